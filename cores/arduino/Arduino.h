@@ -66,14 +66,22 @@ void loop( void ) ;
 #include "Tone.h"
 #include "WMath.h"
 #include "HardwareSerial.h"
+#include "StringBuilder.h"
 #include "pulse.h"
 #endif
 #include "delay.h"
+#include "core_events.h"
 #ifdef __cplusplus
 #include "drivers/usart/usart.h"
+#ifdef CORE_USB_CDC
+#include "drivers/usb/usb_serial.h"
+#endif
 #endif
 
 #include "wiring_digital.h"
+#ifdef __cplusplus
+#include "drivers/gpio/fastio.h"
+#endif
 #include "wiring_analog.h"
 #include "wiring_shift.h"
 #include "WInterrupts.h"
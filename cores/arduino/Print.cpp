@@ -15,11 +15,25 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 #include "Arduino.h"
 
 #include "Print.h"
+#include "ftoa.h"
+
+// size of the staging buffer println() and print(Printable) collect their
+// output in, so the sink receives it with a single write()
+#ifndef PRINTLN_STAGING_SIZE
+#define PRINTLN_STAGING_SIZE 32
+#endif
+
+// size of the staging buffer printf() formats into
+#ifndef PRINTF_STAGING_SIZE
+#define PRINTF_STAGING_SIZE 64
+#endif
 
 // Public Methods //////////////////////////////////////////////////////////////
 
@@ -78,8 +92,8 @@ size_t Print::print(long n, int base)
   } else if (base == 10) {
     if (n < 0) {
       int t = print('-');
-      n = -n;
-      return printNumber(n, 10) + t;
+      // negate as unsigned, so LONG_MIN does not overflow
+      return printNumber(0ul - (unsigned long) n, 10) + t;
     }
     return printNumber(n, 10);
   } else {
@@ -95,6 +109,29 @@ size_t Print::print(unsigned long n, int base)
     return printNumber(n, base);
 }
 
+size_t Print::print(long long n, int base)
+{
+  if (base == 0) {
+    return write(n);
+  } else if (base == 10) {
+    if (n < 0) {
+      int t = print('-');
+      return printNumber64(0ull - (unsigned long long) n, 10) + t;
+    }
+    return printNumber64(n, 10);
+  } else {
+    return printNumber64(n, base);
+  }
+}
+
+size_t Print::print(unsigned long long n, int base)
+{
+  if (base == 0)
+    return write(n);
+  else
+    return printNumber64(n, base);
+}
+
 size_t Print::print(double n, int digits)
 {
   return printFloat(n, digits);
@@ -102,14 +139,17 @@ size_t Print::print(double n, int digits)
 
 size_t Print::println(const __FlashStringHelper *ifsh)
 {
-  size_t n = print(ifsh);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(ifsh);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::print(const Printable& x)
 {
-  return x.printTo(*this);
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  x.printTo(staged);
+  return staged.commit();
 }
 
 size_t Print::println(void)
@@ -119,140 +159,486 @@ size_t Print::println(void)
 
 size_t Print::println(const String &s)
 {
-  size_t n = print(s);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(s);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(const char c[])
 {
-  size_t n = print(c);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(c);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(char c)
 {
-  size_t n = print(c);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(c);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(unsigned char b, int base)
 {
-  size_t n = print(b, base);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(b, base);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(int num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(unsigned int num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(long num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(unsigned long num, int base)
 {
-  size_t n = print(num, base);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
+}
+
+size_t Print::println(long long num, int base)
+{
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
+}
+
+size_t Print::println(unsigned long long num, int base)
+{
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, base);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(double num, int digits)
 {
-  size_t n = print(num, digits);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(num, digits);
+  staged.println();
+  return staged.commit();
 }
 
 size_t Print::println(const Printable& x)
 {
-  size_t n = print(x);
-  n += println();
-  return n;
+  PrintBuffer<PRINTLN_STAGING_SIZE> staged(*this);
+  staged.print(x);
+  staged.println();
+  return staged.commit();
 }
 
 // Private Methods /////////////////////////////////////////////////////////////
 
-size_t Print::printNumber(unsigned long n, uint8_t base)
+// pairs of decimal digits "00" to "99", to convert two digits per step
+static const char decimal_digit_pairs[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static const char digit_chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+/**
+ * format a value as decimal, right-aligned to end.
+ * returns a pointer to the first digit.
+ * the division by the constant 100 compiles to a multiply with its reciprocal, not a division.
+ */
+static char *formatDecimal(uint32_t n, char *end)
 {
-  char buf[8 * sizeof(long) + 1]; // Assumes 8-bit chars plus zero byte.
-  char *str = &buf[sizeof(buf) - 1];
+  while (n >= 100) {
+    const uint32_t q = n / 100;
+    const uint32_t r = n - (q * 100);
+    n = q;
+    end -= 2;
+    memcpy(end, &decimal_digit_pairs[r * 2], 2);
+  }
 
-  *str = '\0';
+  if (n >= 10) {
+    end -= 2;
+    memcpy(end, &decimal_digit_pairs[n * 2], 2);
+  } else {
+    *--end = char('0' + n);
+  }
+  return end;
+}
 
-  // prevent crash if called with base == 1
-  if (base < 2)
-    base = 10;
+/**
+ * format a value below 10^9 as exactly 9 decimal digits, right-aligned to end.
+ * returns a pointer to the first digit.
+ */
+static char *formatDecimal9(uint32_t n, char *end)
+{
+  for (int i = 0; i < 4; i++) {
+    const uint32_t q = n / 100;
+    const uint32_t r = n - (q * 100);
+    n = q;
+    end -= 2;
+    memcpy(end, &decimal_digit_pairs[r * 2], 2);
+  }
+  *--end = char('0' + n);
+  return end;
+}
 
+/**
+ * format a value in a power-of-two base, right-aligned to end.
+ * returns a pointer to the first digit.
+ */
+template <typename T>
+static char *formatPow2(T n, uint8_t shift, char *end)
+{
+  const uint8_t mask = uint8_t((1u << shift) - 1);
   do {
-    char c = n % base;
-    n /= base;
+    *--end = digit_chars[uint8_t(n) & mask];
+    n >>= shift;
+  } while (n);
+  return end;
+}
 
-    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+/**
+ * format a value in any base, right-aligned to end.
+ * returns a pointer to the first digit.
+ */
+template <typename T>
+static char *formatGeneric(T n, uint8_t base, char *end)
+{
+  do {
+    const T q = n / base;
+    *--end = digit_chars[n - (q * base)];
+    n = q;
   } while (n);
+  return end;
+}
 
-  return write(str);
+/**
+ * get log2 of a power-of-two base, or 0 if the base is not a power of two.
+ */
+static inline uint8_t getPow2Shift(uint8_t base)
+{
+  return (base & (base - 1)) == 0 ? uint8_t(__builtin_ctz(base)) : 0;
 }
 
-size_t Print::printFloat(double number, uint8_t digits)
+size_t Print::printNumber(unsigned long n, uint8_t base)
 {
-  size_t n = 0;
+  char buf[8 * sizeof(long)]; // Assumes 8-bit chars, base 2 worst case.
+  char *end = &buf[sizeof(buf)];
+  char *str;
+
+  // prevent crash if called with base == 1, and limit to available digits
+  if (base < 2 || base > 36)
+    base = 10;
 
-  if (isnan(number))
-    return print("nan");
-  if (isinf(number))
-    return print("inf");
-  if (number > 4294967040.0)
-    return print("ovf");  // constant determined empirically
-  if (number < -4294967040.0)
-    return print("ovf");  // constant determined empirically
-
-  // Handle negative numbers
-  if (number < 0.0) {
-    n += print('-');
-    number = -number;
+  const uint8_t shift = getPow2Shift(base);
+  if (base == 10)
+    str = formatDecimal(n, end);
+  else if (shift != 0)
+    str = formatPow2(n, shift, end);
+  else
+    str = formatGeneric(n, base, end);
+
+  return write(str, end - str);
+}
+
+/**
+ * format a 64-bit value in any base, right-aligned to end.
+ * returns a pointer to the first digit.
+ */
+static char *formatUnsigned64(unsigned long long n, uint8_t base, char *end)
+{
+  const uint8_t shift = getPow2Shift(base);
+  if (base == 10) {
+    // split off chunks of 9 digits, so only the split needs a 64-bit division
+    while (n > 0xFFFFFFFFull) {
+      const unsigned long long q = n / 1000000000ull;
+      end = formatDecimal9(uint32_t(n - (q * 1000000000ull)), end);
+      n = q;
+    }
+    return formatDecimal(uint32_t(n), end);
+  } else if (shift != 0) {
+    return formatPow2(n, shift, end);
+  } else {
+    return formatGeneric(n, base, end);
   }
+}
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (uint8_t i = 0; i < digits; ++i)
-    rounding /= 10.0;
+size_t Print::printNumber64(unsigned long long n, uint8_t base)
+{
+  char buf[8 * sizeof(long long)]; // Assumes 8-bit chars, base 2 worst case.
+  char *end = &buf[sizeof(buf)];
 
-  number += rounding;
+  if (base < 2 || base > 36)
+    base = 10;
 
-  // Extract the integer part of the number and print it
-  unsigned long int_part = (unsigned long) number;
-  double remainder = number - (double) int_part;
-  n += print(int_part);
+  const char *str = formatUnsigned64(n, base, end);
+  return write(str, end - str);
+}
 
-  // Print the decimal point, but only if there are digits beyond
-  if (digits > 0) {
-    n += print('.');
+size_t Print::printFloat(double number, uint8_t digits)
+{
+  // format in single precision, the FPU cannot do double
+  char buf[FTOA_BUFFER_SIZE];
+  const size_t len = ftoa_fixed((float) number, digits, buf);
+  size_t n = write(buf, len);
+
+  // digits beyond FTOA_MAX_DIGITS are always zero, but not for nan, inf or ovf
+  if (digits > FTOA_MAX_DIGITS && memchr(buf, '.', len) != NULL) {
+    for (uint8_t i = FTOA_MAX_DIGITS; i < digits; i++)
+      n += print('0');
   }
 
-  // Extract digits from the remainder one at a time
-  while (digits-- > 0) {
-    remainder *= 10.0;
-    unsigned int toPrint = (unsigned int) (remainder);
-    n += print(toPrint);
-    remainder -= toPrint;
-  }
+  return n;
+}
 
+// printf //////////////////////////////////////////////////////////////////////
+
+size_t Print::printf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  const size_t n = vprintf(format, args);
+  va_end(args);
   return n;
 }
+
+// write count copies of a character
+static void printRepeat(Print &out, char c, size_t count)
+{
+  while (count-- > 0)
+    out.write(c);
+}
+
+size_t Print::vprintf(const char *format, va_list args)
+{
+  // formatted output is collected here, and reaches the sink in chunks
+  PrintBuffer<PRINTF_STAGING_SIZE> out(*this);
+
+  const char *p = format;
+  while (*p) {
+    // copy literal text up to the next conversion in one write
+    const char *literal = p;
+    while (*p && *p != '%')
+      p++;
+    if (p > literal)
+      out.write(literal, p - literal);
+    if (*p == '\0')
+      break;
+    p++;
+
+    // flags
+    bool left = false, zero = false, plus = false, space = false, alternate = false;
+    for (;; p++) {
+      if (*p == '-') left = true;
+      else if (*p == '0') zero = true;
+      else if (*p == '+') plus = true;
+      else if (*p == ' ') space = true;
+      else if (*p == '#') alternate = true;
+      else break;
+    }
+
+    // width
+    size_t width = 0;
+    if (*p == '*') {
+      const int w = va_arg(args, int);
+      if (w < 0)
+        left = true;
+      width = w < 0 ? size_t(-w) : size_t(w);
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9')
+        width = (width * 10) + size_t(*p++ - '0');
+    }
+
+    // precision, -1 if not set
+    int precision = -1;
+    if (*p == '.') {
+      p++;
+      precision = 0;
+      if (*p == '*') {
+        precision = va_arg(args, int);
+        if (precision < 0)
+          precision = -1;
+        p++;
+      } else {
+        while (*p >= '0' && *p <= '9')
+          precision = (precision * 10) + (*p++ - '0');
+      }
+    }
+
+    // length modifier: 'H' = hh, 'h', 'l', 'L' = ll / j, 'z' = z / t, or 0
+    char length = 0;
+    if (*p == 'h') {
+      length = (*++p == 'h') ? (p++, 'H') : 'h';
+    } else if (*p == 'l') {
+      length = (*++p == 'l') ? (p++, 'L') : 'l';
+    } else if (*p == 'j') {
+      length = 'L';
+      p++;
+    } else if (*p == 'z' || *p == 't') {
+      length = 'z';
+      p++;
+    }
+
+    const char conversion = *p;
+    if (conversion == '\0')
+      break;
+    p++;
+
+    // convert the argument into str / len
+    char buf[FTOA_BUFFER_SIZE > 24 ? FTOA_BUFFER_SIZE : 24];
+    char *const end = &buf[sizeof(buf)];
+    const char *str = buf;
+    size_t len = 0;
+    char sign = 0;
+    const char *prefix = "";
+    size_t trailingZeros = 0;
+    bool numeric = true;
+
+    switch (conversion) {
+      case 'd':
+      case 'i': {
+        long long v;
+        if (length == 'L') v = va_arg(args, long long);
+        else if (length == 'l') v = va_arg(args, long);
+        else if (length == 'z') v = va_arg(args, ptrdiff_t);
+        else v = va_arg(args, int);
+        if (length == 'h') v = (short) v;
+        else if (length == 'H') v = (signed char) v;
+
+        const unsigned long long u = v < 0 ? 0ull - (unsigned long long) v : (unsigned long long) v;
+        sign = v < 0 ? '-' : (plus ? '+' : (space ? ' ' : 0));
+        str = (u == 0 && precision == 0) ? end : formatUnsigned64(u, 10, end);
+        len = end - str;
+        break;
+      }
+
+      case 'u':
+      case 'x':
+      case 'X':
+      case 'o':
+      case 'p': {
+        unsigned long long u;
+        if (conversion == 'p') u = (uintptr_t) va_arg(args, void *);
+        else if (length == 'L') u = va_arg(args, unsigned long long);
+        else if (length == 'l') u = va_arg(args, unsigned long);
+        else if (length == 'z') u = va_arg(args, size_t);
+        else u = va_arg(args, unsigned int);
+        if (length == 'h') u = (unsigned short) u;
+        else if (length == 'H') u = (unsigned char) u;
+
+        const uint8_t base = (conversion == 'u') ? 10 : ((conversion == 'o') ? 8 : 16);
+        str = (u == 0 && precision == 0) ? end : formatUnsigned64(u, base, end);
+        len = end - str;
+
+        if (conversion == 'x' || conversion == 'p') {
+          for (char *c = const_cast<char *>(str); c < end; c++)
+            if (*c >= 'A') *c |= 0x20;
+        }
+
+        if (conversion == 'p' || (alternate && u != 0 && base == 16))
+          prefix = (conversion == 'X') ? "0X" : "0x";
+        else if (alternate && base == 8 && (len == 0 || *str != '0'))
+          prefix = "0";
+        break;
+      }
+
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G': {
+        // all float conversions print as fixed-point, in single precision
+        const float v = (float) va_arg(args, double);
+        const uint8_t digits = precision < 0 ? 6 : (precision > 255 ? 255 : uint8_t(precision));
+        len = ftoa_fixed(v, digits, buf);
+        if (buf[0] == '-') {
+          sign = '-';
+          str = &buf[1];
+          len--;
+        } else if (plus || space) {
+          sign = plus ? '+' : ' ';
+        }
+
+        // nan and inf are not zero-padded, and digits beyond FTOA_MAX_DIGITS are always zero
+        numeric = isfinite(v) && memchr(str, 'o', len) == NULL;
+        if (numeric && digits > FTOA_MAX_DIGITS)
+          trailingZeros = digits - FTOA_MAX_DIGITS;
+        precision = -1;
+        break;
+      }
+
+      case 'c':
+        buf[0] = char(va_arg(args, int));
+        len = 1;
+        numeric = false;
+        break;
+
+      case 's':
+        str = va_arg(args, const char *);
+        if (str == NULL)
+          str = "(null)";
+        len = precision < 0 ? strlen(str) : strnlen(str, size_t(precision));
+        numeric = false;
+        break;
+
+      case '%':
+        out.write('%');
+        continue;
+
+      default:
+        // unknown conversion, print it as is
+        out.write('%');
+        out.write(conversion);
+        continue;
+    }
+
+    // precision of integers is the minimum number of digits
+    const size_t leadingZeros = (numeric && precision > 0 && size_t(precision) > len) ? size_t(precision) - len : 0;
+    const size_t prefixLength = strlen(prefix);
+    const size_t total = (sign ? 1 : 0) + prefixLength + leadingZeros + len + trailingZeros;
+    const size_t pad = width > total ? width - total : 0;
+
+    // zero padding goes between sign and digits. it does not apply to integers with precision
+    const bool zeroPad = zero && !left && numeric && precision < 0;
+    if (!left && !zeroPad)
+      printRepeat(out, ' ', pad);
+    if (sign)
+      out.write(sign);
+    out.write(prefix, prefixLength);
+    if (zeroPad)
+      printRepeat(out, '0', pad);
+    printRepeat(out, '0', leadingZeros);
+    out.write(str, len);
+    printRepeat(out, '0', trailingZeros);
+    if (left)
+      printRepeat(out, ' ', pad);
+  }
+
+  return out.commit();
+}
@@ -18,6 +18,8 @@
 
 #include <inttypes.h>
 #include <stdio.h> // for size_t
+#include <string.h>
+#include <stdarg.h>
 
 #include "WString.h"
 #include "Printable.h"
@@ -35,11 +37,12 @@ class Print
   private:
     int write_error;
     size_t printNumber(unsigned long, uint8_t);
+    size_t printNumber64(unsigned long long, uint8_t);
     size_t printFloat(double, uint8_t);
   protected:
     void setWriteError(int err = 1) { write_error = err; }
   public:
-    Print() : write_error(0) {}
+    constexpr Print() : write_error(0) {}
 
     int getWriteError() { return write_error; }
     void clearWriteError() { setWriteError(0); }
@@ -67,6 +70,8 @@ class Print
     size_t print(unsigned int, int = DEC);
     size_t print(long, int = DEC);
     size_t print(unsigned long, int = DEC);
+    size_t print(long long, int = DEC);
+    size_t print(unsigned long long, int = DEC);
     size_t print(double, int = 2);
     size_t print(const Printable&);
 
@@ -79,11 +84,185 @@ class Print
     size_t println(unsigned int, int = DEC);
     size_t println(long, int = DEC);
     size_t println(unsigned long, int = DEC);
+    size_t println(long long, int = DEC);
+    size_t println(unsigned long long, int = DEC);
     size_t println(double, int = 2);
     size_t println(const Printable&);
     size_t println(void);
 
+    // lightweight printf, formatting straight into this sink.
+    // supports d i u x X o p c s %, flags "-+ 0#", width, precision and
+    // length modifiers hh h l ll j z t. floats (f F e E g G) are always
+    // printed as fixed-point, in single precision.
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    size_t vprintf(const char *format, va_list args);
+
     virtual void flush() { /* Empty implementation for backward compatibility */ }
 };
 
+// Write-combining adapter for a Print sink. Collects small writes in a
+// buffer of N bytes and passes them on with a single bulk write(), so the
+// sink sees whole chunks instead of one virtual write(uint8_t) per byte.
+// Writes of N bytes or more bypass the buffer.
+// Call commit() to pass on the collected bytes. The destructor commits, too.
+template <size_t N>
+class PrintBuffer final : public Print
+{
+  private:
+    Print &target;
+    uint8_t buffer[N];
+    size_t count;
+    size_t written;
+
+  public:
+    PrintBuffer(Print &target) : target(target), count(0), written(0) {}
+    ~PrintBuffer() { commit(); }
+
+    PrintBuffer(const PrintBuffer &) = delete;
+    PrintBuffer &operator=(const PrintBuffer &) = delete;
+
+    size_t write(uint8_t c) override {
+      if (count >= N)
+        commit();
+      buffer[count++] = c;
+      return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t size) override {
+      if (count + size > N)
+        commit();
+      if (size >= N) {
+        const size_t n = target.write(data, size);
+        written += n;
+        if (n < size)
+          setWriteError();
+        return n;
+      }
+      memcpy(&buffer[count], data, size);
+      count += size;
+      return size;
+    }
+
+    using Print::write;
+
+    int availableForWrite() override { return target.availableForWrite(); }
+
+    // pass on the collected bytes, and flush the sink
+    void flush() override {
+      commit();
+      target.flush();
+    }
+
+    // pass on the collected bytes.
+    // returns the total number of bytes the sink accepted so far.
+    size_t commit() {
+      if (count > 0) {
+        const size_t n = target.write(buffer, count);
+        written += n;
+        if (n < count)
+          setWriteError();
+        count = 0;
+      }
+      return written;
+    }
+};
+
+// Output multiplexer: mirrors everything printed to it to up to N sinks.
+// Numbers and strings are formatted once, and the resulting bytes are passed
+// to every sink with its bulk write(). A sink that accepts less (e.g. a Usart
+// with the DropNewest tx overflow policy) only drops its own data; the other
+// sinks still receive everything. Wrap in a PrintBuffer to combine the small
+// writes of printf() into one write per sink.
+template <size_t N>
+class PrintMux final : public Print
+{
+  private:
+    Print *sinks[N];
+    size_t dropped[N];
+    size_t count;
+
+  public:
+    PrintMux() : count(0) {}
+
+    PrintMux(const PrintMux &) = delete;
+    PrintMux &operator=(const PrintMux &) = delete;
+
+    // add a sink. returns false if all N slots are used, or it was already added
+    bool add(Print &sink) {
+      if (count >= N || indexOf(sink) >= 0)
+        return false;
+      sinks[count] = &sink;
+      dropped[count] = 0;
+      count++;
+      return true;
+    }
+
+    // remove a sink. returns false if it was not added
+    bool remove(Print &sink) {
+      const int i = indexOf(sink);
+      if (i < 0)
+        return false;
+      for (size_t j = i + 1; j < count; j++) {
+        sinks[j - 1] = sinks[j];
+        dropped[j - 1] = dropped[j];
+      }
+      count--;
+      return true;
+    }
+
+    size_t sinkCount() const { return count; }
+
+    // number of bytes a sink did not accept since it was added
+    size_t droppedBytes(const Print &sink) const {
+      const int i = indexOf(sink);
+      return i < 0 ? 0 : dropped[i];
+    }
+
+    size_t write(uint8_t c) override {
+      return write(&c, 1);
+    }
+
+    // returns the most bytes any sink accepted, so the caller only sees
+    // a short write if every sink dropped data
+    size_t write(const uint8_t *data, size_t size) override {
+      size_t accepted = 0;
+      for (size_t i = 0; i < count; i++) {
+        const size_t n = sinks[i]->write(data, size);
+        if (n < size) {
+          dropped[i] += size - n;
+          setWriteError();
+        }
+        if (n > accepted)
+          accepted = n;
+      }
+      return accepted;
+    }
+
+    using Print::write;
+
+    // the space of the fullest sink
+    int availableForWrite() override {
+      int available = 0;
+      for (size_t i = 0; i < count; i++) {
+        const int n = sinks[i]->availableForWrite();
+        if (i == 0 || n < available)
+          available = n;
+      }
+      return available;
+    }
+
+    void flush() override {
+      for (size_t i = 0; i < count; i++)
+        sinks[i]->flush();
+    }
+
+  private:
+    int indexOf(const Print &sink) const {
+      for (size_t i = 0; i < count; i++)
+        if (sinks[i] == &sink)
+          return int(i);
+      return -1;
+    }
+};
+
 #endif
@@ -3,10 +3,20 @@
 
 /**
  * @brief generic ring buffer
+ * @tparam TElement the element type
+ * @tparam N the capacity of the buffer. must be a power of two.
+ *           if 0, the capacity is set at runtime (see RingBuffer<TElement, 0>)
+ * @note in scenarios where there is always one consumer and one producer, the buffer is thread safe (and thus may be used from within an interrupt handler)
+ */
+template <typename TElement, size_t N = 0>
+class RingBuffer;
+
+/**
+ * @brief generic ring buffer, with capacity set at runtime
  * @note in scenarios where there is always one consumer and one producer, the buffer is thread safe (and thus may be used from within an interrupt handler)
  */
 template <typename TElement>
-class RingBuffer
+class RingBuffer<TElement, 0>
 {
 public:
     /**
@@ -16,29 +26,37 @@ public:
     {
         this->buffer = new TElement[capacity];
         this->_capacity = capacity;
+        this->_owns_buffer = true;
         clear();
     }
 
     /**
      * @brief Construct a new Ring Buffer object with the given buffer and capacity
      * @note the buffer must be at least the size of the capacity
-     * @note the buffer will be freed when the RingBuffer is destroyed
+     * @note the buffer is not owned by the RingBuffer and is never freed by it.
+     *       this allows the use of statically allocated buffers
+     * @note constexpr, so a global instance is initialized at compile time instead of by a static constructor
      */
-    RingBuffer(TElement *buffer, size_t capacity)
+    constexpr RingBuffer(TElement *buffer, size_t capacity)
+        : buffer(buffer), _capacity(capacity), _owns_buffer(false), _count(0), _wi(0), _ri(0)
     {
-        this->buffer = buffer;
-        this->_capacity = capacity;
-        clear();
     }
 
     /**
-     * @brief Destroy the Ring Buffer object, freeing the buffer
+     * @brief Destroy the Ring Buffer object, freeing the buffer if it was allocated by the RingBuffer
      */
     ~RingBuffer()
     {
-        delete[] this->buffer;
+        if (this->_owns_buffer)
+        {
+            delete[] this->buffer;
+        }
     }
 
+    // copying would share (and double-free) the buffer
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
     /**
      * @brief Get the number of elements in the buffer
      */
@@ -76,7 +94,7 @@ public:
      */
     TElement peek()
     {
-        return this->isEmpty() ? 0 : this->buffer[this->_ri];
+        return this->isEmpty() ? TElement() : this->buffer[this->_ri];
     }
 
     /**
@@ -85,7 +103,7 @@ public:
      * @param force if true, a element will be overwritten case the buffer is full
      * @return true if the element was pushed, false if the buffer is full
      */
-    bool push(TElement element, bool force = false)
+    bool push(const TElement &element, bool force = false)
     {
         if (!force && this->isFull())
         {
@@ -113,6 +131,123 @@ public:
         return true;
     }
 
+    /**
+     * @brief Push multiple elements onto the buffer
+     * @param elements the elements to push
+     * @param count the number of elements to push
+     * @return the number of elements pushed. less than count if the buffer is full
+     */
+    size_t push(const TElement *elements, size_t count)
+    {
+        // limit to free space
+        const size_t free = this->capacity() - this->count();
+        if (count > free)
+        {
+            count = free;
+        }
+
+        // copy in up to two contiguous regions: until the end of the buffer, then from the start
+        size_t wi = this->_wi;
+        for (size_t i = 0; i < count; i++)
+        {
+            this->buffer[wi] = elements[i];
+            if (++wi >= this->_capacity)
+            {
+                wi = 0;
+            }
+        }
+        this->_wi = wi;
+
+        // increment count atomically, once for all elements
+        // (__sync builtins are full barriers, so the element writes are visible before)
+        __sync_fetch_and_add(&this->_count, count);
+        return count;
+    }
+
+    /**
+     * @brief Pop multiple elements from the buffer
+     * @param elements the buffer to pop the elements into
+     * @param count the maximum number of elements to pop
+     * @return the number of elements popped. less than count if the buffer runs empty
+     */
+    size_t pop(TElement *elements, size_t count)
+    {
+        // limit to available elements
+        const size_t available = this->count();
+        if (count > available)
+        {
+            count = available;
+        }
+
+        size_t ri = this->_ri;
+        for (size_t i = 0; i < count; i++)
+        {
+            elements[i] = this->buffer[ri];
+            if (++ri >= this->_capacity)
+            {
+                ri = 0;
+            }
+        }
+        this->_ri = ri;
+
+        // decrement count atomically, once for all elements
+        __sync_fetch_and_sub(&this->_count, count);
+        return count;
+    }
+
+    /**
+     * @brief Get the next elements in the buffer as a contiguous span, without removing them
+     * @param span pointer to the first element that would be popped next
+     * @return number of elements that can be read from span without wrapping around
+     * @note once the elements were processed, call consume() to remove them from the buffer
+     * @note the span stays valid until it is consumed, since the producer never writes to occupied slots
+     */
+    size_t peekContiguous(TElement *&span)
+    {
+        const size_t count = this->count();
+        const size_t untilWrap = this->_capacity - this->_ri;
+        span = &this->buffer[this->_ri];
+        return count < untilWrap ? count : untilWrap;
+    }
+
+    /**
+     * @brief Remove elements from the buffer without reading them
+     * @param count the number of elements to remove. must not exceed count()
+     */
+    void consume(size_t count)
+    {
+        this->_ri = (this->_ri + count) % (this->_capacity);
+
+        // decrement count atomically
+        __sync_fetch_and_sub(&this->_count, count);
+    }
+
+    /**
+     * @brief Get the free space after the last element as a contiguous span
+     * @param span pointer to the first free slot
+     * @return number of elements that can be written to span without wrapping around
+     * @note once the elements were written, call commit() to add them to the buffer
+     */
+    size_t reserveContiguous(TElement *&span)
+    {
+        const size_t free = this->_capacity - this->count();
+        const size_t untilWrap = this->_capacity - this->_wi;
+        span = &this->buffer[this->_wi];
+        return free < untilWrap ? free : untilWrap;
+    }
+
+    /**
+     * @brief Add elements written to the span returned by reserveContiguous() to the buffer
+     * @param count the number of elements to add. must not exceed the size returned by reserveContiguous()
+     */
+    void commit(size_t count)
+    {
+        this->_wi = (this->_wi + count) % (this->_capacity);
+
+        // increment count atomically
+        __sync_fetch_and_add(&this->_count, count);
+    }
+
     /**
      * @brief Clear the buffer
      */
@@ -124,7 +259,7 @@ public:
     }
 
 private:
-    void _push(TElement element)
+    void _push(const TElement &element)
     {
         this->buffer[this->_wi] = element;
         this->_wi = (this->_wi + 1) % (this->_capacity);
@@ -146,13 +281,18 @@ private:
     /**
      * @brief the data buffer
      */
-    volatile uint8_t *buffer;
+    TElement *buffer;
 
     /**
      * @brief the length of the data buffer
      */
     volatile size_t _capacity;
 
+    /**
+     * @brief was the buffer allocated by the RingBuffer?
+     */
+    bool _owns_buffer;
+
     /**
      * @brief the number of elements in the buffer
      */
@@ -170,3 +310,240 @@ private:
      */
     volatile size_t _ri;
 };
+
+/**
+ * @brief ring buffer with static storage and a capacity that is a power of two
+ * @note instead of a shared element count, the producer only writes the write index and
+ *       the consumer only writes the read index. with one consumer and one producer, no atomic
+ *       operations are required, making it suitable for use within interrupt handlers
+ * @note the indices run freely and are masked on access, so all N slots are usable
+ */
+template <typename TElement, size_t N>
+class RingBuffer
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+public:
+    /**
+     * @brief Construct a new empty Ring Buffer object
+     * @note constexpr, so a global instance is initialized at compile time instead of by a static constructor
+     */
+    constexpr RingBuffer()
+        : buffer(), _wi(0), _ri(0)
+    {
+    }
+
+    /**
+     * @brief Get the number of elements in the buffer
+     */
+    size_t count()
+    {
+        return this->_wi - this->_ri;
+    }
+
+    /**
+     * @brief Get the capacity of the buffer
+     */
+    constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    /**
+     * @brief Test if the buffer is full
+     */
+    bool isFull()
+    {
+        return this->count() >= N;
+    }
+
+    /**
+     * @brief Test if the buffer is empty
+     */
+    bool isEmpty()
+    {
+        return this->_wi == this->_ri;
+    }
+
+    /**
+     * @brief Get the next element in the buffer without removing it
+     */
+    TElement peek()
+    {
+        return this->isEmpty() ? TElement() : this->buffer[this->_ri & MASK];
+    }
+
+    /**
+     * @brief Push an element onto the buffer
+     * @param element the element to push
+     * @return true if the element was pushed, false if the buffer is full
+     */
+    bool push(const TElement &element)
+    {
+        if (this->isFull())
+        {
+            return false;
+        }
+
+        this->buffer[this->_wi & MASK] = element;
+        publish_write(1);
+        return true;
+    }
+
+    /**
+     * @brief Pop an element from the buffer
+     * @param element the element to pop
+     * @return true if the element was popped, false if the buffer is empty
+     */
+    bool pop(TElement &element)
+    {
+        if (this->isEmpty())
+        {
+            return false;
+        }
+
+        element = this->buffer[this->_ri & MASK];
+        publish_read(1);
+        return true;
+    }
+
+    /**
+     * @brief Push multiple elements onto the buffer
+     * @param elements the elements to push
+     * @param count the number of elements to push
+     * @return the number of elements pushed. less than count if the buffer is full
+     */
+    size_t push(const TElement *elements, size_t count)
+    {
+        const size_t free = N - this->count();
+        if (count > free)
+        {
+            count = free;
+        }
+
+        const size_t wi = this->_wi;
+        for (size_t i = 0; i < count; i++)
+        {
+            this->buffer[(wi + i) & MASK] = elements[i];
+        }
+
+        publish_write(count);
+        return count;
+    }
+
+    /**
+     * @brief Pop multiple elements from the buffer
+     * @param elements the buffer to pop the elements into
+     * @param count the maximum number of elements to pop
+     * @return the number of elements popped. less than count if the buffer runs empty
+     */
+    size_t pop(TElement *elements, size_t count)
+    {
+        const size_t available = this->count();
+        if (count > available)
+        {
+            count = available;
+        }
+
+        const size_t ri = this->_ri;
+        for (size_t i = 0; i < count; i++)
+        {
+            elements[i] = this->buffer[(ri + i) & MASK];
+        }
+
+        publish_read(count);
+        return count;
+    }
+
+    /**
+     * @brief Get the next elements in the buffer as a contiguous span, without removing them
+     * @param span pointer to the first element that would be popped next
+     * @return number of elements that can be read from span without wrapping around
+     * @note once the elements were processed, call consume() to remove them from the buffer
+     */
+    size_t peekContiguous(TElement *&span)
+    {
+        const size_t count = this->count();
+        const size_t ri = this->_ri & MASK;
+        const size_t untilWrap = N - ri;
+        span = &this->buffer[ri];
+        return count < untilWrap ? count : untilWrap;
+    }
+
+    /**
+     * @brief Remove elements from the buffer without reading them
+     * @param count the number of elements to remove. must not exceed count()
+     */
+    void consume(size_t count)
+    {
+        publish_read(count);
+    }
+
+    /**
+     * @brief Get the free space after the last element as a contiguous span
+     * @param span pointer to the first free slot
+     * @return number of elements that can be written to span without wrapping around
+     * @note once the elements were written, call commit() to add them to the buffer
+     */
+    size_t reserveContiguous(TElement *&span)
+    {
+        const size_t free = N - this->count();
+        const size_t wi = this->_wi & MASK;
+        const size_t untilWrap = N - wi;
+        span = &this->buffer[wi];
+        return free < untilWrap ? free : untilWrap;
+    }
+
+    /**
+     * @brief Add elements written to the span returned by reserveContiguous() to the buffer
+     * @param count the number of elements to add. must not exceed the size returned by reserveContiguous()
+     */
+    void commit(size_t count)
+    {
+        publish_write(count);
+    }
+
+    /**
+     * @brief Clear the buffer
+     * @note not thread safe, only call while neither producer nor consumer is active
+     */
+    void clear()
+    {
+        this->_wi = 0;
+        this->_ri = 0;
+    }
+
+private:
+    static constexpr size_t MASK = N - 1;
+
+    void publish_write(size_t count)
+    {
+        // element writes must be visible before the new write index
+        __sync_synchronize();
+        this->_wi = this->_wi + count;
+    }
+
+    void publish_read(size_t count)
+    {
+        // element reads must be completed before the slots are released
+        __sync_synchronize();
+        this->_ri = this->_ri + count;
+    }
+
+    /**
+     * @brief the data buffer
+     */
+    TElement buffer[N];
+
+    /**
+     * @brief the write index
+     * @note only written by the producer. masked on access
+     */
+    volatile size_t _wi;
+
+    /**
+     * @brief the read index
+     * @note only written by the consumer. masked on access
+     */
+    volatile size_t _ri;
+};
@@ -25,6 +25,7 @@
 #include "Stream.h"
 
 #include "Arduino.h"
+#include "parse_number.h"
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 
@@ -123,6 +124,13 @@ bool Stream::findUntil(char *target, size_t targetLen, char *terminator, size_t
   }
 }
 
+// can parsing from the buffered input span be used with the given ignore character?
+// the span parser knows nothing about ignore characters, so the number must not contain one
+static inline bool canParseSpan(char ignore)
+{
+  return !((ignore >= '0' && ignore <= '9') || ignore == '-' || ignore == '.');
+}
+
 // returns the first valid (long) integer value from the current position.
 // lookahead determines how parseInt looks ahead in the stream.
 // See LookaheadMode enumeration at the top of the file.
@@ -139,6 +147,19 @@ long Stream::parseInt(LookaheadMode lookahead, char ignore)
   if(c < 0)
     return 0; // zero returned if timeout
 
+  // fast path: parse straight from the buffered input if the whole number and its
+  // terminator are already there. otherwise, fall through to the character loop
+  const char *span;
+  const size_t spanLength = peekSpan(span);
+  if (spanLength > 0 && canParseSpan(ignore)) {
+    const size_t n = parse_long(span, spanLength, &value);
+    if (n > 0 && n < spanLength && span[n] != ignore) {
+      skipSpan(n);
+      return value;
+    }
+    value = 0;
+  }
+
   do{
     if(c == ignore)
       ; // ignore this character
@@ -157,19 +178,32 @@ long Stream::parseInt(LookaheadMode lookahead, char ignore)
 }
 
 // as parseInt but returns a floating point value
+// the digits are collected as integer mantissa and decimal exponent, and converted once at the end,
+// which is exact for up to 7 significant digits (see parse_decimal_to_float)
 float Stream::parseFloat(LookaheadMode lookahead, char ignore)
 {
   bool isNegative = false;
   bool isFraction = false;
-  long value = 0;
+  parse_decimal_t decimal = {0, 0, 0};
   int c;
-  float fraction = 1.0;
 
   c = peekNextDigit(lookahead, true);
     // ignore non numeric leading characters
   if(c < 0)
     return 0; // zero returned if timeout
 
+  // fast path, see parseInt
+  const char *span;
+  const size_t spanLength = peekSpan(span);
+  if (spanLength > 0 && canParseSpan(ignore)) {
+    float value;
+    const size_t n = parse_float(span, spanLength, &value);
+    if (n > 0 && n < spanLength && span[n] != ignore) {
+      skipSpan(n);
+      return value;
+    }
+  }
+
   do{
     if(c == ignore)
       ; // ignore
@@ -177,22 +211,50 @@ float Stream::parseFloat(LookaheadMode lookahead, char ignore)
       isNegative = true;
     else if (c == '.')
       isFraction = true;
-    else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1;
-    }
+    else if(c >= '0' && c <= '9')        // is c a digit?
+      parse_decimal_push(&decimal, c - '0', isFraction);
     read();  // consume the character we got with peek
     c = timedPeek();
   }
   while( (c >= '0' && c <= '9')  || (c == '.' && !isFraction) || c == ignore );
 
-  if(isNegative)
-    value = -value;
-  if(isFraction)
-    return value * fraction;
-  else
-    return value;
+  const float value = parse_decimal_to_float(decimal.mantissa, decimal.exponent);
+  return isNegative ? -value : value;
+}
+
+int Stream::findMulti(TokenMatcher *matchers, int count) {
+  for (int m = 0; m < count; m++) {
+    if (matchers[m].getLength() == 0)
+      return m;
+    matchers[m].reset();
+  }
+
+  while (1) {
+    // scan everything that is buffered in one go, and consume only up to the match
+    const char *span;
+    const size_t spanLength = peekSpan(span);
+    if (spanLength > 0) {
+      for (size_t i = 0; i < spanLength; i++) {
+        for (int m = 0; m < count; m++) {
+          if (matchers[m].push(span[i])) {
+            skipSpan(i + 1);
+            return m;
+          }
+        }
+      }
+      skipSpan(spanLength);
+      continue;
+    }
+
+    int c = timedRead();
+    if (c < 0)
+      return -1;
+
+    for (int m = 0; m < count; m++) {
+      if (matchers[m].push(char(c)))
+        return m;
+    }
+  }
 }
 
 // read characters from stream into buffer
@@ -262,6 +324,21 @@ int Stream::findMulti( struct Stream::MultiTarget *targets, int tCount) {
       return t - targets;
   }
 
+  // search in linear time with precompiled matchers, if the targets fit
+  const int maxMatchers = 4;
+  bool fits = tCount <= maxMatchers;
+  for (struct MultiTarget *t = targets; fits && t < targets+tCount; ++t) {
+    fits = t->len <= TOKEN_MATCHER_MAX_LENGTH;
+  }
+
+  if (fits) {
+    TokenMatcher matchers[maxMatchers];
+    for (int i = 0; i < tCount; i++) {
+      matchers[i].setPattern(targets[i].str, targets[i].len);
+    }
+    return findMulti(matchers, tCount);
+  }
+
   while (1) {
     int c = timedRead();
     if (c < 0)
@@ -25,6 +25,7 @@
 #include <inttypes.h>
 
 #include "Print.h"
+#include "TokenMatcher.h"
 
 // compatability macros for testing
 /*
@@ -56,13 +57,19 @@ class Stream : public Print
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(LookaheadMode lookahead, bool detectDecimal); // returns the next numeric digit in the stream or -1 if timeout
 
+    // optional zero-copy access to the buffered input, used by parseInt() and parseFloat().
+    // peekSpan() returns the number of contiguous characters readable at span without consuming them,
+    // or 0 if the stream does not support it. skipSpan() then consumes count of those characters.
+    virtual size_t peekSpan(const char *&span) { (void)span; return 0; }
+    virtual void skipSpan(size_t count) { (void)count; }
+
   public:
     virtual int available() = 0;
     virtual int read() = 0;
     virtual int peek() = 0;
     virtual void flush() = 0;
 
-    Stream() {_timeout=1000; _startMillis = 0;}
+    constexpr Stream() : _timeout(1000), _startMillis(0) {}
 
 // parsing methods
 
@@ -84,6 +91,14 @@ class Stream : public Print
   bool findUntil(char *target, size_t targetLen, char *terminate, size_t termLen);   // as above but search ends if the terminate string is found
   bool findUntil(uint8_t *target, size_t targetLen, char *terminate, size_t termLen) {return findUntil((char *)target, targetLen, terminate, termLen); }
 
+  bool find(TokenMatcher &matcher) { return findMulti(&matcher, 1) == 0; }
+  // as find, but with a precompiled pattern. searches in linear time
+
+  int findMulti(TokenMatcher *matchers, int count);
+  // reads data from the stream until any of the patterns is found
+  // returns the index of the matcher found first, or -1 if timed out
+  // buffered input is scanned in bulk when the stream supports peekSpan()
+
   long parseInt(LookaheadMode lookahead = SKIP_ALL, char ignore = NO_IGNORE_CHAR);
   // returns the first valid (long) integer value from the current position.
   // lookahead determines how parseInt looks ahead in the stream.
@@ -0,0 +1,150 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Print.h"
+
+/**
+ * @brief fixed-capacity string builder, in a buffer inside the object
+ * @tparam N size of the buffer, including the '\0'. the string holds at most N - 1 characters
+ * @note implements Print, so everything that can be printed can be written into it.
+ *       a message is built in one pass on the stack, without heap allocation:
+ *       StringBuilder<64> msg;
+ *       msg.print("X:");
+ *       msg.print(x);
+ *       msg.printf(" Y:%d", y);
+ *       Serial.println(msg);
+ * @note printf() is the one of Print, so formatting does not use newlib stdio
+ * @note writes that do not fit are truncated, and mark the builder as overflowed
+ */
+template <size_t N>
+class StringBuilder : public Print
+{
+    static_assert(N > 0, "StringBuilder must have space for the '\\0'");
+
+public:
+    StringBuilder()
+    {
+        clear();
+    }
+
+    /**
+     * @brief construct a builder containing a string
+     */
+    explicit StringBuilder(const char *str)
+    {
+        clear();
+        Print::write(str);
+    }
+
+    /**
+     * @brief append a character
+     * @return 1 if the character was appended, 0 if the builder is full
+     */
+    size_t write(uint8_t c) override
+    {
+        if (this->_length >= (N - 1))
+        {
+            this->markOverflow();
+            return 0;
+        }
+
+        this->_buffer[this->_length++] = char(c);
+        this->_buffer[this->_length] = '\0';
+        return 1;
+    }
+
+    /**
+     * @brief append a block of characters
+     * @return number of characters appended. less than size if the builder is full
+     */
+    size_t write(const uint8_t *buffer, size_t size) override
+    {
+        const size_t remaining = (N - 1) - this->_length;
+        if (size > remaining)
+        {
+            size = remaining;
+            this->markOverflow();
+        }
+
+        memcpy(&this->_buffer[this->_length], buffer, size);
+        this->_length += size;
+        this->_buffer[this->_length] = '\0';
+        return size;
+    }
+
+    using Print::write;
+
+    /**
+     * @brief get the number of characters that can still be appended
+     */
+    int availableForWrite() override
+    {
+        return int((N - 1) - this->_length);
+    }
+
+    /**
+     * @brief clear the contents and the overflow flag
+     */
+    void clear()
+    {
+        this->_length = 0;
+        this->_buffer[0] = '\0';
+        this->_overflow = false;
+        this->clearWriteError();
+    }
+
+    /**
+     * @brief get the string, always '\0'-terminated
+     */
+    const char *c_str() const
+    {
+        return this->_buffer;
+    }
+
+    operator const char *() const
+    {
+        return this->_buffer;
+    }
+
+    /**
+     * @brief get the number of characters in the string
+     */
+    size_t length() const
+    {
+        return this->_length;
+    }
+
+    /**
+     * @brief get the maximum number of characters
+     */
+    constexpr size_t capacity() const
+    {
+        return N - 1;
+    }
+
+    /**
+     * @brief was any write truncated since the last clear()?
+     */
+    bool overflowed() const
+    {
+        return this->_overflow;
+    }
+
+private:
+    char _buffer[N];
+    size_t _length;
+    bool _overflow;
+
+    void markOverflow()
+    {
+        this->_overflow = true;
+        this->setWriteError();
+    }
+};
+
+/**
+ * @brief fixed-capacity string, alias of StringBuilder
+ */
+template <size_t N>
+using FixedString = StringBuilder<N>;
@@ -0,0 +1,64 @@
+#include "TokenMatcher.h"
+#include "core_debug.h"
+#include <string.h>
+
+TokenMatcher::TokenMatcher(const char *pattern)
+{
+    setPattern(pattern, strlen(pattern));
+}
+
+TokenMatcher::TokenMatcher(const char *pattern, size_t length)
+{
+    setPattern(pattern, length);
+}
+
+void TokenMatcher::setPattern(const char *pattern, size_t length)
+{
+    CORE_ASSERT(length <= TOKEN_MATCHER_MAX_LENGTH, "TokenMatcher pattern too long", length = TOKEN_MATCHER_MAX_LENGTH);
+
+    this->pattern = pattern;
+    this->length = uint8_t(length);
+    this->state = 0;
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    // standard KMP prefix function
+    this->failure[0] = 0;
+    uint8_t k = 0;
+    for (size_t i = 1; i < length; i++)
+    {
+        while (k > 0 && pattern[i] != pattern[k])
+        {
+            k = this->failure[k - 1];
+        }
+
+        if (pattern[i] == pattern[k])
+        {
+            k++;
+        }
+
+        this->failure[i] = k;
+    }
+}
+
+int TokenMatcher::find(const char *buffer, size_t size)
+{
+    if (this->length == 0)
+    {
+        // an empty pattern matches immediately
+        return 0;
+    }
+
+    for (size_t i = 0; i < size; i++)
+    {
+        if (push(buffer[i]))
+        {
+            return int(i + 1);
+        }
+    }
+
+    return -1;
+}
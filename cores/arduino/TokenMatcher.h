@@ -0,0 +1,113 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TOKEN_MATCHER_MAX_LENGTH
+/**
+ * @brief maximum pattern length of a TokenMatcher
+ * @note each TokenMatcher reserves one byte per character for its failure table
+ */
+#define TOKEN_MATCHER_MAX_LENGTH 32
+#endif
+
+static_assert(TOKEN_MATCHER_MAX_LENGTH > 0 && TOKEN_MATCHER_MAX_LENGTH <= 255, "TOKEN_MATCHER_MAX_LENGTH must be between 1 and 255");
+
+/**
+ * @brief precompiled search pattern, matched in linear time (Knuth-Morris-Pratt)
+ * @note the failure table is computed once on construction, so each searched character costs amortized O(1),
+ *       and characters are never re-scanned
+ * @note the match state carries over between calls, so a token split across several buffers is still found.
+ *       Stream::find() resets it before searching
+ * @note the pattern string is not copied, and must stay valid for the lifetime of the matcher
+ */
+class TokenMatcher
+{
+public:
+    /**
+     * @brief construct an empty matcher. call setPattern() before use
+     */
+    TokenMatcher() : pattern(nullptr), length(0), state(0) {}
+
+    /**
+     * @brief construct a matcher for a '\0'-terminated pattern
+     */
+    explicit TokenMatcher(const char *pattern);
+
+    /**
+     * @brief construct a matcher for a pattern of the given length
+     */
+    TokenMatcher(const char *pattern, size_t length);
+
+    /**
+     * @brief set the pattern and precompute the failure table
+     * @note patterns longer than TOKEN_MATCHER_MAX_LENGTH are rejected with a CORE_ASSERT, and truncated
+     */
+    void setPattern(const char *pattern, size_t length);
+
+    /**
+     * @brief reset the match state
+     */
+    void reset()
+    {
+        this->state = 0;
+    }
+
+    /**
+     * @brief feed one character
+     * @return true if the character completed a match
+     */
+    bool push(char c)
+    {
+        if (this->length == 0)
+        {
+            return true;
+        }
+
+        while (this->state > 0 && c != this->pattern[this->state])
+        {
+            this->state = this->failure[this->state - 1];
+        }
+
+        if (c == this->pattern[this->state])
+        {
+            this->state++;
+        }
+
+        if (this->state == this->length)
+        {
+            // allow overlapping matches, e.g. "aa" twice in "aaa"
+            this->state = this->failure[this->length - 1];
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief search a buffer for the pattern
+     * @param buffer the buffer to search
+     * @param size size of the buffer
+     * @return offset one past the end of the first match, or -1 if the buffer does not contain a match
+     * @note continues from the current match state
+     */
+    int find(const char *buffer, size_t size);
+    int find(const uint8_t *buffer, size_t size) { return find(reinterpret_cast<const char *>(buffer), size); }
+
+    /**
+     * @brief get the pattern length
+     */
+    size_t getLength() const
+    {
+        return this->length;
+    }
+
+private:
+    const char *pattern;
+    uint8_t length;
+
+    // number of pattern characters matched so far
+    uint8_t state;
+
+    // failure[i]: length of the longest proper prefix of pattern[0..i] that is also a suffix of it
+    uint8_t failure[TOKEN_MATCHER_MAX_LENGTH];
+};
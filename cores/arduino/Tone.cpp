@@ -0,0 +1,90 @@
+#include "Tone.h"
+#include "drivers/gpio/gpio.h"
+#include "drivers/timera/timera_tone.h"
+#include "core_debug.h"
+
+// pin that currently plays a tone, or BOARD_NR_GPIO_PINS if none
+static volatile gpio_pin_t tone_pin = BOARD_NR_GPIO_PINS;
+
+/**
+ * @brief return a pin to GPIO function, driven LOW
+ */
+static void release_pin(const gpio_pin_t pin)
+{
+    GPIO_SetFunc(pin, Func_Gpio);
+    digitalWrite(pin, LOW);
+}
+
+/**
+ * @brief a tone with a duration stopped on its own
+ * @note called from the TimerA overflow interrupt
+ */
+static void tone_done(timera_config_t *unit)
+{
+    (void)unit;
+    const gpio_pin_t pin = tone_pin;
+    if (pin < BOARD_NR_GPIO_PINS)
+    {
+        release_pin(pin);
+        tone_pin = BOARD_NR_GPIO_PINS;
+    }
+}
+
+void tone(gpio_pin_t _pin, uint32_t frequency, uint32_t duration)
+{
+    ASSERT_GPIO_PIN_VALID(_pin, "tone");
+    if (_pin >= BOARD_NR_GPIO_PINS)
+    {
+        return;
+    }
+
+    // only one tone at a time
+    if (tone_pin != _pin)
+    {
+        noTone(tone_pin);
+    }
+
+    // the tone is generated by the TimerA unit of the pin
+    timera_config_t *unit;
+    en_timera_channel_t channel;
+    en_port_func_t port_function;
+    if (!timera_get_assignment(_pin, unit, channel, port_function))
+    {
+        CORE_ASSERT_FAIL("tone: pin has no TimerA assignment");
+        return;
+    }
+
+    if (frequency == 0)
+    {
+        noTone(_pin);
+        return;
+    }
+
+    if (timera_tone_start(unit, channel, frequency, duration, tone_done) != Ok)
+    {
+        CORE_ASSERT_FAIL("tone: TimerA unit of pin is in use");
+        return;
+    }
+
+    GPIO_SetFunc(_pin, port_function);
+    tone_pin = _pin;
+}
+
+void noTone(gpio_pin_t _pin)
+{
+    if (_pin >= BOARD_NR_GPIO_PINS || _pin != tone_pin)
+    {
+        return;
+    }
+
+    timera_config_t *unit;
+    en_timera_channel_t channel;
+    en_port_func_t port_function;
+    if (timera_get_assignment(_pin, unit, channel, port_function))
+    {
+        timera_tone_stop(unit);
+    }
+
+    release_pin(_pin);
+    tone_pin = BOARD_NR_GPIO_PINS;
+}
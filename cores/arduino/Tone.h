@@ -19,14 +19,26 @@
 #ifndef TONE_H_
 #define TONE_H_
 
+#include "Arduino.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
-#include "Arduino.h"
-
+  /**
+   * \brief generate a square wave of the given frequency on a pin, using the TimerA unit of the pin
+   * \param _pin the pin. must have a TimerA assignment
+   * \param frequency the frequency of the tone, in Hz
+   * \param duration the duration of the tone, in milliseconds. 0 to play until noTone() is called
+   * \note only one tone can play at a time. the wave is generated in hardware, the duration is counted by the timer interrupt
+   */
   void tone(gpio_pin_t _pin, uint32_t frequency, uint32_t duration = 0);
+
+  /**
+   * \brief stop the tone on a pin
+   * \param _pin the pin
+   */
   void noTone(gpio_pin_t _pin);
 
 #ifdef __cplusplus
@@ -1,6 +1,8 @@
 #include "WInterrupts.h"
 #include "wiring_constants.h"
 #include "core_debug.h"
+#include "core_util.h"
+#include "core_events.h"
 #include "drivers/gpio/gpio.h"
 #include "drivers/irqn/irqn.h"
 #include <hc32_ddl.h>
@@ -24,6 +26,38 @@ inline en_exti_lvl_t mapToTriggerMode(uint32_t mode)
     return ExIntFallingEdge;
 }
 
+inline void mapToFilter(uint32_t filter, en_functional_state_t &enable, en_exti_filter_clock_t &clock)
+{
+    if (filter == EXTI_FILTER_DEFAULT)
+    {
+        filter = EXTI_DEFAULT_FILTER;
+    }
+
+    enable = Enable;
+    switch (filter)
+    {
+    case EXTI_FILTER_NONE:
+        enable = Disable;
+        clock = Pclk3Div1;
+        return;
+    case EXTI_FILTER_PCLK3_DIV1:
+        clock = Pclk3Div1;
+        return;
+    case EXTI_FILTER_PCLK3_DIV8:
+        clock = Pclk3Div8;
+        return;
+    case EXTI_FILTER_PCLK3_DIV32:
+        clock = Pclk3Div32;
+        return;
+    case EXTI_FILTER_PCLK3_DIV64:
+        clock = Pclk3Div64;
+        return;
+    }
+
+    CORE_ASSERT_FAIL("Invalid external interrupt filter. only EXTI_FILTER_xx are valid");
+    clock = Pclk3Div8;
+}
+
 inline en_exti_ch_t mapToExternalInterruptChannel(gpio_pin_t pin)
 {
     // check range
@@ -68,6 +102,25 @@ inline en_int_src_t mapToInterruptSource(gpio_pin_t pin)
     return (en_int_src_t)ch;
 }
 
+/**
+ * @brief filter of each EXTI line, EXTI_FILTER_xx
+ */
+static uint8_t exti_filters[16];
+
+/**
+ * @brief (re-) initialize the EXTI channel of a pin
+ */
+inline void initExternalInterruptChannel(gpio_pin_t pin, uint32_t mode)
+{
+    stc_exint_config_t extiConf = {
+        .enExitCh = mapToExternalInterruptChannel(pin),
+        .enFilterEn = Enable,
+        .enFltClk = Pclk3Div8,
+        .enExtiLvl = mapToTriggerMode(mode)};
+    mapToFilter(exti_filters[extiConf.enExitCh], extiConf.enFilterEn, extiConf.enFltClk);
+    EXINT_Init(&extiConf);
+}
+
 void _attachInterrupt(gpio_pin_t pin, voidFuncPtr handler, IRQn_Type irqn, uint32_t mode)
 {
     // check inputs
@@ -79,12 +132,7 @@ void _attachInterrupt(gpio_pin_t pin, voidFuncPtr handler, IRQn_Type irqn, uint3
     }
 
     // initialize external interrupt channel
-    stc_exint_config_t extiConf = {
-        .enExitCh = mapToExternalInterruptChannel(pin),
-        .enFilterEn = Enable,
-        .enFltClk = Pclk3Div8,
-        .enExtiLvl = mapToTriggerMode(mode)};
-    EXINT_Init(&extiConf);
+    initExternalInterruptChannel(pin, mode);
 
     // configure port for external interrupt
     stc_port_init_t portConf;
@@ -92,6 +140,12 @@ void _attachInterrupt(gpio_pin_t pin, voidFuncPtr handler, IRQn_Type irqn, uint3
     portConf.enExInt = Enable;
     GPIO_Init(pin, &portConf);
 
+#ifdef EXTI_SHARED_IRQ
+    // enable the source on the shared IRQ.
+    // the handler is called by ExtintXX_IrqHandler()
+    (void)irqn;
+    enShareIrqEnable(mapToInterruptSource(pin));
+#else
     // register IRQ
     stc_irq_regi_conf_t irqReg = {
         .enIntSrc = mapToInterruptSource(pin),
@@ -101,8 +155,9 @@ void _attachInterrupt(gpio_pin_t pin, voidFuncPtr handler, IRQn_Type irqn, uint3
 
     // clear pending, set priority and enable
     NVIC_ClearPendingIRQ(irqReg.enIRQn);
-    NVIC_SetPriority(irqReg.enIRQn, DDL_IRQ_PRIORITY_DEFAULT);
+    NVIC_SetPriority(irqReg.enIRQn, IRQ_PRIORITY_EXTI);
     NVIC_EnableIRQ(irqReg.enIRQn);
+#endif
 }
 
 void _detachInterrupt(gpio_pin_t pin, IRQn_Type irqn)
@@ -120,135 +175,207 @@ void _detachInterrupt(gpio_pin_t pin, IRQn_Type irqn)
     portConf.enExInt = Disable;
     GPIO_Init(pin, &portConf);
 
+#ifdef EXTI_SHARED_IRQ
+    // disable the source on the shared IRQ, keep the shared IRQ itself enabled
+    (void)irqn;
+    enShareIrqDisable(mapToInterruptSource(pin));
+    EXINT_IrqFlgClr(mapToExternalInterruptChannel(pin));
+#else
     // clear pending and disable IRQ
     NVIC_ClearPendingIRQ(irqn);
     NVIC_DisableIRQ(irqn);
     enIrqResign(irqn);
+#endif
 }
 // #endregion
 
-// #region pin to IRQn mapping
-typedef struct pin_to_irqn_mapping_t
+// #region context-carrying handlers
+/**
+ * @brief callback with context pointer, per EXTI line
+ */
+typedef struct exti_param_handler_t
 {
-    gpio_pin_t pin;
-    IRQn_Type irqn;
-    struct pin_to_irqn_mapping_t *next;
-} pin_to_irqn_mapping_t;
+    voidFuncPtrParam callback;
+    void *param;
+} exti_param_handler_t;
+
+static exti_param_handler_t exti_param_handlers[16];
 
 /**
- * @brief Linked list of pin to IRQn mappings
+ * @brief trampoline for callbacks with context pointer
+ * @note the EXTI line is a template parameter, so the slot address is constant
  */
-pin_to_irqn_mapping_t *pin_to_irqn_mapping = NULL;
+template <uint8_t ch>
+CORE_RAMFUNC static void exti_param_irq(void)
+{
+    exti_param_handlers[ch].callback(exti_param_handlers[ch].param);
+}
+
+static const voidFuncPtr exti_param_irqs[16] = {
+    exti_param_irq<0>,
+    exti_param_irq<1>,
+    exti_param_irq<2>,
+    exti_param_irq<3>,
+    exti_param_irq<4>,
+    exti_param_irq<5>,
+    exti_param_irq<6>,
+    exti_param_irq<7>,
+    exti_param_irq<8>,
+    exti_param_irq<9>,
+    exti_param_irq<10>,
+    exti_param_irq<11>,
+    exti_param_irq<12>,
+    exti_param_irq<13>,
+    exti_param_irq<14>,
+    exti_param_irq<15>,
+};
+// #endregion
 
+// #region EXTI line table
 /**
- * @brief insert a pin -> irqn mapping
+ * @brief state of a EXTI line
+ * @note each EXTI line can only be used by one pin at a time, so the table is indexed by EXTI line
  */
-inline void insert_pin_to_irqn_mapping(gpio_pin_t pin, IRQn_Type irqn)
+typedef struct exti_line_t
 {
-    // create new node
-    pin_to_irqn_mapping_t *node = new pin_to_irqn_mapping_t;
-    node->pin = pin;
-    node->irqn = irqn;
-    node->next = NULL;
-
-    // insert node...
-    if (pin_to_irqn_mapping == NULL)
-    {
-        // ... as head
-        pin_to_irqn_mapping = node;
-    }
-    else
-    {
-        // ... as child of last node:
-        // find last node
-        pin_to_irqn_mapping_t *parent = pin_to_irqn_mapping;
-        while (parent->next != NULL)
-        {
-            parent = parent->next;
-        }
+    /**
+     * @brief is the line attached to a pin?
+     */
+    bool in_use;
+
+    /**
+     * @brief the pin that uses the line
+     */
+    gpio_pin_t pin;
 
-        // set as child
-        parent->next = node;
-    }
-}
+    /**
+     * @brief the IRQn assigned to the line
+     * @note with EXTI_SHARED_IRQ, all lines use the shared IRQ
+     */
+    IRQn_Type irqn;
+
+    /**
+     * @brief the handler of the line
+     * @note only called directly with EXTI_SHARED_IRQ or EXTI_TIMESTAMP
+     */
+    voidFuncPtr handler;
+
+    /**
+     * @brief the trigger mode of the line, as passed to attachInterrupt()
+     */
+    uint32_t mode;
+} exti_line_t;
+
+static exti_line_t exti_lines[16];
 
 /**
- * @brief get a pin -> irqn mapping by pin number
+ * @brief get the EXTI line used by a pin, or NULL if the pin has no interrupt attached
  */
-inline bool get_pin_to_irqn_mapping(gpio_pin_t pin, pin_to_irqn_mapping_t &mapping)
+inline exti_line_t *get_exti_line_of_pin(gpio_pin_t pin)
 {
-    // find node
-    pin_to_irqn_mapping_t *node = pin_to_irqn_mapping;
-    while (node != NULL && node->pin != pin)
-    {
-        node = node->next;
-    }
+    exti_line_t *line = &exti_lines[mapToExternalInterruptChannel(pin)];
+    return (line->in_use && line->pin == pin) ? line : NULL;
+}
 
-    // return mapping
-    if (node != NULL && node->pin == pin)
-    {
-        mapping = *node;
-        return true;
-    }
+#ifdef EXTI_TIMESTAMP
+/**
+ * @brief DWT cycle count at the last interrupt entry, per EXTI line
+ */
+static volatile uint32_t exti_timestamps[16];
 
-    // not found
-    return false;
+#define EXTI_LATCH_TIMESTAMP(ch) exti_timestamps[ch] = DWT->CYCCNT
+
+#ifndef EXTI_SHARED_IRQ
+/**
+ * @brief IRQ handler that takes the timestamp, then calls the handler of a EXTI line
+ */
+template <uint8_t ch>
+CORE_RAMFUNC static void exti_timestamp_irq(void)
+{
+    EXTI_LATCH_TIMESTAMP(ch);
+    exti_lines[ch].handler();
 }
 
+static const voidFuncPtr exti_timestamp_irqs[16] = {
+    exti_timestamp_irq<0>,
+    exti_timestamp_irq<1>,
+    exti_timestamp_irq<2>,
+    exti_timestamp_irq<3>,
+    exti_timestamp_irq<4>,
+    exti_timestamp_irq<5>,
+    exti_timestamp_irq<6>,
+    exti_timestamp_irq<7>,
+    exti_timestamp_irq<8>,
+    exti_timestamp_irq<9>,
+    exti_timestamp_irq<10>,
+    exti_timestamp_irq<11>,
+    exti_timestamp_irq<12>,
+    exti_timestamp_irq<13>,
+    exti_timestamp_irq<14>,
+    exti_timestamp_irq<15>,
+};
+#endif // !EXTI_SHARED_IRQ
+
+#else
+#define EXTI_LATCH_TIMESTAMP(ch)
+#endif // EXTI_TIMESTAMP
+
+#ifdef EXTI_SHARED_IRQ
+/**
+ * @brief shared IRQ of all EXTI lines
+ */
+#define EXTI_SHARED_IRQn Int128_IRQn
+
 /**
- * @brief remove a pin -> irqn mapping by pin number
+ * @brief handler called by the shared IRQ for a EXTI line
+ * @note the DDL shared IRQ handler only calls the handlers of lines that are enabled and have their flag set
  */
-inline void remove_pin_to_irqn_mapping(gpio_pin_t pin)
+template <uint8_t ch>
+CORE_RAMFUNC static void exti_shared_irq(void)
 {
-    // find node
-    pin_to_irqn_mapping_t *node = pin_to_irqn_mapping;
-    pin_to_irqn_mapping_t *parent = NULL;
-    while (node != NULL && node->pin != pin)
+    EXTI_LATCH_TIMESTAMP(ch);
+    const voidFuncPtr handler = exti_lines[ch].handler;
+    if (handler != NULL)
     {
-        parent = node;
-        node = node->next;
+        handler();
     }
+}
 
-    // remove node
-    if (node != NULL && node->pin == pin)
-    {
-        // remove node from linked list
-        if (parent != NULL)
-        {
-            parent->next = node->next;
-        }
-        else
-        {
-            pin_to_irqn_mapping = node->next;
-        }
-
-        // free node
-        delete[] node;
-    }
+extern "C"
+{
+    void Extint00_IrqHandler(void) { exti_shared_irq<0>(); }
+    void Extint01_IrqHandler(void) { exti_shared_irq<1>(); }
+    void Extint02_IrqHandler(void) { exti_shared_irq<2>(); }
+    void Extint03_IrqHandler(void) { exti_shared_irq<3>(); }
+    void Extint04_IrqHandler(void) { exti_shared_irq<4>(); }
+    void Extint05_IrqHandler(void) { exti_shared_irq<5>(); }
+    void Extint06_IrqHandler(void) { exti_shared_irq<6>(); }
+    void Extint07_IrqHandler(void) { exti_shared_irq<7>(); }
+    void Extint08_IrqHandler(void) { exti_shared_irq<8>(); }
+    void Extint09_IrqHandler(void) { exti_shared_irq<9>(); }
+    void Extint10_IrqHandler(void) { exti_shared_irq<10>(); }
+    void Extint11_IrqHandler(void) { exti_shared_irq<11>(); }
+    void Extint12_IrqHandler(void) { exti_shared_irq<12>(); }
+    void Extint13_IrqHandler(void) { exti_shared_irq<13>(); }
+    void Extint14_IrqHandler(void) { exti_shared_irq<14>(); }
+    void Extint15_IrqHandler(void) { exti_shared_irq<15>(); }
 }
 
 /**
- * @brief check if a pin -> irqn mapping exists that uses the given EXTi channel
+ * @brief enable the shared IRQ on first use
  */
-inline bool is_exti_channel_in_use(en_int_src_t ch)
+inline void exti_shared_irq_enable()
 {
-    // loop over all pin to irqn mappings, check if any of them uses the given channel
-    pin_to_irqn_mapping_t *node = pin_to_irqn_mapping;
-    while (node != NULL)
+    static bool enabled = false;
+    if (!enabled)
     {
-        // check if channel is in use
-        if (mapToInterruptSource(node->pin) == ch)
-        {
-            return true;
-        }
-
-        // next node
-        node = node->next;
+        NVIC_ClearPendingIRQ(EXTI_SHARED_IRQn);
+        NVIC_SetPriority(EXTI_SHARED_IRQn, IRQ_PRIORITY_EXTI);
+        NVIC_EnableIRQ(EXTI_SHARED_IRQn);
+        enabled = true;
     }
-
-    // channel is not in use
-    return false;
 }
+#endif // EXTI_SHARED_IRQ
 
 // #endregion
 
@@ -256,18 +383,28 @@ int attachInterrupt(gpio_pin_t pin, voidFuncPtr callback, uint32_t mode)
 {
     ASSERT_GPIO_PIN_VALID(pin, "attachInterrupt");
     CORE_ASSERT(callback != NULL, "interrupt callback must not be NULL");
+    if (pin >= BOARD_NR_GPIO_PINS || callback == NULL)
+    {
+        return -1;
+    }
 
     // detach any existing interrupt
     detachInterrupt(pin);
 
-    // assert EXTI channel is not already in use
-    if (is_exti_channel_in_use(mapToInterruptSource(pin)))
+    // assert EXTI line is not already in use
+    exti_line_t *line = &exti_lines[mapToExternalInterruptChannel(pin)];
+    if (line->in_use)
     {
-        // EXTI channel is already in use
+        // EXTI line is already in use
         CORE_DEBUG_PRINTF("attachInterrupt: EXTI channel is already in use for pin=%d\n", pin);
         return -1;
     }
 
+#ifdef EXTI_SHARED_IRQ
+    // all lines use the shared IRQ
+    IRQn_Type irqn = EXTI_SHARED_IRQn;
+    exti_shared_irq_enable();
+#else
     // auto-assign a irqn
     IRQn_Type irqn;
     if (irqn_aa_get(irqn, "external interrupt") != Ok)
@@ -276,39 +413,122 @@ int attachInterrupt(gpio_pin_t pin, voidFuncPtr callback, uint32_t mode)
         CORE_DEBUG_PRINTF("attachInterrupt: no IRQn available for pin=%d\n", pin);
         return -1;
     }
+#endif
 
-    // insert pin -> irqn mapping
-    insert_pin_to_irqn_mapping(pin, irqn);
+    // claim the line
+    line->pin = pin;
+    line->irqn = irqn;
+    line->handler = callback;
+    line->mode = mode;
+    line->in_use = true;
 
     // set the interrupt
+#if defined(EXTI_TIMESTAMP) && !defined(EXTI_SHARED_IRQ)
+    // the IRQ calls the handler through the timestamp trampoline of the line
+    core_cycle_counter_enable();
+    _attachInterrupt(pin, exti_timestamp_irqs[mapToExternalInterruptChannel(pin)], irqn, mode);
+#else
+#ifdef EXTI_TIMESTAMP
+    core_cycle_counter_enable();
+#endif
     _attachInterrupt(pin, callback, irqn, mode);
+#endif
     CORE_DEBUG_PRINTF("attachInterrupt: pin=%d, irqn=%d, mode=%lu\n", pin, int(irqn), mode);
 
     // return assigned irqn
     return irqn;
 }
 
+int attachInterruptParam(gpio_pin_t pin, voidFuncPtrParam callback, uint32_t mode, void *param)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "attachInterruptParam");
+    CORE_ASSERT(callback != NULL, "interrupt callback must not be NULL");
+    if (pin >= BOARD_NR_GPIO_PINS || callback == NULL)
+    {
+        return -1;
+    }
+
+    // detach any existing interrupt first, so the slot is not in use while it is updated
+    detachInterrupt(pin);
+
+    // set the slot of the pin's EXTI line, then attach the trampoline of that line.
+    // if the line is in use by another pin, attachInterrupt() fails before the slot is used
+    const uint8_t ch = static_cast<uint8_t>(mapToExternalInterruptChannel(pin));
+    if (exti_lines[ch].in_use)
+    {
+        CORE_DEBUG_PRINTF("attachInterruptParam: EXTI channel is already in use for pin=%d\n", pin);
+        return -1;
+    }
+
+    exti_param_handlers[ch].callback = callback;
+    exti_param_handlers[ch].param = param;
+    return attachInterrupt(pin, exti_param_irqs[ch], mode);
+}
+
+/**
+ * @brief events set by each EXTI line, see attachInterruptEvent()
+ */
+static uint32_t exti_line_events[16];
+
+/**
+ * @brief callback that clears the flag of a EXTI line and sets its events
+ * @param param the entry of the line in exti_line_events
+ */
+CORE_RAMFUNC static void exti_event_irq(void *param)
+{
+    const uint32_t *events = static_cast<const uint32_t *>(param);
+    EXINT_IrqFlgClr(static_cast<en_exti_ch_t>(events - exti_line_events));
+    core_events_set(*events);
+}
+
+int attachInterruptEvent(gpio_pin_t pin, uint32_t events, uint32_t mode)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "attachInterruptEvent");
+    CORE_ASSERT(events != 0, "interrupt events must not be 0");
+    if (pin >= BOARD_NR_GPIO_PINS || events == 0)
+    {
+        return -1;
+    }
+
+    // the events of a line in use by another pin must not be changed
+    const uint8_t ch = static_cast<uint8_t>(mapToExternalInterruptChannel(pin));
+    if (exti_lines[ch].in_use && exti_lines[ch].pin != pin)
+    {
+        CORE_DEBUG_PRINTF("attachInterruptEvent: EXTI channel is already in use for pin=%d\n", pin);
+        return -1;
+    }
+
+    exti_line_events[ch] = events;
+    return attachInterruptParam(pin, exti_event_irq, mode, &exti_line_events[ch]);
+}
+
 void detachInterrupt(gpio_pin_t pin)
 {
     ASSERT_GPIO_PIN_VALID(pin, "detachInterrupt");
+    if (pin >= BOARD_NR_GPIO_PINS)
+    {
+        return;
+    }
 
-    // get irqn for pin from mapping
-    pin_to_irqn_mapping_t mapping;
-    if (!get_pin_to_irqn_mapping(pin, mapping))
+    // get EXTI line of the pin
+    exti_line_t *line = get_exti_line_of_pin(pin);
+    if (line == NULL)
     {
-        // no mapping for this pin...
-        // CORE_ASSERT_FAIL("attempted to detach interrupt with no pin mapping")
+        // no interrupt on this pin...
         return;
     }
 
     // remove the interrupt
-    IRQn_Type irqn = mapping.irqn;
+    IRQn_Type irqn = line->irqn;
     _detachInterrupt(pin, irqn);
     CORE_DEBUG_PRINTF("detachInterrupt: pin=%d, irqn=%u\n", pin, irqn);
 
-    // clear irqn assignment and remove mapping
-    remove_pin_to_irqn_mapping(pin);
+    // release the line and the irqn
+    line->in_use = false;
+    line->handler = NULL;
+#ifndef EXTI_SHARED_IRQ
     irqn_aa_resign(irqn, "external interrupt");
+#endif
 }
 
 bool checkIRQFlag(gpio_pin_t pin, bool clear)
@@ -330,17 +550,53 @@ bool checkIRQFlag(gpio_pin_t pin, bool clear)
 
 void setInterruptPriority(gpio_pin_t pin, uint32_t priority)
 {
-    ASSERT_GPIO_PIN_VALID(pin, "detachInterrupt");
+    ASSERT_GPIO_PIN_VALID(pin, "setInterruptPriority");
+    if (pin >= BOARD_NR_GPIO_PINS)
+    {
+        return;
+    }
 
-    // get irqn for pin from mapping
-    pin_to_irqn_mapping_t mapping;
-    if (!get_pin_to_irqn_mapping(pin, mapping))
+    // get EXTI line of the pin
+    exti_line_t *line = get_exti_line_of_pin(pin);
+    if (line == NULL)
     {
-        // no mapping for this pin...
-        // CORE_ASSERT_FAIL("attempted to detach interrupt with no pin mapping")
+        // no interrupt on this pin...
         return;
     }
 
     // set the interrupt priority
-    NVIC_SetPriority(mapping.irqn, priority);
-}
\ No newline at end of file
+    // (with EXTI_SHARED_IRQ, this sets the priority of all external interrupts)
+    NVIC_SetPriority(line->irqn, priority);
+}
+
+void setInterruptFilter(gpio_pin_t pin, uint32_t filter)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "setInterruptFilter");
+    CORE_ASSERT(filter <= EXTI_FILTER_PCLK3_DIV64, "setInterruptFilter: invalid filter", return);
+    if (pin >= BOARD_NR_GPIO_PINS)
+    {
+        return;
+    }
+
+    exti_filters[mapToExternalInterruptChannel(pin)] = static_cast<uint8_t>(filter);
+
+    // apply now if the pin has an interrupt attached
+    exti_line_t *line = get_exti_line_of_pin(pin);
+    if (line != NULL)
+    {
+        initExternalInterruptChannel(pin, line->mode);
+    }
+}
+
+#ifdef EXTI_TIMESTAMP
+uint32_t getInterruptTimestamp(gpio_pin_t pin)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "getInterruptTimestamp");
+    if (pin >= BOARD_NR_GPIO_PINS)
+    {
+        return 0;
+    }
+
+    return exti_timestamps[mapToExternalInterruptChannel(pin)];
+}
+#endif
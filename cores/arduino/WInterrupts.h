@@ -35,6 +35,19 @@ extern "C"
 #define DEFAULT 1
 #define EXTERNAL 0
 
+// digital noise filter of external interrupts, see setInterruptFilter()
+#define EXTI_FILTER_DEFAULT 0
+#define EXTI_FILTER_NONE 1
+#define EXTI_FILTER_PCLK3_DIV1 2
+#define EXTI_FILTER_PCLK3_DIV8 3
+#define EXTI_FILTER_PCLK3_DIV32 4
+#define EXTI_FILTER_PCLK3_DIV64 5
+
+#ifndef EXTI_DEFAULT_FILTER
+// filter used by pins without a filter set by setInterruptFilter()
+#define EXTI_DEFAULT_FILTER EXTI_FILTER_PCLK3_DIV8
+#endif
+
   /*
    * \brief Specifies a named Interrupt Service Routine (ISR) to call when an interrupt occurs.
    *        Detaches any previously attached interrupt on the same pin.
@@ -56,6 +69,11 @@ extern "C"
    * if a interrupt is already attached to the given pin, this function will detach it first.
    *
    * \note
+   * by default, every attached interrupt uses its own auto-assigned IRQn.
+   * with EXTI_SHARED_IRQ, all external interrupts are dispatched from the shared IRQ (Int128_IRQn) instead,
+   * and no IRQn is used. the returned interrupt number is then Int128_IRQn for every pin.
+   *
+   * \note
    * any pin may be used for external interrupts, with the following limitations:
    * - the pin should not be assigned to another function
    * - at most 16 external interrupts can be used at the same time
@@ -67,6 +85,37 @@ extern "C"
    */
   int attachInterrupt(gpio_pin_t pin, voidFuncPtr callback, uint32_t mode);
 
+  /*
+   * \brief Specifies a Interrupt Service Routine (ISR) that receives a context pointer.
+   *        Detaches any previously attached interrupt on the same pin.
+   *
+   * \param pin The pin number to attach the interrupt to
+   * \param callback The function to call when the interrupt occurs
+   * \param mode Defines when the interrupt should be triggered.
+   * \param param The pointer passed to the callback, eg. the object handling the interrupt
+   * \return assigned interrupt number, or -1 if the interrupt couldn't be assigned
+   *
+   * \note
+   * the callback and param are kept in a static slot per EXTI line, so no memory is allocated.
+   * see attachInterrupt() for all other notes.
+   */
+  int attachInterruptParam(gpio_pin_t pin, voidFuncPtrParam callback, uint32_t mode, void *param);
+
+  /*
+   * \brief Sets events when the interrupt of the given pin triggers, instead of calling an ISR.
+   *        Detaches any previously attached interrupt on the same pin.
+   *
+   * \param pin The pin number to attach the interrupt to
+   * \param events The events to set, for waitEvents(). see core_events.h
+   * \param mode Defines when the interrupt should be triggered.
+   * \return assigned interrupt number, or -1 if the interrupt couldn't be assigned
+   *
+   * \note
+   * the interrupt flag is cleared by the core, so checkIRQFlag() is not needed.
+   * see attachInterrupt() for all other notes.
+   */
+  int attachInterruptEvent(gpio_pin_t pin, uint32_t events, uint32_t mode);
+
   /*
    * \brief Turns off the given interrupt.
    *
@@ -97,11 +146,53 @@ extern "C"
    *
    * \param pin The pin to set the priority for
    * \param priority The priority to set. one of DDL_IRQ_PRIORITY_xx
+   *
+   * \note with EXTI_SHARED_IRQ, this sets the priority of all external interrupts
    */
   void setInterruptPriority(gpio_pin_t pin, uint32_t priority);
 
+  /*
+   * \brief set the digital noise filter of the given external interrupt
+   *
+   * \param pin The pin to set the filter for
+   * \param filter The filter. one of EXTI_FILTER_xx
+   *
+   * \note
+   * the filter samples the pin with the given fraction of PCLK3, and ignores pulses shorter than a few samples.
+   * slow clocks suit noisy, slow inputs (endstops, filament sensors), and avoid bursts of interrupts on a
+   * bouncing edge. fast inputs (encoders) should use EXTI_FILTER_PCLK3_DIV1 or EXTI_FILTER_NONE, as the filter
+   * delays every edge.
+   *
+   * \note
+   * the filter belongs to the pin's EXTI line. it may be set before or after attachInterrupt(), and is kept
+   * after detachInterrupt(). EXTI_FILTER_DEFAULT uses EXTI_DEFAULT_FILTER.
+   */
+  void setInterruptFilter(gpio_pin_t pin, uint32_t filter);
+
+#ifdef EXTI_TIMESTAMP
+  /*
+   * \brief get the time of the last interrupt of the given pin
+   *
+   * \param pin The pin to get the timestamp of
+   * \return the DWT cycle counter (CPU clock) at the entry of the last interrupt of the pin's EXTI line
+   *
+   * \note
+   * the timestamp is taken before the handler is called, so it does not include the time spent in other handlers.
+   * call from the handler to get the time of the edge, up to the interrupt latency and the filter delay.
+   */
+  uint32_t getInterruptTimestamp(gpio_pin_t pin);
+#endif
+
 #ifdef __cplusplus
 }
+
+/*
+ * \brief attachInterruptParam() overload of attachInterrupt()
+ */
+inline int attachInterrupt(gpio_pin_t pin, voidFuncPtrParam callback, uint32_t mode, void *param)
+{
+  return attachInterruptParam(pin, callback, mode, param);
+}
 #endif
 
 #endif
@@ -23,11 +23,34 @@ extern "C" {
 }
 #include "WMath.h"
 
+#ifdef CORE_FAST_RANDOM
+// xorshift32 PRNG instead of rand(). fast and small, but not suitable for cryptography
+static uint32_t random_state = 2463534242ul;
+
+static inline uint32_t next_random()
+{
+  uint32_t x = random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  random_state = x;
+
+  // same range as rand()
+  return x & RAND_MAX;
+}
+#else
+#define next_random() rand()
+#endif
+
 extern void randomSeed( uint32_t dwSeed )
 {
   if ( dwSeed != 0 )
   {
+#ifdef CORE_FAST_RANDOM
+    random_state = dwSeed ;
+#else
     srand( dwSeed ) ;
+#endif
   }
 }
 
@@ -38,7 +61,7 @@ extern long random( long howbig )
     return 0 ;
   }
 
-  return rand() % howbig;
+  return next_random() % howbig;
 }
 
 extern long random( long howsmall, long howbig )
@@ -53,6 +76,40 @@ extern long random( long howsmall, long howbig )
   return random(diff) + howsmall;
 }
 
+/**
+ * @brief 32 random bits, from the 31 bits of two random numbers
+ */
+static inline uint32_t next_random32()
+{
+  return (uint32_t( next_random() ) << 1) ^ (uint32_t( next_random() ) & 1) ;
+}
+
+extern uint32_t randomUniform( uint32_t range )
+{
+  if ( range == 0 )
+  {
+    return 0 ;
+  }
+
+  // multiply-shift maps the random bits to [0, range). the few products that would make some results more
+  // likely than others are rejected (Lemire's method). the modulo for the rejection threshold is only computed
+  // when a product is close to it. ranges above 2^31 need a second random number for 32 bits
+  const bool wide = range > 0x80000000ul ;
+  const uint32_t bits = wide ? 32 : 31 ;
+  const uint64_t low_mask = (1ull << bits) - 1 ;
+  uint64_t product = uint64_t( wide ? next_random32() : uint32_t( next_random() ) ) * range ;
+  if ( (product & low_mask) < range )
+  {
+    const uint64_t threshold = ((1ull << bits) - range) % range ;
+    while ( (product & low_mask) < threshold )
+    {
+      product = uint64_t( wide ? next_random32() : uint32_t( next_random() ) ) * range ;
+    }
+  }
+
+  return uint32_t( product >> bits ) ;
+}
+
 extern long map(long x, long in_min, long in_max, long out_min, long out_max)
 {
   return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
@@ -29,5 +29,78 @@ extern uint16_t makeWord( uint8_t h, uint8_t l ) ;
 
 #define word(...) makeWord(__VA_ARGS__)
 
+/**
+ * @brief uniformly distributed random number in [0, range), without the bias of random(howbig)
+ * @note uses a multiply instead of a modulo. 0 if range is 0
+ */
+extern uint32_t randomUniform( uint32_t range ) ;
+
+/**
+ * @brief map() with ranges known at compile time
+ * @note gives the same result as map(). the division is by a constant, so the compiler replaces it by a shift
+ *       (power-of-two input ranges) or a multiplication
+ */
+template <long InMin, long InMax, long OutMin, long OutMax>
+constexpr long map( long x )
+{
+  static_assert( InMax != InMin, "map: input range is empty" ) ;
+  return (x - InMin) * (OutMax - OutMin) / (InMax - InMin) + OutMin ;
+}
+
+/**
+ * @brief scale a value between power-of-two ranges, [0, 2^InBits] to [0, 2^OutBits], e.g. 12-bit ADC to 8-bit PWM
+ * @note a single shift
+ */
+template <uint8_t InBits, uint8_t OutBits>
+constexpr uint32_t mapBits( uint32_t x )
+{
+  static_assert( InBits < 32 && OutBits < 32, "mapBits: ranges must be below 2^32" ) ;
+  return InBits >= OutBits ? (x >> (InBits - OutBits)) : (x << (OutBits - InBits)) ;
+}
+
+/**
+ * @brief map() for ranges set at runtime, but used many times
+ *
+ * the division by the input range is replaced by a multiplication with its reciprocal, calculated once:
+ *
+ *   const Mapper duty(0, 1023, 0, 255);
+ *   analogWrite(pin, duty(value));
+ *
+ * @note gives the same result as map() if |x - in_min| * |out_max - out_min| * |in_max - in_min| < 2^32,
+ *       which covers all 16-bit ranges. larger ranges may be off by one
+ */
+class Mapper
+{
+public:
+  constexpr Mapper( long in_min, long in_max, long out_min, long out_max )
+    : in_min( in_min ),
+      out_min( out_min ),
+      out_span( out_max - out_min ),
+      negative_span( (in_max - in_min) < 0 ),
+      reciprocal( in_max == in_min ? 0 : (0xFFFFFFFFull / uint64_t( (in_max - in_min) < 0 ? (in_min - in_max) : (in_max - in_min) )) + 1 )
+  {
+  }
+
+  constexpr long operator()( long x ) const
+  {
+    // truncates toward zero, like the division of map()
+    return scale( int64_t( x - in_min ) * out_span ) + out_min ;
+  }
+
+private:
+  constexpr long scale( int64_t product ) const
+  {
+    return ((product < 0) != negative_span)
+      ? -long( (uint64_t( product < 0 ? -product : product ) * reciprocal) >> 32 )
+      : long( (uint64_t( product < 0 ? -product : product ) * reciprocal) >> 32 ) ;
+  }
+
+  long in_min ;
+  long out_min ;
+  long out_span ;
+  bool negative_span ;
+  uint64_t reciprocal ;
+};
+
 
 #endif /* _WIRING_MATH_ */
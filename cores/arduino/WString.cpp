@@ -124,7 +124,7 @@ String::String(double value, unsigned char decimalPlaces)
 
 String::~String()
 {
-	free(buffer);
+	releaseBuffer();
 }
 
 /*********************************************/
@@ -140,11 +140,17 @@ inline void String::init(void)
 
 void String::invalidate(void)
 {
-	if (buffer) free(buffer);
+	releaseBuffer();
 	buffer = NULL;
 	capacity = len = 0;
 }
 
+void String::releaseBuffer(void)
+{
+	// the inline buffer is part of the object
+	if (buffer && !isInline()) free(buffer);
+}
+
 unsigned char String::reserve(unsigned int size)
 {
 	if (buffer && capacity >= size) return 1;
@@ -155,8 +161,35 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+unsigned char String::reserveAppend(unsigned int size)
+{
+	// grow by at least half the current capacity, so repeated appends
+	// (e.g. chained operator +) do not reallocate every time
+	if (buffer && capacity < size && size < capacity + (capacity / 2)) {
+		if (reserve(capacity + (capacity / 2))) return 1;
+	}
+	return reserve(size);
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
+	// short strings use the inline buffer
+	if (maxStrLen < CORE_STRING_INLINE_SIZE && (!buffer || isInline())) {
+		buffer = inlineBuffer;
+		capacity = CORE_STRING_INLINE_SIZE - 1;
+		return 1;
+	}
+
+	// moving out of the inline buffer, so keep its contents like realloc() would
+	if (isInline()) {
+		char *newbuffer = (char *)malloc(maxStrLen + 1);
+		if (!newbuffer) return 0;
+		memcpy(newbuffer, inlineBuffer, CORE_STRING_INLINE_SIZE);
+		buffer = newbuffer;
+		capacity = maxStrLen;
+		return 1;
+	}
+
 	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
@@ -195,14 +228,22 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length)
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
 void String::move(String &rhs)
 {
+	// the inline buffer of rhs cannot be taken over, so its contents are copied
+	if (rhs.buffer && rhs.isInline()) {
+		copy(rhs.buffer, rhs.len);
+		rhs.len = 0;
+		rhs.buffer[0] = 0;
+		return;
+	}
+
 	if (buffer) {
-		if (capacity >= rhs.len) {
+		if (rhs.buffer && capacity >= rhs.len) {
 			strcpy(buffer, rhs.buffer);
 			len = rhs.len;
 			rhs.len = 0;
 			return;
 		} else {
-			free(buffer);
+			releaseBuffer();
 		}
 	}
 	buffer = rhs.buffer;
@@ -268,7 +309,7 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
+	if (!reserveAppend(newlen)) return 0;
 	strcpy(buffer + len, cstr);
 	len = newlen;
 	return 1;
@@ -343,7 +384,7 @@ unsigned char String::concat(const __FlashStringHelper * str)
 	int length = strlen_P((const char *) str);
 	if (length == 0) return 1;
 	unsigned int newlen = len + length;
-	if (!reserve(newlen)) return 0;
+	if (!reserveAppend(newlen)) return 0;
 	strcpy_P(buffer + len, (const char *) str);
 	len = newlen;
 	return 1;
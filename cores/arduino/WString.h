@@ -35,6 +35,16 @@
 //     -felide-constructors
 //     -std=c++0x
 
+// size of the buffer inside each String, including the '\0'.
+// Strings shorter than this are stored inline, without any heap allocation.
+#ifndef CORE_STRING_INLINE_SIZE
+#define CORE_STRING_INLINE_SIZE 16
+#endif
+
+#if CORE_STRING_INLINE_SIZE < 1
+#error "CORE_STRING_INLINE_SIZE must be at least 1"
+#endif
+
 class __FlashStringHelper;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
@@ -192,10 +202,14 @@ protected:
 	char *buffer;	        // the actual char array
 	unsigned int capacity;  // the array length minus one (for the '\0')
 	unsigned int len;       // the String length (not counting the '\0')
+	char inlineBuffer[CORE_STRING_INLINE_SIZE]; // storage for short strings, used before the heap
 protected:
 	void init(void);
 	void invalidate(void);
+	void releaseBuffer(void);
+	inline unsigned char isInline(void) const {return buffer == inlineBuffer;}
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char reserveAppend(unsigned int size);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
@@ -24,6 +24,7 @@
 #include <hc32_ddl.h>
 #include <addon_gpio.h>
 #include "drivers/adc/adc.h"
+#include "core_types.h"
 
 // Include board variant
 #include <variant.h>
@@ -101,6 +102,7 @@ extern "C"
 
 	/**
 	 * @brief variant pin map struct
+	 * @note fields are ordered and sized to pack into 16 bytes
 	 */
 	typedef struct pin_info_t
 	{
@@ -112,23 +114,22 @@ extern "C"
 		/**
 		 * @brief IO port this pin belongs to
 		 */
-		en_port_t port;
+		en_port_t port : 8;
 
 		/**
 		 * @brief bit mask of the pin in the port
 		 */
-		en_pin_t bit_mask;
-
-		/**
-		 * @brief adc configuration for this pin
-		 */
-		pin_adc_info_t adc_info;
+		en_pin_t bit_mask : 16;
 
 		/**
 		 * @brief TimerA configuration for this pin
 		 */
 		pin_timera_info_t timera_info;
 
+		/**
+		 * @brief adc configuration for this pin
+		 */
+		pin_adc_info_t adc_info;
 	} pin_info_t;
 
 	/**
@@ -141,8 +142,117 @@ extern "C"
  */
 #define IS_GPIO_PIN(pin) (pin >= 0 && pin < BOARD_NR_GPIO_PINS)
 
+//
+// VARIANT_PIN_MAP helpers
+//
+
+/**
+ * @brief ADC config struct shorthand
+ * @param ch ADC channel number. 0 == ADC1_IN0, ...
+ * @note device is always ADC1_device. with CORE_ADC_BALANCE_CHANNELS, ADC12_INx channels may be moved to ADC2_device by the core
+ */
+#define PINMAP_ADC(ch)                        \
+	{                                         \
+		.device = &ADC1_device, .channel = ch \
+	}
+
+/**
+ * @brief ADC config struct shorthand for no ADC function
+ */
+#define PINMAP_ADC_NONE                            \
+	{                                              \
+		.device = NULL, .channel = ADC_PIN_INVALID \
+	}
+
+/**
+ * @brief TimerA config struct shorthand
+ * @param uni TimerA unit. 1 == M4_TMRA1, ...
+ * @param ch TimerA channel. 1 == TimeraCh1, ...
+ * @param func TimerA GPIO function. 4 == Func_Tima0, 5 == Func_Tima1
+ */
+#define PINMAP_TIMA(uni, ch, func)                               \
+	{                                                            \
+		.unit = uni, .channel = (ch - 1), .function = (func - 4) \
+	}
+
+/**
+ * @brief TimerA config struct shorthand for no TimerA function
+ */
+#define PINMAP_TIMA_NONE                       \
+	{                                          \
+		.unit = 0, .channel = 0, .function = 0 \
+	}
+
+/**
+ * @brief pin_info_t initializer for a VARIANT_PIN_MAP entry
+ */
+#define PINMAP_INFO(bit_pos, port, bit_mask, adc, timera) {bit_pos, port, bit_mask, timera, adc},
+
 #ifdef __cplusplus
 } // extern "C"
+
+// (WVariant.h may be included from within a extern "C" block)
+extern "C++"
+{
+/**
+ * @brief compile-time copy of PIN_MAP
+ * @note only for use in constant expressions, e.g. using the pin_* accessors below.
+ *       at runtime, use PIN_MAP
+ */
+constexpr pin_info_t PIN_MAP_CONSTEXPR[BOARD_NR_GPIO_PINS] = {
+	VARIANT_PIN_MAP(PINMAP_INFO)
+};
+
+/**
+ * @brief compile-time lookup of the port of a pin
+ */
+template <gpio_pin_t pin>
+constexpr en_port_t pin_port()
+{
+	static_assert(IS_GPIO_PIN(pin), "invalid gpio pin");
+	return PIN_MAP_CONSTEXPR[pin].port;
+}
+
+/**
+ * @brief compile-time lookup of the bit position of a pin in its port
+ */
+template <gpio_pin_t pin>
+constexpr uint8_t pin_bit_pos()
+{
+	static_assert(IS_GPIO_PIN(pin), "invalid gpio pin");
+	return PIN_MAP_CONSTEXPR[pin].bit_pos;
+}
+
+/**
+ * @brief compile-time lookup of the bit mask of a pin in its port
+ */
+template <gpio_pin_t pin>
+constexpr uint16_t pin_bit_mask()
+{
+	static_assert(IS_GPIO_PIN(pin), "invalid gpio pin");
+	return PIN_MAP_CONSTEXPR[pin].bit_mask;
+}
+
+/**
+ * @brief compile-time lookup of the adc configuration of a pin
+ */
+template <gpio_pin_t pin>
+constexpr pin_adc_info_t pin_adc_info()
+{
+	static_assert(IS_GPIO_PIN(pin), "invalid gpio pin");
+	return PIN_MAP_CONSTEXPR[pin].adc_info;
+}
+
+/**
+ * @brief compile-time lookup of the TimerA configuration of a pin
+ */
+template <gpio_pin_t pin>
+constexpr pin_timera_info_t pin_timera_info()
+{
+	static_assert(IS_GPIO_PIN(pin), "invalid gpio pin");
+	return PIN_MAP_CONSTEXPR[pin].timera_info;
+}
+} // extern "C++"
 #endif
 
 #endif /* WVARIANT_H_ */
@@ -20,105 +20,43 @@
   Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
-#include <stdio.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include <string.h>
+#include "../ftoa.h"
 
 char *dtostrf(double val, signed char width, unsigned char prec, char *sout)
 {
-  // Commented code is the original version
-  /*char fmt[20];
-  sprintf(fmt, "%%%d.%df", width, prec);
-  sprintf(sout, fmt, val);
-  return sout;*/
+  // format in single precision, the FPU cannot do double
+  size_t len = ftoa_fixed((float)val, prec, sout);
 
-  // Handle negative numbers
-  uint8_t negative = 0;
-  if (val < 0.0)
+  // digits beyond FTOA_MAX_DIGITS are always zero, but not for nan, inf or ovf
+  if (prec > FTOA_MAX_DIGITS && memchr(sout, '.', len) != NULL)
   {
-    negative = 1;
-    val = -val;
+    memset(&sout[len], '0', prec - FTOA_MAX_DIGITS);
+    len += prec - FTOA_MAX_DIGITS;
+    sout[len] = '\0';
   }
 
-  // Round correctly so that print(1.999, 2) prints as "2.00"
-  double rounding = 0.5;
-  for (int i = 0; i < prec; ++i)
-  {
-    rounding /= 10.0;
-  }
-
-  val += rounding;
-
-  // Extract the integer part of the number
-  unsigned long int_part = (unsigned long)val;
-  double remainder = val - (double)int_part;
-
-  if (prec > 0)
-  {
-    // Extract digits from the remainder
-    unsigned long dec_part = 0;
-    double decade = 1.0;
-    for (int i = 0; i < prec; i++)
-    {
-      decade *= 10.0;
-    }
-    remainder *= decade;
-    dec_part = (int)remainder;
-
-    if (negative)
-    {
-      sprintf(sout, "-%ld.%0*ld", int_part, prec, dec_part);
-    }
-    else
-    {
-      sprintf(sout, "%ld.%0*ld", int_part, prec, dec_part);
-    }
-  }
-  else
-  {
-    if (negative)
-    {
-      sprintf(sout, "-%ld", int_part);
-    }
-    else
-    {
-      sprintf(sout, "%ld", int_part);
-    }
-  }
   // Handle minimum field width of the output string
   // width is signed value, negative for left adjustment.
   // Range -128,127
-  char fmt[129] = "";
-  unsigned int w = width;
-  if (width < 0)
-  {
-    negative = 1;
-    w = -width;
-  }
-  else
-  {
-    negative = 0;
-  }
-
-  if (strlen(sout) < w)
+  const size_t w = (width < 0) ? (size_t)(-width) : (size_t)width;
+  if (len < w)
   {
-    memset(fmt, ' ', 128);
-    fmt[w - strlen(sout)] = '\0';
-    if (negative == 0)
+    const size_t pad = w - len;
+    if (width > 0)
     {
-      char *tmp = malloc(strlen(sout) + 1);
-      strcpy(tmp, sout);
-      strcpy(sout, fmt);
-      strcat(sout, tmp);
-      free(tmp);
+      // right adjustment, move the number behind the padding
+      memmove(&sout[pad], sout, len + 1);
+      memset(sout, ' ', pad);
     }
     else
     {
       // left adjustment
-      strcat(sout, fmt);
+      memset(&sout[len], ' ', pad);
+      sout[w] = '\0';
     }
   }
 
   return sout;
-}
\ No newline at end of file
+}
@@ -0,0 +1,86 @@
+/**
+ * pool allocator behind operator new:
+ *
+ * with CORE_POOL_ALLOCATOR defined, operator new / delete serve small allocations from static pools of fixed-size
+ * blocks (16, 32, 64 and 128 bytes) before falling back to the heap (malloc).
+ * each pool keeps a free list, so allocating and freeing a block is O(1), and pools never fragment.
+ * if a pool is exhausted, the next larger one is tried, then the heap.
+ *
+ * the number of blocks of each pool is set with CORE_POOL_COUNT_<size>. a count of 0 disables the pool.
+ * malloc() and free() themselves (e.g. used by String) are not affected.
+ *
+ * without CORE_POOL_ALLOCATOR, operator new forwards to malloc() as before, and none of this is compiled.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef CORE_POOL_ALLOCATOR
+
+#ifndef CORE_POOL_COUNT_16
+#define CORE_POOL_COUNT_16 32
+#endif
+
+#ifndef CORE_POOL_COUNT_32
+#define CORE_POOL_COUNT_32 16
+#endif
+
+#ifndef CORE_POOL_COUNT_64
+#define CORE_POOL_COUNT_64 8
+#endif
+
+#ifndef CORE_POOL_COUNT_128
+#define CORE_POOL_COUNT_128 4
+#endif
+
+/**
+ * @brief allocation statistics of operator new
+ */
+typedef struct core_alloc_stats_t
+{
+    /**
+     * @brief bytes currently allocated, from pools (in full blocks) and the heap
+     */
+    size_t bytes_in_use;
+
+    /**
+     * @brief maximum of bytes_in_use since boot
+     */
+    size_t peak_bytes_in_use;
+
+    /**
+     * @brief number of allocations that failed, both in pools and the heap
+     */
+    uint32_t failed_allocations;
+
+    /**
+     * @brief number of allocations that did not fit any pool, and went to the heap
+     */
+    uint32_t heap_allocations;
+
+    /**
+     * @brief size of the largest free pool block, 0 if all pools are exhausted
+     */
+    size_t largest_free_block;
+
+    /**
+     * @brief bytes free in the heap arena, as reported by mallinfo()
+     * @note does not include memory the heap has not claimed yet
+     */
+    size_t heap_free_bytes;
+} core_alloc_stats_t;
+
+/**
+ * @brief get the allocation statistics of operator new
+ * @param stats receives the statistics
+ */
+void core_alloc_get_stats(core_alloc_stats_t &stats);
+
+/**
+ * @brief get the number of free blocks in the pool of a block size
+ * @param block_size the block size of the pool (16, 32, 64 or 128)
+ * @return number of free blocks, 0 if there is no pool of that size
+ */
+size_t core_alloc_get_free_blocks(const size_t block_size);
+
+#endif // CORE_POOL_ALLOCATOR
@@ -10,6 +10,10 @@
 #ifdef __CORE_DEBUG_OMIT_PANIC_MESSAGE
 #warning "'__CORE_DEBUG_OMIT_PANIC_MESSAGE' is defined, panic message is omitted"
 #endif
+
+#ifdef CORE_DEBUG_TOKENIZED
+#warning "'CORE_DEBUG_TOKENIZED' is defined, debug output is tokenized. decode it using tools/trace/detokenize.py"
+#endif
 #endif
 
 #if !defined(__CORE_DEBUG) && PANIC_PRINT_ENABLED
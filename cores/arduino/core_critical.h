@@ -0,0 +1,99 @@
+/**
+ * nestable critical sections:
+ *
+ * unlike noInterrupts(), a critical section only masks interrupts with a priority value of
+ * CORE_CRITICAL_SECTION_PRIORITY or higher (= less urgent) using BASEPRI.
+ * interrupts with a lower priority value still preempt the critical section, so they are not delayed by it.
+ *
+ * the priorities of the core interrupts are set in irq_priority.h: the stepper timer (IRQ_PRIORITY_STEPPER) at 2,
+ * USART, SPI and Wire at 3, and all others at DDL_IRQ_PRIORITY_DEFAULT. with the default
+ * CORE_CRITICAL_SECTION_PRIORITY of 1, all of them are masked, including the stepper. only interrupts at priority 0
+ * preempt a critical section. to keep the stepper running through critical sections, raise
+ * CORE_CRITICAL_SECTION_PRIORITY above IRQ_PRIORITY_STEPPER.
+ * an interrupt that is not masked must not access anything the critical section protects.
+ *
+ * critical sections nest, as entering one only ever raises the masking level, and exiting it restores the previous level.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <hc32_ddl.h>
+
+/**
+ * @brief lowest priority value that is not masked by critical sections
+ * @note interrupts with a priority value lower than this are never masked. must be > 0
+ */
+#ifndef CORE_CRITICAL_SECTION_PRIORITY
+#define CORE_CRITICAL_SECTION_PRIORITY DDL_IRQ_PRIORITY_01
+#endif
+
+#if (CORE_CRITICAL_SECTION_PRIORITY <= 0) || (CORE_CRITICAL_SECTION_PRIORITY >= (1 << __NVIC_PRIO_BITS))
+#error "CORE_CRITICAL_SECTION_PRIORITY must be between 1 and 15"
+#endif
+
+/**
+ * @brief BASEPRI value of critical sections
+ */
+#define CORE_CRITICAL_SECTION_BASEPRI ((CORE_CRITICAL_SECTION_PRIORITY) << (8 - __NVIC_PRIO_BITS))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief enter a critical section
+     * @return previous masking state, to pass to core_critical_exit()
+     */
+    static inline uint32_t core_critical_enter(void)
+    {
+        const uint32_t state = __get_BASEPRI();
+
+        // only raises the masking level, so nested sections are never weakened
+        __set_BASEPRI_MAX(CORE_CRITICAL_SECTION_BASEPRI);
+        __ISB();
+        return state;
+    }
+
+    /**
+     * @brief exit a critical section
+     * @param state masking state returned by core_critical_enter()
+     */
+    static inline void core_critical_exit(const uint32_t state)
+    {
+        __set_BASEPRI(state);
+    }
+
+    /**
+     * @brief check if the caller is inside a critical section, or interrupts are disabled altogether
+     */
+    static inline bool core_critical_is_active(void)
+    {
+        const uint32_t basepri = __get_BASEPRI();
+        return __get_PRIMASK() != 0 || (basepri != 0 && basepri <= CORE_CRITICAL_SECTION_BASEPRI);
+    }
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief critical section for the lifetime of the object
+ * @example
+ * {
+ *   CoreCriticalSection cs;
+ *   // ... access shared data ...
+ * }
+ */
+class CoreCriticalSection
+{
+public:
+    CoreCriticalSection() : state(core_critical_enter()) {}
+    ~CoreCriticalSection() { core_critical_exit(state); }
+
+    CoreCriticalSection(const CoreCriticalSection &) = delete;
+    CoreCriticalSection &operator=(const CoreCriticalSection &) = delete;
+
+private:
+    const uint32_t state;
+};
+#endif
@@ -0,0 +1,33 @@
+#include "core_debug.h"
+
+#if defined(__CORE_DEBUG) && defined(CORE_DEBUG_PRINT_TARGET)
+#include "Arduino.h"
+#include <stdarg.h>
+
+size_t core_debug_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const size_t n = CORE_DEBUG_PRINT_TARGET.vprintf(format, args);
+    va_end(args);
+    return n;
+}
+#endif
+
+#if defined(__CORE_DEBUG) && defined(CORE_DEBUG_TOKENIZED)
+#include "core_debug_tokens.h"
+#ifdef CORE_DEBUG_PRINT_TARGET
+#include "Arduino.h"
+#endif
+
+void core_debug_token_send(const core_debug_token_frame_t &frame)
+{
+#ifdef CORE_DEBUG_PRINT_TARGET
+    CORE_DEBUG_PRINT_TARGET.write(frame.data, frame.length);
+#else
+    // binary frames have no newline, so flush them right away
+    fwrite(frame.data, 1, frame.length, stdout);
+    fflush(stdout);
+#endif
+}
+#endif
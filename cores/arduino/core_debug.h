@@ -14,8 +14,23 @@
 #endif
 
 #ifndef CORE_DEBUG_PRINTF
+#if defined(CORE_DEBUG_TOKENIZED) && defined(__cplusplus)
+// send format string tokens and raw arguments, formatted on the host. see core_debug_tokens.h
+#include "core_debug_tokens.h"
+#define CORE_DEBUG_PRINTF(fmt, ...) CORE_DEBUG_TOKEN_PRINTF(fmt, ##__VA_ARGS__)
+#elif defined(CORE_DEBUG_PRINT_TARGET)
+// print through Print::printf() of CORE_DEBUG_PRINT_TARGET (e.g. Serial), without newlib stdio
+#define CORE_DEBUG_PRINTF(fmt, ...) core_debug_printf(fmt, ##__VA_ARGS__)
+
+#ifdef __cplusplus
+extern "C" size_t core_debug_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#else
+size_t core_debug_printf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+#endif
+#else
 #define CORE_DEBUG_PRINTF(fmt, ...) printf(fmt, ##__VA_ARGS__)
 #endif
+#endif
 
 #ifndef CORE_ASSERT
 #define CORE_ASSERT(expression, message, ...) \
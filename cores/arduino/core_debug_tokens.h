@@ -0,0 +1,212 @@
+/**
+ * tokenized debug output:
+ *
+ * with board_build.debug_tokens = true, CORE_DEBUG_PRINTF() no longer formats on the target. the format string is
+ * placed in the .core_debug_tokens section, which is kept in the ELF file but not loaded into flash, and replaced by
+ * its address in that section (the token). only the token and the raw arguments are sent, as a binary frame:
+ *
+ *   CORE_DEBUG_TOKEN_SYNC | token (4 bytes) | payload length (1 byte) | arguments
+ *
+ * integers and pointers are sent as 4 bytes (8 for 64-bit types), floating point values as 8-byte doubles, and
+ * strings as their characters followed by a NUL, truncated to CORE_DEBUG_TOKEN_MAX_STRING characters.
+ * all values are little-endian. arguments not fitting the frame are dropped, and bit 7 of the length is set.
+ *
+ * tools/trace/detokenize.py reads the format strings from the ELF file and formats the messages on the host.
+ * output that is not a frame (e.g. panic messages) is passed through unchanged.
+ *
+ * only C++ callers are tokenized. CORE_DEBUG_PRINTF() in C files still formats on the target.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+#ifndef CORE_DEBUG_TOKEN_FRAME_SIZE
+/**
+ * @brief maximum size of a tokenized frame, including the header
+ */
+#define CORE_DEBUG_TOKEN_FRAME_SIZE 64
+#endif
+
+#ifndef CORE_DEBUG_TOKEN_MAX_STRING
+/**
+ * @brief maximum number of characters sent for a string argument
+ */
+#define CORE_DEBUG_TOKEN_MAX_STRING 32
+#endif
+
+#if (CORE_DEBUG_TOKEN_FRAME_SIZE < 8) || (CORE_DEBUG_TOKEN_FRAME_SIZE > 133)
+#error "CORE_DEBUG_TOKEN_FRAME_SIZE must be between 8 and 133"
+#endif
+
+/**
+ * @brief first byte of every tokenized frame
+ */
+#define CORE_DEBUG_TOKEN_SYNC 0xC5u
+
+/**
+ * @brief size of the frame header: sync, token and payload length
+ */
+#define CORE_DEBUG_TOKEN_HEADER_SIZE 6
+
+/**
+ * @brief set in the payload length if arguments were dropped
+ */
+#define CORE_DEBUG_TOKEN_TRUNCATED 0x80u
+
+/**
+ * @brief place a format string in the token section
+ */
+#define CORE_DEBUG_TOKEN_SECTION __attribute__((section(".core_debug_tokens"), used))
+
+/**
+ * @brief a tokenized frame being built
+ */
+struct core_debug_token_frame_t
+{
+    uint8_t data[CORE_DEBUG_TOKEN_FRAME_SIZE];
+    size_t length;
+
+    core_debug_token_frame_t(const char *token)
+    {
+        const uint32_t address = uint32_t(token);
+        data[0] = CORE_DEBUG_TOKEN_SYNC;
+        memcpy(&data[1], &address, sizeof(address));
+        data[5] = 0;
+        length = CORE_DEBUG_TOKEN_HEADER_SIZE;
+    }
+
+    /**
+     * @brief check that a value fits the payload
+     * @return false if it does not fit. the frame is marked truncated then, and all further values are dropped
+     */
+    bool fits(const size_t size)
+    {
+        if ((data[5] & CORE_DEBUG_TOKEN_TRUNCATED) != 0 || (length + size) > CORE_DEBUG_TOKEN_FRAME_SIZE)
+        {
+            data[5] |= CORE_DEBUG_TOKEN_TRUNCATED;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief append a value to the payload, if it fits
+     */
+    void put(const void *value, const size_t size)
+    {
+        if (fits(size))
+        {
+            memcpy(&data[length], value, size);
+            length += size;
+            data[5] = uint8_t(length - CORE_DEBUG_TOKEN_HEADER_SIZE);
+        }
+    }
+};
+
+/**
+ * @brief send a tokenized frame to the debug output
+ */
+void core_debug_token_send(const core_debug_token_frame_t &frame);
+
+/**
+ * @brief declaration only, to let the compiler check the arguments against the format string
+ */
+int core_debug_token_check_format(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+//
+// argument encoding
+//
+
+// integers and enums
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+core_debug_token_put(core_debug_token_frame_t &frame, const T value)
+{
+    if (sizeof(T) > sizeof(uint32_t))
+    {
+        const uint64_t v = uint64_t(value);
+        frame.put(&v, sizeof(v));
+    }
+    else
+    {
+        const uint32_t v = uint32_t(value);
+        frame.put(&v, sizeof(v));
+    }
+}
+
+// floating point, promoted to double like a printf() argument
+template <typename T>
+inline typename std::enable_if<std::is_floating_point<T>::value>::type
+core_debug_token_put(core_debug_token_frame_t &frame, const T value)
+{
+    const double v = double(value);
+    frame.put(&v, sizeof(v));
+}
+
+// pointers other than strings, sent as their address
+template <typename T>
+inline typename std::enable_if<std::is_pointer<T>::value &&
+                               !std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value>::type
+core_debug_token_put(core_debug_token_frame_t &frame, const T value)
+{
+    const uint32_t v = uint32_t(value);
+    frame.put(&v, sizeof(v));
+}
+
+// strings, sent by value
+inline void core_debug_token_put(core_debug_token_frame_t &frame, const char *value)
+{
+    if (value == nullptr)
+    {
+        value = "(null)";
+    }
+
+    // the terminator is sent with the string, so a string is never cut
+    const size_t length = strnlen(value, CORE_DEBUG_TOKEN_MAX_STRING);
+    if (frame.fits(length + 1))
+    {
+        const char terminator = '\0';
+        frame.put(value, length);
+        frame.put(&terminator, 1);
+    }
+}
+
+inline void core_debug_token_put_all(core_debug_token_frame_t &frame)
+{
+    (void)frame;
+}
+
+template <typename T, typename... Args>
+inline void core_debug_token_put_all(core_debug_token_frame_t &frame, const T &first, const Args &...rest)
+{
+    core_debug_token_put(frame, first);
+    core_debug_token_put_all(frame, rest...);
+}
+
+/**
+ * @brief encode and send a tokenized message
+ * @param token the format string, in the token section. only its address is used
+ * @param args the printf arguments
+ */
+template <typename... Args>
+inline void core_debug_token_printf(const char *token, const Args &...args)
+{
+    core_debug_token_frame_t frame(token);
+    core_debug_token_put_all(frame, args...);
+    core_debug_token_send(frame);
+}
+
+/**
+ * @brief tokenized CORE_DEBUG_PRINTF()
+ * @note fmt must be a string literal
+ */
+#define CORE_DEBUG_TOKEN_PRINTF(fmt, ...)                                          \
+    do                                                                             \
+    {                                                                              \
+        (void)sizeof(core_debug_token_check_format(fmt, ##__VA_ARGS__));           \
+        static const char core_debug_token[] CORE_DEBUG_TOKEN_SECTION = fmt;       \
+        core_debug_token_printf(core_debug_token, ##__VA_ARGS__);                  \
+    } while (0)
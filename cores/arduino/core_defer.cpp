@@ -0,0 +1,120 @@
+#include "core_defer.h"
+#include "core_idle.h"
+#include <hc32_ddl.h>
+
+#define QUEUE_MASK (CORE_DEFER_QUEUE_SIZE - 1)
+
+/**
+ * @brief slot of the deferred call queue
+ */
+typedef struct defer_slot_t
+{
+    /**
+     * @brief sequence number of the slot, relative to the first position of the current round
+     * @note lap (position & ~QUEUE_MASK) if the slot is free for position, and lap + 1 once the call is posted.
+     *       thus, the zero-initialized queue is empty
+     */
+    uint32_t sequence;
+
+    core_defer_function_t function;
+    void *arg;
+} defer_slot_t;
+
+static defer_slot_t slots[CORE_DEFER_QUEUE_SIZE];
+
+/**
+ * @brief get the first position of the round a position is in
+ */
+static inline uint32_t lap(const uint32_t position)
+{
+    return position & ~uint32_t(QUEUE_MASK);
+}
+
+// next position written by core_defer(), and read by core_defer_run()
+static uint32_t write_position = 0;
+static uint32_t read_position = 0;
+
+static uint32_t dropped = 0;
+static bool running = false;
+
+bool core_defer(core_defer_function_t function, void *arg)
+{
+    if (function == nullptr)
+    {
+        return false;
+    }
+
+    // claim a slot. the compare-exchange only fails if another post interrupted this one
+    uint32_t position = __atomic_load_n(&write_position, __ATOMIC_RELAXED);
+    defer_slot_t *slot;
+    while (true)
+    {
+        slot = &slots[position & QUEUE_MASK];
+        const int32_t diff = int32_t(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - lap(position));
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&write_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            // slot still holds a call of the last round that was not run yet
+            __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        else
+        {
+            position = __atomic_load_n(&write_position, __ATOMIC_RELAXED);
+        }
+    }
+
+    // fill the slot, then publish it
+    slot->function = function;
+    slot->arg = arg;
+    __atomic_store_n(&slot->sequence, lap(position) + 1, __ATOMIC_RELEASE);
+
+    core_idle_notify();
+    return true;
+}
+
+size_t core_defer_run(void)
+{
+    if (running || __get_IPSR() != 0)
+    {
+        return 0;
+    }
+    running = true;
+
+    // only the calls posted before this point, so re-posting calls cannot block
+    const uint32_t end = __atomic_load_n(&write_position, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+    while (read_position != end)
+    {
+        defer_slot_t *slot = &slots[read_position & QUEUE_MASK];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != lap(read_position) + 1)
+        {
+            // empty, or the next call is still being posted
+            break;
+        }
+
+        const core_defer_function_t function = slot->function;
+        void *const arg = slot->arg;
+
+        // free the slot for the next round
+        __atomic_store_n(&slot->sequence, lap(read_position) + CORE_DEFER_QUEUE_SIZE, __ATOMIC_RELEASE);
+        read_position++;
+
+        function(arg);
+        count++;
+    }
+
+    running = false;
+    return count;
+}
+
+uint32_t core_defer_get_dropped(void)
+{
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
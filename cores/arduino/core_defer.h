@@ -0,0 +1,69 @@
+/**
+ * deferred calls (interrupt bottom halves):
+ *
+ * interrupt handlers post a {function, arg} call with core_defer(), in constant time and without locking.
+ * the calls are run in thread mode, in order, from yield() and the main loop. heavy work thus leaves the interrupt
+ * handlers, and no flag has to be polled.
+ *
+ * the queue is a bounded lock-free ring with a sequence number per slot. any number of interrupt handlers (of any
+ * priority) and thread mode may post concurrently, while only thread mode runs the calls.
+ * a post only retries if it was interrupted by another post, so it completes after at most one retry per
+ * nested interrupt priority.
+ *
+ * posting wakes the main loop from idle sleep. if the queue is full, the call is dropped and counted.
+ * if nothing is ever posted, the queue is not linked at all.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef CORE_DEFER_QUEUE_SIZE
+/**
+ * @brief number of calls the queue holds
+ * @note must be a power of two
+ */
+#define CORE_DEFER_QUEUE_SIZE 32
+#endif
+
+#if (CORE_DEFER_QUEUE_SIZE < 2) || ((CORE_DEFER_QUEUE_SIZE & (CORE_DEFER_QUEUE_SIZE - 1)) != 0)
+#error "CORE_DEFER_QUEUE_SIZE must be a power of two"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief deferred function
+     * @param arg the argument given to core_defer()
+     */
+    typedef void (*core_defer_function_t)(void *arg);
+
+    /**
+     * @brief post a call to be run in thread mode
+     * @param function the function to call
+     * @param arg argument of the function
+     * @return true if the call was queued, false if the queue is full
+     * @note may be called from any interrupt handler, and from thread mode
+     */
+    bool core_defer(core_defer_function_t function, void *arg);
+
+    /**
+     * @brief run the queued calls
+     * @return number of calls run
+     * @note called by yield() and the main loop. calls posted while running are run on the next call,
+     *       so a function re-posting itself cannot block the caller
+     * @note does nothing if called recursively from a deferred function, or from an interrupt handler
+     */
+    size_t core_defer_run(void);
+
+    /**
+     * @brief get the number of calls dropped because the queue was full
+     */
+    uint32_t core_defer_get_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,448 @@
+#include "core_dsp.h"
+#include "core_debug.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include <hc32_ddl.h> // CMSIS intrinsics
+#define DSP_SIMD 1
+#else
+#define DSP_SIMD 0
+#endif
+
+//
+// packed 16-bit lanes. the portable versions keep this file usable for host builds
+//
+
+/**
+ * @brief load two 16-bit samples, the first one in the low half
+ */
+static inline uint32_t load_pair(const void *samples)
+{
+    uint32_t pair;
+    memcpy(&pair, samples, sizeof(pair));
+    return pair;
+}
+
+static inline void store_pair(void *samples, const uint32_t pair)
+{
+    memcpy(samples, &pair, sizeof(pair));
+}
+
+static inline int16_t lane(const uint32_t pair, const int n)
+{
+    return int16_t(pair >> (16 * n));
+}
+
+/**
+ * @brief acc + a.lo * b.lo + a.hi * b.hi, signed, 64-bit accumulator
+ */
+static inline int64_t smlald(const uint32_t a, const uint32_t b, const int64_t acc)
+{
+#if DSP_SIMD
+    return int64_t(__SMLALD(a, b, uint64_t(acc)));
+#else
+    return acc + int32_t(lane(a, 0)) * lane(b, 0) + int32_t(lane(a, 1)) * lane(b, 1);
+#endif
+}
+
+static inline int16_t saturate_q15(const int32_t value)
+{
+#if DSP_SIMD
+    return int16_t(__SSAT(value, 16));
+#else
+    return int16_t(value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value));
+#endif
+}
+
+static inline int16_t saturate_q15_64(const int64_t value)
+{
+    return int16_t(value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value));
+}
+
+/**
+ * @brief saturating add of both lanes
+ */
+static inline uint32_t qadd16(const uint32_t a, const uint32_t b)
+{
+#if DSP_SIMD
+    return __QADD16(a, b);
+#else
+    const uint16_t lo = uint16_t(saturate_q15(int32_t(lane(a, 0)) + lane(b, 0)));
+    const uint16_t hi = uint16_t(saturate_q15(int32_t(lane(a, 1)) + lane(b, 1)));
+    return (uint32_t(hi) << 16) | lo;
+#endif
+}
+
+/**
+ * @brief unsigned minimum / maximum of both lanes
+ */
+static inline uint32_t min_u16x2(const uint32_t a, const uint32_t b)
+{
+#if DSP_SIMD
+    __USUB16(a, b); // sets the GE flags of the lanes where a >= b
+    return __SEL(b, a);
+#else
+    const uint16_t lo = uint16_t(a) < uint16_t(b) ? uint16_t(a) : uint16_t(b);
+    const uint16_t hi = uint16_t(a >> 16) < uint16_t(b >> 16) ? uint16_t(a >> 16) : uint16_t(b >> 16);
+    return (uint32_t(hi) << 16) | lo;
+#endif
+}
+
+static inline uint32_t max_u16x2(const uint32_t a, const uint32_t b)
+{
+#if DSP_SIMD
+    __USUB16(a, b);
+    return __SEL(a, b);
+#else
+    const uint16_t lo = uint16_t(a) > uint16_t(b) ? uint16_t(a) : uint16_t(b);
+    const uint16_t hi = uint16_t(a >> 16) > uint16_t(b >> 16) ? uint16_t(a >> 16) : uint16_t(b >> 16);
+    return (uint32_t(hi) << 16) | lo;
+#endif
+}
+
+//
+// FIR
+//
+
+void dsp_fir_q15_init(dsp_fir_q15_t &fir, const int16_t *coeffs, const uint16_t taps, int16_t *state, const uint16_t block_size)
+{
+    CORE_ASSERT(coeffs != NULL && state != NULL && taps > 0, "dsp_fir_q15_init: invalid arguments", return);
+    fir.coeffs = coeffs;
+    fir.state = state;
+    fir.taps = taps;
+    fir.block_size = block_size;
+    memset(state, 0, (taps + block_size - 1) * sizeof(int16_t));
+}
+
+void dsp_fir_q15(dsp_fir_q15_t &fir, const int16_t *in, int16_t *out, const size_t count)
+{
+    CORE_ASSERT(count <= fir.block_size, "dsp_fir_q15: count > block_size", return);
+
+    // the state holds the last taps - 1 samples, followed by the new block. oldest sample first
+    const uint16_t taps = fir.taps;
+    int16_t *state = fir.state;
+    memcpy(state + taps - 1, in, count * sizeof(int16_t));
+
+    const int16_t *coeffs = fir.coeffs;
+    for (size_t n = 0; n < count; n++)
+    {
+        const int16_t *x = state + n;
+        int64_t acc = 0;
+        uint16_t k = 0;
+        for (; k + 4 <= taps; k += 4)
+        {
+            acc = smlald(load_pair(x + k), load_pair(coeffs + k), acc);
+            acc = smlald(load_pair(x + k + 2), load_pair(coeffs + k + 2), acc);
+        }
+        for (; k + 2 <= taps; k += 2)
+        {
+            acc = smlald(load_pair(x + k), load_pair(coeffs + k), acc);
+        }
+        if (k < taps)
+        {
+            acc += int32_t(x[k]) * coeffs[k];
+        }
+
+        out[n] = saturate_q15_64(acc >> 15);
+    }
+
+    memmove(state, state + count, (taps - 1) * sizeof(int16_t));
+}
+
+//
+// biquads
+//
+
+void dsp_biquad_q15_init(dsp_biquad_q15_t &biquad, const int16_t *coeffs, const uint8_t stages, int16_t *state, const uint8_t post_shift)
+{
+    CORE_ASSERT(coeffs != NULL && state != NULL && post_shift < 15, "dsp_biquad_q15_init: invalid arguments", return);
+    biquad.coeffs = coeffs;
+    biquad.state = state;
+    biquad.stages = stages;
+    biquad.post_shift = post_shift;
+    memset(state, 0, stages * 4 * sizeof(int16_t));
+}
+
+void dsp_biquad_q15(dsp_biquad_q15_t &biquad, const int16_t *in, int16_t *out, const size_t count)
+{
+    const int16_t *source = in;
+    const int shift = 15 - biquad.post_shift;
+    for (uint8_t stage = 0; stage < biquad.stages; stage++)
+    {
+        const int16_t *c = biquad.coeffs + (stage * 6);
+        int16_t *s = biquad.state + (stage * 4);
+
+        // coefficient and state pairs: (b1, b2) with (x[n-1], x[n-2]), (a1, a2) with (y[n-1], y[n-2])
+        const int32_t b0 = c[0];
+        const uint32_t b12 = load_pair(c + 2);
+        const uint32_t a12 = load_pair(c + 4);
+        uint32_t x12 = load_pair(s);
+        uint32_t y12 = load_pair(s + 2);
+
+        for (size_t n = 0; n < count; n++)
+        {
+            const int16_t x = source[n];
+            int64_t acc = int32_t(x) * b0;
+            acc = smlald(b12, x12, acc);
+            acc = smlald(a12, y12, acc);
+
+            const int16_t y = saturate_q15_64(acc >> shift);
+            x12 = (x12 << 16) | uint16_t(x);
+            y12 = (y12 << 16) | uint16_t(y);
+            out[n] = y;
+        }
+
+        store_pair(s, x12);
+        store_pair(s + 2, y12);
+        source = out;
+    }
+
+    if (biquad.stages == 0 && out != in)
+    {
+        memcpy(out, in, count * sizeof(int16_t));
+    }
+}
+
+void dsp_biquad_f32_init(dsp_biquad_f32_t &biquad, const float *coeffs, const uint8_t stages, float *state)
+{
+    CORE_ASSERT(coeffs != NULL && state != NULL, "dsp_biquad_f32_init: invalid arguments", return);
+    biquad.coeffs = coeffs;
+    biquad.state = state;
+    biquad.stages = stages;
+    memset(state, 0, stages * 2 * sizeof(float));
+}
+
+void dsp_biquad_f32(dsp_biquad_f32_t &biquad, const float *in, float *out, const size_t count)
+{
+    const float *source = in;
+    for (uint8_t stage = 0; stage < biquad.stages; stage++)
+    {
+        const float *c = biquad.coeffs + (stage * 5);
+        const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        float d1 = biquad.state[stage * 2];
+        float d2 = biquad.state[stage * 2 + 1];
+
+        for (size_t n = 0; n < count; n++)
+        {
+            const float x = source[n];
+            const float y = b0 * x + d1;
+            d1 = b1 * x + a1 * y + d2;
+            d2 = b2 * x + a2 * y;
+            out[n] = y;
+        }
+
+        biquad.state[stage * 2] = d1;
+        biquad.state[stage * 2 + 1] = d2;
+        source = out;
+    }
+
+    if (biquad.stages == 0 && out != in)
+    {
+        memcpy(out, in, count * sizeof(float));
+    }
+}
+
+void dsp_biquad_lowpass_f32(float *coeffs, const float sample_rate, const float cutoff, const float q)
+{
+    // RBJ audio EQ cookbook low-pass, normalized to a0 = 1, feedback negated
+    const float w0 = 2.0f * float(M_PI) * cutoff / sample_rate;
+    const float cos_w0 = cosf(w0);
+    const float alpha = sinf(w0) / (2.0f * q);
+    const float a0 = 1.0f + alpha;
+
+    coeffs[0] = ((1.0f - cos_w0) / 2.0f) / a0;
+    coeffs[1] = (1.0f - cos_w0) / a0;
+    coeffs[2] = coeffs[0];
+    coeffs[3] = (2.0f * cos_w0) / a0;
+    coeffs[4] = -(1.0f - alpha) / a0;
+}
+
+//
+// moving average
+//
+
+void dsp_moving_average_init(dsp_moving_average_t &average, uint16_t *window, const uint16_t length)
+{
+    CORE_ASSERT(window != NULL && length > 0, "dsp_moving_average_init: invalid arguments", return);
+    average.window = window;
+    average.length = length;
+    average.index = 0;
+    average.sum = 0;
+    memset(window, 0, length * sizeof(uint16_t));
+}
+
+uint16_t dsp_moving_average_update(dsp_moving_average_t &average, const uint16_t sample)
+{
+    average.sum += sample;
+    average.sum -= average.window[average.index];
+    average.window[average.index] = sample;
+    if (++average.index == average.length)
+    {
+        average.index = 0;
+    }
+
+    return uint16_t(average.sum / average.length);
+}
+
+uint16_t dsp_moving_average_block(dsp_moving_average_t &average, const uint16_t *in, uint16_t *out, const size_t count)
+{
+    // without per-sample output, only the final sum matters, so the window is updated without dividing
+    if (out == NULL)
+    {
+        for (size_t n = 0; n < count; n++)
+        {
+            average.sum += in[n];
+            average.sum -= average.window[average.index];
+            average.window[average.index] = in[n];
+            if (++average.index == average.length)
+            {
+                average.index = 0;
+            }
+        }
+
+        return uint16_t(average.sum / average.length);
+    }
+
+    uint16_t result = uint16_t(average.sum / average.length);
+    for (size_t n = 0; n < count; n++)
+    {
+        result = dsp_moving_average_update(average, in[n]);
+        out[n] = result;
+    }
+    return result;
+}
+
+//
+// block operations
+//
+
+void dsp_add_q15(const int16_t *a, const int16_t *b, int16_t *out, const size_t count)
+{
+    size_t n = 0;
+    for (; n + 2 <= count; n += 2)
+    {
+        store_pair(out + n, qadd16(load_pair(a + n), load_pair(b + n)));
+    }
+    if (n < count)
+    {
+        out[n] = saturate_q15(int32_t(a[n]) + b[n]);
+    }
+}
+
+void dsp_min_max_u16(const uint16_t *in, const size_t count, uint16_t *min, uint16_t *max)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // both lanes track the extremes of every other sample, and are combined at the end
+    uint32_t lo = 0xFFFFFFFFul;
+    uint32_t hi = 0;
+    size_t n = 0;
+    for (; n + 2 <= count; n += 2)
+    {
+        const uint32_t pair = load_pair(in + n);
+        lo = min_u16x2(lo, pair);
+        hi = max_u16x2(hi, pair);
+    }
+    if (n < count)
+    {
+        const uint32_t pair = in[n] | (uint32_t(in[n]) << 16);
+        lo = min_u16x2(lo, pair);
+        hi = max_u16x2(hi, pair);
+    }
+
+    lo = min_u16x2(lo, (lo >> 16) | (lo << 16));
+    hi = max_u16x2(hi, (hi >> 16) | (hi << 16));
+    if (min != NULL)
+    {
+        *min = uint16_t(lo);
+    }
+    if (max != NULL)
+    {
+        *max = uint16_t(hi);
+    }
+}
+
+uint32_t dsp_sum_u16(const uint16_t *in, const size_t count)
+{
+    // unpack both lanes of a pair zero-extended (UXTAH and a shifted add), so samples >= 0x8000 are not
+    // sign-extended like they would be by a signed multiply-accumulate
+    uint32_t sum = 0;
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+    {
+        const uint32_t a = load_pair(in + n);
+        const uint32_t b = load_pair(in + n + 2);
+        sum += uint16_t(a) + (a >> 16);
+        sum += uint16_t(b) + (b >> 16);
+    }
+    for (; n < count; n++)
+    {
+        sum += in[n];
+    }
+
+    return sum;
+}
+
+uint16_t dsp_mean_u16(const uint16_t *in, const size_t count)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    return uint16_t((dsp_sum_u16(in, count) + (count / 2)) / count);
+}
+
+void dsp_min_max_f32(const float *in, const size_t count, float *min, float *max)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    float lo = in[0];
+    float hi = in[0];
+    for (size_t n = 1; n < count; n++)
+    {
+        lo = in[n] < lo ? in[n] : lo;
+        hi = in[n] > hi ? in[n] : hi;
+    }
+
+    if (min != NULL)
+    {
+        *min = lo;
+    }
+    if (max != NULL)
+    {
+        *max = hi;
+    }
+}
+
+float dsp_mean_f32(const float *in, const size_t count)
+{
+    if (count == 0)
+    {
+        return 0.0f;
+    }
+
+    // independent partial sums keep the FPU pipeline busy
+    float sums[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    size_t n = 0;
+    for (; n + 4 <= count; n += 4)
+    {
+        sums[0] += in[n];
+        sums[1] += in[n + 1];
+        sums[2] += in[n + 2];
+        sums[3] += in[n + 3];
+    }
+    for (; n < count; n++)
+    {
+        sums[0] += in[n];
+    }
+
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) / float(count);
+}
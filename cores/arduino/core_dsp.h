@@ -0,0 +1,220 @@
+/**
+ * signal processing kernels for sensor data:
+ *
+ * block filters and statistics for ADC samples and float arrays, using the DSP extension (SMLALD, QADD16, SEL, ...)
+ * and FPU of the Cortex-M4. two 16-bit samples are processed per instruction where possible, so filtering a
+ * buffer filled by the ADC in continuous mode costs a fraction of a scalar loop.
+ *
+ * the Q15 and float filters follow the conventions of CMSIS-DSP, so coefficients designed for it can be used as-is:
+ * - FIR coefficients are stored in time-reversed order, {b[N-1], ..., b[1], b[0]}
+ * - biquad feedback coefficients are negated: y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+ *
+ * buffers need no particular alignment.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Q15 FIR filter
+ */
+struct dsp_fir_q15_t
+{
+    /**
+     * @brief the coefficients, time-reversed
+     */
+    const int16_t *coeffs;
+
+    /**
+     * @brief the state, taps + block_size - 1 samples
+     */
+    int16_t *state;
+
+    uint16_t taps;
+    uint16_t block_size;
+};
+
+/**
+ * @brief cascade of Q15 biquads, direct form I
+ */
+struct dsp_biquad_q15_t
+{
+    /**
+     * @brief the coefficients, 6 per stage: {b0, 0, b1, b2, a1, a2}, scaled down by 2^post_shift
+     * @note the 0 pads the coefficients, so they are processed in pairs
+     */
+    const int16_t *coeffs;
+
+    /**
+     * @brief the state, 4 samples per stage. zero-initialized by dsp_biquad_q15_init()
+     */
+    int16_t *state;
+
+    uint8_t stages;
+
+    /**
+     * @brief shift applied to the result of each stage, so coefficients of magnitude up to 2^post_shift can be
+     *        represented. 1 for the usual coefficients of magnitude up to 2
+     */
+    uint8_t post_shift;
+};
+
+/**
+ * @brief cascade of float biquads, direct form II transposed
+ */
+struct dsp_biquad_f32_t
+{
+    /**
+     * @brief the coefficients, 5 per stage: {b0, b1, b2, a1, a2}
+     */
+    const float *coeffs;
+
+    /**
+     * @brief the state, 2 values per stage. zero-initialized by dsp_biquad_f32_init()
+     */
+    float *state;
+
+    uint8_t stages;
+};
+
+/**
+ * @brief moving average (boxcar) filter of unsigned samples
+ */
+struct dsp_moving_average_t
+{
+    /**
+     * @brief the last length samples
+     */
+    uint16_t *window;
+    uint16_t length;
+    uint16_t index;
+    uint32_t sum;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    //
+    // FIR / IIR filters
+    //
+
+    /**
+     * @brief initialize a Q15 FIR filter
+     * @param fir the filter
+     * @param coeffs the coefficients, time-reversed. must stay valid while the filter is used
+     * @param taps number of coefficients
+     * @param state the state buffer, taps + block_size - 1 samples
+     * @param block_size maximum number of samples per dsp_fir_q15() call
+     */
+    void dsp_fir_q15_init(dsp_fir_q15_t &fir, const int16_t *coeffs, const uint16_t taps, int16_t *state, const uint16_t block_size);
+
+    /**
+     * @brief filter a block of samples
+     * @param fir the filter
+     * @param in input samples
+     * @param out output samples. may be the same as in
+     * @param count number of samples, at most block_size
+     * @note products are accumulated in 64 bit, and the result is saturated to Q15
+     */
+    void dsp_fir_q15(dsp_fir_q15_t &fir, const int16_t *in, int16_t *out, const size_t count);
+
+    /**
+     * @brief initialize a cascade of Q15 biquads
+     * @param biquad the filter
+     * @param coeffs the coefficients, 6 per stage. must stay valid while the filter is used
+     * @param stages number of stages
+     * @param state the state buffer, 4 samples per stage
+     * @param post_shift see dsp_biquad_q15_t
+     */
+    void dsp_biquad_q15_init(dsp_biquad_q15_t &biquad, const int16_t *coeffs, const uint8_t stages, int16_t *state, const uint8_t post_shift);
+
+    /**
+     * @brief filter a block of samples
+     * @param out output samples. may be the same as in
+     */
+    void dsp_biquad_q15(dsp_biquad_q15_t &biquad, const int16_t *in, int16_t *out, const size_t count);
+
+    /**
+     * @brief initialize a cascade of float biquads
+     * @param coeffs the coefficients, 5 per stage. must stay valid while the filter is used
+     * @param state the state buffer, 2 values per stage
+     */
+    void dsp_biquad_f32_init(dsp_biquad_f32_t &biquad, const float *coeffs, const uint8_t stages, float *state);
+
+    /**
+     * @brief filter a block of samples
+     * @param out output samples. may be the same as in
+     */
+    void dsp_biquad_f32(dsp_biquad_f32_t &biquad, const float *in, float *out, const size_t count);
+
+    /**
+     * @brief calculate the coefficients of a second order low-pass biquad stage
+     * @param coeffs the 5 coefficients of the stage
+     * @param sample_rate the sample rate, in Hz
+     * @param cutoff the cutoff frequency, in Hz
+     * @param q the quality factor. 0.7071 for a Butterworth response
+     */
+    void dsp_biquad_lowpass_f32(float *coeffs, const float sample_rate, const float cutoff, const float q);
+
+    /**
+     * @brief initialize a moving average filter
+     * @param window the window buffer, length samples
+     * @param length the window length. the average is exact after length samples were added
+     */
+    void dsp_moving_average_init(dsp_moving_average_t &average, uint16_t *window, const uint16_t length);
+
+    /**
+     * @brief add a sample, and get the average of the window
+     */
+    uint16_t dsp_moving_average_update(dsp_moving_average_t &average, const uint16_t sample);
+
+    /**
+     * @brief add a block of samples
+     * @param out the average after each sample. may be the same as in, or NULL
+     * @return the average after the last sample
+     */
+    uint16_t dsp_moving_average_block(dsp_moving_average_t &average, const uint16_t *in, uint16_t *out, const size_t count);
+
+    //
+    // block operations
+    //
+
+    /**
+     * @brief add two blocks of Q15 samples, with saturation
+     * @param out the result. may be the same as a or b
+     */
+    void dsp_add_q15(const int16_t *a, const int16_t *b, int16_t *out, const size_t count);
+
+    /**
+     * @brief get the smallest and largest of a block of unsigned samples
+     * @param count number of samples. min and max are not changed if 0
+     */
+    void dsp_min_max_u16(const uint16_t *in, const size_t count, uint16_t *min, uint16_t *max);
+
+    /**
+     * @brief get the sum of a block of unsigned samples
+     * @note the sum wraps at 32 bits, so full-range samples are summed exactly for up to 65537 samples
+     */
+    uint32_t dsp_sum_u16(const uint16_t *in, const size_t count);
+
+    /**
+     * @brief get the mean of a block of unsigned samples
+     * @note 0 if count is 0
+     */
+    uint16_t dsp_mean_u16(const uint16_t *in, const size_t count);
+
+    /**
+     * @brief get the smallest and largest of a block of floats
+     */
+    void dsp_min_max_f32(const float *in, const size_t count, float *min, float *max);
+
+    /**
+     * @brief get the mean of a block of floats
+     */
+    float dsp_mean_f32(const float *in, const size_t count);
+
+#ifdef __cplusplus
+}
+#endif
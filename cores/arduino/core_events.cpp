@@ -0,0 +1,37 @@
+#include "core_events.h"
+#include "yield.h"
+#include "drivers/sysclock/systick.h"
+
+// soft-timer service, only linked if soft-timers are used
+__attribute__((weak)) void softtimer_run_deferred();
+
+volatile uint32_t core_events_pending = 0;
+
+uint32_t core_events_wait(const uint32_t mask, const uint32_t timeout)
+{
+    const uint32_t start = systick_millis();
+    for (;;)
+    {
+        const uint32_t fired = core_events_take(mask);
+        if (fired != 0)
+        {
+            return fired;
+        }
+
+        if (timeout != CORE_EVENTS_WAIT_FOREVER && (systick_millis() - start) >= timeout)
+        {
+            return 0;
+        }
+
+        // keep the services of the main loop running while loop() is blocked here
+        yield();
+        if (softtimer_run_deferred != nullptr)
+        {
+            softtimer_run_deferred();
+        }
+
+        // setting an event signals pending work, so this does not sleep if one was set since it was taken.
+        // otherwise, the next interrupt (at the latest SysTick) wakes the loop again
+        core_idle_sleep();
+    }
+}
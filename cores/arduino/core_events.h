@@ -0,0 +1,103 @@
+/**
+ * event flags:
+ *
+ * instead of polling every subsystem in each loop() iteration, the main loop blocks in waitEvents() until one of
+ * the events it waits for is set, then services only what fired.
+ *
+ * events are the 32 bits of a single word. the application decides which bit means what, and hands the bits to
+ * the sources that should set them:
+ * - USART RX:           Serial.setRxEvents(), set when data was received
+ * - ADC DMA completion: adc_set_conversion_events(), set when a conversion (scan) was completed
+ * - EXTI:               attachInterruptEvent(), set when the pin's interrupt triggers
+ * - soft-timers:        softtimer_start_events(), set when the timer expires
+ * interrupt handlers of the application may set their own bits with core_events_set().
+ *
+ * setting an event is a single atomic OR, and wakes the main loop from idle sleep. waiting sleeps (WFI) until any
+ * interrupt, so an event set from an interrupt handler is seen right after the handler returns. while waiting,
+ * yield() and the deferred soft-timer callbacks keep running.
+ *
+ *   #define EV_SERIAL (1ul << 0)
+ *   #define EV_ENDSTOP (1ul << 1)
+ *
+ *   void loop()
+ *   {
+ *       const uint32_t fired = waitEvents(EV_SERIAL | EV_ENDSTOP, 100);
+ *       if (fired & EV_SERIAL) { ... }
+ *       if (fired & EV_ENDSTOP) { ... }
+ *   }
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "core_idle.h"
+
+/**
+ * @brief timeout for core_events_wait() that never expires
+ */
+#define CORE_EVENTS_WAIT_FOREVER 0xFFFFFFFFul
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief the set events
+     * @note use core_events_set() and core_events_take()
+     */
+    extern volatile uint32_t core_events_pending;
+
+    /**
+     * @brief set events
+     * @param events the events to set. 0 does nothing
+     * @note may be called from any interrupt handler, and from thread mode
+     */
+    static inline void core_events_set(const uint32_t events)
+    {
+        if (events != 0)
+        {
+            __atomic_fetch_or(&core_events_pending, events, __ATOMIC_RELEASE);
+            core_idle_notify();
+        }
+    }
+
+    /**
+     * @brief get and clear set events
+     * @param mask the events to take
+     * @return the events of mask that were set
+     */
+    static inline uint32_t core_events_take(const uint32_t mask)
+    {
+        return __atomic_fetch_and(&core_events_pending, ~mask, __ATOMIC_ACQUIRE) & mask;
+    }
+
+    /**
+     * @brief get set events, without clearing them
+     */
+    static inline uint32_t core_events_peek(void)
+    {
+        return __atomic_load_n(&core_events_pending, __ATOMIC_ACQUIRE);
+    }
+
+    /**
+     * @brief wait until any of the given events is set, then take them
+     * @param mask the events to wait for
+     * @param timeout maximum time to wait, in milliseconds. CORE_EVENTS_WAIT_FOREVER to wait forever
+     * @return the events of mask that were set (and are now cleared), or 0 on timeout
+     * @note sleeps (WFI) between interrupts, and calls yield() and the deferred soft-timer callbacks while waiting.
+     *       must not be called from interrupt handlers
+     */
+    uint32_t core_events_wait(const uint32_t mask, const uint32_t timeout);
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief wait until any of the given events is set, then take them
+ * @see core_events_wait()
+ */
+inline uint32_t waitEvents(const uint32_t mask, const uint32_t timeout = CORE_EVENTS_WAIT_FOREVER)
+{
+    return core_events_wait(mask, timeout);
+}
+#endif
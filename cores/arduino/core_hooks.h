@@ -2,6 +2,7 @@
 #define __CORE_HOOKS_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -43,6 +44,28 @@ extern "C"
      */
     DEF_HOOK(usart_rx_irq, uint8_t data, uint8_t usart_channel);
 
+    /**
+     * shared USART transmit block IRQ hook
+     *
+     * @param data the data about to be transmitted
+     * @param length the number of bytes in data
+     * @param usart_channel the usart channel. (one of [1,2,3,4]; 1 => M4_USART1)
+     * @note called once per DMA transfer in TX DMA mode, and once per byte otherwise
+     * @note may run inside a IRQ, so keep it short and sweet
+     */
+    DEF_HOOK(usart_tx_block_irq, const uint8_t *data, size_t length, uint8_t usart_channel);
+
+    /**
+     * shared USART receive block IRQ hook
+     *
+     * @param data the data that was received
+     * @param length the number of bytes in data
+     * @param usart_channel the usart channel. (one of [1,2,3,4]; 1 => M4_USART1)
+     * @note called once per contiguous block in RX DMA mode, and once per byte otherwise
+     * @note may run inside a IRQ, so keep it short and sweet
+     */
+    DEF_HOOK(usart_rx_block_irq, const uint8_t *data, size_t length, uint8_t usart_channel);
+
     /**
      * hook for watchdog reload during yield()
      *
@@ -55,16 +78,17 @@ extern "C"
      *
      * @note
      * if this hook is not implemented, the cpu defaults to MCR at 8 MHz.
-     * the default is restored by the core unless 'CORE_DONT_RESTORE_DEFAULT_CLOCKS' is defined.
+     * the default is restored by the core unless 'CORE_DONT_RESTORE_DEFAULT_CLOCKS' is defined,
+     * or the clocks are still at their reset defaults anyway.
      *
      * @note
      * use "drivers/sysclock/sysclock_util.h" to help with clock configuration
      *
      * @note
      * example workflow:
-     * 1. configure flash / sram wait cycles (if needed)
-     * 2. enable oscillator (e.g. XTAL)
-     * 3. enable and configure PLL
+     * 1. enable oscillator (e.g. XTAL). sysclock_configure_xtal() does not wait for it to stabilize
+     * 2. configure flash / sram wait cycles and flash cache (if needed), while the oscillator starts up
+     * 3. enable and configure PLL (waits for the oscillator first)
      * 4. configure system clock dividers
      * 5. call power_mode_update_pre()
      * 6. switch system clock source
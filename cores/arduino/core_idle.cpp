@@ -0,0 +1,76 @@
+#include "core_idle.h"
+#include "core_scheduler.h"
+#include "drivers/sysclock/systick.h"
+#include <hc32_ddl.h>
+
+// background flash service, only linked if flash jobs are used
+extern "C" __attribute__((weak)) bool flash_async_is_busy(void);
+
+volatile bool core_idle_work_pending = false;
+
+static uint64_t idle_cycles = 0;
+
+// state of the last core_idle_get_load() call
+static uint64_t load_last_total = 0;
+static uint64_t load_last_idle = 0;
+
+void core_idle_sleep(void)
+{
+    // uptime does not advance with interrupts masked, so never sleep then
+    if (__get_PRIMASK() != 0 || __get_BASEPRI() != 0)
+    {
+        return;
+    }
+
+#ifdef CORE_SCHEDULER
+    // other tasks wait by yielding, so they only make progress if the main task does not sleep
+    if (core_scheduler_task_count() > 1)
+    {
+        return;
+    }
+#endif
+
+    // normal sleep, so all peripherals keep running and any interrupt wakes the CPU
+    SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+    // WFI wakes on pending interrupts even with PRIMASK set, but the handler only runs once it is cleared.
+    // so checking for pending work and sleeping cannot race with an interrupt signalling new work
+    __disable_irq();
+    const bool pending = core_idle_work_pending || (flash_async_is_busy != nullptr && flash_async_is_busy());
+    core_idle_work_pending = false;
+    if (!pending)
+    {
+        const uint64_t start = systick_cycles64();
+        __DSB();
+        __WFI();
+        idle_cycles += systick_cycles64() - start;
+    }
+    __enable_irq();
+}
+
+uint64_t core_idle_get_cycles(void)
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint64_t cycles = idle_cycles;
+    __set_PRIMASK(primask);
+    return cycles;
+}
+
+uint32_t core_idle_get_load(void)
+{
+    const uint64_t total = systick_cycles64();
+    const uint64_t idle = core_idle_get_cycles();
+
+    const uint64_t total_delta = total - load_last_total;
+    const uint64_t idle_delta = idle - load_last_idle;
+    load_last_total = total;
+    load_last_idle = idle;
+
+    if (total_delta == 0 || idle_delta >= total_delta)
+    {
+        return 0;
+    }
+
+    return static_cast<uint32_t>(((total_delta - idle_delta) * 1000) / total_delta);
+}
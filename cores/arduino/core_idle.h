@@ -0,0 +1,63 @@
+/**
+ * idle sleep:
+ *
+ * with CORE_ENABLE_IDLE_SLEEP defined, the main loop sleeps (WFI) after each call to loop() unless work is pending.
+ * any enabled interrupt wakes the CPU again, at the latest the SysTick interrupt after 1 ms.
+ *
+ * interrupt handlers that hand work to the main loop (USART RX, deferred soft-timers) call core_idle_notify(),
+ * so the main loop runs again right away instead of sleeping until the next interrupt.
+ * events only signalled through user flags are seen after the next interrupt, at the latest after 1 ms.
+ *
+ * only work signalled since the previous core_idle_sleep() is considered. buffers are not checked, so data that
+ * loop() left unread (e.g. in a USART rx buffer) does not keep the main loop awake. it is seen again after the
+ * next interrupt, or right away if more data arrives.
+ *
+ * the cycles spent sleeping are counted, which gives a CPU load metric.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief set when work for the main loop is pending
+     * @note use core_idle_notify()
+     */
+    extern volatile bool core_idle_work_pending;
+
+    /**
+     * @brief signal that work for the main loop is pending, so it must not sleep
+     * @note may be called from interrupts
+     */
+    static inline void core_idle_notify(void)
+    {
+        core_idle_work_pending = true;
+    }
+
+    /**
+     * @brief sleep until the next interrupt, unless work is pending
+     * @note pending work is what was signalled with core_idle_notify() since the last call, not the state of any buffer.
+     *       clears the pending work flag. called by the main loop after loop() with CORE_ENABLE_IDLE_SLEEP
+     * @note does nothing if called with interrupts disabled or masked
+     */
+    void core_idle_sleep(void);
+
+    /**
+     * @brief get the number of CPU cycles spent sleeping in core_idle_sleep()
+     * @note compare with systick_cycles64() to get the CPU load
+     */
+    uint64_t core_idle_get_cycles(void);
+
+    /**
+     * @brief get the CPU load since the last call
+     * @return CPU load in 0.1 % (0 - 1000)
+     */
+    uint32_t core_idle_get_load(void);
+
+#ifdef __cplusplus
+}
+#endif
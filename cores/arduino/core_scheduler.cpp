@@ -0,0 +1,225 @@
+#include "core_scheduler.h"
+
+#ifdef CORE_SCHEDULER
+#include "core_debug.h"
+#include <hc32_ddl.h>
+
+// value free task stack words are painted with
+#define STACK_PAINT_PATTERN 0xC0FFEE55ul
+
+// EXC_RETURN for returning to thread mode, using the PSP, with a standard (non-FPU) frame
+#define EXC_RETURN_THREAD_PSP 0xFFFFFFFDul
+
+// initial xPSR, with only the thumb bit set
+#define INITIAL_XPSR 0x01000000ul
+
+// words of the initial context: r4 - r11, then the exception frame r0 - r3, r12, lr, pc, xpsr
+#define INITIAL_CONTEXT_WORDS 16
+
+/**
+ * @brief the main task, running setup() and loop() on the main stack
+ */
+static core_task_t main_task = {
+    .sp = 0,
+    .exc_return = 0,
+    .next = &main_task,
+    .name = "main",
+    .stack = NULL,
+    .stack_size = 0,
+    .running = true,
+};
+
+/**
+ * @brief the running task
+ * @note used by the PendSV handler
+ */
+extern "C" core_task_t *core_scheduler_current_task;
+core_task_t *core_scheduler_current_task = &main_task;
+
+static size_t task_count = 1;
+
+/**
+ * @brief called when a task function returns
+ */
+static void task_exit()
+{
+    core_task_t *task = core_scheduler_current_task;
+
+    // remove the task from the list. its next pointer is kept, so the switch still finds the next task
+    __disable_irq();
+    core_task_t *prev = &main_task;
+    while (prev->next != task)
+    {
+        prev = prev->next;
+    }
+    prev->next = task->next;
+    task->running = false;
+    task_count--;
+    __enable_irq();
+
+    // never resumed, since the task is no longer in the list
+    while (true)
+    {
+        core_scheduler_yield();
+    }
+}
+
+bool core_task_create(core_task_t *task, const char *name, core_task_function_t function, void *arg, void *stack, const size_t stack_size)
+{
+    CORE_ASSERT(task != NULL && function != NULL && stack != NULL, "core_task_create: invalid parameter", return false);
+    CORE_ASSERT(stack_size >= CORE_SCHEDULER_MIN_STACK_SIZE, "core_task_create: stack too small", return false);
+    CORE_ASSERT(!task->running, "core_task_create: task already running", return false);
+
+    // paint the stack, for core_task_get_min_free_stack()
+    uint32_t *const bottom = reinterpret_cast<uint32_t *>((reinterpret_cast<uint32_t>(stack) + 3) & ~0x3ul);
+    uint32_t *const top = reinterpret_cast<uint32_t *>((reinterpret_cast<uint32_t>(stack) + stack_size) & ~0x7ul);
+    for (uint32_t *p = bottom; p < top; p++)
+    {
+        *p = STACK_PAINT_PATTERN;
+    }
+
+    // initial context, as if the task was switched out right before entering the function
+    uint32_t *sp = top - INITIAL_CONTEXT_WORDS;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        sp[i] = 0; // r4 - r11
+    }
+    sp[8] = reinterpret_cast<uint32_t>(arg);            // r0
+    sp[9] = 0;                                           // r1
+    sp[10] = 0;                                          // r2
+    sp[11] = 0;                                          // r3
+    sp[12] = 0;                                          // r12
+    sp[13] = reinterpret_cast<uint32_t>(task_exit);      // lr
+    sp[14] = reinterpret_cast<uint32_t>(function) & ~1ul; // pc
+    sp[15] = INITIAL_XPSR;                               // xpsr
+
+    task->sp = reinterpret_cast<uint32_t>(sp);
+    task->exc_return = EXC_RETURN_THREAD_PSP;
+    task->name = name;
+    task->stack = bottom;
+    task->stack_size = (top - bottom) * sizeof(uint32_t);
+
+    // the switch must not be interrupted by any other interrupt, so it runs at the lowest priority
+    NVIC_SetPriority(PendSV_IRQn, (1ul << __NVIC_PRIO_BITS) - 1);
+
+    // add the task to the end of the list
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    core_task_t *last = &main_task;
+    while (last->next != &main_task)
+    {
+        last = last->next;
+    }
+    task->next = &main_task;
+    last->next = task;
+    task->running = true;
+    task_count++;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+void core_scheduler_yield(void)
+{
+    // nothing to switch to
+    if (core_scheduler_current_task->next == core_scheduler_current_task)
+    {
+        return;
+    }
+
+    // never switch in interrupt handlers or critical sections
+    if (__get_IPSR() != 0 || __get_PRIMASK() != 0 || __get_BASEPRI() != 0)
+    {
+        return;
+    }
+
+    // PendSV runs right away, and returns into the next task
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+    __DSB();
+    __ISB();
+}
+
+core_task_t *core_task_current(void)
+{
+    return core_scheduler_current_task;
+}
+
+size_t core_scheduler_task_count(void)
+{
+    return task_count;
+}
+
+size_t core_task_get_min_free_stack(const core_task_t *task)
+{
+    if (task == NULL || task->stack == NULL)
+    {
+        return 0;
+    }
+
+    const uint32_t *p = task->stack;
+    const uint32_t *const top = task->stack + (task->stack_size / sizeof(uint32_t));
+    while (p < top && *p == STACK_PAINT_PATTERN)
+    {
+        p++;
+    }
+
+    return (p - task->stack) * sizeof(uint32_t);
+}
+
+/**
+ * @brief context switch to the next task
+ * @note saves r4 - r11 (and s16 - s31 with a FPU frame) on the stack of the current task, then restores them
+ *       from the stack of the next task. the main task runs on the MSP, all others on the PSP, which is selected
+ *       by the EXC_RETURN value saved with each task.
+ */
+extern "C" __attribute__((naked)) void PendSV_Handler(void)
+{
+    asm volatile(
+        "cpsid i                \n"
+
+        // r0 = stack pointer of the current task. with the MSP, this is the PendSV stack pointer
+        "tst lr, #4             \n"
+        "ite eq                 \n"
+        "mrseq r0, msp          \n"
+        "mrsne r0, psp          \n"
+
+        // save the remaining context
+#if defined(__ARM_FP)
+        "tst lr, #0x10          \n"
+        "it eq                  \n"
+        "vstmdbeq r0!, {s16-s31}\n"
+#endif
+        "stmdb r0!, {r4-r11}    \n"
+
+        // keep the saved context of the main task out of the way of other interrupts
+        "tst lr, #4             \n"
+        "it eq                  \n"
+        "msreq msp, r0          \n"
+
+        // current->sp, current->exc_return, then current = current->next
+        "movw r1, #:lower16:core_scheduler_current_task \n"
+        "movt r1, #:upper16:core_scheduler_current_task \n"
+        "ldr r2, [r1]           \n"
+        "str r0, [r2, #0]       \n"
+        "str lr, [r2, #4]       \n"
+        "ldr r2, [r2, #8]       \n"
+        "str r2, [r1]           \n"
+
+        // restore the context of the next task
+        "ldr r0, [r2, #0]       \n"
+        "ldr lr, [r2, #4]       \n"
+        "ldmia r0!, {r4-r11}    \n"
+#if defined(__ARM_FP)
+        "tst lr, #0x10          \n"
+        "it eq                  \n"
+        "vldmiaeq r0!, {s16-s31}\n"
+#endif
+        "tst lr, #4             \n"
+        "ite eq                 \n"
+        "msreq msp, r0          \n"
+        "msrne psp, r0          \n"
+        "isb                    \n"
+        "cpsie i                \n"
+        "bx lr                  \n");
+}
+
+#endif // CORE_SCHEDULER
@@ -0,0 +1,136 @@
+/**
+ * cooperative scheduler:
+ *
+ * with CORE_SCHEDULER defined, yield() switches to the next task, round-robin. every blocking primitive of the core
+ * (Usart::write(), delay(), adc_await_conversion_completed(), ...) calls yield() while it waits, so other tasks run
+ * instead of spinning.
+ *
+ * the main loop (setup() and loop()) is the main task. it keeps running on the main stack (MSP), while all other
+ * tasks run on their own, statically allocated stacks (PSP). tasks are only switched inside yield(), never
+ * preemptively, so data shared between tasks needs no locking.
+ * the context switch runs in the PendSV handler, at the lowest interrupt priority.
+ *
+ * yield() does not switch when called from an interrupt handler or with interrupts disabled or masked.
+ * a task returning from its function is removed from the scheduler, and its stack and task control block may be
+ * reused.
+ *
+ * interrupt handlers always run on the main stack, so task stacks only need to fit the task itself.
+ * the fault handler backtrace only covers the main stack.
+ *
+ * without CORE_SCHEDULER, none of this is compiled.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef CORE_SCHEDULER
+
+#ifndef CORE_SCHEDULER_MIN_STACK_SIZE
+/**
+ * @brief minimum size of a task stack, in bytes
+ * @note room for the initial context, including the FPU registers
+ */
+#define CORE_SCHEDULER_MIN_STACK_SIZE 256
+#endif
+
+/**
+ * @brief define a statically allocated, aligned task stack
+ * @param name name of the stack variable
+ * @param size size of the stack, in bytes
+ */
+#define CORE_TASK_STACK(name, size) static uint64_t name[((size) + 7) / 8]
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief task function
+     * @param arg the argument passed to core_task_create()
+     */
+    typedef void (*core_task_function_t)(void *arg);
+
+    /**
+     * @brief task control block
+     * @note must stay valid while the task runs. the first three fields are used by the PendSV handler
+     */
+    typedef struct core_task_t
+    {
+        /**
+         * @brief saved stack pointer, while the task is not running
+         */
+        uint32_t sp;
+
+        /**
+         * @brief saved EXC_RETURN value, which selects the stack and frame type when the task resumes
+         */
+        uint32_t exc_return;
+
+        /**
+         * @brief next task in the round-robin list
+         */
+        struct core_task_t *next;
+
+        /**
+         * @brief name of the task, for debugging
+         */
+        const char *name;
+
+        /**
+         * @brief bottom of the task stack. NULL for the main task
+         */
+        uint32_t *stack;
+
+        /**
+         * @brief size of the task stack, in bytes
+         */
+        size_t stack_size;
+
+        /**
+         * @brief is the task in the round-robin list?
+         */
+        volatile bool running;
+    } core_task_t;
+
+    /**
+     * @brief create a task, and add it to the scheduler
+     * @param task the task control block. must stay valid while the task runs
+     * @param name name of the task, for debugging
+     * @param function the task function. the task ends when it returns
+     * @param arg argument passed to the task function
+     * @param stack the task stack, e.g. defined using CORE_TASK_STACK()
+     * @param stack_size size of the stack, in bytes. at least CORE_SCHEDULER_MIN_STACK_SIZE
+     * @return true if the task was created, false if the parameters are invalid or the task is already running
+     * @note the task first runs on the next call to yield()
+     */
+    bool core_task_create(core_task_t *task, const char *name, core_task_function_t function, void *arg, void *stack, const size_t stack_size);
+
+    /**
+     * @brief switch to the next task, if there is one
+     * @note called by yield(). returns right away if called from an interrupt handler, or with interrupts masked
+     */
+    void core_scheduler_yield(void);
+
+    /**
+     * @brief get the task that is currently running
+     */
+    core_task_t *core_task_current(void);
+
+    /**
+     * @brief get the number of tasks, including the main task
+     */
+    size_t core_scheduler_task_count(void);
+
+    /**
+     * @brief get the minimum free stack of a task since it was created, in bytes
+     * @param task the task. must not be the main task
+     * @note the stack is painted when the task is created, and scanned from the bottom
+     */
+    size_t core_task_get_min_free_stack(const core_task_t *task);
+
+#ifdef __cplusplus
+}
+#endif
+#endif // CORE_SCHEDULER
@@ -0,0 +1,134 @@
+#include "core_stack.h"
+
+#if defined(CORE_STACK_MONITOR) || defined(CORE_STACK_GUARD)
+#include <hc32_ddl.h>
+
+// main stack bounds, from the linker script
+extern "C" uint8_t __StackLimit[];
+extern "C" uint8_t __StackTop[];
+
+// pattern the unused stack is painted with
+#define STACK_PAINT_PATTERN 0xC0FFEE55ul
+
+// MPU region used for the stack guard. the highest region wins if regions overlap
+#define STACK_GUARD_MPU_REGION 7
+
+#ifdef CORE_STACK_GUARD
+/**
+ * @brief get the base address of the guard region
+ * @note MPU regions must be aligned to their size
+ */
+static inline uint32_t get_guard_base()
+{
+    return (uint32_t(__StackLimit) + (CORE_STACK_GUARD_SIZE - 1)) & ~uint32_t(CORE_STACK_GUARD_SIZE - 1);
+}
+
+/**
+ * @brief get the MPU region size field for the guard size
+ * @note size = 2^(SIZE + 1)
+ */
+static constexpr uint32_t get_guard_size_field()
+{
+    return uint32_t(__builtin_ctz(CORE_STACK_GUARD_SIZE) - 1);
+}
+
+static void enable_stack_guard()
+{
+    // no-access region, not executable
+    __DMB();
+    MPU->RNR = STACK_GUARD_MPU_REGION;
+    MPU->RBAR = get_guard_base();
+    MPU->RASR = MPU_RASR_XN_Msk                                  // execute never
+                | (0ul << MPU_RASR_AP_Pos)                       // no access
+                | (get_guard_size_field() << MPU_RASR_SIZE_Pos) // size
+                | MPU_RASR_ENABLE_Msk;
+
+    // enable the MemManage fault, so a overflow is not escalated to a HardFault
+    SCB->SHCSR |= SCB_SHCSR_MEMFAULTENA_Msk;
+
+    // enable the MPU, keeping the default memory map everywhere else
+    MPU->CTRL = MPU_CTRL_PRIVDEFENA_Msk | MPU_CTRL_ENABLE_Msk;
+    __DSB();
+    __ISB();
+}
+
+bool core_stack_is_guard_address(const uint32_t address)
+{
+    const uint32_t base = get_guard_base();
+    return address >= base && address < (base + CORE_STACK_GUARD_SIZE);
+}
+#endif // CORE_STACK_GUARD
+
+#ifdef CORE_STACK_MONITOR
+/**
+ * @brief paint the stack from the bottom up to the current stack pointer
+ * @note noinline and nothing is called while painting, so the stack pointer read is the lowest address in use
+ */
+__attribute__((noinline)) static void paint_stack()
+{
+    uint32_t *p = reinterpret_cast<uint32_t *>(core_stack_get_bottom());
+    uint32_t *const end = reinterpret_cast<uint32_t *>(__get_MSP() & ~0x3ul);
+    while (p < end)
+    {
+        *p++ = STACK_PAINT_PATTERN;
+    }
+}
+#endif
+
+void core_stack_init()
+{
+#ifdef CORE_STACK_MONITOR
+    paint_stack();
+#endif
+
+#ifdef CORE_STACK_GUARD
+    enable_stack_guard();
+#endif
+}
+
+uint32_t core_stack_get_bottom()
+{
+#ifdef CORE_STACK_GUARD
+    return get_guard_base() + CORE_STACK_GUARD_SIZE;
+#else
+    return (uint32_t(__StackLimit) + 3) & ~0x3ul;
+#endif
+}
+
+uint32_t core_stack_get_top()
+{
+    return uint32_t(__StackTop);
+}
+
+uint32_t core_stack_get_size()
+{
+    return core_stack_get_top() - core_stack_get_bottom();
+}
+
+uint32_t core_stack_get_usage()
+{
+    return core_stack_get_top() - __get_MSP();
+}
+
+#ifdef CORE_STACK_MONITOR
+uint32_t core_stack_get_high_water_mark()
+{
+    return core_stack_get_size() - core_stack_get_min_free();
+}
+
+uint32_t core_stack_get_min_free()
+{
+    // the stack grows down, so the first word that is not painted is the deepest one ever used
+    const uint32_t *const bottom = reinterpret_cast<const uint32_t *>(core_stack_get_bottom());
+    const uint32_t *const top = reinterpret_cast<const uint32_t *>(core_stack_get_top());
+    const uint32_t *p = bottom;
+    while (p < top && *p == STACK_PAINT_PATTERN)
+    {
+        p++;
+    }
+
+    return uint32_t(p - bottom) * sizeof(uint32_t);
+}
+#endif // CORE_STACK_MONITOR
+
+#endif // CORE_STACK_MONITOR || CORE_STACK_GUARD
@@ -0,0 +1,86 @@
+/**
+ * main stack monitoring:
+ *
+ * with CORE_STACK_MONITOR defined, core_init() paints the unused part of the main stack (MSP) with a known pattern.
+ * the lowest address the pattern was overwritten at gives the high-water mark, i.e. the maximum stack usage since boot,
+ * including all interrupt handlers that ran on the main stack.
+ *
+ * with CORE_STACK_GUARD defined, a MPU region at the bottom of the stack forbids any access to its lowest
+ * CORE_STACK_GUARD_SIZE bytes. a stack overflow then raises a MemManage fault right away, which is reported as
+ * "STACK OVERFLOW" instead of silently corrupting the memory below the stack.
+ * the guard bytes are no longer usable as stack.
+ *
+ * the stack bounds are taken from the __StackLimit and __StackTop symbols of the linker script.
+ * without CORE_STACK_MONITOR and CORE_STACK_GUARD, none of this is compiled.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(CORE_STACK_MONITOR) || defined(CORE_STACK_GUARD)
+
+#ifndef CORE_STACK_GUARD_SIZE
+#define CORE_STACK_GUARD_SIZE 32
+#endif
+
+#if (CORE_STACK_GUARD_SIZE < 32) || ((CORE_STACK_GUARD_SIZE & (CORE_STACK_GUARD_SIZE - 1)) != 0)
+#error "CORE_STACK_GUARD_SIZE must be a power of two, and at least 32"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief paint the unused main stack, and enable the stack guard
+     * @note called at the beginning of core_init()
+     */
+    void core_stack_init(void);
+
+    /**
+     * @brief get the lowest usable address of the main stack
+     * @note above the guard region, if CORE_STACK_GUARD is enabled
+     */
+    uint32_t core_stack_get_bottom(void);
+
+    /**
+     * @brief get the initial value of the main stack pointer
+     */
+    uint32_t core_stack_get_top(void);
+
+    /**
+     * @brief get the usable size of the main stack, in bytes
+     */
+    uint32_t core_stack_get_size(void);
+
+    /**
+     * @brief get the current usage of the main stack, in bytes
+     * @note only meaningful when called from the main stack, i.e. not from a thread using the PSP
+     */
+    uint32_t core_stack_get_usage(void);
+
+#ifdef CORE_STACK_MONITOR
+    /**
+     * @brief get the maximum usage of the main stack since boot, in bytes
+     * @note scans the stack from the bottom, so runtime scales with the free stack
+     */
+    uint32_t core_stack_get_high_water_mark(void);
+
+    /**
+     * @brief get the minimum free main stack since boot, in bytes
+     */
+    uint32_t core_stack_get_min_free(void);
+#endif
+
+#ifdef CORE_STACK_GUARD
+    /**
+     * @brief check if an address is inside the stack guard region
+     */
+    bool core_stack_is_guard_address(const uint32_t address);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif // CORE_STACK_MONITOR || CORE_STACK_GUARD
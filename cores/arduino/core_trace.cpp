@@ -0,0 +1,131 @@
+#include "core_trace.h"
+
+#ifdef CORE_TRACE
+#include "drivers/sysclock/sysclock.h"
+#include "core_util.h"
+#include "Print.h"
+
+// number of records read at once by core_trace_drain()
+#define CORE_TRACE_DRAIN_CHUNK 8
+
+core_trace_record_t core_trace_buffer[CORE_TRACE_BUFFER_SIZE];
+volatile uint32_t core_trace_head = 0;
+
+/**
+ * @brief number of the next record to read
+ */
+static uint32_t core_trace_tail = 0;
+
+void core_trace_init(void)
+{
+    core_cycle_counter_enable();
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_START, SYSTEM_CLOCK_FREQUENCIES.hclk, 0);
+}
+
+size_t core_trace_read(core_trace_record_t *records, const size_t count, uint32_t *lost)
+{
+    uint32_t lost_records = 0;
+    size_t read = 0;
+    while (read < count)
+    {
+        const uint32_t head = core_trace_head;
+        if (core_trace_tail == head)
+        {
+            break;
+        }
+
+        // the writers lapped the reader, skip to the oldest record still in the ring
+        if ((head - core_trace_tail) > CORE_TRACE_BUFFER_SIZE)
+        {
+            lost_records += (head - core_trace_tail) - CORE_TRACE_BUFFER_SIZE;
+            core_trace_tail = head - CORE_TRACE_BUFFER_SIZE;
+        }
+
+        const volatile core_trace_record_t &slot = core_trace_buffer[core_trace_tail & (CORE_TRACE_BUFFER_SIZE - 1)];
+        const uint16_t expected = uint16_t((core_trace_tail & 0x7FFF) | CORE_TRACE_SEQUENCE_VALID);
+        const uint16_t sequence = slot.sequence;
+        if (sequence == 0)
+        {
+            // still being written by the code this was called from
+            break;
+        }
+
+        core_trace_record_t &record = records[read];
+        record.timestamp = slot.timestamp;
+        record.event = slot.event;
+        record.sequence = sequence;
+        record.arg0 = slot.arg0;
+        record.arg1 = slot.arg1;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+        // a writer preempting the copy (or the check above) replaced the record with a newer one
+        if (sequence != expected || slot.sequence != expected)
+        {
+            lost_records++;
+            core_trace_tail++;
+            continue;
+        }
+
+        read++;
+        core_trace_tail++;
+    }
+
+    if (lost != NULL)
+    {
+        *lost += lost_records;
+    }
+    return read;
+}
+
+void core_trace_clear(void)
+{
+    core_trace_tail = core_trace_head;
+}
+
+/**
+ * @brief send a record in binary form
+ */
+static void send_record(Print &out, const core_trace_record_t &record)
+{
+    out.write(uint8_t(CORE_TRACE_SYNC));
+    out.write(reinterpret_cast<const uint8_t *>(&record), sizeof(core_trace_record_t));
+}
+
+size_t core_trace_drain(Print &out, const size_t max_records)
+{
+    core_trace_record_t records[CORE_TRACE_DRAIN_CHUNK];
+    size_t sent = 0;
+    while (sent < max_records)
+    {
+        const size_t chunk = (max_records - sent) < CORE_TRACE_DRAIN_CHUNK ? (max_records - sent) : CORE_TRACE_DRAIN_CHUNK;
+        uint32_t lost = 0;
+        const size_t read = core_trace_read(records, chunk, &lost);
+
+        if (lost > 0)
+        {
+            const core_trace_record_t lost_record = {
+                .timestamp = DWT->CYCCNT,
+                .event = CORE_TRACE_EVENT_LOST,
+                .sequence = CORE_TRACE_SEQUENCE_VALID,
+                .arg0 = lost,
+                .arg1 = 0,
+            };
+            send_record(out, lost_record);
+        }
+
+        for (size_t i = 0; i < read; i++)
+        {
+            send_record(out, records[i]);
+        }
+
+        sent += read;
+        if (read < chunk)
+        {
+            break;
+        }
+    }
+
+    return sent;
+}
+
+#endif // CORE_TRACE
@@ -0,0 +1,220 @@
+/**
+ * binary event tracing:
+ *
+ * with CORE_TRACE defined, CORE_TRACE_EVENT() writes a fixed-size binary record (cycle timestamp, event id and two
+ * arguments) to a RAM ring buffer. writing a record takes a few cycles and does not lock, so it is safe to use in
+ * any interrupt handler, at any priority. the core traces the hot paths of the USART, ADC and TimerA drivers.
+ *
+ * the ring is drained asynchronously:
+ * - from loop(), core_trace_drain() sends the records in binary form, e.g. to a spare serial port
+ * - or, with a debug probe attached, the core_trace_buffer array is dumped from memory
+ * tools/trace/trace_decode.py decodes both formats into a readable timeline on the host.
+ *
+ * if the ring overflows, the oldest records are overwritten. the drain reports the number of lost records.
+ *
+ * without CORE_TRACE, none of this is compiled, and CORE_TRACE_EVENT() expands to nothing.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief trace event ids
+ * @note trace_decode.py reads the names from this enum, keep the "CORE_TRACE_EVENT_x = value," format
+ */
+typedef enum core_trace_event_t
+{
+    /**
+     * @brief records were lost because the ring overflowed. arg0 = number of lost records
+     * @note only generated by core_trace_drain()
+     */
+    CORE_TRACE_EVENT_LOST = 0x0000,
+
+    /**
+     * @brief tracing started. arg0 = HCLK frequency, to convert timestamps
+     */
+    CORE_TRACE_EVENT_START = 0x0001,
+
+    /**
+     * @brief USART rx data available interrupt. arg0 = USART number, arg1 = received byte
+     */
+    CORE_TRACE_EVENT_USART_RX = 0x0100,
+
+    /**
+     * @brief USART rx error interrupt. arg0 = USART number, arg1 = error flags (bit 0 framing, 1 parity, 2 overrun)
+     */
+    CORE_TRACE_EVENT_USART_RX_ERROR = 0x0101,
+
+    /**
+     * @brief USART rx timeout interrupt. arg0 = USART number
+     */
+    CORE_TRACE_EVENT_USART_RX_TIMEOUT = 0x0102,
+
+    /**
+     * @brief USART tx buffer empty interrupt. arg0 = USART number, arg1 = sent byte, or 0xFFFFFFFF if none was left
+     */
+    CORE_TRACE_EVENT_USART_TX = 0x0103,
+
+    /**
+     * @brief USART tx complete interrupt. arg0 = USART number
+     */
+    CORE_TRACE_EVENT_USART_TX_COMPLETE = 0x0104,
+
+    /**
+     * @brief USART tx DMA transfer complete interrupt. arg0 = USART number
+     */
+    CORE_TRACE_EVENT_USART_TX_DMA_COMPLETE = 0x0105,
+
+    /**
+     * @brief ADC DMA block complete interrupt. arg0 = ADC number
+     */
+    CORE_TRACE_EVENT_ADC_DMA_COMPLETE = 0x0200,
+
+    /**
+     * @brief TimerA step segment end interrupt. arg0 = step axis number
+     */
+    CORE_TRACE_EVENT_TIMERA_STEP_SEGMENT_END = 0x0300,
+
+    /**
+     * @brief first event id free for use by libraries and sketches
+     */
+    CORE_TRACE_EVENT_USER = 0x8000,
+} core_trace_event_t;
+
+/**
+ * @brief binary trace record
+ * @note plain little-endian fields, so host tools can decode a raw memory dump of the ring
+ */
+typedef struct core_trace_record_t
+{
+    /**
+     * @brief DWT cycle count at the time of the event
+     */
+    uint32_t timestamp;
+
+    /**
+     * @brief event id, see core_trace_event_t
+     */
+    uint16_t event;
+
+    /**
+     * @brief low 15 bits of the record number, with CORE_TRACE_SEQUENCE_VALID set
+     * @note written last, 0 while the record is being written
+     */
+    uint16_t sequence;
+
+    uint32_t arg0;
+    uint32_t arg1;
+} core_trace_record_t;
+
+/**
+ * @brief set in core_trace_record_t.sequence once the record is complete
+ */
+#define CORE_TRACE_SEQUENCE_VALID 0x8000u
+
+/**
+ * @brief sync byte preceding every record sent by core_trace_drain()
+ */
+#define CORE_TRACE_SYNC 0xA5u
+
+#ifdef CORE_TRACE
+#include <hc32_ddl.h>
+
+#ifndef CORE_TRACE_BUFFER_SIZE
+/**
+ * @brief number of records in the trace ring. must be a power of two
+ * @note each record takes 16 bytes of RAM
+ */
+#define CORE_TRACE_BUFFER_SIZE 256
+#endif
+
+#if (CORE_TRACE_BUFFER_SIZE < 2) || (CORE_TRACE_BUFFER_SIZE > 16384) || ((CORE_TRACE_BUFFER_SIZE & (CORE_TRACE_BUFFER_SIZE - 1)) != 0)
+#error "CORE_TRACE_BUFFER_SIZE must be a power of two, between 2 and 16384"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief the trace ring
+     * @note record n is at index (n % CORE_TRACE_BUFFER_SIZE)
+     */
+    extern core_trace_record_t core_trace_buffer[CORE_TRACE_BUFFER_SIZE];
+
+    /**
+     * @brief number of the next record to write
+     */
+    extern volatile uint32_t core_trace_head;
+
+    /**
+     * @brief start the DWT cycle counter, and write the CORE_TRACE_EVENT_START record
+     * @note called by core_init(), after the system clock is set up
+     */
+    void core_trace_init(void);
+
+    /**
+     * @brief write a trace record
+     * @param event event id, see core_trace_event_t
+     * @param arg0 first event argument
+     * @param arg1 second event argument
+     * @note lock-free, safe to call from any context. use CORE_TRACE_EVENT() instead, so calls are removed without CORE_TRACE
+     */
+    __attribute__((always_inline)) static inline void core_trace_write(const uint16_t event, const uint32_t arg0, const uint32_t arg1)
+    {
+        // reserve a record. a preempting writer gets the next one
+        const uint32_t n = __atomic_fetch_add(&core_trace_head, 1, __ATOMIC_RELAXED);
+        core_trace_record_t *record = &core_trace_buffer[n & (CORE_TRACE_BUFFER_SIZE - 1)];
+
+        record->sequence = 0;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        record->timestamp = DWT->CYCCNT;
+        record->event = event;
+        record->arg0 = arg0;
+        record->arg1 = arg1;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        record->sequence = (uint16_t)((n & 0x7FFF) | CORE_TRACE_SEQUENCE_VALID);
+    }
+
+    /**
+     * @brief read trace records that were not read yet
+     * @param records receives the records, oldest first
+     * @param count maximum number of records to read
+     * @param lost incremented by the number of records that were overwritten before they could be read. may be NULL
+     * @return number of records read
+     * @note call from thread mode (e.g. loop()), not from an interrupt handler
+     */
+    size_t core_trace_read(core_trace_record_t *records, const size_t count, uint32_t *lost);
+
+    /**
+     * @brief discard all records not read yet
+     */
+    void core_trace_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define CORE_TRACE_EVENT(event, arg0, arg1) core_trace_write((uint16_t)(event), (uint32_t)(arg0), (uint32_t)(arg1))
+
+#ifdef __cplusplus
+class Print;
+
+/**
+ * @brief send trace records not read yet in binary form
+ * @param out where to send to, e.g. a spare serial port
+ * @param max_records maximum number of records to send
+ * @return number of records sent
+ * @note each record is sent as CORE_TRACE_SYNC followed by the 16 record bytes. lost records are reported
+ *       using a CORE_TRACE_EVENT_LOST record. decode with tools/trace/trace_decode.py
+ * @note call from thread mode (e.g. loop()), not from an interrupt handler
+ */
+size_t core_trace_drain(Print &out, const size_t max_records = CORE_TRACE_BUFFER_SIZE);
+#endif
+
+#else
+
+#define CORE_TRACE_EVENT(event, arg0, arg1)
+
+#endif // CORE_TRACE
@@ -8,6 +8,7 @@ typedef uint8_t byte;
 typedef uint16_t word;
 
 typedef void (*voidFuncPtr)(void);
+typedef void (*voidFuncPtrParam)(void *);
 
 typedef int16_t gpio_pin_t;
 
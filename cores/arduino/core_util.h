@@ -1,6 +1,79 @@
 #pragma once
+#include <hc32_ddl.h>
 
 #ifndef STRINGIFY
 #define STRINGIFY_DETAIL(x) #x
 #define STRINGIFY(x) STRINGIFY_DETAIL(x)
 #endif
+
+/**
+ * @brief place a function in SRAM, so it runs without flash wait states
+ * @note the function is placed in a sub-section of .data, so the startup code copies it to SRAM
+ *       together with the initialized data. no linker script changes are required.
+ * @note long_call is required, as SRAM is out of range of a direct branch from flash
+ * @note define CORE_DISABLE_RAMFUNC to keep all functions in flash
+ */
+#ifndef CORE_RAMFUNC
+#ifdef CORE_DISABLE_RAMFUNC
+#define CORE_RAMFUNC
+#else
+#define CORE_RAMFUNC __attribute__((section(".data.core_ramfunc"), long_call, noinline))
+#endif
+#endif
+
+/**
+ * SRAM region placement:
+ *
+ * the HC32F460 has SRAMH (32K, zero wait states, at the start of RAM), SRAM1, SRAM2, SRAM3 and the 4K Ret_SRAM.
+ * by default, all data goes to .data / .bss in order of linking, so which of it ends up in SRAMH is left to chance.
+ *
+ * with board_build.sram_sections enabled, the build adds tools/ld/sram_sections.ld to the linker script, which places:
+ * - .sramh at the very start of RAM, before .data. it is thus always in SRAMH.
+ * - .sram_dma after .data, before .bss. this keeps DMA buffers out of the hot region, as far as .data allows.
+ * - .ret_sram_noinit in Ret_SRAM, not initialized at boot.
+ * .sramh and .sram_dma are zeroed before static constructors run.
+ *
+ * without the sections, all macros but CORE_DMA_BUFFER expand to nothing, and variables are placed as before.
+ */
+#ifdef CORE_SRAM_SECTIONS
+
+/**
+ * @brief place a variable in SRAMH, for data used by interrupt handlers or in hot loops
+ * @note variables must be zero-initialized. any other initial value is lost
+ */
+#define CORE_SRAMH __attribute__((section(".sramh")))
+
+/**
+ * @brief place a DMA source or target buffer outside of the hot region
+ * @note buffers must be zero-initialized. any other initial value is lost
+ */
+#define CORE_DMA_BUFFER __attribute__((section(".sram_dma"), aligned(4)))
+
+/**
+ * @brief place a variable in Ret_SRAM, keeping its value across resets and in power-down mode
+ * @note the variable is never initialized. validate its contents (e.g. with a magic value) before use
+ */
+#define CORE_RET_SRAM_NOINIT __attribute__((section(".ret_sram_noinit")))
+
+#else
+
+#define CORE_SRAMH
+#define CORE_DMA_BUFFER __attribute__((aligned(4)))
+#define CORE_RET_SRAM_NOINIT
+
+#endif // CORE_SRAM_SECTIONS
+
+/**
+ * @brief enable the DWT cycle counter, if not already enabled
+ * @note DWT->CYCCNT counts HCLK cycles and wraps at 32 bits. it is only reset when it is first enabled,
+ *       so other users of the counter are not disturbed
+ */
+static inline void core_cycle_counter_enable(void)
+{
+    if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+}
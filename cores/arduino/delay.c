@@ -1,12 +1,57 @@
 #include "delay.h"
+#include "yield.h"
+#include "drivers/sysclock/sysclock.h"
+#include "core_util.h"
 #include <hc32_ddl.h>
 
-inline void delay(uint32_t dwMs)
+void delay(uint32_t dwMs)
 {
-    Ddl_Delay1ms(dwMs);
+    // with interrupts disabled or masked (e.g. in a critical section), or in an interrupt handler
+    // of equal or higher priority than SysTick, uptime does not advance. yield() and WFI must not
+    // be used in handler mode either, so spin on the cycle counter instead
+    if (__get_PRIMASK() != 0 || __get_BASEPRI() != 0 || __get_IPSR() != 0)
+    {
+        while (dwMs > 0)
+        {
+            delayMicroseconds(1000);
+            dwMs--;
+        }
+        return;
+    }
+
+    // sleep until the next SysTick (or other) interrupt while at least a millisecond is left,
+    // then wait for the rest precisely
+    const uint64_t end = micros64() + (uint64_t)dwMs * 1000;
+    for (;;)
+    {
+        const uint64_t now = micros64();
+        if (now >= end)
+        {
+            return;
+        }
+
+        if ((end - now) >= 1000)
+        {
+            yield();
+            __WFI();
+        }
+    }
 }
 
-inline void delayMicroseconds(uint32_t dwUs)
+void delayMicroseconds(uint32_t dwUs)
 {
-    Ddl_Delay1us(dwUs);
+    core_cycle_counter_enable();
+
+    // count CPU cycles at the current HCLK, in chunks so the cycle count cannot overflow
+    const uint32_t cycles_per_us = SYSTEM_CLOCK_FREQUENCIES.hclk / 1000000;
+    while (dwUs > 0)
+    {
+        const uint32_t chunk_us = dwUs > 10000 ? 10000 : dwUs;
+        const uint32_t cycles = chunk_us * cycles_per_us;
+        const uint32_t start = DWT->CYCCNT;
+        while ((DWT->CYCCNT - start) < cycles)
+            ;
+
+        dwUs -= chunk_us;
+    }
 }
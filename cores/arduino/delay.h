@@ -40,7 +40,6 @@ extern "C"
     return systick_millis();
   }
 
-#ifdef ENABLE_MICROS
   /**
    * \brief Returns the number of microseconds since the Arduino board began running the current program.
    *
@@ -50,18 +49,51 @@ extern "C"
    * of eight microseconds.
    *
    * \note There are 1,000 microseconds in a millisecond and 1,000,000 microseconds in a second.
+   * \note interpolated from the 1 ms SysTick interrupt and the SysTick counter, so no faster interrupt is needed.
    */
   inline uint32_t micros()
   {
     return systick_micros();
   }
-#endif
+
+  /**
+   * \brief Returns the number of milliseconds since the program started, as 64-bit value.
+   *
+   * \note unlike millis(), this does not overflow in any practical time frame.
+   */
+  inline uint64_t millis64(void)
+  {
+    return systick_millis64();
+  }
+
+  /**
+   * \brief Returns the number of microseconds since the program started, as 64-bit value.
+   *
+   * \note unlike micros(), this does not overflow in any practical time frame.
+   */
+  inline uint64_t micros64(void)
+  {
+    return systick_micros64();
+  }
+
+  /**
+   * \brief Returns the number of CPU cycles since the program started, as 64-bit value.
+   *
+   * \note cycle-accurate, as the SysTick counter runs at the CPU clock. intended for performance tracing.
+   */
+  inline uint64_t cycles64(void)
+  {
+    return systick_cycles64();
+  }
 
   /**
    * \brief Pauses the program for the amount of time (in miliseconds) specified as parameter.
    * (There are 1000 milliseconds in a second.)
    *
    * \param dwMs the number of milliseconds to pause (uint32_t)
+   *
+   * \note calls yield() and sleeps (WFI) between SysTick interrupts. with interrupts disabled or in an interrupt handler,
+   *       busy-waits on the cycle counter instead.
    */
   void delay(uint32_t dwMs);
 
@@ -69,6 +101,8 @@ extern "C"
    * \brief Pauses the program for the amount of time (in microseconds) specified as parameter.
    *
    * \param dwUs the number of microseconds to pause (uint32_t)
+   *
+   * \note busy-waits on the DWT cycle counter, so it is accurate at any HCLK. does not call yield().
    */
   void delayMicroseconds(uint32_t dwUs);
 
@@ -1,6 +1,12 @@
 #include "adc.h"
+#include "../irqn/irqn.h"
+#include "../dma/dma.h"
+#include "../aos/aos.h"
+#include "../sysclock/sysclock.h"
 #include "../../yield.h"
 #include "../../core_debug.h"
+#include "../../core_critical.h"
+#include "../../core_util.h"
 
 /**
  * @brief assert that channel id is valid
@@ -30,6 +36,41 @@
 #define ADC_DEBUG_PRINTF(device, fmt, ...) \
     CORE_DEBUG_PRINTF("[%s] " fmt, ADC_REG_TO_NAME(device->adc.register_base), ##__VA_ARGS__)
 
+//
+// IRQ register / unregister helper
+//
+inline void adc_irq_register(adc_interrupt_config_t &irq, const char *name)
+{
+    // get auto-assigned irqn and set in irq struct
+    IRQn_Type irqn;
+    irqn_aa_get(irqn, name);
+    irq.interrupt_number = irqn;
+
+    // create irq registration struct
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = irq.interrupt_source,
+        .enIRQn = irq.interrupt_number,
+        .pfnCallback = irq.interrupt_handler,
+    };
+
+    // register and enable irq
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, irq.interrupt_priority);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+}
+
+inline void adc_irq_resign(adc_interrupt_config_t &irq, const char *name)
+{
+    // disable interrupt and clear pending
+    NVIC_DisableIRQ(irq.interrupt_number);
+    NVIC_ClearPendingIRQ(irq.interrupt_number);
+    enIrqResign(irq.interrupt_number);
+
+    // resign auto-assigned irqn
+    irqn_aa_resign(irq.interrupt_number, name);
+}
+
 //
 // ADC init
 //
@@ -46,13 +87,13 @@ inline void adc_adc_init(const adc_device_t *device)
     stc_adc_init_t init_device = {
         .enResolution = device->init_params.resolution,
         .enDataAlign = device->init_params.data_alignment,
-        .enAutoClear = AdcClren_Enable,
+        .enAutoClear = AdcClren_Disable, // keep sequence B results until read by adc_priority_read_result()
         .enScanMode = device->init_params.scan_mode,
         .enRschsel = AdcRschsel_Restart,
     };
     ADC_Init(device->adc.register_base, &init_device);
 
-    // ADC will always trigger conversion by software
+    // ADC triggers conversion by software, until adc_enable_hardware_trigger() is called
     ADC_TriggerSrcCmd(device->adc.register_base, device->adc.sequence, Disable);
 }
 
@@ -61,15 +102,24 @@ inline void adc_adc_init(const adc_device_t *device)
  */
 inline void adc_dma_init(const adc_device_t *device)
 {
+    // DMA repeat size is limited to 10 bits
+    const uint16_t result_count = device->adc.channel_count * device->init_params.sample_count;
+    CORE_ASSERT(result_count <= 0x3FF, "ADC channel_count * sample_count must be <= 1023");
+
+    // the channel is assigned at compile time, claim it to detect conflicts with other users
+    const dma_channel_t channel = {device->dma.register_base, device->dma.channel};
+    CORE_ASSERT(dma_claim(channel, "adc dma") == Ok, "adc_dma_init: DMA channel is in use", return);
+
     // prepare DMA transfer deviceuration to
     // transfer ADCx->DR0-DRn to state.conversion_results
+    // (the destination wraps around after sample_count conversions)
     stc_dma_config_t dma_device = {
         .u16BlockSize = device->adc.channel_count,
         .u16TransferCnt = 0,
         .u32SrcAddr = (uint32_t)(&device->adc.register_base->DR0),  // source address is ADCx->DR0
         .u32DesAddr = (uint32_t)(device->state.conversion_results), // destination address is state.conversion_results
         .u16SrcRptSize = device->adc.channel_count,
-        .u16DesRptSize = device->adc.channel_count,
+        .u16DesRptSize = result_count,
         .stcDmaChCfg = {
             .enSrcInc = AddressIncrease,
             .enDesInc = AddressIncrease,
@@ -79,7 +129,7 @@ inline void adc_dma_init(const adc_device_t *device)
             .enDesNseqEn = Disable,
             .enTrnWidth = Dma16Bit,
             .enLlpEn = Disable,
-            .enIntEn = Disable,
+            .enIntEn = Enable, // only reaches the NVIC while a callback is set
         },
     };
 
@@ -113,6 +163,7 @@ void adc_device_init(adc_device_t *device)
     // adc is set up to trigger conversion by software
     // once conversion is completed, DMA transfer is triggered via AOS
     // adc_wait_for_conversion() waits until the DMA transfer is complete
+    // in continuous scan mode, the conversion is (re-) started once a channel is enabled
     adc_adc_init(device);
     adc_dma_init(device);
 
@@ -125,17 +176,52 @@ void adc_device_init(adc_device_t *device)
 // ADC Channel API
 //
 
+/**
+ * @brief maximum time to wait for a single sample in adc_await_samples(), in milliseconds
+ */
+#define ADC_AWAIT_SAMPLE_TIMEOUT_MS 10
+
+/**
+ * @brief wait until all samples in state.conversion_results were written with the current channel selection
+ * @note only for continuous scan mode
+ * @note while the DMA interrupt is registered, it clears the DMA flag, so its completion counter is watched as well.
+ *       the DWT cycle counter is used for the timeout, so this also works with interrupts disabled
+ */
+inline void adc_await_samples(const adc_device_t *device)
+{
+    core_cycle_counter_enable();
+    const uint32_t timeout_cycles = (SYSTEM_CLOCK_FREQUENCIES.hclk / 1000) * ADC_AWAIT_SAMPLE_TIMEOUT_MS;
+
+    for (uint16_t sample = 0; sample < device->init_params.sample_count; sample++)
+    {
+        // read the counter before clearing the flag, so a block completing in between is seen either way
+        const uint32_t count = device->state.conversion_count;
+        DMA_ClearIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq);
+
+        const uint32_t start = DWT->CYCCNT;
+        while (DMA_GetIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq) != Set &&
+               device->state.conversion_count == count)
+        {
+            if ((DWT->CYCCNT - start) > timeout_cycles)
+            {
+                CORE_ASSERT_FAIL("adc_await_samples: timeout waiting for a sample");
+                return;
+            }
+        }
+    }
+}
+
 inline uint32_t adc_channel_to_mask(const adc_device_t *device, const uint8_t channel)
 {
     ASSERT_CHANNEL_ID(device, channel);
     return 1 << channel;
 }
 
-void adc_enable_channel(const adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time)
+void adc_enable_channel(adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time)
 {
     ASSERT_INITIALIZED(device, STRINGIFY(adc_enable_channel));
     ASSERT_CHANNEL_ID(device, adc_channel);
-    CORE_ASSERT(sample_time > 0, "adc channel sample_time must be > 0")
+    CORE_ASSERT(sample_time > 0, "adc channel sample_time must be > 0");
 
     ADC_DEBUG_PRINTF(device, "enable channel %d, sample_time=%d\n", adc_channel, sample_time);
     stc_adc_ch_cfg_t channel_config = {
@@ -143,10 +229,25 @@ void adc_enable_channel(const adc_device_t *device, const uint8_t adc_channel, u
         .u8Sequence = device->adc.sequence,
         .pu8SampTime = &sample_time,
     };
+
+    // in continuous scan mode, the sequence can only be changed while stopped
+    if (adc_is_continuous(device))
+    {
+        ADC_StopConvert(device->adc.register_base);
+    }
+
     ADC_AddAdcChannel(device->adc.register_base, &channel_config);
+    device->state.enabled_channels |= adc_channel_to_mask(device, adc_channel);
+
+    // restart and wait for valid samples, so the first read is not an average of stale data
+    if (adc_is_continuous(device))
+    {
+        ADC_StartConvert(device->adc.register_base);
+        adc_await_samples(device);
+    }
 }
 
-void adc_disable_channel(const adc_device_t *device, const uint8_t adc_channel)
+void adc_disable_channel(adc_device_t *device, const uint8_t adc_channel)
 {
     if (!device->state.initialized)
     {
@@ -157,19 +258,437 @@ void adc_disable_channel(const adc_device_t *device, const uint8_t adc_channel)
     ASSERT_CHANNEL_ID(device, adc_channel);
 
     ADC_DEBUG_PRINTF(device, "disable channel %d\n", adc_channel);
+    if (adc_is_continuous(device))
+    {
+        ADC_StopConvert(device->adc.register_base);
+        ADC_DelAdcChannel(device->adc.register_base, adc_channel_to_mask(device, adc_channel));
+        ADC_StartConvert(device->adc.register_base);
+    }
+    else
+    {
+        ADC_DelAdcChannel(device->adc.register_base, adc_channel_to_mask(device, adc_channel));
+    }
+
+    device->state.enabled_channels &= ~adc_channel_to_mask(device, adc_channel);
+}
+
+/**
+ * @brief ADC1 channels ADC12_IN4 - ADC12_IN11 are also ADC2 channels 0 - 7
+ */
+#define ADC12_SHARED_FIRST_CHANNEL 4
+#define ADC12_SHARED_LAST_CHANNEL 11
+#define IS_ADC12_SHARED_CHANNEL(device, channel) \
+    (device == &ADC1_device && channel >= ADC12_SHARED_FIRST_CHANNEL && channel <= ADC12_SHARED_LAST_CHANNEL)
+
+void adc_select_channel(adc_device_t **device, uint8_t *adc_channel)
+{
+#ifdef CORE_ADC_BALANCE_CHANNELS
+    if (!IS_ADC12_SHARED_CHANNEL(*device, *adc_channel))
+    {
+        return;
+    }
+
+    // keep the device the channel is already enabled on
+    const uint8_t adc2_channel = *adc_channel - ADC12_SHARED_FIRST_CHANNEL;
+    const bool on_adc1 = (ADC1_device.state.enabled_channels & (1 << *adc_channel)) != 0;
+    const bool on_adc2 = (ADC2_device.state.enabled_channels & (1 << adc2_channel)) != 0;
+
+    // otherwise, put it on the device with fewer channels in its scan sequence
+    if (on_adc2 || (!on_adc1 && __builtin_popcount(ADC2_device.state.enabled_channels) < __builtin_popcount(ADC1_device.state.enabled_channels)))
+    {
+        *device = &ADC2_device;
+        *adc_channel = adc2_channel;
+    }
+#endif
+}
+
+void adc_lookup_channel(adc_device_t **device, uint8_t *adc_channel)
+{
+#ifdef CORE_ADC_BALANCE_CHANNELS
+    if (!IS_ADC12_SHARED_CHANNEL(*device, *adc_channel))
+    {
+        return;
+    }
+
+    const uint8_t adc2_channel = *adc_channel - ADC12_SHARED_FIRST_CHANNEL;
+    if ((ADC2_device.state.enabled_channels & (1 << adc2_channel)) != 0)
+    {
+        *device = &ADC2_device;
+        *adc_channel = adc2_channel;
+    }
+#endif
+}
+
+//
+// ADC sample time API
+//
+
+void adc_set_sample_time(adc_device_t *device, const uint8_t adc_channel, const uint8_t sample_time)
+{
+    ASSERT_CHANNEL_ID(device, adc_channel);
+    device->state.sample_times[adc_channel] = sample_time;
+
+    // balanced channels may end up on either device
+    if (IS_ADC12_SHARED_CHANNEL(device, adc_channel))
+    {
+        ADC2_device.state.sample_times[adc_channel - ADC12_SHARED_FIRST_CHANNEL] = sample_time;
+        if ((ADC2_device.state.enabled_channels & (1 << (adc_channel - ADC12_SHARED_FIRST_CHANNEL))) != 0)
+        {
+            adc_enable_channel(&ADC2_device, adc_channel - ADC12_SHARED_FIRST_CHANNEL, adc_get_sample_time(device, adc_channel));
+        }
+    }
+
+    // re-adding a enabled channel only updates its sample time
+    if ((device->state.enabled_channels & adc_channel_to_mask(device, adc_channel)) != 0)
+    {
+        adc_enable_channel(device, adc_channel, adc_get_sample_time(device, adc_channel));
+    }
+}
+
+uint8_t adc_get_sample_time(const adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_CHANNEL_ID(device, adc_channel);
+    const uint8_t sample_time = device->state.sample_times[adc_channel];
+    return sample_time != 0 ? sample_time : ADC_DEFAULT_SAMPLE_TIME;
+}
+
+uint8_t adc_sample_time_from_ns(const uint32_t nanoseconds)
+{
+    // cycles = ceil(ns * f_pclk2 / 1e9)
+    const uint64_t cycles = ((uint64_t(nanoseconds) * SYSTEM_CLOCK_FREQUENCIES.pclk2) + 999999999ull) / 1000000000ull;
+    if (cycles < 1)
+    {
+        return 1;
+    }
+
+    return cycles > 0xFF ? 0xFF : uint8_t(cycles);
+}
+
+//
+// ADC callback API
+//
+
+/**
+ * @brief is the DMA block transfer complete interrupt needed?
+ */
+inline bool adc_needs_block_complete_irq(const adc_device_t *device)
+{
+    return device->state.conversion_completed_callback != NULL ||
+           device->state.conversion_completed_events != 0 ||
+           device->state.transforms != NULL;
+}
+
+/**
+ * @brief register or resign the DMA block transfer complete interrupt after a callback or transform changed
+ * @param was_needed was the interrupt needed before the change?
+ */
+static void adc_update_block_complete_irq(adc_device_t *device, const bool was_needed)
+{
+    adc_interrupt_config_t &irq = device->dma.block_complete;
+    const bool needed = adc_needs_block_complete_irq(device);
+    if (needed && !was_needed)
+    {
+        adc_irq_register(irq, "adc dma block complete");
+        DMA_EnableIrq(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq);
+    }
+    else if (!needed && was_needed)
+    {
+        DMA_DisableIrq(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq);
+        adc_irq_resign(irq, "adc dma block complete");
+    }
+}
+
+void adc_set_conversion_completed_callback(adc_device_t *device, adc_conversion_callback_t callback)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_set_conversion_completed_callback));
+    const bool was_needed = adc_needs_block_complete_irq(device);
+
+    // the interrupt checks the callback for NULL, so it may keep running while transforms are attached
+    device->state.conversion_completed_callback = callback;
+    adc_update_block_complete_irq(device, was_needed);
+}
+
+void adc_set_conversion_events(adc_device_t *device, const uint32_t events)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_set_conversion_events));
+    const bool was_needed = adc_needs_block_complete_irq(device);
+    device->state.conversion_completed_events = events;
+    adc_update_block_complete_irq(device, was_needed);
+}
+
+//
+// ADC transform API
+//
+
+void adc_attach_transform(adc_device_t *device, const uint8_t adc_channel, adc_channel_transform_t *transform)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_attach_transform));
+    ASSERT_CHANNEL_ID(device, adc_channel);
+    CORE_ASSERT(transform != NULL, "adc_attach_transform: transform is NULL", return);
+
+    // re-attaching moves the transform to the new channel
+    adc_detach_transform(device, transform);
+
+    const bool was_needed = adc_needs_block_complete_irq(device);
+    transform->adc_channel = adc_channel;
+    transform->sequence = 0;
+
+    // the first value is available right away, instead of after the next conversion
+    transform->value = adc_transform_evaluate(transform, adc_conversion_read_sum(device, adc_channel) / device->init_params.sample_count);
+
+    const uint32_t state = core_critical_enter();
+    transform->next = device->state.transforms;
+    device->state.transforms = transform;
+    core_critical_exit(state);
+
+    adc_update_block_complete_irq(device, was_needed);
+}
+
+void adc_detach_transform(adc_device_t *device, adc_channel_transform_t *transform)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_detach_transform));
+    const bool was_needed = adc_needs_block_complete_irq(device);
+
+    const uint32_t state = core_critical_enter();
+    for (adc_channel_transform_t **link = &device->state.transforms; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == transform)
+        {
+            *link = transform->next;
+            transform->next = NULL;
+            break;
+        }
+    }
+    core_critical_exit(state);
+
+    adc_update_block_complete_irq(device, was_needed);
+}
+
+//
+// ADC analog watchdog API
+//
+
+void adc_awd_start(adc_device_t *device, const uint16_t low, const uint16_t high, adc_awd_callback_t callback)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_awd_start));
+    CORE_ASSERT(low <= high, "adc_awd_start() low must be <= high", return);
+    CORE_ASSERT(callback != NULL, "adc_awd_start() callback must not be NULL", return);
+
+    ADC_DEBUG_PRINTF(device, "start analog watchdog, window=[%d, %d]\n", low, high);
+    const bool was_running = device->state.awd_callback != NULL;
+    device->state.awd_callback = callback;
+
+    // flag conversion results outside of [low, high], in any sequence
+    stc_adc_awd_cfg_t awd_config = {
+        .enAwdmd = AdcAwdCmpOutRange,
+        .enAwdss = AdcAwdSel_SA_SB,
+        .u16AwdDr0 = low,
+        .u16AwdDr1 = high,
+    };
+    ADC_ConfigAwd(device->adc.register_base, &awd_config);
+
+    if (!was_running)
+    {
+        adc_irq_register(device->awd, "adc awd");
+        ADC_AwdIntCmd(device->adc.register_base, Enable);
+        ADC_AwdCmd(device->adc.register_base, Enable);
+    }
+}
+
+void adc_awd_stop(adc_device_t *device)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_awd_stop));
+    if (device->state.awd_callback == NULL)
+    {
+        return;
+    }
+
+    ADC_DEBUG_PRINTF(device, "stop analog watchdog\n");
+    ADC_AwdCmd(device->adc.register_base, Disable);
+    ADC_AwdIntCmd(device->adc.register_base, Disable);
+    ADC_DelAwdChannel(device->adc.register_base, device->state.awd_channels);
+    ADC_ClrAwdChFlag(device->adc.register_base, device->state.awd_channels);
+    adc_irq_resign(device->awd, "adc awd");
+
+    device->state.awd_channels = 0;
+    device->state.awd_callback = NULL;
+}
+
+void adc_awd_enable_channel(adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_awd_enable_channel));
+    CORE_ASSERT(device->state.awd_callback != NULL, "adc_awd_enable_channel() analog watchdog not started", return);
+    ASSERT_CHANNEL_ID(device, adc_channel);
+
+    // the interrupt removes channels concurrently
+    const uint32_t mask = adc_channel_to_mask(device, adc_channel);
+    const uint32_t critical = core_critical_enter();
+    ADC_ClrAwdChFlag(device->adc.register_base, mask);
+    ADC_AddAwdChannel(device->adc.register_base, mask);
+    device->state.awd_channels |= mask;
+    core_critical_exit(critical);
+}
+
+void adc_awd_disable_channel(adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_awd_disable_channel));
+    ASSERT_CHANNEL_ID(device, adc_channel);
+
+    const uint32_t mask = adc_channel_to_mask(device, adc_channel);
+    const uint32_t critical = core_critical_enter();
+    ADC_DelAwdChannel(device->adc.register_base, mask);
+    ADC_ClrAwdChFlag(device->adc.register_base, mask);
+    device->state.awd_channels &= ~mask;
+    core_critical_exit(critical);
+}
+
+//
+// ADC trigger API
+//
+
+// owners of the AOS targets of the ADC internal triggers
+static const char *const hardware_trigger_owner = "adc hardware trigger";
+static const char *const priority_trigger_owner = "adc priority channel";
+
+/**
+ * @brief get the AOS target of a ADC internal trigger
+ * @param trigger internal trigger 0 (sequence A) or 1 (sequence B)
+ */
+static inline aos_target_t adc_trigger_target(const adc_device_t *device, const uint8_t trigger)
+{
+    if (device->adc.register_base == M4_ADC1)
+    {
+        return trigger == 0 ? AOS_TARGET_ADC1_TRIGGER0 : AOS_TARGET_ADC1_TRIGGER1;
+    }
+
+    return trigger == 0 ? AOS_TARGET_ADC2_TRIGGER0 : AOS_TARGET_ADC2_TRIGGER1;
+}
+
+void adc_enable_hardware_trigger(adc_device_t *device, const en_event_src_t event_source)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_enable_hardware_trigger));
+    CORE_ASSERT(!adc_is_continuous(device), "adc_enable_hardware_trigger() not supported in continuous scan mode", return);
+
+    ADC_DEBUG_PRINTF(device, "enable hardware trigger, event=%d\n", event_source);
+
+    // route the event to the sequence using internal trigger 0
+    // (the AOS peripheral clock is already enabled by adc_dma_init())
+    aos_claim(adc_trigger_target(device, 0), hardware_trigger_owner);
+    stc_adc_trg_cfg_t trigger_config = {
+        .u8Sequence = device->adc.sequence,
+        .enTrgSel = AdcTrgsel_TRGX0,
+        .enInTrg0 = event_source,
+    };
+    ADC_ConfigTriggerSrc(device->adc.register_base, &trigger_config);
+    ADC_TriggerSrcCmd(device->adc.register_base, device->adc.sequence, Enable);
+
+    device->state.hardware_triggered = true;
+}
+
+void adc_disable_hardware_trigger(adc_device_t *device)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_disable_hardware_trigger));
+
+    ADC_DEBUG_PRINTF(device, "disable hardware trigger\n");
+    ADC_TriggerSrcCmd(device->adc.register_base, device->adc.sequence, Disable);
+    if (device->state.hardware_triggered)
+    {
+        aos_resign(adc_trigger_target(device, 0), hardware_trigger_owner);
+    }
+    device->state.hardware_triggered = false;
+}
+
+//
+// ADC priority channel API
+//
+
+void adc_enable_priority_channel(adc_device_t *device, const uint8_t adc_channel, const en_event_src_t event_source, adc_conversion_callback_t callback)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_enable_priority_channel));
+    ASSERT_CHANNEL_ID(device, adc_channel);
+
+    ADC_DEBUG_PRINTF(device, "enable priority channel %d, event=%d\n", adc_channel, event_source);
+
+    // a channel can only be in one sequence
+    if ((device->state.enabled_channels & adc_channel_to_mask(device, adc_channel)) != 0)
+    {
+        adc_disable_channel(device, adc_channel);
+    }
+
+    uint8_t sample_time = adc_get_sample_time(device, adc_channel);
+    stc_adc_ch_cfg_t channel_config = {
+        .u32Channel = adc_channel_to_mask(device, adc_channel),
+        .u8Sequence = ADC_SEQ_B,
+        .pu8SampTime = &sample_time,
+    };
+    ADC_AddAdcChannel(device->adc.register_base, &channel_config);
+
+    // set callback before the interrupt is enabled
+    const bool was_enabled = device->state.priority_channels != 0;
+    device->state.priority_callback = callback;
+    device->state.priority_channels |= adc_channel_to_mask(device, adc_channel);
+
+    // sequence B uses internal trigger 1, so it does not interfere with adc_enable_hardware_trigger()
+    aos_claim(adc_trigger_target(device, 1), priority_trigger_owner);
+    stc_adc_trg_cfg_t trigger_config = {
+        .u8Sequence = ADC_SEQ_B,
+        .enTrgSel = AdcTrgsel_TRGX1,
+        .enInTrg1 = event_source,
+    };
+    ADC_ConfigTriggerSrc(device->adc.register_base, &trigger_config);
+
+    if (!was_enabled)
+    {
+        ADC_ClrEocFlag(device->adc.register_base, ADC_SEQ_B);
+        adc_irq_register(device->priority, "adc priority complete");
+        ADC_SeqITCmd(device->adc.register_base, ADC_SEQ_B, Enable);
+        ADC_TriggerSrcCmd(device->adc.register_base, ADC_SEQ_B, Enable);
+    }
+}
+
+void adc_disable_priority_channel(adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_CHANNEL_ID(device, adc_channel);
+    if ((device->state.priority_channels & adc_channel_to_mask(device, adc_channel)) == 0)
+    {
+        return;
+    }
+
+    ADC_DEBUG_PRINTF(device, "disable priority channel %d\n", adc_channel);
+
+    // the last channel stops sequence B before it is emptied
+    device->state.priority_channels &= ~adc_channel_to_mask(device, adc_channel);
+    if (device->state.priority_channels == 0)
+    {
+        ADC_TriggerSrcCmd(device->adc.register_base, ADC_SEQ_B, Disable);
+        ADC_SeqITCmd(device->adc.register_base, ADC_SEQ_B, Disable);
+        adc_irq_resign(device->priority, "adc priority complete");
+        aos_resign(adc_trigger_target(device, 1), priority_trigger_owner);
+        device->state.priority_callback = NULL;
+    }
+
     ADC_DelAdcChannel(device->adc.register_base, adc_channel_to_mask(device, adc_channel));
 }
 
+uint16_t adc_priority_read_result(const adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_CHANNEL_ID(device, adc_channel);
+
+    // DR0 - DRn are consecutive
+    return (&device->adc.register_base->DR0)[adc_channel];
+}
+
 //
 // ADC conversion API
 //
 
-void adc_start_conversion(const adc_device_t *device)
+void adc_start_conversion(adc_device_t *device)
 {
     ASSERT_INITIALIZED(device, STRINGIFY(adc_start_conversion));
 
     // clear DMA transfer complete flag
     DMA_ClearIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq);
+    device->state.conversion_completed = false;
 
     // start ADC conversion
     ADC_StartConvert(device->adc.register_base);
@@ -180,7 +699,8 @@ bool adc_is_conversion_completed(const adc_device_t *device)
     ASSERT_INITIALIZED(device, STRINGIFY(adc_is_conversion_completed));
 
     // check if DMA transfer complete flag is set
-    return DMA_GetIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq) == Set;
+    // (with a callback set, the interrupt clears the flag and sets conversion_completed instead)
+    return device->state.conversion_completed || DMA_GetIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq) == Set;
 }
 
 void adc_await_conversion_completed(const adc_device_t *device)
@@ -192,14 +712,29 @@ void adc_await_conversion_completed(const adc_device_t *device)
     }
 }
 
-uint16_t adc_conversion_read_result(const adc_device_t *device, const uint8_t adc_channel)
+uint16_t adc_conversion_read_result(adc_device_t *device, const uint8_t adc_channel)
 {
     ASSERT_INITIALIZED(device, STRINGIFY(adc_conversion_read_result));
     ASSERT_CHANNEL_ID(device, adc_channel);
 
     // clear DMA transfer complete flag
     DMA_ClearIrqFlag(device->dma.register_base, device->dma.channel, BlkTrnCpltIrq);
+    device->state.conversion_completed = false;
+
+    // read conversion result, averaged over all samples
+    return adc_conversion_read_sum(device, adc_channel) / device->init_params.sample_count;
+}
+
+uint32_t adc_conversion_read_sum(const adc_device_t *device, const uint8_t adc_channel)
+{
+    ASSERT_INITIALIZED(device, STRINGIFY(adc_conversion_read_sum));
+    ASSERT_CHANNEL_ID(device, adc_channel);
+
+    uint32_t sum = 0;
+    for (uint16_t sample = 0; sample < device->init_params.sample_count; sample++)
+    {
+        sum += device->state.conversion_results[(sample * device->adc.channel_count) + adc_channel];
+    }
 
-    // read conversion result
-    return device->state.conversion_results[adc_channel];
+    return sum;
 }
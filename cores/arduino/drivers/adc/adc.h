@@ -13,18 +13,22 @@ extern "C"
      */
     void adc_device_init(adc_device_t *device);
 
+/**
+ * @brief default sample time of a adc channel, in ADC clock (PCLK2) cycles
+ */
+#define ADC_DEFAULT_SAMPLE_TIME 50
+
 #ifdef __cplusplus
-    // TODO: find out what unit sample_time is in...
     /**
      * @brief enable adc conversion channel
      * @param device ADC device configuration
      * @param adc_channel ADC channel to enable
-     * @param sample_time ADC sampling time
+     * @param sample_time ADC sampling time, in ADC clock (PCLK2) cycles. must be > 0
      * @note requires adc_device_init() to be called first
      */
-    void adc_enable_channel(const adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time = 50);
+    void adc_enable_channel(adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time = ADC_DEFAULT_SAMPLE_TIME);
 #else
-    void adc_enable_channel(const adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time);
+    void adc_enable_channel(adc_device_t *device, const uint8_t adc_channel, uint8_t sample_time);
 #endif
 
     /**
@@ -33,14 +37,179 @@ extern "C"
      * @param adc_channel ADC channel to disable
      * @note if adc_device_init() was not called before, this function will do nothing
      */
-    void adc_disable_channel(const adc_device_t *device, const uint8_t adc_channel);
+    void adc_disable_channel(adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief set the sample time of a adc channel
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to configure
+     * @param sample_time ADC sampling time, in ADC clock (PCLK2) cycles. 0 to use ADC_DEFAULT_SAMPLE_TIME
+     * @note if the channel is already enabled, the new sample time is applied immediately
+     * @note for channels shared by ADC1 and ADC2, setting the ADC1 channel also sets the ADC2 channel
+     */
+    void adc_set_sample_time(adc_device_t *device, const uint8_t adc_channel, const uint8_t sample_time);
+
+    /**
+     * @brief get the sample time of a adc channel
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to get the sample time of
+     * @return sample time set with adc_set_sample_time(), or ADC_DEFAULT_SAMPLE_TIME
+     */
+    uint8_t adc_get_sample_time(const adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief convert a sample time in nanoseconds to ADC clock (PCLK2) cycles
+     * @param nanoseconds the minimum sampling time
+     * @return sample time in ADC clock cycles, rounded up and clamped to 1 - 255
+     * @note uses the current PCLK2 frequency
+     */
+    uint8_t adc_sample_time_from_ns(const uint32_t nanoseconds);
+
+    /**
+     * @brief select the adc device to enable a channel on
+     * @param device in: the ADC1 device of the channel, as in the pin map. out: the device to use
+     * @param adc_channel in: the ADC1 channel number. out: the channel number on the selected device
+     * @note with CORE_ADC_BALANCE_CHANNELS, channels shared by ADC1 and ADC2 (ADC12_IN4 - ADC12_IN11) are
+     *       put on the device with fewer enabled channels. otherwise, the input is not changed
+     * @note the channel has to be enabled before the next call, so it is counted
+     */
+    void adc_select_channel(adc_device_t **device, uint8_t *adc_channel);
+
+    /**
+     * @brief find the adc device a channel was enabled on
+     * @param device in: the ADC1 device of the channel, as in the pin map. out: the device the channel is enabled on
+     * @param adc_channel in: the ADC1 channel number. out: the channel number on that device
+     * @note the input is not changed if the channel is not enabled on ADC2
+     */
+    void adc_lookup_channel(adc_device_t **device, uint8_t *adc_channel);
+
+    /**
+     * @brief start a conversion of the adc sequence on every occurrence of a hardware event
+     * @param device ADC device configuration
+     * @param event_source the trigger event, eg. EVT_TMRA1_CMP or EVT_TMR01_GCMA
+     * @note requires adc_device_init() to be called first
+     * @note the event is routed through AOS. the timer generating the event has to be configured by the caller
+     * @note not supported in continuous scan mode
+     */
+    void adc_enable_hardware_trigger(adc_device_t *device, const en_event_src_t event_source);
+
+    /**
+     * @brief stop starting conversions on a hardware event
+     * @param device ADC device configuration
+     * @note conversions have to be started by software again afterwards
+     */
+    void adc_disable_hardware_trigger(adc_device_t *device);
+
+    /**
+     * @brief set a callback for completed conversions
+     * @param device ADC device configuration
+     * @param callback the callback, called from the DMA block transfer complete interrupt. NULL to remove the callback
+     * @note requires adc_device_init() to be called first
+     * @note while a callback is set, the DMA interrupt is registered. polling with adc_is_conversion_completed() still works
+     */
+    void adc_set_conversion_completed_callback(adc_device_t *device, adc_conversion_callback_t callback);
+
+    /**
+     * @brief set events to set for completed conversions, for core_events_wait()
+     * @param device ADC device configuration
+     * @param events the events, set from the DMA block transfer complete interrupt. 0 to remove them
+     * @note requires adc_device_init() to be called first
+     * @note like a callback, this registers the DMA interrupt. see core_events.h
+     */
+    void adc_set_conversion_events(adc_device_t *device, const uint32_t events);
+
+    /**
+     * @brief attach a transform to a adc channel, see adc_transform.h
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel whose results are transformed
+     * @param transform the transform. must stay valid until detached. value is set from the latest result right away
+     * @note requires adc_device_init() to be called first
+     * @note while a transform is attached, the DMA interrupt is registered
+     * @note a transform can only be attached to one channel. attaching it again moves it
+     */
+    void adc_attach_transform(adc_device_t *device, const uint8_t adc_channel, adc_channel_transform_t *transform);
+
+    /**
+     * @brief detach a transform from its adc channel
+     * @param device ADC device configuration
+     * @param transform the transform. does nothing if not attached
+     * @note requires adc_device_init() to be called first
+     */
+    void adc_detach_transform(adc_device_t *device, adc_channel_transform_t *transform);
+
+    /**
+     * @brief start the analog watchdog of a adc device
+     * @param device ADC device configuration
+     * @param low lower bound of the window
+     * @param high upper bound of the window
+     * @param callback called when a conversion result of a watched channel is outside the window
+     * @note requires adc_device_init() to be called first
+     * @note the hardware has one window per adc device, shared by all watched channels
+     * @note the watchdog only checks conversions that happen, so combine it with continuous scan mode or a hardware trigger
+     * @note if already running, the window and callback are updated
+     */
+    void adc_awd_start(adc_device_t *device, const uint16_t low, const uint16_t high, adc_awd_callback_t callback);
+
+    /**
+     * @brief stop the analog watchdog of a adc device
+     * @param device ADC device configuration
+     * @note all watched channels are removed
+     */
+    void adc_awd_stop(adc_device_t *device);
+
+    /**
+     * @brief watch a channel with the analog watchdog
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to watch
+     * @note requires adc_awd_start() to be called first
+     * @note once a channel left the window, it is no longer watched. call this function again to re-arm it
+     */
+    void adc_awd_enable_channel(adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief stop watching a channel with the analog watchdog
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to no longer watch
+     */
+    void adc_awd_disable_channel(adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief convert a channel in sequence B, which interrupts the sequence A scan
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to convert with priority
+     * @param event_source the trigger event starting sequence B, eg. EVT_TMRA1_CMP
+     * @param callback called from the sequence B end of conversion interrupt. read the result with adc_priority_read_result()
+     * @note requires adc_device_init() to be called first
+     * @note if the channel is enabled in sequence A, it is moved to sequence B
+     * @note all priority channels of a device share one trigger and callback. the last call sets them
+     * @note sequence A restarts after sequence B completed
+     */
+    void adc_enable_priority_channel(adc_device_t *device, const uint8_t adc_channel, const en_event_src_t event_source, adc_conversion_callback_t callback);
+
+    /**
+     * @brief remove a channel from sequence B
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to remove
+     * @note the channel is not added back to sequence A
+     * @note once the last priority channel is removed, the sequence B trigger and interrupt are disabled
+     */
+    void adc_disable_priority_channel(adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief read the latest conversion result of a priority channel
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel enabled with adc_enable_priority_channel()
+     * @return conversion result
+     * @note reads the data register directly, so this is safe to call from the priority callback
+     */
+    uint16_t adc_priority_read_result(const adc_device_t *device, const uint8_t adc_channel);
 
     /**
      * @brief start asynchronous conversion
      * @param device ADC device configuration
      * @note requires adc_device_init() to be called first
      */
-    void adc_start_conversion(const adc_device_t *device);
+    void adc_start_conversion(adc_device_t *device);
 
     /**
      * @brief check if conversion is complete
@@ -63,8 +232,30 @@ extern "C"
      * @param adc_channel ADC channel to read
      * @return conversion result
      * @note requires adc_device_init() to be called first
+     * @note in continuous scan mode, this is the average of the last init_params.sample_count conversions
+     */
+    uint16_t adc_conversion_read_result(adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief read the sum of all samples of a channel
+     * @param device ADC device configuration
+     * @param adc_channel ADC channel to read
+     * @return sum of the last init_params.sample_count conversion results. use for oversampling
+     * @note requires adc_device_init() to be called first
+     * @note in continuous scan mode, this never blocks
      */
-    uint16_t adc_conversion_read_result(const adc_device_t *device, const uint8_t adc_channel);
+    uint32_t adc_conversion_read_sum(const adc_device_t *device, const uint8_t adc_channel);
+
+    /**
+     * @brief check if the adc runs in continuous scan mode
+     * @param device ADC device configuration
+     * @return true if the adc converts continuously
+     */
+    inline bool adc_is_continuous(const adc_device_t *device)
+    {
+        return device->init_params.scan_mode == AdcMode_SAContinuous ||
+               device->init_params.scan_mode == AdcMode_SAContinuousSBOnce;
+    }
 
     /**
      * @brief start adc conversion and wait for result synchronously
@@ -72,11 +263,16 @@ extern "C"
      * @param adc_channel ADC channel to read
      * @return conversion result
      * @note requires adc_device_init() to be called first
+     * @note in continuous scan mode or with a hardware trigger, this returns the latest result(s) without waiting
      */
-    inline uint16_t adc_read_sync(const adc_device_t *device, const uint8_t adc_channel)
+    inline uint16_t adc_read_sync(adc_device_t *device, const uint8_t adc_channel)
     {
-        adc_start_conversion(device);
-        adc_await_conversion_completed(device);
+        if (!adc_is_continuous(device) && !device->state.hardware_triggered)
+        {
+            adc_start_conversion(device);
+            adc_await_conversion_completed(device);
+        }
+
         return adc_conversion_read_result(device, adc_channel);
     }
 
@@ -1,4 +1,7 @@
 #include "adc_config.h"
+#include "adc_handlers.h"
+#include "../../core_util.h"
+#include "../irqn/irq_priority.h"
 
 // configurable ADC resolution
 #ifndef CORE_ADC_RESOLUTION
@@ -15,6 +18,37 @@
 #error "Invalid ADC resolution. only 8, 10, 12 bit are supported"
 #endif
 
+// continuous scan mode, with a running average of CORE_ADC_CONTINUOUS_SAMPLES samples per channel
+#ifdef CORE_ADC_CONTINUOUS
+#define ADC_SCAN_MODE AdcMode_SAContinuousSBOnce
+#ifndef CORE_ADC_CONTINUOUS_SAMPLES
+#define CORE_ADC_CONTINUOUS_SAMPLES 4
+#endif
+#define ADC_SAMPLE_COUNT CORE_ADC_CONTINUOUS_SAMPLES
+#else
+#define ADC_SCAN_MODE AdcMode_SAOnceSBOnce
+#define ADC_SAMPLE_COUNT 1
+#endif
+
+#if ADC_SAMPLE_COUNT < 1
+#error "CORE_ADC_CONTINUOUS_SAMPLES must be at least 1"
+#endif
+
+// ADC2 uses the DMA channel of USART4 TX DMA
+#if defined(CORE_ADC_BALANCE_CHANNELS) && defined(USART4_TX_DMA)
+#error "CORE_ADC_BALANCE_CHANNELS cannot be used with USART4_TX_DMA, both use DMA2 channel 3"
+#endif
+
+//
+// ADC DMA buffers
+//
+static uint16_t adc1_conversion_results[ADC1_CH_COUNT * ADC_SAMPLE_COUNT] CORE_DMA_BUFFER;
+static uint16_t adc2_conversion_results[ADC2_CH_COUNT * ADC_SAMPLE_COUNT] CORE_DMA_BUFFER;
+
+// statically allocated, so no static constructor allocates them before main()
+static uint8_t adc1_sample_times[ADC1_CH_COUNT];
+static uint8_t adc2_sample_times[ADC2_CH_COUNT];
+
 //
 // ADC devices
 //
@@ -28,15 +62,72 @@ adc_device_t ADC1_device = {
     .init_params = {
         .resolution = ADC_RESOLUTION,
         .data_alignment = AdcDataAlign_Right,
-        .scan_mode = AdcMode_SAOnce, // only sequence A
+        .scan_mode = ADC_SCAN_MODE, // sequence B only converts priority channels
+        .sample_count = ADC_SAMPLE_COUNT,
     },
     .dma = {
         .register_base = M4_DMA1,
         .clock_id = PWC_FCG0_PERIPH_DMA1,
         .channel = DmaCh1,
         .event_source = EVT_ADC1_EOCA,
+        .block_complete = {
+            .interrupt_priority = IRQ_PRIORITY_ADC,
+            .interrupt_source = INT_DMA1_BTC1,
+            .interrupt_handler = ADCx_dma_block_complete_irq<1>,
+        },
+    },
+    .awd = {
+        .interrupt_priority = IRQ_PRIORITY_ADC,
+        .interrupt_source = INT_ADC1_CHCMP,
+        .interrupt_handler = ADCx_awd_irq<1>,
+    },
+    .priority = {
+        .interrupt_priority = IRQ_PRIORITY_ADC,
+        .interrupt_source = INT_ADC1_EOCB,
+        .interrupt_handler = ADCx_priority_complete_irq<1>,
+    },
+    .state = {
+        .conversion_results = adc1_conversion_results,
+        .sample_times = adc1_sample_times,
+    },
+};
+
+adc_device_t ADC2_device = {
+    .adc = {
+        .register_base = M4_ADC2,
+        .clock_id = PWC_FCG3_PERIPH_ADC2,
+        .sequence = ADC_SEQ_A,
+        .channel_count = ADC2_CH_COUNT,
+    },
+    .init_params = {
+        .resolution = ADC_RESOLUTION,
+        .data_alignment = AdcDataAlign_Right,
+        .scan_mode = ADC_SCAN_MODE, // sequence B only converts priority channels
+        .sample_count = ADC_SAMPLE_COUNT,
+    },
+    .dma = {
+        .register_base = M4_DMA2,
+        .clock_id = PWC_FCG0_PERIPH_DMA2,
+        .channel = DmaCh3,
+        .event_source = EVT_ADC2_EOCA,
+        .block_complete = {
+            .interrupt_priority = IRQ_PRIORITY_ADC,
+            .interrupt_source = INT_DMA2_BTC3,
+            .interrupt_handler = ADCx_dma_block_complete_irq<2>,
+        },
+    },
+    .awd = {
+        .interrupt_priority = IRQ_PRIORITY_ADC,
+        .interrupt_source = INT_ADC2_CHCMP,
+        .interrupt_handler = ADCx_awd_irq<2>,
+    },
+    .priority = {
+        .interrupt_priority = IRQ_PRIORITY_ADC,
+        .interrupt_source = INT_ADC2_EOCB,
+        .interrupt_handler = ADCx_priority_complete_irq<2>,
     },
     .state = {
-        .conversion_results = new uint16_t[ADC1_CH_COUNT],
+        .conversion_results = adc2_conversion_results,
+        .sample_times = adc2_sample_times,
     },
 };
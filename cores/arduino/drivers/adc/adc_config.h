@@ -1,5 +1,6 @@
 #pragma once
 #include <hc32_ddl.h>
+#include "adc_transform.h"
 
 /**
  * @brief ADC peripheral configuration
@@ -47,11 +48,45 @@ typedef struct adc_init_params_t
     /**
      * @brief ADC scan mode
      * @note must include sequence set in peripheral config
+     * @note sequence B is only used for priority channels, see adc_enable_priority_channel()
      */
     en_adc_scan_mode_t scan_mode;
 
+    /**
+     * @brief number of samples per channel kept in conversion_results
+     * @note only > 1 in continuous scan mode (AdcMode_SAContinuous[SBOnce]). must be 1 otherwise
+     */
+    uint16_t sample_count;
+
 } adc_init_params_t;
 
+/**
+ * @brief ADC interrupt configuration
+ */
+typedef struct adc_interrupt_config_t
+{
+    /**
+     * @brief IRQn assigned to this interrupt handler
+     * @note auto-assigned in adc_set_conversion_completed_callback()
+     */
+    IRQn_Type interrupt_number;
+
+    /**
+     * @brief interrupt priority
+     */
+    uint32_t interrupt_priority;
+
+    /**
+     * @brief Interrupt source to set for this interrupt handler
+     */
+    en_int_src_t interrupt_source;
+
+    /**
+     * @brief Interrupt handler function pointer
+     */
+    func_ptr_t interrupt_handler;
+} adc_interrupt_config_t;
+
 /**
  * @brief ADC DMA configuration
  */
@@ -78,8 +113,31 @@ typedef struct adc_dma_config_t
      * @note should be set to EVT_ADCx_EOCA (ADC end of conversion)
      */
     en_event_src_t event_source;
+
+    /**
+     * @brief DMA block transfer complete interrupt
+     * @note only registered while a conversion completed callback or a transform is set
+     */
+    adc_interrupt_config_t block_complete;
 } adc_dma_config_t;
 
+struct adc_device_t;
+
+/**
+ * @brief callback for ADC analog watchdog events
+ * @param device the ADC device
+ * @param adc_channel the channel whose conversion result left the watchdog window
+ * @note called from the analog watchdog interrupt
+ */
+typedef void (*adc_awd_callback_t)(struct adc_device_t *device, uint8_t adc_channel);
+
+/**
+ * @brief callback for completed ADC conversions
+ * @param device the ADC device that completed a conversion
+ * @note called from the DMA block transfer complete interrupt
+ */
+typedef void (*adc_conversion_callback_t)(struct adc_device_t *device);
+
 /**
  * @brief ADC runtime state
  */
@@ -90,12 +148,92 @@ typedef struct adc_runtime_state_t
      */
     bool initialized;
 
+    /**
+     * @brief are conversions started by a hardware trigger event?
+     * @note set by adc_enable_hardware_trigger()
+     */
+    bool hardware_triggered;
+
+    /**
+     * @brief bitmask of enabled adc channels
+     * @note bit n == adc channel n
+     */
+    uint32_t enabled_channels;
+
+    /**
+     * @brief did a conversion complete since it was last started or read?
+     * @note set by the DMA block transfer complete interrupt, which clears the DMA flag
+     */
+    volatile bool conversion_completed;
+
+    /**
+     * @brief number of DMA block transfers completed while the DMA interrupt was registered
+     * @note incremented by the DMA block transfer complete interrupt. wraps around
+     */
+    volatile uint32_t conversion_count;
+
+    /**
+     * @brief callback for completed conversions
+     * @note NULL if not set
+     */
+    adc_conversion_callback_t conversion_completed_callback;
+
+    /**
+     * @brief events set for completed conversions
+     * @note 0 if not set. see core_events.h
+     */
+    uint32_t conversion_completed_events;
+
+    /**
+     * @brief bitmask of channels checked by the analog watchdog
+     * @note bit n == adc channel n
+     */
+    volatile uint32_t awd_channels;
+
+    /**
+     * @brief callback for analog watchdog events
+     * @note NULL if the analog watchdog is not running
+     */
+    adc_awd_callback_t awd_callback;
+
+    /**
+     * @brief bitmask of channels in sequence B
+     * @note bit n == adc channel n
+     */
+    uint32_t priority_channels;
+
+    /**
+     * @brief callback for completed sequence B conversions
+     * @note NULL if no priority channel is enabled
+     */
+    adc_conversion_callback_t priority_callback;
+
     /**
      * @brief adc conversion results array
-     * @note index == adc channel number
-     * @note lenght == adc channel count (see ADCx_device.adc.channel_count)
+     * @note index == (sample * channel count) + adc channel number
+     * @note lenght == adc channel count (see ADCx_device.adc.channel_count) * sample count (see ADCx_device.init_params.sample_count)
+     * @note in continuous scan mode, the DMA writes into this array in circular mode
      */
     uint16_t *conversion_results;
+
+    /**
+     * @brief sample time of each adc channel, in ADC clock (PCLK2) cycles
+     * @note index == adc channel number. 0 == ADC_DEFAULT_SAMPLE_TIME
+     * @note lenght == adc channel count (see ADCx_device.adc.channel_count)
+     */
+    uint8_t *sample_times;
+
+    /**
+     * @brief transforms evaluated for every completed conversion, as a linked list
+     * @note NULL if no transform is attached. see adc_attach_transform()
+     */
+    adc_channel_transform_t *transforms;
+
+    /**
+     * @brief scans since the transforms were last updated
+     * @note only used in continuous scan mode
+     */
+    uint16_t transform_scan_count;
 } adc_runtime_state_t;
 
 /**
@@ -118,6 +256,18 @@ typedef struct adc_device_t
      */
     adc_dma_config_t dma;
 
+    /**
+     * @brief ADC analog watchdog (channel compare) interrupt
+     * @note only registered while the analog watchdog is running
+     */
+    adc_interrupt_config_t awd;
+
+    /**
+     * @brief ADC sequence B end of conversion interrupt
+     * @note only registered while a priority channel is enabled
+     */
+    adc_interrupt_config_t priority;
+
     /**
      * @brief ADC runtime state
      */
@@ -128,3 +278,4 @@ typedef struct adc_device_t
 // ADC devices
 //
 extern adc_device_t ADC1_device;
+extern adc_device_t ADC2_device;
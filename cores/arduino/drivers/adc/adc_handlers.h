@@ -0,0 +1,83 @@
+#pragma once
+#include "adc_config.h"
+#include "../../core_trace.h"
+#include "../../core_events.h"
+
+#define ADC_COUNT 2
+adc_device_t *ADCx[ADC_COUNT] = {
+    &ADC1_device,
+    &ADC2_device,
+};
+
+#define IS_VALID_ADCx(x) ((x) >= 1 && (x) <= ADC_COUNT)
+#define ASSERT_VALID_ADCx(x) static_assert(IS_VALID_ADCx(x), "ADC number must be between 1 and ADC_COUNT")
+
+template <uint8_t x>
+static void ADCx_dma_block_complete_irq(void)
+{
+    ASSERT_VALID_ADCx(x);
+    adc_device_t *adcx = ADCx[x - 1];
+
+    // the DMA flag must be cleared for the interrupt to stop, so keep the completion in the state
+    DMA_ClearIrqFlag(adcx->dma.register_base, adcx->dma.channel, BlkTrnCpltIrq);
+    adcx->state.conversion_completed = true;
+    adcx->state.conversion_count++;
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_ADC_DMA_COMPLETE, x, 0);
+
+    // transforms first, so the callback sees the new values
+    if (adcx->state.transforms != NULL)
+    {
+        adc_transforms_update(adcx);
+    }
+
+    if (adcx->state.conversion_completed_callback != NULL)
+    {
+        adcx->state.conversion_completed_callback(adcx);
+    }
+
+    core_events_set(adcx->state.conversion_completed_events);
+}
+
+template <uint8_t x>
+static void ADCx_awd_irq(void)
+{
+    ASSERT_VALID_ADCx(x);
+    adc_device_t *adcx = ADCx[x - 1];
+
+    // report every channel outside the window once, then stop checking it
+    // (otherwise, every following conversion would fire again)
+    uint32_t channels = adcx->state.awd_channels;
+    while (channels != 0)
+    {
+        const uint8_t channel = __builtin_ctz(channels);
+        const uint32_t mask = 1ul << channel;
+        channels &= ~mask;
+
+        if (ADC_GetAwdFlag(adcx->adc.register_base, mask) == Set)
+        {
+            ADC_ClrAwdChFlag(adcx->adc.register_base, mask);
+            ADC_DelAwdChannel(adcx->adc.register_base, mask);
+            adcx->state.awd_channels &= ~mask;
+
+            if (adcx->state.awd_callback != NULL)
+            {
+                adcx->state.awd_callback(adcx, channel);
+            }
+        }
+    }
+}
+
+template <uint8_t x>
+static void ADCx_priority_complete_irq(void)
+{
+    ASSERT_VALID_ADCx(x);
+    adc_device_t *adcx = ADCx[x - 1];
+
+    // sequence B results stay in the data registers, read with adc_priority_read_result()
+    ADC_ClrEocFlag(adcx->adc.register_base, ADC_SEQ_B);
+
+    if (adcx->state.priority_callback != NULL)
+    {
+        adcx->state.priority_callback(adcx);
+    }
+}
@@ -0,0 +1,76 @@
+#include "adc_transform.h"
+#include "adc.h"
+
+/**
+ * @brief gain of 1.0
+ */
+#define ADC_TRANSFORM_UNITY_GAIN 65536ul
+
+int32_t adc_lut_interpolate(const adc_lut_point_t *lut, const uint16_t size, const int32_t raw)
+{
+    if (raw <= lut[0].raw)
+    {
+        return lut[0].value;
+    }
+    if (raw >= lut[size - 1].raw)
+    {
+        return lut[size - 1].value;
+    }
+
+    // find the segment lut[lo].raw <= raw < lut[hi].raw
+    uint16_t lo = 0;
+    uint16_t hi = size - 1;
+    while (hi - lo > 1)
+    {
+        const uint16_t mid = lo + (hi - lo) / 2;
+        if (lut[mid].raw <= raw)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    const adc_lut_point_t &a = lut[lo];
+    const adc_lut_point_t &b = lut[hi];
+    return a.value + int32_t((int64_t(b.value - a.value) * (raw - a.raw)) / (b.raw - a.raw));
+}
+
+int32_t adc_transform_evaluate(const adc_channel_transform_t *transform, const uint16_t raw)
+{
+    const uint32_t gain = transform->gain != 0 ? transform->gain : ADC_TRANSFORM_UNITY_GAIN;
+    int32_t calibrated = int32_t(raw) + transform->offset;
+    if (gain != ADC_TRANSFORM_UNITY_GAIN)
+    {
+        calibrated = int32_t((int64_t(calibrated) * gain) >> 16);
+    }
+
+    if (transform->lut == NULL || transform->lut_size == 0)
+    {
+        return calibrated;
+    }
+
+    return adc_lut_interpolate(transform->lut, transform->lut_size, calibrated);
+}
+
+void adc_transforms_update(adc_device_t *device)
+{
+    // in continuous scan mode, the DMA completes a block every scan. only update once all samples were replaced
+    if (adc_is_continuous(device))
+    {
+        if (++device->state.transform_scan_count < device->init_params.sample_count)
+        {
+            return;
+        }
+        device->state.transform_scan_count = 0;
+    }
+
+    for (adc_channel_transform_t *transform = device->state.transforms; transform != NULL; transform = transform->next)
+    {
+        const uint16_t raw = adc_conversion_read_sum(device, transform->adc_channel) / device->init_params.sample_count;
+        transform->value = adc_transform_evaluate(transform, raw);
+        transform->sequence++;
+    }
+}
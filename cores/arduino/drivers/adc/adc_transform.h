@@ -0,0 +1,119 @@
+/**
+ * ADC result post-processing:
+ *
+ * a transform attached to a adc channel turns its raw conversion result into a calibrated, linearized value, e.g.
+ * a temperature from a thermistor. transforms are evaluated in the DMA block transfer complete interrupt, once per
+ * completed conversion (in continuous scan mode, once every init_params.sample_count scans, when all samples were
+ * replaced). consumers then just read transform->value, which costs nothing.
+ *
+ * each transform is evaluated as:
+ *
+ *   raw        = average of the channel's samples (see adc_conversion_read_result())
+ *   calibrated = (raw + offset) * gain / 65536
+ *   value      = lut != NULL ? linear interpolation of calibrated in lut : calibrated
+ *
+ * the lookup table is a list of (raw, value) points, sorted by ascending raw value. values outside the table are
+ * clamped to the first / last point. for a thermistor, the points are the ADC readings of the temperatures in the
+ * table; the table does not have to be evenly spaced.
+ */
+#pragma once
+#include <stdint.h>
+
+struct adc_device_t;
+
+/**
+ * @brief a point of a lookup table
+ */
+typedef struct adc_lut_point_t
+{
+    /**
+     * @brief calibrated conversion result
+     */
+    uint16_t raw;
+
+    /**
+     * @brief value at this conversion result
+     */
+    int32_t value;
+} adc_lut_point_t;
+
+/**
+ * @brief post-processing of the results of a adc channel
+ * @note owned by the caller, and must stay valid while attached (see adc_attach_transform())
+ */
+typedef struct adc_channel_transform_t
+{
+    /**
+     * @brief the adc channel
+     * @note set by adc_attach_transform()
+     */
+    uint8_t adc_channel;
+
+    /**
+     * @brief calibration offset, added to the raw result
+     */
+    int32_t offset;
+
+    /**
+     * @brief calibration gain, in 1/65536. 65536 == 1.0
+     * @note 0 is treated as 65536
+     */
+    uint32_t gain;
+
+    /**
+     * @brief lookup table, sorted by ascending raw value. NULL to skip linearization
+     */
+    const adc_lut_point_t *lut;
+    uint16_t lut_size;
+
+    /**
+     * @brief the transformed value of the latest conversion
+     * @note written by the DMA interrupt
+     */
+    volatile int32_t value;
+
+    /**
+     * @brief incremented every time value is updated
+     * @note compare to a previously read sequence to detect new values
+     */
+    volatile uint32_t sequence;
+
+    /**
+     * @brief next transform of the same adc device
+     * @note managed by the adc driver
+     */
+    struct adc_channel_transform_t *next;
+} adc_channel_transform_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief interpolate a value in a lookup table
+     * @param lut the lookup table, sorted by ascending raw value
+     * @param size number of points in the table. at least 1
+     * @param raw the value to look up
+     * @return the linearly interpolated value, clamped to the first and last point
+     */
+    int32_t adc_lut_interpolate(const adc_lut_point_t *lut, const uint16_t size, const int32_t raw);
+
+    /**
+     * @brief evaluate a transform for a raw conversion result
+     * @param transform the transform
+     * @param raw the raw conversion result
+     * @return the transformed value
+     */
+    int32_t adc_transform_evaluate(const adc_channel_transform_t *transform, const uint16_t raw);
+
+    /**
+     * @brief update all transforms attached to a adc device
+     * @param device the adc device
+     * @note called from the DMA block transfer complete interrupt
+     */
+    void adc_transforms_update(struct adc_device_t *device);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,134 @@
+#include "aos.h"
+#include "../../core_critical.h"
+
+// TRGSEL field of the trigger selection registers, and its value when no event is selected
+#define AOS_TRGSEL_MASK 0x1FFul
+#define AOS_TRGSEL_NONE 0x1FFul
+
+/**
+ * @brief offsets of the trigger selection registers, from the AOS register base
+ * @note DMA1_TRGSEL0 - DMA2_TRGSEL3 (0x14 - 0x30) are left to the DMA driver
+ */
+static const uint16_t target_offsets[AOS_TARGET_COUNT] = {
+    0x04, // DCU1_TRGSEL
+    0x08, // DCU2_TRGSEL
+    0x0C, // DCU3_TRGSEL
+    0x10, // DCU4_TRGSEL
+    0x34, // DMA_TRGSELRC
+    0x38, // TMR6_HTSSR1
+    0x3C, // TMR6_HTSSR2
+    0x40, // TMR0_HTSSR
+    0x44, // PEVNTTRGSR12
+    0x48, // PEVNTTRGSR34
+    0x4C, // TMRA_HTSSR0
+    0x50, // TMRA_HTSSR1
+    0x54, // OTS_TRG
+    0x58, // ADC1_ITRGSELR0
+    0x5C, // ADC1_ITRGSELR1
+    0x60, // ADC2_ITRGSELR0
+    0x64, // ADC2_ITRGSELR1
+};
+
+/**
+ * @brief owners of the targets, NULL if free
+ */
+static const char *owners[AOS_TARGET_COUNT] = {};
+
+/**
+ * @brief is the software event taken by aos_software_trigger_take()?
+ */
+static volatile bool software_trigger_taken = false;
+
+#define ASSERT_TARGET(target, fn, ...) \
+    CORE_ASSERT(uint32_t(target) < AOS_TARGET_COUNT, fn ": invalid AOS target", __VA_ARGS__)
+
+/**
+ * @brief get the trigger selection register of a target
+ */
+static inline volatile uint32_t *target_register(const aos_target_t target)
+{
+    return reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_AOS) + target_offsets[target]);
+}
+
+en_result_t _aos_claim(const aos_target_t target, const char *name)
+{
+    ASSERT_TARGET(target, "aos_claim", return ErrorInvalidParameter);
+
+    const uint32_t critical = core_critical_enter();
+    if (owners[target] != NULL && owners[target] != name)
+    {
+        core_critical_exit(critical);
+        return Error;
+    }
+
+    owners[target] = name;
+    core_critical_exit(critical);
+    return Ok;
+}
+
+en_result_t _aos_resign(const aos_target_t target, const char *name)
+{
+    ASSERT_TARGET(target, "aos_resign", return ErrorInvalidParameter);
+    if (owners[target] != name)
+    {
+        return Error;
+    }
+
+    aos_disconnect(target);
+    owners[target] = NULL;
+    return Ok;
+}
+
+const char *aos_get_owner(const aos_target_t target)
+{
+    ASSERT_TARGET(target, "aos_get_owner", return NULL);
+    return owners[target];
+}
+
+void aos_connect(const aos_target_t target, const en_event_src_t source)
+{
+    ASSERT_TARGET(target, "aos_connect", return);
+    CORE_ASSERT(owners[target] != NULL, "aos_connect: target not claimed", return);
+
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // keep the common trigger enable bits
+    volatile uint32_t *reg = target_register(target);
+    *reg = (*reg & ~AOS_TRGSEL_MASK) | (uint32_t(source) & AOS_TRGSEL_MASK);
+}
+
+void aos_disconnect(const aos_target_t target)
+{
+    ASSERT_TARGET(target, "aos_disconnect", return);
+
+    volatile uint32_t *reg = target_register(target);
+    *reg = (*reg & ~AOS_TRGSEL_MASK) | AOS_TRGSEL_NONE;
+}
+
+en_event_src_t aos_get_source(const aos_target_t target)
+{
+    ASSERT_TARGET(target, "aos_get_source", return EVT_MAX);
+
+    const uint32_t selected = *target_register(target) & AOS_TRGSEL_MASK;
+    return selected == AOS_TRGSEL_NONE ? EVT_MAX : static_cast<en_event_src_t>(selected);
+}
+
+void aos_software_trigger(void)
+{
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+    M4_AOS->INTSFTTRG = 1ul;
+}
+
+bool aos_software_trigger_take(void)
+{
+    const uint32_t critical = core_critical_enter();
+    const bool available = !software_trigger_taken;
+    software_trigger_taken = true;
+    core_critical_exit(critical);
+    return available;
+}
+
+void aos_software_trigger_give(void)
+{
+    software_trigger_taken = false;
+}
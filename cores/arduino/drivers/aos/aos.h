@@ -0,0 +1,185 @@
+/**
+ * AOS (automatic operation system) event routing:
+ *
+ * the AOS connects event sources (en_event_src_t, e.g. EVT_TMRA1_OVF) to trigger inputs of other peripherals,
+ * so that chains like "TimerA overflow -> ADC conversion -> DMA transfer" run entirely in hardware.
+ * every trigger input (target) selects one event source at a time.
+ *
+ * targets are claimed by an owner before they are connected, so conflicting uses of the same target are detected.
+ * the core claims the targets it uses itself (e.g. the ADC triggers used by adc_enable_hardware_trigger()).
+ *
+ * e.g. start a conversion of sequence A of ADC1 on every overflow of TimerA unit 1:
+ *
+ *   aos_claim(AOS_TARGET_ADC1_TRIGGER0, "my trigger");
+ *   aos_connect(AOS_TARGET_ADC1_TRIGGER0, EVT_TMRA1_OVF);
+ *   ADC_TriggerSrcCmd(M4_ADC1, ADC_SEQ_A, Enable); // with AdcTrgsel_TRGX0 configured
+ *
+ * the DMA channel triggers are not AOS targets here. they belong to the owner of the DMA channel,
+ * see dma_claim() and dma_set_trigger().
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include "../../core_debug.h"
+
+/**
+ * @brief AOS trigger inputs
+ */
+typedef enum aos_target_t
+{
+    AOS_TARGET_DCU1,
+    AOS_TARGET_DCU2,
+    AOS_TARGET_DCU3,
+    AOS_TARGET_DCU4,
+
+    /**
+     * @brief DMA channel reconfiguration trigger
+     */
+    AOS_TARGET_DMA_RECONFIG,
+
+    /**
+     * @brief Timer6 hardware trigger events 0 and 1
+     */
+    AOS_TARGET_TIMER6_0,
+    AOS_TARGET_TIMER6_1,
+
+    /**
+     * @brief Timer0 hardware trigger (start, stop, clear, capture)
+     */
+    AOS_TARGET_TIMER0,
+
+    /**
+     * @brief event port 1 and 2, and event port 3 and 4
+     */
+    AOS_TARGET_EVENT_PORT_1_2,
+    AOS_TARGET_EVENT_PORT_3_4,
+
+    /**
+     * @brief TimerA hardware count trigger (all units)
+     */
+    AOS_TARGET_TIMERA_COUNT,
+
+    /**
+     * @brief TimerA hardware start / stop / clear / capture trigger (all units)
+     */
+    AOS_TARGET_TIMERA_CONTROL,
+
+    /**
+     * @brief on-chip temperature sensor measurement start
+     */
+    AOS_TARGET_OTS,
+
+    /**
+     * @brief ADC internal triggers 0 and 1 of ADC1 and ADC2
+     * @note internal trigger 0 starts sequence A, internal trigger 1 starts sequence B
+     */
+    AOS_TARGET_ADC1_TRIGGER0,
+    AOS_TARGET_ADC1_TRIGGER1,
+    AOS_TARGET_ADC2_TRIGGER0,
+    AOS_TARGET_ADC2_TRIGGER1,
+
+    AOS_TARGET_COUNT,
+} aos_target_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    en_result_t _aos_claim(const aos_target_t target, const char *name);
+    en_result_t _aos_resign(const aos_target_t target, const char *name);
+
+#ifdef __CORE_DEBUG
+
+    /**
+     * @brief claim a AOS target
+     * @param target the target to claim
+     * @param name name of the owner
+     * @return Ok, or Error if the target is owned by someone else
+     * @note claiming a target again with the same name is Ok
+     */
+    inline en_result_t aos_claim(const aos_target_t target, const char *name)
+    {
+        if (_aos_claim(target, name) != Ok)
+        {
+            panic_begin();
+            panic_printf("AOS target %d claimed by %s is already in use", int(target), name);
+            panic_end();
+        }
+
+        CORE_DEBUG_PRINTF("AOS target %d claimed by %s\n", int(target), name);
+        return Ok;
+    }
+
+    /**
+     * @brief disconnect and release a claimed AOS target
+     * @param target the target to release
+     * @param name name of the owner
+     * @return Ok, or Error if the target is not owned by name
+     */
+    inline en_result_t aos_resign(const aos_target_t target, const char *name)
+    {
+        CORE_DEBUG_PRINTF("%s resigned AOS target %d\n", name, int(target));
+        if (_aos_resign(target, name) != Ok)
+        {
+            panic_begin();
+            panic_printf("AOS target resign failed for %s", name);
+            panic_end();
+        }
+
+        return Ok;
+    }
+
+#else
+#define aos_claim(target, name) _aos_claim(target, name)
+#define aos_resign(target, name) _aos_resign(target, name)
+#endif
+
+    /**
+     * @brief get the owner of a AOS target
+     * @return name of the owner, or NULL if the target is free
+     */
+    const char *aos_get_owner(const aos_target_t target);
+
+    /**
+     * @brief connect an event source to a claimed target
+     * @param target the target. must be claimed
+     * @param source the event source, e.g. EVT_TMRA1_OVF
+     * @note enables the AOS peripheral clock. the target peripheral must still be configured to use its trigger
+     */
+    void aos_connect(const aos_target_t target, const en_event_src_t source);
+
+    /**
+     * @brief disconnect a target from its event source
+     * @param target the target
+     */
+    void aos_disconnect(const aos_target_t target);
+
+    /**
+     * @brief get the event source a target is connected to
+     * @return the event source, or EVT_MAX if not connected
+     */
+    en_event_src_t aos_get_source(const aos_target_t target);
+
+    /**
+     * @brief raise the software event (EVT_AOS_STRG), e.g. to trigger a target by software
+     * @note every target and DMA channel waiting on EVT_AOS_STRG is triggered. see aos_software_trigger_take()
+     */
+    void aos_software_trigger(void);
+
+    /**
+     * @brief take the software event for exclusive use
+     * @return true if taken, false if it is in use by someone else
+     * @note a DMA channel triggered by EVT_AOS_STRG moves a block on every software event, no matter who raised it.
+     *       so only one software-triggered transfer may run at a time. take the event before starting the transfer,
+     *       and give it back once it is complete. may be called from an interrupt
+     */
+    bool aos_software_trigger_take(void);
+
+    /**
+     * @brief give back the software event taken with aos_software_trigger_take()
+     */
+    void aos_software_trigger_give(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,414 @@
+#include "can.h"
+#include "../irqn/irqn.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+#include <string.h>
+
+//
+// CAN registers, as offsets from the register base
+//
+#define CAN_RBUF 0x00ul
+#define CAN_TBUF 0x50ul
+#define CAN_CFG_STAT 0xA0ul
+#define CAN_TCMD 0xA1ul
+#define CAN_TCTRL 0xA2ul
+#define CAN_RCTRL 0xA3ul
+#define CAN_RTIE 0xA4ul
+#define CAN_RTIF 0xA5ul
+#define CAN_ERRINT 0xA6ul
+#define CAN_SBT 0xA8ul
+#define CAN_RECNT 0xB2ul
+#define CAN_TECNT 0xB3ul
+#define CAN_ACFCTRL 0xB4ul
+#define CAN_ACFEN 0xB6ul
+#define CAN_ACF 0xB8ul
+
+// frame layout in RBUF / TBUF: id word, control byte, data
+#define FRAME_ID 0x00ul
+#define FRAME_CONTROL 0x04ul
+#define FRAME_DATA 0x08ul
+#define CONTROL_DLC_MASK 0x0Fu
+#define CONTROL_RTR (1u << 6)
+#define CONTROL_IDE (1u << 7)
+
+// CFG_STAT
+#define CFG_STAT_BUSOFF (1u << 0)
+#define CFG_STAT_LBMI (1u << 5)
+#define CFG_STAT_LBME (1u << 6)
+#define CFG_STAT_RESET (1u << 7)
+
+// TCMD
+#define TCMD_TSALL (1u << 1)
+#define TCMD_LOM (1u << 6)
+#define TCMD_TBSEL (1u << 7)
+
+// TCTRL
+#define TCTRL_TSSTAT_MASK 0x3u
+#define TCTRL_TSSTAT_EMPTY 0x0u
+#define TCTRL_TSSTAT_FULL 0x3u
+#define TCTRL_TSNEXT (1u << 6)
+
+// RCTRL
+#define RCTRL_RSTAT_MASK 0x3u
+#define RCTRL_RREL (1u << 4)
+#define RCTRL_SACK (1u << 7)
+
+// RTIE / RTIF
+#define RTI_EI (1u << 1)
+#define RTI_TSI (1u << 2)
+#define RTI_RAFI (1u << 4)
+#define RTI_RFI (1u << 5)
+#define RTI_ROI (1u << 6)
+#define RTI_RI (1u << 7)
+
+// ERRINT
+#define ERRINT_EPASS (1u << 6)
+
+// SBT
+#define SBT_SEG1_POS 0
+#define SBT_SEG2_POS 8
+#define SBT_SJW_POS 16
+#define SBT_PRESC_POS 24
+
+// ACFCTRL / ACF
+#define ACFCTRL_SELMASK (1u << 5)
+#define ACF_AIDE (1ul << 29)
+#define ACF_AIDEE (1ul << 30)
+
+// bit timing: 8 - 25 time quanta per bit, sample point at 87.5 %
+#define CAN_MIN_TQ 8
+#define CAN_MAX_TQ 25
+#define CAN_MAX_PRESCALER 256
+
+static can_config_t config = {};
+static bool running = false;
+static IRQn_Type can_irqn;
+
+/**
+ * @brief is the STB being sent?
+ */
+static volatile bool transmitting = false;
+
+static volatile uint32_t overflows = 0;
+
+static inline volatile uint8_t &reg8(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint8_t *>(reinterpret_cast<uint32_t>(M4_CAN) + offset);
+}
+
+static inline volatile uint32_t &reg32(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_CAN) + offset);
+}
+
+/**
+ * @brief calculate the bit timing register for a bit rate
+ * @return false if the bit rate cannot be set exactly
+ */
+static bool calculate_bit_timing(const uint32_t bitrate, uint32_t &sbt)
+{
+    // prefer many time quanta per bit, for a finer sample point
+    for (uint32_t tq = CAN_MAX_TQ; tq >= CAN_MIN_TQ; tq--)
+    {
+        if ((CAN_CLOCK_FREQUENCY % (bitrate * tq)) != 0)
+        {
+            continue;
+        }
+
+        const uint32_t prescaler = CAN_CLOCK_FREQUENCY / (bitrate * tq);
+        if (prescaler < 1 || prescaler > CAN_MAX_PRESCALER)
+        {
+            continue;
+        }
+
+        // segment 1 includes the sync segment, and is set as length - 2. segment 2 and sjw as length - 1
+        const uint32_t seg1 = (tq * 7 + 4) / 8;
+        const uint32_t seg2 = tq - seg1;
+        const uint32_t sjw = seg2 < 4 ? seg2 : 4;
+        sbt = ((seg1 - 2) << SBT_SEG1_POS) |
+              ((seg2 - 1) << SBT_SEG2_POS) |
+              ((sjw - 1) << SBT_SJW_POS) |
+              ((prescaler - 1) << SBT_PRESC_POS);
+        return true;
+    }
+
+    return false;
+}
+
+static inline void enter_reset(void)
+{
+    reg8(CAN_CFG_STAT) |= CFG_STAT_RESET;
+}
+
+static inline void leave_reset(void)
+{
+    reg8(CAN_CFG_STAT) &= ~CFG_STAT_RESET;
+}
+
+/**
+ * @brief write the acceptance code and mask of a filter
+ * @note the controller must be in reset
+ */
+static void write_filter(const uint8_t index, const uint32_t code, const uint32_t hardware_mask)
+{
+    reg8(CAN_ACFCTRL) = index;
+    reg32(CAN_ACF) = code;
+    reg8(CAN_ACFCTRL) = index | ACFCTRL_SELMASK;
+    reg32(CAN_ACF) = hardware_mask;
+}
+
+//
+// frames
+//
+
+static void read_frame(can_frame_t &frame)
+{
+    const uint8_t control = reg8(CAN_RBUF + FRAME_CONTROL);
+    frame.extended = (control & CONTROL_IDE) != 0;
+    frame.rtr = (control & CONTROL_RTR) != 0;
+    frame.id = reg32(CAN_RBUF + FRAME_ID) & (frame.extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK);
+
+    const uint8_t dlc = control & CONTROL_DLC_MASK;
+    frame.length = dlc > 8 ? 8 : dlc;
+
+    const uint32_t data[2] = {reg32(CAN_RBUF + FRAME_DATA), reg32(CAN_RBUF + FRAME_DATA + 4)};
+    memcpy(frame.data, data, sizeof(frame.data));
+}
+
+static void write_frame(const can_frame_t &frame)
+{
+    const uint8_t length = frame.length > 8 ? 8 : frame.length;
+    reg32(CAN_TBUF + FRAME_ID) = frame.id & (frame.extended ? CAN_EXTENDED_ID_MASK : CAN_STANDARD_ID_MASK);
+    reg32(CAN_TBUF + FRAME_CONTROL) = length |
+                                      (frame.rtr ? CONTROL_RTR : 0u) |
+                                      (frame.extended ? CONTROL_IDE : 0u);
+
+    uint32_t data[2];
+    memcpy(data, frame.data, sizeof(data));
+    reg32(CAN_TBUF + FRAME_DATA) = data[0];
+    reg32(CAN_TBUF + FRAME_DATA + 4) = data[1];
+}
+
+/**
+ * @brief move all frames out of the receive FIFO
+ */
+static void drain_receive_fifo(void)
+{
+    while ((reg8(CAN_RCTRL) & RCTRL_RSTAT_MASK) != 0)
+    {
+        can_frame_t frame;
+        read_frame(frame);
+
+        // release the slot. the other bits keep their configuration
+        reg8(CAN_RCTRL) |= RCTRL_RREL;
+
+        if (config.receive != NULL)
+        {
+            config.receive(frame, config.param);
+        }
+    }
+}
+
+/**
+ * @brief fill the STB from the transmit callback, and start sending it
+ * @note must be called with the CAN interrupt unable to run
+ */
+static void fill_transmit_buffer(void)
+{
+    if (transmitting || config.transmit == NULL)
+    {
+        return;
+    }
+
+    bool filled = false;
+    can_frame_t frame;
+    while ((reg8(CAN_TCTRL) & TCTRL_TSSTAT_MASK) != TCTRL_TSSTAT_FULL && config.transmit(frame, config.param))
+    {
+        write_frame(frame);
+        reg8(CAN_TCTRL) |= TCTRL_TSNEXT;
+        filled = true;
+    }
+
+    if (filled)
+    {
+        // the action bits must only be written when intended, so they are not read back
+        reg8(CAN_TCMD) = (reg8(CAN_TCMD) & TCMD_LOM) | TCMD_TBSEL | TCMD_TSALL;
+        transmitting = true;
+    }
+}
+
+static void can_irq_handler(void)
+{
+    const uint8_t flags = reg8(CAN_RTIF);
+    reg8(CAN_RTIF) = flags;
+
+    const uint8_t errors = reg8(CAN_ERRINT);
+    reg8(CAN_ERRINT) = errors; // flags are cleared, enables written back unchanged
+
+    if ((flags & RTI_ROI) != 0)
+    {
+        overflows++;
+    }
+
+    if ((flags & (RTI_RI | RTI_RFI | RTI_RAFI | RTI_ROI)) != 0)
+    {
+        drain_receive_fifo();
+    }
+
+    // the STB was sent completely. after bus-off, it was cleared by the controller
+    if ((flags & RTI_TSI) != 0 ||
+        ((flags & RTI_EI) != 0 && (reg8(CAN_TCTRL) & TCTRL_TSSTAT_MASK) == TCTRL_TSSTAT_EMPTY))
+    {
+        transmitting = false;
+        fill_transmit_buffer();
+    }
+}
+
+//
+// public API
+//
+
+bool can_begin(const can_config_t *can_config)
+{
+    CORE_ASSERT(can_config != NULL, "can_begin: config is NULL", return false);
+    CORE_ASSERT(!running, "can_begin: already started", return false);
+
+    uint32_t sbt;
+    if (!calculate_bit_timing(can_config->bitrate, sbt))
+    {
+        CORE_DEBUG_PRINTF("can: bit rate %lu not possible with a %lu Hz CAN clock\n", can_config->bitrate, uint32_t(CAN_CLOCK_FREQUENCY));
+        return false;
+    }
+
+    config = *can_config;
+    transmitting = false;
+    overflows = 0;
+
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_CAN, Enable);
+    GPIO_SetFunc(config.tx, Func_Can1_Tx);
+    GPIO_SetFunc(config.rx, Func_Can1_Rx);
+
+    enter_reset();
+    reg32(CAN_SBT) = sbt;
+
+    // filter 0 accepts everything, the others are off
+    write_filter(0, 0, CAN_EXTENDED_ID_MASK);
+    reg8(CAN_ACFEN) = 1u << 0;
+
+    uint8_t cfg = 0;
+    uint8_t rctrl = 0;
+    switch (config.mode)
+    {
+    case CAN_MODE_LOOPBACK_INTERNAL:
+        cfg = CFG_STAT_LBMI;
+        break;
+    case CAN_MODE_LOOPBACK_EXTERNAL:
+        cfg = CFG_STAT_LBME;
+        rctrl = RCTRL_SACK;
+        break;
+    case CAN_MODE_LISTEN_ONLY:
+    case CAN_MODE_NORMAL:
+    default:
+        break;
+    }
+    reg8(CAN_CFG_STAT) = CFG_STAT_RESET | cfg;
+    leave_reset();
+
+    reg8(CAN_RCTRL) = rctrl;
+    reg8(CAN_TCMD) = TCMD_TBSEL | (config.mode == CAN_MODE_LISTEN_ONLY ? TCMD_LOM : 0u);
+    reg8(CAN_RTIF) = 0xFF;
+    reg8(CAN_RTIE) = RTI_RI | RTI_ROI | RTI_RFI | RTI_RAFI | RTI_TSI | RTI_EI;
+
+    irqn_aa_get(can_irqn, "CAN");
+    stc_irq_regi_conf_t irq_config = {
+        .enIntSrc = INT_CAN_INT,
+        .enIRQn = can_irqn,
+        .pfnCallback = can_irq_handler,
+    };
+    enIrqRegistration(&irq_config);
+    NVIC_ClearPendingIRQ(can_irqn);
+    NVIC_SetPriority(can_irqn, IRQ_PRIORITY_CAN);
+    NVIC_EnableIRQ(can_irqn);
+
+    running = true;
+    return true;
+}
+
+void can_end(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    reg8(CAN_RTIE) = 0;
+    enter_reset();
+
+    NVIC_DisableIRQ(can_irqn);
+    NVIC_ClearPendingIRQ(can_irqn);
+    enIrqResign(can_irqn);
+    irqn_aa_resign(can_irqn, "CAN");
+
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_CAN, Disable);
+    transmitting = false;
+    running = false;
+}
+
+bool can_set_filter(const uint8_t index, const uint32_t id, const uint32_t mask, const can_filter_type_t type)
+{
+    CORE_ASSERT(running, "can_set_filter: not started", return false);
+    CORE_ASSERT(index < CAN_FILTER_COUNT, "can_set_filter: invalid index", return false);
+
+    // in the hardware mask, set bits are ignored
+    uint32_t hardware_mask = ~mask & CAN_EXTENDED_ID_MASK;
+    if (type == CAN_FILTER_STANDARD)
+    {
+        hardware_mask = (~mask & CAN_STANDARD_ID_MASK) | ACF_AIDEE;
+    }
+    else if (type == CAN_FILTER_EXTENDED)
+    {
+        hardware_mask |= ACF_AIDEE | ACF_AIDE;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    enter_reset();
+    write_filter(index, id & mask & CAN_EXTENDED_ID_MASK, hardware_mask);
+    reg8(CAN_ACFEN) |= uint8_t(1u << index);
+    leave_reset();
+
+    // the reset cleared the STB
+    transmitting = false;
+    fill_transmit_buffer();
+    core_critical_exit(critical);
+    return true;
+}
+
+void can_disable_filter(const uint8_t index)
+{
+    CORE_ASSERT(running, "can_disable_filter: not started", return);
+    CORE_ASSERT(index < CAN_FILTER_COUNT, "can_disable_filter: invalid index", return);
+
+    // the filter enables can be changed outside of reset
+    reg8(CAN_ACFEN) &= uint8_t(~(1u << index));
+}
+
+void can_transmit_kick(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    fill_transmit_buffer();
+    core_critical_exit(critical);
+}
+
+void can_get_error_state(can_error_state_t &state)
+{
+    state.receive_errors = reg8(CAN_RECNT);
+    state.transmit_errors = reg8(CAN_TECNT);
+    state.passive = (reg8(CAN_ERRINT) & ERRINT_EPASS) != 0;
+    state.bus_off = (reg8(CAN_CFG_STAT) & CFG_STAT_BUSOFF) != 0;
+    state.overflows = overflows;
+}
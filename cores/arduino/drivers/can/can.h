@@ -0,0 +1,179 @@
+/**
+ * CAN 2.0B driver for the CAN controller:
+ *
+ * received frames pass the hardware acceptance filters and are stored in the receive FIFO of the controller. the
+ * CAN interrupt moves them out of the FIFO and hands each one to the receive callback, so only frames the
+ * application asked for ever reach the CPU.
+ *
+ * frames are sent from the secondary transmit buffer (STB), which holds multiple frames sent in order. when the
+ * STB was sent, the interrupt refills it from the transmit callback, so a queue of frames is sent back to back.
+ *
+ * the CAN clock is the external oscillator (XTAL), see CAN_CLOCK_FREQUENCY.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include "../gpio/gpio.h"
+
+#ifndef CAN_CLOCK_FREQUENCY
+/**
+ * @brief frequency of the CAN clock, in Hz
+ */
+#define CAN_CLOCK_FREQUENCY XTAL_VALUE
+#endif
+
+/**
+ * @brief number of hardware acceptance filters
+ */
+#define CAN_FILTER_COUNT 8
+
+/**
+ * @brief id masks for standard (11 bit) and extended (29 bit) ids
+ */
+#define CAN_STANDARD_ID_MASK 0x7FFul
+#define CAN_EXTENDED_ID_MASK 0x1FFFFFFFul
+
+/**
+ * @brief a CAN frame
+ */
+struct can_frame_t
+{
+    /**
+     * @brief the id. 11 bit for standard frames, 29 bit for extended frames
+     */
+    uint32_t id;
+
+    /**
+     * @brief is the id extended?
+     */
+    bool extended;
+
+    /**
+     * @brief is this a remote (request) frame?
+     */
+    bool rtr;
+
+    /**
+     * @brief number of data bytes, 0 - 8
+     */
+    uint8_t length;
+    uint8_t data[8];
+};
+
+/**
+ * @brief operating mode of the controller
+ */
+typedef enum can_mode_t
+{
+    CAN_MODE_NORMAL,
+    CAN_MODE_LISTEN_ONLY,       // receive only, frames are not acknowledged
+    CAN_MODE_LOOPBACK_INTERNAL, // sent frames are received back, and not sent on the bus
+    CAN_MODE_LOOPBACK_EXTERNAL, // sent frames are sent on the bus and received back, acknowledged by the controller itself
+} can_mode_t;
+
+/**
+ * @brief which frames a filter accepts, by id type
+ */
+typedef enum can_filter_type_t
+{
+    CAN_FILTER_STANDARD,
+    CAN_FILTER_EXTENDED,
+    CAN_FILTER_ANY,
+} can_filter_type_t;
+
+/**
+ * @brief called for every received frame
+ * @note called from the CAN interrupt
+ */
+typedef void (*can_receive_callback_t)(const can_frame_t &frame, void *param);
+
+/**
+ * @brief called to get the next frame to send
+ * @return false if there is no frame to send
+ * @note called from the CAN interrupt, and from can_transmit_kick()
+ */
+typedef bool (*can_transmit_callback_t)(can_frame_t &frame, void *param);
+
+/**
+ * @brief configuration of the controller
+ */
+struct can_config_t
+{
+    gpio_pin_t tx;
+    gpio_pin_t rx;
+
+    /**
+     * @brief the bit rate, e.g. 500000 or 1000000
+     */
+    uint32_t bitrate;
+
+    can_mode_t mode;
+
+    can_receive_callback_t receive;
+    can_transmit_callback_t transmit;
+    void *param;
+};
+
+/**
+ * @brief error state of the controller
+ */
+struct can_error_state_t
+{
+    uint8_t receive_errors;
+    uint8_t transmit_errors;
+    bool passive;
+    bool bus_off;
+
+    /**
+     * @brief number of receive FIFO overflows. at least one frame was lost in each
+     */
+    uint32_t overflows;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief start the controller
+     * @param config the configuration. copied
+     * @return false if the bit rate cannot be set from CAN_CLOCK_FREQUENCY
+     * @note on start, filter 0 accepts all frames. use can_set_filter() to narrow that down
+     */
+    bool can_begin(const can_config_t *config);
+
+    /**
+     * @brief stop the controller
+     */
+    void can_end(void);
+
+    /**
+     * @brief set an acceptance filter
+     * @param index the filter, 0 - CAN_FILTER_COUNT - 1
+     * @param id the id to accept
+     * @param mask id bits that must match. 0 accepts every id
+     * @param type the accepted id type
+     * @note a frame is accepted if any enabled filter accepts it. the controller is reset briefly, so frames
+     *       pending in the controller are dropped
+     */
+    bool can_set_filter(const uint8_t index, const uint32_t id, const uint32_t mask, const can_filter_type_t type);
+
+    /**
+     * @brief disable an acceptance filter
+     */
+    void can_disable_filter(const uint8_t index);
+
+    /**
+     * @brief start sending frames from the transmit callback, if the controller is not sending already
+     * @note call after frames were added to the queue of the transmit callback
+     */
+    void can_transmit_kick(void);
+
+    /**
+     * @brief get the error state of the controller
+     */
+    void can_get_error_state(can_error_state_t &state);
+
+#ifdef __cplusplus
+}
+#endif
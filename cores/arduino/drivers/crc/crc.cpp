@@ -0,0 +1,426 @@
+#include "crc.h"
+#include "../dma/dma.h"
+#include "../irqn/irq_priority.h"
+#include "../aos/aos.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+
+// CRC_CR bits
+#define CRC_CR_CRC32 (1ul << 1)
+#define CRC_CR_REFIN (1ul << 2)
+
+// the data registers DAT0 - DAT31, at offset 0x80 from the CRC register base.
+// all of them feed the same calculation, DAT0 is used by the driver
+#define CRC_DATA_ADDRESS (reinterpret_cast<uint32_t>(M4_CRC) + 0x80ul)
+
+// polynomials of the CRC unit
+#define CRC16_POLYNOMIAL 0x1021ul
+#define CRC32_POLYNOMIAL 0x04C11DB7ul
+
+// number of transfer units per block. the 10-bit block size stores 1024 as 0
+#define CRC_DMA_MAX_BLOCK_SIZE 1024
+
+// the transfer count register is 16 bits wide
+#define CRC_DMA_MAX_BLOCK_COUNT 0xFFFF
+
+const crc_algorithm_t CRC_ALGORITHM_CRC32 = {32, true, 0xFFFFFFFFul, 0xFFFFFFFFul};
+const crc_algorithm_t CRC_ALGORITHM_CRC32_MPEG2 = {32, false, 0xFFFFFFFFul, 0};
+const crc_algorithm_t CRC_ALGORITHM_CRC16_CCITT_FALSE = {16, false, 0xFFFF, 0};
+const crc_algorithm_t CRC_ALGORITHM_CRC16_XMODEM = {16, false, 0, 0};
+const crc_algorithm_t CRC_ALGORITHM_CRC16_KERMIT = {16, true, 0, 0};
+const crc_algorithm_t CRC_ALGORITHM_CRC16_X25 = {16, true, 0xFFFF, 0xFFFF};
+
+/**
+ * @brief state of the DMA calculation
+ */
+struct crc_dma_engine_t
+{
+    /**
+     * @brief the auto-assigned channel. unit is NULL until first use
+     */
+    dma_channel_t channel;
+
+    /**
+     * @brief transfer width, as shift of the unit size: 0 = 8 bit, 2 = 32 bit
+     */
+    uint8_t width_shift;
+
+    /**
+     * @brief remaining blocks of the current phase
+     */
+    uint16_t blocks_left;
+
+    /**
+     * @brief units transferred by the current phase
+     */
+    uint32_t phase_units;
+
+    /**
+     * @brief units not yet transferred, including the current phase
+     */
+    uint32_t remaining_units;
+
+    const uint8_t *src;
+
+    /**
+     * @brief bytes after the last full unit, fed by the CPU once the DMA is done
+     */
+    size_t tail_length;
+
+    crc_context_t *context;
+    crc_callback_t callback;
+    void *param;
+};
+
+/**
+ * @brief is the CRC unit used by a DMA calculation?
+ * @note while set, crc_update() runs on the CPU
+ */
+static volatile bool hardware_busy = false;
+
+static crc_dma_engine_t engine = {};
+
+#define ASSERT_CONTEXT(context, fn, ...) \
+    CORE_ASSERT(context.algorithm != NULL, fn ": context not initialized", __VA_ARGS__)
+
+static inline volatile uint8_t &data_register8()
+{
+    return *reinterpret_cast<volatile uint8_t *>(CRC_DATA_ADDRESS);
+}
+
+static inline volatile uint32_t &data_register32()
+{
+    return *reinterpret_cast<volatile uint32_t *>(CRC_DATA_ADDRESS);
+}
+
+/**
+ * @brief configure the CRC unit for an algorithm, and load the CRC register
+ * @note output reflection and final xor are never done by the hardware, so the CRC register can be saved
+ *       and restored at any time. crc_final() applies them
+ */
+static inline void hardware_load(const crc_algorithm_t &algorithm, const uint32_t state)
+{
+    M4_CRC->CR = (algorithm.width == 32 ? CRC_CR_CRC32 : 0ul) | (algorithm.reflect ? CRC_CR_REFIN : 0ul);
+    M4_CRC->RESLT = state;
+}
+
+static inline uint32_t hardware_save(const crc_algorithm_t &algorithm)
+{
+    return algorithm.width == 32 ? M4_CRC->RESLT : (M4_CRC->RESLT & 0xFFFFul);
+}
+
+/**
+ * @brief feed bytes to the CRC unit
+ * @note with input reflection, the bytes of a word are processed LSB first, so words are written as they are.
+ *       without, MSB first, so words are byte-swapped to keep the byte order of the buffer
+ */
+static void hardware_feed(const crc_algorithm_t &algorithm, const uint8_t *data, size_t length)
+{
+    while (length > 0 && (reinterpret_cast<uint32_t>(data) & 3) != 0)
+    {
+        data_register8() = *data++;
+        length--;
+    }
+
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(data);
+    if (algorithm.reflect)
+    {
+        for (; length >= 4; length -= 4)
+        {
+            data_register32() = *words++;
+        }
+    }
+    else
+    {
+        for (; length >= 4; length -= 4)
+        {
+            data_register32() = __REV(*words++);
+        }
+    }
+
+    data = reinterpret_cast<const uint8_t *>(words);
+    while (length-- > 0)
+    {
+        data_register8() = *data++;
+    }
+}
+
+/**
+ * @brief calculate the CRC on the CPU, while the CRC unit is busy
+ */
+static uint32_t software_update(const crc_algorithm_t &algorithm, uint32_t state, const uint8_t *data, size_t length)
+{
+    const uint32_t polynomial = algorithm.width == 32 ? CRC32_POLYNOMIAL : CRC16_POLYNOMIAL;
+    const uint32_t top_bit = 1ul << (algorithm.width - 1);
+    const uint32_t mask = algorithm.width == 32 ? 0xFFFFFFFFul : 0xFFFFul;
+
+    while (length-- > 0)
+    {
+        const uint32_t byte = algorithm.reflect ? (__RBIT(*data++) >> 24) : *data++;
+        state ^= byte << (algorithm.width - 8);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            state = (state & top_bit) != 0 ? ((state << 1) ^ polynomial) : (state << 1);
+        }
+        state &= mask;
+    }
+
+    return state;
+}
+
+void crc_begin(crc_context_t &context, const crc_algorithm_t &algorithm)
+{
+    CORE_ASSERT(algorithm.width == 16 || algorithm.width == 32, "crc_begin: width must be 16 or 32", return);
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_CRC, Enable);
+
+    context.algorithm = &algorithm;
+    context.state = algorithm.init;
+}
+
+void crc_update(crc_context_t &context, const void *data, const size_t length)
+{
+    ASSERT_CONTEXT(context, "crc_update", return);
+    const crc_algorithm_t &algorithm = *context.algorithm;
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    size_t remaining = length;
+    while (remaining > 0)
+    {
+        const size_t chunk = remaining < CRC_CHUNK_SIZE ? remaining : CRC_CHUNK_SIZE;
+
+        const uint32_t critical = core_critical_enter();
+        if (hardware_busy)
+        {
+            core_critical_exit(critical);
+            context.state = software_update(algorithm, context.state, bytes, remaining);
+            return;
+        }
+
+        hardware_load(algorithm, context.state);
+        hardware_feed(algorithm, bytes, chunk);
+        context.state = hardware_save(algorithm);
+        core_critical_exit(critical);
+
+        bytes += chunk;
+        remaining -= chunk;
+    }
+}
+
+uint32_t crc_final(const crc_context_t &context)
+{
+    ASSERT_CONTEXT(context, "crc_final", return 0);
+    const crc_algorithm_t &algorithm = *context.algorithm;
+
+    uint32_t result = context.state;
+    if (algorithm.reflect)
+    {
+        result = __RBIT(result) >> (32 - algorithm.width);
+    }
+
+    return result ^ algorithm.xor_out;
+}
+
+uint32_t crc_calculate(const crc_algorithm_t &algorithm, const void *data, const size_t length)
+{
+    crc_context_t context;
+    crc_begin(context, algorithm);
+    crc_update(context, data, length);
+    return crc_final(context);
+}
+
+/**
+ * @brief start the next phase of a DMA calculation
+ * @note a phase moves as many full blocks as possible. the remainder of less than a block is a second phase
+ */
+static void engine_start_phase()
+{
+    const uint32_t block = engine.remaining_units < CRC_DMA_MAX_BLOCK_SIZE ? engine.remaining_units : CRC_DMA_MAX_BLOCK_SIZE;
+    uint32_t blocks = engine.remaining_units / block;
+    if (blocks > CRC_DMA_MAX_BLOCK_COUNT)
+    {
+        blocks = CRC_DMA_MAX_BLOCK_COUNT;
+    }
+
+    engine.blocks_left = uint16_t(blocks);
+    engine.phase_units = block * blocks;
+
+    stc_dma_config_t config = {
+        .u16BlockSize = uint16_t(block),
+        .u16TransferCnt = uint16_t(blocks),
+        .u32SrcAddr = (uint32_t)(engine.src),
+        .u32DesAddr = CRC_DATA_ADDRESS,
+        .u16SrcRptSize = 0,
+        .u16DesRptSize = 0,
+        .stcDmaChCfg = {
+            .enSrcInc = AddressIncrease,
+            .enDesInc = AddressFix,
+            .enSrcRptEn = Disable,
+            .enDesRptEn = Disable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = en_dma_transfer_width_t(engine.width_shift), // Dma8Bit, Dma32Bit
+            .enLlpEn = Disable,
+            .enIntEn = Enable,
+        },
+    };
+
+    dma_init(engine.channel, &config, EVT_AOS_STRG);
+    dma_start(engine.channel);
+    aos_software_trigger();
+}
+
+/**
+ * @brief block transfer complete callback
+ * @note each software trigger moves one block, so the next block is triggered from here
+ */
+static void engine_block_complete(const dma_channel_t &channel, void *)
+{
+    if (--engine.blocks_left > 0)
+    {
+        aos_software_trigger();
+        return;
+    }
+
+    // phase complete
+    engine.src += engine.phase_units << engine.width_shift;
+    engine.remaining_units -= engine.phase_units;
+    if (engine.remaining_units > 0)
+    {
+        engine_start_phase();
+        return;
+    }
+
+    dma_stop(channel);
+
+    // the CPU feeds the bytes that do not fill a whole unit
+    crc_context_t &context = *engine.context;
+    hardware_feed(*context.algorithm, engine.src, engine.tail_length);
+    context.state = hardware_save(*context.algorithm);
+
+    // release the CRC unit before calling back, so the callback may start the next calculation
+    const crc_callback_t callback = engine.callback;
+    void *const callback_param = engine.param;
+    aos_software_trigger_give();
+    hardware_busy = false;
+
+    if (callback != NULL)
+    {
+        callback(callback_param);
+    }
+}
+
+/**
+ * @brief start a calculation on the DMA
+ * @return false if the DMA cannot be used, nothing was done then
+ */
+static bool engine_start(crc_context_t &context, const void *data, const size_t length, crc_callback_t callback, void *param)
+{
+    if (length < CRC_DMA_MIN_SIZE)
+    {
+        return false;
+    }
+
+    // the CRC unit may also be taken by an interrupt calling crc_update(), so claim it with interrupts disabled
+    const uint32_t critical = core_critical_enter();
+    const bool available = !hardware_busy;
+    hardware_busy = true;
+    core_critical_exit(critical);
+
+    if (!available)
+    {
+        return false;
+    }
+
+    // the software trigger may be in use by another DMA transfer, e.g. dma_memcpy_async()
+    if (!aos_software_trigger_take())
+    {
+        hardware_busy = false;
+        return false;
+    }
+
+    // assign the channel on first use, and keep it
+    if (engine.channel.unit == NULL)
+    {
+        if (_dma_aa_get(engine.channel, "crc") != Ok)
+        {
+            engine.channel.unit = NULL;
+            aos_software_trigger_give();
+            hardware_busy = false;
+            return false;
+        }
+
+        dma_set_callback(engine.channel, BlkTrnCpltIrq, engine_block_complete, NULL, IRQ_PRIORITY_DMA);
+    }
+
+    const crc_algorithm_t &algorithm = *context.algorithm;
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    size_t remaining = length;
+
+    // without input reflection, words would have to be byte-swapped, which the DMA cannot do
+    engine.width_shift = algorithm.reflect ? 2 : 0;
+    hardware_load(algorithm, context.state);
+
+    // the CPU feeds the bytes up to the first word boundary
+    if (engine.width_shift != 0)
+    {
+        const size_t head = (4 - (reinterpret_cast<uint32_t>(bytes) & 3)) & 3;
+        hardware_feed(algorithm, bytes, head);
+        bytes += head;
+        remaining -= head;
+    }
+
+    engine.context = &context;
+    engine.callback = callback;
+    engine.param = param;
+    engine.src = bytes;
+    engine.remaining_units = remaining >> engine.width_shift;
+    engine.tail_length = remaining & ((1u << engine.width_shift) - 1);
+
+    engine_start_phase();
+    return true;
+}
+
+bool crc_update_dma_async(crc_context_t &context, const void *data, const size_t length, crc_callback_t callback, void *param)
+{
+    ASSERT_CONTEXT(context, "crc_update_dma_async", return false);
+    if (engine_start(context, data, length, callback, param))
+    {
+        return true;
+    }
+
+    crc_update(context, data, length);
+    if (callback != NULL)
+    {
+        callback(param);
+    }
+    return false;
+}
+
+/**
+ * @brief can the caller wait for the DMA interrupt?
+ * @note not in an interrupt handler, and not with interrupts disabled or masked by a critical section
+ */
+static inline bool can_wait_for_dma(void)
+{
+    return __get_IPSR() == 0 && __get_PRIMASK() == 0 && __get_BASEPRI() == 0;
+}
+
+static void set_done_flag(void *param)
+{
+    *static_cast<volatile bool *>(param) = true;
+}
+
+void crc_update_dma(crc_context_t &context, const void *data, const size_t length)
+{
+    ASSERT_CONTEXT(context, "crc_update_dma", return);
+
+    volatile bool done = false;
+    if (!can_wait_for_dma() || !engine_start(context, data, length, set_done_flag, (void *)&done))
+    {
+        crc_update(context, data, length);
+        return;
+    }
+
+    while (!done)
+        ;
+}
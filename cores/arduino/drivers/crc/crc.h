@@ -0,0 +1,181 @@
+/**
+ * CRC16 / CRC32 calculation using the CRC peripheral:
+ *
+ * the CRC unit implements the CRC16 polynomial 0x1021 (CCITT) and the CRC32 polynomial 0x04C11DB7.
+ * init value, input / output reflection and final xor are configurable, so most CRC16-CCITT and CRC32 variants
+ * are supported. presets for the common ones are provided, e.g. CRC_ALGORITHM_CRC32 (as used by zlib and ethernet).
+ *
+ * a calculation is kept in a context, so multiple calculations can be streamed at the same time:
+ *
+ *   crc_context_t crc;
+ *   crc_begin(crc, CRC_ALGORITHM_CRC32);
+ *   crc_update(crc, header, sizeof(header));
+ *   crc_update(crc, payload, payload_length);
+ *   const uint32_t checksum = crc_final(crc);
+ *
+ * larger buffers can be fed to the CRC unit by DMA, see crc_update_dma_async().
+ *
+ * crc_update() may be called from interrupts as well. the CRC unit state is saved to the context after every
+ * CRC_CHUNK_SIZE bytes, with interrupts disabled in between. while a DMA calculation uses the CRC unit, other
+ * calculations run on the CPU.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include <stddef.h>
+
+#ifndef CRC_CHUNK_SIZE
+/**
+ * @brief maximum number of bytes fed to the CRC unit with interrupts disabled
+ */
+#define CRC_CHUNK_SIZE 64
+#endif
+
+#ifndef CRC_DMA_MIN_SIZE
+/**
+ * @brief calculations over less bytes than this always run on the CPU, even if DMA was requested
+ */
+#define CRC_DMA_MIN_SIZE 128
+#endif
+
+/**
+ * @brief parameters of a CRC algorithm, in the usual (Rocksoft) notation
+ * @note the polynomial is fixed by the width: 0x1021 for 16 bit, 0x04C11DB7 for 32 bit
+ */
+struct crc_algorithm_t
+{
+    /**
+     * @brief width of the CRC, 16 or 32 bit
+     */
+    uint8_t width;
+
+    /**
+     * @brief reflect the input bytes and the result?
+     */
+    bool reflect;
+
+    /**
+     * @brief initial value of the CRC register
+     */
+    uint32_t init;
+
+    /**
+     * @brief value the result is xor'ed with
+     */
+    uint32_t xor_out;
+};
+
+/**
+ * @brief state of a CRC calculation
+ */
+struct crc_context_t
+{
+    /**
+     * @brief the algorithm, set by crc_begin()
+     */
+    const crc_algorithm_t *algorithm;
+
+    /**
+     * @brief current value of the CRC register, without output reflection and final xor
+     */
+    uint32_t state;
+};
+
+/**
+ * @brief DMA CRC completion callback
+ * @param param the parameter passed to crc_update_dma_async()
+ * @note called from the DMA interrupt, or directly from the caller if the calculation ran on the CPU
+ */
+typedef void (*crc_callback_t)(void *param);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief CRC-32 (zlib, ethernet, PNG). check value 0xCBF43926
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC32;
+
+    /**
+     * @brief CRC-32/MPEG-2. check value 0x0376E6E7
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC32_MPEG2;
+
+    /**
+     * @brief CRC-16/CCITT-FALSE. check value 0x29B1
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC16_CCITT_FALSE;
+
+    /**
+     * @brief CRC-16/XMODEM. check value 0x31C3
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC16_XMODEM;
+
+    /**
+     * @brief CRC-16/KERMIT. check value 0x2189
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC16_KERMIT;
+
+    /**
+     * @brief CRC-16/X-25. check value 0x906E
+     */
+    extern const crc_algorithm_t CRC_ALGORITHM_CRC16_X25;
+
+    /**
+     * @brief start a CRC calculation
+     * @param context the context to initialize
+     * @param algorithm the algorithm. must stay valid while the context is used
+     * @note enables the CRC peripheral clock
+     */
+    void crc_begin(crc_context_t &context, const crc_algorithm_t &algorithm);
+
+    /**
+     * @brief add data to a CRC calculation
+     * @param context the context
+     * @param data the data
+     * @param length number of bytes
+     */
+    void crc_update(crc_context_t &context, const void *data, const size_t length);
+
+    /**
+     * @brief get the result of a CRC calculation
+     * @param context the context
+     * @return the CRC of all data added since crc_begin()
+     * @note the calculation can be continued afterwards
+     */
+    uint32_t crc_final(const crc_context_t &context);
+
+    /**
+     * @brief calculate the CRC of a buffer
+     * @param algorithm the algorithm
+     * @param data the data
+     * @param length number of bytes
+     * @return the CRC
+     */
+    uint32_t crc_calculate(const crc_algorithm_t &algorithm, const void *data, const size_t length);
+
+    /**
+     * @brief add data to a CRC calculation in the background, using DMA
+     * @param context the context. must not be used until the callback was called
+     * @param data the data. must not be modified until the callback was called
+     * @param length number of bytes
+     * @param callback called once the data was added. may be NULL
+     * @param param parameter passed to the callback
+     * @return true if the calculation runs on the DMA, false if it was done on the CPU before returning
+     * @note a DMA channel is auto-assigned on first use and kept. only one DMA calculation runs at a time
+     * @note reflected algorithms are fed using 32-bit transfers, others using 8-bit transfers
+     * @note the DMA is triggered through the AOS software trigger, taken with aos_software_trigger_take() for the
+     *       duration of the calculation. while it is in use, e.g. by dma_memcpy_async(), the calculation runs on the CPU
+     */
+    bool crc_update_dma_async(crc_context_t &context, const void *data, const size_t length, crc_callback_t callback, void *param);
+
+    /**
+     * @brief add data to a CRC calculation using DMA, and wait for it to complete
+     * @note see crc_update_dma_async(). runs on the CPU if called from an interrupt or with interrupts disabled
+     */
+    void crc_update_dma(crc_context_t &context, const void *data, const size_t length);
+
+#ifdef __cplusplus
+}
+#endif
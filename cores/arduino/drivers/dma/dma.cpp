@@ -0,0 +1,466 @@
+#include "dma.h"
+#include "../irqn/irqn.h"
+#include "../../core_critical.h"
+
+// channel registers SARx - CHxCTL start at offset 0x40, one block of 0x40 bytes per channel
+#define DMA_CHANNEL_REGS_OFFSET 0x40
+#define DMA_CHANNEL_REGS_STRIDE 0x40
+
+// CHxCTL bit positions
+#define DMA_CHCTL_SINC_POS 0
+#define DMA_CHCTL_DINC_POS 2
+#define DMA_CHCTL_SRPTEN_POS 4
+#define DMA_CHCTL_DRPTEN_POS 5
+#define DMA_CHCTL_SNSEQEN_POS 6
+#define DMA_CHCTL_DNSEQEN_POS 7
+#define DMA_CHCTL_HSIZE_POS 8
+#define DMA_CHCTL_LLPEN_POS 10
+#define DMA_CHCTL_LLPRUN_POS 11
+#define DMA_CHCTL_IE_POS 12
+
+// number of completion interrupts per channel: transfer complete and block transfer complete
+#define DMA_IRQ_COUNT 2
+
+/**
+ * @brief state of a DMA channel
+ */
+struct dma_channel_state_t
+{
+    /**
+     * @brief name of the owner, NULL if the channel is free
+     */
+    const char *owner;
+
+    /**
+     * @brief completion callbacks and their parameters, by irq slot
+     */
+    dma_callback_t callback[DMA_IRQ_COUNT];
+    void *param[DMA_IRQ_COUNT];
+
+    /**
+     * @brief auto-assigned IRQn of the completion interrupts, by irq slot
+     * @note only valid while a callback is set
+     */
+    IRQn_Type irqn[DMA_IRQ_COUNT];
+};
+
+static dma_channel_state_t dma_channels[DMA_CHANNEL_COUNT] = {};
+
+/**
+ * @brief bit of a fixed channel assignment, by DMA unit (1 or 2) and channel number
+ */
+#define DMA_FIXED_CHANNEL(unit, ch) (1u << ((((unit) - 1) * DMA_CHANNELS_PER_UNIT) + (ch)))
+
+/**
+ * @brief channels assigned at compile time, by channel index
+ * @note these are reserved from the start and never auto-assigned, so their drivers can claim
+ *       them later than any auto-assigned user. must match usart_config.cpp, adc_config.cpp and spi_config.cpp
+ */
+static const uint32_t dma_fixed_channels = 0
+#ifdef USART1_TX_DMA
+                                           | DMA_FIXED_CHANNEL(2, 0)
+#endif
+#ifdef USART1_RX_DMA
+                                           | DMA_FIXED_CHANNEL(1, 0)
+#endif
+#ifdef USART2_TX_DMA
+                                           | DMA_FIXED_CHANNEL(2, 1)
+#endif
+#ifdef USART2_RX_DMA
+                                           | DMA_FIXED_CHANNEL(1, 2)
+#endif
+#ifdef USART3_TX_DMA
+                                           | DMA_FIXED_CHANNEL(2, 2)
+#endif
+#ifdef USART3_RX_DMA
+                                           | DMA_FIXED_CHANNEL(1, 3)
+#endif
+#ifdef USART4_TX_DMA
+                                           | DMA_FIXED_CHANNEL(2, 3)
+#endif
+#ifdef CORE_ADC_BALANCE_CHANNELS
+                                           | DMA_FIXED_CHANNEL(2, 3) // ADC2
+#endif
+#ifdef SPI1_DMA
+                                           | DMA_FIXED_CHANNEL(1, 2) | DMA_FIXED_CHANNEL(1, 3)
+#endif
+#ifdef SPI2_DMA
+                                           | DMA_FIXED_CHANNEL(2, 0) | DMA_FIXED_CHANNEL(2, 1)
+#endif
+#ifdef SPI3_DMA
+                                           | DMA_FIXED_CHANNEL(2, 2) | DMA_FIXED_CHANNEL(2, 3)
+#endif
+                                           | DMA_FIXED_CHANNEL(1, 1); // ADC1
+
+/**
+ * @brief interrupt sources of the completion interrupts, by irq slot and channel index
+ */
+static const en_int_src_t dma_interrupt_sources[DMA_IRQ_COUNT][DMA_CHANNEL_COUNT] = {
+    {INT_DMA1_TC0, INT_DMA1_TC1, INT_DMA1_TC2, INT_DMA1_TC3, INT_DMA2_TC0, INT_DMA2_TC1, INT_DMA2_TC2, INT_DMA2_TC3},
+    {INT_DMA1_BTC0, INT_DMA1_BTC1, INT_DMA1_BTC2, INT_DMA1_BTC3, INT_DMA2_BTC0, INT_DMA2_BTC1, INT_DMA2_BTC2, INT_DMA2_BTC3},
+};
+
+/**
+ * @brief translate a channel index to a DMA channel
+ */
+inline dma_channel_t dma_index_to_channel(const size_t index)
+{
+    return {
+        .unit = index < DMA_CHANNELS_PER_UNIT ? M4_DMA1 : M4_DMA2,
+        .channel = en_dma_channel_t(index % DMA_CHANNELS_PER_UNIT),
+    };
+}
+
+/**
+ * @brief translate a DMA channel to its channel index
+ */
+inline size_t dma_channel_to_index(const dma_channel_t &channel)
+{
+    CORE_ASSERT(channel.unit == M4_DMA1 || channel.unit == M4_DMA2, "invalid DMA unit");
+    CORE_ASSERT(channel.channel < DMA_CHANNELS_PER_UNIT, "invalid DMA channel");
+    return (channel.unit == M4_DMA1 ? 0 : DMA_CHANNELS_PER_UNIT) + size_t(channel.channel);
+}
+
+/**
+ * @brief translate a completion interrupt to its irq slot
+ */
+inline size_t dma_irq_to_slot(const en_dma_irq_sel_t irq)
+{
+    CORE_ASSERT(irq == TrnCpltIrq || irq == BlkTrnCpltIrq, "DMA callbacks only support TrnCpltIrq and BlkTrnCpltIrq");
+    return irq == TrnCpltIrq ? 0 : 1;
+}
+
+/**
+ * @brief common handler of all completion interrupts
+ */
+template <size_t index, en_dma_irq_sel_t irq>
+static void dma_irq_handler(void)
+{
+    const dma_channel_t channel = dma_index_to_channel(index);
+    DMA_ClearIrqFlag(channel.unit, channel.channel, irq);
+
+    const size_t slot = irq == TrnCpltIrq ? 0 : 1;
+    const dma_callback_t callback = dma_channels[index].callback[slot];
+    if (callback != NULL)
+    {
+        callback(channel, dma_channels[index].param[slot]);
+    }
+}
+
+#define DMA_IRQ_HANDLERS(irq)                                                                  \
+    {                                                                                          \
+        dma_irq_handler<0, irq>, dma_irq_handler<1, irq>, dma_irq_handler<2, irq>,             \
+            dma_irq_handler<3, irq>, dma_irq_handler<4, irq>, dma_irq_handler<5, irq>,         \
+            dma_irq_handler<6, irq>, dma_irq_handler<7, irq>,                                  \
+    }
+
+/**
+ * @brief handlers of the completion interrupts, by irq slot and channel index
+ */
+static const func_ptr_t dma_interrupt_handlers[DMA_IRQ_COUNT][DMA_CHANNEL_COUNT] = {
+    DMA_IRQ_HANDLERS(TrnCpltIrq),
+    DMA_IRQ_HANDLERS(BlkTrnCpltIrq),
+};
+
+/**
+ * @brief get the FCG0 clock id of a DMA unit
+ */
+inline uint32_t dma_unit_clock_id(const M4_DMA_TypeDef *unit)
+{
+    return unit == M4_DMA1 ? PWC_FCG0_PERIPH_DMA1 : PWC_FCG0_PERIPH_DMA2;
+}
+
+//
+// channel ownership
+//
+en_result_t _dma_aa_get(dma_channel_t &channel, const char *name)
+{
+    const uint32_t critical = core_critical_enter();
+
+    // hand out from the end, but never a channel with a fixed assignment
+    for (size_t i = DMA_CHANNEL_COUNT; i > 0; i--)
+    {
+        dma_channel_state_t &state = dma_channels[i - 1];
+        if (state.owner == NULL && (dma_fixed_channels & (1u << (i - 1))) == 0)
+        {
+            state.owner = name;
+            core_critical_exit(critical);
+
+            channel = dma_index_to_channel(i - 1);
+            return Ok;
+        }
+    }
+
+    core_critical_exit(critical);
+    return Error;
+}
+
+en_result_t _dma_claim(const dma_channel_t &channel, const char *name)
+{
+    dma_channel_state_t &state = dma_channels[dma_channel_to_index(channel)];
+
+    const uint32_t critical = core_critical_enter();
+    if (state.owner != NULL)
+    {
+        core_critical_exit(critical);
+        return Error;
+    }
+
+    state.owner = name;
+    core_critical_exit(critical);
+    return Ok;
+}
+
+en_result_t _dma_resign(dma_channel_t &channel)
+{
+    const size_t index = dma_channel_to_index(channel);
+    if (dma_channels[index].owner == NULL)
+    {
+        return Error;
+    }
+
+    // stop the channel and remove all callbacks before it can be handed out again
+    dma_stop(channel);
+    dma_set_callback(channel, TrnCpltIrq, NULL, NULL, 0);
+    dma_set_callback(channel, BlkTrnCpltIrq, NULL, NULL, 0);
+
+    dma_channels[index].owner = NULL;
+    channel.unit = NULL;
+    return Ok;
+}
+
+const char *dma_get_owner(const dma_channel_t &channel)
+{
+    return dma_channels[dma_channel_to_index(channel)].owner;
+}
+
+//
+// channel control
+//
+void dma_init(const dma_channel_t &channel, const stc_dma_config_t *config, const en_event_src_t trigger)
+{
+    CORE_ASSERT(dma_get_owner(channel) != NULL, "dma_init() channel not claimed", return);
+
+    // enable DMA unit clock
+    PWC_Fcg0PeriphClockCmd(dma_unit_clock_id(channel.unit), Enable);
+
+    // initialize the channel, but keep it disabled until started
+    DMA_InitChannel(channel.unit, channel.channel, config);
+    DMA_Cmd(channel.unit, Enable);
+    DMA_ChannelCmd(channel.unit, channel.channel, Disable);
+
+    // clear completion flags
+    DMA_ClearIrqFlag(channel.unit, channel.channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(channel.unit, channel.channel, BlkTrnCpltIrq);
+
+    dma_set_trigger(channel, trigger);
+}
+
+void dma_set_trigger(const dma_channel_t &channel, const en_event_src_t trigger)
+{
+    // AOS is required to trigger DMA transfer, enable AOS peripheral clock
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+    DMA_SetTriggerSrc(channel.unit, channel.channel, trigger);
+}
+
+void dma_start(const dma_channel_t &channel)
+{
+    DMA_ChannelCmd(channel.unit, channel.channel, Enable);
+}
+
+void dma_stop(const dma_channel_t &channel)
+{
+    DMA_ChannelCmd(channel.unit, channel.channel, Disable);
+    DMA_ClearIrqFlag(channel.unit, channel.channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(channel.unit, channel.channel, BlkTrnCpltIrq);
+}
+
+//
+// completion interrupt dispatch
+//
+void dma_set_callback(const dma_channel_t &channel, const en_dma_irq_sel_t irq, dma_callback_t callback, void *param, const uint32_t priority)
+{
+    const size_t index = dma_channel_to_index(channel);
+    const size_t slot = dma_irq_to_slot(irq);
+    dma_channel_state_t &state = dma_channels[index];
+    const bool registered = state.callback[slot] != NULL;
+
+    // remove the callback
+    if (callback == NULL)
+    {
+        if (registered)
+        {
+            DMA_DisableIrq(channel.unit, channel.channel, irq);
+
+            NVIC_DisableIRQ(state.irqn[slot]);
+            NVIC_ClearPendingIRQ(state.irqn[slot]);
+            enIrqResign(state.irqn[slot]);
+            irqn_aa_resign(state.irqn[slot], "dma completion");
+
+            state.callback[slot] = NULL;
+        }
+        return;
+    }
+
+    // update parameters first, so the handler never sees a new callback with the old parameter
+    const uint32_t critical = core_critical_enter();
+    state.param[slot] = param;
+    state.callback[slot] = callback;
+    core_critical_exit(critical);
+
+    if (registered)
+    {
+        NVIC_SetPriority(state.irqn[slot], priority);
+        return;
+    }
+
+    // first callback, register interrupt
+    irqn_aa_get(state.irqn[slot], "dma completion");
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = dma_interrupt_sources[slot][index],
+        .enIRQn = state.irqn[slot],
+        .pfnCallback = dma_interrupt_handlers[slot][index],
+    };
+
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, priority);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+
+    DMA_ClearIrqFlag(channel.unit, channel.channel, irq);
+    DMA_EnableIrq(channel.unit, channel.channel, irq);
+}
+
+//
+// linked-list descriptors
+//
+void dma_descriptor_init(dma_descriptor_t &descriptor, const stc_dma_config_t *config)
+{
+    const stc_dma_ch_cfg_t &ch = config->stcDmaChCfg;
+
+    descriptor.SAR = config->u32SrcAddr;
+    descriptor.DAR = config->u32DesAddr;
+    descriptor.DTCTL = (uint32_t(config->u16BlockSize) & 0x3FF) | (uint32_t(config->u16TransferCnt) << 16);
+    descriptor.RPT = (uint32_t(config->u16SrcRptSize) & 0x3FF) | ((uint32_t(config->u16DesRptSize) & 0x3FF) << 16);
+    descriptor.SNSEQCTL = (config->stcSrcNseqCfg.u32Offset & 0xFFFFF) | (uint32_t(config->stcSrcNseqCfg.u16Cnt) << 20);
+    descriptor.DNSEQCTL = (config->stcDesNseqCfg.u32Offset & 0xFFFFF) | (uint32_t(config->stcDesNseqCfg.u16Cnt) << 20);
+    descriptor.LLP = config->u32DmaLlp & ~3ul;
+    descriptor.CHCTL = (uint32_t(ch.enSrcInc) << DMA_CHCTL_SINC_POS) |
+                       (uint32_t(ch.enDesInc) << DMA_CHCTL_DINC_POS) |
+                       (uint32_t(ch.enSrcRptEn == Enable) << DMA_CHCTL_SRPTEN_POS) |
+                       (uint32_t(ch.enDesRptEn == Enable) << DMA_CHCTL_DRPTEN_POS) |
+                       (uint32_t(ch.enSrcNseqEn == Enable) << DMA_CHCTL_SNSEQEN_POS) |
+                       (uint32_t(ch.enDesNseqEn == Enable) << DMA_CHCTL_DNSEQEN_POS) |
+                       (uint32_t(ch.enTrnWidth) << DMA_CHCTL_HSIZE_POS) |
+                       (uint32_t(ch.enLlpEn == Enable) << DMA_CHCTL_LLPEN_POS) |
+                       ((uint32_t(ch.enLlpMd) & 1) << DMA_CHCTL_LLPRUN_POS) |
+                       (uint32_t(ch.enIntEn == Enable) << DMA_CHCTL_IE_POS);
+}
+
+void dma_descriptor_link(dma_descriptor_t &descriptor, const dma_descriptor_t *next, const bool run_now)
+{
+    CORE_ASSERT((uint32_t(next) & 3) == 0, "DMA descriptors must be word-aligned");
+
+    const uint32_t llp_mask = (1ul << DMA_CHCTL_LLPEN_POS) | (1ul << DMA_CHCTL_LLPRUN_POS);
+    descriptor.CHCTL &= ~llp_mask;
+    descriptor.LLP = uint32_t(next);
+
+    if (next != NULL)
+    {
+        descriptor.CHCTL |= (1ul << DMA_CHCTL_LLPEN_POS) | (uint32_t(run_now) << DMA_CHCTL_LLPRUN_POS);
+    }
+}
+
+void dma_start_linked(const dma_channel_t &channel, const dma_descriptor_t *first)
+{
+    CORE_ASSERT(first != NULL, "dma_start_linked() no descriptor", return);
+
+    // load the descriptor the same way the DMA does, by copying it into the channel registers
+    DMA_ChannelCmd(channel.unit, channel.channel, Disable);
+    volatile uint32_t *regs = reinterpret_cast<volatile uint32_t *>(
+        uint32_t(channel.unit) + DMA_CHANNEL_REGS_OFFSET + (DMA_CHANNEL_REGS_STRIDE * uint32_t(channel.channel)));
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(first);
+    for (size_t i = 0; i < (sizeof(dma_descriptor_t) / sizeof(uint32_t)); i++)
+    {
+        regs[i] = words[i];
+    }
+
+    DMA_ChannelCmd(channel.unit, channel.channel, Enable);
+}
+
+void dma_descriptor_chain(dma_descriptor_t *descriptors, const size_t count, const bool circular, const bool run_now)
+{
+    CORE_ASSERT(descriptors != NULL && count > 0, "dma_descriptor_chain() no descriptors", return);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const bool last = i == (count - 1);
+        const dma_descriptor_t *next = last ? (circular ? &descriptors[0] : NULL) : &descriptors[i + 1];
+        dma_descriptor_link(descriptors[i], next, run_now);
+    }
+}
+
+//
+// ping-pong transfers
+//
+
+/**
+ * @brief transfer complete callback of ping-pong transfers
+ * @note fires once per descriptor, so once per buffer
+ */
+static void dma_pingpong_complete(const dma_channel_t &channel, void *param)
+{
+    (void)channel;
+    dma_pingpong_t &pingpong = *static_cast<dma_pingpong_t *>(param);
+
+    const uint8_t completed = pingpong.active;
+    pingpong.active = completed ^ 1;
+
+    if (pingpong.callback != NULL)
+    {
+        pingpong.callback(completed, pingpong.param);
+    }
+}
+
+void dma_pingpong_start(dma_pingpong_t &pingpong, const dma_channel_t &channel, const stc_dma_config_t *config,
+                        void *buffer_a, void *buffer_b, const bool buffers_are_destination, const en_event_src_t trigger,
+                        dma_pingpong_callback_t callback, void *param, const uint32_t priority)
+{
+    CORE_ASSERT(config != NULL && buffer_a != NULL && buffer_b != NULL, "dma_pingpong_start() invalid parameters", return);
+
+    void *const buffers[2] = {buffer_a, buffer_b};
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        dma_descriptor_t &descriptor = pingpong.descriptors[i];
+        dma_descriptor_init(descriptor, config);
+        if (buffers_are_destination)
+        {
+            descriptor.DAR = (uint32_t)(buffers[i]);
+        }
+        else
+        {
+            descriptor.SAR = (uint32_t)(buffers[i]);
+        }
+
+        // the completion of each buffer must raise the transfer complete interrupt
+        descriptor.CHCTL |= (1ul << DMA_CHCTL_IE_POS);
+    }
+
+    // each buffer continues with the other one, on the next trigger
+    dma_descriptor_chain(pingpong.descriptors, 2, true, false);
+
+    pingpong.channel = channel;
+    pingpong.active = 0;
+    pingpong.callback = callback;
+    pingpong.param = param;
+
+    dma_init(channel, config, trigger);
+    dma_set_callback(channel, TrnCpltIrq, dma_pingpong_complete, &pingpong, priority);
+    dma_start_linked(channel, &pingpong.descriptors[0]);
+}
+
+void dma_pingpong_stop(dma_pingpong_t &pingpong)
+{
+    dma_stop(pingpong.channel);
+    dma_set_callback(pingpong.channel, TrnCpltIrq, NULL, NULL, 0);
+}
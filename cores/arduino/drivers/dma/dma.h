@@ -0,0 +1,265 @@
+#pragma once
+#include <hc32_ddl.h>
+#include "../../core_debug.h"
+
+#define DMA_UNIT_COUNT 2                                         // DMA1 and DMA2
+#define DMA_CHANNELS_PER_UNIT 4                                  // channel 0 - 3 per unit
+#define DMA_CHANNEL_COUNT (DMA_UNIT_COUNT * DMA_CHANNELS_PER_UNIT) // total number of DMA channels
+
+/**
+ * @brief a DMA channel, identified by unit and channel number
+ */
+struct dma_channel_t
+{
+    /**
+     * @brief DMA unit register base address. M4_DMA1 or M4_DMA2
+     * @note NULL if no channel is assigned
+     */
+    M4_DMA_TypeDef *unit;
+
+    /**
+     * @brief channel number in the unit
+     */
+    en_dma_channel_t channel;
+};
+
+/**
+ * @brief DMA completion callback
+ * @param channel the channel that completed
+ * @param param the parameter passed to dma_set_callback()
+ * @note called from the DMA interrupt, after the interrupt flag was cleared
+ */
+typedef void (*dma_callback_t)(const dma_channel_t &channel, void *param);
+
+/**
+ * @brief DMA linked-list descriptor
+ * @note layout matches the channel registers SARx - CHxCTL, which the DMA loads the descriptor into.
+ *       descriptors must be word-aligned, and stay valid until the DMA loaded them
+ */
+struct dma_descriptor_t
+{
+    uint32_t SAR;
+    uint32_t DAR;
+    uint32_t DTCTL;
+    uint32_t RPT;
+    uint32_t SNSEQCTL;
+    uint32_t DNSEQCTL;
+    uint32_t LLP;
+    uint32_t CHCTL;
+};
+
+static_assert(sizeof(dma_descriptor_t) == 32, "dma_descriptor_t must match the DMA channel register layout");
+
+/**
+ * @brief ping-pong buffer completion callback
+ * @param buffer index of the buffer that was just completed, 0 or 1
+ * @param param the parameter passed to dma_pingpong_start()
+ * @note called from the DMA transfer complete interrupt. the DMA already continues with the other buffer
+ */
+typedef void (*dma_pingpong_callback_t)(const uint8_t buffer, void *param);
+
+/**
+ * @brief state of a ping-pong (double-buffered) transfer
+ * @note the DMA reads the descriptors from here, so the struct must stay valid while the transfer runs
+ */
+struct dma_pingpong_t
+{
+    /**
+     * @brief descriptors of the two buffers, linked to each other
+     */
+    dma_descriptor_t descriptors[2];
+
+    /**
+     * @brief the channel running the transfer
+     */
+    dma_channel_t channel;
+
+    /**
+     * @brief index of the buffer the DMA is currently working on
+     */
+    volatile uint8_t active;
+
+    dma_pingpong_callback_t callback;
+    void *param;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    en_result_t _dma_aa_get(dma_channel_t &channel, const char *name);
+    en_result_t _dma_claim(const dma_channel_t &channel, const char *name);
+    en_result_t _dma_resign(dma_channel_t &channel);
+
+#ifdef __CORE_DEBUG
+
+    /**
+     * @brief get an auto-assigned DMA channel
+     * @param channel assigned channel
+     * @param name name of the owner
+     * @return Ok or Error
+     * @note DMA2 channels are handed out first, DMA1 channel 0 last. channels with a fixed assignment
+     *       (USART, SPI and ADC DMA) are never handed out
+     */
+    inline en_result_t dma_aa_get(dma_channel_t &channel, const char *name)
+    {
+        if (_dma_aa_get(channel, name) != Ok)
+        {
+            panic_begin();
+            panic_printf("DMA channel auto-assignment failed for %s", name);
+            panic_end();
+        }
+
+        CORE_DEBUG_PRINTF("DMA%d channel %d auto-assigned to %s\n", channel.unit == M4_DMA1 ? 1 : 2, int(channel.channel), name);
+        return Ok;
+    }
+
+    /**
+     * @brief claim a fixed DMA channel
+     * @param channel the channel to claim
+     * @param name name of the owner
+     * @return Ok, or Error if the channel is already owned
+     * @note for peripherals with a fixed channel assignment, so that conflicts are detected
+     */
+    inline en_result_t dma_claim(const dma_channel_t &channel, const char *name)
+    {
+        if (_dma_claim(channel, name) != Ok)
+        {
+            panic_begin();
+            panic_printf("DMA%d channel %d claimed by %s is already in use", channel.unit == M4_DMA1 ? 1 : 2, int(channel.channel), name);
+            panic_end();
+        }
+
+        CORE_DEBUG_PRINTF("DMA%d channel %d claimed by %s\n", channel.unit == M4_DMA1 ? 1 : 2, int(channel.channel), name);
+        return Ok;
+    }
+
+    /**
+     * @brief release a claimed or auto-assigned DMA channel
+     * @param channel the channel to release. unit is set to NULL
+     * @param name name of the owner
+     * @return Ok or Error
+     * @note the channel is stopped, and its callbacks are removed
+     */
+    inline en_result_t dma_resign(dma_channel_t &channel, const char *name)
+    {
+        CORE_DEBUG_PRINTF("%s resigned DMA%d channel %d\n", name, channel.unit == M4_DMA1 ? 1 : 2, int(channel.channel));
+        if (_dma_resign(channel) != Ok)
+        {
+            panic_begin();
+            panic_printf("DMA channel resign failed for %s", name);
+            panic_end();
+        }
+
+        return Ok;
+    }
+
+#else
+#define dma_aa_get(channel, name) _dma_aa_get(channel, name)
+#define dma_claim(channel, name) _dma_claim(channel, name)
+#define dma_resign(channel, name) _dma_resign(channel)
+#endif
+
+    /**
+     * @brief get the owner of a DMA channel
+     * @return name of the owner, or NULL if the channel is free
+     */
+    const char *dma_get_owner(const dma_channel_t &channel);
+
+    /**
+     * @brief initialize a DMA channel
+     * @param channel the channel
+     * @param config transfer configuration
+     * @param trigger AOS event source that triggers the transfer. EVT_AOS_STRG for software trigger
+     * @note enables the clocks of the DMA unit and the AOS. the channel is left disabled, call dma_start()
+     */
+    void dma_init(const dma_channel_t &channel, const stc_dma_config_t *config, const en_event_src_t trigger);
+
+    /**
+     * @brief route an AOS event to the channel trigger
+     */
+    void dma_set_trigger(const dma_channel_t &channel, const en_event_src_t trigger);
+
+    /**
+     * @brief enable the channel, so it transfers on the next trigger
+     */
+    void dma_start(const dma_channel_t &channel);
+
+    /**
+     * @brief disable the channel and clear its completion flags
+     * @note a running transfer is aborted
+     */
+    void dma_stop(const dma_channel_t &channel);
+
+    /**
+     * @brief set the completion callback of a channel
+     * @param channel the channel
+     * @param irq TrnCpltIrq (transfer complete) or BlkTrnCpltIrq (block transfer complete)
+     * @param callback the callback. NULL to remove it and release the interrupt
+     * @param param parameter passed to the callback
+     * @param priority NVIC priority of the interrupt
+     * @note the interrupt is auto-assigned and registered on the first callback, and enabled in the DMA
+     */
+    void dma_set_callback(const dma_channel_t &channel, const en_dma_irq_sel_t irq, dma_callback_t callback, void *param, const uint32_t priority);
+
+    /**
+     * @brief fill a linked-list descriptor from a transfer configuration
+     * @param descriptor the descriptor
+     * @param config transfer configuration. u32DmaLlp and enLlpEn / enLlpMd select the next descriptor
+     */
+    void dma_descriptor_init(dma_descriptor_t &descriptor, const stc_dma_config_t *config);
+
+    /**
+     * @brief link a descriptor to the next one
+     * @param descriptor the descriptor
+     * @param next the next descriptor. NULL to end the list
+     * @param run_now start the next descriptor right away (true), or wait for the next trigger (false)?
+     */
+    void dma_descriptor_link(dma_descriptor_t &descriptor, const dma_descriptor_t *next, const bool run_now);
+
+    /**
+     * @brief load the first descriptor of a list into the channel, and enable it
+     * @param channel the channel. must be initialized with dma_init()
+     * @param first the first descriptor
+     */
+    void dma_start_linked(const dma_channel_t &channel, const dma_descriptor_t *first);
+
+    /**
+     * @brief link an array of descriptors into a chain
+     * @param descriptors the descriptors, in transfer order
+     * @param count number of descriptors
+     * @param circular link the last descriptor back to the first?
+     * @param run_now start each next descriptor right away (true), or wait for the next trigger (false)?
+     * @note e.g. sends the two segments of a wrapped ring buffer, or a command followed by its data, without
+     *       re-arming the channel in between
+     */
+    void dma_descriptor_chain(dma_descriptor_t *descriptors, const size_t count, const bool circular, const bool run_now);
+
+    /**
+     * @brief start a continuous ping-pong transfer between two buffers
+     * @param pingpong transfer state, must stay valid until dma_pingpong_stop()
+     * @param channel the channel. must be claimed or auto-assigned
+     * @param config transfer configuration of one buffer. the buffer address is replaced by buffer_a / buffer_b
+     * @param buffer_a first buffer
+     * @param buffer_b second buffer
+     * @param buffers_are_destination true if the DMA writes the buffers (e.g. ADC, rx), false if it reads them (e.g. tx)
+     * @param trigger AOS event source that triggers the transfer
+     * @param callback called each time a buffer was completed
+     * @param param parameter passed to the callback
+     * @param priority NVIC priority of the transfer complete interrupt
+     * @note while the callback processes one buffer, the DMA fills or drains the other one, so the stream never stops
+     */
+    void dma_pingpong_start(dma_pingpong_t &pingpong, const dma_channel_t &channel, const stc_dma_config_t *config,
+                            void *buffer_a, void *buffer_b, const bool buffers_are_destination, const en_event_src_t trigger,
+                            dma_pingpong_callback_t callback, void *param, const uint32_t priority);
+
+    /**
+     * @brief stop a ping-pong transfer
+     * @note the channel stays owned by the caller
+     */
+    void dma_pingpong_stop(dma_pingpong_t &pingpong);
+
+#ifdef __cplusplus
+}
+#endif
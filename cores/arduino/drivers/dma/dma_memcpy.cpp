@@ -0,0 +1,305 @@
+#include "dma_memcpy.h"
+#include "dma.h"
+#include "../aos/aos.h"
+#include "../irqn/irq_priority.h"
+#include "../../core_critical.h"
+#include <string.h>
+
+// number of transfer units per block. the 10-bit block size stores 1024 as 0
+#define DMA_MEMCPY_MAX_BLOCK_SIZE 1024
+
+// the transfer count register is 16 bits wide
+#define DMA_MEMCPY_MAX_BLOCK_COUNT 0xFFFF
+
+/**
+ * @brief state of the memcpy engine
+ */
+struct dma_memcpy_engine_t
+{
+    /**
+     * @brief the auto-assigned channel. unit is NULL until first use
+     */
+    dma_channel_t channel;
+
+    /**
+     * @brief is a copy running?
+     */
+    volatile bool busy;
+
+    /**
+     * @brief fill instead of copy? src then points to fill_value
+     */
+    bool fill;
+
+    /**
+     * @brief transfer width, as shift of the unit size: 0 = 8 bit, 1 = 16 bit, 2 = 32 bit
+     */
+    uint8_t width_shift;
+
+    /**
+     * @brief remaining blocks of the current phase
+     */
+    uint16_t blocks_left;
+
+    /**
+     * @brief units transferred by the current phase
+     */
+    uint32_t phase_units;
+
+    /**
+     * @brief units not yet transferred, including the current phase
+     */
+    uint32_t remaining_units;
+
+    uint8_t *dst;
+    const uint8_t *src;
+    uint32_t fill_value;
+
+    dma_memcpy_callback_t callback;
+    void *param;
+};
+
+/**
+ * @brief the engine
+ * @note a single engine is enough: every DMA channel triggered by the software event would move a block on every
+ *       trigger, so only one copy can run on the DMA at a time anyway
+ */
+static dma_memcpy_engine_t engine = {};
+
+/**
+ * @brief start the next phase of a copy
+ * @note a phase moves as many full blocks as possible. the remainder of less than a block is a second phase
+ */
+static void engine_start_phase(void)
+{
+    const uint32_t block = engine.remaining_units < DMA_MEMCPY_MAX_BLOCK_SIZE ? engine.remaining_units : DMA_MEMCPY_MAX_BLOCK_SIZE;
+    uint32_t blocks = engine.remaining_units / block;
+    if (blocks > DMA_MEMCPY_MAX_BLOCK_COUNT)
+    {
+        blocks = DMA_MEMCPY_MAX_BLOCK_COUNT;
+    }
+
+    engine.blocks_left = uint16_t(blocks);
+    engine.phase_units = block * blocks;
+
+    stc_dma_config_t config = {
+        .u16BlockSize = uint16_t(block),
+        .u16TransferCnt = uint16_t(blocks),
+        .u32SrcAddr = (uint32_t)(engine.src),
+        .u32DesAddr = (uint32_t)(engine.dst),
+        .u16SrcRptSize = 0,
+        .u16DesRptSize = 0,
+        .stcDmaChCfg = {
+            .enSrcInc = engine.fill ? AddressFix : AddressIncrease,
+            .enDesInc = AddressIncrease,
+            .enSrcRptEn = Disable,
+            .enDesRptEn = Disable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = en_dma_transfer_width_t(engine.width_shift), // Dma8Bit, Dma16Bit, Dma32Bit
+            .enLlpEn = Disable,
+            .enIntEn = Enable,
+        },
+    };
+
+    dma_init(engine.channel, &config, EVT_AOS_STRG);
+    dma_start(engine.channel);
+    aos_software_trigger();
+}
+
+/**
+ * @brief block transfer complete callback
+ * @note each software trigger moves one block, so the next block is triggered from here
+ */
+static void engine_block_complete(const dma_channel_t &channel, void *)
+{
+    if (--engine.blocks_left > 0)
+    {
+        aos_software_trigger();
+        return;
+    }
+
+    // phase complete
+    const uint32_t phase_bytes = engine.phase_units << engine.width_shift;
+    engine.dst += phase_bytes;
+    if (!engine.fill)
+    {
+        engine.src += phase_bytes;
+    }
+
+    engine.remaining_units -= engine.phase_units;
+    if (engine.remaining_units > 0)
+    {
+        engine_start_phase();
+        return;
+    }
+
+    // copy complete, release the engine before calling back, so the callback may start the next copy
+    dma_stop(channel);
+    const dma_memcpy_callback_t callback = engine.callback;
+    void *const callback_param = engine.param;
+    aos_software_trigger_give();
+    engine.busy = false;
+
+    if (callback != NULL)
+    {
+        callback(callback_param);
+    }
+}
+
+/**
+ * @brief take the engine and the software trigger, and assign the channel on first use
+ * @return false if the engine, the software trigger or a DMA channel is not available
+ */
+static bool engine_acquire(void)
+{
+    const uint32_t critical = core_critical_enter();
+    const bool available = !engine.busy;
+    engine.busy = true;
+    core_critical_exit(critical);
+
+    if (!available)
+    {
+        return false;
+    }
+
+    // the software trigger may be in use by another DMA transfer, e.g. a CRC calculation
+    if (!aos_software_trigger_take())
+    {
+        engine.busy = false;
+        return false;
+    }
+
+    // assign the channel on first use, and keep it
+    if (engine.channel.unit == NULL)
+    {
+        if (_dma_aa_get(engine.channel, "dma memcpy") != Ok)
+        {
+            engine.channel.unit = NULL;
+            aos_software_trigger_give();
+            engine.busy = false;
+            return false;
+        }
+
+        dma_set_callback(engine.channel, BlkTrnCpltIrq, engine_block_complete, NULL, IRQ_PRIORITY_DMA);
+    }
+
+    return true;
+}
+
+/**
+ * @brief start a copy or fill on the DMA
+ * @return false if the DMA cannot be used, nothing was done then
+ */
+static bool engine_start(void *dst, const void *src, const bool fill, const uint8_t value, const size_t length, dma_memcpy_callback_t callback, void *param)
+{
+    if (length < DMA_MEMCPY_MIN_SIZE)
+    {
+        return false;
+    }
+
+    if (!engine_acquire())
+    {
+        return false;
+    }
+
+    // widest transfer the alignment allows
+    const uint32_t alignment = fill ? (uint32_t)(dst) : ((uint32_t)(dst) | (uint32_t)(src));
+    engine.width_shift = (alignment & 3) == 0 ? 2 : ((alignment & 1) == 0 ? 1 : 0);
+
+    engine.fill = fill;
+    engine.fill_value = 0x01010101ul * value;
+    engine.dst = static_cast<uint8_t *>(dst);
+    engine.src = fill ? reinterpret_cast<const uint8_t *>(&engine.fill_value) : static_cast<const uint8_t *>(src);
+    engine.remaining_units = length >> engine.width_shift;
+    engine.callback = callback;
+    engine.param = param;
+
+    // bytes that do not fill a whole unit are handled on the CPU right away
+    const size_t tail = length & ((1u << engine.width_shift) - 1);
+    if (tail > 0)
+    {
+        const size_t offset = length - tail;
+        if (fill)
+        {
+            memset(engine.dst + offset, value, tail);
+        }
+        else
+        {
+            memcpy(engine.dst + offset, engine.src + offset, tail);
+        }
+    }
+
+    engine_start_phase();
+    return true;
+}
+
+bool dma_memcpy_async(void *dst, const void *src, size_t length, dma_memcpy_callback_t callback, void *param)
+{
+    if (engine_start(dst, src, false, 0, length, callback, param))
+    {
+        return true;
+    }
+
+    memcpy(dst, src, length);
+    if (callback != NULL)
+    {
+        callback(param);
+    }
+    return false;
+}
+
+bool dma_memset_async(void *dst, uint8_t value, size_t length, dma_memcpy_callback_t callback, void *param)
+{
+    if (engine_start(dst, NULL, true, value, length, callback, param))
+    {
+        return true;
+    }
+
+    memset(dst, value, length);
+    if (callback != NULL)
+    {
+        callback(param);
+    }
+    return false;
+}
+
+/**
+ * @brief can the caller wait for the DMA interrupt?
+ * @note not in an interrupt handler, and not with interrupts disabled or masked by a critical section
+ */
+inline bool can_wait_for_dma(void)
+{
+    return __get_IPSR() == 0 && __get_PRIMASK() == 0 && __get_BASEPRI() == 0;
+}
+
+static void set_done_flag(void *param)
+{
+    *static_cast<volatile bool *>(param) = true;
+}
+
+void dma_memcpy(void *dst, const void *src, size_t length)
+{
+    volatile bool done = false;
+    if (!can_wait_for_dma() || !engine_start(dst, src, false, 0, length, set_done_flag, (void *)&done))
+    {
+        memcpy(dst, src, length);
+        return;
+    }
+
+    while (!done)
+        ;
+}
+
+void dma_memset(void *dst, uint8_t value, size_t length)
+{
+    volatile bool done = false;
+    if (!can_wait_for_dma() || !engine_start(dst, NULL, true, value, length, set_done_flag, (void *)&done))
+    {
+        memset(dst, value, length);
+        return;
+    }
+
+    while (!done)
+        ;
+}
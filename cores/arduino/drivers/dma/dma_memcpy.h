@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef DMA_MEMCPY_MIN_SIZE
+/**
+ * @brief copies smaller than this (in bytes) always run on the CPU
+ * @note below this size, setting up the DMA costs more than the copy itself
+ */
+#define DMA_MEMCPY_MIN_SIZE 64
+#endif
+
+/**
+ * @brief DMA memcpy / memset completion callback
+ * @param param the parameter passed to dma_memcpy_async() / dma_memset_async()
+ * @note called from the DMA interrupt, or directly from the caller if the copy ran on the CPU
+ */
+typedef void (*dma_memcpy_callback_t)(void *param);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief copy memory in the background using DMA
+     * @param dst destination
+     * @param src source. must not overlap with dst
+     * @param length number of bytes to copy
+     * @param callback called once the copy is complete. may be NULL
+     * @param param parameter passed to the callback
+     * @return true if the copy runs on the DMA, false if it was done on the CPU before returning
+     * @note dst and src must not be accessed until the callback was called
+     * @note with dst and src word-aligned, 32-bit transfers are used. otherwise 16- or 8-bit transfers
+     * @note a DMA channel is auto-assigned on first use and kept. only one copy runs on the DMA at a time
+     * @note the DMA is triggered through the AOS software trigger, taken with aos_software_trigger_take() for the
+     *       duration of the copy. while it is in use, e.g. by crc_update_dma_async(), copies run on the CPU
+     */
+    bool dma_memcpy_async(void *dst, const void *src, size_t length, dma_memcpy_callback_t callback, void *param);
+
+    /**
+     * @brief fill memory in the background using DMA
+     * @param dst destination
+     * @param value the byte to fill with
+     * @param length number of bytes to fill
+     * @param callback called once the fill is complete. may be NULL
+     * @param param parameter passed to the callback
+     * @return true if the fill runs on the DMA, false if it was done on the CPU before returning
+     * @note see dma_memcpy_async()
+     */
+    bool dma_memset_async(void *dst, uint8_t value, size_t length, dma_memcpy_callback_t callback, void *param);
+
+    /**
+     * @brief copy memory using DMA, and wait for completion
+     * @note for large copies, the DMA is faster than a CPU copy loop, and interrupts are still serviced while waiting.
+     *       if called from an interrupt handler or with interrupts masked, the copy runs on the CPU
+     */
+    void dma_memcpy(void *dst, const void *src, size_t length);
+
+    /**
+     * @brief fill memory using DMA, and wait for completion
+     * @note see dma_memcpy()
+     */
+    void dma_memset(void *dst, uint8_t value, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
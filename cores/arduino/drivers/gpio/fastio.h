@@ -0,0 +1,106 @@
+/**
+ * compile-time fast GPIO access:
+ *
+ * FastPin<PA1> resolves the port registers and bit mask of a pin at compile-time, so setting or clearing a pin
+ * compiles down to a single store to the port's POSR / PORR register, and reading a pin to a single load of PIDR.
+ * there are no checks at runtime. invalid pins fail to compile.
+ *
+ * FastPin only accesses the pin state. the pin still has to be configured using pinMode() first.
+ *
+ * @example
+ * FastPin<PA1>::set();
+ * FastPin<PA1>::write(false);
+ * if (FastPin<PB2>::read()) { ... }
+ */
+#pragma once
+#include <stdint.h>
+#include <hc32_ddl.h>
+#include "../../core_types.h"
+#include "../../WVariant.h"
+
+/**
+ * @brief offset between the registers of two ports
+ */
+#define FASTIO_PORT_STRIDE 0x10
+
+/**
+ * @brief get a port register of a port
+ * @param type register type, e.g. uint16_t
+ * @param porta_register the register of PortA, e.g. M4_PORT->POSRA
+ * @param port the port. 0 == PortA, ...
+ */
+#define FASTIO_PORT_REG(type, porta_register, port) \
+    (*((volatile type *)((uintptr_t)(&(porta_register)) + (FASTIO_PORT_STRIDE * (uint32_t)(port)))))
+
+#ifdef __cplusplus
+
+template <gpio_pin_t pin>
+struct FastPin
+{
+    /**
+     * @brief port of the pin. 0 == PortA, ...
+     */
+    static constexpr uint32_t port = pin_port<pin>();
+
+    /**
+     * @brief bit mask of the pin in the port registers
+     */
+    static constexpr uint16_t mask = pin_bit_mask<pin>();
+
+    /**
+     * @brief set the pin HIGH
+     */
+    static inline void set()
+    {
+        FASTIO_PORT_REG(uint16_t, M4_PORT->POSRA, port) = mask;
+    }
+
+    /**
+     * @brief set the pin LOW
+     */
+    static inline void clear()
+    {
+        FASTIO_PORT_REG(uint16_t, M4_PORT->PORRA, port) = mask;
+    }
+
+    /**
+     * @brief toggle the pin
+     */
+    static inline void toggle()
+    {
+        FASTIO_PORT_REG(uint16_t, M4_PORT->POTRA, port) = mask;
+    }
+
+    /**
+     * @brief set the pin HIGH or LOW
+     */
+    static inline void write(const bool high)
+    {
+        if (high)
+        {
+            set();
+        }
+        else
+        {
+            clear();
+        }
+    }
+
+    /**
+     * @brief read the input level of the pin
+     */
+    static inline bool read()
+    {
+        return (FASTIO_PORT_REG(uint16_t, M4_PORT->PIDRA, port) & mask) != 0;
+    }
+
+    /**
+     * @brief read the output level the pin is driven to
+     */
+    static inline bool readOutput()
+    {
+        return (FASTIO_PORT_REG(uint16_t, M4_PORT->PODRA, port) & mask) != 0;
+    }
+};
+
+#endif // __cplusplus
@@ -5,6 +5,7 @@
 #include "../adc/adc.h"
 #include "../../WVariant.h"
 #include "../../core_types.h"
+#include "fastio.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -101,6 +102,117 @@ extern "C"
         return PORT_GetFunc(PIN_ARG(gpio_pin), enFuncSelect, enSubFunc);
     }
 
+    //
+    // port-level access
+    //
+
+    /**
+     * @brief a group of pins on the same port
+     */
+    typedef struct gpio_port_group_t
+    {
+        /**
+         * @brief port of all pins in the group
+         */
+        en_port_t port;
+
+        /**
+         * @brief bit mask of all pins in the group
+         */
+        uint16_t mask;
+    } gpio_port_group_t;
+
+    /**
+     * @brief read the input levels of all pins of a port at once
+     * @param port the port
+     * @return input levels, bit n is pin n of the port
+     */
+    inline uint16_t GPIO_ReadPort(en_port_t port)
+    {
+        return FASTIO_PORT_REG(uint16_t, M4_PORT->PIDRA, port);
+    }
+
+    /**
+     * @brief read the output levels of all pins of a port at once
+     * @param port the port
+     * @return output levels, bit n is pin n of the port
+     */
+    inline uint16_t GPIO_ReadPortOutput(en_port_t port)
+    {
+        return FASTIO_PORT_REG(uint16_t, M4_PORT->PODRA, port);
+    }
+
+    /**
+     * @brief write the output levels of multiple pins of a port at once
+     * @param port the port
+     * @param mask pins to write, bit n is pin n of the port. other pins are not changed
+     * @param value output levels, bit n is pin n of the port
+     * @note POSR and PORR are adjacent, so a single 32-bit store sets and clears all pins at the same time.
+     *       this is atomic, and no read-modify-write is needed
+     */
+    inline void GPIO_WritePort(en_port_t port, uint16_t mask, uint16_t value)
+    {
+        const uint16_t set = value & mask;
+        const uint16_t reset = ~value & mask;
+        FASTIO_PORT_REG(uint32_t, M4_PORT->POSRA, port) = (uint32_t(reset) << 16) | set;
+    }
+
+    /**
+     * @brief precompute the port and mask of a group of pins
+     * @param pins the pins of the group
+     * @param count number of pins
+     * @param group the group. only valid if function returns true
+     * @return true if all pins are valid and on the same port, false otherwise
+     */
+    inline bool GPIO_GetPortGroup(const gpio_pin_t *pins, size_t count, gpio_port_group_t *group)
+    {
+        CORE_ASSERT(pins != NULL && group != NULL && count > 0, "GPIO_GetPortGroup: invalid arguments", return false);
+
+        group->mask = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            ASSERT_GPIO_PIN_VALID(pins[i], "GPIO_GetPortGroup");
+            if (!IS_GPIO_PIN(pins[i]))
+            {
+                return false;
+            }
+
+            // all pins must be on the port of the first pin
+            if (i == 0)
+            {
+                group->port = PIN_MAP[pins[i]].port;
+            }
+            else if (PIN_MAP[pins[i]].port != group->port)
+            {
+                return false;
+            }
+
+            group->mask |= PIN_MAP[pins[i]].bit_mask;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief write the output levels of all pins of a group at once
+     * @param group the group
+     * @param value output levels, bit n is pin n of the port. bits not in the group are ignored
+     */
+    inline void GPIO_WritePortGroup(const gpio_port_group_t *group, uint16_t value)
+    {
+        GPIO_WritePort(group->port, group->mask, value);
+    }
+
+    /**
+     * @brief read the input levels of all pins of a group at once
+     * @param group the group
+     * @return input levels, bit n is pin n of the port. bits not in the group are 0
+     */
+    inline uint16_t GPIO_ReadPortGroup(const gpio_port_group_t *group)
+    {
+        return GPIO_ReadPort(group->port) & group->mask;
+    }
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,139 @@
+/**
+ * interrupt priority plan of the core drivers:
+ *
+ * every driver takes the priority of its interrupts from this table, so the relative priorities of all interrupts
+ * are set in one place. each entry can be overridden with a build flag of the same name.
+ *
+ * the NVIC has 4 priority bits. IRQ_PRIORITY_PREEMPT_BITS of them set the preemption priority, the rest set the
+ * sub-priority. an interrupt only preempts another of a numerically higher preemption priority. the sub-priority
+ * only decides which of two pending interrupts is taken first. by default, all 4 bits are preemption bits, so the
+ * values match DDL_IRQ_PRIORITY_xx.
+ *
+ * by default, the stepper timer preempts everything but critical sections (see CORE_CRITICAL_SECTION_PRIORITY),
+ * and serial communication preempts all other drivers.
+ */
+#pragma once
+#include <hc32_ddl.h>
+
+#ifndef IRQ_PRIORITY_PREEMPT_BITS
+/**
+ * @brief number of priority bits used for the preemption priority, 0 - 4
+ */
+#define IRQ_PRIORITY_PREEMPT_BITS 4
+#endif
+
+#if IRQ_PRIORITY_PREEMPT_BITS < 0 || IRQ_PRIORITY_PREEMPT_BITS > __NVIC_PRIO_BITS
+#error "IRQ_PRIORITY_PREEMPT_BITS must be between 0 and __NVIC_PRIO_BITS"
+#endif
+
+/**
+ * @brief build a priority value from a preemption priority and a sub-priority
+ * @note with the default IRQ_PRIORITY_PREEMPT_BITS, IRQ_PRIORITY(n, 0) is DDL_IRQ_PRIORITY_n
+ */
+#define IRQ_PRIORITY(preempt, sub) \
+    ((((preempt) << (__NVIC_PRIO_BITS - IRQ_PRIORITY_PREEMPT_BITS)) | (sub)) & ((1ul << __NVIC_PRIO_BITS) - 1))
+
+//
+// priority table
+//
+
+#ifndef IRQ_PRIORITY_STEPPER
+/**
+ * @brief TimerA stepper pulse generation (timera_step)
+ */
+#define IRQ_PRIORITY_STEPPER IRQ_PRIORITY(2, 0)
+#endif
+
+#ifndef IRQ_PRIORITY_USART
+/**
+ * @brief USART rx / tx interrupts and their DMA
+ */
+#define IRQ_PRIORITY_USART IRQ_PRIORITY(3, 0)
+#endif
+
+#ifndef IRQ_PRIORITY_SPI
+/**
+ * @brief SPI DMA transfers
+ */
+#define IRQ_PRIORITY_SPI IRQ_PRIORITY(3, 0)
+#endif
+
+#ifndef IRQ_PRIORITY_WIRE
+/**
+ * @brief I2C (Wire)
+ */
+#define IRQ_PRIORITY_WIRE IRQ_PRIORITY(3, 0)
+#endif
+
+#ifndef IRQ_PRIORITY_EXTI
+/**
+ * @brief external interrupts (attachInterrupt), unless changed by setInterruptPriority()
+ */
+#define IRQ_PRIORITY_EXTI DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_TIMERA
+/**
+ * @brief TimerA timer and PWM interrupts
+ */
+#define IRQ_PRIORITY_TIMERA DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_TIMER0
+/**
+ * @brief Timer0 (Timer0 library)
+ */
+#define IRQ_PRIORITY_TIMER0 DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_SOFTPWM
+/**
+ * @brief software PWM engine
+ */
+#define IRQ_PRIORITY_SOFTPWM DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_ADC
+/**
+ * @brief ADC conversion, watchdog and DMA interrupts
+ */
+#define IRQ_PRIORITY_ADC DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_DMA
+/**
+ * @brief DMA completion of the core DMA services (memcpy, CRC)
+ */
+#define IRQ_PRIORITY_DMA DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_CAN
+/**
+ * @brief CAN controller
+ */
+#define IRQ_PRIORITY_CAN DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_USB
+/**
+ * @brief USB device
+ */
+#define IRQ_PRIORITY_USB DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+#ifndef IRQ_PRIORITY_LOW
+/**
+ * @brief everything else: watchdog, TRNG, temperature sensor, ...
+ */
+#define IRQ_PRIORITY_LOW DDL_IRQ_PRIORITY_DEFAULT
+#endif
+
+/**
+ * @brief set the NVIC priority grouping to IRQ_PRIORITY_PREEMPT_BITS
+ * @note called by core_init(), before any interrupt is enabled
+ */
+inline void irq_priority_init()
+{
+    // PRIGROUP = 7 - preemption bits, counted on the full 8-bit priority field
+    NVIC_SetPriorityGrouping(7 - IRQ_PRIORITY_PREEMPT_BITS);
+}
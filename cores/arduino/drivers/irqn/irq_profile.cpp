@@ -0,0 +1,249 @@
+#include "irq_profile.h"
+
+#ifdef CORE_IRQ_PROFILING
+#include "../sysclock/systick.h"
+#include "../../core_debug.h"
+#include "../../core_util.h"
+#include "../../Print.h"
+#include <stdio.h>
+
+// IRQ0 - IRQ127 can be registered using enIrqRegistration()
+#define IRQ_PROFILE_COUNT 128
+
+/**
+ * @brief profiling state of a IRQn
+ */
+typedef struct irq_profile_entry_t
+{
+    /**
+     * @brief the actual handler of the IRQn
+     */
+    func_ptr_t handler;
+
+    /**
+     * @brief cycle count the IRQn was first seen pending at
+     * @note only valid if pending_seen is set
+     */
+    uint32_t pending_since;
+
+    /**
+     * @brief was the IRQn seen pending since its handler was last entered?
+     */
+    bool pending_seen;
+
+    /**
+     * @brief statistics of the IRQn
+     */
+    irq_profile_stats_t stats;
+} irq_profile_entry_t;
+
+static irq_profile_entry_t profiles[IRQ_PROFILE_COUNT];
+
+/**
+ * @brief bitmask of IRQns with a profiled handler, in NVIC->ISPR layout
+ */
+static uint32_t profiled_mask[IRQ_PROFILE_COUNT / 32];
+
+/**
+ * @brief cycles spent in nested handlers of the current handler
+ */
+static uint32_t nested_cycles = 0;
+
+/**
+ * @brief cycles spent in all profiled handlers, never reset
+ */
+static uint64_t total_handler_cycles = 0;
+
+/**
+ * @brief cycle count (64-bit) of the last reset, for load calculation
+ */
+static uint64_t reset_cycles = 0;
+
+/**
+ * @brief timestamp all profiled IRQns that are pending, but not yet seen pending
+ * @param now current cycle count
+ */
+static inline void mark_pending(const uint32_t now)
+{
+    for (uint8_t w = 0; w < (IRQ_PROFILE_COUNT / 32); w++)
+    {
+        uint32_t pending = NVIC->ISPR[w] & profiled_mask[w];
+        while (pending != 0)
+        {
+            const uint8_t bit = __CLZ(__RBIT(pending));
+            pending &= pending - 1;
+
+            irq_profile_entry_t &profile = profiles[(w * 32) + bit];
+            if (!profile.pending_seen)
+            {
+                profile.pending_since = now;
+                profile.pending_seen = true;
+            }
+        }
+    }
+}
+
+/**
+ * @brief profiling dispatcher, registered in place of the actual handler
+ * @note the IRQn is taken from IPSR, so one dispatcher serves all IRQns
+ */
+static void irq_profile_dispatch(void)
+{
+    const uint32_t enter = DWT->CYCCNT;
+    const uint32_t irqn = (__get_IPSR() & 0x1FF) - 16;
+    if (irqn >= IRQ_PROFILE_COUNT)
+    {
+        return;
+    }
+
+    irq_profile_entry_t &profile = profiles[irqn];
+
+    // entry latency
+    if (profile.pending_seen)
+    {
+        const uint32_t latency = enter - profile.pending_since;
+        if (latency > profile.stats.max_latency_cycles)
+        {
+            profile.stats.max_latency_cycles = latency;
+        }
+
+        profile.pending_seen = false;
+    }
+
+    mark_pending(enter);
+
+    // call the actual handler, tracking the cycles of nested handlers separately
+    const uint32_t outer_nested_cycles = nested_cycles;
+    nested_cycles = 0;
+    const uint32_t start = DWT->CYCCNT;
+
+    profile.handler();
+
+    const uint32_t end = DWT->CYCCNT;
+    const uint32_t elapsed = end - start;
+    const uint32_t cycles = elapsed - nested_cycles;
+    nested_cycles = outer_nested_cycles + (end - enter);
+
+    // update statistics
+    profile.stats.count++;
+    profile.stats.total_cycles += cycles;
+    if (cycles > profile.stats.max_cycles)
+    {
+        profile.stats.max_cycles = cycles;
+    }
+
+    // shared by all handlers, so a nested handler must not interrupt the update
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    total_handler_cycles += cycles;
+    __set_PRIMASK(primask);
+
+    mark_pending(end);
+}
+
+//
+// public API
+//
+
+en_result_t irq_profile_registration(const stc_irq_regi_conf_t *conf)
+{
+    CORE_ASSERT(conf != nullptr, "irq_profile_registration: conf is nullptr", return ErrorInvalidParameter);
+
+    const uint32_t irqn = static_cast<uint32_t>(conf->enIRQn);
+    if (irqn >= IRQ_PROFILE_COUNT || conf->pfnCallback == nullptr)
+    {
+        // cannot profile, register as-is
+        return enIrqRegistration(conf);
+    }
+
+    core_cycle_counter_enable();
+
+    // set the actual handler and reset statistics before the dispatcher can be called
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    irq_profile_entry_t &profile = profiles[irqn];
+    profile.handler = conf->pfnCallback;
+    profile.pending_seen = false;
+    profile.stats = {};
+    profile.stats.source = conf->enIntSrc;
+    profiled_mask[irqn / 32] |= (1ul << (irqn % 32));
+    __set_PRIMASK(primask);
+
+    // register the dispatcher in place of the handler
+    stc_irq_regi_conf_t profiled_conf = *conf;
+    profiled_conf.pfnCallback = irq_profile_dispatch;
+    return enIrqRegistration(&profiled_conf);
+}
+
+bool irq_profile_get(const IRQn_Type irqn, irq_profile_stats_t &stats)
+{
+    const uint32_t n = static_cast<uint32_t>(irqn);
+    if (n >= IRQ_PROFILE_COUNT || profiles[n].handler == nullptr)
+    {
+        return false;
+    }
+
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    stats = profiles[n].stats;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+uint64_t irq_profile_get_total_cycles()
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint64_t cycles = total_handler_cycles;
+    __set_PRIMASK(primask);
+    return cycles;
+}
+
+void irq_profile_reset()
+{
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint32_t n = 0; n < IRQ_PROFILE_COUNT; n++)
+    {
+        const en_int_src_t source = profiles[n].stats.source;
+        profiles[n].stats = {};
+        profiles[n].stats.source = source;
+        profiles[n].pending_seen = false;
+    }
+
+    reset_cycles = systick_cycles64();
+    __set_PRIMASK(primask);
+}
+
+void irq_profile_dump(Print &out)
+{
+    const uint64_t window = systick_cycles64() - reset_cycles;
+
+    out.println("IRQn  source  count       total kcycles  max cycles  max latency  load");
+    for (uint32_t n = 0; n < IRQ_PROFILE_COUNT; n++)
+    {
+        irq_profile_stats_t stats;
+        if (!irq_profile_get(static_cast<IRQn_Type>(n), stats) || stats.count == 0)
+        {
+            continue;
+        }
+
+        // load in 0.01 %
+        const uint32_t load = window == 0 ? 0 : static_cast<uint32_t>((stats.total_cycles * 10000) / window);
+
+        // total in kilocycles, as printf may not support 64-bit values
+        char line[96];
+        snprintf(line, sizeof(line), "%-4lu  %-6d  %-10lu  %-13lu  %-10lu  %-11lu  %lu.%02lu%%",
+                 n,
+                 int(stats.source),
+                 stats.count,
+                 static_cast<uint32_t>(stats.total_cycles / 1000),
+                 stats.max_cycles,
+                 stats.max_latency_cycles,
+                 load / 100,
+                 load % 100);
+        out.println(line);
+    }
+}
+
+#endif // CORE_IRQ_PROFILING
@@ -0,0 +1,89 @@
+/**
+ * IRQ profiling:
+ *
+ * with CORE_IRQ_PROFILING defined, every IRQ registered using enIrqRegistration() is routed through a
+ * dispatcher that measures the handler using the DWT cycle counter.
+ * for each IRQn, the invocation count, the cumulative and maximum cycles spent in the handler, and the
+ * maximum entry latency are recorded.
+ *
+ * handler cycles exclude time spent in nested interrupts that are profiled as well.
+ * entry latency is measured from the moment the IRQ is first seen pending by the dispatcher (on entry or exit
+ * of any profiled handler) until its handler is entered. thus, it is the time the IRQ was blocked by other
+ * profiled handlers, and a lower bound of the actual latency.
+ *
+ * without CORE_IRQ_PROFILING, none of this is compiled.
+ */
+#pragma once
+#include <hc32_ddl.h>
+
+#ifdef CORE_IRQ_PROFILING
+
+/**
+ * @brief profiling statistics of a IRQn
+ */
+typedef struct irq_profile_stats_t
+{
+    /**
+     * @brief interrupt source the IRQn is registered to
+     */
+    en_int_src_t source;
+
+    /**
+     * @brief number of handler invocations
+     */
+    uint32_t count;
+
+    /**
+     * @brief cumulative handler cycles
+     */
+    uint64_t total_cycles;
+
+    /**
+     * @brief maximum cycles of a single handler invocation
+     */
+    uint32_t max_cycles;
+
+    /**
+     * @brief maximum entry latency, in cycles
+     */
+    uint32_t max_latency_cycles;
+} irq_profile_stats_t;
+
+/**
+ * @brief register a IRQ handler, profiled
+ * @param conf IRQ registration config, see enIrqRegistration()
+ * @return result of enIrqRegistration()
+ * @note enIrqRegistration() is redirected to this function by irqn.h
+ */
+en_result_t irq_profile_registration(const stc_irq_regi_conf_t *conf);
+
+/**
+ * @brief get the profiling statistics of a IRQn
+ * @param irqn the IRQn
+ * @param stats statistics of the IRQn. only valid if function returns true
+ * @return true if the IRQn has a profiled handler registered, false otherwise
+ * @note the statistics are read in a critical section, so they are consistent
+ */
+bool irq_profile_get(const IRQn_Type irqn, irq_profile_stats_t &stats);
+
+/**
+ * @brief get the cycles spent in all profiled handlers
+ * @return cycles since boot, excluding the dispatcher. not affected by irq_profile_reset()
+ */
+uint64_t irq_profile_get_total_cycles();
+
+/**
+ * @brief reset the profiling statistics of all IRQns
+ */
+void irq_profile_reset();
+
+class Print;
+
+/**
+ * @brief print the profiling statistics of all IRQns that were invoked at least once
+ * @param out where to print to, e.g. Serial
+ * @note the load is relative to the time since the last reset
+ */
+void irq_profile_dump(Print &out);
+
+#endif // CORE_IRQ_PROFILING
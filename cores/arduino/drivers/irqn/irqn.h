@@ -1,6 +1,7 @@
 #pragma once
 #include <hc32_ddl.h>
 #include "../../core_debug.h"
+#include "irq_priority.h"
 
 #define IRQN_AA_FIRST_IRQN 0                                                 // IRQ0 is the first auto-assignable IRQn
 #define IRQN_AA_AVAILABLE_COUNT 128                                          // IRQ0 - IRQ127 are available for auto-assignment (all normal IRQn)
@@ -62,3 +63,10 @@ extern "C"
 #ifdef __cplusplus
 }
 #endif
+
+#ifdef CORE_IRQ_PROFILING
+#include "irq_profile.h"
+
+// route all IRQ registrations through the profiler
+#define enIrqRegistration(conf) irq_profile_registration(conf)
+#endif
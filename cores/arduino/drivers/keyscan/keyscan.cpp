@@ -0,0 +1,294 @@
+#include "keyscan.h"
+#include "../irqn/irqn.h"
+#include "../sysclock/systick.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+#include <string.h>
+
+/**
+ * @brief frequency of the scan clock (LRC), in Hz
+ */
+#define KEYSCAN_CLOCK_FREQUENCY 32768ul
+
+/**
+ * @brief Hi-Z time between two rows, in scan clock cycles. lets the columns recover before the next row
+ */
+#define KEYSCAN_HIZ_CYCLE Hiz8
+#define KEYSCAN_HIZ_CYCLES 8ul
+
+#define KEYSCAN_MAX_KEYS (KEYSCAN_MAX_ROWS * KEYSCAN_MAX_COLUMNS)
+#define NO_COLUMN 0xFFu
+
+static keyscan_config_t config;
+static bool running = false;
+
+/**
+ * @brief column index of each EXTI line, or NO_COLUMN
+ */
+static uint8_t column_of_line[KEYSCAN_MAX_COLUMNS];
+
+/**
+ * @brief IRQn of each column
+ */
+static IRQn_Type column_irqn[KEYSCAN_MAX_COLUMNS];
+
+/**
+ * @brief pressed keys, one bit per key
+ */
+static uint32_t pressed[KEYSCAN_MAX_KEYS / 32];
+static volatile uint8_t pressed_count = 0;
+
+/**
+ * @brief systick_millis() when each key was last seen, truncated to 16 bit
+ */
+static volatile uint16_t last_seen[KEYSCAN_MAX_KEYS];
+
+/**
+ * @brief time a key is not seen before it is released, in milliseconds
+ */
+static uint16_t release_ms;
+
+static inline bool is_pressed(const uint8_t key)
+{
+    return (pressed[key / 32] & (1ul << (key % 32))) != 0;
+}
+
+/**
+ * @brief EXTI interrupt of a column
+ */
+template <uint8_t line>
+static void keyscan_column_irq(void)
+{
+    EXINT_IrqFlgClr(static_cast<en_exti_ch_t>(line));
+
+    // the scan index is the row driven low right now
+    const uint8_t row = KEYSCAN_GetColIdx();
+    const uint8_t column = column_of_line[line];
+    if (row >= config.row_count || column == NO_COLUMN)
+    {
+        return;
+    }
+
+    const uint8_t key = row * config.column_count + column;
+    last_seen[key] = uint16_t(systick_millis());
+    if (is_pressed(key))
+    {
+        return;
+    }
+
+    pressed[key / 32] |= (1ul << (key % 32));
+    pressed_count++;
+    if (config.callback != nullptr)
+    {
+        config.callback(key, true, config.param);
+    }
+}
+
+static const func_ptr_t column_irqs[KEYSCAN_MAX_COLUMNS] = {
+    keyscan_column_irq<0>,
+    keyscan_column_irq<1>,
+    keyscan_column_irq<2>,
+    keyscan_column_irq<3>,
+    keyscan_column_irq<4>,
+    keyscan_column_irq<5>,
+    keyscan_column_irq<6>,
+    keyscan_column_irq<7>,
+    keyscan_column_irq<8>,
+    keyscan_column_irq<9>,
+    keyscan_column_irq<10>,
+    keyscan_column_irq<11>,
+    keyscan_column_irq<12>,
+    keyscan_column_irq<13>,
+    keyscan_column_irq<14>,
+    keyscan_column_irq<15>,
+};
+
+/**
+ * @brief low time per row as a power of two scan clock cycles, at least 4
+ */
+static uint8_t low_cycles_log2(const uint32_t row_time_us)
+{
+    const uint64_t cycles = (uint64_t(row_time_us) * KEYSCAN_CLOCK_FREQUENCY + 999999ull) / 1000000ull;
+    uint8_t n = 2;
+    while (n < uint8_t(Low16M) && (1ull << n) < cycles)
+    {
+        n++;
+    }
+    return n;
+}
+
+static void release_columns(const uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const IRQn_Type irqn = column_irqn[i];
+        NVIC_DisableIRQ(irqn);
+        NVIC_ClearPendingIRQ(irqn);
+        enIrqResign(irqn);
+        irqn_aa_resign(column_irqn[i], "keyscan");
+
+        stc_port_init_t pin_config;
+        MEM_ZERO_STRUCT(pin_config);
+        GPIO_Init(config.columns[i], &pin_config);
+    }
+}
+
+//
+// public API
+//
+
+bool keyscan_begin(const keyscan_config_t *cfg)
+{
+    CORE_ASSERT(cfg != nullptr, "keyscan_begin: config is NULL", return false);
+    CORE_ASSERT(cfg->row_count >= 2 && cfg->row_count <= KEYSCAN_MAX_ROWS, "keyscan_begin: 2 - 8 rows are supported", return false);
+    CORE_ASSERT(cfg->column_count >= 1 && cfg->column_count <= KEYSCAN_MAX_COLUMNS, "keyscan_begin: invalid column count", return false);
+    if (running)
+    {
+        keyscan_end();
+    }
+
+    config = *cfg;
+    memset(column_of_line, NO_COLUMN, sizeof(column_of_line));
+    memset(pressed, 0, sizeof(pressed));
+    pressed_count = 0;
+
+    // the column of each EXTI line
+    uint16_t keyin_mask = 0;
+    for (uint8_t i = 0; i < config.column_count; i++)
+    {
+        ASSERT_GPIO_PIN_VALID(config.columns[i], "keyscan_begin", return false);
+        const uint8_t line = PIN_MAP[config.columns[i]].bit_pos;
+        CORE_ASSERT(column_of_line[line] == NO_COLUMN, "keyscan_begin: two columns on the same EXTI line", return false);
+        column_of_line[line] = i;
+        keyin_mask |= uint16_t(1u << line);
+    }
+
+    // timing: a full scan is row_count * (hiz + low) cycles. a key is released when not seen for two scans
+    const uint32_t row_time_us = config.row_time_us != 0 ? config.row_time_us : 1000;
+    const uint8_t low_log2 = low_cycles_log2(row_time_us);
+    const uint32_t scan_cycles = config.row_count * (KEYSCAN_HIZ_CYCLES + (1ul << low_log2));
+    const uint32_t scan_ms = (scan_cycles * 1000ul + KEYSCAN_CLOCK_FREQUENCY - 1) / KEYSCAN_CLOCK_FREQUENCY;
+    release_ms = uint16_t(scan_ms * 2 + 1);
+
+    // columns: pulled-up inputs, interrupt on the falling edge
+    for (uint8_t i = 0; i < config.column_count; i++)
+    {
+        const gpio_pin_t pin = config.columns[i];
+        const uint8_t line = PIN_MAP[pin].bit_pos;
+
+        if (irqn_aa_get(column_irqn[i], "keyscan") != Ok)
+        {
+            CORE_DEBUG_PRINTF("keyscan: no IRQn for column %d\n", i);
+            release_columns(i);
+            return false;
+        }
+
+        stc_exint_config_t exti_config = {
+            .enExitCh = static_cast<en_exti_ch_t>(line),
+            .enFilterEn = Enable,
+            .enFltClk = Pclk3Div64,
+            .enExtiLvl = ExIntFallingEdge,
+        };
+        EXINT_Init(&exti_config);
+
+        stc_port_init_t pin_config;
+        MEM_ZERO_STRUCT(pin_config);
+        pin_config.enExInt = Enable;
+        pin_config.enPullUp = Enable;
+        GPIO_Init(pin, &pin_config);
+
+        stc_irq_regi_conf_t irq_config = {
+            .enIntSrc = static_cast<en_int_src_t>(INT_PORT_EIRQ0 + line),
+            .enIRQn = column_irqn[i],
+            .pfnCallback = column_irqs[line],
+        };
+        enIrqRegistration(&irq_config);
+        EXINT_IrqFlgClr(static_cast<en_exti_ch_t>(line));
+        NVIC_ClearPendingIRQ(column_irqn[i]);
+        NVIC_SetPriority(column_irqn[i], IRQ_PRIORITY_LOW);
+        NVIC_EnableIRQ(column_irqn[i]);
+    }
+
+    // rows: driven by the KEYSCAN peripheral
+    for (uint8_t i = 0; i < config.row_count; i++)
+    {
+        GPIO_SetFunc(config.rows[i], Func_Key, Disable);
+    }
+
+    stc_keyscan_config_t keyscan_config;
+    MEM_ZERO_STRUCT(keyscan_config);
+    keyscan_config.enHizCycle = KEYSCAN_HIZ_CYCLE;
+    keyscan_config.enLowCycle = static_cast<en_keyscan_low_cycle_t>(low_log2);
+    keyscan_config.enKeyscanClk = KeyscanLrc;
+    keyscan_config.enKeyoutSel = static_cast<en_keyscan_keyout_sel_t>(config.row_count - 1);
+    keyscan_config.u16KeyinSel = keyin_mask;
+
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_KEY, Enable);
+    KEYSCAN_Init(&keyscan_config);
+    KEYSCAN_Start();
+
+    CORE_DEBUG_PRINTF("keyscan: %dx%d matrix, scan=%lums\n", config.row_count, config.column_count, scan_ms);
+    running = true;
+    return true;
+}
+
+void keyscan_end(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    KEYSCAN_Stop();
+    KEYSCAN_DeInit();
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_KEY, Disable);
+
+    release_columns(config.column_count);
+    for (uint8_t i = 0; i < config.row_count; i++)
+    {
+        GPIO_SetFunc(config.rows[i], Func_Gpio, Enable);
+    }
+
+    memset(pressed, 0, sizeof(pressed));
+    pressed_count = 0;
+    running = false;
+}
+
+void keyscan_poll(void)
+{
+    if (pressed_count == 0)
+    {
+        return;
+    }
+
+    const uint16_t now = uint16_t(systick_millis());
+    const uint8_t key_count = config.row_count * config.column_count;
+    for (uint8_t key = 0; key < key_count; key++)
+    {
+        if (!is_pressed(key))
+        {
+            continue;
+        }
+
+        // the interrupt may see the key again while this checks it
+        bool released = false;
+        const uint32_t state = core_critical_enter();
+        if (uint16_t(now - last_seen[key]) > release_ms && int16_t(now - last_seen[key]) > 0)
+        {
+            pressed[key / 32] &= ~(1ul << (key % 32));
+            pressed_count--;
+            released = true;
+        }
+        core_critical_exit(state);
+
+        if (released && config.callback != nullptr)
+        {
+            config.callback(key, false, config.param);
+        }
+    }
+}
+
+bool keyscan_is_pressed(const uint8_t key)
+{
+    return key < KEYSCAN_MAX_KEYS && is_pressed(key);
+}
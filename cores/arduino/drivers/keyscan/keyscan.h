@@ -0,0 +1,92 @@
+/**
+ * button matrix scanning with the KEYSCAN peripheral:
+ *
+ * the KEYSCAN peripheral drives the rows (KEYOUTn) low one after another, while the columns (KEYINn) are pulled up
+ * and connected to the EXTI lines of the same number. a pressed key pulls its column low while its row is driven,
+ * which raises the EXTI interrupt of the column. the interrupt takes the row from the scan index, so the CPU only
+ * runs while a key is pressed.
+ *
+ * a held key is seen once per scan cycle. a key is released once it was not seen for two scan cycles, which also
+ * debounces it. releases are found by keyscan_poll().
+ *
+ * key numbers are row * column_count + column, in the order of the pins in keyscan_config_t.
+ *
+ * the EXTI lines of the columns are used by the driver, and cannot be used with attachInterrupt().
+ * the scan clock is the LRC (32.768 kHz).
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include "../gpio/gpio.h"
+
+/**
+ * @brief maximum number of rows (KEYOUT0 - 7) and columns (KEYIN0 - 15)
+ */
+#define KEYSCAN_MAX_ROWS 8
+#define KEYSCAN_MAX_COLUMNS 16
+
+/**
+ * @brief called for every key press and release
+ * @param key the key number
+ * @param pressed true if the key was pressed, false if it was released
+ * @note called from the EXTI interrupt on press, and from keyscan_poll() on release
+ */
+typedef void (*keyscan_callback_t)(const uint8_t key, const bool pressed, void *param);
+
+/**
+ * @brief configuration of the key matrix
+ */
+struct keyscan_config_t
+{
+    /**
+     * @brief the row pins. rows[n] must be the KEYOUTn pin
+     */
+    gpio_pin_t rows[KEYSCAN_MAX_ROWS];
+    uint8_t row_count;
+
+    /**
+     * @brief the column pins. each must be on a different EXTI line (the bit number of the pin)
+     */
+    gpio_pin_t columns[KEYSCAN_MAX_COLUMNS];
+    uint8_t column_count;
+
+    /**
+     * @brief how long each row is driven low, in microseconds. rounded up to a power of two LRC cycles
+     * @note a full scan takes row_count times this. 0 for the default of 1 ms
+     */
+    uint32_t row_time_us;
+
+    keyscan_callback_t callback;
+    void *param;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief start scanning the matrix
+     * @param config the configuration. copied
+     * @return false if the configuration is invalid, or an EXTI line has no IRQn
+     */
+    bool keyscan_begin(const keyscan_config_t *config);
+
+    /**
+     * @brief stop scanning. keys still pressed are not reported as released
+     */
+    void keyscan_end(void);
+
+    /**
+     * @brief report keys released since the last call
+     * @note call regularly, e.g. from loop(). returns immediately if no key is pressed
+     */
+    void keyscan_poll(void);
+
+    /**
+     * @brief is a key pressed?
+     */
+    bool keyscan_is_pressed(const uint8_t key);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,129 @@
+#include "backtrace.h"
+#include "panic.h"
+#include "../../main/init.h"
+
+// code and stack bounds, from the linker script
+// (CORE_RAMFUNC code is placed in .data)
+extern uint32_t __etext;
+extern uint32_t __data_start__;
+extern uint32_t __data_end__;
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+
+// an EXC_RETURN value with bit 4 cleared means the exception frame includes the FPU registers
+#define EXC_RETURN_FRAME_STANDARD (1ul << 4)
+
+// size of the exception frame, in words
+#define EXCEPTION_FRAME_WORDS 8
+#define EXCEPTION_FRAME_FPU_WORDS 26
+
+/**
+ * @brief is the address inside the code, so that the 4 bytes before it can be read?
+ */
+static inline bool is_code_address(const uint32_t address)
+{
+    return (address >= (uint32_t)(LD_FLASH_START) + 4 && address <= (uint32_t)(&__etext)) ||
+           (address >= (uint32_t)(&__data_start__) + 4 && address <= (uint32_t)(&__data_end__));
+}
+
+bool backtrace_is_return_address(const uint32_t value)
+{
+    // return addresses of thumb code have bit 0 set
+    if ((value & 1) == 0)
+    {
+        return false;
+    }
+
+    const uint32_t address = value & ~1ul;
+    if (!is_code_address(address))
+    {
+        return false;
+    }
+
+    // BL <label>: 32-bit, 11110xxx xxxxxxxx 11x1xxxx xxxxxxxx
+    const uint16_t *code = (const uint16_t *)(address);
+    if ((code[-2] & 0xF800) == 0xF000 && (code[-1] & 0xD000) == 0xD000)
+    {
+        return true;
+    }
+
+    // BLX <Rm>: 16-bit, 01000111 1xxxx000
+    return (code[-1] & 0xFF87) == 0x4780;
+}
+
+size_t backtrace_scan(const uint32_t *sp, uint32_t *addresses, size_t depth, const size_t max_depth)
+{
+    const uint32_t *bottom = &__StackLimit;
+    const uint32_t *top = &__StackTop;
+    if (sp < bottom || sp >= top)
+    {
+        return depth;
+    }
+
+    if ((size_t)(top - sp) > BACKTRACE_SCAN_WORDS)
+    {
+        top = sp + BACKTRACE_SCAN_WORDS;
+    }
+
+    for (const uint32_t *word = sp; word < top && depth < max_depth; word++)
+    {
+        const uint32_t value = *word;
+        if (!backtrace_is_return_address(value))
+        {
+            continue;
+        }
+
+        // the LR of the interrupted code is often also pushed by it. don't list it twice
+        if (depth > 0 && addresses[depth - 1] == value)
+        {
+            continue;
+        }
+
+        addresses[depth++] = value;
+    }
+
+    return depth;
+}
+
+size_t backtrace_from_exception(const uint32_t *stack_frame, const uint32_t exc_return, uint32_t *addresses, const size_t max_depth)
+{
+    size_t depth = 0;
+    if (max_depth == 0)
+    {
+        return 0;
+    }
+
+    // the faulting instruction itself
+    addresses[depth++] = stack_frame[6];
+
+    // the return address of the interrupted function, unless it was overwritten since
+    if (depth < max_depth && backtrace_is_return_address(stack_frame[5]))
+    {
+        addresses[depth++] = stack_frame[5];
+    }
+
+    // the stack of the interrupted code continues after the exception frame
+    const size_t frame_words = (exc_return & EXC_RETURN_FRAME_STANDARD) != 0 ? EXCEPTION_FRAME_WORDS : EXCEPTION_FRAME_FPU_WORDS;
+    return backtrace_scan(stack_frame + frame_words, addresses, depth, max_depth);
+}
+
+#ifdef __CORE_DEBUG
+void backtrace_print(const uint32_t *addresses, const size_t depth)
+{
+    panic_printf("- Backtrace (addr2line -e firmware.elf):\n");
+    for (size_t i = 0; i < depth; i++)
+    {
+        panic_printf("#%u 0x%08lx\n", (unsigned)i, addresses[i]);
+    }
+}
+
+void backtrace_print_current(void)
+{
+    uint32_t sp;
+    asm volatile("mov %0, sp" : "=r"(sp));
+
+    uint32_t addresses[BACKTRACE_DEPTH];
+    const size_t depth = backtrace_scan((const uint32_t *)(sp), addresses, 0, BACKTRACE_DEPTH);
+    backtrace_print(addresses, depth);
+}
+#endif
@@ -0,0 +1,87 @@
+/**
+ * heuristic stack backtrace:
+ *
+ * the core is built without frame pointers and without unwind tables, so the call chain cannot be unwound exactly.
+ * instead, the stack is scanned for words that look like return addresses: odd (thumb) addresses inside the code,
+ * directly after a BL or BLX instruction. these are the functions that were being called into when the stack was
+ * written, innermost first.
+ *
+ * stale return addresses left on the stack by functions that already returned may show up as well, so treat the
+ * backtrace as a list of candidates. decode it using arm-none-eabi-addr2line -e firmware.elf <addresses>.
+ *
+ * only the main stack (MSP) is scanned, since its bounds are known from the linker script.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifndef BACKTRACE_DEPTH
+/**
+ * @brief maximum number of addresses in a backtrace
+ */
+#define BACKTRACE_DEPTH 8
+#endif
+
+#ifndef BACKTRACE_SCAN_WORDS
+/**
+ * @brief maximum number of stack words scanned for return addresses
+ */
+#define BACKTRACE_SCAN_WORDS 512
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief check if a value looks like a return address
+     * @param value the value, e.g. a stack word
+     * @return true if value is a thumb address inside the code, and the instruction before it is a BL or BLX
+     */
+    bool backtrace_is_return_address(const uint32_t value);
+
+    /**
+     * @brief scan the stack for return addresses
+     * @param sp first stack word to scan. if not inside the main stack, nothing is scanned
+     * @param addresses receives the return addresses, innermost first
+     * @param depth number of addresses already in the backtrace. the new addresses are appended
+     * @param max_depth maximum number of addresses in the backtrace
+     * @return number of addresses in the backtrace
+     */
+    size_t backtrace_scan(const uint32_t *sp, uint32_t *addresses, size_t depth, const size_t max_depth);
+
+    /**
+     * @brief collect the backtrace of an exception
+     * @param stack_frame the stacked exception frame (r0 - psr)
+     * @param exc_return EXC_RETURN value of the exception, to find the end of the frame
+     * @param addresses receives the addresses. the first is the PC of the interrupted code, followed by the LR
+     *                  (if it is a return address) and the return addresses on the stack
+     * @param max_depth maximum number of addresses
+     * @return number of addresses in the backtrace
+     */
+    size_t backtrace_from_exception(const uint32_t *stack_frame, const uint32_t exc_return, uint32_t *addresses, const size_t max_depth);
+
+#ifdef __CORE_DEBUG
+
+    /**
+     * @brief print a backtrace to the panic output
+     * @note only available if the panic output is enabled and panic_begin() was called
+     */
+    void backtrace_print(const uint32_t *addresses, const size_t depth);
+
+    /**
+     * @brief print the backtrace of the caller to the panic output
+     * @note only available if the panic output is enabled and panic_begin() was called
+     */
+    void backtrace_print_current(void);
+
+#else
+#define backtrace_print(addresses, depth)
+#define backtrace_print_current()
+#endif
+
+#ifdef __cplusplus
+}
+#endif
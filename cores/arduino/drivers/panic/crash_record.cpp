@@ -0,0 +1,246 @@
+#include "crash_record.h"
+
+#ifdef CORE_CRASH_RECORD
+#ifndef CORE_SRAM_SECTIONS
+#error "CORE_CRASH_RECORD requires the SRAM placement sections (board_build.sram_sections)"
+#endif
+
+#include "../../core_util.h"
+#include "../../core_stack.h"
+#include "../sysclock/systick.h"
+#include <hc32_ddl.h>
+#include <string.h>
+
+// size of the record, without the checksum
+#define CRASH_RECORD_CHECKSUM_WORDS ((sizeof(crash_record_t) - sizeof(uint32_t)) / sizeof(uint32_t))
+
+// panic messages are string literals, so they are in flash
+#define CRASH_RECORD_FLASH_END 0x00080000ul
+
+/**
+ * @brief the crash record, kept through resets
+ */
+static crash_record_t crash_record CORE_RET_SRAM_NOINIT;
+
+// main stack bounds, from the linker script
+extern "C" uint32_t __StackLimit;
+extern "C" uint32_t __StackTop;
+
+/**
+ * @brief calculate the checksum of a record
+ */
+static uint32_t crash_record_checksum(const crash_record_t *record)
+{
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(record);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < CRASH_RECORD_CHECKSUM_WORDS; i++)
+    {
+        // rotate, so swapped words change the checksum
+        sum = ((sum << 5) | (sum >> 27)) ^ words[i];
+    }
+
+    return ~sum;
+}
+
+/**
+ * @brief fill the fields common to all crash types
+ */
+static void crash_record_begin(const crash_type_t type)
+{
+    crash_record.magic = CRASH_RECORD_MAGIC;
+    crash_record.version = CRASH_RECORD_VERSION;
+    crash_record.type = uint8_t(type);
+    crash_record.flags = 0;
+    crash_record.uptime_ms = systick_millis();
+
+    crash_record.cfsr = SCB->CFSR;
+    crash_record.hfsr = SCB->HFSR;
+    crash_record.dfsr = SCB->DFSR;
+    crash_record.afsr = SCB->AFSR;
+    crash_record.mmfar = SCB->MMFAR;
+    crash_record.bfar = SCB->BFAR;
+    crash_record.message = 0;
+}
+
+/**
+ * @brief copy the stack into the record
+ * @param sp first stack word to copy. only the part inside the main stack is copied
+ */
+static void crash_record_copy_stack(const uint32_t sp)
+{
+#if defined(CORE_STACK_MONITOR) || defined(CORE_STACK_GUARD)
+    // above the guard region, which cannot be read while the MPU is enabled
+    const uint32_t bottom = core_stack_get_bottom();
+#else
+    const uint32_t bottom = uint32_t(&__StackLimit);
+#endif
+    const uint32_t top = uint32_t(&__StackTop);
+
+    uint32_t words = 0;
+    if (sp >= bottom && sp < top)
+    {
+        words = (top - sp) / sizeof(uint32_t);
+        if (words > CRASH_RECORD_STACK_WORDS)
+        {
+            words = CRASH_RECORD_STACK_WORDS;
+        }
+
+        memcpy(crash_record.stack, reinterpret_cast<const void *>(sp), words * sizeof(uint32_t));
+    }
+
+    crash_record.stack_words = words;
+}
+
+/**
+ * @brief finalize the record with its checksum
+ */
+static void crash_record_end(void)
+{
+    crash_record.checksum = crash_record_checksum(&crash_record);
+    __DSB();
+}
+
+void crash_record_save_fault(const crash_type_t type, const uint32_t *stack_frame, const uint32_t exc_return, const bool frame_valid)
+{
+    crash_record_begin(type);
+    crash_record.exc_return = exc_return;
+    crash_record.sp = uint32_t(stack_frame);
+
+    if (frame_valid)
+    {
+        crash_record.flags |= CRASH_RECORD_FLAG_FRAME_VALID;
+        crash_record.r0 = stack_frame[0];
+        crash_record.r1 = stack_frame[1];
+        crash_record.r2 = stack_frame[2];
+        crash_record.r3 = stack_frame[3];
+        crash_record.r12 = stack_frame[4];
+        crash_record.lr = stack_frame[5];
+        crash_record.pc = stack_frame[6];
+        crash_record.psr = stack_frame[7];
+
+        // the stack of the interrupted code continues after the 8 word frame
+        crash_record_copy_stack(uint32_t(stack_frame + 8));
+        crash_record.backtrace_depth = backtrace_from_exception(stack_frame, exc_return, crash_record.backtrace, CRASH_RECORD_BACKTRACE_DEPTH);
+    }
+    else
+    {
+        crash_record.r0 = crash_record.r1 = crash_record.r2 = crash_record.r3 = 0;
+        crash_record.r12 = crash_record.lr = crash_record.pc = crash_record.psr = 0;
+        crash_record.stack_words = 0;
+        crash_record.backtrace_depth = 0;
+    }
+
+    crash_record_end();
+}
+
+void crash_record_save_panic(const char *message)
+{
+    crash_record_begin(CRASH_TYPE_PANIC);
+    crash_record.message = uint32_t(message);
+
+    // there is no exception frame, but the caller's registers are still meaningful
+    uint32_t sp;
+    asm volatile("mov %0, sp" : "=r"(sp));
+    crash_record.exc_return = 0;
+    crash_record.sp = sp;
+    crash_record.lr = uint32_t(__builtin_return_address(0));
+    crash_record.r0 = crash_record.r1 = crash_record.r2 = crash_record.r3 = 0;
+    crash_record.r12 = crash_record.pc = crash_record.psr = 0;
+    crash_record_copy_stack(sp);
+    crash_record.backtrace_depth = backtrace_scan(reinterpret_cast<const uint32_t *>(sp), crash_record.backtrace, 0, CRASH_RECORD_BACKTRACE_DEPTH);
+
+    crash_record_end();
+}
+
+bool crash_record_get(crash_record_t *record)
+{
+    if (crash_record.magic != CRASH_RECORD_MAGIC ||
+        crash_record.version != CRASH_RECORD_VERSION ||
+        crash_record.stack_words > CRASH_RECORD_STACK_WORDS ||
+        crash_record.backtrace_depth > CRASH_RECORD_BACKTRACE_DEPTH ||
+        crash_record.checksum != crash_record_checksum(&crash_record))
+    {
+        return false;
+    }
+
+    if (record != NULL)
+    {
+        *record = crash_record;
+    }
+    return true;
+}
+
+void crash_record_clear(void)
+{
+    crash_record.magic = 0;
+}
+
+//
+// printing
+//
+static const char *crash_type_name(const uint8_t type)
+{
+    switch (type)
+    {
+    case CRASH_TYPE_HARDFAULT:
+        return "HARDFAULT";
+    case CRASH_TYPE_MEMMANAGE:
+        return "MEMMANAGE FAULT";
+    case CRASH_TYPE_STACK_OVERFLOW:
+        return "STACK OVERFLOW";
+    case CRASH_TYPE_PANIC:
+        return "PANIC";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+void crash_record_print(Print &out, const crash_record_t &record)
+{
+    out.printf("*** CRASH RECORD: %s after %lu ms ***\n", crash_type_name(record.type), record.uptime_ms);
+
+    if (record.message != 0 && record.message < CRASH_RECORD_FLASH_END)
+    {
+        out.printf("message: %s\n", reinterpret_cast<const char *>(record.message));
+    }
+
+    out.printf("CFSR = 0x%08lx HFSR = 0x%08lx DFSR = 0x%08lx AFSR = 0x%08lx\n", record.cfsr, record.hfsr, record.dfsr, record.afsr);
+    out.printf("MMFAR = 0x%08lx BFAR = 0x%08lx\n", record.mmfar, record.bfar);
+
+    if ((record.flags & CRASH_RECORD_FLAG_FRAME_VALID) != 0)
+    {
+        out.printf("R0 = 0x%08lx R1 = 0x%08lx R2 = 0x%08lx R3 = 0x%08lx\n", record.r0, record.r1, record.r2, record.r3);
+        out.printf("R12 = 0x%08lx LR = 0x%08lx PC = 0x%08lx PSR = 0x%08lx\n", record.r12, record.lr, record.pc, record.psr);
+    }
+    else if (record.type == CRASH_TYPE_PANIC)
+    {
+        out.printf("caller LR = 0x%08lx\n", record.lr);
+    }
+    else
+    {
+        out.printf("(exception frame not stacked)\n");
+    }
+
+    out.printf("SP = 0x%08lx EXC_RETURN = 0x%08lx\n", record.sp, record.exc_return);
+
+    // for faults, the copied stack starts after the 8 word exception frame
+    const uint32_t stack_start = record.sp + (((record.flags & CRASH_RECORD_FLAG_FRAME_VALID) != 0) ? 32 : 0);
+    out.printf("stack:");
+    for (uint32_t i = 0; i < record.stack_words; i++)
+    {
+        if ((i % 4) == 0)
+        {
+            out.printf("\n0x%08lx:", stack_start + (i * 4));
+        }
+        out.printf(" %08lx", record.stack[i]);
+    }
+
+    out.printf("\nbacktrace (addr2line -e firmware.elf):");
+    for (uint32_t i = 0; i < record.backtrace_depth; i++)
+    {
+        out.printf(" 0x%08lx", record.backtrace[i]);
+    }
+    out.printf("\n***\n");
+}
+
+#endif // CORE_CRASH_RECORD
@@ -0,0 +1,177 @@
+/**
+ * post-mortem crash record:
+ *
+ * on a fault or panic, a compact binary record is written to Ret_SRAM, before anything is printed.
+ * this takes a few microseconds, and the record survives the following reset.
+ * after boot, check for a record with crash_record_get() and print it with crash_record_print(),
+ * e.g. to a serial port or a file on the SD card. then discard it using crash_record_clear().
+ *
+ * enable with CORE_CRASH_RECORD. requires the SRAM placement sections (board_build.sram_sections),
+ * since Ret_SRAM is only kept through a reset with its own no-init section.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "backtrace.h"
+
+#ifndef CRASH_RECORD_STACK_WORDS
+/**
+ * @brief number of stack words above the exception frame saved in the crash record
+ */
+#define CRASH_RECORD_STACK_WORDS 32
+#endif
+
+#ifndef CRASH_RECORD_BACKTRACE_DEPTH
+/**
+ * @brief maximum number of return addresses saved in the crash record
+ */
+#define CRASH_RECORD_BACKTRACE_DEPTH BACKTRACE_DEPTH
+#endif
+
+/**
+ * @brief crash record magic value, "CRSH"
+ */
+#define CRASH_RECORD_MAGIC 0x48535243ul
+
+/**
+ * @brief version of the crash record layout
+ */
+#define CRASH_RECORD_VERSION 2
+
+/**
+ * @brief cause of a crash
+ */
+typedef enum crash_type_t
+{
+    CRASH_TYPE_HARDFAULT = 1,
+    CRASH_TYPE_MEMMANAGE = 2,
+    CRASH_TYPE_STACK_OVERFLOW = 3,
+    CRASH_TYPE_PANIC = 4,
+} crash_type_t;
+
+/**
+ * @brief the exception frame was stacked, and the register values are valid
+ */
+#define CRASH_RECORD_FLAG_FRAME_VALID (1u << 0)
+
+/**
+ * @brief binary crash record
+ * @note plain 32-bit words, so host tools can decode a raw memory dump of it
+ */
+typedef struct crash_record_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint8_t type;  // crash_type_t
+    uint8_t flags; // CRASH_RECORD_FLAG_*
+    uint32_t uptime_ms;
+
+    // exception frame
+    uint32_t r0;
+    uint32_t r1;
+    uint32_t r2;
+    uint32_t r3;
+    uint32_t r12;
+    uint32_t lr;
+    uint32_t pc;
+    uint32_t psr;
+
+    // EXC_RETURN value, and the stack pointer at the time of the fault
+    uint32_t exc_return;
+    uint32_t sp;
+
+    // fault status and address registers
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t dfsr;
+    uint32_t afsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+
+    /**
+     * @brief address of the panic message, in flash. 0 if there is none
+     */
+    uint32_t message;
+
+    /**
+     * @brief stack contents above the exception frame
+     */
+    uint32_t stack[CRASH_RECORD_STACK_WORDS];
+
+    /**
+     * @brief number of valid words in stack
+     */
+    uint32_t stack_words;
+
+    /**
+     * @brief candidate call chain, innermost first. see backtrace.h
+     * @note for faults, the first address is the faulting PC
+     */
+    uint32_t backtrace[CRASH_RECORD_BACKTRACE_DEPTH];
+
+    /**
+     * @brief number of valid addresses in backtrace
+     */
+    uint32_t backtrace_depth;
+
+    /**
+     * @brief checksum over all previous words
+     */
+    uint32_t checksum;
+} crash_record_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#ifdef CORE_CRASH_RECORD
+
+    /**
+     * @brief save a crash record for a fault
+     * @param type the fault type
+     * @param stack_frame the stacked exception frame (r0 - psr) and the following stack
+     * @param exc_return EXC_RETURN value of the exception
+     * @param frame_valid was the exception frame stacked successfully?
+     * @note called from the fault handlers. overwrites any previous record
+     */
+    void crash_record_save_fault(const crash_type_t type, const uint32_t *stack_frame, const uint32_t exc_return, const bool frame_valid);
+
+    /**
+     * @brief save a crash record for a panic
+     * @param message the panic message. only its address is saved, the text stays in flash
+     * @note overwrites any previous record
+     */
+    void crash_record_save_panic(const char *message);
+
+    /**
+     * @brief get the crash record of the previous run
+     * @param record receives a copy of the record
+     * @return true if there is a valid record
+     */
+    bool crash_record_get(crash_record_t *record);
+
+    /**
+     * @brief discard the crash record
+     */
+    void crash_record_clear(void);
+
+#else
+#define crash_record_save_fault(type, stack_frame, exc_return, frame_valid)
+#define crash_record_save_panic(message)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(__cplusplus) && defined(CORE_CRASH_RECORD)
+#include "../../Print.h"
+
+/**
+ * @brief print a crash record in human-readable form
+ * @param out where to print to, e.g. Serial
+ * @param record the record
+ */
+void crash_record_print(Print &out, const crash_record_t &record);
+#endif
@@ -5,6 +5,9 @@
  */
 #include "fault_handlers.h"
 #include "panic.h"
+#include "crash_record.h"
+#include "backtrace.h"
+#include "../../core_stack.h"
 #include <hc32_ddl.h>
 
 typedef union hardfault_stack_frame_t
@@ -95,11 +98,28 @@ void print_stack_frame(hardfault_stack_frame_t *stack_frame)
     panic_printf("PSR = 0x%08lx\n", stack_frame->psr);
 }
 
+/**
+ * @brief print the backtrace of the interrupted code to panic output
+ * @note the stack frame must be valid
+ */
+void print_backtrace(hardfault_stack_frame_t *stack_frame, uint32_t lr_value)
+{
+#ifdef __CORE_DEBUG
+    uint32_t addresses[BACKTRACE_DEPTH];
+    const size_t depth = backtrace_from_exception(stack_frame->raw, lr_value, addresses, BACKTRACE_DEPTH);
+    backtrace_print(addresses, depth);
+#endif
+}
+
 /**
  * @brief hard fault handler in C, called by assembly wrapper
  */
 void HardFault_Handler_C(hardfault_stack_frame_t *stack_frame, uint32_t lr_value)
 {
+    // save the crash record first, it is fast and survives the reset
+    crash_record_save_fault(CRASH_TYPE_HARDFAULT, stack_frame->raw, lr_value,
+                            (SCB->CFSR & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_STKERR_Msk)) == 0);
+
     // prepare panic message formatting
     panic_begin();
 
@@ -124,6 +144,12 @@ void HardFault_Handler_C(hardfault_stack_frame_t *stack_frame, uint32_t lr_value
         panic_printf("SCB->BFAR = 0x%08lx\n", SCB->BFAR);
     }
 
+    // - stacking errors are usually caused by a stack overflow
+    if ((SCB->CFSR & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_STKERR_Msk)) != 0)
+    {
+        panic_printf("- stacking error, possible stack overflow\n");
+    }
+
     // - CFSR flag names
     //  * memory management fault
     //  * bus fault
@@ -135,9 +161,13 @@ void HardFault_Handler_C(hardfault_stack_frame_t *stack_frame, uint32_t lr_value
     }
 #endif
 
-    // - stack frame
+    // - stack frame, and the call chain leading to it
     panic_printf("- Stack frame:\n");
     print_stack_frame(stack_frame);
+    if ((SCB->CFSR & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_STKERR_Msk)) == 0)
+    {
+        print_backtrace(stack_frame, lr_value);
+    }
 
     // - misc
     //  * LR value
@@ -149,6 +179,11 @@ void HardFault_Handler_C(hardfault_stack_frame_t *stack_frame, uint32_t lr_value
 
     // end panic message and halt
     panic_end();
+
+#if defined(CORE_CRASH_RECORD) && !defined(__CORE_DEBUG)
+    // without core debug, panic_end() does nothing. reset, so the crash record can be read after reboot
+    NVIC_SystemReset();
+#endif
 }
 
 /**
@@ -165,3 +200,125 @@ __attribute__((naked)) void HardFault_Handler(void)
         " b HardFault_Handler_C \n" // call handler in C
     );
 }
+
+#ifdef CORE_STACK_GUARD
+/**
+ * @brief memory management fault handler in C, called by assembly wrapper
+ * @note only enabled with the stack guard. runs with the MPU disabled, on a reset main stack if the faulting one
+ *       had no room left. see MemManage_Handler()
+ */
+void MemManage_Handler_C(hardfault_stack_frame_t *stack_frame, uint32_t lr_value)
+{
+    // a fault while stacking means the exception frame could not be written
+    const bool stacking_fault = (SCB->CFSR & (SCB_CFSR_MSTKERR_Msk | SCB_CFSR_MLSPERR_Msk)) != 0;
+    const bool guard_access = (SCB->CFSR & SCB_CFSR_MMARVALID_Msk) != 0 && core_stack_is_guard_address(SCB->MMFAR);
+
+    crash_record_save_fault(stacking_fault || guard_access ? CRASH_TYPE_STACK_OVERFLOW : CRASH_TYPE_MEMMANAGE,
+                            stack_frame->raw, lr_value, !stacking_fault);
+
+    // prepare panic message formatting
+    panic_begin();
+
+    // print panic message:
+    // - header
+    if (stacking_fault || guard_access)
+    {
+        panic_printf("\n\n*** STACK OVERFLOW ***\n");
+    }
+    else
+    {
+        panic_printf("\n\n*** MEMMANAGE FAULT ***\n");
+    }
+
+    // - fault status registers
+    panic_printf("- FSR / FAR:\n");
+    panic_printf("SCB->CFSR = 0x%08lx\n", SCB->CFSR);
+    if ((SCB->CFSR & SCB_CFSR_MMARVALID_Msk) != 0)
+    {
+        panic_printf("SCB->MMFAR = 0x%08lx\n", SCB->MMFAR);
+    }
+
+    // - stack frame, only if it was written
+    panic_printf("- Stack frame:\n");
+    if (stacking_fault)
+    {
+        panic_printf("SP = 0x%08lx (frame not stacked)\n", (uint32_t)stack_frame);
+    }
+    else
+    {
+        print_stack_frame(stack_frame);
+        print_backtrace(stack_frame, lr_value);
+    }
+
+    // - misc
+    //  * LR value
+    panic_printf("- Misc:\n");
+    panic_printf("LR = 0x%08lx\n", lr_value);
+
+    // - footer
+    panic_printf("***\n\n");
+
+    // end panic message and halt
+    panic_end();
+
+#if defined(CORE_CRASH_RECORD) && !defined(__CORE_DEBUG)
+    // without core debug, panic_end() does nothing. reset, so the crash record can be read after reboot
+    NVIC_SystemReset();
+#endif
+}
+
+/**
+ * @brief stack space the memory management fault handler needs, in bytes
+ * @note a fault taken with the main stack pointer closer than this to the guard region switches to a reset main stack
+ */
+#define MEMMANAGE_HANDLER_STACK_SIZE 1024
+
+extern uint8_t __StackLimit[];
+
+/**
+ * @brief lowest main stack pointer the memory management fault handler still runs on
+ * @note the guard base is __StackLimit aligned up to CORE_STACK_GUARD_SIZE, so the guard ends below
+ *       __StackLimit + 2 * CORE_STACK_GUARD_SIZE
+ */
+__attribute__((used)) static const uint8_t *const memmanage_stack_limit =
+    __StackLimit + (2 * CORE_STACK_GUARD_SIZE) + MEMMANAGE_HANDLER_STACK_SIZE;
+
+/**
+ * @brief memory management fault handler wrapper in assembly
+ * @note the MPU is disabled, so the handler may touch the guard region.
+ *       if the fault was taken on the main stack and that stack cannot hold the handler (a stacking fault, or the
+ *       stack pointer is in or near the guard region), the main stack is reset to its top. the exception frame and
+ *       the faulting stack are at the bottom of the stack then, so the handler does not overwrite them.
+ *       otherwise, the handler runs on the current main stack, below the exception frame
+ */
+__attribute__((naked)) void MemManage_Handler(void)
+{
+    asm volatile(
+        " tst lr, #4                       \n" // check if we're using the MSP or PSP
+        " ite eq                           \n" // if equal, we're using the MSP
+        " mrseq r0, msp                    \n" //  * using MSP, load MSP into r0
+        " mrsne r0, psp                    \n" //  * using PSP, load PSP into r0
+        " mov r1, lr                       \n" // load LR into r1
+        " ldr r2, =0xE000ED94              \n" // disable the MPU (MPU->CTRL = 0)
+        " mov r3, #0                       \n"
+        " str r3, [r2]                     \n"
+        " dsb                              \n"
+        " isb                              \n"
+        " tst r1, #4                       \n" // taken on the PSP: the handler runs on the MSP, which did not fault
+        " bne 2f                           \n"
+        " ldr r2, =0xE000ED28              \n" // stacking fault (CFSR.MSTKERR, MUNSTKERR or MLSPERR)?
+        " ldr r2, [r2]                     \n"
+        " tst r2, #0x38                    \n"
+        " bne 1f                           \n"
+        " ldr r2, =memmanage_stack_limit   \n" // stack pointer in or near the guard region?
+        " ldr r2, [r2]                     \n"
+        " cmp r0, r2                       \n"
+        " bhs 2f                           \n"
+        "1:                                \n"
+        " ldr r2, =__StackTop              \n" // reset the MSP to the top of the stack
+        " msr msp, r2                      \n"
+        "2:                                \n"
+        " b MemManage_Handler_C            \n" // call handler in C
+    );
+}
+#endif // CORE_STACK_GUARD
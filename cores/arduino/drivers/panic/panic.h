@@ -1,5 +1,7 @@
 #pragma once
 #include <stdlib.h>
+#include "crash_record.h"
+#include "backtrace.h"
 
 // only enable panic print if at least one output is defined
 #define PANIC_PRINT_ENABLED          \
@@ -53,10 +55,12 @@ extern "C"
      */
     inline void _panic(const char *message)
     {
+        crash_record_save_panic(message);
         if (message != NULL)
         {
             panic_begin();
             panic_printf(message);
+            backtrace_print_current();
         }
 
         panic_end();
@@ -93,7 +97,7 @@ extern "C"
 
     #define panic_begin()
     #define panic_printf(fmt, ...)
-    #define panic(msg) panic_end()
+    #define panic(msg) do { crash_record_save_panic(NULL); panic_end(); } while (0)
 
 #endif // PANIC_PRINT_ENABLED
 #else  // !__CORE_DEBUG
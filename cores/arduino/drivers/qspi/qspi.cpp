@@ -0,0 +1,394 @@
+#include "qspi.h"
+#include "../sysclock/sysclock.h"
+#include "../sysclock/systick.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+#include "../../yield.h"
+#include <string.h>
+
+//
+// QSPI registers, as offsets from the register base
+//
+#define QSPI_CR 0x00ul
+#define QSPI_CSCR 0x04ul
+#define QSPI_FCR 0x08ul
+#define QSPI_SR 0x0Cul
+#define QSPI_DCOM 0x10ul
+#define QSPI_XCMD 0x18ul
+
+// CR
+#define CR_MDSW_MASK 0x7ul
+#define CR_PFE (1ul << 3)
+#define CR_PFSAE (1ul << 4)
+#define CR_DCOME (1ul << 5)
+#define CR_DIV_POS 16
+
+// CSCR: chip select high for at least 2 cycles between commands
+#define CSCR_SSHW_2 0x1ul
+
+// FCR
+#define FCR_AWSL_3_BYTES 0x2ul
+#define FCR_DMCYCN_POS 8
+#define FCR_DMCYCN_MASK (0xFul << FCR_DMCYCN_POS)
+
+// SR
+#define SR_BUSY (1ul << 0)
+
+// flash commands
+#define FLASH_WRITE_STATUS 0x01
+#define FLASH_PAGE_PROGRAM 0x02
+#define FLASH_READ_STATUS_1 0x05
+#define FLASH_WRITE_ENABLE 0x06
+#define FLASH_SECTOR_ERASE 0x20
+#define FLASH_READ_STATUS_2 0x35
+#define FLASH_JEDEC_ID 0x9F
+#define FLASH_CHIP_ERASE 0xC7
+#define FLASH_BLOCK_ERASE 0xD8
+
+// status register bits
+#define FLASH_SR1_WIP (1u << 0)
+#define FLASH_SR1_QE (1u << 6)
+#define FLASH_SR2_QE (1u << 1)
+
+// typical worst-case times of the flash operations, in milliseconds
+#define QSPI_PROGRAM_TIMEOUT 10ul
+#define QSPI_STATUS_TIMEOUT 50ul
+#define QSPI_SECTOR_ERASE_TIMEOUT 500ul
+#define QSPI_BLOCK_ERASE_TIMEOUT 3000ul
+#define QSPI_CHIP_ERASE_TIMEOUT 400000ul
+
+static qspi_config_t config = {};
+static uint32_t jedec_id = 0;
+static bool running = false;
+
+static inline volatile uint32_t &reg(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_QSPI) + offset);
+}
+
+//
+// direct communication
+//
+
+/**
+ * @brief assert chip select, and send a command byte
+ * @note the mapped region cannot be read until command_end()
+ */
+static void command_begin(const uint8_t command)
+{
+    // let a running memory-mapped read finish first
+    while ((reg(QSPI_SR) & SR_BUSY) != 0)
+        ;
+
+    reg(QSPI_CR) |= CR_DCOME;
+    reg(QSPI_DCOM) = command;
+}
+
+static inline void command_write(const uint8_t value)
+{
+    reg(QSPI_DCOM) = value;
+}
+
+static inline uint8_t command_read(void)
+{
+    return uint8_t(reg(QSPI_DCOM));
+}
+
+static inline void command_address(const uint32_t address)
+{
+    command_write(uint8_t(address >> 16));
+    command_write(uint8_t(address >> 8));
+    command_write(uint8_t(address));
+}
+
+/**
+ * @brief release chip select, and return to memory-mapped reads
+ */
+static void command_end(void)
+{
+    reg(QSPI_CR) &= ~CR_DCOME;
+}
+
+/**
+ * @brief send a command without address or data
+ */
+static void send_command(const uint8_t command)
+{
+    const uint32_t critical = core_critical_enter();
+    command_begin(command);
+    command_end();
+    core_critical_exit(critical);
+}
+
+static uint8_t read_status(const uint8_t command)
+{
+    const uint32_t critical = core_critical_enter();
+    command_begin(command);
+    const uint8_t status = command_read();
+    command_end();
+    core_critical_exit(critical);
+    return status;
+}
+
+/**
+ * @brief wait until the flash finished a program, erase or status write
+ * @return false on timeout
+ */
+static bool wait_ready(const uint32_t timeout)
+{
+    const uint32_t start = systick_millis();
+    while ((read_status(FLASH_READ_STATUS_1) & FLASH_SR1_WIP) != 0)
+    {
+        if ((systick_millis() - start) >= timeout)
+        {
+            CORE_DEBUG_PRINTF("qspi: flash did not finish within %lu ms\n", timeout);
+            return false;
+        }
+
+        yield();
+    }
+
+    return true;
+}
+
+/**
+ * @brief restart the prefetch of memory-mapped reads, so no data from before a change of the flash is returned
+ */
+static void restart_prefetch(void)
+{
+    reg(QSPI_CR) &= ~CR_PFE;
+    reg(QSPI_CR) |= CR_PFE;
+}
+
+/**
+ * @brief set the quad enable bit of the flash, if it is not set already
+ */
+static bool set_quad_enable(void)
+{
+    const uint8_t sr1 = read_status(FLASH_READ_STATUS_1);
+    const uint8_t sr2 = read_status(FLASH_READ_STATUS_2);
+
+    uint8_t values[2];
+    uint8_t count;
+    switch (config.quad_enable)
+    {
+    case QSPI_QE_SR2_BIT1:
+        if ((sr2 & FLASH_SR2_QE) != 0)
+        {
+            return true;
+        }
+        values[0] = sr1;
+        values[1] = sr2 | FLASH_SR2_QE;
+        count = 2;
+        break;
+    case QSPI_QE_SR1_BIT6:
+        if ((sr1 & FLASH_SR1_QE) != 0)
+        {
+            return true;
+        }
+        values[0] = sr1 | FLASH_SR1_QE;
+        count = 1;
+        break;
+    case QSPI_QE_NONE:
+    default:
+        return true;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    command_begin(FLASH_WRITE_ENABLE);
+    command_end();
+    command_begin(FLASH_WRITE_STATUS);
+    for (uint8_t i = 0; i < count; i++)
+    {
+        command_write(values[i]);
+    }
+    command_end();
+    core_critical_exit(critical);
+    return wait_ready(QSPI_STATUS_TIMEOUT);
+}
+
+/**
+ * @brief dummy cycles usually required by a read mode
+ */
+static uint8_t default_dummy_cycles(const qspi_read_mode_t mode)
+{
+    switch (mode)
+    {
+    case QSPI_READ_DUAL_IO:
+        return 4; // mode byte on 2 lines
+    case QSPI_READ_QUAD_IO:
+        return 6; // mode byte on 4 lines, and 4 dummy cycles
+    case QSPI_READ_STANDARD:
+    case QSPI_READ_FAST:
+    case QSPI_READ_DUAL_OUTPUT:
+    case QSPI_READ_QUAD_OUTPUT:
+    default:
+        return 8;
+    }
+}
+
+//
+// public API
+//
+
+bool qspi_begin(const qspi_config_t *qspi_config)
+{
+    CORE_ASSERT(qspi_config != NULL, "qspi_begin: config is NULL", return false);
+    CORE_ASSERT(qspi_config->frequency > 0, "qspi_begin: frequency is 0", return false);
+    config = *qspi_config;
+
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_QSPI, Enable);
+
+    stc_port_init_t pin_config = {};
+    pin_config.enPinMode = Pin_Mode_Out;
+    pin_config.enPinDrv = Pin_Drv_H;
+    const gpio_pin_t pins[] = {config.sck, config.cs, config.io0, config.io1, config.io2, config.io3};
+    for (const gpio_pin_t pin : pins)
+    {
+        GPIO_Init(pin, &pin_config);
+        GPIO_SetFunc(pin, Func_Qspi);
+    }
+
+    // SPI clock: HCLK / divider, with divider 2 - 64 set as divider - 1
+    uint32_t divider = (SYSTEM_CLOCK_FREQUENCIES.hclk + config.frequency - 1) / config.frequency;
+    divider = divider < 2 ? 2 : (divider > 64 ? 64 : divider);
+
+    // flash commands always start from the standard read mode, the read mode is set after the flash was set up
+    reg(QSPI_CR) = ((divider - 1) << CR_DIV_POS) | CR_PFSAE;
+    reg(QSPI_CSCR) = CSCR_SSHW_2;
+    reg(QSPI_XCMD) = 0xFF; // mode byte that keeps the flash out of continuous read mode
+
+    jedec_id = 0;
+    const uint32_t critical = core_critical_enter();
+    command_begin(FLASH_JEDEC_ID);
+    for (int i = 0; i < 3; i++)
+    {
+        jedec_id = (jedec_id << 8) | command_read();
+    }
+    command_end();
+    core_critical_exit(critical);
+
+    if (jedec_id == 0 || jedec_id == 0xFFFFFFul)
+    {
+        CORE_DEBUG_PRINTF("qspi: no flash found\n");
+        PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_QSPI, Disable);
+        return false;
+    }
+
+    const bool quad = config.read_mode == QSPI_READ_QUAD_OUTPUT || config.read_mode == QSPI_READ_QUAD_IO;
+    if (quad && !set_quad_enable())
+    {
+        CORE_DEBUG_PRINTF("qspi: could not set the quad enable bit\n");
+        PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_QSPI, Disable);
+        return false;
+    }
+
+    uint8_t dummy_cycles = config.dummy_cycles != 0 ? config.dummy_cycles : default_dummy_cycles(config.read_mode);
+    dummy_cycles = dummy_cycles < 3 ? 3 : (dummy_cycles > 18 ? 18 : dummy_cycles);
+    reg(QSPI_FCR) = FCR_AWSL_3_BYTES | ((uint32_t(dummy_cycles) - 3) << FCR_DMCYCN_POS);
+    reg(QSPI_CR) = (reg(QSPI_CR) & ~CR_MDSW_MASK) | uint32_t(config.read_mode) | CR_PFE;
+
+    running = true;
+    CORE_DEBUG_PRINTF("qspi: flash %06lx, %lu Hz, read mode %d\n",
+                      jedec_id,
+                      SYSTEM_CLOCK_FREQUENCIES.hclk / divider,
+                      int(config.read_mode));
+    return true;
+}
+
+void qspi_end(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    reg(QSPI_CR) &= ~(CR_PFE | CR_MDSW_MASK);
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_QSPI, Disable);
+    running = false;
+}
+
+uint32_t qspi_jedec_id(void)
+{
+    return jedec_id;
+}
+
+void qspi_read(const uint32_t address, void *buffer, const size_t length)
+{
+    CORE_ASSERT(running, "qspi_read: not started", return);
+    memcpy(buffer, qspi_mapped_address(address), length);
+}
+
+/**
+ * @brief send an erase command, and wait until it finished
+ */
+static bool erase(const uint8_t command, const uint32_t address, const bool with_address, const uint32_t timeout)
+{
+    CORE_ASSERT(running, "qspi: erase before qspi_begin()", return false);
+
+    const uint32_t critical = core_critical_enter();
+    command_begin(FLASH_WRITE_ENABLE);
+    command_end();
+    command_begin(command);
+    if (with_address)
+    {
+        command_address(address);
+    }
+    command_end();
+    core_critical_exit(critical);
+
+    const bool ok = wait_ready(timeout);
+    restart_prefetch();
+    return ok;
+}
+
+bool qspi_erase_sector(const uint32_t address)
+{
+    return erase(FLASH_SECTOR_ERASE, address, true, QSPI_SECTOR_ERASE_TIMEOUT);
+}
+
+bool qspi_erase_block(const uint32_t address)
+{
+    return erase(FLASH_BLOCK_ERASE, address, true, QSPI_BLOCK_ERASE_TIMEOUT);
+}
+
+bool qspi_erase_chip(void)
+{
+    return erase(FLASH_CHIP_ERASE, 0, false, QSPI_CHIP_ERASE_TIMEOUT);
+}
+
+bool qspi_program(const uint32_t address, const void *data, const size_t length)
+{
+    CORE_ASSERT(running, "qspi_program: not started", return false);
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    uint32_t offset = address;
+    size_t remaining = length;
+    bool ok = true;
+    while (ok && remaining > 0)
+    {
+        // a page program wraps around at the page boundary, so it must not cross one
+        const size_t page_left = QSPI_PAGE_SIZE - (offset % QSPI_PAGE_SIZE);
+        const size_t chunk = remaining < page_left ? remaining : page_left;
+
+        const uint32_t critical = core_critical_enter();
+        command_begin(FLASH_WRITE_ENABLE);
+        command_end();
+        command_begin(FLASH_PAGE_PROGRAM);
+        command_address(offset);
+        for (size_t i = 0; i < chunk; i++)
+        {
+            command_write(bytes[i]);
+        }
+        command_end();
+        core_critical_exit(critical);
+
+        ok = wait_ready(QSPI_PROGRAM_TIMEOUT);
+        bytes += chunk;
+        offset += chunk;
+        remaining -= chunk;
+    }
+
+    restart_prefetch();
+    return ok;
+}
@@ -0,0 +1,168 @@
+/**
+ * external NOR flash on the QSPI peripheral:
+ *
+ * the flash is mapped into the address space at QSPI_MAPPED_BASE, so data (fonts, bitmaps, tables) can be read in
+ * place like internal flash, e.g. with qspi_mapped_address(). the controller translates every read of the region
+ * into a read command, using the configured single, dual or quad read mode, and prefetches sequential data.
+ *
+ * erase and program use the direct communication mode of the controller. while they run, the mapped region must
+ * not be read: the waits for the flash call yield(), so yield hooks must not read the region either.
+ *
+ * flashes with 3-byte addresses (up to 16 MB) and the common commands (JEDEC 9Fh, 02h page program, 20h / D8h / C7h
+ * erase) are supported.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include <stddef.h>
+#include "../gpio/gpio.h"
+
+/**
+ * @brief start of the memory-mapped flash region
+ */
+#define QSPI_MAPPED_BASE 0x98000000ul
+
+/**
+ * @brief size of a program page, in bytes
+ */
+#define QSPI_PAGE_SIZE 256
+
+/**
+ * @brief sizes of the erase units, in bytes
+ */
+#define QSPI_SECTOR_SIZE 4096ul
+#define QSPI_BLOCK_SIZE 65536ul
+
+/**
+ * @brief read command used for memory-mapped reads
+ */
+typedef enum qspi_read_mode_t
+{
+    QSPI_READ_STANDARD = 0,    // 03h, 1-1-1, no dummy cycles. at most ~50 MHz on most flashes
+    QSPI_READ_FAST = 1,        // 0Bh, 1-1-1
+    QSPI_READ_DUAL_OUTPUT = 2, // 3Bh, 1-1-2
+    QSPI_READ_DUAL_IO = 3,     // BBh, 1-2-2
+    QSPI_READ_QUAD_OUTPUT = 4, // 6Bh, 1-1-4
+    QSPI_READ_QUAD_IO = 5,     // EBh, 1-4-4
+} qspi_read_mode_t;
+
+/**
+ * @brief how the quad enable (QE) bit of the flash is set, for the quad read modes
+ */
+typedef enum qspi_quad_enable_t
+{
+    QSPI_QE_NONE,     // QE is set already, or IO2 / IO3 are always data pins
+    QSPI_QE_SR2_BIT1, // status register 2, bit 1. written together with SR1 by 01h (Winbond, GigaDevice)
+    QSPI_QE_SR1_BIT6, // status register 1, bit 6 (Macronix, ISSI)
+} qspi_quad_enable_t;
+
+/**
+ * @brief pins and read mode of the flash
+ */
+struct qspi_config_t
+{
+    /**
+     * @brief the pins. io2 and io3 are only used with the quad read modes, hold / write protect otherwise
+     */
+    gpio_pin_t sck;
+    gpio_pin_t cs;
+    gpio_pin_t io0;
+    gpio_pin_t io1;
+    gpio_pin_t io2;
+    gpio_pin_t io3;
+
+    /**
+     * @brief the read mode of memory-mapped reads
+     */
+    qspi_read_mode_t read_mode;
+
+    /**
+     * @brief dummy cycles of the read command, 3 - 18. 0 for the usual value of the read mode
+     * @note for QSPI_READ_DUAL_IO and QSPI_READ_QUAD_IO, this includes the cycles of the mode byte
+     */
+    uint8_t dummy_cycles;
+
+    /**
+     * @brief how to set the quad enable bit
+     */
+    qspi_quad_enable_t quad_enable;
+
+    /**
+     * @brief maximum SPI clock, in Hz. the clock is HCLK divided by 2 - 64
+     */
+    uint32_t frequency;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief initialize the QSPI peripheral and the flash, and enable memory-mapped reads
+     * @param config pins and read mode. copied
+     * @return false if no flash responded to the JEDEC id command
+     */
+    bool qspi_begin(const qspi_config_t *config);
+
+    /**
+     * @brief stop the QSPI peripheral
+     */
+    void qspi_end(void);
+
+    /**
+     * @brief get the JEDEC id of the flash
+     * @return manufacturer id << 16 | memory type << 8 | capacity, as read by qspi_begin()
+     * @note the capacity byte is log2 of the size in bytes on most flashes
+     */
+    uint32_t qspi_jedec_id(void);
+
+    /**
+     * @brief get the address of flash data in the memory-mapped region
+     * @param address address in the flash
+     */
+    inline const void *qspi_mapped_address(const uint32_t address)
+    {
+        return reinterpret_cast<const void *>(QSPI_MAPPED_BASE + address);
+    }
+
+    /**
+     * @brief read flash data to a buffer
+     * @param address address in the flash
+     * @param buffer the buffer
+     * @param length number of bytes
+     */
+    void qspi_read(const uint32_t address, void *buffer, const size_t length);
+
+    /**
+     * @brief erase a 4 KB sector
+     * @param address address in the sector
+     * @return false on timeout
+     */
+    bool qspi_erase_sector(const uint32_t address);
+
+    /**
+     * @brief erase a 64 KB block
+     * @param address address in the block
+     * @return false on timeout
+     */
+    bool qspi_erase_block(const uint32_t address);
+
+    /**
+     * @brief erase the whole flash
+     * @return false on timeout
+     * @note takes up to minutes on large flashes
+     */
+    bool qspi_erase_chip(void);
+
+    /**
+     * @brief program data into erased flash
+     * @param address address in the flash
+     * @param data the data. must not be in the memory-mapped region
+     * @param length number of bytes. split into page program commands at the page boundaries
+     * @return false on timeout
+     */
+    bool qspi_program(const uint32_t address, const void *data, const size_t length);
+
+#ifdef __cplusplus
+}
+#endif
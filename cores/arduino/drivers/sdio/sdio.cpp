@@ -0,0 +1,929 @@
+#include "sdio.h"
+#include "../dma/dma.h"
+#include "../sysclock/sysclock.h"
+#include "../sysclock/systick.h"
+#include "../../core_debug.h"
+#include "../../yield.h"
+#include <string.h>
+
+//
+// SDIOC registers, as offsets from the register base
+//
+#define SDIOC_BLKSIZE 0x04ul
+#define SDIOC_BLKCNT 0x06ul
+#define SDIOC_ARG 0x08ul
+#define SDIOC_TRANSMODE 0x0Cul
+#define SDIOC_CMD 0x0Eul
+#define SDIOC_RESP 0x10ul // RESP0 - RESP7
+#define SDIOC_BUF 0x20ul
+#define SDIOC_PSTAT 0x24ul
+#define SDIOC_HOSTCON 0x28ul
+#define SDIOC_PWRCON 0x29ul
+#define SDIOC_CLKCON 0x2Cul
+#define SDIOC_TOUTCON 0x2Eul
+#define SDIOC_SFTRST 0x2Ful
+#define SDIOC_NORINTST 0x30ul
+#define SDIOC_ERRINTST 0x32ul
+#define SDIOC_NORINTSTEN 0x34ul
+#define SDIOC_ERRINTSTEN 0x36ul
+
+// TRANSMODE
+#define TRANSMODE_BCE (1u << 1)
+#define TRANSMODE_ATCEN_CMD12 (1u << 2)
+#define TRANSMODE_DDIR_READ (1u << 4)
+#define TRANSMODE_MULB (1u << 5)
+
+// CMD: response type, checks and data
+#define CMD_RESP_NONE 0x0u
+#define CMD_RESP_136 0x1u
+#define CMD_RESP_48 0x2u
+#define CMD_RESP_48_BUSY 0x3u
+#define CMD_CCE (1u << 3)
+#define CMD_ICE (1u << 4)
+#define CMD_DAT (1u << 5)
+#define CMD_IDX_POS 8
+
+// response formats of the SD specification
+#define RESP_R1 (CMD_RESP_48 | CMD_CCE | CMD_ICE)
+#define RESP_R1B (CMD_RESP_48_BUSY | CMD_CCE | CMD_ICE)
+#define RESP_R2 (CMD_RESP_136 | CMD_CCE)
+#define RESP_R3 (CMD_RESP_48)
+#define RESP_R6 RESP_R1
+#define RESP_R7 RESP_R1
+
+// PSTAT
+#define PSTAT_CIC (1ul << 0)
+#define PSTAT_CID (1ul << 1)
+
+// HOSTCON
+#define HOSTCON_DW (1u << 1)
+
+// PWRCON
+#define PWRCON_PWON (1u << 0)
+
+// CLKCON
+#define CLKCON_ICE (1u << 0)
+#define CLKCON_CE (1u << 2)
+#define CLKCON_FS_POS 8
+
+// TOUTCON: data timeout of 2^27 SD clocks
+#define TOUTCON_DTO_MAX 0xEu
+
+// SFTRST
+#define SFTRST_RSTA (1u << 0)
+#define SFTRST_RSTC (1u << 1)
+#define SFTRST_RSTD (1u << 2)
+
+// NORINTST
+#define NORINTST_CC (1u << 0)
+#define NORINTST_TC (1u << 1)
+#define NORINTST_BWR (1u << 4)
+#define NORINTST_BRR (1u << 5)
+#define NORINTST_EI (1u << 15)
+
+// SD commands
+#define SD_CMD0_GO_IDLE_STATE 0
+#define SD_CMD2_ALL_SEND_CID 2
+#define SD_CMD3_SEND_RELATIVE_ADDR 3
+#define SD_CMD7_SELECT_CARD 7
+#define SD_CMD8_SEND_IF_COND 8
+#define SD_CMD9_SEND_CSD 9
+#define SD_CMD12_STOP_TRANSMISSION 12
+#define SD_CMD13_SEND_STATUS 13
+#define SD_CMD16_SET_BLOCKLEN 16
+#define SD_CMD17_READ_SINGLE_BLOCK 17
+#define SD_CMD18_READ_MULTIPLE_BLOCK 18
+#define SD_CMD24_WRITE_BLOCK 24
+#define SD_CMD25_WRITE_MULTIPLE_BLOCK 25
+#define SD_CMD55_APP_CMD 55
+#define SD_ACMD6_SET_BUS_WIDTH 6
+#define SD_ACMD41_SD_SEND_OP_COND 41
+
+// CMD8 argument: 2.7 - 3.6 V, check pattern 0xAA
+#define SD_IF_COND_ARG 0x1AAul
+
+// ACMD41 argument and OCR bits
+#define SD_OCR_VOLTAGE_WINDOW 0x00FF8000ul
+#define SD_OCR_HCS (1ul << 30)
+#define SD_OCR_BUSY (1ul << 31)
+
+// card status (R1)
+#define SD_STATUS_READY_FOR_DATA (1ul << 8)
+#define SD_STATUS_STATE(status) (((status) >> 9) & 0xFul)
+#define SD_STATE_TRAN 4
+
+// clock while identifying the card
+#define SDIO_IDENTIFY_FREQUENCY 400000ul
+
+// timeouts, in milliseconds
+#define SDIO_COMMAND_TIMEOUT 100ul
+#define SDIO_INIT_TIMEOUT 1000ul
+#define SDIO_DATA_TIMEOUT 500ul
+#define SDIO_BUSY_TIMEOUT 1000ul
+
+// limit of BLKCNT and of the DMA transfer count
+#define SDIO_MAX_BLOCKS_PER_COMMAND 0xFFFFul
+
+// a DMA block moves one sector, triggered by buffer read / write ready
+#define SDIO_DMA_BLOCK_SIZE (SDIO_SECTOR_SIZE / 4)
+
+/**
+ * @brief who started the running data transfer?
+ */
+enum sdio_transfer_owner_t
+{
+    TRANSFER_NONE,
+    TRANSFER_USER,
+    TRANSFER_READAHEAD,
+};
+
+struct sdio_state_t
+{
+    sdio_config_t config;
+    sdio_card_info_t card;
+    bool ready;
+
+    /**
+     * @brief DMA channel of data transfers. assigned in sdio_begin()
+     */
+    dma_channel_t channel;
+
+    /**
+     * @brief the running DMA transfer
+     */
+    sdio_transfer_owner_t transfer;
+    uint32_t transfer_start;
+    uint32_t transfer_timeout;
+
+    /**
+     * @brief result of the last background read started by sdio_read_sectors_async()
+     */
+    bool user_result;
+
+    /**
+     * @brief sector following the last read, to detect sequential reads
+     */
+    uint32_t next_sequential;
+
+    /**
+     * @brief sectors held by (or being read into) the read-ahead buffer
+     */
+    uint32_t readahead_sector;
+    uint32_t readahead_count;
+    bool readahead_valid;
+};
+
+static sdio_state_t state = {};
+
+#if SDIO_READAHEAD_SECTORS > 0
+static uint32_t readahead_buffer[(SDIO_READAHEAD_SECTORS * SDIO_SECTOR_SIZE) / 4];
+#endif
+
+static inline volatile uint8_t &reg8(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint8_t *>(reinterpret_cast<uint32_t>(state.config.unit) + offset);
+}
+
+static inline volatile uint16_t &reg16(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint16_t *>(reinterpret_cast<uint32_t>(state.config.unit) + offset);
+}
+
+static inline volatile uint32_t &reg32(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(state.config.unit) + offset);
+}
+
+static inline bool is_unit_1(void)
+{
+    return state.config.unit == M4_SDIOC1;
+}
+
+static inline bool timed_out(const uint32_t start, const uint32_t timeout)
+{
+    return (systick_millis() - start) >= timeout;
+}
+
+//
+// host controller
+//
+
+/**
+ * @brief reset parts of the host controller
+ * @param mask SFTRST_RSTA, SFTRST_RSTC, SFTRST_RSTD
+ */
+static void host_reset(const uint8_t mask)
+{
+    reg8(SDIOC_SFTRST) = mask;
+    while ((reg8(SDIOC_SFTRST) & mask) != 0)
+        ;
+}
+
+static inline void clear_status(void)
+{
+    reg16(SDIOC_NORINTST) = 0xFFFFu;
+    reg16(SDIOC_ERRINTST) = 0xFFFFu;
+}
+
+/**
+ * @brief set the SD clock to the fastest frequency not above the target
+ * @return the actual frequency
+ */
+static uint32_t set_clock(const uint32_t frequency)
+{
+    // the divider is a power of two, 1 - 256. FS is 0 for 1, and divider / 2 otherwise
+    const uint32_t base = SYSTEM_CLOCK_FREQUENCIES.exclk;
+    uint32_t shift = 0;
+    while (shift < 8 && (base >> shift) > frequency)
+    {
+        shift++;
+    }
+
+    const uint16_t fs = shift == 0 ? 0u : uint16_t(1u << (shift - 1));
+    reg16(SDIOC_CLKCON) = 0;
+    reg16(SDIOC_CLKCON) = uint16_t((fs << CLKCON_FS_POS) | CLKCON_ICE);
+    reg16(SDIOC_CLKCON) |= CLKCON_CE;
+    return base >> shift;
+}
+
+/**
+ * @brief send a command, and wait for its response
+ * @param index command index
+ * @param argument command argument
+ * @param flags response format (RESP_x), and CMD_DAT for commands with a data transfer
+ * @return false on timeout or error. the command line is reset
+ * @note for RESP_R1B, also waits until the card released the busy signal
+ */
+static bool send_command(const uint8_t index, const uint32_t argument, const uint16_t flags)
+{
+    const uint32_t inhibit = (flags & (CMD_DAT | CMD_RESP_48_BUSY)) != 0 ? (PSTAT_CIC | PSTAT_CID) : PSTAT_CIC;
+    const uint32_t start = systick_millis();
+    while ((reg32(SDIOC_PSTAT) & inhibit) != 0)
+    {
+        if (timed_out(start, SDIO_COMMAND_TIMEOUT))
+        {
+            host_reset(SFTRST_RSTC | SFTRST_RSTD);
+            return false;
+        }
+    }
+
+    clear_status();
+    reg32(SDIOC_ARG) = argument;
+    reg16(SDIOC_CMD) = uint16_t((uint16_t(index) << CMD_IDX_POS) | flags);
+
+    uint16_t status;
+    do
+    {
+        status = reg16(SDIOC_NORINTST);
+        if (timed_out(start, SDIO_COMMAND_TIMEOUT))
+        {
+            status = NORINTST_EI;
+        }
+    } while ((status & (NORINTST_CC | NORINTST_EI)) == 0);
+
+    if ((status & NORINTST_EI) != 0)
+    {
+        host_reset(SFTRST_RSTC);
+        return false;
+    }
+
+    reg16(SDIOC_NORINTST) = NORINTST_CC;
+    if ((flags & CMD_RESP_48_BUSY) == CMD_RESP_48_BUSY)
+    {
+        while ((reg16(SDIOC_NORINTST) & (NORINTST_TC | NORINTST_EI)) == 0)
+        {
+            if (timed_out(start, SDIO_BUSY_TIMEOUT))
+            {
+                host_reset(SFTRST_RSTC | SFTRST_RSTD);
+                return false;
+            }
+        }
+
+        reg16(SDIOC_NORINTST) = NORINTST_TC;
+    }
+
+    return true;
+}
+
+static inline uint32_t response(const uint8_t word)
+{
+    return (&reg32(SDIOC_RESP))[word];
+}
+
+/**
+ * @brief send an application specific command (CMD55 + ACMDx)
+ */
+static bool send_app_command(const uint8_t index, const uint32_t argument, const uint16_t flags)
+{
+    return send_command(SD_CMD55_APP_CMD, uint32_t(state.card.rca) << 16, RESP_R1) &&
+           send_command(index, argument, flags);
+}
+
+//
+// card identification
+//
+
+/**
+ * @brief get bits of a R2 response (CID / CSD)
+ * @param r the response words. the controller strips the CRC, so bit 8 of the register is bit 0 of the words
+ * @param high highest bit, as numbered in the SD specification
+ * @param low lowest bit
+ */
+static uint32_t r2_bits(const uint32_t *r, const uint32_t high, const uint32_t low)
+{
+    uint32_t value = 0;
+    for (uint32_t bit = high + 1; bit-- > low;)
+    {
+        const uint32_t b = bit - 8;
+        value = (value << 1) | ((r[b / 32] >> (b % 32)) & 1);
+    }
+    return value;
+}
+
+/**
+ * @brief read the CSD, and calculate the capacity of the card
+ */
+static bool read_capacity(void)
+{
+    if (!send_command(SD_CMD9_SEND_CSD, uint32_t(state.card.rca) << 16, RESP_R2))
+    {
+        return false;
+    }
+
+    const uint32_t csd[4] = {response(0), response(1), response(2), response(3)};
+    if (r2_bits(csd, 127, 126) == 1)
+    {
+        // CSD version 2.0: C_SIZE in units of 512 KB
+        state.card.sector_count = (r2_bits(csd, 69, 48) + 1) * 1024;
+    }
+    else
+    {
+        // CSD version 1.0: (C_SIZE + 1) * 2^(C_SIZE_MULT + 2) blocks of 2^READ_BL_LEN bytes
+        const uint32_t c_size = r2_bits(csd, 73, 62);
+        const uint32_t c_size_mult = r2_bits(csd, 49, 47);
+        const uint32_t read_bl_len = r2_bits(csd, 83, 80);
+        state.card.sector_count = ((c_size + 1) << (c_size_mult + 2 + read_bl_len)) / SDIO_SECTOR_SIZE;
+    }
+
+    return true;
+}
+
+/**
+ * @brief identify and initialize the card, up to transfer state
+ */
+static bool identify_card(void)
+{
+    if (!send_command(SD_CMD0_GO_IDLE_STATE, 0, CMD_RESP_NONE))
+    {
+        return false;
+    }
+
+    // version 2.00 cards echo the check pattern. older cards do not respond
+    const bool version2 = send_command(SD_CMD8_SEND_IF_COND, SD_IF_COND_ARG, RESP_R7) &&
+                          (response(0) & 0xFFFul) == SD_IF_COND_ARG;
+
+    const uint32_t op_cond = SD_OCR_VOLTAGE_WINDOW | (version2 ? SD_OCR_HCS : 0ul);
+    const uint32_t start = systick_millis();
+    uint32_t ocr = 0;
+    state.card.rca = 0;
+    do
+    {
+        if (timed_out(start, SDIO_INIT_TIMEOUT) || !send_app_command(SD_ACMD41_SD_SEND_OP_COND, op_cond, RESP_R3))
+        {
+            CORE_DEBUG_PRINTF("sdio: card did not leave idle state\n");
+            return false;
+        }
+        ocr = response(0);
+    } while ((ocr & SD_OCR_BUSY) == 0);
+    state.card.high_capacity = (ocr & SD_OCR_HCS) != 0;
+
+    if (!send_command(SD_CMD2_ALL_SEND_CID, 0, RESP_R2) ||
+        !send_command(SD_CMD3_SEND_RELATIVE_ADDR, 0, RESP_R6))
+    {
+        return false;
+    }
+    state.card.rca = uint16_t(response(0) >> 16);
+
+    if (!read_capacity() ||
+        !send_command(SD_CMD7_SELECT_CARD, uint32_t(state.card.rca) << 16, RESP_R1B))
+    {
+        return false;
+    }
+
+    // SDHC / SDXC cards have a fixed block length of 512
+    if (!state.card.high_capacity && !send_command(SD_CMD16_SET_BLOCKLEN, SDIO_SECTOR_SIZE, RESP_R1))
+    {
+        return false;
+    }
+
+    if (state.config.wide_bus)
+    {
+        if (!send_app_command(SD_ACMD6_SET_BUS_WIDTH, 2, RESP_R1))
+        {
+            return false;
+        }
+        reg8(SDIOC_HOSTCON) |= HOSTCON_DW;
+    }
+
+    return true;
+}
+
+//
+// data transfers
+//
+
+/**
+ * @brief sector number to command argument
+ */
+static inline uint32_t card_address(const uint32_t sector)
+{
+    return state.card.high_capacity ? sector : sector * SDIO_SECTOR_SIZE;
+}
+
+/**
+ * @brief start a data transfer
+ * @param read read (true) or write (false)?
+ * @param sector first sector
+ * @param buffer the buffer
+ * @param count number of sectors, at most SDIO_MAX_BLOCKS_PER_COMMAND
+ * @param use_dma move the data by DMA? the buffer must be word aligned. if false, the caller moves the data
+ */
+static bool start_transfer(const bool read, const uint32_t sector, const void *buffer, const uint32_t count, const bool use_dma)
+{
+    if (use_dma)
+    {
+        const uint32_t buf = reinterpret_cast<uint32_t>(&reg32(SDIOC_BUF));
+        stc_dma_config_t config = {
+            .u16BlockSize = SDIO_DMA_BLOCK_SIZE,
+            .u16TransferCnt = uint16_t(count),
+            .u32SrcAddr = read ? buf : reinterpret_cast<uint32_t>(buffer),
+            .u32DesAddr = read ? reinterpret_cast<uint32_t>(buffer) : buf,
+            .u16SrcRptSize = 0,
+            .u16DesRptSize = 0,
+            .stcDmaChCfg = {
+                .enSrcInc = read ? AddressFix : AddressIncrease,
+                .enDesInc = read ? AddressIncrease : AddressFix,
+                .enSrcRptEn = Disable,
+                .enDesRptEn = Disable,
+                .enSrcNseqEn = Disable,
+                .enDesNseqEn = Disable,
+                .enTrnWidth = Dma32Bit,
+                .enLlpEn = Disable,
+                .enIntEn = Disable,
+            },
+        };
+
+        const en_event_src_t trigger = is_unit_1() ? (read ? EVT_SDIOC1_DMAR : EVT_SDIOC1_DMAW)
+                                                   : (read ? EVT_SDIOC2_DMAR : EVT_SDIOC2_DMAW);
+        dma_init(state.channel, &config, trigger);
+        dma_start(state.channel);
+    }
+
+    reg16(SDIOC_BLKSIZE) = SDIO_SECTOR_SIZE;
+    reg16(SDIOC_BLKCNT) = uint16_t(count);
+
+    const bool multi = count > 1;
+    reg16(SDIOC_TRANSMODE) = uint16_t(TRANSMODE_BCE |
+                                      (multi ? (TRANSMODE_MULB | TRANSMODE_ATCEN_CMD12) : 0u) |
+                                      (read ? TRANSMODE_DDIR_READ : 0u));
+
+    const uint8_t command = read ? (multi ? SD_CMD18_READ_MULTIPLE_BLOCK : SD_CMD17_READ_SINGLE_BLOCK)
+                                 : (multi ? SD_CMD25_WRITE_MULTIPLE_BLOCK : SD_CMD24_WRITE_BLOCK);
+    if (!send_command(command, card_address(sector), RESP_R1 | CMD_DAT))
+    {
+        if (use_dma)
+        {
+            dma_stop(state.channel);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief has the running data transfer ended, with or without error?
+ */
+static inline bool transfer_ended(void)
+{
+    return (reg16(SDIOC_NORINTST) & (NORINTST_TC | NORINTST_EI)) != 0 ||
+           timed_out(state.transfer_start, state.transfer_timeout);
+}
+
+/**
+ * @brief collect the result of a data transfer, after transfer_ended()
+ * @return true if the transfer completed without error
+ */
+static bool end_transfer(void)
+{
+    const bool ok = (reg16(SDIOC_NORINTST) & (NORINTST_TC | NORINTST_EI)) == NORINTST_TC;
+    if (!ok)
+    {
+        // abort the card side, and bring the data line back to idle
+        CORE_DEBUG_PRINTF("sdio: data transfer failed, error status 0x%04x\n", reg16(SDIOC_ERRINTST));
+        host_reset(SFTRST_RSTC | SFTRST_RSTD);
+        send_command(SD_CMD12_STOP_TRANSMISSION, 0, RESP_R1B);
+    }
+
+    clear_status();
+    return ok;
+}
+
+/**
+ * @brief start a background DMA transfer
+ */
+static bool start_dma_transfer(const sdio_transfer_owner_t owner, const bool read, const uint32_t sector, const void *buffer, const uint32_t count)
+{
+    state.transfer_start = systick_millis();
+    state.transfer_timeout = SDIO_DATA_TIMEOUT + count;
+    if (!start_transfer(read, sector, buffer, count, true))
+    {
+        return false;
+    }
+
+    state.transfer = owner;
+    return true;
+}
+
+/**
+ * @brief wait for the running background DMA transfer
+ * @return true if it completed without error. true if no transfer was running
+ */
+static bool finish_dma_transfer(void)
+{
+    if (state.transfer == TRANSFER_NONE)
+    {
+        return true;
+    }
+
+    while (!transfer_ended())
+    {
+        yield();
+    }
+
+    dma_stop(state.channel);
+    state.transfer = TRANSFER_NONE;
+    return end_transfer();
+}
+
+/**
+ * @brief finish any background transfer, so a new one can start
+ */
+static void wait_idle(void)
+{
+    switch (state.transfer)
+    {
+    case TRANSFER_USER:
+        state.user_result = finish_dma_transfer();
+        break;
+    case TRANSFER_READAHEAD:
+        state.readahead_valid = finish_dma_transfer();
+        break;
+    case TRANSFER_NONE:
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief move one command worth of sectors by the CPU, for buffers that are not word aligned
+ */
+static bool transfer_pio(const bool read, const uint32_t sector, uint8_t *buffer, const uint32_t count)
+{
+    state.transfer_start = systick_millis();
+    state.transfer_timeout = SDIO_DATA_TIMEOUT + count;
+    if (!start_transfer(read, sector, buffer, count, false))
+    {
+        return false;
+    }
+
+    const uint16_t ready = read ? NORINTST_BRR : NORINTST_BWR;
+    volatile uint32_t &data = reg32(SDIOC_BUF);
+    for (uint32_t block = 0; block < count; block++)
+    {
+        while ((reg16(SDIOC_NORINTST) & (ready | NORINTST_EI)) == 0)
+        {
+            if (timed_out(state.transfer_start, state.transfer_timeout))
+            {
+                return end_transfer();
+            }
+        }
+
+        if ((reg16(SDIOC_NORINTST) & NORINTST_EI) != 0)
+        {
+            return end_transfer();
+        }
+
+        reg16(SDIOC_NORINTST) = ready;
+        for (uint32_t i = 0; i < SDIO_SECTOR_SIZE; i += 4)
+        {
+            uint32_t word;
+            if (read)
+            {
+                word = data;
+                memcpy(buffer + i, &word, sizeof(word));
+            }
+            else
+            {
+                memcpy(&word, buffer + i, sizeof(word));
+                data = word;
+            }
+        }
+        buffer += SDIO_SECTOR_SIZE;
+    }
+
+    while (!transfer_ended())
+    {
+        yield();
+    }
+    return end_transfer();
+}
+
+/**
+ * @brief read or write sectors, in as few commands as possible
+ */
+static bool transfer_sectors(const bool read, uint32_t sector, uint8_t *buffer, uint32_t count)
+{
+    const bool aligned = (reinterpret_cast<uint32_t>(buffer) & 3) == 0;
+    while (count > 0)
+    {
+        const uint32_t chunk = count < SDIO_MAX_BLOCKS_PER_COMMAND ? count : SDIO_MAX_BLOCKS_PER_COMMAND;
+        const bool ok = aligned ? (start_dma_transfer(TRANSFER_USER, read, sector, buffer, chunk) && finish_dma_transfer())
+                                : transfer_pio(read, sector, buffer, chunk);
+        if (!ok)
+        {
+            return false;
+        }
+
+        sector += chunk;
+        buffer += chunk * SDIO_SECTOR_SIZE;
+        count -= chunk;
+    }
+
+    return true;
+}
+
+//
+// read-ahead
+//
+
+#if SDIO_READAHEAD_SECTORS > 0
+/**
+ * @brief copy the part of a read that starts in the read-ahead buffer
+ * @return number of sectors copied
+ */
+static uint32_t read_from_readahead(const uint32_t sector, uint8_t *buffer, const uint32_t count)
+{
+    if (!state.readahead_valid ||
+        sector < state.readahead_sector ||
+        sector >= state.readahead_sector + state.readahead_count)
+    {
+        return 0;
+    }
+
+    const uint32_t available = state.readahead_sector + state.readahead_count - sector;
+    const uint32_t copy = count < available ? count : available;
+    memcpy(buffer,
+           reinterpret_cast<const uint8_t *>(readahead_buffer) + ((sector - state.readahead_sector) * SDIO_SECTOR_SIZE),
+           copy * SDIO_SECTOR_SIZE);
+    return copy;
+}
+
+/**
+ * @brief start reading the sectors following a sequential read in the background
+ */
+static void start_readahead(const uint32_t sector)
+{
+    state.readahead_valid = false;
+    if (sector >= state.card.sector_count)
+    {
+        return;
+    }
+
+    const uint32_t left = state.card.sector_count - sector;
+    state.readahead_sector = sector;
+    state.readahead_count = left < SDIO_READAHEAD_SECTORS ? left : SDIO_READAHEAD_SECTORS;
+    start_dma_transfer(TRANSFER_READAHEAD, true, sector, readahead_buffer, state.readahead_count);
+}
+#endif
+
+//
+// public API
+//
+
+bool sdio_begin(const sdio_config_t *config)
+{
+    CORE_ASSERT(config != NULL, "sdio_begin: config is NULL", return false);
+    CORE_ASSERT(config->unit == M4_SDIOC1 || config->unit == M4_SDIOC2, "sdio_begin: invalid unit", return false);
+
+    if (state.config.unit != NULL)
+    {
+        sdio_end();
+    }
+
+    state.config = *config;
+    state.card = {};
+    state.transfer = TRANSFER_NONE;
+    state.readahead_valid = false;
+    state.next_sequential = 0;
+
+    if (_dma_aa_get(state.channel, "sdio") != Ok)
+    {
+        CORE_DEBUG_PRINTF("sdio: no DMA channel available\n");
+        state.config.unit = NULL;
+        return false;
+    }
+
+    PWC_Fcg1PeriphClockCmd(is_unit_1() ? PWC_FCG1_PERIPH_SDIOC1 : PWC_FCG1_PERIPH_SDIOC2, Enable);
+
+    // the command and data lines are open drain on the card side, and need pull-ups
+    stc_port_init_t pin_config = {};
+    pin_config.enPinMode = Pin_Mode_Out;
+    pin_config.enPinDrv = Pin_Drv_H;
+    GPIO_Init(config->clk, &pin_config);
+    pin_config.enPullUp = Enable;
+    GPIO_Init(config->cmd, &pin_config);
+    GPIO_Init(config->d0, &pin_config);
+    GPIO_SetFunc(config->clk, Func_Sdio);
+    GPIO_SetFunc(config->cmd, Func_Sdio);
+    GPIO_SetFunc(config->d0, Func_Sdio);
+    if (config->wide_bus)
+    {
+        GPIO_Init(config->d1, &pin_config);
+        GPIO_Init(config->d2, &pin_config);
+        GPIO_Init(config->d3, &pin_config);
+        GPIO_SetFunc(config->d1, Func_Sdio);
+        GPIO_SetFunc(config->d2, Func_Sdio);
+        GPIO_SetFunc(config->d3, Func_Sdio);
+    }
+
+    host_reset(SFTRST_RSTA);
+    reg8(SDIOC_PWRCON) = PWRCON_PWON;
+    reg8(SDIOC_TOUTCON) = TOUTCON_DTO_MAX;
+    reg16(SDIOC_NORINTSTEN) = 0xFFFFu;
+    reg16(SDIOC_ERRINTSTEN) = 0xFFFFu;
+    clear_status();
+
+    // identification at 400 kHz, after at least 74 clocks with the card powered
+    set_clock(SDIO_IDENTIFY_FREQUENCY);
+    const uint32_t start = systick_millis();
+    while (!timed_out(start, 2))
+        ;
+
+    if (!identify_card())
+    {
+        CORE_DEBUG_PRINTF("sdio: card initialization failed\n");
+        return false;
+    }
+
+    state.card.frequency = set_clock(SDIO_MAX_FREQUENCY);
+    state.ready = true;
+    CORE_DEBUG_PRINTF("sdio: %s card with %lu sectors, %lu Hz, %d-bit bus\n",
+                      state.card.high_capacity ? "SDHC" : "SDSC",
+                      state.card.sector_count,
+                      state.card.frequency,
+                      state.config.wide_bus ? 4 : 1);
+    return true;
+}
+
+void sdio_end(void)
+{
+    if (state.config.unit == NULL)
+    {
+        return;
+    }
+
+    if (state.ready)
+    {
+        wait_idle();
+    }
+
+    reg16(SDIOC_CLKCON) = 0;
+    reg8(SDIOC_PWRCON) = 0;
+    PWC_Fcg1PeriphClockCmd(is_unit_1() ? PWC_FCG1_PERIPH_SDIOC1 : PWC_FCG1_PERIPH_SDIOC2, Disable);
+
+    dma_resign(state.channel, "sdio");
+    state.config.unit = NULL;
+    state.ready = false;
+    state.readahead_valid = false;
+}
+
+bool sdio_card_ready(void)
+{
+    return state.ready;
+}
+
+const sdio_card_info_t *sdio_card_info(void)
+{
+    return state.ready ? &state.card : NULL;
+}
+
+bool sdio_read_sectors(const uint32_t sector, void *buffer, const uint32_t count)
+{
+    CORE_ASSERT(state.ready, "sdio_read_sectors: no card", return false);
+    CORE_ASSERT(buffer != NULL, "sdio_read_sectors: buffer is NULL", return false);
+
+    uint8_t *bytes = static_cast<uint8_t *>(buffer);
+    uint32_t next = sector;
+    uint32_t remaining = count;
+    wait_idle();
+
+#if SDIO_READAHEAD_SECTORS > 0
+    // serve the start of the read from the read-ahead buffer
+    const bool sequential = sector == state.next_sequential;
+    const uint32_t copied = read_from_readahead(next, bytes, remaining);
+    next += copied;
+    bytes += copied * SDIO_SECTOR_SIZE;
+    remaining -= copied;
+#endif
+
+    if (remaining > 0 && !transfer_sectors(true, next, bytes, remaining))
+    {
+        state.next_sequential = 0;
+        return false;
+    }
+
+    state.next_sequential = sector + count;
+#if SDIO_READAHEAD_SECTORS > 0
+    // keep the buffer if the read ended inside it, otherwise read ahead what follows
+    const bool ends_in_buffer = state.readahead_valid &&
+                                state.next_sequential >= state.readahead_sector &&
+                                state.next_sequential < state.readahead_sector + state.readahead_count;
+    if (sequential && !ends_in_buffer)
+    {
+        start_readahead(state.next_sequential);
+    }
+#endif
+    return true;
+}
+
+bool sdio_write_sectors(const uint32_t sector, const void *buffer, const uint32_t count)
+{
+    CORE_ASSERT(state.ready, "sdio_write_sectors: no card", return false);
+    CORE_ASSERT(buffer != NULL, "sdio_write_sectors: buffer is NULL", return false);
+
+    wait_idle();
+
+    // the write may change sectors in the read-ahead buffer
+    if (state.readahead_valid &&
+        sector < state.readahead_sector + state.readahead_count &&
+        sector + count > state.readahead_sector)
+    {
+        state.readahead_valid = false;
+    }
+
+    // the DMA only reads the buffer
+    return transfer_sectors(false, sector, static_cast<uint8_t *>(const_cast<void *>(buffer)), count);
+}
+
+bool sdio_read_sectors_async(const uint32_t sector, void *buffer, const uint32_t count)
+{
+    CORE_ASSERT(state.ready, "sdio_read_sectors_async: no card", return false);
+    CORE_ASSERT((reinterpret_cast<uint32_t>(buffer) & 3) == 0, "sdio_read_sectors_async: buffer not word aligned", return false);
+    CORE_ASSERT(count > 0 && count <= SDIO_MAX_BLOCKS_PER_COMMAND, "sdio_read_sectors_async: invalid count", return false);
+
+    wait_idle();
+    state.user_result = false;
+    state.next_sequential = sector + count;
+    return start_dma_transfer(TRANSFER_USER, true, sector, buffer, count);
+}
+
+bool sdio_busy(void)
+{
+    return state.transfer != TRANSFER_NONE && !transfer_ended();
+}
+
+bool sdio_wait(void)
+{
+    if (state.transfer == TRANSFER_USER)
+    {
+        state.user_result = finish_dma_transfer();
+    }
+
+    return state.user_result;
+}
+
+bool sdio_sync(void)
+{
+    CORE_ASSERT(state.ready, "sdio_sync: no card", return false);
+    wait_idle();
+
+    const uint32_t start = systick_millis();
+    while (!timed_out(start, SDIO_BUSY_TIMEOUT))
+    {
+        if (!send_command(SD_CMD13_SEND_STATUS, uint32_t(state.card.rca) << 16, RESP_R1))
+        {
+            return false;
+        }
+
+        const uint32_t status = response(0);
+        if ((status & SD_STATUS_READY_FOR_DATA) != 0 && SD_STATUS_STATE(status) == SD_STATE_TRAN)
+        {
+            return true;
+        }
+
+        yield();
+    }
+
+    return false;
+}
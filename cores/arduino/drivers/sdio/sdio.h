@@ -0,0 +1,170 @@
+/**
+ * SD card block device on the SDIOC peripheral:
+ *
+ * initializes SD (SDSC) and SDHC / SDXC cards in 1-bit or 4-bit bus mode, and reads and writes 512 byte sectors.
+ * multi-sector transfers use a single multi-block command (with auto CMD12), moved by DMA when the buffer is word
+ * aligned, so a FAT library plugged into sdio_read_sectors() / sdio_write_sectors() streams files at bus speed.
+ *
+ * sequential reads are read ahead: after a read that continues the previous one, the driver starts reading the
+ * following SDIO_READAHEAD_SECTORS sectors into its own buffer in the background. the next sequential read is
+ * then copied from that buffer, and starts the next read-ahead. while the caller processes one buffer, the card
+ * fills the other one.
+ *
+ * blocking calls wait with yield(), so they must not be used from interrupts.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include "../gpio/gpio.h"
+
+/**
+ * @brief size of a sector, in bytes
+ */
+#define SDIO_SECTOR_SIZE 512
+
+#ifndef SDIO_READAHEAD_SECTORS
+/**
+ * @brief number of sectors read ahead after a sequential read. 0 disables read-ahead
+ * @note the read-ahead buffer is SDIO_READAHEAD_SECTORS * 512 bytes of RAM
+ */
+#define SDIO_READAHEAD_SECTORS 8
+#endif
+
+#ifndef SDIO_MAX_FREQUENCY
+/**
+ * @brief maximum SD clock frequency after initialization, in Hz
+ * @note the card runs in default speed mode, so at most 25 MHz
+ */
+#define SDIO_MAX_FREQUENCY 25000000ul
+#endif
+
+/**
+ * @brief pins and bus of a SD card slot
+ */
+struct sdio_config_t
+{
+    /**
+     * @brief the SDIOC unit. M4_SDIOC1 or M4_SDIOC2
+     */
+    M4_SDIOC_TypeDef *unit;
+
+    /**
+     * @brief the pins. d1 - d3 are only used with wide_bus
+     */
+    gpio_pin_t clk;
+    gpio_pin_t cmd;
+    gpio_pin_t d0;
+    gpio_pin_t d1;
+    gpio_pin_t d2;
+    gpio_pin_t d3;
+
+    /**
+     * @brief use the 4-bit bus?
+     */
+    bool wide_bus;
+};
+
+/**
+ * @brief information about the initialized card
+ */
+struct sdio_card_info_t
+{
+    /**
+     * @brief capacity of the card, in sectors
+     */
+    uint32_t sector_count;
+
+    /**
+     * @brief is the card SDHC / SDXC (block addressing)?
+     */
+    bool high_capacity;
+
+    /**
+     * @brief relative card address
+     */
+    uint16_t rca;
+
+    /**
+     * @brief SD clock frequency, in Hz
+     */
+    uint32_t frequency;
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief initialize the SDIOC unit and the card in the slot
+     * @param config pins and bus of the slot. copied
+     * @return true if a card was found and initialized
+     * @note enables the clock of the unit and sets the pin functions. may be called again after a card change
+     */
+    bool sdio_begin(const sdio_config_t *config);
+
+    /**
+     * @brief stop the SDIOC unit, and release the DMA channel
+     */
+    void sdio_end(void);
+
+    /**
+     * @brief is a card initialized?
+     */
+    bool sdio_card_ready(void);
+
+    /**
+     * @brief get information about the initialized card
+     * @return NULL if no card is initialized
+     */
+    const sdio_card_info_t *sdio_card_info(void);
+
+    /**
+     * @brief read sectors from the card
+     * @param sector first sector
+     * @param buffer the buffer, count * SDIO_SECTOR_SIZE bytes. word aligned buffers are filled by DMA
+     * @param count number of sectors
+     * @return false on a card or bus error
+     */
+    bool sdio_read_sectors(const uint32_t sector, void *buffer, const uint32_t count);
+
+    /**
+     * @brief write sectors to the card
+     * @param sector first sector
+     * @param buffer the data, count * SDIO_SECTOR_SIZE bytes. word aligned buffers are sent by DMA
+     * @param count number of sectors
+     * @return false on a card or bus error
+     * @note returns when the data was sent. the card may still be programming, see sdio_sync()
+     */
+    bool sdio_write_sectors(const uint32_t sector, const void *buffer, const uint32_t count);
+
+    /**
+     * @brief start reading sectors in the background
+     * @param sector first sector
+     * @param buffer the buffer. must be word aligned, and stay valid until the read completed
+     * @param count number of sectors, at most 65535
+     * @return false if the read could not be started
+     * @note completion is polled with sdio_busy(), and the result collected with sdio_wait()
+     */
+    bool sdio_read_sectors_async(const uint32_t sector, void *buffer, const uint32_t count);
+
+    /**
+     * @brief is a background read running?
+     */
+    bool sdio_busy(void);
+
+    /**
+     * @brief wait for the background read started by sdio_read_sectors_async()
+     * @return true if the read completed without error
+     */
+    bool sdio_wait(void);
+
+    /**
+     * @brief wait until the card finished programming, and is ready for the next command
+     * @return false if the card did not become ready
+     * @note e.g. for the CTRL_SYNC ioctl of FatFs
+     */
+    bool sdio_sync(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,438 @@
+#include "softpwm.h"
+#include "../gpio/fastio.h"
+#include "../irqn/irqn.h"
+#include "../sysclock/sysclock.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+#include <string.h>
+
+#if SOFTPWM_TIMER0_UNIT == 1
+#if SOFTPWM_TIMER0_CHANNEL == 0
+#error "softpwm: Timer0 unit 1 channel A is not supported"
+#endif
+#define SOFTPWM_TIMER M4_TMR01
+#define SOFTPWM_TIMER_CLOCK PWC_FCG2_PERIPH_TIM01
+#define SOFTPWM_TIMER_IRQ INT_TMR01_GCMB
+#elif SOFTPWM_TIMER0_UNIT == 2
+#define SOFTPWM_TIMER M4_TMR02
+#define SOFTPWM_TIMER_CLOCK PWC_FCG2_PERIPH_TIM02
+#define SOFTPWM_TIMER_IRQ (SOFTPWM_TIMER0_CHANNEL == 0 ? INT_TMR02_GCMA : INT_TMR02_GCMB)
+#else
+#error "softpwm: SOFTPWM_TIMER0_UNIT must be 1 or 2"
+#endif
+
+#define SOFTPWM_TIMER_CHANNEL (SOFTPWM_TIMER0_CHANNEL == 0 ? Tim0_ChannelA : Tim0_ChannelB)
+
+/**
+ * @brief number of GPIO ports: A - E, and H
+ */
+#define SOFTPWM_PORT_COUNT 6
+
+/**
+ * @brief a set of pins, as bit mask per port
+ */
+struct softpwm_pins_t
+{
+    uint16_t masks[SOFTPWM_PORT_COUNT];
+
+    /**
+     * @brief bit n is set if masks[n] is not 0
+     */
+    uint8_t ports;
+};
+
+/**
+ * @brief an interrupt of the period, after the start
+ */
+struct softpwm_edge_t
+{
+    /**
+     * @brief pins to clear
+     */
+    softpwm_pins_t clear;
+
+    /**
+     * @brief ticks until the next edge, or the end of the period
+     */
+    uint16_t delay;
+};
+
+/**
+ * @brief what a period does
+ */
+struct softpwm_schedule_t
+{
+    /**
+     * @brief pins to set at the start of the period
+     */
+    softpwm_pins_t set;
+
+    /**
+     * @brief ticks from the start to the first edge, or the end of the period
+     */
+    uint16_t first_delay;
+
+    softpwm_edge_t edges[SOFTPWM_MAX_CHANNELS];
+    uint8_t edge_count;
+};
+
+struct softpwm_channel_t
+{
+    gpio_pin_t pin;
+    uint16_t duty;
+    bool used;
+};
+
+static softpwm_channel_t channels[SOFTPWM_MAX_CHANNELS] = {};
+
+/**
+ * @brief the schedule of the running period, and the next one. swapped by the interrupt at the start of a period
+ */
+static softpwm_schedule_t schedules[2] = {};
+static volatile uint8_t front = 0;
+static volatile bool pending = false;
+
+/**
+ * @brief state of the interrupt
+ */
+static const softpwm_schedule_t *current = &schedules[0];
+static volatile uint8_t next_edge = 0;
+
+static bool running = false;
+static IRQn_Type softpwm_irqn;
+static uint16_t period_ticks = 0;
+static uint16_t ticks_per_step = 0;
+static uint16_t resolution_steps = 0;
+static uint16_t min_edge_ticks = 1;
+
+static inline void write_pins(const softpwm_pins_t &pins, const bool set)
+{
+    for (uint8_t ports = pins.ports, port = 0; ports != 0; ports >>= 1, port++)
+    {
+        if ((ports & 1) == 0)
+        {
+            continue;
+        }
+
+        if (set)
+        {
+            FASTIO_PORT_REG(uint16_t, M4_PORT->POSRA, port) = pins.masks[port];
+        }
+        else
+        {
+            FASTIO_PORT_REG(uint16_t, M4_PORT->PORRA, port) = pins.masks[port];
+        }
+    }
+}
+
+static inline void add_pin(softpwm_pins_t &pins, const gpio_pin_t pin)
+{
+    const uint8_t port = uint8_t(PIN_MAP[pin].port);
+    pins.masks[port] |= uint16_t(PIN_MAP[pin].bit_mask);
+    pins.ports |= uint8_t(1u << port);
+}
+
+static void softpwm_irq_handler(void)
+{
+    TIMER0_ClearFlag(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL);
+
+    // the counter restarted at the compare match, so the compare value is the time until the next interrupt
+    uint16_t delay;
+    if (next_edge == 0)
+    {
+        if (pending)
+        {
+            front ^= 1;
+            pending = false;
+        }
+
+        current = &schedules[front];
+        write_pins(current->set, true);
+        delay = current->first_delay;
+    }
+    else
+    {
+        const softpwm_edge_t &edge = current->edges[next_edge - 1];
+        write_pins(edge.clear, false);
+        delay = edge.delay;
+    }
+
+    next_edge = next_edge >= current->edge_count ? 0 : next_edge + 1;
+    TIMER0_WriteCmpReg(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, delay);
+}
+
+/**
+ * @brief build the schedule of the next period from the channels, and hand it to the interrupt
+ */
+static void update_schedule(void)
+{
+    // the interrupt does not swap while pending is false, so the back schedule is not read
+    pending = false;
+    softpwm_schedule_t &schedule = schedules[front ^ 1];
+    memset(&schedule, 0, sizeof(schedule));
+
+    // active channels, sorted by duty. there are few, so insertion sort is fine
+    uint8_t order[SOFTPWM_MAX_CHANNELS];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SOFTPWM_MAX_CHANNELS; i++)
+    {
+        if (!channels[i].used || channels[i].duty == 0)
+        {
+            continue;
+        }
+
+        add_pin(schedule.set, channels[i].pin);
+
+        // always-on pins are never cleared
+        if (channels[i].duty >= resolution_steps)
+        {
+            continue;
+        }
+
+        uint8_t j = count++;
+        for (; j > 0 && channels[order[j - 1]].duty > channels[i].duty; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+
+    // one edge per cluster of clear times. a time too close to the previous edge joins it, the last edge keeps
+    // its distance to the end of the period
+    uint32_t edge_time = 0;
+    for (uint8_t k = 0; k < count; k++)
+    {
+        const softpwm_channel_t &channel = channels[order[k]];
+        uint32_t time = uint32_t(channel.duty) * ticks_per_step;
+        if (time > uint32_t(period_ticks - min_edge_ticks))
+        {
+            time = period_ticks - min_edge_ticks;
+        }
+        if (time < min_edge_ticks)
+        {
+            time = min_edge_ticks;
+        }
+
+        if (schedule.edge_count == 0 || time - edge_time >= min_edge_ticks)
+        {
+            schedule.edge_count++;
+            edge_time = time;
+            schedule.edges[schedule.edge_count - 1].delay = uint16_t(time); // absolute for now
+        }
+
+        add_pin(schedule.edges[schedule.edge_count - 1].clear, channel.pin);
+    }
+
+    // absolute edge times to delays between the interrupts
+    uint32_t previous = 0;
+    for (uint8_t k = 0; k < schedule.edge_count; k++)
+    {
+        const uint32_t time = schedule.edges[k].delay;
+        if (k == 0)
+        {
+            schedule.first_delay = uint16_t(time);
+        }
+        else
+        {
+            schedule.edges[k - 1].delay = uint16_t(time - previous);
+        }
+        previous = time;
+    }
+
+    if (schedule.edge_count == 0)
+    {
+        schedule.first_delay = period_ticks;
+    }
+    else
+    {
+        schedule.edges[schedule.edge_count - 1].delay = uint16_t(period_ticks - previous);
+    }
+
+    pending = true;
+}
+
+static softpwm_channel_t *find_channel(const gpio_pin_t pin)
+{
+    for (softpwm_channel_t &channel : channels)
+    {
+        if (channel.used && channel.pin == pin)
+        {
+            return &channel;
+        }
+    }
+    return NULL;
+}
+
+//
+// public API
+//
+
+bool softpwm_begin(const uint32_t frequency, const uint16_t resolution)
+{
+    CORE_ASSERT(frequency > 0 && resolution > 0, "softpwm_begin: invalid frequency or resolution", return false);
+    if (running)
+    {
+        softpwm_end();
+    }
+
+    // smallest clock division with a period that fits the 16-bit compare register
+    update_system_clock_frequencies();
+    const uint32_t base = SYSTEM_CLOCK_FREQUENCIES.pclk1;
+    uint8_t shift = 0;
+    uint32_t ticks = 0;
+    for (; shift <= 10; shift++)
+    {
+        ticks = (base >> shift) / (frequency * resolution);
+        if (ticks * resolution <= 0xFFFF)
+        {
+            break;
+        }
+    }
+
+    if (shift > 10 || ticks == 0)
+    {
+        CORE_DEBUG_PRINTF("softpwm: %lu Hz with %u steps is out of range\n", frequency, resolution);
+        return false;
+    }
+
+    ticks_per_step = uint16_t(ticks);
+    resolution_steps = resolution;
+    period_ticks = uint16_t(ticks * resolution);
+
+    const uint32_t min_ticks = ((base >> shift) / 1000000ul) * SOFTPWM_MIN_EDGE_US;
+    min_edge_ticks = uint16_t(min_ticks < 1 ? 1 : (min_ticks > period_ticks / 2 ? period_ticks / 2 : min_ticks));
+
+    front = 0;
+    pending = false;
+    next_edge = 0;
+    update_schedule();
+
+    stc_tim0_base_init_t timer_config;
+    MEM_ZERO_STRUCT(timer_config);
+    timer_config.Tim0_CounterMode = Tim0_Sync;
+    timer_config.Tim0_SyncClockSource = Tim0_Pclk1;
+    timer_config.Tim0_ClockDivision = en_tim0_clock_div_t(Tim0_ClkDiv0 + shift);
+    timer_config.Tim0_CmpValue = period_ticks;
+
+    PWC_Fcg2PeriphClockCmd(SOFTPWM_TIMER_CLOCK, Enable);
+    TIMER0_BaseInit(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, &timer_config);
+    TIMER0_WriteCntReg(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, 0);
+
+    irqn_aa_get(softpwm_irqn, "softpwm");
+    stc_irq_regi_conf_t irq_config = {
+        .enIntSrc = SOFTPWM_TIMER_IRQ,
+        .enIRQn = softpwm_irqn,
+        .pfnCallback = softpwm_irq_handler,
+    };
+    enIrqRegistration(&irq_config);
+    NVIC_ClearPendingIRQ(softpwm_irqn);
+    NVIC_SetPriority(softpwm_irqn, IRQ_PRIORITY_SOFTPWM);
+    NVIC_EnableIRQ(softpwm_irqn);
+
+    TIMER0_IntCmd(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, Enable);
+    TIMER0_Cmd(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, Enable);
+    running = true;
+    return true;
+}
+
+bool softpwm_analog_write_begin(void)
+{
+    return running || softpwm_begin(SOFTPWM_ANALOG_WRITE_FREQUENCY, SOFTPWM_ANALOG_WRITE_RESOLUTION);
+}
+
+void softpwm_end(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    TIMER0_Cmd(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, Disable);
+    TIMER0_IntCmd(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL, Disable);
+
+    NVIC_DisableIRQ(softpwm_irqn);
+    NVIC_ClearPendingIRQ(softpwm_irqn);
+    enIrqResign(softpwm_irqn);
+    irqn_aa_resign(softpwm_irqn, "softpwm");
+
+    TIMER0_DeInit(SOFTPWM_TIMER, SOFTPWM_TIMER_CHANNEL);
+    running = false;
+
+    for (const softpwm_channel_t &channel : channels)
+    {
+        if (channel.used)
+        {
+            GPIO_ResetBits(channel.pin);
+        }
+    }
+}
+
+bool softpwm_write(const gpio_pin_t pin, const uint16_t duty)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "softpwm_write", return false);
+
+    softpwm_channel_t *channel = find_channel(pin);
+    if (channel == NULL)
+    {
+        for (softpwm_channel_t &free_channel : channels)
+        {
+            if (!free_channel.used)
+            {
+                channel = &free_channel;
+                break;
+            }
+        }
+
+        if (channel == NULL)
+        {
+            CORE_DEBUG_PRINTF("softpwm: no free channel for pin %d\n", int(pin));
+            return false;
+        }
+
+        GPIO_ResetBits(pin);
+        stc_port_init_t pin_config = {};
+        pin_config.enPinMode = Pin_Mode_Out;
+        GPIO_Init(pin, &pin_config);
+
+        channel->pin = pin;
+        channel->used = true;
+    }
+
+    channel->duty = duty;
+    if (running)
+    {
+        update_schedule();
+    }
+    return true;
+}
+
+void softpwm_detach(const gpio_pin_t pin)
+{
+    softpwm_channel_t *channel = find_channel(pin);
+    if (channel == NULL)
+    {
+        return;
+    }
+
+    channel->used = false;
+    if (running)
+    {
+        update_schedule();
+
+        // the running period may still set the pin, so it is cleared once the new schedule was taken.
+        // the interrupt cannot take it while interrupts are masked or from a handler, so don't wait then.
+        // only the start of a period sets pins, and that start already uses the new schedule
+        if (__get_IPSR() == 0 && __get_PRIMASK() == 0 && __get_BASEPRI() == 0)
+        {
+            while (pending)
+                ;
+        }
+    }
+
+    GPIO_ResetBits(pin);
+}
+
+bool softpwm_attached(const gpio_pin_t pin)
+{
+    return find_channel(pin) != NULL;
+}
@@ -0,0 +1,99 @@
+/**
+ * software PWM on any GPIO pin, driven by one Timer0 channel:
+ *
+ * every PWM period starts with one interrupt that sets all active pins. the pins are then cleared in order of
+ * their duty, one interrupt per distinct duty. pins with the same (or nearly the same) duty share an interrupt, and
+ * all pins of an interrupt are written through the masked set / reset registers, one store per port. dozens of
+ * outputs thus cost as many interrupts per period as there are distinct duty values, plus one.
+ *
+ * duty changes are applied at the start of the next period, so there are no glitches. edges closer than
+ * SOFTPWM_MIN_EDGE_US are merged, which limits the interrupt rate but rounds the duty of the later pin.
+ *
+ * the Timer0 channel is set by SOFTPWM_TIMER0_UNIT / SOFTPWM_TIMER0_CHANNEL. it must not be used otherwise, e.g. as
+ * the rx timeout timer of a USART with DMA.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include "../gpio/gpio.h"
+
+#ifndef SOFTPWM_MAX_CHANNELS
+/**
+ * @brief maximum number of software PWM pins
+ */
+#define SOFTPWM_MAX_CHANNELS 32
+#endif
+
+#ifndef SOFTPWM_TIMER0_UNIT
+/**
+ * @brief Timer0 unit (1 or 2) and channel (0 = A, 1 = B) of the engine
+ * @note Timer0 unit 1 channel A cannot run from PCLK1, and is not supported
+ */
+#define SOFTPWM_TIMER0_UNIT 2
+#define SOFTPWM_TIMER0_CHANNEL 1
+#endif
+
+#ifndef SOFTPWM_MIN_EDGE_US
+/**
+ * @brief minimum time between two interrupts of the engine, in microseconds
+ * @note must be longer than the interrupt latency, plus the run time of the interrupt handler
+ */
+#define SOFTPWM_MIN_EDGE_US 4
+#endif
+
+#ifndef SOFTPWM_ANALOG_WRITE_FREQUENCY
+/**
+ * @brief PWM frequency and resolution used by analogWrite() on pins without TimerA output
+ * @note only if SOFTPWM_ANALOG_WRITE is defined
+ */
+#define SOFTPWM_ANALOG_WRITE_FREQUENCY 1000
+#define SOFTPWM_ANALOG_WRITE_RESOLUTION 255
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief start the engine
+     * @param frequency the PWM frequency, in Hz
+     * @param resolution number of duty steps per period. a duty of resolution is always on
+     * @return false if the timer cannot run at frequency * resolution
+     * @note the timer runs from PCLK1. restart the engine after changing the system clock
+     */
+    bool softpwm_begin(const uint32_t frequency, const uint16_t resolution);
+
+    /**
+     * @brief start the engine for analogWrite(), unless it is running already
+     * @return true if the engine is running
+     */
+    bool softpwm_analog_write_begin(void);
+
+    /**
+     * @brief stop the engine, and set all pins LOW
+     * @note the pins stay attached
+     */
+    void softpwm_end(void);
+
+    /**
+     * @brief set the duty of a pin, and attach it to the engine if it is not already
+     * @param pin the pin. configured as output on attach
+     * @param duty duty, 0 - resolution
+     * @return false if all channels are in use
+     */
+    bool softpwm_write(const gpio_pin_t pin, const uint16_t duty);
+
+    /**
+     * @brief detach a pin from the engine
+     * @param pin the pin. left as output, LOW
+     */
+    void softpwm_detach(const gpio_pin_t pin);
+
+    /**
+     * @brief is the pin attached to the engine?
+     */
+    bool softpwm_attached(const gpio_pin_t pin);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,318 @@
+#include "softtimer.h"
+#include "../../core_debug.h"
+#include "../../core_critical.h"
+#include "../../core_idle.h"
+#include "../../core_events.h"
+#include <hc32_ddl.h>
+
+#define WHEEL_LEVELS 4
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_SLOT_MASK (WHEEL_SLOTS - 1)
+
+/**
+ * @brief slot index of a tick on a wheel level
+ */
+#define WHEEL_INDEX(tick, level) (((tick) >> ((level) * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK)
+
+/**
+ * @brief the timer wheel
+ */
+static softtimer_t *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+
+/**
+ * @brief the next tick to be processed
+ */
+static uint32_t wheel_time = 0;
+
+/**
+ * @brief queue of deferred callbacks
+ */
+static softtimer_t *deferred_head = nullptr;
+static softtimer_t *deferred_tail = nullptr;
+
+//
+// wheel helpers
+// (must be called with interrupts disabled)
+//
+
+/**
+ * @brief insert a timer into the wheel slot matching its expiry tick
+ */
+static void wheel_insert(softtimer_t *timer)
+{
+    const uint32_t delta = timer->expires - wheel_time;
+
+    softtimer_t **slot;
+    if (static_cast<int32_t>(delta) < 0)
+    {
+        // already expired, process on the next tick
+        slot = &wheel[0][WHEEL_INDEX(wheel_time, 0)];
+    }
+    else if (delta < (1ul << (1 * WHEEL_SLOT_BITS)))
+    {
+        slot = &wheel[0][WHEEL_INDEX(timer->expires, 0)];
+    }
+    else if (delta < (1ul << (2 * WHEEL_SLOT_BITS)))
+    {
+        slot = &wheel[1][WHEEL_INDEX(timer->expires, 1)];
+    }
+    else if (delta < (1ul << (3 * WHEEL_SLOT_BITS)))
+    {
+        slot = &wheel[2][WHEEL_INDEX(timer->expires, 2)];
+    }
+    else
+    {
+        // clamp to the maximum delay
+        if (delta > SOFTTIMER_MAX_DELAY)
+        {
+            timer->expires = wheel_time + SOFTTIMER_MAX_DELAY;
+        }
+
+        slot = &wheel[3][WHEEL_INDEX(timer->expires, 3)];
+    }
+
+    // insert as head of slot
+    timer->next = *slot;
+    if (timer->next != nullptr)
+    {
+        timer->next->pprev = &timer->next;
+    }
+
+    timer->pprev = slot;
+    *slot = timer;
+}
+
+/**
+ * @brief remove a timer from the wheel, if it is in the wheel
+ */
+static void wheel_remove(softtimer_t *timer)
+{
+    if (timer->pprev == nullptr)
+    {
+        return;
+    }
+
+    *timer->pprev = timer->next;
+    if (timer->next != nullptr)
+    {
+        timer->next->pprev = timer->pprev;
+    }
+
+    timer->next = nullptr;
+    timer->pprev = nullptr;
+}
+
+/**
+ * @brief move all timers of a slot to lower levels
+ * @return the slot index that was cascaded
+ */
+static uint32_t wheel_cascade(const uint8_t level)
+{
+    const uint32_t index = WHEEL_INDEX(wheel_time, level);
+
+    // detach the slot, then re-insert each timer
+    softtimer_t *timer = wheel[level][index];
+    wheel[level][index] = nullptr;
+    while (timer != nullptr)
+    {
+        softtimer_t *next = timer->next;
+        timer->pprev = nullptr;
+        wheel_insert(timer);
+        timer = next;
+    }
+
+    return index;
+}
+
+/**
+ * @brief remove a timer from the deferred callback queue, if it is queued
+ */
+static void deferred_remove(softtimer_t *timer)
+{
+    if (!timer->deferred_pending)
+    {
+        return;
+    }
+
+    softtimer_t *prev = nullptr;
+    for (softtimer_t *t = deferred_head; t != nullptr; prev = t, t = t->deferred_next)
+    {
+        if (t == timer)
+        {
+            if (prev == nullptr)
+            {
+                deferred_head = t->deferred_next;
+            }
+            else
+            {
+                prev->deferred_next = t->deferred_next;
+            }
+
+            if (deferred_tail == t)
+            {
+                deferred_tail = prev;
+            }
+
+            break;
+        }
+    }
+
+    timer->deferred_next = nullptr;
+    timer->deferred_pending = false;
+}
+
+/**
+ * @brief handle the expiry of a timer
+ * @note the timer is already removed from the wheel
+ */
+static void handle_expiry(softtimer_t *timer)
+{
+    // re-arm periodic timers first, so the callback may stop or restart them
+    if (timer->period != 0)
+    {
+        timer->expires += timer->period;
+        wheel_insert(timer);
+    }
+
+    if (timer->context == SOFTTIMER_CONTEXT_IRQ)
+    {
+        timer->callback(timer, timer->param);
+        return;
+    }
+
+    // queue for the main loop, once
+    if (!timer->deferred_pending)
+    {
+        timer->deferred_pending = true;
+        timer->deferred_next = nullptr;
+        if (deferred_tail == nullptr)
+        {
+            deferred_head = timer;
+        }
+        else
+        {
+            deferred_tail->deferred_next = timer;
+        }
+
+        deferred_tail = timer;
+        core_idle_notify();
+    }
+}
+
+/**
+ * @brief callback of timers started with softtimer_start_events()
+ * @param param the events to set
+ */
+static void softtimer_events_callback(softtimer_t *timer, void *param)
+{
+    (void)timer;
+    core_events_set(static_cast<uint32_t>(reinterpret_cast<uintptr_t>(param)));
+}
+
+//
+// public API
+//
+
+void softtimer_start(softtimer_t *timer,
+                     const uint32_t delay_ms,
+                     const uint32_t period_ms,
+                     const softtimer_callback_t callback,
+                     void *param,
+                     const softtimer_context_t context)
+{
+    CORE_ASSERT(timer != nullptr, "softtimer_start: timer is nullptr", return);
+    CORE_ASSERT(callback != nullptr, "softtimer_start: callback is nullptr", return);
+
+    const uint32_t critical = core_critical_enter();
+
+    wheel_remove(timer);
+    deferred_remove(timer);
+
+    timer->expires = wheel_time + (delay_ms > SOFTTIMER_MAX_DELAY ? SOFTTIMER_MAX_DELAY : delay_ms);
+    timer->period = period_ms > SOFTTIMER_MAX_DELAY ? SOFTTIMER_MAX_DELAY : period_ms;
+    timer->callback = callback;
+    timer->param = param;
+    timer->context = context;
+    wheel_insert(timer);
+
+    core_critical_exit(critical);
+}
+
+void softtimer_start_events(softtimer_t *timer,
+                            const uint32_t delay_ms,
+                            const uint32_t period_ms,
+                            const uint32_t events)
+{
+    softtimer_start(timer, delay_ms, period_ms, softtimer_events_callback,
+                    reinterpret_cast<void *>(static_cast<uintptr_t>(events)), SOFTTIMER_CONTEXT_IRQ);
+}
+
+void softtimer_stop(softtimer_t *timer)
+{
+    CORE_ASSERT(timer != nullptr, "softtimer_stop: timer is nullptr", return);
+
+    const uint32_t critical = core_critical_enter();
+    wheel_remove(timer);
+    deferred_remove(timer);
+    core_critical_exit(critical);
+}
+
+void softtimer_tick()
+{
+    // cascade higher levels when a lower level wraps around
+    const uint32_t index = WHEEL_INDEX(wheel_time, 0);
+    if (index == 0 && wheel_cascade(1) == 0 && wheel_cascade(2) == 0)
+    {
+        wheel_cascade(3);
+    }
+
+    // process the current slot
+    softtimer_t *timer = wheel[0][index];
+    wheel[0][index] = nullptr;
+    wheel_time++;
+    while (timer != nullptr)
+    {
+        softtimer_t *next = timer->next;
+        timer->next = nullptr;
+        timer->pprev = nullptr;
+        handle_expiry(timer);
+        timer = next;
+    }
+}
+
+void softtimer_run_deferred()
+{
+    // fast path: nothing queued
+    if (deferred_head == nullptr)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        // pop the first queued timer
+        const uint32_t critical = core_critical_enter();
+        softtimer_t *timer = deferred_head;
+        if (timer != nullptr)
+        {
+            deferred_head = timer->deferred_next;
+            if (deferred_head == nullptr)
+            {
+                deferred_tail = nullptr;
+            }
+
+            timer->deferred_next = nullptr;
+            timer->deferred_pending = false;
+        }
+        core_critical_exit(critical);
+
+        if (timer == nullptr)
+        {
+            return;
+        }
+
+        // run callback with interrupts enabled
+        timer->callback(timer, timer->param);
+    }
+}
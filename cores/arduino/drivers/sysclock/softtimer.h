@@ -0,0 +1,167 @@
+/**
+ * software timers on the SysTick tick:
+ *
+ * timers are kept in a hierarchical timer wheel of 4 levels with 64 slots each.
+ * level 0 has a resolution of 1 ms, each following level covers 64 times the range of the previous one.
+ * starting and stopping a timer is O(1), and every tick only looks at a single level 0 slot.
+ * once every 64 ms, the timers in the next level 1 slot are moved down (cascaded), and so on.
+ *
+ *   level 0: 64 x 1 ms      =   64 ms
+ *   level 1: 64 x 64 ms     = ~  4 s
+ *   level 2: 64 x 4096 ms   = ~  4.5 min
+ *   level 3: 64 x 262144 ms = ~  4.6 h (maximum delay)
+ *
+ * a timer's callback either runs in the SysTick interrupt (SOFTTIMER_CONTEXT_IRQ), or is deferred to the main loop
+ * (SOFTTIMER_CONTEXT_LOOP), where it runs before each call to loop().
+ *
+ * timers are allocated by the caller, so the soft-timer service never allocates memory.
+ * if no soft-timer is ever used, the service is not linked at all.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+struct softtimer_t;
+
+/**
+ * @brief soft-timer callback
+ * @param timer the timer that expired
+ * @param param the param given to softtimer_start()
+ */
+typedef void (*softtimer_callback_t)(struct softtimer_t *timer, void *param);
+
+/**
+ * @brief context the callback of a soft-timer runs in
+ */
+typedef enum softtimer_context_t
+{
+    /**
+     * @brief run the callback inside the SysTick interrupt
+     * @note keep the callback short and sweet
+     */
+    SOFTTIMER_CONTEXT_IRQ,
+
+    /**
+     * @brief run the callback in the main loop, before loop() is called
+     * @note if the timer expires multiple times before the main loop runs, the callback is called once
+     */
+    SOFTTIMER_CONTEXT_LOOP,
+} softtimer_context_t;
+
+/**
+ * @brief soft-timer
+ * @note all fields are managed by the soft-timer service. only zero-initialize before first use
+ */
+typedef struct softtimer_t
+{
+    /**
+     * @brief next timer in the same wheel slot
+     */
+    struct softtimer_t *next;
+
+    /**
+     * @brief pointer to the pointer that points to this timer
+     * @note NULL if the timer is not in the wheel
+     */
+    struct softtimer_t **pprev;
+
+    /**
+     * @brief next timer in the deferred callback queue
+     */
+    struct softtimer_t *deferred_next;
+
+    /**
+     * @brief tick the timer expires at
+     */
+    uint32_t expires;
+
+    /**
+     * @brief period of the timer, in milliseconds
+     * @note 0 for one-shot timers
+     */
+    uint32_t period;
+
+    /**
+     * @brief callback of the timer
+     */
+    softtimer_callback_t callback;
+
+    /**
+     * @brief param for the callback
+     */
+    void *param;
+
+    /**
+     * @brief context the callback runs in
+     */
+    softtimer_context_t context;
+
+    /**
+     * @brief is the callback queued to run in the main loop?
+     */
+    volatile bool deferred_pending;
+} softtimer_t;
+
+/**
+ * @brief maximum delay and period of a soft-timer, in milliseconds
+ */
+#define SOFTTIMER_MAX_DELAY ((1ul << 24) - 1)
+
+/**
+ * @brief start a soft-timer
+ * @param timer the timer. if it is already running, it is restarted
+ * @param delay_ms delay until the first expiry, in milliseconds. 0 expires on the next tick
+ * @param period_ms period of the following expiries, in milliseconds. 0 for a one-shot timer
+ * @param callback the callback to call on expiry
+ * @param param param for the callback
+ * @param context context the callback runs in
+ * @note may be called from the callback of the timer itself
+ */
+void softtimer_start(softtimer_t *timer,
+                     const uint32_t delay_ms,
+                     const uint32_t period_ms,
+                     const softtimer_callback_t callback,
+                     void *param,
+                     const softtimer_context_t context);
+
+/**
+ * @brief start a soft-timer that sets events on expiry, for waitEvents()
+ * @param timer the timer. if it is already running, it is restarted
+ * @param delay_ms delay until the first expiry, in milliseconds. 0 expires on the next tick
+ * @param period_ms period of the following expiries, in milliseconds. 0 for a one-shot timer
+ * @param events the events to set. see core_events.h
+ * @note the events are set from the SysTick interrupt, no callback is involved
+ */
+void softtimer_start_events(softtimer_t *timer,
+                            const uint32_t delay_ms,
+                            const uint32_t period_ms,
+                            const uint32_t events);
+
+/**
+ * @brief stop a soft-timer
+ * @param timer the timer
+ * @note a deferred callback that is already queued is dropped as well
+ * @note may be called from the callback of the timer itself
+ */
+void softtimer_stop(softtimer_t *timer);
+
+/**
+ * @brief check if a soft-timer is running
+ * @param timer the timer
+ */
+inline bool softtimer_is_active(const softtimer_t *timer)
+{
+    return timer->pprev != nullptr;
+}
+
+/**
+ * @brief advance the timer wheel by one tick
+ * @note called by the SysTick interrupt
+ */
+void softtimer_tick();
+
+/**
+ * @brief run the queued callbacks of SOFTTIMER_CONTEXT_LOOP timers
+ * @note called by the main loop, before loop()
+ */
+void softtimer_run_deferred();
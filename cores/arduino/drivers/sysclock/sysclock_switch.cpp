@@ -0,0 +1,128 @@
+#include "sysclock_switch.h"
+#include "sysclock_util.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+
+// clock max frequencies (refer to HC32F460 user manual, Section 4.4, Table 4-1)
+#define MAX_HCLK 200000000ul
+#define MAX_EXCLK 100000000ul
+#define MAX_PCLK0 200000000ul
+#define MAX_PCLK1 100000000ul
+#define MAX_PCLK2 60000000ul
+#define MAX_PCLK3 50000000ul
+#define MAX_PCLK4 100000000ul
+
+static sysclock_listener_t *listeners = nullptr;
+
+void sysclock_listener_register(sysclock_listener_t *listener, const sysclock_change_callback_t callback, void *param)
+{
+    CORE_ASSERT(listener != nullptr && callback != nullptr, "sysclock_listener_register: listener and callback cannot be NULL", return);
+
+    const uint32_t critical = core_critical_enter();
+    if (!listener->registered)
+    {
+        listener->callback = callback;
+        listener->param = param;
+        listener->next = listeners;
+        listener->registered = true;
+        listeners = listener;
+    }
+    core_critical_exit(critical);
+}
+
+void sysclock_listener_unregister(sysclock_listener_t *listener)
+{
+    const uint32_t critical = core_critical_enter();
+    for (sysclock_listener_t **pp = &listeners; *pp != nullptr; pp = &(*pp)->next)
+    {
+        if (*pp == listener)
+        {
+            *pp = listener->next;
+            break;
+        }
+    }
+
+    listener->next = nullptr;
+    listener->registered = false;
+    core_critical_exit(critical);
+}
+
+bool sysclock_get_shift(const uint32_t from, const uint32_t to, int8_t &shift)
+{
+    shift = 0;
+    if (from == 0 || to == 0)
+    {
+        return false;
+    }
+
+    uint32_t f = from;
+    while (f < to)
+    {
+        f <<= 1;
+        shift++;
+    }
+    while (f > to)
+    {
+        f >>= 1;
+        shift--;
+    }
+
+    return (shift >= 0) ? ((from << shift) == to) : ((to << -shift) == from);
+}
+
+static void notify_listeners(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous)
+{
+    for (sysclock_listener_t *listener = listeners; listener != nullptr; listener = listener->next)
+    {
+        listener->callback(phase, previous, listener->param);
+    }
+}
+
+en_result_t sysclock_switch_dividers(const stc_clk_sysclk_cfg_t *dividers)
+{
+    CORE_ASSERT(dividers != nullptr, "sysclock_switch_dividers: dividers cannot be NULL", return ErrorInvalidParameter);
+
+    // the divider enums are log2 of the division factor
+    update_system_clock_frequencies();
+    const uint32_t system = SYSTEM_CLOCK_FREQUENCIES.system;
+    const uint32_t hclk = system >> dividers->enHclkDiv;
+    if (hclk > MAX_HCLK ||
+        (system >> dividers->enExclkDiv) > MAX_EXCLK ||
+        (system >> dividers->enPclk0Div) > MAX_PCLK0 ||
+        (system >> dividers->enPclk1Div) > MAX_PCLK1 ||
+        (system >> dividers->enPclk2Div) > MAX_PCLK2 ||
+        (system >> dividers->enPclk3Div) > MAX_PCLK3 ||
+        (system >> dividers->enPclk4Div) > MAX_PCLK4)
+    {
+        CORE_DEBUG_PRINTF("sysclock_switch_dividers: clocks out of range\n");
+        return ErrorInvalidParameter;
+    }
+
+    const system_clock_frequencies_t previous = SYSTEM_CLOCK_FREQUENCIES;
+
+    // let drivers get ready, e.g. drain tx buffers
+    notify_listeners(SYSCLOCK_CHANGE_PRE, &previous);
+
+    // switch and re-time everything in one go, so no interrupt sees a half-updated driver
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // flash must be slow enough for the faster of both clocks
+    if (hclk > previous.hclk)
+    {
+        sysclock_configure_flash_wait_cycles(hclk);
+    }
+
+    sysclock_set_clock_dividers(dividers);
+    update_system_clock_frequencies();
+
+    if (hclk < previous.hclk)
+    {
+        sysclock_configure_flash_wait_cycles(hclk);
+    }
+
+    notify_listeners(SYSCLOCK_CHANGE_POST, &previous);
+
+    __set_PRIMASK(primask);
+    return Ok;
+}
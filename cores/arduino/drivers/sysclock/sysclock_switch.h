@@ -0,0 +1,115 @@
+/**
+ * runtime clock switching:
+ *
+ * sysclock_switch_dividers() changes the HCLK / PCLKn dividers while the system is running, e.g. to drop to a low
+ * clock while idle and go back to full speed for motion. the system clock source (MPLL) keeps running, so no PLL
+ * relock is needed, and every derived clock changes by a power of two.
+ *
+ * drivers whose timing depends on these clocks register a listener, which is called twice for every switch:
+ * - SYSCLOCK_CHANGE_PRE: before the switch, with interrupts enabled. get the peripheral to a point where it can be
+ *   re-timed without losing data (e.g. drain the tx buffer)
+ * - SYSCLOCK_CHANGE_POST: right after the switch, with interrupts disabled. re-derive the dividers from the new clocks
+ *
+ * the core registers listeners for SysTick, TimerA units, Usart, Timer0, SPIClass and TwoWire instances.
+ * TimerA and Timer0 keep their count rate by shifting their clock prescaler, so their outputs don't glitch.
+ */
+#pragma once
+#include "sysclock.h"
+#include <hc32_ddl.h>
+
+/**
+ * @brief phase of a clock switch
+ */
+typedef enum sysclock_change_phase_t
+{
+    /**
+     * @brief before the clocks are switched
+     * @note interrupts are enabled
+     */
+    SYSCLOCK_CHANGE_PRE,
+
+    /**
+     * @brief after the clocks were switched, SYSTEM_CLOCK_FREQUENCIES holds the new clocks
+     * @note interrupts are disabled. keep it short and sweet
+     */
+    SYSCLOCK_CHANGE_POST,
+} sysclock_change_phase_t;
+
+/**
+ * @brief clock change listener callback
+ * @param phase phase of the clock switch
+ * @param previous the clock frequencies before the switch
+ * @param param the param given to sysclock_listener_register()
+ */
+typedef void (*sysclock_change_callback_t)(const sysclock_change_phase_t phase,
+                                           const system_clock_frequencies_t *previous,
+                                           void *param);
+
+/**
+ * @brief clock change listener
+ * @note all fields are managed by sysclock_listener_register(). only zero-initialize before first use
+ */
+typedef struct sysclock_listener_t
+{
+    /**
+     * @brief next registered listener
+     */
+    struct sysclock_listener_t *next;
+
+    /**
+     * @brief callback of the listener
+     */
+    sysclock_change_callback_t callback;
+
+    /**
+     * @brief param for the callback
+     */
+    void *param;
+
+    /**
+     * @brief is the listener registered?
+     */
+    bool registered;
+} sysclock_listener_t;
+
+/**
+ * @brief register a clock change listener
+ * @param listener the listener. no-op if already registered
+ * @param callback the callback
+ * @param param param for the callback
+ * @note listeners are called in reverse order of registration
+ */
+void sysclock_listener_register(sysclock_listener_t *listener, const sysclock_change_callback_t callback, void *param);
+
+/**
+ * @brief unregister a clock change listener
+ * @param listener the listener. no-op if not registered
+ * @note must not be called from a listener callback
+ */
+void sysclock_listener_unregister(sysclock_listener_t *listener);
+
+/**
+ * @brief switch the HCLK / PCLKn dividers at runtime, and notify all listeners
+ * @param dividers the new clock dividers
+ * @return Ok on success, ErrorInvalidParameter if the resulting clocks are out of range
+ *
+ * @note
+ * flash wait cycles are adjusted to the new HCLK, raised before and lowered after the switch.
+ * (SRAM wait cycles as configured by sysclock_configure_sram_wait_cycles() are safe for any HCLK)
+ *
+ * @note
+ * bytes received by a USART while the switch is in progress may be corrupted, as the baud rate changes mid-frame.
+ * transmitted bytes are never lost, as the tx buffers are drained before the switch
+ *
+ * @note must not be called from interrupts, as listeners may wait for their peripheral in SYSCLOCK_CHANGE_PRE
+ */
+en_result_t sysclock_switch_dividers(const stc_clk_sysclk_cfg_t *dividers);
+
+/**
+ * @brief get the power-of-two shift between two clock frequencies
+ * @param from the previous frequency
+ * @param to the new frequency
+ * @param shift receives log2(to / from)
+ * @return true if the frequencies differ by an exact power of two
+ */
+bool sysclock_get_shift(const uint32_t from, const uint32_t to, int8_t &shift);
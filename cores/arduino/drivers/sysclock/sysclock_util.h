@@ -8,6 +8,8 @@
 
 /**
  * @brief init external XTAL clock source
+ * @note does not wait for the XTAL to stabilize. other setup (e.g. wait cycles) can run in the meantime,
+ *       sysclock_configure_mpll() waits for it before enabling the PLL
  */
 inline void sysclock_configure_xtal()
 {
@@ -21,6 +23,15 @@ inline void sysclock_configure_xtal()
     CLK_XtalCmd(Enable);
 }
 
+/**
+ * @brief wait until the XTAL clock source is stable
+ */
+inline void sysclock_wait_xtal_stable()
+{
+    while (CLK_GetFlagStatus(ClkFlagXTALRdy) != Set)
+        ;
+}
+
 /**
  * @brief init internal high-speed RC clock source to 16 MHz
  */
@@ -61,6 +72,12 @@ inline void sysclock_configure_mpll(
     en_clk_pll_source_t pllSource,
     const stc_clk_mpll_cfg_t *pllConfig)
 {
+    // PLL must only be enabled on a stable source
+    if (pllSource == ClkPllSrcXTAL)
+    {
+        sysclock_wait_xtal_stable();
+    }
+
     // configure PLL
     CLK_SetPllSource(pllSource);
     CLK_MpllConfig(pllConfig);
@@ -134,29 +151,111 @@ inline void sysclock_configure_sram_wait_cycles(
 }
 
 /**
- * @brief setup flash wait cycles and cache to safe values for HCLK <= 200 MHz
+ * @brief reset (invalidate) the flash cache
+ *
+ * @note
+ * the cache is not updated when flash is erased or programmed, so it may still hold the old contents.
+ * call after every flash erase or program operation.
+ *
+ * @note the EFM must be unlocked (EFM_Unlock()) when calling this function
+ */
+inline void sysclock_flush_flash_cache()
+{
+    // cache must be disabled while it is reset
+    const uint32_t cache = M4_EFM->FRMC_f.CACHE;
+    M4_EFM->FRMC_f.CACHE = 0;
+    M4_EFM->FRMC_f.CRST = 1;
+    M4_EFM->FRMC_f.CRST = 0;
+    M4_EFM->FRMC_f.CACHE = cache;
+}
+
+/**
+ * @brief enable or disable the flash cache
+ * @param enable enable the cache? enabled cache is reset before use
+ *
+ * @note
+ * the EFM cache buffers both instruction and data reads from flash, and prefetches the next line on
+ * sequential instruction fetches. with it enabled, most code in flash runs without wait cycles.
+ * there is no separate prefetch control on the HC32F460.
+ *
+ * (refer to HC32F460 user manual, Section 7.4)
+ */
+inline void sysclock_configure_flash_cache(const bool enable = true)
+{
+    EFM_Unlock();
+    if (enable)
+    {
+        sysclock_flush_flash_cache();
+    }
+
+    EFM_InstructionCacheCmd(enable ? Enable : Disable);
+    EFM_Lock();
+}
+
+/**
+ * @brief get the number of flash wait cycles required for a HCLK frequency
+ * @param hclk HCLK frequency, in Hz
+ * @return one of EFM_LATENCY_0 to EFM_LATENCY_5
+ *
+ * @note
+ * refer to HC32F460 user manual, Section 7.4, Table 7-1
+ */
+inline uint32_t sysclock_get_flash_wait_cycles(const uint32_t hclk)
+{
+    if (hclk <= 33000000)
+    {
+        return EFM_LATENCY_0;
+    }
+    else if (hclk <= 66000000)
+    {
+        return EFM_LATENCY_1;
+    }
+    else if (hclk <= 99000000)
+    {
+        return EFM_LATENCY_2;
+    }
+    else if (hclk <= 132000000)
+    {
+        return EFM_LATENCY_3;
+    }
+    else if (hclk <= 168000000)
+    {
+        return EFM_LATENCY_4;
+    }
+    else
+    {
+        // 168 < HCLK <= 200 MHz
+        return EFM_LATENCY_5;
+    }
+}
+
+/**
+ * @brief setup flash wait cycles and cache
+ * @param hclk HCLK frequency to set the wait cycles for, in Hz. default is safe for up to 200 MHz HCLK
+ * @param enableCache enable the flash cache?
  *
  * @note
- * this function sets safe values for HCLK = 200 MHz, but should be safe to use for lower clocks as well
+ * the default sets safe values for HCLK = 200 MHz, but should be safe to use for lower clocks as well.
+ * lower values reduce the wait cycles, which speeds up flash accesses on cache misses
  *
  * @note
  * refer to HC32F460 user manual, Section 7.4, Table 7-1 for values to use
  *
- * @note set flash wait cycles before switching sysclk
+ * @note
+ * when increasing HCLK, set flash wait cycles before switching sysclk.
+ * when decreasing HCLK, set flash wait cycles after switching sysclk
  */
-inline void sysclock_configure_flash_wait_cycles()
+inline void sysclock_configure_flash_wait_cycles(const uint32_t hclk = 200000000, const bool enableCache = true)
 {
     EFM_Unlock();
 
     // ultra-low-power mode only supported for HCLK <= 2 MHz
     EFM_SetReadMode(NormalRead);
 
-    // 168 < HCLK <= 200 MHz, 5 wait cycles are required
-    EFM_SetLatency(EFM_LATENCY_5);
-
-    // enable instruction cache
-    EFM_InstructionCacheCmd(Enable);
+    EFM_SetLatency(sysclock_get_flash_wait_cycles(hclk));
     EFM_Lock();
+
+    sysclock_configure_flash_cache(enableCache);
 }
 
 //
@@ -179,6 +278,16 @@ void power_mode_update(uint32_t newSystemClock, bool preClockSwitchOver);
 // restore defaults
 //
 
+/**
+ * @brief check if the clocks are at their reset defaults
+ * @return true if MRC is the system clock source, and all clock dividers are 1
+ * @note false if e.g. a bootloader left the clocks configured
+ */
+inline bool sysclock_is_default_clocks()
+{
+    return CLK_GetSysClkSource() == ClkSysSrcMRC && M4_SYSREG->CMU_SCFGR == 0ul;
+}
+
 /**
  * @brief restore the default clock source and frequencies
  *
@@ -196,6 +305,9 @@ void power_mode_update(uint32_t newSystemClock, bool preClockSwitchOver);
  * - PCLK4: 1 (8 MHz)
  *
  * (refer to HC32F460 user manual, Section 4.11.21, register defaults)
+ *
+ * @note
+ * flash wait cycles are reduced to 0 after the switch, and the flash cache is enabled
  */
 inline void sysclock_restore_default_clocks()
 {
@@ -222,4 +334,7 @@ inline void sysclock_restore_default_clocks()
 
     // update performance mode
     power_mode_update_post(8000000);
+
+    // no flash wait cycles are needed at 8 MHz, cache enabled
+    sysclock_configure_flash_wait_cycles(8000000);
 }
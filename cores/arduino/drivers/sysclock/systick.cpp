@@ -1,33 +1,154 @@
 #include "systick.h"
+#include "sysclock_switch.h"
+#include "../../core_util.h"
+#include "../../core_critical.h"
 #include <hc32_ddl.h>
 
 volatile uint32_t uptime = 0;
 
-extern "C" void SysTick_IrqHandler(void)
+// upper 32 bits of the 64-bit uptime, incremented when uptime wraps
+volatile uint32_t uptime_wraps = 0;
+
+// soft-timer service, only linked if soft-timers are used
+__attribute__((weak)) void softtimer_tick();
+
+extern "C" CORE_RAMFUNC void SysTick_IrqHandler(void)
 {
     // uptime++;
-    __sync_fetch_and_add(&uptime, 1);
+    if (__sync_add_and_fetch(&uptime, 1) == 0)
+    {
+        uptime_wraps++;
+    }
+
+    if (softtimer_tick != nullptr)
+    {
+        softtimer_tick();
+    }
+}
+
+// cycles counted up to the last clock change, and the uptime they were counted at.
+// cycles after that are counted with the current SysTick reload
+static uint64_t systick_cycle_base = 0;
+static uint64_t systick_cycle_base_ms = 0;
+
+static sysclock_listener_t systick_clock_listener = {};
+
+static void systick_read(uint64_t &ms, uint32_t &elapsed, uint32_t &load);
+
+static void systick_clock_changed(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)previous;
+    (void)param;
+    if (phase != SYSCLOCK_CHANGE_POST)
+    {
+        return;
+    }
+
+    const uint32_t critical = core_critical_enter();
+
+    // fold the cycles counted at the previous reload into the cycle base
+    uint64_t ms;
+    uint32_t elapsed, load;
+    systick_read(ms, elapsed, load);
+    systick_cycle_base += ((ms - systick_cycle_base_ms) * load) + elapsed;
+
+    // reload for the new clock. writing VAL restarts the current millisecond,
+    // so count the partial millisecond as complete, and micros() never goes backwards
+    SysTick->LOAD = (SYSTEM_CLOCK_FREQUENCIES.hclk / TICKS_PER_SECOND) - 1;
+    SysTick->VAL = 0;
+    if (++uptime == 0)
+    {
+        uptime_wraps++;
+    }
+
+    systick_cycle_base_ms = ms + 1;
+    core_critical_exit(critical);
 }
 
 void systick_init()
 {
+    // SysTick is clocked by the CPU clock (HCLK)
     stc_clk_freq_t clkFreq;
     CLK_GetClockFreq(&clkFreq);
-    SysTick_Config(clkFreq.sysclkFreq / TICKS_PER_SECOND);
+    SysTick_Config(clkFreq.hclkFreq / TICKS_PER_SECOND);
+
+    sysclock_listener_register(&systick_clock_listener, systick_clock_changed, nullptr);
+}
+
+/**
+ * @brief read the 64-bit uptime and the SysTick counter consistently
+ * @param ms receives the uptime, in milliseconds
+ * @param elapsed receives the SysTick cycles elapsed in the current millisecond
+ * @param load receives the SysTick cycles per millisecond
+ */
+static void systick_read(uint64_t &ms, uint32_t &elapsed, uint32_t &load)
+{
+    // re-read if the SysTick interrupt updated uptime in between
+    uint32_t wraps;
+    uint32_t ms_low;
+    uint32_t ticks;
+    bool wrap_pending;
+    do
+    {
+        wraps = uptime_wraps;
+        ms_low = uptime;
+        ticks = SysTick->VAL;
+        wrap_pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+    } while (ms_low != uptime || wraps != uptime_wraps);
+
+    ms = (uint64_t(wraps) << 32) | ms_low;
+
+    // with interrupts disabled, the counter may have wrapped without uptime being incremented yet.
+    // if so, and the counter was read after the wrap (= it is still high), count the pending millisecond
+    load = SysTick->LOAD + 1;
+    if (wrap_pending && ticks > (load / 2))
+    {
+        ms++;
+    }
+
+    // SysTick counts down from LOAD to 0 once per millisecond
+    elapsed = (load - 1) - ticks;
 }
 
 uint32_t systick_millis()
 {
-#ifdef ENABLE_MICROS
-    return uptime / 1000;
-#else
     return uptime;
-#endif
 }
 
-#ifdef ENABLE_MICROS
 uint32_t systick_micros()
 {
-    return uptime;
+    return static_cast<uint32_t>(systick_micros64());
+}
+
+uint64_t systick_millis64()
+{
+    uint32_t wraps;
+    uint32_t ms_low;
+    do
+    {
+        wraps = uptime_wraps;
+        ms_low = uptime;
+    } while (wraps != uptime_wraps);
+
+    return (uint64_t(wraps) << 32) | ms_low;
+}
+
+uint64_t systick_micros64()
+{
+    uint64_t ms;
+    uint32_t elapsed, load;
+    systick_read(ms, elapsed, load);
+    return (ms * 1000) + ((elapsed * 1000) / load);
+}
+
+uint64_t systick_cycles64()
+{
+    // the cycle base is updated by a clock change, read it together with the counter
+    const uint32_t critical = core_critical_enter();
+    uint64_t ms;
+    uint32_t elapsed, load;
+    systick_read(ms, elapsed, load);
+    const uint64_t cycles = systick_cycle_base + ((ms - systick_cycle_base_ms) * load) + elapsed;
+    core_critical_exit(critical);
+    return cycles;
 }
-#endif
@@ -1,16 +1,26 @@
 #pragma once
 #include <stdint.h>
 
-// set systick to only millisecond resolution if micros are not required
-#ifdef ENABLE_MICROS
-#define TICKS_PER_SECOND 1000000ul
-#else
+// systick runs at millisecond resolution. micros() interpolates using the SysTick counter
 #define TICKS_PER_SECOND 1000ul
-#endif
 
 void systick_init();
 uint32_t systick_millis();
-
-#ifdef ENABLE_MICROS
 uint32_t systick_micros();
-#endif
+
+/**
+ * @brief milliseconds since systick_init(), as 64-bit value that does not wrap
+ */
+uint64_t systick_millis64();
+
+/**
+ * @brief microseconds since systick_init(), as 64-bit value that does not wrap
+ */
+uint64_t systick_micros64();
+
+/**
+ * @brief SysTick clock cycles since systick_init(), as 64-bit value that does not wrap
+ * @note SysTick is clocked by the CPU clock, so this counts CPU cycles. cycles at a previous clock
+ *       frequency are kept when the clock changes, so the value never jumps
+ */
+uint64_t systick_cycles64();
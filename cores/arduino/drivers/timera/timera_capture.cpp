@@ -0,0 +1,288 @@
+#include "timera_capture.h"
+#include "../gpio/gpio.h"
+#include "timera_irq.h"
+#include "../../core_critical.h"
+
+//
+// capture interrupt handler
+//
+static timera_config_t *TIMERAx[6] = {
+    &TIMERA1_config,
+    &TIMERA2_config,
+    &TIMERA3_config,
+    &TIMERA4_config,
+    &TIMERA5_config,
+    &TIMERA6_config,
+};
+
+template <uint8_t x>
+static void TIMERAx_capture_irq(void)
+{
+    timera_config_t *unit = TIMERAx[x - 1];
+    M4_TMRA_TypeDef *reg = unit->peripheral.register_base;
+    timera_capture_channel_t *channels = unit->state.capture_channels;
+    if (channels == nullptr)
+    {
+        return;
+    }
+
+    // a pending overflow is not yet counted in capture_overflows
+    const bool overflowed = TIMERA_GetFlag(reg, TimeraFlagOverflow) == Set;
+
+    for (uint8_t ch = 0; ch < 8; ch++)
+    {
+        const en_timera_channel_t channel = static_cast<en_timera_channel_t>(TimeraCh1 + ch);
+        const en_timera_flag_type_t flag = static_cast<en_timera_flag_type_t>(TimeraFlagCaptureOrCompareCh1 + ch);
+        if (!timera_is_channel_active(unit, channel) || TIMERA_GetFlag(reg, flag) != Set)
+        {
+            continue;
+        }
+
+        TIMERA_ClearFlag(reg, flag);
+        const uint16_t value = TIMERA_GetCaptureValue(reg, channel);
+
+        // extend timestamp to 32 bits.
+        // if the overflow is pending, a small value was captured after it, a large value before it
+        const uint32_t overflows = unit->state.capture_overflows + ((overflowed && value < 0x8000) ? 1 : 0);
+        const uint32_t timestamp = (overflows << 16) | value;
+
+        // the pin level after the edge tells the edge type
+        timera_capture_channel_t &c = channels[ch];
+        if (GPIO_GetBit(c.pin) == Set)
+        {
+            // rising edge: ends a LOW pulse and a period
+            if (c.seen_edges & (1 << 1))
+            {
+                c.low_time = timestamp - c.last_falling;
+                c.updated |= TIMERA_CAPTURE_NEW_LOW;
+            }
+
+            if (c.seen_edges & (1 << 0))
+            {
+                c.period = timestamp - c.last_rising;
+                c.updated |= TIMERA_CAPTURE_NEW_PERIOD;
+            }
+
+            c.last_rising = timestamp;
+            c.seen_edges |= (1 << 0);
+        }
+        else
+        {
+            // falling edge: ends a HIGH pulse
+            if (c.seen_edges & (1 << 0))
+            {
+                c.high_time = timestamp - c.last_rising;
+                c.updated |= TIMERA_CAPTURE_NEW_HIGH;
+            }
+
+            c.last_falling = timestamp;
+            c.seen_edges |= (1 << 1);
+        }
+    }
+
+    if (overflowed)
+    {
+        TIMERA_ClearFlag(reg, TimeraFlagOverflow);
+        unit->state.capture_overflows++;
+    }
+}
+
+/**
+ * @brief capture channel states of each unit
+ * @note allocated on the first capture of a unit and kept, so repeated captures (e.g. pulseIn()) don't allocate
+ */
+static timera_capture_channel_t *TIMERAx_capture_channels[6] = {};
+
+static const func_ptr_t TIMERAx_capture_irqs[6] = {
+    TIMERAx_capture_irq<1>,
+    TIMERAx_capture_irq<2>,
+    TIMERAx_capture_irq<3>,
+    TIMERAx_capture_irq<4>,
+    TIMERAx_capture_irq<5>,
+    TIMERAx_capture_irq<6>,
+};
+
+//
+// public API
+//
+
+en_result_t timera_capture_start(timera_config_t *unit, const en_timera_channel_t channel, const gpio_pin_t pin, const uint16_t divider)
+{
+    CORE_ASSERT(unit != nullptr, "timera_capture_start: unit is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(channel >= TimeraCh1 && channel <= TimeraCh8, "timera_capture_start: invalid channel", return ErrorInvalidParameter);
+
+    const int x = TIMERA_REG_TO_X(unit->peripheral.register_base);
+    CORE_ASSERT(x >= 1 && x <= 6, "timera_capture_start: unit is invalid", return ErrorInvalidParameter);
+
+    const en_timera_clk_div_t clk_div = timera_n_to_clk_div(divider);
+
+    if (timera_is_unit_initialized(unit))
+    {
+        // unit may only be shared with other capture channels at the same divider
+        if (unit->state.capture_channels == nullptr || unit->state.base_init->enClkDiv != clk_div)
+        {
+            return ErrorOperationInProgress;
+        }
+
+        if (timera_is_channel_active(unit, channel))
+        {
+            return ErrorOperationInProgress;
+        }
+    }
+    else
+    {
+        // prepare unit config
+        // (stored in the unit's state. only valid once base_init points to it)
+        stc_timera_base_init_t *unit_config = &unit->state.base_init_storage;
+        unit_config->enClkDiv = clk_div;                      // timestamp resolution
+        unit_config->enCntMode = TimeraCountModeSawtoothWave; // sawtooth wave mode
+        unit_config->enCntDir = TimeraCountDirUp;             // count up
+        unit_config->enSyncStartupEn = Disable;               // no sync startup
+        unit_config->u16PeriodVal = 0xFFFF;                   // use full 16 bit range, wrap around is handled by interrupts
+
+        TIMERA_DEBUG_PRINTF(unit, -2, "capture_start: divider=%d\n", int(divider));
+
+        // start peripheral clock for TimerA unit
+        PWC_Fcg2PeriphClockCmd(unit->peripheral.clock_id, Enable);
+
+        // initialize unit
+        TIMERA_BaseInit(unit->peripheral.register_base, unit_config);
+        unit->state.base_init = unit_config;
+        timera_track_clock_changes();
+        if (TIMERAx_capture_channels[x - 1] == nullptr)
+        {
+            TIMERAx_capture_channels[x - 1] = new timera_capture_channel_t[8]();
+        }
+        unit->state.capture_channels = TIMERAx_capture_channels[x - 1];
+        unit->state.capture_overflows = 0;
+
+        // capture and overflow share one handler, so timestamps are always ordered correctly
+        TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagOverflow);
+        timera_irq_register(unit->compare_interrupt, TIMERAx_capture_irqs[x - 1], "timera capture");
+        timera_irq_register(unit->overflow_interrupt, TIMERAx_capture_irqs[x - 1], "timera capture overflow");
+        TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Enable);
+        TIMERA_Cmd(unit->peripheral.register_base, Enable);
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, channel, "capture_start\n");
+
+    // reset channel state
+    timera_capture_channel_t &c = unit->state.capture_channels[channel - TimeraCh1];
+    c = timera_capture_channel_t();
+    c.pin = pin;
+
+    // capture on both edges of the pin
+    stc_timera_capture_init_t capture_config;
+    MEM_ZERO_STRUCT(capture_config);
+    capture_config.enCapturePwmRisingEn = Enable;
+    capture_config.enCapturePwmFallingEn = Enable;
+    capture_config.enCaptureSpecifyEventEn = Disable;
+    capture_config.enPwmClkDiv = TimeraFilterPclkDiv4;
+    capture_config.enPwmFilterEn = Enable;
+    capture_config.enCaptureTrigRisingEn = Disable;
+    capture_config.enCaptureTrigFallingEn = Disable;
+    capture_config.enTrigClkDiv = TimeraFilterPclkDiv1;
+    capture_config.enTrigFilterEn = Disable;
+    TIMERA_CaptureInit(unit->peripheral.register_base, channel, &capture_config);
+
+    // enable capture interrupt
+    const en_timera_flag_type_t flag = static_cast<en_timera_flag_type_t>(TimeraFlagCaptureOrCompareCh1 + (channel - TimeraCh1));
+    const en_timera_irq_type_t irq = static_cast<en_timera_irq_type_t>(TimeraIrqCaptureOrCompareCh1 + (channel - TimeraCh1));
+    TIMERA_ClearFlag(unit->peripheral.register_base, flag);
+    timera_set_channel_active_flag(unit, channel, true);
+    TIMERA_IrqCmd(unit->peripheral.register_base, irq, Enable);
+    return Ok;
+}
+
+en_result_t timera_capture_start_on_pin(const gpio_pin_t pin, const uint16_t divider, timera_config_t *&unit, en_timera_channel_t &channel)
+{
+    en_port_func_t function;
+    if (!timera_get_assignment(pin, unit, channel, function))
+    {
+        CORE_ASSERT_FAIL("timera_capture_start_on_pin: pin has no TimerA assignment");
+        return ErrorInvalidParameter;
+    }
+
+    GPIO_SetFunc(pin, function);
+    return timera_capture_start(unit, channel, pin, divider);
+}
+
+void timera_capture_stop(timera_config_t *unit, const en_timera_channel_t channel)
+{
+    CORE_ASSERT(unit != nullptr, "timera_capture_stop: unit is nullptr", return);
+    if (unit->state.capture_channels == nullptr || !timera_is_channel_active(unit, channel))
+    {
+        return;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, channel, "capture_stop\n");
+
+    // disable capture interrupt
+    const en_timera_irq_type_t irq = static_cast<en_timera_irq_type_t>(TimeraIrqCaptureOrCompareCh1 + (channel - TimeraCh1));
+    TIMERA_IrqCmd(unit->peripheral.register_base, irq, Disable);
+    timera_set_channel_active_flag(unit, channel, false);
+
+    // stop the unit once the last channel is stopped
+    if (unit->state.active_channels != 0)
+    {
+        return;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, -2, "capture_stop: stopping unit\n");
+    TIMERA_Cmd(unit->peripheral.register_base, Disable);
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Disable);
+    timera_irq_resign(unit->compare_interrupt, "timera capture");
+    timera_irq_resign(unit->overflow_interrupt, "timera capture overflow");
+
+    // reset state. the channel states are kept for the next capture
+    unit->state.capture_channels = nullptr;
+    unit->state.base_init = nullptr;
+}
+
+bool timera_capture_read_pulse(timera_config_t *unit, const en_timera_channel_t channel, const bool high, uint32_t &ticks)
+{
+    CORE_ASSERT(unit != nullptr, "timera_capture_read_pulse: unit is nullptr", return false);
+    if (unit->state.capture_channels == nullptr)
+    {
+        return false;
+    }
+
+    timera_capture_channel_t &c = unit->state.capture_channels[channel - TimeraCh1];
+    const uint8_t mask = high ? TIMERA_CAPTURE_NEW_HIGH : TIMERA_CAPTURE_NEW_LOW;
+
+    const uint32_t critical = core_critical_enter();
+    const bool is_new = (c.updated & mask) != 0;
+    ticks = high ? c.high_time : c.low_time;
+    c.updated &= ~mask;
+    core_critical_exit(critical);
+    return is_new;
+}
+
+bool timera_capture_read(timera_config_t *unit, const en_timera_channel_t channel, uint32_t &period, uint32_t &high_time)
+{
+    CORE_ASSERT(unit != nullptr, "timera_capture_read: unit is nullptr", return false);
+    if (unit->state.capture_channels == nullptr)
+    {
+        return false;
+    }
+
+    timera_capture_channel_t &c = unit->state.capture_channels[channel - TimeraCh1];
+
+    // period and high time are read together, so they belong to the same cycle
+    const uint32_t critical = core_critical_enter();
+    const bool is_new = (c.updated & TIMERA_CAPTURE_NEW_PERIOD) != 0;
+    period = c.period;
+    high_time = c.high_time;
+    c.updated &= ~TIMERA_CAPTURE_NEW_PERIOD;
+    core_critical_exit(critical);
+    return is_new;
+}
+
+uint32_t timera_capture_ticks_to_us(timera_config_t *unit, const uint32_t ticks)
+{
+    CORE_ASSERT(unit != nullptr, "timera_capture_ticks_to_us: unit is nullptr", return 0);
+    CORE_ASSERT(timera_is_unit_initialized(unit), "timera_capture_ticks_to_us: unit is not initialized", return 0);
+
+    const uint32_t base_frequency = timera_get_base_clock() / timera_clk_div_to_n(unit->state.base_init->enClkDiv);
+    return static_cast<uint32_t>((static_cast<uint64_t>(ticks) * 1000000ull) / base_frequency);
+}
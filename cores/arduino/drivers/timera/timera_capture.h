@@ -0,0 +1,135 @@
+/**
+ * TimerA input capture:
+ *
+ * in capture mode, the TimerA unit counts freely from 0 to 0xFFFF, and a channel latches the counter value
+ * into its compare register on every edge of its pin. the capture interrupt converts the latched values into
+ * pulse and period lengths, so the result is exact to the timer tick, no matter the interrupt latency.
+ * overflows of the unit extend the timestamps to 32 bits.
+ *
+ *   pin     ___/‾‾‾‾‾‾‾‾\_______________/‾‾‾‾‾‾‾‾\___
+ *              ^ t0     ^ t1            ^ t2
+ *
+ *   high_time = t1 - t0
+ *   low_time  = t2 - t1
+ *   period    = t2 - t0
+ *
+ * all times are in ticks of the base counting frequency (PCLK1 / divider).
+ */
+#pragma once
+#include "timera_config.h"
+#include "timera_util.h"
+
+/**
+ * @brief input capture state of a channel
+ */
+typedef struct timera_capture_channel_t
+{
+    /**
+     * @brief the pin that is captured
+     * @note the level of the pin tells the edge that was captured
+     */
+    gpio_pin_t pin;
+
+    /**
+     * @brief timestamp of the last rising edge
+     */
+    uint32_t last_rising;
+
+    /**
+     * @brief timestamp of the last falling edge
+     */
+    uint32_t last_falling;
+
+    /**
+     * @brief bitmask of the edges captured since the capture was started
+     * @note bit 0 == rising, bit 1 == falling
+     */
+    uint8_t seen_edges;
+
+    /**
+     * @brief length of the last HIGH pulse
+     */
+    volatile uint32_t high_time;
+
+    /**
+     * @brief length of the last LOW pulse
+     */
+    volatile uint32_t low_time;
+
+    /**
+     * @brief length of the last period, from rising to rising edge
+     */
+    volatile uint32_t period;
+
+    /**
+     * @brief bitmask of the values updated since they were last read
+     * @note see TIMERA_CAPTURE_NEW_*
+     */
+    volatile uint8_t updated;
+} timera_capture_channel_t;
+
+#define TIMERA_CAPTURE_NEW_HIGH (1 << 0)
+#define TIMERA_CAPTURE_NEW_LOW (1 << 1)
+#define TIMERA_CAPTURE_NEW_PERIOD (1 << 2)
+
+/**
+ * @brief start input capture on a channel
+ * @param unit pointer to timera unit config
+ * @param channel channel to capture
+ * @param pin the pin of the channel. the pin function has to be set by the caller, or use timera_capture_start_on_pin()
+ * @param divider clock divider of the unit. one of [1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024]
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if the unit is in use by something else, or with a different divider
+ * @note all capture channels of a unit share the divider
+ * @note pulses shorter than the interrupt latency cannot be told apart, as the edge is taken from the pin level
+ */
+en_result_t timera_capture_start(timera_config_t *unit, const en_timera_channel_t channel, const gpio_pin_t pin, const uint16_t divider);
+
+/**
+ * @brief start input capture on a pin
+ * @param pin the pin to capture. must have a TimerA assignment
+ * @param divider clock divider of the unit
+ * @param unit receives the TimerA unit of the pin
+ * @param channel receives the TimerA channel of the pin
+ * @return see timera_capture_start(). ErrorInvalidParameter if the pin has no TimerA assignment
+ */
+en_result_t timera_capture_start_on_pin(const gpio_pin_t pin, const uint16_t divider, timera_config_t *&unit, en_timera_channel_t &channel);
+
+/**
+ * @brief stop input capture on a channel
+ * @param unit pointer to timera unit config
+ * @param channel channel to stop
+ * @note once the last channel is stopped, the unit is stopped as well
+ */
+void timera_capture_stop(timera_config_t *unit, const en_timera_channel_t channel);
+
+/**
+ * @brief read the length of the last HIGH or LOW pulse
+ * @param unit pointer to timera unit config
+ * @param channel the capture channel
+ * @param high true to read the last HIGH pulse, false to read the last LOW pulse
+ * @param ticks receives the pulse length, in ticks
+ * @return true if a new pulse was measured since the last call
+ * @note never blocks
+ */
+bool timera_capture_read_pulse(timera_config_t *unit, const en_timera_channel_t channel, const bool high, uint32_t &ticks);
+
+/**
+ * @brief read the period and HIGH time of the last complete cycle
+ * @param unit pointer to timera unit config
+ * @param channel the capture channel
+ * @param period receives the period, in ticks
+ * @param high_time receives the HIGH time, in ticks
+ * @return true if a new period was measured since the last call
+ * @note never blocks
+ */
+bool timera_capture_read(timera_config_t *unit, const en_timera_channel_t channel, uint32_t &period, uint32_t &high_time);
+
+/**
+ * @brief convert capture ticks of a unit to microseconds
+ * @param unit pointer to timera unit config, in capture mode
+ * @param ticks ticks to convert
+ * @return the time, in microseconds
+ */
+uint32_t timera_capture_ticks_to_us(timera_config_t *unit, const uint32_t ticks);
@@ -1,9 +1,12 @@
 #include "timera_config.h"
+#include "../sysclock/sysclock_switch.h"
+#include "../../core_debug.h"
 
 timera_config_t TIMERA1_config = {
     .peripheral = {
         .register_base = M4_TMRA1,
         .clock_id = PWC_FCG2_PERIPH_TIMA1,
+        .overflow_event = EVT_TMRA1_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA1_OVF,
@@ -20,6 +23,7 @@ timera_config_t TIMERA2_config = {
     .peripheral = {
         .register_base = M4_TMRA2,
         .clock_id = PWC_FCG2_PERIPH_TIMA2,
+        .overflow_event = EVT_TMRA2_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA2_OVF,
@@ -36,6 +40,7 @@ timera_config_t TIMERA3_config = {
     .peripheral = {
         .register_base = M4_TMRA3,
         .clock_id = PWC_FCG2_PERIPH_TIMA3,
+        .overflow_event = EVT_TMRA3_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA3_OVF,
@@ -52,6 +57,7 @@ timera_config_t TIMERA4_config = {
     .peripheral = {
         .register_base = M4_TMRA4,
         .clock_id = PWC_FCG2_PERIPH_TIMA4,
+        .overflow_event = EVT_TMRA4_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA4_OVF,
@@ -68,6 +74,7 @@ timera_config_t TIMERA5_config = {
     .peripheral = {
         .register_base = M4_TMRA5,
         .clock_id = PWC_FCG2_PERIPH_TIMA5,
+        .overflow_event = EVT_TMRA5_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA5_OVF,
@@ -84,6 +91,7 @@ timera_config_t TIMERA6_config = {
     .peripheral = {
         .register_base = M4_TMRA6,
         .clock_id = PWC_FCG2_PERIPH_TIMA6,
+        .overflow_event = EVT_TMRA6_OVF,
     },
     .overflow_interrupt = {
         .interrupt_source = INT_TMRA6_OVF,
@@ -95,3 +103,55 @@ timera_config_t TIMERA6_config = {
         .interrupt_source = INT_TMRA6_CMP,
     },
 };
+
+//
+// clock change handling
+//
+static timera_config_t *const timera_units[] = {
+    &TIMERA1_config,
+    &TIMERA2_config,
+    &TIMERA3_config,
+    &TIMERA4_config,
+    &TIMERA5_config,
+    &TIMERA6_config,
+};
+
+static sysclock_listener_t timera_clock_listener = {};
+
+static void timera_clock_changed(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)param;
+    int8_t shift;
+    if (phase != SYSCLOCK_CHANGE_POST ||
+        !sysclock_get_shift(previous->pclk1, SYSTEM_CLOCK_FREQUENCIES.pclk1, shift) ||
+        shift == 0)
+    {
+        return;
+    }
+
+    for (timera_config_t *unit : timera_units)
+    {
+        stc_timera_base_init_t *base_init = unit->state.base_init;
+        if (base_init == nullptr)
+        {
+            continue;
+        }
+
+        // the clock divider is log2 of the division factor, so shifting it by the same amount as PCLK1
+        // keeps the count rate. period, compare and capture values all stay valid
+        const int32_t div = int32_t(base_init->enClkDiv) + shift;
+        if (div < int32_t(TimeraPclkDiv1) || div > int32_t(TimeraPclkDiv1024))
+        {
+            CORE_DEBUG_PRINTF("TimerA unit clock divider out of range after clock change, timing changed\n");
+            continue;
+        }
+
+        base_init->enClkDiv = static_cast<en_timera_clk_div_t>(div);
+        unit->peripheral.register_base->BCSTR_f.CKDIV = uint16_t(div);
+    }
+}
+
+void timera_track_clock_changes()
+{
+    sysclock_listener_register(&timera_clock_listener, timera_clock_changed, nullptr);
+}
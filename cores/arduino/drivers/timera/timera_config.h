@@ -23,8 +23,37 @@ struct timera_peripheral_config_t
      * @note in FCG2
      */
     uint32_t clock_id;
+
+    /**
+     * @brief timer overflow event, for triggering DMA or other peripherals via AOS
+     * @note eg. EVT_TMRA1_OVF
+     */
+    en_event_src_t overflow_event;
 };
 
+/**
+ * @brief timerA DMA configuration
+ * @note the DMA channel is chosen by the user of the timer, since all DMA channels may be assigned to other peripherals
+ */
+typedef struct timera_dma_config_t
+{
+    /**
+     * @brief DMA peripheral register base address
+     */
+    M4_DMA_TypeDef *register_base;
+
+    /**
+     * @brief DMA peripheral clock id
+     * @note in FCG0
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief DMA channel
+     */
+    en_dma_channel_t channel;
+} timera_dma_config_t;
+
 /**
  * @brief timerA interrupt config
  */
@@ -49,15 +78,91 @@ typedef struct timera_runtime_state_t
 {
     /**
      * @brief TimerA unit base init configuration.
-     * @note NULL if not initialized.
+     * @note NULL if not initialized. otherwise, points to base_init_storage
      */
     stc_timera_base_init_t *base_init;
 
+    /**
+     * @brief storage of the base init configuration
+     * @note static, so (re-)initializing a unit never allocates
+     */
+    stc_timera_base_init_t base_init_storage;
+
     /**
      * @brief TimerA unit active channels
      * @note use TIMERA_STATE_ACTIVE_CHANNEL_BIT(ch) to get bit positions
      */
     uint8_t active_channels;
+
+    /**
+     * @brief TimerA unit channels with the compare output enabled
+     * @note use TIMERA_STATE_ACTIVE_CHANNEL_BIT(ch) to get bit positions
+     */
+    uint8_t output_channels;
+
+    /**
+     * @brief TimerA unit channels with a buffered compare value
+     * @note use TIMERA_STATE_ACTIVE_CHANNEL_BIT(ch) to get bit positions. see timera_pwm_set_buffered()
+     */
+    uint8_t buffered_channels;
+
+    /**
+     * @brief period (PERAR) of the unit, cached by timera_pwm_start()
+     */
+    uint16_t pwm_period;
+
+    /**
+     * @brief duty_scale that pwm_duty_factor was calculated for
+     * @note 0 if pwm_duty_factor is not valid
+     */
+    uint32_t pwm_duty_scale;
+
+    /**
+     * @brief (pwm_period << 16) / pwm_duty_scale, as 16.16 fixed-point
+     * @note cmp_s = (duty * pwm_duty_factor) >> 16
+     */
+    uint32_t pwm_duty_factor;
+
+    /**
+     * @brief DMA channel used for waveform playback
+     * @note NULL if no waveform is playing
+     */
+    const timera_dma_config_t *waveform_dma;
+
+    /**
+     * @brief position offset of the unit in counter mode
+     * @note updated by the overflow and underflow interrupts, in steps of 0x10000
+     */
+    volatile int32_t counter_offset;
+
+    /**
+     * @brief input capture state of each channel
+     * @note NULL if no channel of the unit is in capture mode. otherwise, an array of 8 channels
+     */
+    struct timera_capture_channel_t *capture_channels;
+
+    /**
+     * @brief overflows of the unit in capture mode
+     * @note upper bits of capture timestamps
+     */
+    volatile uint32_t capture_overflows;
+
+    /**
+     * @brief is the unit generating a tone?
+     */
+    volatile bool tone_playing;
+
+    /**
+     * @brief output toggles left until the tone stops
+     * @note 0 if the tone plays until stopped
+     */
+    volatile uint32_t tone_toggles_left;
+
+    /**
+     * @brief called once a tone with a duration stopped on its own
+     * @note may be NULL
+     */
+    void (*tone_done)(struct timera_config_t *unit);
 } timera_runtime_state_t;
 
 /**
@@ -128,3 +233,9 @@ extern timera_config_t TIMERA5_config;
  * @brief TimerA Unit 6 configuration
  */
 extern timera_config_t TIMERA6_config;
+
+/**
+ * @brief keep the count rate of initialized TimerA units when PCLK1 changes at runtime
+ * @note call after initializing a unit. registers the clock change listener of all units once
+ */
+void timera_track_clock_changes();
@@ -0,0 +1,210 @@
+#include "timera_counter.h"
+#include "../gpio/gpio.h"
+#include "timera_irq.h"
+#include "../../core_critical.h"
+
+//
+// wrap-around interrupt handlers
+//
+static timera_config_t *TIMERAx[6] = {
+    &TIMERA1_config,
+    &TIMERA2_config,
+    &TIMERA3_config,
+    &TIMERA4_config,
+    &TIMERA5_config,
+    &TIMERA6_config,
+};
+
+template <uint8_t x>
+static void TIMERAx_counter_overflow_irq(void)
+{
+    timera_config_t *unit = TIMERAx[x - 1];
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagOverflow);
+    unit->state.counter_offset += 0x10000;
+}
+
+template <uint8_t x>
+static void TIMERAx_counter_underflow_irq(void)
+{
+    timera_config_t *unit = TIMERAx[x - 1];
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagUnderflow);
+    unit->state.counter_offset -= 0x10000;
+}
+
+static const func_ptr_t TIMERAx_counter_overflow_irqs[6] = {
+    TIMERAx_counter_overflow_irq<1>,
+    TIMERAx_counter_overflow_irq<2>,
+    TIMERAx_counter_overflow_irq<3>,
+    TIMERAx_counter_overflow_irq<4>,
+    TIMERAx_counter_overflow_irq<5>,
+    TIMERAx_counter_overflow_irq<6>,
+};
+
+static const func_ptr_t TIMERAx_counter_underflow_irqs[6] = {
+    TIMERAx_counter_underflow_irq<1>,
+    TIMERAx_counter_underflow_irq<2>,
+    TIMERAx_counter_underflow_irq<3>,
+    TIMERAx_counter_underflow_irq<4>,
+    TIMERAx_counter_underflow_irq<5>,
+    TIMERAx_counter_underflow_irq<6>,
+};
+
+//
+// public API
+//
+
+en_result_t timera_counter_start(timera_config_t *unit, const timera_counter_mode_t mode)
+{
+    CORE_ASSERT(unit != nullptr, "timera_counter_start: unit is nullptr", return ErrorInvalidParameter);
+    if (timera_is_unit_initialized(unit))
+    {
+        return ErrorOperationInProgress;
+    }
+
+    const int x = TIMERA_REG_TO_X(unit->peripheral.register_base);
+    CORE_ASSERT(x >= 1 && x <= 6, "timera_counter_start: unit is invalid", return ErrorInvalidParameter);
+
+    // prepare unit config
+    // (stored in the unit's state. only valid once base_init points to it)
+    stc_timera_base_init_t *unit_config = &unit->state.base_init_storage;
+    unit_config->enClkDiv = TimeraPclkDiv1;               // unused, counts input edges
+    unit_config->enCntMode = TimeraCountModeSawtoothWave; // sawtooth wave mode
+    unit_config->enCntDir = TimeraCountDirUp;             // count up
+    unit_config->enSyncStartupEn = Disable;               // no sync startup
+    unit_config->u16PeriodVal = 0xFFFF;                   // use full 16 bit range, wrap around is handled by interrupts
+
+    // select counting edges
+    stc_timera_hw_count_up_config_t count_up;
+    stc_timera_hw_count_down_config_t count_down;
+    MEM_ZERO_STRUCT(count_up);
+    MEM_ZERO_STRUCT(count_down);
+    switch (mode)
+    {
+    case TIMERA_COUNTER_QUADRATURE:
+        // CLKA leading CLKB
+        count_up.enClkBLowAndClkARisingUpEn = Enable;
+        count_up.enClkAHighAndClkBRisingUpEn = Enable;
+        count_up.enClkBHighAndClkAFallingUpEn = Enable;
+        count_up.enClkALowAndClkBFallingUpEn = Enable;
+
+        // CLKB leading CLKA
+        count_down.enClkBHighAndClkARisingDownEn = Enable;
+        count_down.enClkALowAndClkBRisingDownEn = Enable;
+        count_down.enClkBLowAndClkAFallingDownEn = Enable;
+        count_down.enClkAHighAndClkBFallingDownEn = Enable;
+        break;
+    case TIMERA_COUNTER_PULSE:
+        count_up.enClkBLowAndClkARisingUpEn = Enable;
+        count_up.enClkBHighAndClkARisingUpEn = Enable;
+        break;
+    case TIMERA_COUNTER_PULSE_DIRECTION:
+        count_up.enClkBHighAndClkARisingUpEn = Enable;
+        count_down.enClkBLowAndClkARisingDownEn = Enable;
+        break;
+    default:
+        CORE_ASSERT_FAIL("timera_counter_start: invalid mode");
+        return ErrorInvalidParameter;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, -2, "counter_start: mode=%d\n", int(mode));
+
+    // start peripheral clocks for TimerA unit and AOS
+    PWC_Fcg2PeriphClockCmd(unit->peripheral.clock_id, Enable);
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // initialize unit
+    TIMERA_BaseInit(unit->peripheral.register_base, unit_config);
+    TIMERA_HwCountUpConfig(unit->peripheral.register_base, &count_up);
+    TIMERA_HwCountDownConfig(unit->peripheral.register_base, &count_down);
+    TIMERA_SetCurrCount(unit->peripheral.register_base, 0);
+    unit->state.base_init = unit_config;
+    unit->state.counter_offset = 0;
+    timera_track_clock_changes();
+
+    // extend the counter to 32 bits
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagOverflow);
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagUnderflow);
+    timera_irq_register(unit->overflow_interrupt, TIMERAx_counter_overflow_irqs[x - 1], "timera counter overflow");
+    timera_irq_register(unit->underflow_interrupt, TIMERAx_counter_underflow_irqs[x - 1], "timera counter underflow");
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Enable);
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqUnderflow, Enable);
+
+    return TIMERA_Cmd(unit->peripheral.register_base, Enable);
+}
+
+en_result_t timera_counter_start_on_pins(const gpio_pin_t pin_a, const gpio_pin_t pin_b, const timera_counter_mode_t mode, timera_config_t *&unit)
+{
+    // CLKA is the channel 1 pin of the unit
+    en_timera_channel_t channel_a;
+    en_port_func_t function_a;
+    if (!timera_get_assignment(pin_a, unit, channel_a, function_a) || channel_a != TimeraCh1)
+    {
+        CORE_ASSERT_FAIL("timera_counter_start_on_pins: pin_a is not CLKA of a TimerA unit");
+        return ErrorInvalidParameter;
+    }
+
+    GPIO_SetFunc(pin_a, function_a);
+
+    // CLKB is the channel 2 pin of the same unit
+    if (mode != TIMERA_COUNTER_PULSE)
+    {
+        timera_config_t *unit_b;
+        en_timera_channel_t channel_b;
+        en_port_func_t function_b;
+        if (!timera_get_assignment(pin_b, unit_b, channel_b, function_b) || unit_b != unit || channel_b != TimeraCh2)
+        {
+            CORE_ASSERT_FAIL("timera_counter_start_on_pins: pin_b is not CLKB of the unit of pin_a");
+            return ErrorInvalidParameter;
+        }
+
+        GPIO_SetFunc(pin_b, function_b);
+    }
+
+    return timera_counter_start(unit, mode);
+}
+
+void timera_counter_stop(timera_config_t *unit)
+{
+    CORE_ASSERT(unit != nullptr, "timera_counter_stop: unit is nullptr", return);
+    if (!timera_is_unit_initialized(unit))
+    {
+        return;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, -2, "counter_stop\n");
+    TIMERA_Cmd(unit->peripheral.register_base, Disable);
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Disable);
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqUnderflow, Disable);
+    timera_irq_resign(unit->overflow_interrupt, "timera counter overflow");
+    timera_irq_resign(unit->underflow_interrupt, "timera counter underflow");
+
+    // reset state
+    unit->state.base_init = nullptr;
+}
+
+int32_t timera_counter_get(timera_config_t *unit)
+{
+    CORE_ASSERT(unit != nullptr, "timera_counter_get: unit is nullptr", return 0);
+
+    // re-read if a wrap-around interrupt updated the offset in between
+    int32_t offset;
+    uint16_t count;
+    do
+    {
+        offset = unit->state.counter_offset;
+        count = TIMERA_GetCurrCount(unit->peripheral.register_base);
+    } while (offset != unit->state.counter_offset);
+
+    return offset + count;
+}
+
+void timera_counter_set(timera_config_t *unit, const int32_t position)
+{
+    CORE_ASSERT(unit != nullptr, "timera_counter_set: unit is nullptr", return);
+
+    // the lower 16 bits are held by the hardware counter
+    const uint32_t critical = core_critical_enter();
+    TIMERA_SetCurrCount(unit->peripheral.register_base, static_cast<uint16_t>(position & 0xFFFF));
+    unit->state.counter_offset = position - (position & 0xFFFF);
+    core_critical_exit(critical);
+}
@@ -0,0 +1,84 @@
+/**
+ * TimerA counter mode:
+ *
+ * in counter mode, the TimerA unit does not count the PCLK1 clock, but edges on its CLKA and CLKB inputs.
+ * CLKA and CLKB are the pins of channel 1 and 2 of the unit (TIMn_PWM1 and TIMn_PWM2).
+ * the counter counts up or down in hardware, depending on the mode and the level of the other input,
+ * so no interrupt is needed per edge.
+ * the 16 bit counter is extended to 32 bits by the overflow and underflow interrupts, once every 65536 counts.
+ *
+ * quadrature mode (x4, CLKA leading CLKB counts up):
+ *
+ *   CLKA  ___/‾‾‾‾‾‾‾\_______/‾‾‾‾‾‾‾\___
+ *   CLKB  _______/‾‾‾‾‾‾‾\_______/‾‾‾‾‾‾‾
+ *   count   +1  +1  +1  +1  +1  +1  +1
+ */
+#pragma once
+#include "timera_config.h"
+#include "timera_util.h"
+
+/**
+ * @brief TimerA counter mode
+ */
+typedef enum timera_counter_mode_t
+{
+    /**
+     * @brief count every edge of a quadrature encoder on CLKA and CLKB (x4)
+     * @note counts up if CLKA leads CLKB, down otherwise
+     */
+    TIMERA_COUNTER_QUADRATURE,
+
+    /**
+     * @brief count rising edges on CLKA. CLKB is not used
+     */
+    TIMERA_COUNTER_PULSE,
+
+    /**
+     * @brief count rising edges on CLKA, with CLKB as direction input
+     * @note counts up while CLKB is HIGH, down while it is LOW
+     */
+    TIMERA_COUNTER_PULSE_DIRECTION,
+} timera_counter_mode_t;
+
+/**
+ * @brief start a TimerA unit in counter mode
+ * @param unit pointer to timera unit config
+ * @param mode counter mode
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if the unit is already in use
+ * @note the pin functions of CLKA and CLKB have to be set by the caller, or use timera_counter_start_on_pins()
+ * @note the position starts at 0
+ */
+en_result_t timera_counter_start(timera_config_t *unit, const timera_counter_mode_t mode);
+
+/**
+ * @brief start a TimerA unit in counter mode, with CLKA and CLKB on the given pins
+ * @param pin_a pin of CLKA. must be channel 1 of a TimerA unit
+ * @param pin_b pin of CLKB. must be channel 2 of the same unit. ignored in TIMERA_COUNTER_PULSE mode
+ * @param mode counter mode
+ * @param unit receives the TimerA unit of the pins
+ * @return see timera_counter_start(). ErrorInvalidParameter if the pins are not CLKA and CLKB of a unit
+ */
+en_result_t timera_counter_start_on_pins(const gpio_pin_t pin_a, const gpio_pin_t pin_b, const timera_counter_mode_t mode, timera_config_t *&unit);
+
+/**
+ * @brief stop a TimerA unit in counter mode
+ * @param unit pointer to timera unit config
+ */
+void timera_counter_stop(timera_config_t *unit);
+
+/**
+ * @brief get the position of a TimerA counter
+ * @param unit pointer to timera unit config
+ * @return current position
+ * @note call with interrupts enabled. otherwise, a pending wrap-around may be missed
+ */
+int32_t timera_counter_get(timera_config_t *unit);
+
+/**
+ * @brief set the position of a TimerA counter
+ * @param unit pointer to timera unit config
+ * @param position new position
+ */
+void timera_counter_set(timera_config_t *unit, const int32_t position);
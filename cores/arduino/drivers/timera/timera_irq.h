@@ -0,0 +1,39 @@
+#pragma once
+#include <hc32_ddl.h>
+#include "timera_config.h"
+#include "../irqn/irqn.h"
+
+//
+// IRQ register / unregister helper
+//
+inline void timera_irq_register(timera_interrupt_config_t &irq, const func_ptr_t handler, const char *name)
+{
+    // get auto-assigned irqn and set in irq struct
+    IRQn_Type irqn;
+    irqn_aa_get(irqn, name);
+    irq.interrupt_number = irqn;
+
+    // create irq registration struct
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = irq.interrupt_source,
+        .enIRQn = irq.interrupt_number,
+        .pfnCallback = handler,
+    };
+
+    // register and enable irq
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, IRQ_PRIORITY_TIMERA);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+}
+
+inline void timera_irq_resign(timera_interrupt_config_t &irq, const char *name)
+{
+    // disable interrupt and clear pending
+    NVIC_DisableIRQ(irq.interrupt_number);
+    NVIC_ClearPendingIRQ(irq.interrupt_number);
+    enIrqResign(irq.interrupt_number);
+
+    // resign auto-assigned irqn
+    irqn_aa_resign(irq.interrupt_number, name);
+}
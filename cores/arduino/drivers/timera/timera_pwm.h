@@ -109,9 +109,19 @@
  *
  * delta_cmp_s = 3.125 - 2.500
  *             = 625
+ *
+ *
+ * buffered compare values:
+ * a compare value written while the unit counts takes effect right away. if the new cmp_s is below the current count
+ * and the old one was above it, the pulse misses its compare match for one period (one glitched 100% pulse).
+ * with timera_pwm_set_buffered(), the channel's compare value is written to a buffer instead, and copied to cmp_s by
+ * the hardware at the next period start. each odd channel (1, 3, 5, 7) uses the compare register of the following
+ * channel as its buffer, so that channel cannot be used while the buffer is enabled.
+ * timera_pwm_set_duties() updates several channels at once, so all of them change in the same period.
  */
-
+#pragma once
 #include "timera_util.h"
+#include "../../core_critical.h"
 
 #define TIMERA_PWM_UNIT_S 1
 #define TIMERA_PWM_UNIT_MS 1000
@@ -155,6 +165,75 @@
 
 en_result_t timera_pwm_channel_stop(timera_config_t *unit, const en_timera_channel_t channel);
 
+#ifndef TIMERA_PWM_BATCH_MARGIN
+/**
+ * @brief margin before the period end in which timera_pwm_set_duties() waits for the next period, in timer counts
+ * @note only used for channels without a buffered compare value
+ */
+#define TIMERA_PWM_BATCH_MARGIN 32
+#endif
+
+/**
+ * @brief is the compare value of a channel buffered?
+ */
+inline bool timera_pwm_is_buffered(const timera_config_t *unit, const en_timera_channel_t channel)
+{
+    return (unit->state.buffered_channels & TIMERA_STATE_ACTIVE_CHANNEL_BIT(TIMERA_CHANNEL_TO_X(channel))) != 0;
+}
+
+/**
+ * @brief is a channel used as the compare buffer of the channel before it?
+ */
+inline bool timera_pwm_is_buffer_channel(const timera_config_t *unit, const en_timera_channel_t channel)
+{
+    return (int(channel) % 2) == 1 && timera_pwm_is_buffered(unit, static_cast<en_timera_channel_t>(int(channel) - 1));
+}
+
+/**
+ * @brief write the compare value of a channel, to the buffer if the channel is buffered
+ */
+inline void timera_pwm_write_compare(timera_config_t *unit, const en_timera_channel_t channel, const uint16_t cmp_s)
+{
+    if (timera_pwm_is_buffered(unit, channel))
+    {
+        TIMERA_SetCacheValue(unit->peripheral.register_base, channel, cmp_s);
+    }
+    else
+    {
+        TIMERA_SetCompareValue(unit->peripheral.register_base, channel, cmp_s);
+    }
+}
+
+/**
+ * @brief read the compare value of a channel. for a buffered channel, this is the value of the next period
+ */
+inline uint16_t timera_pwm_read_compare(timera_config_t *unit, const en_timera_channel_t channel)
+{
+    if (timera_pwm_is_buffered(unit, channel))
+    {
+        return TIMERA_GetCompareValue(unit->peripheral.register_base, static_cast<en_timera_channel_t>(int(channel) + 1));
+    }
+
+    return TIMERA_GetCompareValue(unit->peripheral.register_base, channel);
+}
+
+/**
+ * @brief enable the compare output of a channel, if not already enabled
+ * @param unit pointer to timera unit config
+ * @param channel channel to enable
+ */
+inline en_result_t timera_pwm_channel_output_enable(timera_config_t *unit, const en_timera_channel_t channel)
+{
+    const uint8_t bit = TIMERA_STATE_ACTIVE_CHANNEL_BIT(TIMERA_CHANNEL_TO_X(channel));
+    if ((unit->state.output_channels & bit) != 0)
+    {
+        return Ok;
+    }
+
+    unit->state.output_channels |= bit;
+    return TIMERA_CompareCmd(unit->peripheral.register_base, channel, Enable);
+}
+
 /**
  * @brief initialize a timera unit for PWM output
  * @param unit pointer to timera unit config
@@ -164,6 +243,8 @@ en_result_t timera_pwm_channel_stop(timera_config_t *unit, const en_timera_chann
  *                                      function will try to use the existing config if possible.
  *                                      timera_pwm* functions will still work, but the frequency may be wrong.
  *                                      if false, the function will fail with ErrorOperationInProgress
+ * @param sync_start if true, a newly initialized unit does not start counting now, but together with TimerA unit 1.
+ *                   see timera_pwm_group_start()
  * @return Ok on success,
  *         ErrorInvalidParameter if parameters not valid,
  *         ErrorOperationInProgress if unit already initialized with a incompatible config
@@ -171,7 +252,8 @@ en_result_t timera_pwm_channel_stop(timera_config_t *unit, const en_timera_chann
 inline en_result_t timera_pwm_start(timera_config_t *unit,
                                     const uint32_t frequency,
                                     const uint32_t divider,
-                                    const bool allow_use_incompatible_config = true)
+                                    const bool allow_use_incompatible_config = true,
+                                    const bool sync_start = false)
 {
     CORE_ASSERT(unit != nullptr, "timera_pwm_unit_start: unit is nullptr", return ErrorInvalidParameter);
     CORE_ASSERT(divider > 0 && divider <= 1024, "timera_pwm_unit_start: divider is invalid", return ErrorInvalidParameter);
@@ -187,14 +269,17 @@ inline en_result_t timera_pwm_start(timera_config_t *unit,
     CORE_ASSERT(PERAR > 0 && PERAR <= 0xFFFF, "timera_pwm_unit_start: PERAR is out-of-range", return Error);
 
     // prepare unit config
-    // (when initializing, a pointer to this is stored in the unit's state. so we need to allocate it on the heap)
-    stc_timera_base_init_t *unit_config = new stc_timera_base_init_t;
+    // (only copied to the unit's state when initializing, so nothing is allocated)
+    stc_timera_base_init_t config;
+    stc_timera_base_init_t *unit_config = &config;
     unit_config->enClkDiv = timera_n_to_clk_div(divider);     // PCLK1 / divider
     unit_config->enCntMode = TimeraCountModeSawtoothWave;     // sawtooth wave mode
     unit_config->enCntDir = TimeraCountDirUp;                 // count up
-    unit_config->enSyncStartupEn = Disable;                   // no sync startup
     unit_config->u16PeriodVal = static_cast<uint16_t>(PERAR); // 0..PERAR,0
 
+    // sync startup: start when unit 1 starts. unit 1 has no sync startup, and is started manually
+    unit_config->enSyncStartupEn = (sync_start && unit != &TIMERA1_config) ? Enable : Disable;
+
     TIMERA_DEBUG_PRINTF(unit, -2, "pwm_start: pwm init with f=%ldHz (PCLK1/%ld), f_base=%ld (T=%ld), PERAR=%d\n", frequency, divider, int32_t(f_base), int32_t(T), uint16_t(PERAR));
 
     // initialize unit
@@ -210,8 +295,6 @@ inline en_result_t timera_pwm_start(timera_config_t *unit,
         if (current_config->enCntMode != unit_config->enCntMode ||
             current_config->enCntDir != unit_config->enCntDir)
         {
-            // free heap memory
-            delete unit_config;
             return ErrorOperationInProgress;
         }
 
@@ -222,15 +305,16 @@ inline en_result_t timera_pwm_start(timera_config_t *unit,
             // configs are different, if we are not allowed to just roll with it, error out
             if (!allow_use_incompatible_config)
             {
-                // free heap memory
-                delete unit_config;
                 return ErrorOperationInProgress;
             }
 
             TIMERA_DEBUG_PRINTF(unit, -2, "pwm_start: semi-compatible config. rolling with it\n");
         }
 
-        // sync startup really shouldn't matter...
+        // sync startup only matters for newly initialized units...
+
+        // config is not used, the unit keeps running with current_config
+        unit_config = current_config;
     }
     else
     {
@@ -242,11 +326,23 @@ inline en_result_t timera_pwm_start(timera_config_t *unit,
         PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
 
         // initialize unit
+        unit->state.base_init_storage = config;
+        unit_config = &unit->state.base_init_storage;
         TIMERA_BaseInit(unit->peripheral.register_base, unit_config);
         unit->state.base_init = unit_config;
+        timera_track_clock_changes();
+    }
+
+    // cache the period for timera_pwm_set_duty(), and invalidate the duty factor
+    unit->state.pwm_period = unit_config->u16PeriodVal;
+    unit->state.pwm_duty_scale = 0;
+
+    // ensure timer is started, unless it waits for unit 1 (or is unit 1, started by the caller)
+    if (sync_start)
+    {
+        return Ok;
     }
 
-    // ensure timer is started
     return TIMERA_Cmd(unit->peripheral.register_base, Enable);
 }
 
@@ -269,9 +365,12 @@ inline en_result_t timera_pwm_stop_hard(timera_config_t *unit)
     }
 
     // reset state
-    delete unit->state.base_init;
     unit->state.base_init = nullptr;
     unit->state.active_channels = 0;
+    unit->state.output_channels = 0;
+    unit->state.buffered_channels = 0;
+    unit->state.pwm_period = 0;
+    unit->state.pwm_duty_scale = 0;
     return Ok;
 }
 
@@ -295,6 +394,105 @@ inline en_result_t timera_pwm_stop_if_not_in_use(timera_config_t *unit)
     return timera_pwm_stop_hard(unit);
 }
 
+/**
+ * @brief start multiple TimerA units for PWM output, counting in sync
+ * @param units the units to start. must include TimerA unit 1, which starts the other units in hardware
+ * @param count number of units
+ * @param frequency PWM frequency in Hz, shared by all units
+ * @param divider clock divider, shared by all units. one of [1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024]
+ * @param phase_offsets delay of each unit's period start, in phase_scale parts of a period. NULL to start all units in phase
+ * @param phase_scale scale of phase_offsets. default is 100 (for percent)
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if one of the units is already initialized
+ *
+ * @note with phase offsets, the duty windows of the units are staggered, eg. to spread the current peaks of multiple
+ *       heaters. the channels of a unit always share the unit's phase.
+ * @note the PWM channels are set up as usual, eg. using timera_pwm_set_duty()
+ */
+inline en_result_t timera_pwm_group_start(timera_config_t *const *units,
+                                          const uint8_t count,
+                                          const uint32_t frequency,
+                                          const uint32_t divider,
+                                          const uint32_t *phase_offsets = nullptr,
+                                          const uint32_t phase_scale = 100)
+{
+    CORE_ASSERT(units != nullptr && count > 0, "timera_pwm_group_start: no units", return ErrorInvalidParameter);
+    CORE_ASSERT(phase_scale > 0, "timera_pwm_group_start: phase_scale must be > 0", return ErrorInvalidParameter);
+
+    // unit 1 is the sync master and must be part of the group. all units must be free
+    bool has_master = false;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        CORE_ASSERT(units[i] != nullptr, "timera_pwm_group_start: unit is nullptr", return ErrorInvalidParameter);
+        if (timera_is_unit_initialized(units[i]))
+        {
+            return ErrorOperationInProgress;
+        }
+
+        has_master |= (units[i] == &TIMERA1_config);
+    }
+
+    CORE_ASSERT(has_master, "timera_pwm_group_start: TimerA unit 1 must be part of the group", return ErrorInvalidParameter);
+    TIMERA_DEBUG_PRINTF(units[0], -2, "pwm_group_start: count=%d, phase_offsets=%d\n", count, phase_offsets != nullptr ? 1 : 0);
+
+    // initialize all units, without starting them
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const en_result_t result = timera_pwm_start(units[i], frequency, divider, false, true);
+        if (result != Ok)
+        {
+            for (uint8_t j = 0; j <= i; j++)
+            {
+                timera_pwm_stop_hard(units[j]);
+            }
+
+            return result;
+        }
+    }
+
+    // a unit that starts counting at (period - delay) reaches its period match `delay` counts late
+    if (phase_offsets != nullptr)
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint32_t period = uint32_t(units[i]->state.pwm_period) + 1;
+            const uint32_t delay = (uint64_t(phase_offsets[i] % phase_scale) * period) / phase_scale;
+            const uint16_t start_count = static_cast<uint16_t>((period - delay) % period);
+            TIMERA_DEBUG_PRINTF(units[i], -2, "pwm_group_start: delay=%ld, start_count=%d\n", delay, start_count);
+            TIMERA_SetCurrCount(units[i]->peripheral.register_base, start_count);
+        }
+    }
+
+    // starting unit 1 starts all other units in the same clock cycle
+    return TIMERA_Cmd(TIMERA1_config.peripheral.register_base, Enable);
+}
+
+/**
+ * @brief start multiple TimerA units for PWM output, with their periods evenly staggered
+ * @param units the units to start. must include TimerA unit 1
+ * @param count number of units
+ * @param frequency PWM frequency in Hz, shared by all units
+ * @param divider clock divider, shared by all units
+ * @return see timera_pwm_group_start()
+ * @note unit i is delayed by i / count of a period
+ */
+inline en_result_t timera_pwm_group_start_staggered(timera_config_t *const *units,
+                                                    const uint8_t count,
+                                                    const uint32_t frequency,
+                                                    const uint32_t divider)
+{
+    CORE_ASSERT(count > 0 && count <= 6, "timera_pwm_group_start_staggered: invalid count", return ErrorInvalidParameter);
+
+    uint32_t phase_offsets[6];
+    for (uint8_t i = 0; i < count; i++)
+    {
+        phase_offsets[i] = i;
+    }
+
+    return timera_pwm_group_start(units, count, frequency, divider, phase_offsets, count);
+}
+
 /**
  * @brief start a PWM channel
  * @param unit pointer to timera unit config
@@ -319,7 +517,7 @@ inline en_result_t timera_pwm_channel_start(timera_config_t *unit, const en_time
 
     if (start_now)
     {
-        TIMERA_CompareCmd(unit->peripheral.register_base, channel, Enable);
+        timera_pwm_channel_output_enable(unit, channel);
     }
 
     // set active flag
@@ -338,7 +536,15 @@ inline en_result_t timera_pwm_channel_stop(timera_config_t *unit, const en_timer
 {
     CORE_ASSERT(unit != nullptr, "timera_pwm_channel_stop: unit is nullptr", return ErrorInvalidParameter);
     TIMERA_DEBUG_PRINTF(unit, channel, "pwm_channel_stop\n");
+    if (timera_pwm_is_buffered(unit, channel))
+    {
+        TIMERA_CompareCacheCmd(unit->peripheral.register_base, channel, Disable);
+        unit->state.buffered_channels &= ~TIMERA_STATE_ACTIVE_CHANNEL_BIT(TIMERA_CHANNEL_TO_X(channel));
+        timera_set_channel_active_flag(unit, static_cast<en_timera_channel_t>(int(channel) + 1), false);
+    }
+
     timera_set_channel_active_flag(unit, channel, false);
+    unit->state.output_channels &= ~TIMERA_STATE_ACTIVE_CHANNEL_BIT(TIMERA_CHANNEL_TO_X(channel));
     return TIMERA_CompareCmd(unit->peripheral.register_base, channel, Disable);
 }
 
@@ -361,6 +567,7 @@ inline en_result_t timera_pwm_set_period(timera_config_t *unit,
     CORE_ASSERT(unit != nullptr, "timera_pwm_set_period: unit is nullptr", return ErrorInvalidParameter);
     CORE_ASSERT(unit->state.base_init != nullptr, "timera_pwm_set_period: unit not initialized", return ErrorInvalidParameter);
     CORE_ASSERT(period >= 0, "timera_pwm_set_period: period must be positive", return ErrorInvalidParameter);
+    CORE_ASSERT(!timera_pwm_is_buffer_channel(unit, channel), "timera_pwm_set_period: channel is used as compare buffer", return ErrorOperationInProgress);
 
     if (!timera_is_channel_active(unit, channel))
     {
@@ -392,10 +599,10 @@ inline en_result_t timera_pwm_set_period(timera_config_t *unit,
     // set compare value
     TIMERA_DEBUG_PRINTF(unit, channel, "pwm_set_period: period=%ld, period_unit=%ld, invert=%d, cmp_s=%d, f=%ld\n",
                         period, period_unit, invert ? 1 : 0, int16_t(cmp_s), int32_t(f_base));
-    TIMERA_SetCompareValue(unit->peripheral.register_base, channel, static_cast<uint16_t>(cmp_s));
+    timera_pwm_write_compare(unit, channel, static_cast<uint16_t>(cmp_s));
 
     // ensure channel compare function is enabled
-    return TIMERA_CompareCmd(unit->peripheral.register_base, channel, Enable);
+    return timera_pwm_channel_output_enable(unit, channel);
 }
 
 /**
@@ -422,7 +629,7 @@ inline int32_t timera_pwm_get_period(timera_config_t *unit,
     const int64_t f_base = timera_get_base_clock() / divider;
 
     // get compare value
-    uint16_t cmp_s = TIMERA_GetCompareValue(unit->peripheral.register_base, channel);
+    uint16_t cmp_s = timera_pwm_read_compare(unit, channel);
 
     // invert if requested
     if (invert)
@@ -435,6 +642,33 @@ inline int32_t timera_pwm_get_period(timera_config_t *unit,
     return TIMERA_PWM_CALC_PERIOD_FROM_CMP(f_base, int64_t(cmp_s), int64_t(period_unit));
 }
 
+/**
+ * @brief convert a duty cycle to a channel compare value
+ * @param unit pointer to timera unit config
+ * @param duty duty cycle (0-duty_scale)
+ * @param duty_scale scale of duty cycle
+ * @param invert if true, invert the PWM signal
+ * @return the compare value (cmp_s)
+ */
+inline uint16_t timera_pwm_duty_to_compare(timera_config_t *unit, const uint32_t duty, const uint32_t duty_scale, const bool invert)
+{
+    // since we only care about the duty, we can simplify the calculation by using PERAR and taking a percentage of it.
+    // PERAR / duty_scale is cached as fixed-point factor, so this is only divided once per scale
+    const uint16_t PERAR = unit->state.pwm_period;
+    if (unit->state.pwm_duty_scale != duty_scale)
+    {
+        unit->state.pwm_duty_factor = ((uint64_t(PERAR) << 16) + (duty_scale / 2)) / duty_scale;
+        unit->state.pwm_duty_scale = duty_scale;
+    }
+
+    // constrain to 0 <= cmp_s <= PERAR (rounding may overshoot by one)
+    const uint64_t cmp = (uint64_t(duty) * unit->state.pwm_duty_factor + 0x8000) >> 16;
+    const uint16_t cmp_s = static_cast<uint16_t>(TIMERA_CONSTRAIN(cmp, 0, uint64_t(PERAR)));
+
+    // invert if requested
+    return invert ? PERAR - cmp_s : cmp_s;
+}
+
 /**
  * @brief set PWM duty cycle for a channel
  * @param unit pointer to timera unit config
@@ -453,7 +687,8 @@ inline en_result_t timera_pwm_set_duty(timera_config_t *unit,
 {
     CORE_ASSERT(unit != nullptr, "timera_pwm_set_duty: unit is nullptr", return ErrorInvalidParameter);
     CORE_ASSERT(unit->state.base_init != nullptr, "timera_pwm_set_duty: unit not initialized", return ErrorInvalidParameter);
-    CORE_ASSERT(duty >= 0 && duty <= duty_scale, "timera_pwm_set_duty: duty must be between 0 and duty_scale", return ErrorInvalidParameter);
+    CORE_ASSERT(duty_scale > 0 && duty <= duty_scale, "timera_pwm_set_duty: duty must be between 0 and duty_scale", return ErrorInvalidParameter);
+    CORE_ASSERT(!timera_pwm_is_buffer_channel(unit, channel), "timera_pwm_set_duty: channel is used as compare buffer", return ErrorOperationInProgress);
 
     if (!timera_is_channel_active(unit, channel))
     {
@@ -462,26 +697,15 @@ inline en_result_t timera_pwm_set_duty(timera_config_t *unit,
         timera_pwm_channel_start(unit, channel, false);
     }
 
-    // since we only care about the duty, we can simplify the calculation by using PERAR and taking a percentage of it
-    const uint16_t PERAR = TIMERA_GetPeriodValue(unit->peripheral.register_base);
-    uint16_t cmp_s = (PERAR * duty) / duty_scale;
-
-    // invert if requested
-    if (invert)
-    {
-        cmp_s = PERAR - cmp_s;
-    }
-
-    // constrain to 0 <= cmp_s <= PERAR
-    cmp_s = TIMERA_CONSTRAIN(cmp_s, 0, PERAR);
+    const uint16_t cmp_s = timera_pwm_duty_to_compare(unit, duty, duty_scale, invert);
 
     // set compare value
     TIMERA_DEBUG_PRINTF(unit, channel, "pwm_set_duty: duty=%ld, duty_scale=%ld, invert=%d, cmp_s=%d, PERAR=%d\n",
-                        duty, duty_scale, invert ? 1 : 0, cmp_s, PERAR);
-    TIMERA_SetCompareValue(unit->peripheral.register_base, channel, cmp_s);
+                        duty, duty_scale, invert ? 1 : 0, cmp_s, unit->state.pwm_period);
+    timera_pwm_write_compare(unit, channel, cmp_s);
 
     // ensure channel compare function is enabled
-    return TIMERA_CompareCmd(unit->peripheral.register_base, channel, Enable);
+    return timera_pwm_channel_output_enable(unit, channel);
 }
 
 /**
@@ -503,7 +727,7 @@ inline int32_t timera_pwm_get_duty(timera_config_t *unit,
 
     // get current compare values (channel and PERAR)
     const uint16_t PERAR = TIMERA_GetPeriodValue(unit->peripheral.register_base);
-    uint16_t cmp_s = TIMERA_GetCompareValue(unit->peripheral.register_base, channel);
+    uint16_t cmp_s = timera_pwm_read_compare(unit, channel);
 
     // invert if requested
     if (invert)
@@ -514,3 +738,142 @@ inline int32_t timera_pwm_get_duty(timera_config_t *unit,
     // calculate duty
     return (cmp_s * duty_scale) / PERAR;
 }
+
+/**
+ * @brief enable or disable the compare buffer of a PWM channel
+ * @param unit pointer to timera unit config
+ * @param channel channel to buffer. must be TimeraCh1, TimeraCh3, TimeraCh5 or TimeraCh7
+ * @param enable true to buffer the compare value, false to write it directly again
+ * @return Ok on success,
+ *         ErrorInvalidParameter if the channel cannot be buffered,
+ *         ErrorOperationInProgress if the following channel (used as buffer) is in use
+ *
+ * @note while buffered, timera_pwm_set_duty() and timera_pwm_set_period() take effect at the next period start
+ * @note the following channel is reserved until the buffer is disabled or the channel is stopped
+ */
+inline en_result_t timera_pwm_set_buffered(timera_config_t *unit, const en_timera_channel_t channel, const bool enable = true)
+{
+    CORE_ASSERT(unit != nullptr, "timera_pwm_set_buffered: unit is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(unit->state.base_init != nullptr, "timera_pwm_set_buffered: unit not initialized", return ErrorInvalidParameter);
+    CORE_ASSERT((int(channel) % 2) == 0, "timera_pwm_set_buffered: only odd channels can be buffered", return ErrorInvalidParameter);
+    TIMERA_DEBUG_PRINTF(unit, channel, "pwm_set_buffered: enable=%d\n", enable ? 1 : 0);
+
+    if (enable == timera_pwm_is_buffered(unit, channel))
+    {
+        return Ok;
+    }
+
+    M4_TMRA_TypeDef *reg = unit->peripheral.register_base;
+    const en_timera_channel_t buffer_channel = static_cast<en_timera_channel_t>(int(channel) + 1);
+    const uint8_t bit = TIMERA_STATE_ACTIVE_CHANNEL_BIT(TIMERA_CHANNEL_TO_X(channel));
+    if (enable)
+    {
+        if (timera_is_channel_active(unit, buffer_channel))
+        {
+            return ErrorOperationInProgress;
+        }
+
+        if (!timera_is_channel_active(unit, channel))
+        {
+            timera_pwm_channel_start(unit, channel, false);
+        }
+
+        // start with the current compare value, so the next period does not change
+        timera_set_channel_active_flag(unit, buffer_channel, true);
+        TIMERA_SetCacheValue(reg, channel, TIMERA_GetCompareValue(reg, channel));
+        TIMERA_CompareCacheCmd(reg, channel, Enable);
+        unit->state.buffered_channels |= bit;
+    }
+    else
+    {
+        // the value still in the buffer was the latest one set, so apply it
+        const uint16_t cmp_s = TIMERA_GetCompareValue(reg, buffer_channel);
+        TIMERA_CompareCacheCmd(reg, channel, Disable);
+        TIMERA_SetCompareValue(reg, channel, cmp_s);
+        unit->state.buffered_channels &= ~bit;
+        timera_set_channel_active_flag(unit, buffer_channel, false);
+    }
+
+    return Ok;
+}
+
+/**
+ * @brief a duty cycle update for timera_pwm_set_duties()
+ */
+struct timera_pwm_duty_t
+{
+    en_timera_channel_t channel;
+
+    /**
+     * @brief duty cycle (0-duty_scale)
+     */
+    uint32_t duty;
+};
+
+/**
+ * @brief set the duty cycles of several channels of a unit at once
+ * @param unit pointer to timera unit config
+ * @param duties the channels and their duty cycles
+ * @param count number of entries in duties. at most 8
+ * @param duty_scale scale of duty cycle. default is 100 (for percent)
+ * @param invert if true, invert the PWM signals
+ * @return Ok on success, ErrorInvalidParameter if parameters not valid
+ *
+ * @note all channels change in the same period. buffered channels (see timera_pwm_set_buffered()) change at the next
+ *       period start, which is glitch-free. for channels that are not buffered, the values are written together in a
+ *       critical section, outside of the last TIMERA_PWM_BATCH_MARGIN counts of a period
+ */
+inline en_result_t timera_pwm_set_duties(timera_config_t *unit,
+                                         const timera_pwm_duty_t *duties,
+                                         const uint8_t count,
+                                         const uint32_t duty_scale = 100,
+                                         const bool invert = false)
+{
+    CORE_ASSERT(unit != nullptr, "timera_pwm_set_duties: unit is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(unit->state.base_init != nullptr, "timera_pwm_set_duties: unit not initialized", return ErrorInvalidParameter);
+    CORE_ASSERT(duties != nullptr && count <= 8, "timera_pwm_set_duties: invalid duties", return ErrorInvalidParameter);
+    CORE_ASSERT(duty_scale > 0, "timera_pwm_set_duties: duty_scale must be > 0", return ErrorInvalidParameter);
+
+    // prepare all compare values first, so writing them takes as little time as possible
+    uint16_t cmp_s[8];
+    bool all_buffered = true;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const en_timera_channel_t channel = duties[i].channel;
+        CORE_ASSERT(duties[i].duty <= duty_scale, "timera_pwm_set_duties: duty must be between 0 and duty_scale", return ErrorInvalidParameter);
+        CORE_ASSERT(!timera_pwm_is_buffer_channel(unit, channel), "timera_pwm_set_duties: channel is used as compare buffer", return ErrorOperationInProgress);
+
+        if (!timera_is_channel_active(unit, channel))
+        {
+            timera_pwm_channel_start(unit, channel, false);
+        }
+
+        cmp_s[i] = timera_pwm_duty_to_compare(unit, duties[i].duty, duty_scale, invert);
+        all_buffered &= timera_pwm_is_buffered(unit, channel);
+    }
+
+    const uint32_t state = core_critical_enter();
+
+    // unbuffered compare values apply right away, so do not start writing right before the period ends
+    // (a stopped unit never gets there)
+    M4_TMRA_TypeDef *reg = unit->peripheral.register_base;
+    if (!all_buffered && reg->BCSTR_f.START != 0 && unit->state.pwm_period > 2 * TIMERA_PWM_BATCH_MARGIN)
+    {
+        const uint16_t limit = unit->state.pwm_period - TIMERA_PWM_BATCH_MARGIN;
+        while (TIMERA_GetCurrCount(reg) >= limit)
+            ;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        timera_pwm_write_compare(unit, duties[i].channel, cmp_s[i]);
+    }
+    core_critical_exit(state);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        timera_pwm_channel_output_enable(unit, duties[i].channel);
+    }
+
+    return Ok;
+}
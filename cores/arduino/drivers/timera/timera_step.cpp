@@ -0,0 +1,327 @@
+#include "timera_step.h"
+#include "../irqn/irqn.h"
+#include "../dma/dma.h"
+#include "../../core_trace.h"
+
+//
+// segment end interrupt handlers
+//
+template <uint8_t n>
+static void TIMERA_STEPn_segment_end_irq(void);
+
+//
+// step axes
+//
+timera_step_axis_t TIMERA_STEP1_axis = {
+    .pulse_unit = &TIMERA1_config,
+    .count_unit = &TIMERA2_config,
+    .interrupt_priority = IRQ_PRIORITY_STEPPER,
+    .interrupt_handler = TIMERA_STEPn_segment_end_irq<1>,
+};
+
+timera_step_axis_t TIMERA_STEP2_axis = {
+    .pulse_unit = &TIMERA3_config,
+    .count_unit = &TIMERA4_config,
+    .interrupt_priority = IRQ_PRIORITY_STEPPER,
+    .interrupt_handler = TIMERA_STEPn_segment_end_irq<2>,
+};
+
+timera_step_axis_t TIMERA_STEP3_axis = {
+    .pulse_unit = &TIMERA5_config,
+    .count_unit = &TIMERA6_config,
+    .interrupt_priority = IRQ_PRIORITY_STEPPER,
+    .interrupt_handler = TIMERA_STEPn_segment_end_irq<3>,
+};
+
+#define TIMERA_STEP_AXIS_COUNT 3
+static timera_step_axis_t *TIMERA_STEPx[TIMERA_STEP_AXIS_COUNT] = {
+    &TIMERA_STEP1_axis,
+    &TIMERA_STEP2_axis,
+    &TIMERA_STEP3_axis,
+};
+
+#define ASSERT_INITIALIZED(axis, function_name) \
+    CORE_ASSERT(axis != nullptr && axis->state.initialized, function_name ": axis not initialized", return ErrorInvalidParameter)
+
+//
+// internal helpers
+//
+
+/**
+ * @brief configure the output of the pulse channel
+ * @param axis the step axis
+ * @param emit if true, a pulse starts on every period match. if false, the output stays LOW
+ * @note a running pulse still ends on compare match
+ */
+static void timera_step_set_output(timera_step_axis_t *axis, const bool emit)
+{
+    stc_timera_compare_init_t cmp_config = {
+        .u16CompareVal = axis->state.pulse_width,                                               // end of pulse
+        .enStartCountOutput = TimeraCountStartOutputLow,                                        // when not active, output LOW
+        .enStopCountOutput = TimeraCountStopOutputLow,                                          // "
+        .enCompareMatchOutput = TimeraCompareMatchOutputLow,                                    // transition LOW on compare match
+        .enPeriodMatchOutput = emit ? TimeraPeriodMatchOutputHigh : TimeraPeriodMatchOutputLow, // transition HIGH on period match while emitting
+        .enSpecifyOutput = TimeraSpecifyOutputInvalid,                                          //
+    };
+    TIMERA_CompareInit(axis->pulse_unit->peripheral.register_base, axis->state.channel, &cmp_config);
+}
+
+/**
+ * @brief stop the DMA writing the period table, if any, and release its channel
+ * @note called from the segment end interrupt, so without the debug output of dma_resign()
+ */
+static void timera_step_stop_dma(timera_step_axis_t *axis)
+{
+    const timera_dma_config_t *dma = axis->state.dma;
+    if (dma != nullptr)
+    {
+        dma_channel_t channel = {dma->register_base, dma->channel};
+        _dma_resign(channel);
+        axis->state.dma = nullptr;
+    }
+}
+
+/**
+ * @brief start a segment
+ * @param axis the step axis
+ * @param period period before the first pulse
+ * @param count number of pulses
+ */
+static void timera_step_begin(timera_step_axis_t *axis, const uint16_t period, const uint32_t count)
+{
+    M4_TMRA_TypeDef *pulse_unit = axis->pulse_unit->peripheral.register_base;
+    M4_TMRA_TypeDef *count_unit = axis->count_unit->peripheral.register_base;
+
+    // the pulse unit may still run idle from the last segment
+    TIMERA_Cmd(pulse_unit, Disable);
+    TIMERA_Cmd(count_unit, Disable);
+
+    // count unit overflows on the count-th overflow of the pulse unit
+    TIMERA_SetCurrCount(pulse_unit, 0);
+    TIMERA_SetPeriodValue(pulse_unit, period);
+    TIMERA_SetCurrCount(count_unit, 0);
+    TIMERA_SetPeriodValue(count_unit, static_cast<uint16_t>(count - 1));
+    TIMERA_ClearFlag(count_unit, TimeraFlagOverflow);
+
+    timera_step_set_output(axis, true);
+    axis->state.busy = true;
+
+    TIMERA_DEBUG_PRINTF(axis->pulse_unit, axis->state.channel, "step_begin: period=%d, count=%ld\n", period, count);
+    TIMERA_Cmd(count_unit, Enable);
+    TIMERA_Cmd(pulse_unit, Enable);
+}
+
+template <uint8_t n>
+static void TIMERA_STEPn_segment_end_irq(void)
+{
+    static_assert(n >= 1 && n <= TIMERA_STEP_AXIS_COUNT, "step axis number must be between 1 and TIMERA_STEP_AXIS_COUNT");
+    timera_step_axis_t *axis = TIMERA_STEPx[n - 1];
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_TIMERA_STEP_SEGMENT_END, n, 0);
+
+    // the last pulse just started. it ends on compare match, but no further pulse may follow.
+    // the pulse unit keeps running idle, so the pulse is not cut short
+    TIMERA_ClearFlag(axis->count_unit->peripheral.register_base, TimeraFlagOverflow);
+    timera_step_set_output(axis, false);
+    TIMERA_Cmd(axis->count_unit->peripheral.register_base, Disable);
+    timera_step_stop_dma(axis);
+
+    axis->state.busy = false;
+    if (axis->state.callback != nullptr)
+    {
+        axis->state.callback(axis);
+    }
+}
+
+//
+// public API
+//
+
+en_result_t timera_step_init(timera_step_axis_t *axis,
+                             const en_timera_channel_t channel,
+                             const uint16_t divider,
+                             const uint32_t pulse_width_ns,
+                             timera_step_callback_t callback)
+{
+    CORE_ASSERT(axis != nullptr, "timera_step_init: axis is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(divider > 0 && divider <= 1024, "timera_step_init: divider is invalid", return ErrorInvalidParameter);
+    if (axis->state.initialized || timera_is_unit_initialized(axis->pulse_unit) || timera_is_unit_initialized(axis->count_unit))
+    {
+        return ErrorOperationInProgress;
+    }
+
+    // pulse width in counts, rounded up
+    const uint64_t f_base = timera_get_base_clock() / divider;
+    const uint64_t pulse_width = ((uint64_t(pulse_width_ns) * f_base) + 999999999ull) / 1000000000ull;
+    CORE_ASSERT(pulse_width > 0 && pulse_width < 0xFFFF, "timera_step_init: pulse width is out-of-range", return ErrorInvalidParameter);
+
+    // prepare unit configs
+    // (stored in the units' state. only valid once base_init points to it)
+    stc_timera_base_init_t *pulse_config = &axis->pulse_unit->state.base_init_storage;
+    pulse_config->enClkDiv = timera_n_to_clk_div(divider); // PCLK1 / divider
+    pulse_config->enCntMode = TimeraCountModeSawtoothWave; // sawtooth wave mode
+    pulse_config->enCntDir = TimeraCountDirUp;             // count up
+    pulse_config->enSyncStartupEn = Disable;               // no sync startup
+    pulse_config->u16PeriodVal = 0xFFFF;                   // set per segment
+
+    stc_timera_base_init_t *count_config = &axis->count_unit->state.base_init_storage;
+    count_config->enClkDiv = TimeraPclkDiv1;               // unused, counts hardware events
+    count_config->enCntMode = TimeraCountModeSawtoothWave; // sawtooth wave mode
+    count_config->enCntDir = TimeraCountDirUp;             // count up
+    count_config->enSyncStartupEn = Disable;               // no sync startup
+    count_config->u16PeriodVal = 0;                        // set per segment
+
+    // start peripheral clocks for TimerA units and AOS
+    PWC_Fcg2PeriphClockCmd(axis->pulse_unit->peripheral.clock_id, Enable);
+    PWC_Fcg2PeriphClockCmd(axis->count_unit->peripheral.clock_id, Enable);
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // initialize units
+    TIMERA_BaseInit(axis->pulse_unit->peripheral.register_base, pulse_config);
+    axis->pulse_unit->state.base_init = pulse_config;
+    TIMERA_BaseInit(axis->count_unit->peripheral.register_base, count_config);
+    axis->count_unit->state.base_init = count_config;
+    timera_track_clock_changes();
+
+    // count unit counts overflows of the symmetric (pulse) unit
+    stc_timera_hw_count_up_config_t count_up_config = {
+        .enSyncOverflowUpEn = Enable,
+    };
+    TIMERA_HwCountUpConfig(axis->count_unit->peripheral.register_base, &count_up_config);
+
+    // setup pulse channel, idle LOW
+    axis->state.channel = channel;
+    axis->state.pulse_width = static_cast<uint16_t>(pulse_width);
+    axis->state.callback = callback;
+    axis->state.dma = nullptr;
+    axis->state.busy = false;
+    timera_step_set_output(axis, false);
+    TIMERA_CompareCmd(axis->pulse_unit->peripheral.register_base, channel, Enable);
+    timera_set_channel_active_flag(axis->pulse_unit, channel, true);
+
+    // register and enable segment end interrupt
+    timera_interrupt_config_t &irq = axis->count_unit->overflow_interrupt;
+    irqn_aa_get(irq.interrupt_number, "timera step");
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = irq.interrupt_source,
+        .enIRQn = irq.interrupt_number,
+        .pfnCallback = axis->interrupt_handler,
+    };
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, axis->interrupt_priority);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+    TIMERA_IrqCmd(axis->count_unit->peripheral.register_base, TimeraIrqOverflow, Enable);
+
+    TIMERA_DEBUG_PRINTF(axis->pulse_unit, channel, "step_init: f_base=%ld, pulse_width=%d\n", int32_t(f_base), axis->state.pulse_width);
+    axis->state.initialized = true;
+    return Ok;
+}
+
+void timera_step_deinit(timera_step_axis_t *axis)
+{
+    if (axis == nullptr || !axis->state.initialized)
+    {
+        return;
+    }
+
+    timera_step_stop(axis);
+
+    // disable and resign segment end interrupt
+    timera_interrupt_config_t &irq = axis->count_unit->overflow_interrupt;
+    TIMERA_IrqCmd(axis->count_unit->peripheral.register_base, TimeraIrqOverflow, Disable);
+    NVIC_DisableIRQ(irq.interrupt_number);
+    NVIC_ClearPendingIRQ(irq.interrupt_number);
+    enIrqResign(irq.interrupt_number);
+    irqn_aa_resign(irq.interrupt_number, "timera step");
+
+    // release units
+    TIMERA_CompareCmd(axis->pulse_unit->peripheral.register_base, axis->state.channel, Disable);
+    timera_set_channel_active_flag(axis->pulse_unit, axis->state.channel, false);
+
+    axis->pulse_unit->state.base_init = nullptr;
+    axis->count_unit->state.base_init = nullptr;
+
+    axis->state.initialized = false;
+}
+
+uint32_t timera_step_get_base_frequency(timera_step_axis_t *axis)
+{
+    CORE_ASSERT(axis != nullptr && axis->state.initialized, "timera_step_get_base_frequency: axis not initialized", return 0);
+    return timera_get_base_clock() / timera_clk_div_to_n(axis->pulse_unit->state.base_init->enClkDiv);
+}
+
+en_result_t timera_step_start(timera_step_axis_t *axis, const uint32_t rate, const uint32_t count)
+{
+    ASSERT_INITIALIZED(axis, "timera_step_start");
+    CORE_ASSERT(rate > 0, "timera_step_start: rate must be > 0", return ErrorInvalidParameter);
+    CORE_ASSERT(count > 0 && count <= 0x10000, "timera_step_start: count is out-of-range", return ErrorInvalidParameter);
+    if (axis->state.busy)
+    {
+        return ErrorOperationInProgress;
+    }
+
+    // calculate compare value for PERAR
+    const uint32_t period = timera_step_get_base_frequency(axis) / rate;
+    CORE_ASSERT(period > axis->state.pulse_width && period <= 0xFFFF, "timera_step_start: rate is out-of-range", return ErrorInvalidParameter);
+
+    timera_step_begin(axis, static_cast<uint16_t>(period), count);
+    return Ok;
+}
+
+en_result_t timera_step_start_ramp(timera_step_axis_t *axis, const uint16_t *periods, const uint16_t count, const timera_dma_config_t *dma)
+{
+    ASSERT_INITIALIZED(axis, "timera_step_start_ramp");
+    CORE_ASSERT(periods != nullptr && count > 0, "timera_step_start_ramp: periods is empty", return ErrorInvalidParameter);
+    CORE_ASSERT(dma != nullptr && dma->register_base != nullptr, "timera_step_start_ramp: dma is invalid", return ErrorInvalidParameter);
+    if (axis->state.busy)
+    {
+        return ErrorOperationInProgress;
+    }
+
+    // the first period is set directly, the DMA sets the following ones on every overflow
+    if (count > 1)
+    {
+        stc_dma_config_t dma_config = {
+            .u16BlockSize = 1,
+            .u16TransferCnt = static_cast<uint16_t>(count - 1),
+            .u32SrcAddr = (uint32_t)(&periods[1]),
+            .u32DesAddr = (uint32_t)(&axis->pulse_unit->peripheral.register_base->PERAR),
+            .u16SrcRptSize = 0,
+            .u16DesRptSize = 0,
+            .stcDmaChCfg = {
+                .enSrcInc = AddressIncrease,
+                .enDesInc = AddressFix,
+                .enSrcRptEn = Disable,
+                .enDesRptEn = Disable,
+                .enSrcNseqEn = Disable,
+                .enDesNseqEn = Disable,
+                .enTrnWidth = Dma16Bit,
+                .enLlpEn = Disable,
+                .enIntEn = Disable,
+            },
+        };
+
+        const dma_channel_t channel = {dma->register_base, dma->channel};
+        CORE_ASSERT(dma_claim(channel, "timera step") == Ok, "timera_step_start_ramp: DMA channel is in use", return ErrorNotReady);
+        dma_init(channel, &dma_config, axis->pulse_unit->peripheral.overflow_event);
+        dma_start(channel);
+        axis->state.dma = dma;
+    }
+
+    timera_step_begin(axis, periods[0], count);
+    return Ok;
+}
+
+void timera_step_stop(timera_step_axis_t *axis)
+{
+    if (axis == nullptr || !axis->state.initialized)
+    {
+        return;
+    }
+
+    // stopping the units sets the output LOW
+    TIMERA_Cmd(axis->pulse_unit->peripheral.register_base, Disable);
+    TIMERA_Cmd(axis->count_unit->peripheral.register_base, Disable);
+    timera_step_stop_dma(axis);
+    axis->state.busy = false;
+}
@@ -0,0 +1,191 @@
+/**
+ * TimerA step pulse generation:
+ *
+ * each step axis uses a pair of symmetric TimerA units (1+2, 3+4, 5+6).
+ * the pulse unit runs in sawtooth mode, with one period per step pulse.
+ * on period match, the output is set to HIGH. on compare match (cmp_s = pulse width), it is set to LOW again.
+ * the count unit counts the overflows of the pulse unit in hardware, and overflows itself after the last pulse
+ * of a segment. only this overflow raises an interrupt, which ends the segment.
+ *
+ *
+ *   PERAR |---/|      /|          /|
+ *         | /  |    /  |        /  |
+ *         |    |  /    |      /    |
+ *   cmp_s |----|/------|----/------|
+ *       0 |-----------------------------> t
+ *              |<- T ->|
+ *      5v |     _       _          _
+ *      0v |____| |_____| |________| |__
+ *               ^ step 1 ^ step 2   ^ step n -> count unit overflow -> segment end interrupt
+ *
+ * with a period table, the DMA writes the period of the next step to PERAR on every overflow,
+ * so acceleration ramps need no CPU either.
+ */
+#pragma once
+#include "timera_config.h"
+#include "timera_util.h"
+
+struct timera_step_axis_t;
+
+/**
+ * @brief callback for the end of a step segment
+ * @param axis the step axis that completed a segment
+ * @note called from the count unit overflow interrupt
+ */
+typedef void (*timera_step_callback_t)(struct timera_step_axis_t *axis);
+
+/**
+ * @brief TimerA step axis configuration
+ */
+typedef struct timera_step_axis_t
+{
+    /**
+     * @brief unit generating the step pulses
+     * @note TimerA unit 1, 3 or 5
+     */
+    timera_config_t *pulse_unit;
+
+    /**
+     * @brief unit counting the step pulses
+     * @note the symmetric unit of pulse_unit (2, 4 or 6)
+     */
+    timera_config_t *count_unit;
+
+    /**
+     * @brief segment end interrupt priority
+     */
+    uint32_t interrupt_priority;
+
+    /**
+     * @brief segment end interrupt handler
+     */
+    func_ptr_t interrupt_handler;
+
+    /**
+     * @brief step axis runtime state
+     */
+    struct
+    {
+        /**
+         * @brief was timera_step_init() called?
+         */
+        bool initialized;
+
+        /**
+         * @brief channel of pulse_unit that outputs the step pulses
+         */
+        en_timera_channel_t channel;
+
+        /**
+         * @brief pulse width, in counts of the base counting frequency
+         */
+        uint16_t pulse_width;
+
+        /**
+         * @brief is a segment running?
+         */
+        volatile bool busy;
+
+        /**
+         * @brief DMA channel writing the period table
+         * @note NULL if the segment runs at a constant rate
+         */
+        const timera_dma_config_t *dma;
+
+        /**
+         * @brief callback for the end of a segment
+         * @note may be NULL
+         */
+        timera_step_callback_t callback;
+    } state;
+} timera_step_axis_t;
+
+/**
+ * @brief initialize a step axis
+ * @param axis the step axis
+ * @param channel channel of the pulse unit that outputs the step pulses. the pin function has to be set by the caller
+ * @param divider clock divider of the pulse unit. one of [1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024]
+ * @param pulse_width_ns minimum width of the step pulses, in nanoseconds
+ * @param callback called at the end of each segment. may be NULL
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if one of the units is already in use
+ */
+en_result_t timera_step_init(timera_step_axis_t *axis,
+                             const en_timera_channel_t channel,
+                             const uint16_t divider,
+                             const uint32_t pulse_width_ns,
+                             timera_step_callback_t callback);
+
+/**
+ * @brief stop any running segment and release the units of a step axis
+ * @param axis the step axis
+ */
+void timera_step_deinit(timera_step_axis_t *axis);
+
+/**
+ * @brief get the base counting frequency of a step axis
+ * @param axis the step axis
+ * @return base counting frequency (PCLK1 / divider), in Hz
+ * @note use to calculate period tables for timera_step_start_ramp()
+ */
+uint32_t timera_step_get_base_frequency(timera_step_axis_t *axis);
+
+/**
+ * @brief emit pulses at a constant rate
+ * @param axis the step axis
+ * @param rate step rate, in Hz
+ * @param count number of pulses. 1 - 65536
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if a segment is already running
+ * @note the first pulse is emitted one period after this call
+ */
+en_result_t timera_step_start(timera_step_axis_t *axis, const uint32_t rate, const uint32_t count);
+
+/**
+ * @brief emit pulses with a period table, eg. for acceleration ramps
+ * @param axis the step axis
+ * @param periods period before each pulse, in counts of the base counting frequency. must be > pulse width
+ * @param count number of pulses, and length of periods. 1 - 65535
+ * @param dma DMA channel used to write the periods. must stay valid until the segment ended
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if a segment is already running,
+ *         ErrorNotReady if the DMA channel is in use
+ * @note periods must stay valid until the segment ended
+ */
+en_result_t timera_step_start_ramp(timera_step_axis_t *axis, const uint16_t *periods, const uint16_t count, const timera_dma_config_t *dma);
+
+/**
+ * @brief abort the running segment
+ * @param axis the step axis
+ * @note a pulse that is currently being emitted may be cut short. the callback is not called
+ */
+void timera_step_stop(timera_step_axis_t *axis);
+
+/**
+ * @brief check if a segment is running
+ * @param axis the step axis
+ */
+inline bool timera_step_is_busy(const timera_step_axis_t *axis)
+{
+    return axis->state.busy;
+}
+
+/**
+ * @brief get the number of pulses emitted in the running segment
+ * @param axis the step axis
+ * @note only valid while the segment is running
+ */
+inline uint16_t timera_step_get_pulse_count(const timera_step_axis_t *axis)
+{
+    return TIMERA_GetCurrCount(axis->count_unit->peripheral.register_base);
+}
+
+//
+// step axes
+//
+extern timera_step_axis_t TIMERA_STEP1_axis; // TimerA unit 1 + 2
+extern timera_step_axis_t TIMERA_STEP2_axis; // TimerA unit 3 + 4
+extern timera_step_axis_t TIMERA_STEP3_axis; // TimerA unit 5 + 6
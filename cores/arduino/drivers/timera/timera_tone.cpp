@@ -0,0 +1,164 @@
+#include "timera_tone.h"
+#include "timera_irq.h"
+
+//
+// duration interrupt handler
+//
+static timera_config_t *TIMERAx[6] = {
+    &TIMERA1_config,
+    &TIMERA2_config,
+    &TIMERA3_config,
+    &TIMERA4_config,
+    &TIMERA5_config,
+    &TIMERA6_config,
+};
+
+template <uint8_t x>
+static void TIMERAx_tone_overflow_irq(void)
+{
+    timera_config_t *unit = TIMERAx[x - 1];
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagOverflow);
+
+    if (--unit->state.tone_toggles_left == 0)
+    {
+        const timera_tone_callback_t done = unit->state.tone_done;
+        timera_tone_stop(unit);
+        if (done != nullptr)
+        {
+            done(unit);
+        }
+    }
+}
+
+static const func_ptr_t TIMERAx_tone_overflow_irqs[6] = {
+    TIMERAx_tone_overflow_irq<1>,
+    TIMERAx_tone_overflow_irq<2>,
+    TIMERAx_tone_overflow_irq<3>,
+    TIMERAx_tone_overflow_irq<4>,
+    TIMERAx_tone_overflow_irq<5>,
+    TIMERAx_tone_overflow_irq<6>,
+};
+
+//
+// public API
+//
+
+en_result_t timera_tone_start(timera_config_t *unit, const en_timera_channel_t channel, const uint32_t frequency, const uint32_t duration_ms, const timera_tone_callback_t done)
+{
+    CORE_ASSERT(unit != nullptr, "timera_tone_start: unit is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(frequency > 0, "timera_tone_start: frequency must be > 0", return ErrorInvalidParameter);
+
+    const int x = TIMERA_REG_TO_X(unit->peripheral.register_base);
+    CORE_ASSERT(x >= 1 && x <= 6, "timera_tone_start: unit is invalid", return ErrorInvalidParameter);
+
+    // replace a running tone
+    if (unit->state.tone_playing)
+    {
+        timera_tone_stop(unit);
+    }
+
+    if (timera_is_unit_initialized(unit))
+    {
+        return ErrorOperationInProgress;
+    }
+
+    // output toggles on every period match, so one period is half a wave.
+    // use the smallest divider where the period fits into 16 bits, for maximum precision
+    const uint32_t f_pclk1 = timera_get_base_clock();
+    uint16_t divider = 1;
+    uint64_t period = 0;
+    for (; divider <= 1024; divider *= 2)
+    {
+        period = (uint64_t(f_pclk1 / divider) + frequency) / (uint64_t(frequency) * 2);
+        if (period <= 0x10000)
+        {
+            break;
+        }
+    }
+
+    CORE_ASSERT(divider <= 1024 && period >= 2, "timera_tone_start: frequency is out-of-range", return ErrorInvalidParameter);
+
+    // prepare unit config
+    // (stored in the unit's state. only valid once base_init points to it)
+    stc_timera_base_init_t *unit_config = &unit->state.base_init_storage;
+    unit_config->enClkDiv = timera_n_to_clk_div(divider);          // PCLK1 / divider
+    unit_config->enCntMode = TimeraCountModeSawtoothWave;          // sawtooth wave mode
+    unit_config->enCntDir = TimeraCountDirUp;                      // count up
+    unit_config->enSyncStartupEn = Disable;                        // no sync startup
+    unit_config->u16PeriodVal = static_cast<uint16_t>(period - 1); // 0..PERAR,0 == period counts
+
+    TIMERA_DEBUG_PRINTF(unit, channel, "tone_start: f=%ldHz (PCLK1/%d), PERAR=%d, duration=%ldms\n", frequency, divider, unit_config->u16PeriodVal, duration_ms);
+
+    // start peripheral clock for TimerA unit
+    PWC_Fcg2PeriphClockCmd(unit->peripheral.clock_id, Enable);
+
+    // initialize unit
+    TIMERA_BaseInit(unit->peripheral.register_base, unit_config);
+    unit->state.base_init = unit_config;
+    timera_track_clock_changes();
+
+    // toggle output on period match, LOW while stopped
+    stc_timera_compare_init_t cmp_config = {
+        .u16CompareVal = 0,                                    // unused
+        .enStartCountOutput = TimeraCountStartOutputLow,       // start LOW
+        .enStopCountOutput = TimeraCountStopOutputLow,         // when stopped, output LOW
+        .enCompareMatchOutput = TimeraCompareMatchOutputKeep,  // compare match is not used
+        .enPeriodMatchOutput = TimeraPeriodMatchOutputReverse, // toggle on period match
+        .enSpecifyOutput = TimeraSpecifyOutputInvalid,         //
+    };
+    TIMERA_CompareInit(unit->peripheral.register_base, channel, &cmp_config);
+    TIMERA_CompareCmd(unit->peripheral.register_base, channel, Enable);
+    timera_set_channel_active_flag(unit, channel, true);
+
+    // count down toggles, if a duration is set.
+    // the interrupt is registered in any case, but only enabled with a duration
+    uint64_t toggles = (uint64_t(duration_ms) * frequency * 2) / 1000;
+    if (duration_ms != 0 && toggles == 0)
+    {
+        toggles = 1;
+    }
+
+    unit->state.tone_toggles_left = toggles > 0xFFFFFFFF ? 0xFFFFFFFF : static_cast<uint32_t>(toggles);
+    TIMERA_ClearFlag(unit->peripheral.register_base, TimeraFlagOverflow);
+    timera_irq_register(unit->overflow_interrupt, TIMERAx_tone_overflow_irqs[x - 1], "timera tone");
+    if (duration_ms != 0)
+    {
+        TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Enable);
+    }
+
+    unit->state.tone_done = done;
+    unit->state.tone_playing = true;
+    return TIMERA_Cmd(unit->peripheral.register_base, Enable);
+}
+
+void timera_tone_stop(timera_config_t *unit)
+{
+    CORE_ASSERT(unit != nullptr, "timera_tone_stop: unit is nullptr", return);
+    if (!unit->state.tone_playing)
+    {
+        return;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, -2, "tone_stop\n");
+    TIMERA_Cmd(unit->peripheral.register_base, Disable);
+
+    // release the duration interrupt
+    TIMERA_IrqCmd(unit->peripheral.register_base, TimeraIrqOverflow, Disable);
+    timera_irq_resign(unit->overflow_interrupt, "timera tone");
+
+    // stop channels
+    for (uint8_t ch = TimeraCh1; ch <= TimeraCh8; ch++)
+    {
+        const en_timera_channel_t channel = static_cast<en_timera_channel_t>(ch);
+        if (timera_is_channel_active(unit, channel))
+        {
+            TIMERA_CompareCmd(unit->peripheral.register_base, channel, Disable);
+            timera_set_channel_active_flag(unit, channel, false);
+        }
+    }
+
+    // reset state
+    unit->state.tone_playing = false;
+    unit->state.tone_done = nullptr;
+    unit->state.base_init = nullptr;
+}
@@ -0,0 +1,54 @@
+/**
+ * TimerA tone generation:
+ *
+ * for tone output, the channel output is toggled on every period match of the unit, so the output
+ * frequency is half the overflow frequency. the waveform is generated entirely in hardware.
+ * if a duration is given, the overflow interrupt counts the toggles down and stops the unit after the last one.
+ *
+ *   PERAR |---/|   /|   /|   /|
+ *         | /  | /  | /  | /  |
+ *       0 |------------------------> t
+ *      5v |     ____      ____
+ *      0v |____|    |____|    |___
+ *              |<- 1/f ->|
+ */
+#pragma once
+#include "timera_config.h"
+#include "timera_util.h"
+
+/**
+ * @brief tone done callback
+ * @param unit the unit that played the tone
+ * @note called from the overflow interrupt, after the unit was released
+ */
+typedef void (*timera_tone_callback_t)(timera_config_t *unit);
+
+/**
+ * @brief start a tone on a TimerA channel
+ * @param unit pointer to timera unit config
+ * @param channel channel that outputs the tone. the pin function has to be set by the caller
+ * @param frequency tone frequency, in Hz
+ * @param duration_ms tone duration, in milliseconds. 0 to play until timera_tone_stop() is called
+ * @param done called once the tone stopped after its duration. not called if stopped by timera_tone_stop(). may be NULL
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorOperationInProgress if the unit is in use by something else
+ * @note the tone uses the whole unit. if the unit already plays a tone, it is replaced
+ */
+en_result_t timera_tone_start(timera_config_t *unit, const en_timera_channel_t channel, const uint32_t frequency, const uint32_t duration_ms, const timera_tone_callback_t done = nullptr);
+
+/**
+ * @brief stop the tone of a TimerA unit, and release the unit
+ * @param unit pointer to timera unit config
+ * @note the output is LOW afterwards
+ */
+void timera_tone_stop(timera_config_t *unit);
+
+/**
+ * @brief check if a TimerA unit plays a tone
+ * @param unit pointer to timera unit config
+ */
+inline bool timera_tone_is_playing(const timera_config_t *unit)
+{
+    return unit->state.tone_playing;
+}
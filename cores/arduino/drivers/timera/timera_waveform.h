@@ -0,0 +1,150 @@
+/**
+ * TimerA waveform playback:
+ *
+ * instead of setting a static duty, a buffer of channel compare values (cmp_s) is streamed into the
+ * channel compare register by DMA. the DMA is triggered by the TimerA overflow event, so every period
+ * of the PWM wave uses the next value of the buffer, without any CPU involvement.
+ *
+ * the unit has to be initialized with timera_pwm_start() beforehand, which defines the period (PERAR).
+ * compare values are in counts of the base counting frequency, with 0 <= cmp_s <= PERAR.
+ */
+#pragma once
+#include "timera_pwm.h"
+#include "../dma/dma.h"
+
+/**
+ * @brief waveform repeat mode
+ */
+typedef enum timera_waveform_repeat_t
+{
+    /**
+     * @brief play the buffer once. the channel keeps the last compare value afterwards
+     */
+    TIMERA_WAVEFORM_ONCE,
+
+    /**
+     * @brief play the buffer in a loop, until timera_waveform_stop() is called
+     */
+    TIMERA_WAVEFORM_LOOP,
+} timera_waveform_repeat_t;
+
+/**
+ * @brief get the address of a channel compare register (CMPARn)
+ * @param unit pointer to timera unit config
+ * @param channel the channel
+ * @note CMPAR1 - CMPAR8 are 16 bit registers, placed 4 bytes apart
+ */
+inline uint32_t timera_get_compare_register_address(timera_config_t *unit, const en_timera_channel_t channel)
+{
+    return uint32_t(&unit->peripheral.register_base->CMPAR1) + (uint32_t(channel) * 4);
+}
+
+/**
+ * @brief stop waveform playback
+ * @param unit pointer to timera unit config
+ * @note the channel keeps the compare value last written by the DMA
+ */
+inline en_result_t timera_waveform_stop(timera_config_t *unit)
+{
+    CORE_ASSERT(unit != nullptr, "timera_waveform_stop: unit is nullptr", return ErrorInvalidParameter);
+
+    const timera_dma_config_t *dma = unit->state.waveform_dma;
+    if (dma == nullptr)
+    {
+        return Ok;
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, -2, "waveform_stop\n");
+    dma_channel_t channel = {dma->register_base, dma->channel};
+    dma_resign(channel, "timera waveform");
+    unit->state.waveform_dma = nullptr;
+    return Ok;
+}
+
+/**
+ * @brief start waveform playback on a PWM channel
+ * @param unit pointer to timera unit config
+ * @param channel channel to play the waveform on
+ * @param dma the DMA channel to use. must stay valid until playback is stopped
+ * @param buffer compare values, one per period. must stay valid until playback is stopped
+ * @param length number of values in the buffer
+ * @param repeat play the buffer once, or loop it
+ * @return Ok on success,
+ *         ErrorInvalidParameter if parameters not valid,
+ *         ErrorNotReady if the DMA channel is in use
+ *
+ * @note requires timera_pwm_start() to be called first
+ * @note the first value is applied on the first overflow after this call
+ * @note only one waveform can play per unit. a running playback is stopped first
+ */
+inline en_result_t timera_waveform_start(timera_config_t *unit,
+                                         const en_timera_channel_t channel,
+                                         const timera_dma_config_t *dma,
+                                         const uint16_t *buffer,
+                                         const uint16_t length,
+                                         const timera_waveform_repeat_t repeat = TIMERA_WAVEFORM_LOOP)
+{
+    CORE_ASSERT(unit != nullptr, "timera_waveform_start: unit is nullptr", return ErrorInvalidParameter);
+    CORE_ASSERT(unit->state.base_init != nullptr, "timera_waveform_start: unit not initialized", return ErrorInvalidParameter);
+    CORE_ASSERT(dma != nullptr && dma->register_base != nullptr, "timera_waveform_start: dma is invalid", return ErrorInvalidParameter);
+    CORE_ASSERT(buffer != nullptr && length > 0, "timera_waveform_start: buffer is empty", return ErrorInvalidParameter);
+
+    // DMA repeat size is limited to 10 bits
+    CORE_ASSERT(repeat != TIMERA_WAVEFORM_LOOP || length <= 0x3FF, "timera_waveform_start: looped buffer must be <= 1023 values", return ErrorInvalidParameter);
+
+    timera_waveform_stop(unit);
+
+    const dma_channel_t dma_channel = {dma->register_base, dma->channel};
+    CORE_ASSERT(dma_claim(dma_channel, "timera waveform") == Ok, "timera_waveform_start: DMA channel is in use", return ErrorNotReady);
+
+    if (!timera_is_channel_active(unit, channel))
+    {
+        // channel not active, initialize it now
+        timera_pwm_channel_start(unit, channel, false);
+    }
+
+    TIMERA_DEBUG_PRINTF(unit, channel, "waveform_start: length=%d, repeat=%d\n", length, int(repeat));
+
+    // prepare DMA transfer configuration to
+    // transfer one compare value from the buffer to CMPARn per overflow
+    // (in loop mode, the source wraps around after length transfers)
+    const bool loop = repeat == TIMERA_WAVEFORM_LOOP;
+    stc_dma_config_t dma_config = {
+        .u16BlockSize = 1,
+        .u16TransferCnt = static_cast<uint16_t>(loop ? 0 : length),
+        .u32SrcAddr = (uint32_t)(buffer),
+        .u32DesAddr = timera_get_compare_register_address(unit, channel),
+        .u16SrcRptSize = static_cast<uint16_t>(loop ? length : 0),
+        .u16DesRptSize = 0,
+        .stcDmaChCfg = {
+            .enSrcInc = AddressIncrease,
+            .enDesInc = AddressFix,
+            .enSrcRptEn = loop ? Enable : Disable,
+            .enDesRptEn = Disable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = Dma16Bit,
+            .enLlpEn = Disable,
+            .enIntEn = Disable,
+        },
+    };
+
+    // initialize DMA channel to transfer on every overflow of the unit
+    dma_init(dma_channel, &dma_config, unit->peripheral.overflow_event);
+    dma_start(dma_channel);
+    unit->state.waveform_dma = dma;
+
+    // ensure channel compare function is enabled
+    return timera_pwm_channel_output_enable(unit, channel);
+}
+
+/**
+ * @brief check if a waveform is playing
+ * @param unit pointer to timera unit config
+ * @return true if a waveform is playing. looped waveforms play until stopped
+ */
+inline bool timera_waveform_is_playing(timera_config_t *unit)
+{
+    const timera_dma_config_t *dma = unit->state.waveform_dma;
+    return dma != nullptr && DMA_GetIrqFlag(dma->register_base, dma->channel, TrnCpltIrq) != Set;
+}
@@ -1,19 +1,34 @@
 #include <hc32_ddl.h>
 #include "usart.h"
+#include "usart_dma.h"
+#include "usart_rx_framing.h"
+#include "usart_half_duplex.h"
 #include "core_hooks.h"
 #include "core_debug.h"
 #include "yield.h"
+#include "delay.h"
 #include "../gpio/gpio.h"
 #include "../irqn/irqn.h"
+#include "../dma/dma.h"
+#include "../../core_critical.h"
 
 //
 // global instances
 //
 #ifndef DISABLE_SERIAL_GLOBALS
+#ifndef DISABLE_SERIAL1_GLOBAL
 Usart Serial1(&USART1_config, VARIANT_USART1_TX_PIN, VARIANT_USART1_RX_PIN);
+#endif
+#ifndef DISABLE_SERIAL2_GLOBAL
 Usart Serial2(&USART2_config, VARIANT_USART2_TX_PIN, VARIANT_USART2_RX_PIN);
+#endif
+#ifndef DISABLE_SERIAL3_GLOBAL
 Usart Serial3(&USART3_config, VARIANT_USART3_TX_PIN, VARIANT_USART3_RX_PIN);
 #endif
+#ifndef DISABLE_SERIAL4_GLOBAL
+Usart Serial4(&USART4_config, VARIANT_USART4_TX_PIN, VARIANT_USART4_RX_PIN);
+#endif
+#endif
 
 //
 // IRQ register / unregister helper
@@ -53,33 +68,12 @@ inline void usart_irq_resign(usart_interrupt_config_t &irq, const char *name)
 //
 // debug print helpers
 //
-#define USART_REG_TO_X(reg) \
-    reg == M4_USART1   ? 1  \
-    : reg == M4_USART2 ? 2  \
-    : reg == M4_USART3 ? 3  \
-    : reg == M4_USART4 ? 4  \
-                       : 0
 #define USART_DEBUG_PRINTF(fmt, ...) \
     CORE_DEBUG_PRINTF("[USART%d] " fmt, USART_REG_TO_X(this->config->peripheral.register_base), ##__VA_ARGS__)
 
 //
 // Usart class implementation
 //
-Usart::Usart(struct usart_config_t *config, gpio_pin_t tx_pin, gpio_pin_t rx_pin)
-{
-    CORE_ASSERT(config != NULL, "USART() config cannot be NULL");
-    ASSERT_GPIO_PIN_VALID(tx_pin, "USART() tx_pin");
-    ASSERT_GPIO_PIN_VALID(rx_pin, "USART() rx_pin");
-
-    this->config = config;
-    this->tx_pin = tx_pin;
-    this->rx_pin = rx_pin;
-
-    // unpack rx and tx buffers from usart config
-    this->rxBuffer = config->state.rx_buffer;
-    this->txBuffer = config->state.tx_buffer;
-}
-
 void Usart::begin(uint32_t baud)
 {
     // default to 8 bits, no parity, 1 stop bit
@@ -146,32 +140,88 @@ void Usart::begin(uint32_t baud, uint16_t config)
 
 void Usart::begin(uint32_t baud, const stc_usart_uart_init_t *config)
 {
+    CORE_ASSERT(this->config != NULL, "USART() config cannot be NULL", return);
+    ASSERT_GPIO_PIN_VALID(this->tx_pin, "USART() tx_pin");
+    ASSERT_GPIO_PIN_VALID(this->rx_pin, "USART() rx_pin");
+
     // clear rx and tx buffers
-    this->rxBuffer->clear();
-    this->txBuffer->clear();
+    this->rxBuffer()->clear();
+    this->txBuffer()->clear();
+    usart_rx_framing_reset(this->config);
+
+    // setup half-duplex mode
+    usart_half_duplex_state_t &halfDuplexState = this->config->state.half_duplex;
+    halfDuplexState.enabled = this->halfDuplex;
+    halfDuplexState.single_wire = this->halfDuplex && this->tx_pin == this->rx_pin;
+    halfDuplexState.pin = this->tx_pin;
+    halfDuplexState.transmitting = false;
+    if (this->halfDuplex)
+    {
+        // open-drain with pull-up, so the line idles high when nobody drives it
+        stc_port_init_t pinConf;
+        MEM_ZERO_STRUCT(pinConf);
+        pinConf.enPinOType = Pin_OType_Od;
+        pinConf.enPullUp = Enable;
+        GPIO_Init(this->tx_pin, &pinConf);
+    }
 
     // set IO pin functions
-    GPIO_SetFunc(this->tx_pin, this->config->peripheral.tx_pin_function);
+    // (in single-wire mode, the pin starts out receiving)
+    if (!halfDuplexState.single_wire)
+    {
+        GPIO_SetFunc(this->tx_pin, this->config->peripheral.tx_pin_function);
+    }
     GPIO_SetFunc(this->rx_pin, this->config->peripheral.rx_pin_function);
 
     // enable peripheral clock
     PWC_Fcg1PeriphClockCmd(this->config->peripheral.clock_id, Enable);
 
     // initialize usart peripheral and set baud rate
+    // the prescaler, oversampling and fractional divider are chosen for the smallest baud rate error
     USART_UART_Init(this->config->peripheral.register_base, config);
-    USART_SetBaudrate(this->config->peripheral.register_base, baud);
+    usart_set_baudrate(this->config->peripheral.register_base, baud, &this->baudSettings);
 
     // setup usart interrupts
-    usart_irq_register(this->config->interrupts.rx_data_available, "usart rx data available");
+    // in RX DMA mode, the RX data available event only triggers the DMA, and the
+    // receive timeout interrupt moves the received data to the rx buffer
+    if (USART_RX_DMA_ENABLED(this->config))
+    {
+        const dma_channel_t rx_channel = {this->config->rx_dma.register_base, this->config->rx_dma.channel};
+        CORE_ASSERT(dma_claim(rx_channel, "usart rx dma") == Ok, "Usart::begin: RX DMA channel is in use", return);
+        usart_dma_rx_init(this->config);
+        usart_dma_rx_timeout_init(this->config, baud);
+        usart_irq_register(this->config->interrupts.rx_timeout, "usart rx timeout");
+    }
+    else
+    {
+        usart_irq_register(this->config->interrupts.rx_data_available, "usart rx data available");
+    }
     usart_irq_register(this->config->interrupts.rx_error, "usart rx error");
-    usart_irq_register(this->config->interrupts.tx_buffer_empty, "usart tx buffer empty");
     usart_irq_register(this->config->interrupts.tx_complete, "usart tx complete");
 
+    // in DMA mode, the TX empty event only triggers the DMA and the DMA transfer complete
+    // interrupt replaces the TX empty interrupt
+    if (USART_TX_DMA_ENABLED(this->config))
+    {
+        const dma_channel_t tx_channel = {this->config->tx_dma.register_base, this->config->tx_dma.channel};
+        CORE_ASSERT(dma_claim(tx_channel, "usart tx dma") == Ok, "Usart::begin: TX DMA channel is in use", return);
+        usart_dma_tx_init(this->config);
+        usart_irq_register(this->config->tx_dma.transfer_complete, "usart tx dma complete");
+    }
+    else
+    {
+        usart_irq_register(this->config->interrupts.tx_buffer_empty, "usart tx buffer empty");
+    }
+
     // enable usart RX + interrupts
     // (tx is enabled on-demand when data is available to send)
     USART_FuncCmd(this->config->peripheral.register_base, UsartRx, Enable);
     USART_FuncCmd(this->config->peripheral.register_base, UsartRxInt, Enable);
 
+    // re-derive the baud rate when the clocks change
+    this->baudrate = baud;
+    sysclock_listener_register(&this->clockListener, Usart::clockChanged, this);
+
     // write debug message AFTER init (this UART may be used for the debug message)
     USART_DEBUG_PRINTF("begin completed\n");
     this->initialized = true;
@@ -184,46 +234,76 @@ void Usart::end()
 
     // wait for tx buffer to empty
     flush();
+    sysclock_listener_unregister(&this->clockListener);
 
     // disable uart peripheral
     USART_FuncCmd(this->config->peripheral.register_base, UsartTx, Disable);
     USART_FuncCmd(this->config->peripheral.register_base, UsartRx, Disable);
 
     // resign usart interrupts
-    usart_irq_resign(this->config->interrupts.rx_data_available, "usart rx data available");
+    if (USART_RX_DMA_ENABLED(this->config))
+    {
+        usart_irq_resign(this->config->interrupts.rx_timeout, "usart rx timeout");
+        usart_dma_rx_timeout_deinit(this->config);
+        usart_dma_rx_deinit(this->config);
+
+        dma_channel_t rx_channel = {this->config->rx_dma.register_base, this->config->rx_dma.channel};
+        dma_resign(rx_channel, "usart rx dma");
+    }
+    else
+    {
+        usart_irq_resign(this->config->interrupts.rx_data_available, "usart rx data available");
+    }
     usart_irq_resign(this->config->interrupts.rx_error, "usart rx error");
-    usart_irq_resign(this->config->interrupts.tx_buffer_empty, "usart tx buffer empty");
     usart_irq_resign(this->config->interrupts.tx_complete, "usart tx complete");
+    if (USART_TX_DMA_ENABLED(this->config))
+    {
+        usart_irq_resign(this->config->tx_dma.transfer_complete, "usart tx dma complete");
+        usart_dma_tx_deinit(this->config);
+
+        dma_channel_t tx_channel = {this->config->tx_dma.register_base, this->config->tx_dma.channel};
+        dma_resign(tx_channel, "usart tx dma");
+    }
+    else
+    {
+        usart_irq_resign(this->config->interrupts.tx_buffer_empty, "usart tx buffer empty");
+    }
 
     // deinit uart
     USART_DeInit(this->config->peripheral.register_base);
 
     // clear rx and tx buffers
-    this->rxBuffer->clear();
-    this->txBuffer->clear();
+    this->rxBuffer()->clear();
+    this->txBuffer()->clear();
+    usart_rx_framing_reset(this->config);
+    this->config->state.half_duplex = {};
+    this->config->state.tx_active = false;
 
     this->initialized = false;
 }
 
 int Usart::available(void)
 {
-    return this->rxBuffer->count();
+    flushRxDma();
+    return this->rxBuffer()->count();
 }
 
 int Usart::availableForWrite(void)
 {
-    return this->txBuffer->capacity() - this->txBuffer->count();
+    return this->txBuffer()->capacity() - this->txBuffer()->count();
 }
 
 int Usart::peek(void)
 {
-    return this->rxBuffer->peek();
+    flushRxDma();
+    return this->rxBuffer()->peek();
 }
 
 int Usart::read(void)
 {
+    flushRxDma();
     uint8_t ch;
-    if (this->rxBuffer->pop(ch))
+    if (this->rxBuffer()->pop(ch))
     {
         return ch;
     }
@@ -233,6 +313,20 @@ int Usart::read(void)
     }
 }
 
+size_t Usart::peekSpan(const char *&span)
+{
+    flushRxDma();
+    uint8_t *data;
+    const size_t length = this->rxBuffer()->peekContiguous(data);
+    span = reinterpret_cast<const char *>(data);
+    return length;
+}
+
+void Usart::skipSpan(size_t count)
+{
+    this->rxBuffer()->consume(count);
+}
+
 void Usart::flush(void)
 {
     // ignore if not initialized
@@ -241,36 +335,177 @@ void Usart::flush(void)
         return;
     }
 
-    // wait for tx buffer to empty
-    while (!this->txBuffer->isEmpty())
-        ;
+    // wait until the tx buffer is empty and the last stop bit has left the shift register.
+    // the TX complete interrupt clears tx_active, so sleep until the next interrupt in between
+    while (!this->txBuffer()->isEmpty() || this->config->state.tx_active)
+    {
+        yield();
+        __WFI();
+    }
 }
 
 size_t Usart::write(uint8_t ch)
+{
+    return write(&ch, 1);
+}
+
+size_t Usart::write(const uint8_t *buffer, size_t size)
 {
     // if uninitialized, ignore write
     if (!this->initialized)
     {
-        return 1;
+        return size;
     }
 
-    // wait until tx buffer is no longer full
-    while (this->txBuffer->isFull())
+    // copy as much as fits into the tx buffer, and start sending once per chunk
+    size_t written = 0;
+    uint32_t lastProgress = millis();
+    while (written < size)
     {
-        yield();
+        const size_t pushed = this->txBuffer()->push(buffer + written, size - written);
+        if (pushed > 0)
+        {
+            written += pushed;
+            lastProgress = millis();
+            usart_update_high_water(this->config->state.statistics.tx_high_water, this->txBuffer()->count());
+            startTx();
+            continue;
+        }
+
+        // tx buffer is full, handle according to overflow policy
+        switch (this->txOverflowPolicy)
+        {
+        case usart_tx_overflow_policy_t::OverwriteOldest:
+            // a DMA transfer reads the oldest bytes in-place, so they cannot be overwritten
+            if (!USART_TX_DMA_ENABLED(this->config))
+            {
+                // discard oldest bytes to make room. the tx interrupt pops concurrently,
+                // so consuming must be done in a critical section
+                const uint32_t critical = core_critical_enter();
+                size_t discard = size - written;
+                if (discard > this->txBuffer()->count())
+                {
+                    discard = this->txBuffer()->count();
+                }
+                this->txBuffer()->consume(discard);
+                core_critical_exit(critical);
+
+                this->config->state.statistics.tx_dropped += discard;
+                break;
+            }
+
+            // fall through to DropNewest
+        case usart_tx_overflow_policy_t::DropNewest:
+            this->config->state.statistics.tx_dropped += size - written;
+            return written;
+        case usart_tx_overflow_policy_t::BlockTimeout:
+            if (millis() - lastProgress >= this->txTimeout)
+            {
+                this->config->state.statistics.tx_dropped += size - written;
+                return written;
+            }
+
+            yield();
+            break;
+        default:
+        case usart_tx_overflow_policy_t::Block:
+            // wait for the tx buffer to drain
+            yield();
+            break;
+        }
     }
 
-    // add to tx buffer
-    while (!this->txBuffer->push(ch))
+    return written;
+}
+
+size_t Usart::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    _startMillis = millis();
+    while (count < length)
     {
-        yield();
+        // take everything that is available in one go
+        flushRxDma();
+        const size_t popped = this->rxBuffer()->pop(reinterpret_cast<uint8_t *>(buffer) + count, length - count);
+        if (popped > 0)
+        {
+            count += popped;
+
+            // timeout is between characters, same as Stream::readBytes
+            _startMillis = millis();
+        }
+        else if (millis() - _startMillis >= _timeout)
+        {
+            break;
+        }
+        else
+        {
+            yield();
+        }
     }
 
-    // enable tx + empty interrupt
-    USART_FuncCmd(this->config->peripheral.register_base, UsartTxAndTxEmptyInt, Enable);
+    return count;
+}
+
+int Usart::availableLines(void)
+{
+    if (!USART_RX_FRAMING_ENABLED(this->config))
+    {
+        return 0;
+    }
 
-    // wrote one byte
-    return 1;
+    flushRxDma();
+    return this->config->state.rx_lines->count();
+}
+
+int Usart::readLine(char *buffer, size_t size, usart_rx_line_t *line)
+{
+    CORE_ASSERT(USART_RX_FRAMING_ENABLED(this->config), "Usart::readLine() RX line framing not enabled", return -1);
+    CORE_ASSERT(buffer != NULL && size > 0, "Usart::readLine() invalid buffer", return -1);
+
+    // get the next complete line
+    flushRxDma();
+    usart_rx_line_t info;
+    if (!this->config->state.rx_lines->pop(info))
+    {
+        return -1;
+    }
+
+    // copy line without terminator, truncate if buffer is too small
+    const size_t length = info.length - 1;
+    const size_t copied = length < (size - 1) ? length : (size - 1);
+    this->rxBuffer()->pop(reinterpret_cast<uint8_t *>(buffer), copied);
+    buffer[copied] = '\0';
+
+    // skip the rest of the line and the terminator
+    this->rxBuffer()->consume(info.length - copied);
+
+    if (line != NULL)
+    {
+        *line = info;
+    }
+
+    return copied;
+}
+
+void Usart::startTx(void)
+{
+    // start DMA transfer, or enable tx + empty interrupt
+    if (USART_TX_DMA_ENABLED(this->config))
+    {
+        usart_dma_tx_start(this->config);
+    }
+    else
+    {
+        // the TX complete interrupt must not disable TX (and re-enable RX in half-duplex mode)
+        // between re-arming and enabling TX
+        const uint32_t critical = core_critical_enter();
+        USART_FuncCmd(this->config->peripheral.register_base, UsartTxCmpltInt, Disable);
+        usart_half_duplex_tx_begin(this->config);
+        this->config->state.tx_active = true;
+        USART_FuncCmd(this->config->peripheral.register_base, UsartTxAndTxEmptyInt, Enable);
+        core_critical_exit(critical);
+    }
 }
 
 const usart_receive_error_t Usart::getReceiveError()
@@ -279,3 +514,126 @@ const usart_receive_error_t Usart::getReceiveError()
     this->config->state.rx_error = usart_receive_error_t::None;
     return rxError;
 }
+
+void Usart::flushRxDma(void)
+{
+    // pick up data received since the last receive timeout
+    if (this->initialized && USART_RX_DMA_ENABLED(this->config))
+    {
+        usart_dma_rx_flush(this->config);
+    }
+}
+
+void Usart::clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)previous;
+    Usart *usart = static_cast<Usart *>(param);
+    if (phase == SYSCLOCK_CHANGE_PRE)
+    {
+        // drain the tx buffer, so no byte is sent with a half-updated baud rate
+        usart->flush();
+        return;
+    }
+
+    // re-derive dividers from the new PCLK1
+    usart_set_baudrate(usart->config->peripheral.register_base, usart->baudrate, &usart->baudSettings);
+    if (USART_RX_DMA_ENABLED(usart->config))
+    {
+        usart_dma_rx_timeout_init(usart->config, usart->baudrate);
+    }
+}
+
+uint32_t Usart::getActualBaudrate(void)
+{
+    return this->initialized ? this->baudSettings.actual : 0;
+}
+
+int32_t Usart::getBaudrateError(void)
+{
+    return this->initialized ? this->baudSettings.error_ppm : 0;
+}
+
+const usart_statistics_t Usart::getStatistics(void)
+{
+    return this->config->state.statistics;
+}
+
+void Usart::resetStatistics(void)
+{
+    this->config->state.statistics = {};
+}
+
+#ifdef USART_RX_TIMESTAMPS
+uint32_t Usart::getRxTimestamp(void)
+{
+    flushRxDma();
+    return this->config->state.rx_timestamp;
+}
+#endif
+
+void Usart::setRxEvents(const uint32_t events)
+{
+    this->config->state.rx_events = events;
+}
+
+void Usart::setTxOverflowPolicy(const usart_tx_overflow_policy_t policy, const uint32_t timeout)
+{
+    this->txOverflowPolicy = policy;
+    this->txTimeout = timeout;
+}
+
+void Usart::setHalfDuplex(const bool enable)
+{
+    CORE_ASSERT(!this->initialized, "Usart::setHalfDuplex() must be called before begin()", return);
+    this->halfDuplex = enable;
+}
+
+size_t Usart::transact(const uint8_t *request, size_t request_length, uint8_t *response, size_t response_length, uint32_t timeout)
+{
+    CORE_ASSERT(this->initialized, "Usart::transact() not initialized", return 0);
+    CORE_ASSERT(response != NULL || response_length == 0, "Usart::transact() invalid response buffer", return 0);
+
+    // discard stale data, so only the response is read
+    flushRxDma();
+    this->rxBuffer()->consume(this->rxBuffer()->count());
+
+    if (write(request, request_length) != request_length)
+    {
+        return 0;
+    }
+
+    // wait until the request was sent
+    // in half-duplex mode, the receiver is enabled again once the last stop bit was sent
+    const uint32_t start = millis();
+    while (!this->txBuffer()->isEmpty() || this->config->state.tx_active)
+    {
+        if (millis() - start >= timeout)
+        {
+            return 0;
+        }
+
+        yield();
+    }
+
+    // receive the response
+    size_t count = 0;
+    while (count < response_length)
+    {
+        flushRxDma();
+        const size_t popped = this->rxBuffer()->pop(response + count, response_length - count);
+        if (popped > 0)
+        {
+            count += popped;
+        }
+        else if (millis() - start >= timeout)
+        {
+            break;
+        }
+        else
+        {
+            yield();
+        }
+    }
+
+    return count;
+}
@@ -21,6 +21,8 @@
 #include "HardwareSerial.h"
 #include "RingBuffer.h"
 #include "usart_config.h"
+#include "usart_baud.h"
+#include "../sysclock/sysclock_switch.h"
 #include "../../core_types.h"
 
 class Usart : public HardwareSerial
@@ -31,8 +33,11 @@ public:
    * @param config pointer to the usart configuration struct
    * @param tx_pin gpio pin number for tx function
    * @param rx_pin gpio pin number for rx function
+   * @note constexpr, so the Serial globals are initialized at compile time. the config and pins are checked by
+   *       begin()
    */
-  Usart(struct usart_config_t *config, gpio_pin_t tx_pin, gpio_pin_t rx_pin);
+  constexpr Usart(struct usart_config_t *config, gpio_pin_t tx_pin, gpio_pin_t rx_pin)
+      : config(config), tx_pin(tx_pin), rx_pin(rx_pin) {}
   void begin(uint32_t baud);
   void begin(uint32_t baud, uint16_t config);
   void begin(uint32_t baud, const stc_usart_uart_init_t *config);
@@ -41,9 +46,18 @@ public:
   int availableForWrite();
   int peek();
   int read();
+
+  /**
+   * @brief wait until all data in the tx buffer was sent
+   * @note returns only after the last stop bit has left the shift register
+   * @note sleeps (WFI) between interrupts while waiting. must not be called with interrupts disabled
+   */
   void flush();
   size_t write(uint8_t ch);
-  using Print::write; // pull in write(str) and write(buf, size) from Print
+  size_t write(const uint8_t *buffer, size_t size);
+  using Print::write; // pull in write(str) from Print
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
   operator bool() { return true; }
 
   /**
@@ -57,7 +71,129 @@ public:
    */
   const usart_receive_error_t getReceiveError(void);
 
+  /**
+   * @brief get the baud rate actually generated, which may differ from the one passed to begin()
+   * @return the baud rate, or 0 if not initialized
+   */
+  uint32_t getActualBaudrate(void);
+
+  /**
+   * @brief get the error of the actual baud rate, relative to the one passed to begin()
+   * @return the error, in ppm. links usually tolerate up to about +-20000 ppm (2%) in total
+   */
+  int32_t getBaudrateError(void);
+
+  /**
+   * @brief get a snapshot of the usart statistics
+   * @note the counters are updated from interrupts, so the snapshot may be slightly inconsistent
+   */
+  const usart_statistics_t getStatistics(void);
+
+  /**
+   * @brief reset all usart statistics to zero
+   */
+  void resetStatistics(void);
+
+#ifdef USART_RX_TIMESTAMPS
+  /**
+   * @brief get the time the latest data was received
+   * @return micros() when the latest byte arrived
+   * @note requires USART_RX_TIMESTAMPS. with RX line framing, readLine() returns per-line timestamps instead
+   * @note with RX DMA, the timestamp is set by the receive timeout interrupt when the line goes idle, for the last
+   *       byte of the burst. all bytes of a burst share it. bytes read (or framed into lines) before the burst
+   *       ended, e.g. by polling available(), carry the timestamp of the previous burst instead
+   */
+  uint32_t getRxTimestamp(void);
+#endif
+
+  /**
+   * @brief get the number of complete lines in the rx buffer
+   * @note requires RX line framing to be enabled (USART[n]_RX_LINE_FRAMING). returns 0 otherwise
+   */
+  int availableLines(void);
+
+  /**
+   * @brief read the next complete line from the rx buffer
+   * @param buffer buffer to copy the line to. the line terminator is not copied, but the line is null-terminated
+   * @param size size of the buffer. longer lines are truncated
+   * @param line optional, receives length, checksum and error information of the line.
+   *             with USART_RX_TIMESTAMPS, also the time the line was received
+   * @return the number of characters copied, or -1 if no complete line is available
+   * @note requires RX line framing to be enabled (USART[n]_RX_LINE_FRAMING)
+   * @note with RX line framing enabled, do not mix readLine() with read() or readBytes()
+   */
+  int readLine(char *buffer, size_t size, usart_rx_line_t *line = NULL);
+
+  /**
+   * @brief set events to set when data was received, for waitEvents()
+   * @param events the events. 0 to remove them
+   * @note with RX DMA, the events are set when received data is moved to the rx buffer (on receive timeout).
+   *       with RX line framing, they are set for every byte, so check availableLines() when they fire
+   */
+  void setRxEvents(const uint32_t events);
+
+  /**
+   * @brief set how write() behaves when the tx buffer is full
+   * @param policy the overflow policy
+   * @param timeout for BlockTimeout, the maximum time (in milliseconds) to wait for the tx buffer to drain
+   * @note with TX DMA enabled, OverwriteOldest behaves like DropNewest
+   */
+  void setTxOverflowPolicy(const usart_tx_overflow_policy_t policy, const uint32_t timeout = 0);
+
+  /**
+   * @brief enable or disable half-duplex mode
+   * @param enable enable half-duplex mode?
+   * @note must be called before begin()
+   * @note in half-duplex mode, the receiver is disabled while transmitting, so the local echo is suppressed.
+   *       if tx_pin and rx_pin are the same pin (single-wire), the pin function is switched between tx and rx
+   * @note the tx pin is configured as open-drain with pull-up in half-duplex mode
+   */
+  void setHalfDuplex(const bool enable);
+
+  /**
+   * @brief send a request and receive the response
+   * @param request the request to send
+   * @param request_length number of bytes in request
+   * @param response buffer for the response
+   * @param response_length number of response bytes to receive
+   * @param timeout maximum time (in milliseconds) for the whole transaction
+   * @return the number of response bytes received. less than response_length on timeout
+   * @note any data received before the request is discarded
+   * @note intended for half-duplex mode, but works in full-duplex mode too
+   */
+  size_t transact(const uint8_t *request, size_t request_length, uint8_t *response, size_t response_length, uint32_t timeout);
+
+protected:
+  /**
+   * @brief get the contiguous part of the rx buffer, for parsing without copying
+   * @note used by Stream::parseInt() and Stream::parseFloat()
+   */
+  size_t peekSpan(const char *&span) override;
+
+  /**
+   * @brief consume characters returned by peekSpan()
+   */
+  void skipSpan(size_t count) override;
+
 private:
+  /**
+   * @brief start sending the data in the tx buffer
+   * @note no-op if a transfer is already running
+   */
+  void startTx(void);
+
+  /**
+   * @brief move data received by the RX DMA to the rx buffer
+   * @note no-op if RX DMA is disabled
+   */
+  void flushRxDma(void);
+
+  /**
+   * @brief clock change listener callback, re-derives the baud rate
+   * @param param the Usart
+   */
+  static void clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param);
+
   // usart configuration struct
   usart_config_t *config;
 
@@ -66,20 +202,41 @@ private:
   gpio_pin_t rx_pin;
 
   // rx / tx buffers (unboxed from config)
-  RingBuffer<uint8_t> *rxBuffer;
-  RingBuffer<uint8_t> *txBuffer;
+  RingBuffer<uint8_t> *rxBuffer() { return this->config->state.rx_buffer; }
+  RingBuffer<uint8_t> *txBuffer() { return this->config->state.tx_buffer; }
 
   // is initialized? (begin() called)
   bool initialized = false;
+
+  // tx buffer overflow handling
+  usart_tx_overflow_policy_t txOverflowPolicy = usart_tx_overflow_policy_t::Block;
+  uint32_t txTimeout = 0;
+
+  // half-duplex mode requested? (applied in begin())
+  bool halfDuplex = false;
+
+  // baud rate set in begin(), re-applied on clock changes
+  uint32_t baudrate = 0;
+  usart_baud_t baudSettings = {};
+  sysclock_listener_t clockListener = {};
 };
 
 //
 // global instances
 //
+// DISABLE_SERIAL<n>_GLOBAL removes a single instance, e.g. when pruned by board_build.serial_globals
 #ifndef DISABLE_SERIAL_GLOBALS
+#ifndef DISABLE_SERIAL1_GLOBAL
 extern Usart Serial1;
+#define Serial Serial1
+#endif
+#ifndef DISABLE_SERIAL2_GLOBAL
 extern Usart Serial2;
+#endif
+#ifndef DISABLE_SERIAL3_GLOBAL
 extern Usart Serial3;
-
-#define Serial Serial1
+#endif
+#ifndef DISABLE_SERIAL4_GLOBAL
+extern Usart Serial4;
+#endif
 #endif
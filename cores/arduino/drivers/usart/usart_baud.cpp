@@ -0,0 +1,128 @@
+#include "usart_baud.h"
+#include "../sysclock/sysclock.h"
+#include "../../core_debug.h"
+
+// CR1
+#define USART_CR1_OVER8 (1ul << 15)
+#define USART_CR1_FBME (1ul << 29)
+
+// PR
+#define USART_PR_PSC_MASK 0x3ul
+
+// BRR
+#define USART_BRR_DIV_INTEGER_POS 8
+#define USART_BRR_DIV_FRACTION_MASK 0x7Ful
+
+/**
+ * @brief keep a candidate if it is better than the best one so far
+ */
+static void consider(const uint32_t baud, const uint64_t actual, usart_baud_t &candidate, usart_baud_t &best, uint32_t &best_error)
+{
+    const uint32_t error = actual > baud ? uint32_t(actual - baud) : uint32_t(baud - actual);
+    if (error >= best_error)
+    {
+        return;
+    }
+
+    candidate.actual = uint32_t(actual);
+    candidate.error_ppm = int32_t((int64_t(actual) - int64_t(baud)) * 1000000ll / int64_t(baud));
+    best = candidate;
+    best_error = error;
+}
+
+bool usart_baud_calculate(const uint32_t clock, const uint32_t baud, usart_baud_t &result)
+{
+    if (clock == 0 || baud == 0)
+    {
+        return false;
+    }
+
+    uint32_t best_error = UINT32_MAX;
+    for (uint8_t over8 = 0; over8 < 2; over8++)
+    {
+        const uint64_t samples = over8 ? 8 : 16;
+        for (uint8_t psc = 0; psc < 4; psc++)
+        {
+            const uint64_t c = clock >> (2 * psc);
+            const uint64_t divisor = samples * baud;
+            usart_baud_t candidate = {
+                .prescaler = psc,
+                .over8 = over8 != 0,
+                .fraction_enable = false,
+                .div_integer = 0,
+                .div_fraction = 0,
+                .actual = 0,
+                .error_ppm = 0,
+            };
+
+            // integer divider only: n = DIV_Integer + 1, rounded to nearest
+            uint64_t n = (c + divisor / 2) / divisor;
+            if (n >= 1 && n <= 256)
+            {
+                candidate.div_integer = uint8_t(n - 1);
+                consider(baud, (c + samples * n / 2) / (samples * n), candidate, result, best_error);
+            }
+
+            // fractional divider: the fraction (128 + F) / 256 is in [0.5, 1) and lowers the baud rate,
+            // so n is rounded down
+            n = c / divisor;
+            if (n >= 1 && n <= 256)
+            {
+                const uint64_t scaled = (divisor * n * 256 + c / 2) / c;
+                if (scaled >= 128 && scaled <= 255)
+                {
+                    candidate.fraction_enable = true;
+                    candidate.div_integer = uint8_t(n - 1);
+                    candidate.div_fraction = uint8_t(scaled - 128);
+                    const uint64_t den = samples * n * 256;
+                    consider(baud, (c * scaled + den / 2) / den, candidate, result, best_error);
+                }
+            }
+        }
+    }
+
+    return best_error != UINT32_MAX;
+}
+
+void usart_baud_apply(M4_USART_TypeDef *usart, const usart_baud_t &settings)
+{
+    usart->PR = (usart->PR & ~USART_PR_PSC_MASK) | settings.prescaler;
+
+    uint32_t cr1 = usart->CR1 & ~(USART_CR1_OVER8 | USART_CR1_FBME);
+    if (settings.over8)
+    {
+        cr1 |= USART_CR1_OVER8;
+    }
+    if (settings.fraction_enable)
+    {
+        cr1 |= USART_CR1_FBME;
+    }
+
+    usart->BRR = (uint32_t(settings.div_integer) << USART_BRR_DIV_INTEGER_POS) |
+                 (settings.fraction_enable ? (settings.div_fraction & USART_BRR_DIV_FRACTION_MASK) : USART_BRR_DIV_FRACTION_MASK);
+    usart->CR1 = cr1;
+}
+
+bool usart_set_baudrate(M4_USART_TypeDef *usart, const uint32_t baud, usart_baud_t *result)
+{
+    update_system_clock_frequencies();
+
+    usart_baud_t settings;
+    if (!usart_baud_calculate(SYSTEM_CLOCK_FREQUENCIES.pclk1, baud, settings))
+    {
+        CORE_DEBUG_PRINTF("USART: baud rate %lu cannot be generated from PCLK1=%lu\n", baud, SYSTEM_CLOCK_FREQUENCIES.pclk1);
+        return false;
+    }
+
+    if (settings.error_ppm > USART_BAUD_MAX_ERROR_PPM || settings.error_ppm < -USART_BAUD_MAX_ERROR_PPM)
+    {
+        CORE_DEBUG_PRINTF("USART: baud rate %lu is off by %ld ppm\n", baud, settings.error_ppm);
+    }
+
+    usart_baud_apply(usart, settings);
+    if (result != NULL)
+    {
+        *result = settings;
+    }
+    return true;
+}
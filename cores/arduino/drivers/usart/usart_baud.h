@@ -0,0 +1,80 @@
+/**
+ * USART baud rate generator setup:
+ *
+ * the baud rate is derived from PCLK1 by a prescaler (1, 4, 16, 64), the oversampling (16 or 8 samples per bit) and
+ * an 8-bit integer divider, optionally refined by a 7-bit fractional divider:
+ *
+ *   B = C / (8 * (2 - OVER8) * (DIV_Integer + 1))                                  (fraction off)
+ *   B = C * (128 + DIV_Fraction) / (8 * (2 - OVER8) * (DIV_Integer + 1) * 256)     (fraction on)
+ *
+ * with C = PCLK1 / prescaler. usart_baud_calculate() tries all combinations and picks the one closest to the
+ * requested baud rate. for equal errors, 16x oversampling (better noise tolerance) and no fraction are preferred.
+ */
+#pragma once
+#include <hc32_ddl.h>
+
+#ifndef USART_BAUD_MAX_ERROR_PPM
+/**
+ * @brief baud rate error above which a warning is printed, in ppm
+ */
+#define USART_BAUD_MAX_ERROR_PPM 20000
+#endif
+
+/**
+ * @brief baud rate generator settings
+ */
+struct usart_baud_t
+{
+    /**
+     * @brief the prescaler, as PR.PSC (0 = /1, 1 = /4, 2 = /16, 3 = /64)
+     */
+    uint8_t prescaler;
+
+    /**
+     * @brief 8x oversampling?
+     */
+    bool over8;
+
+    /**
+     * @brief use the fractional divider?
+     */
+    bool fraction_enable;
+
+    uint8_t div_integer;
+    uint8_t div_fraction;
+
+    /**
+     * @brief the resulting baud rate
+     */
+    uint32_t actual;
+
+    /**
+     * @brief error of the actual baud rate, (actual - requested) / requested, in ppm
+     */
+    int32_t error_ppm;
+};
+
+/**
+ * @brief calculate the baud rate generator settings with the smallest error
+ * @param clock the USART clock (PCLK1), in Hz
+ * @param baud the requested baud rate
+ * @param result the settings
+ * @return false if the baud rate cannot be generated from the clock
+ */
+bool usart_baud_calculate(const uint32_t clock, const uint32_t baud, usart_baud_t &result);
+
+/**
+ * @brief write baud rate generator settings to a USART
+ * @note call after USART_UART_Init(), which sets the prescaler and oversampling it is given
+ */
+void usart_baud_apply(M4_USART_TypeDef *usart, const usart_baud_t &settings);
+
+/**
+ * @brief set the baud rate of a USART, from the current PCLK1
+ * @param usart the USART
+ * @param baud the requested baud rate
+ * @param result optional, receives the settings and the actual baud rate
+ * @return false if the baud rate cannot be generated
+ * @note replaces USART_SetBaudrate(), which keeps the prescaler and oversampling of the initial configuration
+ */
+bool usart_set_baudrate(M4_USART_TypeDef *usart, const uint32_t baud, usart_baud_t *result = NULL);
@@ -2,6 +2,8 @@
 #include "usart_handlers.h"
 #include "../../WVariant.h"
 #include "../../core_hooks.h"
+#include "../../core_util.h"
+#include "../irqn/irq_priority.h"
 
 #ifndef SERIAL_BUFFER_SIZE
 #define SERIAL_BUFFER_SIZE 64
@@ -12,6 +14,135 @@
 #ifndef SERIAL_RX_BUFFER_SIZE
 #define SERIAL_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
 #endif
+#ifndef SERIAL_RX_DMA_BUFFER_SIZE
+#define SERIAL_RX_DMA_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+#ifndef USART1_TX_BUFFER_SIZE
+#define USART1_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#ifndef USART1_RX_BUFFER_SIZE
+#define USART1_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+#ifndef USART2_TX_BUFFER_SIZE
+#define USART2_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#ifndef USART2_RX_BUFFER_SIZE
+#define USART2_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+#ifndef USART3_TX_BUFFER_SIZE
+#define USART3_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#ifndef USART3_RX_BUFFER_SIZE
+#define USART3_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+#ifndef USART4_TX_BUFFER_SIZE
+#define USART4_TX_BUFFER_SIZE SERIAL_TX_BUFFER_SIZE
+#endif
+#ifndef USART4_RX_BUFFER_SIZE
+#define USART4_RX_BUFFER_SIZE SERIAL_RX_BUFFER_SIZE
+#endif
+
+#if defined(DISABLE_USART_IRQ_HOOKS) || defined(USART1_DISABLE_IRQ_HOOKS)
+#define USART1_IRQ_HOOKS false
+#else
+#define USART1_IRQ_HOOKS true
+#endif
+#if defined(DISABLE_USART_IRQ_HOOKS) || defined(USART2_DISABLE_IRQ_HOOKS)
+#define USART2_IRQ_HOOKS false
+#else
+#define USART2_IRQ_HOOKS true
+#endif
+#if defined(DISABLE_USART_IRQ_HOOKS) || defined(USART3_DISABLE_IRQ_HOOKS)
+#define USART3_IRQ_HOOKS false
+#else
+#define USART3_IRQ_HOOKS true
+#endif
+#if defined(DISABLE_USART_IRQ_HOOKS) || defined(USART4_DISABLE_IRQ_HOOKS)
+#define USART4_IRQ_HOOKS false
+#else
+#define USART4_IRQ_HOOKS true
+#endif
+
+#ifdef USART4_RX_DMA
+#error "USART4_RX_DMA is not supported, all remaining DMA channels are in use"
+#endif
+
+//
+// USART buffers
+// statically allocated, so unused ports only cost what they are configured for.
+// the storage is accessed from the interrupt handlers, so it goes to SRAMH.
+// the RingBuffer constructor is constexpr, so the ring buffers are constant-initialized and need no code before main()
+//
+#define USART_BUFFERS(x)                                                                                      \
+    static uint8_t usart##x##_rx_buffer_storage[USART##x##_RX_BUFFER_SIZE] CORE_SRAMH;                        \
+    static uint8_t usart##x##_tx_buffer_storage[USART##x##_TX_BUFFER_SIZE] CORE_SRAMH;                        \
+    static RingBuffer<uint8_t> usart##x##_rx_buffer(usart##x##_rx_buffer_storage, USART##x##_RX_BUFFER_SIZE); \
+    static RingBuffer<uint8_t> usart##x##_tx_buffer(usart##x##_tx_buffer_storage, USART##x##_TX_BUFFER_SIZE);
+
+USART_BUFFERS(1)
+USART_BUFFERS(2)
+USART_BUFFERS(3)
+USART_BUFFERS(4)
+
+#if defined(USART1_RX_DMA) || defined(USART2_RX_DMA) || defined(USART3_RX_DMA)
+// the DMA destination repeat size, which wraps the rx dma buffer, is a 10-bit field
+static_assert(SERIAL_RX_DMA_BUFFER_SIZE > 0 && SERIAL_RX_DMA_BUFFER_SIZE <= 1023,
+              "SERIAL_RX_DMA_BUFFER_SIZE must be between 1 and 1023");
+#endif
+
+#ifdef USART1_RX_DMA
+static uint8_t usart1_rx_dma_buffer[SERIAL_RX_DMA_BUFFER_SIZE] CORE_DMA_BUFFER;
+#endif
+#ifdef USART2_RX_DMA
+static uint8_t usart2_rx_dma_buffer[SERIAL_RX_DMA_BUFFER_SIZE] CORE_DMA_BUFFER;
+#endif
+#ifdef USART3_RX_DMA
+static uint8_t usart3_rx_dma_buffer[SERIAL_RX_DMA_BUFFER_SIZE] CORE_DMA_BUFFER;
+#endif
+
+#ifdef USART1_RX_LINE_FRAMING
+static RingBuffer<usart_rx_line_t, USART_RX_LINE_INDEX_SIZE> usart1_rx_lines;
+#endif
+#ifdef USART2_RX_LINE_FRAMING
+static RingBuffer<usart_rx_line_t, USART_RX_LINE_INDEX_SIZE> usart2_rx_lines;
+#endif
+#ifdef USART3_RX_LINE_FRAMING
+static RingBuffer<usart_rx_line_t, USART_RX_LINE_INDEX_SIZE> usart3_rx_lines;
+#endif
+#ifdef USART4_RX_LINE_FRAMING
+static RingBuffer<usart_rx_line_t, USART_RX_LINE_INDEX_SIZE> usart4_rx_lines;
+#endif
+
+//
+// USART DMA configuration helpers
+//
+#define USART_TX_DMA_CONFIG(x, dma, ch)                         \
+    {                                                           \
+        .register_base = M4_DMA##dma,                           \
+        .clock_id = PWC_FCG0_PERIPH_DMA##dma,                   \
+        .channel = DmaCh##ch,                                   \
+        .event_source = EVT_USART##x##_TI,                      \
+        .transfer_complete = {                                  \
+            .interrupt_priority = IRQ_PRIORITY_USART,          \
+            .interrupt_source = INT_DMA##dma##_TC##ch,          \
+            .interrupt_handler = USARTx_tx_dma_complete_irq<x>, \
+        },                                                      \
+    }
+#define USART_RX_DMA_CONFIG(x, dma, ch)       \
+    {                                         \
+        .register_base = M4_DMA##dma,         \
+        .clock_id = PWC_FCG0_PERIPH_DMA##dma, \
+        .channel = DmaCh##ch,                 \
+        .event_source = EVT_USART##x##_RI,    \
+    }
+#define USART_DMA_DISABLED    \
+    {                         \
+        .register_base = NULL \
+    }
 
 //
 // USART configurations
@@ -22,33 +153,77 @@ usart_config_t USART1_config = {
         .clock_id = PWC_FCG1_PERIPH_USART1,
         .tx_pin_function = Func_Usart1_Tx,
         .rx_pin_function = Func_Usart1_Rx,
+        .timeout_timer = {
+            .register_base = M4_TMR01,
+            .clock_id = PWC_FCG2_PERIPH_TIM01,
+            .channel = Tim0_ChannelA,
+        },
     },
     .interrupts = {
         .rx_data_available = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART1_RI,
-            .interrupt_handler = USARTx_rx_data_available_irq<1>,
+            .interrupt_handler = USARTx_rx_data_available_irq<1, USART1_IRQ_HOOKS>,
         },
         .rx_error = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART1_EI,
             .interrupt_handler = USARTx_rx_error_irq<1>,
         },
         .tx_buffer_empty = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART1_TI,
-            .interrupt_handler = USARTx_tx_buffer_empty_irq<1>,
+            .interrupt_handler = USARTx_tx_buffer_empty_irq<1, USART1_IRQ_HOOKS>,
         },
         .tx_complete = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART1_TCI,
             .interrupt_handler = USARTx_tx_complete_irq<1>,
         },
+        .rx_timeout = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART1_RTO,
+            .interrupt_handler = USARTx_rx_timeout_irq<1>,
+        },
+        .hooks_enabled = USART1_IRQ_HOOKS,
     },
+#ifdef USART1_TX_DMA
+    .tx_dma = USART_TX_DMA_CONFIG(1, 2, 0),
+#else
+    .tx_dma = USART_DMA_DISABLED,
+#endif
+#ifdef USART1_RX_DMA
+    .rx_dma = USART_RX_DMA_CONFIG(1, 1, 0),
+#else
+    .rx_dma = USART_DMA_DISABLED,
+#endif
     .state = {
-        .rx_buffer = new RingBuffer<uint8_t>(SERIAL_RX_BUFFER_SIZE),
-        .tx_buffer = new RingBuffer<uint8_t>(SERIAL_TX_BUFFER_SIZE),
+        .rx_buffer = &usart1_rx_buffer,
+        .tx_buffer = &usart1_tx_buffer,
         .rx_error = usart_receive_error_t::None,
+        .statistics = {},
+        .tx_active = false,
+        .tx_dma_transfer_length = 0,
+#ifdef USART1_RX_DMA
+        .rx_dma_buffer = usart1_rx_dma_buffer,
+#else
+        .rx_dma_buffer = NULL,
+#endif
+        .rx_dma_buffer_size = SERIAL_RX_DMA_BUFFER_SIZE,
+        .rx_dma_read_index = 0,
+#ifdef USART1_RX_LINE_FRAMING
+        .rx_lines = &usart1_rx_lines,
+#else
+        .rx_lines = NULL,
+#endif
+        .rx_current_line = {},
+        .rx_after_cr = false,
+        .rx_events = 0,
+        .half_duplex = {},
+#ifdef USART_RX_TIMESTAMPS
+        .rx_timestamp = 0,
+        .rx_timeout_us = 0,
+#endif
     },
 };
 
@@ -58,33 +233,77 @@ usart_config_t USART2_config = {
         .clock_id = PWC_FCG1_PERIPH_USART2,
         .tx_pin_function = Func_Usart2_Tx,
         .rx_pin_function = Func_Usart2_Rx,
+        .timeout_timer = {
+            .register_base = M4_TMR01,
+            .clock_id = PWC_FCG2_PERIPH_TIM01,
+            .channel = Tim0_ChannelB,
+        },
     },
     .interrupts = {
         .rx_data_available = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART2_RI,
-            .interrupt_handler = USARTx_rx_data_available_irq<2>,
+            .interrupt_handler = USARTx_rx_data_available_irq<2, USART2_IRQ_HOOKS>,
         },
         .rx_error = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART2_EI,
             .interrupt_handler = USARTx_rx_error_irq<2>,
         },
         .tx_buffer_empty = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART2_TI,
-            .interrupt_handler = USARTx_tx_buffer_empty_irq<2>,
+            .interrupt_handler = USARTx_tx_buffer_empty_irq<2, USART2_IRQ_HOOKS>,
         },
         .tx_complete = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART2_TCI,
             .interrupt_handler = USARTx_tx_complete_irq<2>,
         },
+        .rx_timeout = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART2_RTO,
+            .interrupt_handler = USARTx_rx_timeout_irq<2>,
+        },
+        .hooks_enabled = USART2_IRQ_HOOKS,
     },
+#ifdef USART2_TX_DMA
+    .tx_dma = USART_TX_DMA_CONFIG(2, 2, 1),
+#else
+    .tx_dma = USART_DMA_DISABLED,
+#endif
+#ifdef USART2_RX_DMA
+    .rx_dma = USART_RX_DMA_CONFIG(2, 1, 2),
+#else
+    .rx_dma = USART_DMA_DISABLED,
+#endif
     .state = {
-        .rx_buffer = new RingBuffer<uint8_t>(SERIAL_RX_BUFFER_SIZE),
-        .tx_buffer = new RingBuffer<uint8_t>(SERIAL_TX_BUFFER_SIZE),
+        .rx_buffer = &usart2_rx_buffer,
+        .tx_buffer = &usart2_tx_buffer,
         .rx_error = usart_receive_error_t::None,
+        .statistics = {},
+        .tx_active = false,
+        .tx_dma_transfer_length = 0,
+#ifdef USART2_RX_DMA
+        .rx_dma_buffer = usart2_rx_dma_buffer,
+#else
+        .rx_dma_buffer = NULL,
+#endif
+        .rx_dma_buffer_size = SERIAL_RX_DMA_BUFFER_SIZE,
+        .rx_dma_read_index = 0,
+#ifdef USART2_RX_LINE_FRAMING
+        .rx_lines = &usart2_rx_lines,
+#else
+        .rx_lines = NULL,
+#endif
+        .rx_current_line = {},
+        .rx_after_cr = false,
+        .rx_events = 0,
+        .half_duplex = {},
+#ifdef USART_RX_TIMESTAMPS
+        .rx_timestamp = 0,
+        .rx_timeout_us = 0,
+#endif
     },
 };
 
@@ -94,32 +313,148 @@ usart_config_t USART3_config = {
         .clock_id = PWC_FCG1_PERIPH_USART3,
         .tx_pin_function = Func_Usart3_Tx,
         .rx_pin_function = Func_Usart3_Rx,
+        .timeout_timer = {
+            .register_base = M4_TMR02,
+            .clock_id = PWC_FCG2_PERIPH_TIM02,
+            .channel = Tim0_ChannelA,
+        },
     },
     .interrupts = {
         .rx_data_available = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART3_RI,
-            .interrupt_handler = USARTx_rx_data_available_irq<3>,
+            .interrupt_handler = USARTx_rx_data_available_irq<3, USART3_IRQ_HOOKS>,
         },
         .rx_error = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART3_EI,
             .interrupt_handler = USARTx_rx_error_irq<3>,
         },
         .tx_buffer_empty = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART3_TI,
-            .interrupt_handler = USARTx_tx_buffer_empty_irq<3>,
+            .interrupt_handler = USARTx_tx_buffer_empty_irq<3, USART3_IRQ_HOOKS>,
         },
         .tx_complete = {
-            .interrupt_priority = DDL_IRQ_PRIORITY_03,
+            .interrupt_priority = IRQ_PRIORITY_USART,
             .interrupt_source = INT_USART3_TCI,
             .interrupt_handler = USARTx_tx_complete_irq<3>,
         },
+        .rx_timeout = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART3_RTO,
+            .interrupt_handler = USARTx_rx_timeout_irq<3>,
+        },
+        .hooks_enabled = USART3_IRQ_HOOKS,
+    },
+#ifdef USART3_TX_DMA
+    .tx_dma = USART_TX_DMA_CONFIG(3, 2, 2),
+#else
+    .tx_dma = USART_DMA_DISABLED,
+#endif
+#ifdef USART3_RX_DMA
+    .rx_dma = USART_RX_DMA_CONFIG(3, 1, 3),
+#else
+    .rx_dma = USART_DMA_DISABLED,
+#endif
+    .state = {
+        .rx_buffer = &usart3_rx_buffer,
+        .tx_buffer = &usart3_tx_buffer,
+        .rx_error = usart_receive_error_t::None,
+        .statistics = {},
+        .tx_active = false,
+        .tx_dma_transfer_length = 0,
+#ifdef USART3_RX_DMA
+        .rx_dma_buffer = usart3_rx_dma_buffer,
+#else
+        .rx_dma_buffer = NULL,
+#endif
+        .rx_dma_buffer_size = SERIAL_RX_DMA_BUFFER_SIZE,
+        .rx_dma_read_index = 0,
+#ifdef USART3_RX_LINE_FRAMING
+        .rx_lines = &usart3_rx_lines,
+#else
+        .rx_lines = NULL,
+#endif
+        .rx_current_line = {},
+        .rx_after_cr = false,
+        .rx_events = 0,
+        .half_duplex = {},
+#ifdef USART_RX_TIMESTAMPS
+        .rx_timestamp = 0,
+        .rx_timeout_us = 0,
+#endif
+    },
+};
+
+usart_config_t USART4_config = {
+    .peripheral = {
+        .register_base = M4_USART4,
+        .clock_id = PWC_FCG1_PERIPH_USART4,
+        .tx_pin_function = Func_Usart4_Tx,
+        .rx_pin_function = Func_Usart4_Rx,
+        .timeout_timer = {
+            .register_base = M4_TMR02,
+            .clock_id = PWC_FCG2_PERIPH_TIM02,
+            .channel = Tim0_ChannelB,
+        },
+    },
+    .interrupts = {
+        .rx_data_available = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART4_RI,
+            .interrupt_handler = USARTx_rx_data_available_irq<4, USART4_IRQ_HOOKS>,
+        },
+        .rx_error = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART4_EI,
+            .interrupt_handler = USARTx_rx_error_irq<4>,
+        },
+        .tx_buffer_empty = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART4_TI,
+            .interrupt_handler = USARTx_tx_buffer_empty_irq<4, USART4_IRQ_HOOKS>,
+        },
+        .tx_complete = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART4_TCI,
+            .interrupt_handler = USARTx_tx_complete_irq<4>,
+        },
+        .rx_timeout = {
+            .interrupt_priority = IRQ_PRIORITY_USART,
+            .interrupt_source = INT_USART4_RTO,
+            .interrupt_handler = USARTx_rx_timeout_irq<4>,
+        },
+        .hooks_enabled = USART4_IRQ_HOOKS,
     },
+#ifdef USART4_TX_DMA
+    .tx_dma = USART_TX_DMA_CONFIG(4, 2, 3),
+#else
+    .tx_dma = USART_DMA_DISABLED,
+#endif
+    .rx_dma = USART_DMA_DISABLED,
     .state = {
-        .rx_buffer = new RingBuffer<uint8_t>(SERIAL_RX_BUFFER_SIZE),
-        .tx_buffer = new RingBuffer<uint8_t>(SERIAL_TX_BUFFER_SIZE),
+        .rx_buffer = &usart4_rx_buffer,
+        .tx_buffer = &usart4_tx_buffer,
         .rx_error = usart_receive_error_t::None,
+        .statistics = {},
+        .tx_active = false,
+        .tx_dma_transfer_length = 0,
+        .rx_dma_buffer = NULL,
+        .rx_dma_buffer_size = SERIAL_RX_DMA_BUFFER_SIZE,
+        .rx_dma_read_index = 0,
+#ifdef USART4_RX_LINE_FRAMING
+        .rx_lines = &usart4_rx_lines,
+#else
+        .rx_lines = NULL,
+#endif
+        .rx_current_line = {},
+        .rx_after_cr = false,
+        .rx_events = 0,
+        .half_duplex = {},
+#ifdef USART_RX_TIMESTAMPS
+        .rx_timestamp = 0,
+        .rx_timeout_us = 0,
+#endif
     },
 };
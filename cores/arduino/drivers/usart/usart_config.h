@@ -1,6 +1,30 @@
 #pragma once
 #include <hc32_ddl.h>
 #include "../../RingBuffer.h"
+#include "../../core_types.h"
+
+/**
+ * @brief USART receive timeout timer configuration
+ * @note the receive timeout (RTO) function of each USART is hard-wired to a Timer0 channel
+ */
+struct usart_timeout_timer_config_t
+{
+    /**
+     * @brief Timer0 peripheral register base address
+     */
+    M4_TMR0_TypeDef *register_base;
+
+    /**
+     * @brief Timer0 peripheral clock id
+     * @note in FCG2
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief Timer0 channel
+     */
+    en_tim0_channel_t channel;
+};
 
 /**
  * @brief USART peripheral configuration
@@ -27,6 +51,11 @@ struct usart_peripheral_config_t
      * @brief pin function for usart rx pin
      */
     en_port_func_t rx_pin_function;
+
+    /**
+     * @brief Timer0 channel used by the receive timeout function
+     */
+    usart_timeout_timer_config_t timeout_timer;
 };
 
 /**
@@ -80,6 +109,53 @@ struct usart_interrupts_config_t
      * @brief USART transmit complete interrupt configuration
      */
     usart_interrupt_config_t tx_complete;
+
+    /**
+     * @brief USART receive timeout interrupt configuration
+     * @note only used if RX DMA is enabled
+     */
+    usart_interrupt_config_t rx_timeout;
+
+    /**
+     * @brief call the core_hook_usart_* hooks for this usart?
+     * @note the per-byte interrupt handlers use a template parameter instead, so the hooks are compiled out there
+     */
+    bool hooks_enabled;
+};
+
+/**
+ * @brief USART DMA configuration
+ */
+struct usart_dma_config_t
+{
+    /**
+     * @brief DMA peripheral register base address
+     * @note set to NULL to disable DMA
+     */
+    M4_DMA_TypeDef *register_base;
+
+    /**
+     * @brief DMA peripheral clock id
+     * @note in FCG0
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief DMA channel to use
+     */
+    en_dma_channel_t channel;
+
+    /**
+     * @brief DMA trigger event source
+     * @note EVT_USARTx_TI for transmit, EVT_USARTx_RI for receive
+     */
+    en_event_src_t event_source;
+
+    /**
+     * @brief DMA transfer complete interrupt configuration
+     * @note unused for receive, the receive DMA never completes
+     */
+    usart_interrupt_config_t transfer_complete;
 };
 
 /**
@@ -93,6 +169,175 @@ enum class usart_receive_error_t
     OverrunError
 };
 
+/**
+ * @brief USART transmit buffer overflow policies
+ */
+enum class usart_tx_overflow_policy_t
+{
+    /**
+     * @brief wait until there is space in the tx buffer
+     */
+    Block,
+
+    /**
+     * @brief wait until there is space in the tx buffer, but give up after a timeout
+     */
+    BlockTimeout,
+
+    /**
+     * @brief drop the data that does not fit into the tx buffer
+     */
+    DropNewest,
+
+    /**
+     * @brief drop the oldest data in the tx buffer to make room
+     */
+    OverwriteOldest
+};
+
+/**
+ * @brief USART statistics
+ * @note counters wrap around on overflow
+ */
+struct usart_statistics_t
+{
+    /**
+     * @brief number of bytes received
+     * @note includes dropped bytes
+     */
+    uint32_t rx_bytes;
+
+    /**
+     * @brief number of bytes sent
+     */
+    uint32_t tx_bytes;
+
+    /**
+     * @brief number of received bytes dropped because the rx buffer was full
+     */
+    uint32_t rx_dropped;
+
+    /**
+     * @brief number of bytes dropped by the tx buffer overflow policy
+     */
+    uint32_t tx_dropped;
+
+    /**
+     * @brief number of overrun errors
+     */
+    uint32_t overrun_errors;
+
+    /**
+     * @brief number of framing errors
+     */
+    uint32_t framing_errors;
+
+    /**
+     * @brief number of parity errors
+     */
+    uint32_t parity_errors;
+
+    /**
+     * @brief highest number of bytes in the rx buffer
+     */
+    uint32_t rx_high_water;
+
+    /**
+     * @brief highest number of bytes in the tx buffer
+     */
+    uint32_t tx_high_water;
+};
+
+/**
+ * @brief update a high-water mark in usart_statistics_t
+ */
+inline void usart_update_high_water(uint32_t &mark, const size_t count)
+{
+    if (count > mark)
+    {
+        mark = count;
+    }
+}
+
+#ifndef USART_RX_LINE_INDEX_SIZE
+#define USART_RX_LINE_INDEX_SIZE 16
+#endif
+
+/**
+ * @brief a line received in RX line framing mode
+ */
+struct usart_rx_line_t
+{
+    /**
+     * @brief length of the line in the rx buffer, including the terminator
+     */
+    uint16_t length;
+
+    /**
+     * @brief XOR checksum of all bytes before the first '*' in the line
+     * @note this is the checksum format used by G-code
+     */
+    uint8_t checksum;
+
+    /**
+     * @brief checksum transmitted after the '*', if any
+     */
+    uint8_t expected_checksum;
+
+    /**
+     * @brief did the line contain a '*' followed by a checksum?
+     */
+    bool has_checksum;
+
+    /**
+     * @brief was any byte of the line dropped because the rx buffer or the line index was full?
+     */
+    bool dropped;
+
+#ifdef USART_RX_TIMESTAMPS
+    /**
+     * @brief micros() when the first byte of the line was received
+     * @note with RX DMA, this is when the DMA block containing the byte was moved to the rx buffer
+     */
+    uint32_t start_time;
+
+    /**
+     * @brief micros() when the line terminator was received
+     * @note compare with micros() when the line is consumed to get the time the line waited in the rx buffer
+     */
+    uint32_t end_time;
+#endif
+};
+
+/**
+ * @brief USART half-duplex mode state
+ */
+struct usart_half_duplex_state_t
+{
+    /**
+     * @brief is half-duplex mode enabled?
+     * @note in half-duplex mode, the receiver is disabled while transmitting
+     */
+    bool enabled;
+
+    /**
+     * @brief are tx and rx on the same pin?
+     * @note if true, the pin function is switched between tx and rx
+     */
+    bool single_wire;
+
+    /**
+     * @brief the shared tx / rx pin
+     * @note only used in single-wire mode
+     */
+    gpio_pin_t pin;
+
+    /**
+     * @brief is a transmission running, with the receiver disabled?
+     */
+    volatile bool transmitting;
+};
+
 /**
  * @brief USART runtime states
  */
@@ -112,6 +357,84 @@ struct usart_runtime_state_t
      * @brief last error in RX error interrupt handler
      */
     usart_receive_error_t rx_error;
+
+    /**
+     * @brief USART statistics
+     */
+    usart_statistics_t statistics;
+
+    /**
+     * @brief is the USART transmitting?
+     * @note set when TX is started, cleared by the TX complete interrupt once the last stop bit was sent
+     */
+    volatile bool tx_active;
+
+    /**
+     * @brief number of bytes in the currently running TX DMA transfer
+     * @note 0 if no transfer is running. only used if TX DMA is enabled
+     */
+    volatile size_t tx_dma_transfer_length;
+
+    /**
+     * @brief buffer the receive DMA writes to, in circular mode
+     * @note only used if RX DMA is enabled
+     */
+    uint8_t *rx_dma_buffer;
+
+    /**
+     * @brief size of rx_dma_buffer
+     */
+    uint16_t rx_dma_buffer_size;
+
+    /**
+     * @brief index in rx_dma_buffer up to which the data was moved to rx_buffer
+     */
+    volatile uint16_t rx_dma_read_index;
+
+    /**
+     * @brief index of complete lines in rx_buffer
+     * @note RX line framing is disabled if NULL
+     */
+    RingBuffer<usart_rx_line_t, USART_RX_LINE_INDEX_SIZE> *rx_lines;
+
+    /**
+     * @brief the line currently being received
+     * @note only used if RX line framing is enabled
+     */
+    usart_rx_line_t rx_current_line;
+
+    /**
+     * @brief was the last received byte a '\r' that ended a line?
+     * @note a '\n' right after it is dropped, so CRLF ends a single line
+     */
+    bool rx_after_cr;
+
+    /**
+     * @brief events set when data was received
+     * @note 0 if not set. see core_events.h
+     */
+    uint32_t rx_events;
+
+    /**
+     * @brief half-duplex mode state
+     * @note set up by Usart::begin()
+     */
+    usart_half_duplex_state_t half_duplex;
+
+#ifdef USART_RX_TIMESTAMPS
+    /**
+     * @brief micros() when the latest received byte arrived
+     * @note set by the rx producer before pushing, see usart_rx_timestamp().
+     *       with RX DMA, only set by the receive timeout interrupt, for the last byte before the line went idle
+     */
+    volatile uint32_t rx_timestamp;
+
+    /**
+     * @brief duration of the RX DMA receive timeout, in microseconds
+     * @note the receive timeout interrupt fires this long after the last byte arrived
+     */
+    uint32_t rx_timeout_us;
+#endif
 };
 
 /**
@@ -129,15 +452,39 @@ struct usart_config_t
      */
     usart_interrupts_config_t interrupts;
 
+    /**
+     * @brief USART transmit DMA configuration
+     * @note TX DMA is disabled if register_base is NULL
+     */
+    usart_dma_config_t tx_dma;
+
+    /**
+     * @brief USART receive DMA configuration
+     * @note RX DMA is disabled if register_base is NULL
+     */
+    usart_dma_config_t rx_dma;
+
     /**
      * @brief USART runtime states
      */
     usart_runtime_state_t state;
 };
 
+/**
+ * @brief get the usart channel number (1-4) of a usart peripheral
+ * @note 0 if not a valid usart peripheral
+ */
+#define USART_REG_TO_X(reg) \
+    reg == M4_USART1   ? 1  \
+    : reg == M4_USART2 ? 2  \
+    : reg == M4_USART3 ? 3  \
+    : reg == M4_USART4 ? 4  \
+                       : 0
+
 //
-// USART 1-3 configurations
+// USART 1-4 configurations
 //
 extern usart_config_t USART1_config;
 extern usart_config_t USART2_config;
 extern usart_config_t USART3_config;
+extern usart_config_t USART4_config;
@@ -0,0 +1,357 @@
+#include "usart_dma.h"
+#include "usart_rx_framing.h"
+#include "usart_half_duplex.h"
+#include "../../core_debug.h"
+#include "../../core_hooks.h"
+#include "../sysclock/sysclock.h"
+#include "../../core_critical.h"
+#include "../../core_idle.h"
+#include "../../core_events.h"
+
+// DMA transfer count register is 16 bits wide
+#define USART_DMA_MAX_TRANSFER_LENGTH 0xFFFF
+
+#ifndef USART_RX_DMA_TIMEOUT_BITS
+#define USART_RX_DMA_TIMEOUT_BITS 20
+#endif
+
+void usart_dma_tx_init(usart_config_t *config)
+{
+    CORE_ASSERT(USART_TX_DMA_ENABLED(config), "usart_dma_tx_init() TX DMA not enabled", return);
+    usart_dma_config_t &dma = config->tx_dma;
+
+    // prepare DMA transfer configuration to
+    // transfer single bytes from the tx buffer to USARTx->DR (TDR)
+    // source address and transfer count are set for each transfer
+    stc_dma_config_t dma_config = {
+        .u16BlockSize = 1,
+        .u16TransferCnt = 0,
+        .u32SrcAddr = 0,
+        .u32DesAddr = (uint32_t)(&config->peripheral.register_base->DR), // destination address is USARTx->DR
+        .u16SrcRptSize = 0,
+        .u16DesRptSize = 0,
+        .stcDmaChCfg = {
+            .enSrcInc = AddressIncrease,
+            .enDesInc = AddressFix,
+            .enSrcRptEn = Disable,
+            .enDesRptEn = Disable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = Dma8Bit,
+            .enLlpEn = Disable,
+            .enIntEn = Enable,
+        },
+    };
+
+    // enable DMA peripheral clock
+    PWC_Fcg0PeriphClockCmd(dma.clock_id, Enable);
+
+    // initialize DMA channel, but keep it disabled until there is something to send
+    DMA_InitChannel(dma.register_base, dma.channel, &dma_config);
+    DMA_Cmd(dma.register_base, Enable);
+    DMA_ChannelCmd(dma.register_base, dma.channel, Disable);
+
+    // clear DMA transfer complete flags
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, BlkTrnCpltIrq);
+
+    // AOS is required to trigger DMA transfer, enable AOS peripheral clock
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // trigger a DMA transfer every time the USART TX data register is empty
+    DMA_SetTriggerSrc(dma.register_base, dma.channel, dma.event_source);
+
+    config->state.tx_dma_transfer_length = 0;
+}
+
+void usart_dma_tx_deinit(usart_config_t *config)
+{
+    CORE_ASSERT(USART_TX_DMA_ENABLED(config), "usart_dma_tx_deinit() TX DMA not enabled", return);
+    usart_dma_config_t &dma = config->tx_dma;
+
+    // stop channel and clear flags
+    DMA_ChannelCmd(dma.register_base, dma.channel, Disable);
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, BlkTrnCpltIrq);
+
+    config->state.tx_dma_transfer_length = 0;
+}
+
+void usart_dma_tx_start(usart_config_t *config)
+{
+    usart_dma_config_t &dma = config->tx_dma;
+    M4_USART_TypeDef *usart = config->peripheral.register_base;
+
+    // this may be called both from thread mode and from the DMA interrupt,
+    // so checking and claiming the channel must not be interrupted
+    const uint32_t critical = core_critical_enter();
+
+    // if a transfer is running, the transfer complete handler will start the next one
+    if (config->state.tx_dma_transfer_length != 0)
+    {
+        core_critical_exit(critical);
+        return;
+    }
+
+    // get next contiguous span from the tx buffer
+    // the bytes are only removed once the transfer completed, so the span stays valid
+    uint8_t *span;
+    size_t length = config->state.tx_buffer->peekContiguous(span);
+    if (length == 0)
+    {
+        core_critical_exit(critical);
+        return;
+    }
+
+    if (length > USART_DMA_MAX_TRANSFER_LENGTH)
+    {
+        length = USART_DMA_MAX_TRANSFER_LENGTH;
+    }
+
+    config->state.tx_dma_transfer_length = length;
+    config->state.tx_active = true;
+
+    if (config->interrupts.hooks_enabled)
+    {
+        core_hook_usart_tx_block_irq(span, length, USART_REG_TO_X(usart));
+    }
+
+    // TX complete interrupt would disable TX while the transfer is running
+    USART_FuncCmd(usart, UsartTxCmpltInt, Disable);
+    usart_half_duplex_tx_begin(config);
+
+    // set source and length, then arm the channel
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, TrnCpltIrq);
+    DMA_SetSrcAddress(dma.register_base, dma.channel, (uint32_t)span);
+    DMA_SetTransferCnt(dma.register_base, dma.channel, uint16_t(length));
+    DMA_ChannelCmd(dma.register_base, dma.channel, Enable);
+
+    // (re-) enable TX + empty interrupt to generate the trigger event for the first byte
+    // (the TX empty IRQ is not registered in DMA mode, so only the DMA is triggered)
+    USART_FuncCmd(usart, UsartTxEmptyInt, Disable);
+    USART_FuncCmd(usart, UsartTxAndTxEmptyInt, Enable);
+
+    core_critical_exit(critical);
+}
+
+void usart_dma_tx_complete(usart_config_t *config)
+{
+    usart_dma_config_t &dma = config->tx_dma;
+    M4_USART_TypeDef *usart = config->peripheral.register_base;
+
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(dma.register_base, dma.channel, BlkTrnCpltIrq);
+
+    // release the span that was just sent
+    config->state.statistics.tx_bytes += config->state.tx_dma_transfer_length;
+    config->state.tx_buffer->consume(config->state.tx_dma_transfer_length);
+    config->state.tx_dma_transfer_length = 0;
+
+    // start next transfer if more data was buffered in the meantime
+    // (a higher priority interrupt must not start a transfer between start and the check below)
+    const uint32_t critical = core_critical_enter();
+    usart_dma_tx_start(config);
+    if (config->state.tx_dma_transfer_length == 0)
+    {
+        // nothing left to send, disable TX empty interrupt and enable TX complete interrupt
+        // (tx complete interrupt will disable TX when it fires)
+        USART_FuncCmd(usart, UsartTxEmptyInt, Disable);
+        USART_FuncCmd(usart, UsartTxCmpltInt, Enable);
+    }
+    core_critical_exit(critical);
+}
+
+void usart_dma_rx_init(usart_config_t *config)
+{
+    CORE_ASSERT(USART_RX_DMA_ENABLED(config), "usart_dma_rx_init() RX DMA not enabled", return);
+    CORE_ASSERT(config->state.rx_dma_buffer != NULL, "usart_dma_rx_init() RX DMA buffer not allocated", return);
+    usart_dma_config_t &dma = config->rx_dma;
+
+    // prepare DMA transfer configuration to
+    // transfer single bytes from USARTx->DR (RDR) to the rx dma buffer
+    // the destination address wraps around after rx_dma_buffer_size bytes,
+    // and with a transfer count of 0 the transfer never completes
+    stc_dma_config_t dma_config = {
+        .u16BlockSize = 1,
+        .u16TransferCnt = 0,
+        .u32SrcAddr = (uint32_t)(&config->peripheral.register_base->DR) + 2, // source address is USARTx->DR RDR (upper half word)
+        .u32DesAddr = (uint32_t)(config->state.rx_dma_buffer),               // destination address is state.rx_dma_buffer
+        .u16SrcRptSize = 0,
+        .u16DesRptSize = config->state.rx_dma_buffer_size,
+        .stcDmaChCfg = {
+            .enSrcInc = AddressFix,
+            .enDesInc = AddressIncrease,
+            .enSrcRptEn = Disable,
+            .enDesRptEn = Enable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = Dma8Bit,
+            .enLlpEn = Disable,
+            .enIntEn = Disable,
+        },
+    };
+
+    // enable DMA peripheral clock
+    PWC_Fcg0PeriphClockCmd(dma.clock_id, Enable);
+
+    // initialize DMA channel and enable
+    DMA_InitChannel(dma.register_base, dma.channel, &dma_config);
+    DMA_Cmd(dma.register_base, Enable);
+    DMA_ChannelCmd(dma.register_base, dma.channel, Enable);
+
+    // AOS is required to trigger DMA transfer, enable AOS peripheral clock
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // trigger a DMA transfer every time the USART received a byte
+    DMA_SetTriggerSrc(dma.register_base, dma.channel, dma.event_source);
+
+    config->state.rx_dma_read_index = 0;
+}
+
+void usart_dma_rx_deinit(usart_config_t *config)
+{
+    CORE_ASSERT(USART_RX_DMA_ENABLED(config), "usart_dma_rx_deinit() RX DMA not enabled", return);
+    usart_dma_config_t &dma = config->rx_dma;
+
+    DMA_ChannelCmd(dma.register_base, dma.channel, Disable);
+    config->state.rx_dma_read_index = 0;
+}
+
+/**
+ * @brief get the Timer0 clock divider and compare value for a timeout of 'ticks' clock cycles
+ * @return false if the timeout cannot be represented
+ */
+inline bool get_timeout_clock_div(uint32_t ticks, en_tim0_clock_div_t &div, uint16_t &compare)
+{
+    // Tim0_ClkDiv0 ... Tim0_ClkDiv1024 are consecutive values for dividers 1, 2, 4, ..., 1024
+    for (uint8_t shift = 0; shift <= 10; shift++)
+    {
+        const uint32_t cmp = ticks >> shift;
+        if (cmp <= 0xFFFF)
+        {
+            div = en_tim0_clock_div_t(Tim0_ClkDiv0 + shift);
+            compare = cmp > 0 ? uint16_t(cmp) : 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void usart_dma_rx_timeout_init(usart_config_t *config, uint32_t baud)
+{
+    usart_timeout_timer_config_t &timer = config->peripheral.timeout_timer;
+
+    stc_tim0_base_init_t timer_config;
+    MEM_ZERO_STRUCT(timer_config);
+
+    // get timer base clock
+    uint32_t base_frequency;
+    if (timer.register_base == M4_TMR01 && timer.channel == Tim0_ChannelA)
+    {
+        // Timer0 Unit 1 Channel A does not support Sync mode, use LRC instead
+        CLK_LrcCmd(Enable);
+        timer_config.Tim0_CounterMode = Tim0_Async;
+        timer_config.Tim0_AsyncClockSource = Tim0_LRC;
+        base_frequency = LRC_VALUE;
+    }
+    else
+    {
+        update_system_clock_frequencies();
+        timer_config.Tim0_CounterMode = Tim0_Sync;
+        timer_config.Tim0_SyncClockSource = Tim0_Pclk1;
+        base_frequency = SYSTEM_CLOCK_FREQUENCIES.pclk1;
+    }
+
+    // calculate compare value for the timeout
+    const uint32_t ticks = (uint64_t(base_frequency) * USART_RX_DMA_TIMEOUT_BITS) / baud;
+#ifdef USART_RX_TIMESTAMPS
+    config->state.rx_timeout_us = uint32_t((uint64_t(USART_RX_DMA_TIMEOUT_BITS) * 1000000) / baud);
+#endif
+    CORE_ASSERT(get_timeout_clock_div(ticks, timer_config.Tim0_ClockDivision, timer_config.Tim0_CmpValue),
+                "usart_dma_rx_timeout_init() timeout out of range", return);
+
+    // enable Timer0 peripheral clock and initialize channel
+    PWC_Fcg2PeriphClockCmd(timer.clock_id, Enable);
+    TIMER0_BaseInit(timer.register_base, timer.channel, &timer_config);
+    TIMER0_WriteCntReg(timer.register_base, timer.channel, 0);
+
+    // the USART clears and starts the timer on every received byte
+    stc_tim0_trigger_init_t trigger_config;
+    MEM_ZERO_STRUCT(trigger_config);
+    trigger_config.Tim0_OCMode = Tim0_OC_Mode;
+    trigger_config.Tim0_InTrigEnable = false;
+    trigger_config.Tim0_InTrigClear = true;
+    trigger_config.Tim0_InTrigStart = true;
+    trigger_config.Tim0_InTrigStop = false;
+    TIMER0_HardTriggerInit(timer.register_base, timer.channel, &trigger_config);
+
+    // enable receive timeout function and interrupt
+    USART_ClearStatus(config->peripheral.register_base, UsartRxTimeOut);
+    USART_FuncCmd(config->peripheral.register_base, UsartTimeOut, Enable);
+    USART_FuncCmd(config->peripheral.register_base, UsartTimeOutInt, Enable);
+}
+
+void usart_dma_rx_timeout_deinit(usart_config_t *config)
+{
+    usart_timeout_timer_config_t &timer = config->peripheral.timeout_timer;
+
+    USART_FuncCmd(config->peripheral.register_base, UsartTimeOutInt, Disable);
+    USART_FuncCmd(config->peripheral.register_base, UsartTimeOut, Disable);
+    TIMER0_Cmd(timer.register_base, timer.channel, Disable);
+}
+
+void usart_dma_rx_flush(usart_config_t *config)
+{
+    const uint8_t usart_channel = USART_REG_TO_X(config->peripheral.register_base);
+    usart_dma_config_t &dma = config->rx_dma;
+
+    // flushing may be interrupted by the receive timeout interrupt, which also flushes
+    const uint32_t critical = core_critical_enter();
+
+    // get DMA write index from the current destination address
+    const uint32_t base = (uint32_t)(config->state.rx_dma_buffer);
+    const uint16_t write_index = (DMA_GetDesAddr(dma.register_base, dma.channel) - base) % config->state.rx_dma_buffer_size;
+
+    // move all new bytes to the rx buffer, in up to two contiguous blocks
+    // (the timestamp of the bytes is set by the receive timeout interrupt, not here at consume time)
+    uint16_t read_index = config->state.rx_dma_read_index;
+    while (read_index != write_index)
+    {
+        const uint16_t end = write_index > read_index ? write_index : config->state.rx_dma_buffer_size;
+        const uint8_t *block = &config->state.rx_dma_buffer[read_index];
+        const uint16_t length = end - read_index;
+
+        if (config->interrupts.hooks_enabled)
+        {
+            core_hook_usart_rx_block_irq(block, length, usart_channel);
+        }
+
+        for (uint16_t i = 0; i < length; i++)
+        {
+            if (config->interrupts.hooks_enabled)
+            {
+                core_hook_usart_rx_irq(block[i], usart_channel);
+            }
+
+            config->state.statistics.rx_bytes++;
+            if (!usart_rx_push(config, block[i]))
+            {
+                config->state.statistics.rx_dropped++;
+            }
+        }
+
+        read_index = end % config->state.rx_dma_buffer_size;
+    }
+
+    // only signal if data was moved, so polling available() does not set the events
+    const bool received = read_index != config->state.rx_dma_read_index;
+    config->state.rx_dma_read_index = read_index;
+    usart_update_high_water(config->state.statistics.rx_high_water, config->state.rx_buffer->count());
+    core_critical_exit(critical);
+    if (received)
+    {
+        core_events_set(config->state.rx_events);
+        core_idle_notify();
+    }
+}
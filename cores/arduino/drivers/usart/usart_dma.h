@@ -0,0 +1,79 @@
+#pragma once
+#include <hc32_ddl.h>
+#include "usart_config.h"
+
+/**
+ * @brief check if TX DMA is enabled in a usart configuration
+ */
+#define USART_TX_DMA_ENABLED(usart_config) ((usart_config)->tx_dma.register_base != NULL)
+
+/**
+ * @brief check if RX DMA is enabled in a usart configuration
+ */
+#define USART_RX_DMA_ENABLED(usart_config) ((usart_config)->rx_dma.register_base != NULL)
+
+/**
+ * @brief initialize the TX DMA channel of a usart
+ * @param config usart configuration
+ * @note requires TX DMA to be enabled in the configuration
+ * @note the transfer complete interrupt has to be registered by the caller
+ */
+void usart_dma_tx_init(usart_config_t *config);
+
+/**
+ * @brief stop the TX DMA channel of a usart
+ * @param config usart configuration
+ * @note any running transfer is aborted
+ */
+void usart_dma_tx_deinit(usart_config_t *config);
+
+/**
+ * @brief start a TX DMA transfer of the next contiguous span in the tx buffer
+ * @param config usart configuration
+ * @note if a transfer is already running, this function does nothing.
+ *       the transfer complete handler will pick up any newly buffered data
+ */
+void usart_dma_tx_start(usart_config_t *config);
+
+/**
+ * @brief handle completion of a TX DMA transfer
+ * @param config usart configuration
+ * @note called from the DMA transfer complete interrupt
+ */
+void usart_dma_tx_complete(usart_config_t *config);
+
+/**
+ * @brief initialize and start the RX DMA channel of a usart
+ * @param config usart configuration
+ * @note requires RX DMA to be enabled in the configuration
+ * @note the DMA writes into state.rx_dma_buffer continuously, in circular mode
+ */
+void usart_dma_rx_init(usart_config_t *config);
+
+/**
+ * @brief stop the RX DMA channel of a usart
+ * @param config usart configuration
+ */
+void usart_dma_rx_deinit(usart_config_t *config);
+
+/**
+ * @brief setup the receive timeout function of a usart
+ * @param config usart configuration
+ * @param baud the baud rate the usart is configured for
+ * @note the timeout fires after USART_RX_DMA_TIMEOUT_BITS bit times without receiving data
+ * @note the rx_timeout interrupt has to be registered by the caller
+ */
+void usart_dma_rx_timeout_init(usart_config_t *config, uint32_t baud);
+
+/**
+ * @brief stop the receive timeout function of a usart
+ * @param config usart configuration
+ */
+void usart_dma_rx_timeout_deinit(usart_config_t *config);
+
+/**
+ * @brief move all data the RX DMA wrote since the last call from state.rx_dma_buffer to state.rx_buffer
+ * @param config usart configuration
+ * @note safe to call both from thread mode and from the receive timeout interrupt
+ */
+void usart_dma_rx_flush(usart_config_t *config);
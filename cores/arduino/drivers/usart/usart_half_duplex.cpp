@@ -0,0 +1,41 @@
+#include "usart_half_duplex.h"
+#include "../gpio/gpio.h"
+
+void usart_half_duplex_tx_begin(usart_config_t *config)
+{
+    usart_half_duplex_state_t &half_duplex = config->state.half_duplex;
+    if (!half_duplex.enabled || half_duplex.transmitting)
+    {
+        return;
+    }
+
+    half_duplex.transmitting = true;
+
+    // stop receiving, everything on the line is our own echo now
+    USART_FuncCmd(config->peripheral.register_base, UsartRx, Disable);
+
+    // in single-wire mode, the pin is only connected to one function at a time
+    if (half_duplex.single_wire)
+    {
+        GPIO_SetFunc(half_duplex.pin, config->peripheral.tx_pin_function);
+    }
+}
+
+void usart_half_duplex_tx_end(usart_config_t *config)
+{
+    usart_half_duplex_state_t &half_duplex = config->state.half_duplex;
+    if (!half_duplex.enabled || !half_duplex.transmitting)
+    {
+        return;
+    }
+
+    // hand the line back to the receiver
+    // (the open-drain output and pull-up keep the line idle while switching)
+    if (half_duplex.single_wire)
+    {
+        GPIO_SetFunc(half_duplex.pin, config->peripheral.rx_pin_function);
+    }
+
+    USART_FuncCmd(config->peripheral.register_base, UsartRx, Enable);
+    half_duplex.transmitting = false;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <hc32_ddl.h>
+#include "usart_config.h"
+
+/**
+ * @brief check if half-duplex mode is enabled in a usart configuration
+ */
+#define USART_HALF_DUPLEX_ENABLED(usart_config) ((usart_config)->state.half_duplex.enabled)
+
+/**
+ * @brief prepare a usart in half-duplex mode for transmitting
+ * @param config usart configuration
+ * @note disables the receiver, so the local echo is not received. in single-wire mode, the pin is switched to the TX function
+ * @note must be called with interrupts disabled, before TX is enabled. no-op if half-duplex mode is disabled
+ */
+void usart_half_duplex_tx_begin(usart_config_t *config);
+
+/**
+ * @brief return a usart in half-duplex mode to receiving
+ * @param config usart configuration
+ * @note called from the TX complete interrupt, once the last stop bit was sent. no-op if half-duplex mode is disabled
+ */
+void usart_half_duplex_tx_end(usart_config_t *config);
@@ -1,56 +1,89 @@
 #include "usart_config.h"
+#include "usart_dma.h"
+#include "usart_rx_framing.h"
+#include "usart_half_duplex.h"
 #include "../../core_hooks.h"
+#include "../../core_util.h"
+#include "../../core_idle.h"
+#include "../../core_trace.h"
+#include "../../core_events.h"
 
-#define USART_COUNT 3
+#define USART_COUNT 4
 usart_config_t *USARTx[USART_COUNT] = {
     &USART1_config,
     &USART2_config,
     &USART3_config,
+    &USART4_config,
 };
 
 #define IS_VALID_USARTx(x) ((x) >= 1 && (x) <= USART_COUNT)
 #define ASSERT_VALID_USARTx(x) static_assert(IS_VALID_USARTx(x), "USART number must be between 1 and USART_COUNT")
 
-template <uint8_t x>
-static void USARTx_rx_data_available_irq(void)
+template <uint8_t x, bool hooks>
+CORE_RAMFUNC static void USARTx_rx_data_available_irq(void)
 {
     ASSERT_VALID_USARTx(x);
     usart_config_t *usartx = USARTx[x - 1];
 
     // get the received byte and push it to the rx buffer
     uint8_t ch = USART_RecData(usartx->peripheral.register_base);
-    core_hook_usart_rx_irq(ch, x);
-    usartx->state.rx_buffer->push(ch);
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_RX, x, ch);
+    if (hooks)
+    {
+        core_hook_usart_rx_irq(ch, x);
+        core_hook_usart_rx_block_irq(&ch, 1, x);
+    }
+
+    usartx->state.statistics.rx_bytes++;
+    usart_rx_timestamp(usartx);
+    if (!usart_rx_push(usartx, ch))
+    {
+        usartx->state.statistics.rx_dropped++;
+    }
+
+    usart_update_high_water(usartx->state.statistics.rx_high_water, usartx->state.rx_buffer->count());
+    core_events_set(usartx->state.rx_events);
+    core_idle_notify();
 }
 
 template <uint8_t x>
-static void USARTx_rx_error_irq(void)
+CORE_RAMFUNC static void USARTx_rx_error_irq(void)
 {
     ASSERT_VALID_USARTx(x);
     usart_config_t *usartx = USARTx[x - 1];
 
     // check and clear error flags
+#ifdef CORE_TRACE
+    const uint32_t trace_flags = (USART_GetStatus(usartx->peripheral.register_base, UsartFrameErr) == Set ? 1 : 0) |
+                                 (USART_GetStatus(usartx->peripheral.register_base, UsartParityErr) == Set ? 2 : 0) |
+                                 (USART_GetStatus(usartx->peripheral.register_base, UsartOverrunErr) == Set ? 4 : 0);
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_RX_ERROR, x, trace_flags);
+#endif
+
     if (USART_GetStatus(usartx->peripheral.register_base, UsartFrameErr) == Set)
     {
         USART_ClearStatus(usartx->peripheral.register_base, UsartFrameErr);
         usartx->state.rx_error = usart_receive_error_t::FramingError;
+        usartx->state.statistics.framing_errors++;
     }
 
     if (USART_GetStatus(usartx->peripheral.register_base, UsartParityErr) == Set)
     {
         USART_ClearStatus(usartx->peripheral.register_base, UsartParityErr);
         usartx->state.rx_error = usart_receive_error_t::ParityError;
+        usartx->state.statistics.parity_errors++;
     }
 
     if (USART_GetStatus(usartx->peripheral.register_base, UsartOverrunErr) == Set)
     {
         USART_ClearStatus(usartx->peripheral.register_base, UsartOverrunErr);
         usartx->state.rx_error = usart_receive_error_t::OverrunError;
+        usartx->state.statistics.overrun_errors++;
     }
 }
 
-template <uint8_t x>
-static void USARTx_tx_buffer_empty_irq(void)
+template <uint8_t x, bool hooks>
+CORE_RAMFUNC static void USARTx_tx_buffer_empty_irq(void)
 {
     ASSERT_VALID_USARTx(x);
     usart_config_t *usartx = USARTx[x - 1];
@@ -59,12 +92,22 @@ static void USARTx_tx_buffer_empty_irq(void)
     uint8_t ch;
     if (usartx->state.tx_buffer->pop(ch))
     {
-        // call hook, then send the byte
-        core_hook_usart_tx_irq(ch, x);
+        CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_TX, x, ch);
+
+        // call hooks, then send the byte
+        if (hooks)
+        {
+            core_hook_usart_tx_irq(ch, x);
+            core_hook_usart_tx_block_irq(&ch, 1, x);
+        }
+
         USART_SendData(usartx->peripheral.register_base, ch);
+        usartx->state.statistics.tx_bytes++;
     }
     else
     {
+        CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_TX, x, 0xFFFFFFFF);
+
         // disable TX empty interrupt, and enable TX complete interrupt
         // (tx complete interrupt will disable TX when it fires)
         USART_FuncCmd(usartx->peripheral.register_base, UsartTxEmptyInt, Disable);
@@ -73,12 +116,51 @@ static void USARTx_tx_buffer_empty_irq(void)
 }
 
 template <uint8_t x>
-static void USARTx_tx_complete_irq(void)
+CORE_RAMFUNC static void USARTx_tx_complete_irq(void)
 {
     ASSERT_VALID_USARTx(x);
     usart_config_t *usartx = USARTx[x - 1];
 
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_TX_COMPLETE, x, 0);
+
     // disable TX and TX complete interrupts
     USART_FuncCmd(usartx->peripheral.register_base, UsartTxCmpltInt, Disable);
     USART_FuncCmd(usartx->peripheral.register_base, UsartTx, Disable);
+
+    // last stop bit was sent, start listening for the response in half-duplex mode
+    usart_half_duplex_tx_end(usartx);
+
+    // wakes up flush()
+    usartx->state.tx_active = false;
+}
+
+template <uint8_t x>
+CORE_RAMFUNC static void USARTx_tx_dma_complete_irq(void)
+{
+    ASSERT_VALID_USARTx(x);
+    usart_config_t *usartx = USARTx[x - 1];
+
+    // release sent data and start the next transfer
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_TX_DMA_COMPLETE, x, 0);
+    usart_dma_tx_complete(usartx);
+}
+
+template <uint8_t x>
+CORE_RAMFUNC static void USARTx_rx_timeout_irq(void)
+{
+    ASSERT_VALID_USARTx(x);
+    usart_config_t *usartx = USARTx[x - 1];
+
+    CORE_TRACE_EVENT(CORE_TRACE_EVENT_USART_RX_TIMEOUT, x, 0);
+
+    // stop timeout timer (restarted by the next received byte) and clear flag
+    TIMER0_Cmd(usartx->peripheral.timeout_timer.register_base, usartx->peripheral.timeout_timer.channel, Disable);
+    USART_ClearStatus(usartx->peripheral.register_base, UsartRxTimeOut);
+
+    // line went idle, make the received data available.
+    // the last byte arrived one receive timeout ago, all bytes of the block share its timestamp
+#ifdef USART_RX_TIMESTAMPS
+    usart_rx_timestamp(usartx, usartx->state.rx_timeout_us);
+#endif
+    usart_dma_rx_flush(usartx);
 }
@@ -0,0 +1,85 @@
+#include "usart_rx_framing.h"
+
+bool usart_rx_push(usart_config_t *config, const uint8_t ch)
+{
+    if (!USART_RX_FRAMING_ENABLED(config))
+    {
+        return config->state.rx_buffer->push(ch);
+    }
+
+    usart_rx_line_t &line = config->state.rx_current_line;
+    const bool is_terminator = ch == '\n' || ch == '\r';
+
+    // CRLF ends one line. the '\n' is not part of any line, so it is not even buffered
+    const bool after_cr = config->state.rx_after_cr;
+    config->state.rx_after_cr = false;
+    if (ch == '\n' && after_cr)
+    {
+        return true;
+    }
+
+    // if the line index is full, the line end cannot be recorded.
+    // drop the terminator, so the line merges with the next one
+    if (is_terminator && config->state.rx_lines->isFull())
+    {
+        line.dropped = true;
+        return false;
+    }
+
+    if (!config->state.rx_buffer->push(ch))
+    {
+        line.dropped = true;
+        return false;
+    }
+
+#ifdef USART_RX_TIMESTAMPS
+    if (line.length == 0)
+    {
+        line.start_time = config->state.rx_timestamp;
+    }
+#endif
+
+    line.length++;
+
+    // record completed line and start a new one
+    // (the line bytes are pushed before the line record, so they are available once the record is)
+    if (is_terminator)
+    {
+#ifdef USART_RX_TIMESTAMPS
+        line.end_time = config->state.rx_timestamp;
+#endif
+        config->state.rx_lines->push(line);
+        line = {};
+        config->state.rx_after_cr = ch == '\r';
+        return true;
+    }
+
+    // update checksum: XOR all bytes up to '*', then parse the decimal checksum after it
+    if (line.has_checksum)
+    {
+        if (ch >= '0' && ch <= '9')
+        {
+            line.expected_checksum = (line.expected_checksum * 10) + (ch - '0');
+        }
+    }
+    else if (ch == '*')
+    {
+        line.has_checksum = true;
+    }
+    else
+    {
+        line.checksum ^= ch;
+    }
+
+    return true;
+}
+
+void usart_rx_framing_reset(usart_config_t *config)
+{
+    if (USART_RX_FRAMING_ENABLED(config))
+    {
+        config->state.rx_lines->clear();
+        config->state.rx_current_line = {};
+        config->state.rx_after_cr = false;
+    }
+}
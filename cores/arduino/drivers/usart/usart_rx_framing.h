@@ -0,0 +1,44 @@
+#pragma once
+#include <hc32_ddl.h>
+#include "usart_config.h"
+#include "../sysclock/systick.h"
+
+/**
+ * @brief check if RX line framing is enabled in a usart configuration
+ */
+#define USART_RX_FRAMING_ENABLED(usart_config) ((usart_config)->state.rx_lines != NULL)
+
+/**
+ * @brief record the time data was received, for the next calls to usart_rx_push()
+ * @param config usart configuration
+ * @param age_us how long ago the data arrived, in microseconds
+ * @note no-op unless USART_RX_TIMESTAMPS is defined. call once per received byte or DMA block, not per pushed byte
+ */
+inline void usart_rx_timestamp(usart_config_t *config, const uint32_t age_us = 0)
+{
+#ifdef USART_RX_TIMESTAMPS
+    config->state.rx_timestamp = systick_micros() - age_us;
+#else
+    (void)config;
+    (void)age_us;
+#endif
+}
+
+/**
+ * @brief push a received byte to the rx buffer
+ * @param config usart configuration
+ * @param ch the received byte
+ * @return true if the byte was pushed, false if it was dropped
+ * @note with RX line framing enabled, line terminators ('\n' or '\r') are recorded in the line index.
+ *       a "\r\n" pair is a single terminator, the '\n' is dropped.
+ *       with USART_RX_TIMESTAMPS, the line is stamped with the time set by usart_rx_timestamp()
+ * @note must only be called by the rx producer (rx interrupt or rx dma flush)
+ */
+bool usart_rx_push(usart_config_t *config, const uint8_t ch);
+
+/**
+ * @brief reset the RX line framing state
+ * @param config usart configuration
+ * @note call whenever the rx buffer is cleared
+ */
+void usart_rx_framing_reset(usart_config_t *config);
@@ -0,0 +1,1021 @@
+#include "usb_device.h"
+#include "../irqn/irqn.h"
+#include "../../core_critical.h"
+#include "../../core_debug.h"
+#include "../../delay.h"
+#include <string.h>
+
+//
+// USBFS registers, as offsets from the register base
+//
+#define USB_GVBUSCFG 0x000ul
+#define USB_GAHBCFG 0x008ul
+#define USB_GUSBCFG 0x00Cul
+#define USB_GRSTCTL 0x010ul
+#define USB_GINTSTS 0x014ul
+#define USB_GINTMSK 0x018ul
+#define USB_GRXSTSP 0x020ul
+#define USB_GRXFSIZ 0x024ul
+#define USB_DIEPTXF0 0x028ul
+#define USB_DIEPTXF(n) (0x104ul + (((n) - 1) * 4))
+#define USB_DCFG 0x800ul
+#define USB_DCTL 0x804ul
+#define USB_DIEPMSK 0x810ul
+#define USB_DOEPMSK 0x814ul
+#define USB_DAINT 0x818ul
+#define USB_DAINTMSK 0x81Cul
+#define USB_DIEPEMPMSK 0x834ul
+#define USB_DIEPCTL(n) (0x900ul + ((n) * 0x20))
+#define USB_DIEPINT(n) (0x908ul + ((n) * 0x20))
+#define USB_DIEPTSIZ(n) (0x910ul + ((n) * 0x20))
+#define USB_DTXFSTS(n) (0x918ul + ((n) * 0x20))
+#define USB_DOEPCTL(n) (0xB00ul + ((n) * 0x20))
+#define USB_DOEPINT(n) (0xB08ul + ((n) * 0x20))
+#define USB_DOEPTSIZ(n) (0xB10ul + ((n) * 0x20))
+#define USB_GCCTL 0xE00ul
+#define USB_FIFO(n) (0x1000ul + ((n) * 0x1000))
+
+// GVBUSCFG: override VBUS sensing, so the VBUS pin is not required
+#define GVBUSCFG_VBUSOVEN (1ul << 6)
+#define GVBUSCFG_VBUSVAL (1ul << 7)
+
+// GAHBCFG
+#define GAHBCFG_GINTMSK (1ul << 0)
+
+// GUSBCFG
+#define GUSBCFG_PHYSEL (1ul << 6)
+#define GUSBCFG_TRDT_POS 10
+#define GUSBCFG_TRDT_MASK (0xFul << GUSBCFG_TRDT_POS)
+#define GUSBCFG_FHMOD (1ul << 29)
+#define GUSBCFG_FDMOD (1ul << 30)
+
+// USB turnaround time, in PHY clocks
+#define USB_TURNAROUND_TIME 9ul
+
+// GRSTCTL
+#define GRSTCTL_CSRST (1ul << 0)
+#define GRSTCTL_RXFFLSH (1ul << 4)
+#define GRSTCTL_TXFFLSH (1ul << 5)
+#define GRSTCTL_TXFNUM_ALL (0x10ul << 6)
+#define GRSTCTL_AHBIDL (1ul << 31)
+
+// GINTSTS / GINTMSK
+#define GINT_RXFLVL (1ul << 4)
+#define GINT_ESUSP (1ul << 10)
+#define GINT_USBSUSP (1ul << 11)
+#define GINT_USBRST (1ul << 12)
+#define GINT_ENUMDNE (1ul << 13)
+#define GINT_IEPINT (1ul << 18)
+#define GINT_OEPINT (1ul << 19)
+#define GINT_WKUINT (1ul << 31)
+
+// GRXSTSP
+#define GRXSTSP_EPNUM(status) ((status) & 0xFul)
+#define GRXSTSP_BCNT(status) (((status) >> 4) & 0x7FFul)
+#define GRXSTSP_PKTSTS(status) (((status) >> 17) & 0xFul)
+#define PKTSTS_OUT_DATA 0x2
+#define PKTSTS_SETUP_DATA 0x6
+
+// DCFG
+#define DCFG_DSPD_FULL_SPEED 0x3ul
+#define DCFG_DAD_POS 4
+#define DCFG_DAD_MASK (0x7Ful << DCFG_DAD_POS)
+
+// DCTL
+#define DCTL_SDIS (1ul << 1)
+#define DCTL_CGINAK (1ul << 8)
+
+// DIEPCTL / DOEPCTL
+#define DEPCTL_MPSIZ_MASK 0x7FFul
+#define DEPCTL_USBAEP (1ul << 15)
+#define DEPCTL_EPTYP_POS 18
+#define DEPCTL_STALL (1ul << 21)
+#define DEPCTL_TXFNUM_POS 22
+#define DEPCTL_CNAK (1ul << 26)
+#define DEPCTL_SNAK (1ul << 27)
+#define DEPCTL_SD0PID (1ul << 28)
+#define DEPCTL_EPDIS (1ul << 30)
+#define DEPCTL_EPENA (1ul << 31)
+
+// DIEPINT / DOEPINT
+#define DEPINT_XFRC (1ul << 0)
+#define DIEPINT_TOC (1ul << 3)
+#define DIEPINT_TXFE (1ul << 7)
+#define DOEPINT_STUP (1ul << 3)
+
+// DIEPTSIZ / DOEPTSIZ
+#define DEPTSIZ_PKTCNT_POS 19
+#define DOEPTSIZ0_STUPCNT_3 (3ul << 29)
+
+// FIFO sizes, in words. the FIFO RAM holds 320 words
+#define USB_RX_FIFO_WORDS 128
+static const uint16_t tx_fifo_words[USB_ENDPOINT_COUNT] = {32, 64, 32, 16, 16, 16};
+
+// standard requests
+#define USB_REQ_GET_STATUS 0
+#define USB_REQ_CLEAR_FEATURE 1
+#define USB_REQ_SET_FEATURE 3
+#define USB_REQ_SET_ADDRESS 5
+#define USB_REQ_GET_DESCRIPTOR 6
+#define USB_REQ_GET_CONFIGURATION 8
+#define USB_REQ_SET_CONFIGURATION 9
+#define USB_REQ_GET_INTERFACE 10
+#define USB_REQ_SET_INTERFACE 11
+
+// bmRequestType fields
+#define USB_REQ_TYPE(setup) (((setup).bmRequestType >> 5) & 0x3)
+#define USB_REQ_TYPE_STANDARD 0
+#define USB_REQ_RECIPIENT(setup) ((setup).bmRequestType & 0x1F)
+#define USB_REQ_RECIPIENT_ENDPOINT 2
+
+// descriptor types
+#define USB_DESC_DEVICE 1
+#define USB_DESC_CONFIGURATION 2
+#define USB_DESC_STRING 3
+
+// feature selector of ENDPOINT_HALT
+#define USB_FEATURE_ENDPOINT_HALT 0
+
+/**
+ * @brief transfer state of an endpoint
+ */
+struct endpoint_state_t
+{
+    uint8_t *buffer;
+    size_t length;
+
+    /**
+     * @brief number of bytes written to the FIFO (IN) or received (OUT)
+     */
+    size_t done;
+
+    uint16_t max_packet_size;
+    volatile bool busy;
+};
+
+/**
+ * @brief stages of a control transfer on endpoint 0
+ */
+enum ep0_stage_t
+{
+    EP0_IDLE,
+    EP0_DATA_IN,
+    EP0_DATA_OUT,
+    EP0_STATUS_IN,
+    EP0_STATUS_OUT,
+};
+
+static endpoint_state_t in_endpoints[USB_ENDPOINT_COUNT] = {};
+static endpoint_state_t out_endpoints[USB_ENDPOINT_COUNT] = {};
+
+static const usb_class_t *device_class = NULL;
+static IRQn_Type usb_irqn;
+static volatile uint8_t configuration = 0;
+
+//
+// endpoint 0 state
+//
+static ep0_stage_t ep0_stage = EP0_IDLE;
+static usb_setup_packet_t setup;
+static uint32_t setup_words[2];
+
+/**
+ * @brief remaining data of the IN data stage
+ */
+static const uint8_t *ep0_data;
+static size_t ep0_remaining;
+static bool ep0_send_zlp;
+
+/**
+ * @brief receive buffer of the OUT data stage, set by the class
+ */
+static uint8_t *ep0_out_data;
+
+/**
+ * @brief buffer for descriptors and replies built at runtime
+ */
+static uint8_t ep0_buffer[USB_EP0_SIZE];
+
+static inline volatile uint32_t &reg(const uint32_t offset)
+{
+    return *reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_USBFS) + offset);
+}
+
+//
+// FIFO access
+//
+
+static void fifo_write(const uint8_t ep, const uint8_t *data, size_t length)
+{
+    volatile uint32_t &fifo = reg(USB_FIFO(ep));
+    for (; length >= 4; length -= 4, data += 4)
+    {
+        uint32_t word;
+        memcpy(&word, data, 4);
+        fifo = word;
+    }
+
+    if (length > 0)
+    {
+        uint32_t word = 0;
+        memcpy(&word, data, length);
+        fifo = word;
+    }
+}
+
+/**
+ * @brief read a packet from the RX FIFO
+ * @param data where to store the packet. bytes beyond capacity are discarded
+ */
+static void fifo_read(uint8_t *data, const size_t capacity, const size_t length)
+{
+    volatile uint32_t &fifo = reg(USB_FIFO(0));
+    for (size_t i = 0; i < length; i += 4)
+    {
+        const uint32_t word = fifo;
+        if (i < capacity)
+        {
+            const size_t left = capacity - i;
+            memcpy(data + i, &word, left < 4 ? left : 4);
+        }
+    }
+}
+
+static void fifo_flush(void)
+{
+    reg(USB_GRSTCTL) = GRSTCTL_TXFFLSH | GRSTCTL_TXFNUM_ALL;
+    while ((reg(USB_GRSTCTL) & GRSTCTL_TXFFLSH) != 0)
+        ;
+
+    reg(USB_GRSTCTL) = GRSTCTL_RXFFLSH;
+    while ((reg(USB_GRSTCTL) & GRSTCTL_RXFFLSH) != 0)
+        ;
+}
+
+//
+// endpoint transfers
+//
+
+/**
+ * @brief start an IN transfer. the FIFO is filled from the TX FIFO empty interrupt
+ */
+static void in_start(const uint8_t ep, const uint8_t *data, const size_t length)
+{
+    endpoint_state_t &state = in_endpoints[ep];
+    state.buffer = const_cast<uint8_t *>(data);
+    state.length = length;
+    state.done = 0;
+    state.busy = true;
+
+    const uint32_t packets = length == 0 ? 1 : ((length + state.max_packet_size - 1) / state.max_packet_size);
+    reg(USB_DIEPTSIZ(ep)) = (packets << DEPTSIZ_PKTCNT_POS) | length;
+    reg(USB_DIEPCTL(ep)) |= DEPCTL_CNAK | DEPCTL_EPENA;
+
+    if (length > 0)
+    {
+        reg(USB_DIEPEMPMSK) |= (1ul << ep);
+    }
+}
+
+/**
+ * @brief write as many packets of the IN transfer to the FIFO as fit
+ */
+static void in_fill_fifo(const uint8_t ep)
+{
+    endpoint_state_t &state = in_endpoints[ep];
+    while (state.done < state.length)
+    {
+        const size_t left = state.length - state.done;
+        const size_t packet = left < state.max_packet_size ? left : state.max_packet_size;
+        if ((reg(USB_DTXFSTS(ep)) & 0xFFFFul) < ((packet + 3) / 4))
+        {
+            return;
+        }
+
+        fifo_write(ep, state.buffer + state.done, packet);
+        state.done += packet;
+    }
+
+    reg(USB_DIEPEMPMSK) &= ~(1ul << ep);
+}
+
+/**
+ * @brief start an OUT transfer
+ */
+static void out_start(const uint8_t ep, uint8_t *data, const size_t length)
+{
+    endpoint_state_t &state = out_endpoints[ep];
+    state.buffer = data;
+    state.length = length;
+    state.done = 0;
+    state.busy = true;
+
+    const uint32_t packets = length == 0 ? 1 : ((length + state.max_packet_size - 1) / state.max_packet_size);
+    reg(USB_DOEPTSIZ(ep)) = (packets << DEPTSIZ_PKTCNT_POS) | (packets * state.max_packet_size) | (ep == 0 ? DOEPTSIZ0_STUPCNT_3 : 0ul);
+    reg(USB_DOEPCTL(ep)) |= DEPCTL_CNAK | DEPCTL_EPENA;
+}
+
+//
+// endpoint 0 control transfers
+//
+
+/**
+ * @brief allow endpoint 0 to receive the next setup packet
+ */
+static void ep0_prepare_setup(void)
+{
+    ep0_stage = EP0_IDLE;
+    reg(USB_DOEPTSIZ(0)) = DOEPTSIZ0_STUPCNT_3 | (1ul << DEPTSIZ_PKTCNT_POS) | (3 * sizeof(usb_setup_packet_t));
+}
+
+static void ep0_stall(void)
+{
+    reg(USB_DIEPCTL(0)) |= DEPCTL_STALL;
+    reg(USB_DOEPCTL(0)) |= DEPCTL_STALL;
+    ep0_prepare_setup();
+}
+
+/**
+ * @brief send the next packet of the IN data stage, or start the status stage
+ */
+static void ep0_continue_in(void)
+{
+    if (ep0_remaining > 0 || ep0_send_zlp)
+    {
+        const size_t packet = ep0_remaining < USB_EP0_SIZE ? ep0_remaining : USB_EP0_SIZE;
+        if (packet == 0)
+        {
+            ep0_send_zlp = false;
+        }
+
+        in_start(0, ep0_data, packet);
+        ep0_data += packet;
+        ep0_remaining -= packet;
+        return;
+    }
+
+    // the host acknowledges with a zero-length OUT packet
+    ep0_stage = EP0_STATUS_OUT;
+    out_start(0, ep0_buffer, 0);
+}
+
+static void ep0_send(const uint8_t *data, const size_t length)
+{
+    // a reply shorter than requested ends with a short packet, which may have to be a zero-length packet
+    ep0_data = data;
+    ep0_remaining = length < setup.wLength ? length : setup.wLength;
+    ep0_send_zlp = ep0_remaining < setup.wLength && (ep0_remaining % USB_EP0_SIZE) == 0;
+    ep0_stage = EP0_DATA_IN;
+    ep0_continue_in();
+}
+
+static void ep0_send_status(void)
+{
+    ep0_stage = EP0_STATUS_IN;
+    in_start(0, NULL, 0);
+}
+
+/**
+ * @brief build a string descriptor in ep0_buffer
+ * @return length of the descriptor, 0 if there is no such string
+ */
+static size_t build_string_descriptor(const uint8_t index)
+{
+    if (index == 0)
+    {
+        // language: english (US)
+        ep0_buffer[0] = 4;
+        ep0_buffer[1] = USB_DESC_STRING;
+        ep0_buffer[2] = 0x09;
+        ep0_buffer[3] = 0x04;
+        return 4;
+    }
+
+    if (index > device_class->string_count || device_class->strings[index - 1] == NULL)
+    {
+        return 0;
+    }
+
+    // ASCII to UTF-16LE, truncated to fit the buffer
+    const char *string = device_class->strings[index - 1];
+    size_t length = 2;
+    for (; *string != '\0' && length + 2 <= sizeof(ep0_buffer); string++, length += 2)
+    {
+        ep0_buffer[length] = uint8_t(*string);
+        ep0_buffer[length + 1] = 0;
+    }
+
+    ep0_buffer[0] = uint8_t(length);
+    ep0_buffer[1] = USB_DESC_STRING;
+    return length;
+}
+
+/**
+ * @brief deactivate all endpoints except endpoint 0
+ */
+static void close_endpoints(void)
+{
+    for (uint8_t ep = 1; ep < USB_ENDPOINT_COUNT; ep++)
+    {
+        reg(USB_DIEPCTL(ep)) = (reg(USB_DIEPCTL(ep)) & DEPCTL_EPENA) != 0 ? (DEPCTL_EPDIS | DEPCTL_SNAK) : 0ul;
+        reg(USB_DOEPCTL(ep)) = (reg(USB_DOEPCTL(ep)) & DEPCTL_EPENA) != 0 ? (DEPCTL_EPDIS | DEPCTL_SNAK) : 0ul;
+        in_endpoints[ep].busy = false;
+        out_endpoints[ep].busy = false;
+    }
+
+    reg(USB_DAINTMSK) = (1ul << 0) | (1ul << 16);
+    reg(USB_DIEPEMPMSK) = 0;
+}
+
+static void set_configuration(const uint8_t value)
+{
+    if (value == configuration)
+    {
+        return;
+    }
+
+    if (configuration != 0)
+    {
+        configuration = 0;
+        close_endpoints();
+        if (device_class->set_configuration != NULL)
+        {
+            device_class->set_configuration(false);
+        }
+    }
+
+    if (value != 0)
+    {
+        configuration = value;
+        if (device_class->set_configuration != NULL)
+        {
+            device_class->set_configuration(true);
+        }
+    }
+}
+
+/**
+ * @brief handle a standard request
+ * @return false to stall
+ */
+static bool handle_standard_request(void)
+{
+    switch (setup.bRequest)
+    {
+    case USB_REQ_GET_STATUS:
+        ep0_buffer[0] = 0;
+        ep0_buffer[1] = 0;
+        if (USB_REQ_RECIPIENT(setup) == USB_REQ_RECIPIENT_ENDPOINT)
+        {
+            const uint8_t ep = setup.wIndex & 0x0F;
+            const uint32_t ctl = (setup.wIndex & USB_DIR_IN) != 0 ? reg(USB_DIEPCTL(ep)) : reg(USB_DOEPCTL(ep));
+            ep0_buffer[0] = (ctl & DEPCTL_STALL) != 0 ? 1 : 0;
+        }
+        ep0_send(ep0_buffer, 2);
+        return true;
+
+    case USB_REQ_CLEAR_FEATURE:
+    case USB_REQ_SET_FEATURE:
+        if (USB_REQ_RECIPIENT(setup) == USB_REQ_RECIPIENT_ENDPOINT && setup.wValue == USB_FEATURE_ENDPOINT_HALT)
+        {
+            const uint8_t ep = setup.wIndex & 0x0F;
+            if (ep == 0 || ep >= USB_ENDPOINT_COUNT)
+            {
+                return ep == 0;
+            }
+
+            volatile uint32_t &ctl = (setup.wIndex & USB_DIR_IN) != 0 ? reg(USB_DIEPCTL(ep)) : reg(USB_DOEPCTL(ep));
+            if (setup.bRequest == USB_REQ_SET_FEATURE)
+            {
+                ctl |= DEPCTL_STALL;
+            }
+            else
+            {
+                // clearing the halt also resets the data toggle
+                ctl = (ctl & ~DEPCTL_STALL) | DEPCTL_SD0PID;
+            }
+        }
+
+        // remote wakeup is not supported, ignore it
+        ep0_send_status();
+        return true;
+
+    case USB_REQ_SET_ADDRESS:
+        // the address is applied by the controller after the status stage
+        reg(USB_DCFG) = (reg(USB_DCFG) & ~DCFG_DAD_MASK) | ((uint32_t(setup.wValue) & 0x7F) << DCFG_DAD_POS);
+        ep0_send_status();
+        return true;
+
+    case USB_REQ_GET_DESCRIPTOR:
+    {
+        const uint8_t type = setup.wValue >> 8;
+        const uint8_t index = setup.wValue & 0xFF;
+        switch (type)
+        {
+        case USB_DESC_DEVICE:
+            ep0_send(device_class->device_descriptor, device_class->device_descriptor[0]);
+            return true;
+        case USB_DESC_CONFIGURATION:
+            ep0_send(device_class->configuration_descriptor, device_class->configuration_descriptor_length);
+            return true;
+        case USB_DESC_STRING:
+        {
+            const size_t length = build_string_descriptor(index);
+            if (length == 0)
+            {
+                return false;
+            }
+
+            ep0_send(ep0_buffer, length);
+            return true;
+        }
+        default:
+            // e.g. the device qualifier, which full-speed only devices don't have
+            return false;
+        }
+    }
+
+    case USB_REQ_GET_CONFIGURATION:
+        ep0_buffer[0] = configuration;
+        ep0_send(ep0_buffer, 1);
+        return true;
+
+    case USB_REQ_SET_CONFIGURATION:
+        if (setup.wValue > 1)
+        {
+            return false;
+        }
+
+        set_configuration(uint8_t(setup.wValue));
+        ep0_send_status();
+        return true;
+
+    case USB_REQ_GET_INTERFACE:
+        ep0_buffer[0] = 0;
+        ep0_send(ep0_buffer, 1);
+        return true;
+
+    case USB_REQ_SET_INTERFACE:
+        // only alternate setting 0 exists
+        if (setup.wValue != 0)
+        {
+            return false;
+        }
+        ep0_send_status();
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+static void handle_setup(void)
+{
+    memcpy(&setup, setup_words, sizeof(setup));
+
+    // a new setup packet aborts a running control transfer
+    in_endpoints[0].busy = false;
+    out_endpoints[0].busy = false;
+    reg(USB_DIEPEMPMSK) &= ~1ul;
+
+    if (USB_REQ_TYPE(setup) == USB_REQ_TYPE_STANDARD)
+    {
+        if (!handle_standard_request())
+        {
+            ep0_stall();
+        }
+        return;
+    }
+
+    // class and vendor requests
+    uint8_t *data = NULL;
+    uint16_t length = 0;
+    if (device_class->control_request == NULL || !device_class->control_request(setup, data, length))
+    {
+        ep0_stall();
+        return;
+    }
+
+    if (setup.wLength == 0)
+    {
+        ep0_send_status();
+    }
+    else if ((setup.bmRequestType & USB_DIR_IN) != 0)
+    {
+        ep0_send(data, length);
+    }
+    else
+    {
+        ep0_out_data = data;
+        ep0_remaining = setup.wLength;
+        ep0_stage = EP0_DATA_OUT;
+        out_start(0, data, setup.wLength < USB_EP0_SIZE ? setup.wLength : USB_EP0_SIZE);
+    }
+}
+
+static void ep0_in_complete(void)
+{
+    switch (ep0_stage)
+    {
+    case EP0_DATA_IN:
+        ep0_continue_in();
+        break;
+    case EP0_STATUS_IN:
+        ep0_prepare_setup();
+        break;
+    default:
+        break;
+    }
+}
+
+static void ep0_out_complete(void)
+{
+    switch (ep0_stage)
+    {
+    case EP0_DATA_OUT:
+    {
+        // the OUT data stage is received in packets of at most USB_EP0_SIZE bytes
+        const size_t received = out_endpoints[0].done;
+        ep0_remaining = received < ep0_remaining ? ep0_remaining - received : 0;
+        if (ep0_remaining > 0 && received == USB_EP0_SIZE)
+        {
+            uint8_t *next = out_endpoints[0].buffer + received;
+            out_start(0, next, ep0_remaining < USB_EP0_SIZE ? ep0_remaining : USB_EP0_SIZE);
+            return;
+        }
+
+        if (device_class->control_out_complete != NULL)
+        {
+            device_class->control_out_complete(setup, ep0_out_data);
+        }
+        ep0_send_status();
+        break;
+    }
+    case EP0_STATUS_OUT:
+        ep0_prepare_setup();
+        break;
+    default:
+        break;
+    }
+}
+
+//
+// interrupt handling
+//
+
+static void handle_reset(void)
+{
+    fifo_flush();
+    for (uint8_t ep = 0; ep < USB_ENDPOINT_COUNT; ep++)
+    {
+        reg(USB_DIEPINT(ep)) = 0xFFFFFFFFul;
+        reg(USB_DOEPINT(ep)) = 0xFFFFFFFFul;
+        in_endpoints[ep].busy = false;
+        out_endpoints[ep].busy = false;
+    }
+
+    close_endpoints();
+    reg(USB_DOEPCTL(0)) |= DEPCTL_SNAK;
+    reg(USB_DOEPMSK) = DEPINT_XFRC | DOEPINT_STUP;
+    reg(USB_DIEPMSK) = DEPINT_XFRC | DIEPINT_TOC;
+    reg(USB_DCFG) &= ~DCFG_DAD_MASK;
+
+    in_endpoints[0].max_packet_size = USB_EP0_SIZE;
+    out_endpoints[0].max_packet_size = USB_EP0_SIZE;
+
+    if (configuration != 0)
+    {
+        configuration = 0;
+        if (device_class->set_configuration != NULL)
+        {
+            device_class->set_configuration(false);
+        }
+    }
+
+    ep0_prepare_setup();
+}
+
+static void handle_enumeration_done(void)
+{
+    // MPSIZ of endpoint 0 is encoded, 0 is 64 bytes
+    reg(USB_DIEPCTL(0)) &= ~0x3ul;
+    reg(USB_DCTL) |= DCTL_CGINAK;
+}
+
+static void handle_rx_fifo(void)
+{
+    const uint32_t status = reg(USB_GRXSTSP);
+    const uint8_t ep = GRXSTSP_EPNUM(status);
+    const size_t count = GRXSTSP_BCNT(status);
+
+    switch (GRXSTSP_PKTSTS(status))
+    {
+    case PKTSTS_SETUP_DATA:
+        fifo_read(reinterpret_cast<uint8_t *>(setup_words), sizeof(setup_words), count);
+        break;
+
+    case PKTSTS_OUT_DATA:
+        if (count > 0)
+        {
+            endpoint_state_t &state = out_endpoints[ep];
+            const size_t capacity = state.done < state.length ? state.length - state.done : 0;
+            fifo_read(state.buffer + state.done, capacity, count);
+            state.done += count < capacity ? count : capacity;
+        }
+        break;
+
+    default:
+        // transfer and setup stage complete are signalled by the endpoint interrupts as well
+        break;
+    }
+}
+
+static void handle_out_endpoints(void)
+{
+    const uint32_t pending = (reg(USB_DAINT) & reg(USB_DAINTMSK)) >> 16;
+    for (uint8_t ep = 0; ep < USB_ENDPOINT_COUNT; ep++)
+    {
+        if ((pending & (1ul << ep)) == 0)
+        {
+            continue;
+        }
+
+        const uint32_t flags = reg(USB_DOEPINT(ep)) & reg(USB_DOEPMSK);
+        reg(USB_DOEPINT(ep)) = flags;
+
+        if ((flags & DEPINT_XFRC) != 0)
+        {
+            out_endpoints[ep].busy = false;
+            if (ep == 0)
+            {
+                ep0_out_complete();
+            }
+            else if (device_class->receive_complete != NULL)
+            {
+                device_class->receive_complete(ep, out_endpoints[ep].done);
+            }
+        }
+
+        if ((flags & DOEPINT_STUP) != 0)
+        {
+            handle_setup();
+        }
+    }
+}
+
+static void handle_in_endpoints(void)
+{
+    const uint32_t pending = reg(USB_DAINT) & reg(USB_DAINTMSK) & 0xFFFFul;
+    for (uint8_t ep = 0; ep < USB_ENDPOINT_COUNT; ep++)
+    {
+        if ((pending & (1ul << ep)) == 0)
+        {
+            continue;
+        }
+
+        const uint32_t fifo_empty_mask = (reg(USB_DIEPEMPMSK) & (1ul << ep)) != 0 ? DIEPINT_TXFE : 0ul;
+        const uint32_t flags = reg(USB_DIEPINT(ep)) & (reg(USB_DIEPMSK) | fifo_empty_mask);
+
+        if ((flags & DEPINT_XFRC) != 0)
+        {
+            reg(USB_DIEPINT(ep)) = DEPINT_XFRC;
+            reg(USB_DIEPEMPMSK) &= ~(1ul << ep);
+            in_endpoints[ep].busy = false;
+            if (ep == 0)
+            {
+                ep0_in_complete();
+            }
+            else if (device_class->transmit_complete != NULL)
+            {
+                device_class->transmit_complete(ep);
+            }
+        }
+
+        if ((flags & DIEPINT_TOC) != 0)
+        {
+            reg(USB_DIEPINT(ep)) = DIEPINT_TOC;
+        }
+
+        // TXFE is a status flag, it clears once the FIFO is filled
+        if ((flags & DIEPINT_TXFE) != 0)
+        {
+            in_fill_fifo(ep);
+        }
+    }
+}
+
+static void usb_irq_handler(void)
+{
+    const uint32_t status = reg(USB_GINTSTS) & reg(USB_GINTMSK);
+
+    if ((status & GINT_USBRST) != 0)
+    {
+        reg(USB_GINTSTS) = GINT_USBRST;
+        handle_reset();
+    }
+
+    if ((status & GINT_ENUMDNE) != 0)
+    {
+        reg(USB_GINTSTS) = GINT_ENUMDNE;
+        handle_enumeration_done();
+    }
+
+    // the RX FIFO is read until empty, so transfer complete flags see all data of the transfer
+    while ((reg(USB_GINTSTS) & GINT_RXFLVL) != 0)
+    {
+        handle_rx_fifo();
+    }
+
+    if ((status & GINT_OEPINT) != 0)
+    {
+        handle_out_endpoints();
+    }
+
+    if ((status & GINT_IEPINT) != 0)
+    {
+        handle_in_endpoints();
+    }
+
+    if ((status & GINT_USBSUSP) != 0)
+    {
+        reg(USB_GINTSTS) = GINT_USBSUSP | GINT_ESUSP;
+        if (device_class->suspend != NULL)
+        {
+            device_class->suspend(true);
+        }
+    }
+
+    if ((status & GINT_WKUINT) != 0)
+    {
+        reg(USB_GINTSTS) = GINT_WKUINT;
+        if (device_class->suspend != NULL)
+        {
+            device_class->suspend(false);
+        }
+    }
+}
+
+//
+// public API
+//
+
+void usb_device_begin(const usb_class_t *usb_class)
+{
+    CORE_ASSERT(usb_class != NULL, "usb_device_begin: usb_class is NULL", return);
+    CORE_ASSERT(device_class == NULL, "usb_device_begin: already started", return);
+    device_class = usb_class;
+
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_USBFS, Enable);
+
+    // D- (PA11) and D+ (PA12) are analog pins of the internal PHY
+    stc_port_init_t pin_config = {};
+    pin_config.enPinMode = Pin_Mode_Ana;
+    PORT_Init(PortA, Pin11 | Pin12, &pin_config);
+
+    // core soft reset, with the internal full-speed PHY selected
+    reg(USB_GUSBCFG) |= GUSBCFG_PHYSEL;
+    while ((reg(USB_GRSTCTL) & GRSTCTL_AHBIDL) == 0)
+        ;
+    reg(USB_GRSTCTL) |= GRSTCTL_CSRST;
+    while ((reg(USB_GRSTCTL) & GRSTCTL_CSRST) != 0)
+        ;
+
+    // force device mode. the mode change takes up to 25 ms
+    reg(USB_GVBUSCFG) = GVBUSCFG_VBUSOVEN | GVBUSCFG_VBUSVAL;
+    reg(USB_GUSBCFG) = (reg(USB_GUSBCFG) & ~(GUSBCFG_FHMOD | GUSBCFG_TRDT_MASK)) | GUSBCFG_FDMOD | (USB_TURNAROUND_TIME << GUSBCFG_TRDT_POS);
+    delay(25);
+
+    // stay disconnected while configuring
+    reg(USB_GCCTL) = 0;
+    reg(USB_DCTL) |= DCTL_SDIS;
+    reg(USB_DCFG) = (reg(USB_DCFG) & ~0x3ul) | DCFG_DSPD_FULL_SPEED;
+
+    // FIFO layout: RX FIFO, then the TX FIFOs of IN endpoint 0 - 5
+    uint32_t fifo_start = USB_RX_FIFO_WORDS;
+    reg(USB_GRXFSIZ) = USB_RX_FIFO_WORDS;
+    reg(USB_DIEPTXF0) = (uint32_t(tx_fifo_words[0]) << 16) | fifo_start;
+    fifo_start += tx_fifo_words[0];
+    for (uint8_t ep = 1; ep < USB_ENDPOINT_COUNT; ep++)
+    {
+        reg(USB_DIEPTXF(ep)) = (uint32_t(tx_fifo_words[ep]) << 16) | fifo_start;
+        fifo_start += tx_fifo_words[ep];
+    }
+    fifo_flush();
+
+    reg(USB_DIEPMSK) = 0;
+    reg(USB_DOEPMSK) = 0;
+    reg(USB_DAINTMSK) = 0;
+    reg(USB_DIEPEMPMSK) = 0;
+    reg(USB_GINTSTS) = 0xFFFFFFFFul;
+    reg(USB_GINTMSK) = GINT_RXFLVL | GINT_USBSUSP | GINT_USBRST | GINT_ENUMDNE | GINT_IEPINT | GINT_OEPINT | GINT_WKUINT;
+
+    // TX FIFO empty interrupts fire once the FIFO is half empty, so the next packets are written while one is sent
+    reg(USB_GAHBCFG) = GAHBCFG_GINTMSK;
+
+    irqn_aa_get(usb_irqn, "USBFS");
+    stc_irq_regi_conf_t irq_config = {
+        .enIntSrc = INT_USBFS_GLB,
+        .enIRQn = usb_irqn,
+        .pfnCallback = usb_irq_handler,
+    };
+    enIrqRegistration(&irq_config);
+    NVIC_ClearPendingIRQ(usb_irqn);
+    NVIC_SetPriority(usb_irqn, IRQ_PRIORITY_USB);
+    NVIC_EnableIRQ(usb_irqn);
+
+    // connect
+    reg(USB_DCTL) &= ~DCTL_SDIS;
+}
+
+void usb_device_end(void)
+{
+    if (device_class == NULL)
+    {
+        return;
+    }
+
+    reg(USB_DCTL) |= DCTL_SDIS;
+    reg(USB_GAHBCFG) = 0;
+
+    NVIC_DisableIRQ(usb_irqn);
+    NVIC_ClearPendingIRQ(usb_irqn);
+    enIrqResign(usb_irqn);
+    irqn_aa_resign(usb_irqn, "USBFS");
+
+    set_configuration(0);
+    PWC_Fcg1PeriphClockCmd(PWC_FCG1_PERIPH_USBFS, Disable);
+    device_class = NULL;
+}
+
+bool usb_device_configured(void)
+{
+    return configuration != 0;
+}
+
+void usb_device_open_endpoint(const uint8_t address, const usb_endpoint_type_t type, const uint16_t max_packet_size)
+{
+    const uint8_t ep = address & 0x0F;
+    CORE_ASSERT(ep > 0 && ep < USB_ENDPOINT_COUNT, "usb_device_open_endpoint: invalid endpoint", return);
+    CORE_ASSERT(max_packet_size > 0 && max_packet_size <= 64, "usb_device_open_endpoint: invalid packet size", return);
+
+    const uint32_t ctl = DEPCTL_USBAEP | DEPCTL_SD0PID | (uint32_t(type) << DEPCTL_EPTYP_POS) | (max_packet_size & DEPCTL_MPSIZ_MASK);
+    if ((address & USB_DIR_IN) != 0)
+    {
+        in_endpoints[ep].max_packet_size = max_packet_size;
+        in_endpoints[ep].busy = false;
+        reg(USB_DIEPCTL(ep)) = ctl | (uint32_t(ep) << DEPCTL_TXFNUM_POS);
+        reg(USB_DAINTMSK) |= (1ul << ep);
+    }
+    else
+    {
+        out_endpoints[ep].max_packet_size = max_packet_size;
+        out_endpoints[ep].busy = false;
+        reg(USB_DOEPCTL(ep)) = ctl;
+        reg(USB_DAINTMSK) |= (1ul << (16 + ep));
+    }
+}
+
+bool usb_device_transmit(const uint8_t ep, const uint8_t *data, const size_t length)
+{
+    if (ep == 0 || ep >= USB_ENDPOINT_COUNT || configuration == 0)
+    {
+        return false;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    const bool start = !in_endpoints[ep].busy;
+    if (start)
+    {
+        in_start(ep, data, length);
+    }
+    core_critical_exit(critical);
+    return start;
+}
+
+bool usb_device_receive(const uint8_t ep, uint8_t *data, const size_t length)
+{
+    if (ep == 0 || ep >= USB_ENDPOINT_COUNT || configuration == 0)
+    {
+        return false;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    const bool start = !out_endpoints[ep].busy;
+    if (start)
+    {
+        out_start(ep, data, length);
+    }
+    core_critical_exit(critical);
+    return start;
+}
+
+bool usb_device_endpoint_busy(const uint8_t address)
+{
+    const uint8_t ep = address & 0x0F;
+    if (ep >= USB_ENDPOINT_COUNT)
+    {
+        return false;
+    }
+
+    return (address & USB_DIR_IN) != 0 ? in_endpoints[ep].busy : out_endpoints[ep].busy;
+}
@@ -0,0 +1,178 @@
+/**
+ * USB full-speed device driver for the USBFS controller:
+ *
+ * handles enumeration on endpoint 0 (standard requests, descriptors) and moves data of the other endpoints.
+ * everything specific to a device class (descriptors, class requests, endpoint use) is provided by a usb_class_t,
+ * e.g. the CDC-ACM class of usb_serial.h.
+ *
+ * the controller runs in slave mode: packets are copied between the endpoint FIFOs and memory by the USB interrupt.
+ * the IN FIFOs hold multiple packets, so the host can read the next packet while the current one is acknowledged.
+ *
+ * the USB clock (UCLK) must be 48 MHz, e.g. set up in core_hook_sysclock_init() using UPLL and
+ * CLK_SetUsbClkSource(). the D+ / D- pins are PA12 / PA11.
+ */
+#pragma once
+#include <hc32_ddl.h>
+#include <stddef.h>
+
+/**
+ * @brief maximum packet size of endpoint 0
+ */
+#define USB_EP0_SIZE 64
+
+/**
+ * @brief number of endpoints of the controller, including endpoint 0
+ */
+#define USB_ENDPOINT_COUNT 6
+
+/**
+ * @brief direction bit of an endpoint address
+ */
+#define USB_DIR_IN 0x80
+
+/**
+ * @brief a setup packet, as received on endpoint 0
+ */
+struct __attribute__((packed)) usb_setup_packet_t
+{
+    uint8_t bmRequestType;
+    uint8_t bRequest;
+    uint16_t wValue;
+    uint16_t wIndex;
+    uint16_t wLength;
+};
+
+/**
+ * @brief endpoint transfer types
+ */
+typedef enum usb_endpoint_type_t
+{
+    USB_ENDPOINT_CONTROL = 0,
+    USB_ENDPOINT_ISOCHRONOUS = 1,
+    USB_ENDPOINT_BULK = 2,
+    USB_ENDPOINT_INTERRUPT = 3,
+} usb_endpoint_type_t;
+
+/**
+ * @brief a device class, implemented on top of the device driver
+ * @note all callbacks are called from the USB interrupt. callbacks may be NULL
+ */
+struct usb_class_t
+{
+    /**
+     * @brief the device descriptor
+     */
+    const uint8_t *device_descriptor;
+
+    /**
+     * @brief the configuration descriptor, with all interface and endpoint descriptors
+     */
+    const uint8_t *configuration_descriptor;
+    uint16_t configuration_descriptor_length;
+
+    /**
+     * @brief string descriptors 1 - string_count, as ASCII strings. string 0 (language) is provided by the driver
+     */
+    const char *const *strings;
+    uint8_t string_count;
+
+    /**
+     * @brief the host selected the configuration, or the device was reset or deconfigured
+     * @param configured true if the configuration is now active. endpoints are configured from here
+     */
+    void (*set_configuration)(const bool configured);
+
+    /**
+     * @brief handle a class or vendor request
+     * @param setup the request
+     * @param data for requests with an IN data stage, set to the data to send. for requests with an OUT data stage,
+     *             set to a buffer of at least setup.wLength bytes to receive into
+     * @param length number of bytes to send. ignored for OUT requests
+     * @return false to stall the request
+     */
+    bool (*control_request)(const usb_setup_packet_t &setup, uint8_t *&data, uint16_t &length);
+
+    /**
+     * @brief the OUT data stage of a class or vendor request completed
+     * @param setup the request
+     * @param data the buffer set by control_request()
+     */
+    void (*control_out_complete)(const usb_setup_packet_t &setup, const uint8_t *data);
+
+    /**
+     * @brief a transfer started with usb_device_transmit() was sent completely
+     * @param ep endpoint number, without the direction bit
+     */
+    void (*transmit_complete)(const uint8_t ep);
+
+    /**
+     * @brief a transfer started with usb_device_receive() completed
+     * @param ep endpoint number
+     * @param length number of bytes received. less than requested if the host sent a short packet
+     */
+    void (*receive_complete)(const uint8_t ep, const size_t length);
+
+    /**
+     * @brief the bus was suspended or resumed
+     */
+    void (*suspend)(const bool suspended);
+};
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief start the USB device, and connect to the host
+     * @param usb_class the device class. must stay valid until usb_device_end()
+     * @note enables the USBFS clock, configures PA11 / PA12, and registers the USB interrupt
+     */
+    void usb_device_begin(const usb_class_t *usb_class);
+
+    /**
+     * @brief disconnect from the host, and stop the USB device
+     */
+    void usb_device_end(void);
+
+    /**
+     * @brief is the device configured by the host?
+     */
+    bool usb_device_configured(void);
+
+    /**
+     * @brief configure and activate an endpoint of the active configuration
+     * @param address endpoint address, with USB_DIR_IN for IN endpoints
+     * @param type the transfer type
+     * @param max_packet_size maximum packet size, at most 64
+     * @note call from usb_class_t::set_configuration(). IN endpoint n uses TX FIFO n
+     */
+    void usb_device_open_endpoint(const uint8_t address, const usb_endpoint_type_t type, const uint16_t max_packet_size);
+
+    /**
+     * @brief send data on an IN endpoint
+     * @param ep endpoint number, without the direction bit
+     * @param data the data. must stay valid until transmit_complete is called
+     * @param length number of bytes. may be 0 to send a zero-length packet
+     * @return false if the endpoint is busy or not configured
+     */
+    bool usb_device_transmit(const uint8_t ep, const uint8_t *data, const size_t length);
+
+    /**
+     * @brief receive data on an OUT endpoint
+     * @param ep endpoint number
+     * @param data the buffer to receive into. must stay valid until receive_complete is called
+     * @param length size of the buffer. should be a multiple of the maximum packet size
+     * @return false if the endpoint is busy or not configured
+     */
+    bool usb_device_receive(const uint8_t ep, uint8_t *data, const size_t length);
+
+    /**
+     * @brief is a transfer running on an endpoint?
+     * @param address endpoint address, with USB_DIR_IN for IN endpoints
+     */
+    bool usb_device_endpoint_busy(const uint8_t address);
+
+#ifdef __cplusplus
+}
+#endif
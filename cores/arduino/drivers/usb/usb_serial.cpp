@@ -0,0 +1,425 @@
+#include "usb_serial.h"
+#include "usb_device.h"
+#include "../../RingBuffer.h"
+#include "../../core_critical.h"
+#include "../../yield.h"
+#include <stdio.h>
+
+// endpoints
+#define CDC_EP_DATA 1         // bulk IN and OUT
+#define CDC_EP_NOTIFICATION 2 // interrupt IN
+#define CDC_DATA_PACKET_SIZE 64
+#define CDC_NOTIFICATION_PACKET_SIZE 16
+
+// CDC class requests
+#define CDC_SET_LINE_CODING 0x20
+#define CDC_GET_LINE_CODING 0x21
+#define CDC_SET_CONTROL_LINE_STATE 0x22
+#define CDC_SEND_BREAK 0x23
+
+// SET_CONTROL_LINE_STATE bits
+#define CDC_CONTROL_DTR (1u << 0)
+#define CDC_CONTROL_RTS (1u << 1)
+
+// the IN transfer size is limited by the 10-bit packet count
+#define CDC_MAX_TRANSFER_SIZE (1023 * CDC_DATA_PACKET_SIZE)
+
+static_assert(USB_CDC_RX_BUFFER_SIZE >= CDC_DATA_PACKET_SIZE, "USB_CDC_RX_BUFFER_SIZE must hold at least one packet");
+
+/**
+ * @brief line coding, as sent by SET_LINE_CODING and GET_LINE_CODING
+ */
+struct __attribute__((packed)) cdc_line_coding_t
+{
+    uint32_t dwDTERate;
+    uint8_t bCharFormat;
+    uint8_t bParityType;
+    uint8_t bDataBits;
+};
+
+static const uint8_t device_descriptor[] = {
+    18,   // bLength
+    1,    // bDescriptorType: device
+    0x00, // bcdUSB: 2.00
+    0x02,
+    0x02, // bDeviceClass: CDC
+    0x00, // bDeviceSubClass
+    0x00, // bDeviceProtocol
+    USB_EP0_SIZE,
+    uint8_t(USB_CDC_VID & 0xFF),
+    uint8_t(USB_CDC_VID >> 8),
+    uint8_t(USB_CDC_PID & 0xFF),
+    uint8_t(USB_CDC_PID >> 8),
+    0x00, // bcdDevice: 1.00
+    0x01,
+    1, // iManufacturer
+    2, // iProduct
+    3, // iSerialNumber
+    1, // bNumConfigurations
+};
+
+static const uint8_t configuration_descriptor[] = {
+    // configuration
+    9, 2, 67, 0, // bLength, bDescriptorType, wTotalLength
+    2,           // bNumInterfaces
+    1,           // bConfigurationValue
+    0,           // iConfiguration
+    0x80,        // bmAttributes: bus powered
+    50,          // bMaxPower: 100 mA
+
+    // communication interface
+    9, 4, 0, 0, 1, // bLength, bDescriptorType, bInterfaceNumber, bAlternateSetting, bNumEndpoints
+    0x02, 0x02, 0x01, 0, // CDC, abstract control model, AT commands, iInterface
+
+    // CDC header, call management, ACM and union functional descriptors
+    5, 0x24, 0x00, 0x10, 0x01, // CDC 1.10
+    5, 0x24, 0x01, 0x00, 1, // no call management, data interface 1
+    4, 0x24, 0x02, 0x02,   // supports line coding and control line state
+    5, 0x24, 0x06, 0, 1,   // master interface 0, slave interface 1
+
+    // notification endpoint
+    7, 5, USB_DIR_IN | CDC_EP_NOTIFICATION, 0x03, CDC_NOTIFICATION_PACKET_SIZE, 0, 16,
+
+    // data interface
+    9, 4, 1, 0, 2, 0x0A, 0, 0, 0,
+
+    // data endpoints
+    7, 5, CDC_EP_DATA, 0x02, CDC_DATA_PACKET_SIZE, 0, 0,
+    7, 5, USB_DIR_IN | CDC_EP_DATA, 0x02, CDC_DATA_PACKET_SIZE, 0, 0,
+};
+
+static_assert(sizeof(configuration_descriptor) == 67, "wTotalLength must match the configuration descriptor");
+
+/**
+ * @brief serial number string, built from the chip unique id
+ */
+static char serial_number[25];
+
+static const char *const strings[] = {
+    USB_CDC_MANUFACTURER,
+    USB_CDC_PRODUCT,
+    serial_number,
+};
+
+//
+// CDC state
+//
+static RingBuffer<uint8_t, USB_CDC_RX_BUFFER_SIZE> rx_buffer;
+static RingBuffer<uint8_t, USB_CDC_TX_BUFFER_SIZE> tx_buffer;
+
+/**
+ * @brief OUT packet receive buffer. packets are moved to rx_buffer once received
+ */
+static uint8_t rx_packet[CDC_DATA_PACKET_SIZE] __attribute__((aligned(4)));
+
+/**
+ * @brief is the OUT endpoint set up to receive the next packet?
+ * @note not while rx_buffer has no room for a full packet. the host is NAK'ed then
+ */
+static volatile bool rx_armed = false;
+
+/**
+ * @brief is an IN transfer running? and the number of bytes of tx_buffer it sends
+ */
+static volatile bool tx_busy = false;
+static size_t tx_in_flight = 0;
+
+/**
+ * @brief does the last IN transfer have to be terminated by a zero-length packet?
+ */
+static bool tx_zlp_pending = false;
+
+static volatile bool configured = false;
+static volatile uint8_t control_line_state = 0;
+static cdc_line_coding_t line_coding = {115200, 0, 0, 8};
+static cdc_line_coding_t line_coding_received;
+
+/**
+ * @brief arm the OUT endpoint, if rx_buffer has room for a packet
+ * @note call from the USB interrupt, or with interrupts disabled
+ */
+static void rx_arm(void)
+{
+    if (rx_armed || !configured || (rx_buffer.capacity() - rx_buffer.count()) < CDC_DATA_PACKET_SIZE)
+    {
+        return;
+    }
+
+    rx_armed = usb_device_receive(CDC_EP_DATA, rx_packet, CDC_DATA_PACKET_SIZE);
+}
+
+/**
+ * @brief start sending the contents of tx_buffer, if no transfer is running
+ * @note call from the USB interrupt, or with interrupts disabled
+ */
+static void tx_kick(void)
+{
+    if (tx_busy || !configured)
+    {
+        return;
+    }
+
+    // data is sent directly from tx_buffer, and only released once the transfer completed
+    uint8_t *span;
+    size_t length = tx_buffer.peekContiguous(span);
+    if (length > CDC_MAX_TRANSFER_SIZE)
+    {
+        length = CDC_MAX_TRANSFER_SIZE;
+    }
+
+    if (length == 0)
+    {
+        // a transfer of full packets ends with a zero-length packet, so the host does not wait for more
+        if (tx_zlp_pending && usb_device_transmit(CDC_EP_DATA, NULL, 0))
+        {
+            tx_zlp_pending = false;
+            tx_in_flight = 0;
+            tx_busy = true;
+        }
+        return;
+    }
+
+    if (usb_device_transmit(CDC_EP_DATA, span, length))
+    {
+        tx_in_flight = length;
+        tx_busy = true;
+    }
+}
+
+//
+// class callbacks, called from the USB interrupt
+//
+
+static void cdc_set_configuration(const bool active)
+{
+    configured = active;
+    rx_armed = false;
+    tx_busy = false;
+    tx_in_flight = 0;
+    tx_zlp_pending = false;
+
+    if (!active)
+    {
+        control_line_state = 0;
+        return;
+    }
+
+    usb_device_open_endpoint(USB_DIR_IN | CDC_EP_NOTIFICATION, USB_ENDPOINT_INTERRUPT, CDC_NOTIFICATION_PACKET_SIZE);
+    usb_device_open_endpoint(USB_DIR_IN | CDC_EP_DATA, USB_ENDPOINT_BULK, CDC_DATA_PACKET_SIZE);
+    usb_device_open_endpoint(CDC_EP_DATA, USB_ENDPOINT_BULK, CDC_DATA_PACKET_SIZE);
+
+    rx_arm();
+    tx_kick();
+}
+
+static bool cdc_control_request(const usb_setup_packet_t &setup, uint8_t *&data, uint16_t &length)
+{
+    switch (setup.bRequest)
+    {
+    case CDC_SET_LINE_CODING:
+        data = reinterpret_cast<uint8_t *>(&line_coding_received);
+        return setup.wLength == sizeof(cdc_line_coding_t);
+    case CDC_GET_LINE_CODING:
+        data = reinterpret_cast<uint8_t *>(&line_coding);
+        length = sizeof(cdc_line_coding_t);
+        return true;
+    case CDC_SET_CONTROL_LINE_STATE:
+        control_line_state = uint8_t(setup.wValue);
+        return true;
+    case CDC_SEND_BREAK:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void cdc_control_out_complete(const usb_setup_packet_t &setup, const uint8_t *)
+{
+    if (setup.bRequest == CDC_SET_LINE_CODING)
+    {
+        line_coding = line_coding_received;
+    }
+}
+
+static void cdc_transmit_complete(const uint8_t ep)
+{
+    if (ep != CDC_EP_DATA)
+    {
+        return;
+    }
+
+    if (tx_in_flight > 0)
+    {
+        tx_buffer.consume(tx_in_flight);
+        tx_zlp_pending = (tx_in_flight % CDC_DATA_PACKET_SIZE) == 0;
+        tx_in_flight = 0;
+    }
+
+    tx_busy = false;
+    tx_kick();
+}
+
+static void cdc_receive_complete(const uint8_t ep, const size_t length)
+{
+    if (ep != CDC_EP_DATA)
+    {
+        return;
+    }
+
+    rx_buffer.push(rx_packet, length);
+    rx_armed = false;
+    rx_arm();
+}
+
+static const usb_class_t cdc_class = {
+    .device_descriptor = device_descriptor,
+    .configuration_descriptor = configuration_descriptor,
+    .configuration_descriptor_length = sizeof(configuration_descriptor),
+    .strings = strings,
+    .string_count = sizeof(strings) / sizeof(strings[0]),
+    .set_configuration = cdc_set_configuration,
+    .control_request = cdc_control_request,
+    .control_out_complete = cdc_control_out_complete,
+    .transmit_complete = cdc_transmit_complete,
+    .receive_complete = cdc_receive_complete,
+    .suspend = NULL,
+};
+
+//
+// UsbSerial implementation
+//
+
+#ifdef CORE_USB_CDC
+UsbSerial SerialUSB;
+#endif
+
+void UsbSerial::begin(uint32_t baud)
+{
+    (void)baud;
+
+    const stc_efm_unique_id_t uid = EFM_ReadUID();
+    snprintf(serial_number, sizeof(serial_number), "%08lX%08lX%08lX", uid.uniqueID3, uid.uniqueID2, uid.uniqueID1);
+
+    rx_buffer.clear();
+    tx_buffer.clear();
+    usb_device_begin(&cdc_class);
+}
+
+void UsbSerial::begin(uint32_t baud, uint16_t config)
+{
+    (void)config;
+    begin(baud);
+}
+
+void UsbSerial::end()
+{
+    usb_device_end();
+}
+
+int UsbSerial::available()
+{
+    return int(rx_buffer.count());
+}
+
+int UsbSerial::availableForWrite()
+{
+    return int(tx_buffer.capacity() - tx_buffer.count());
+}
+
+int UsbSerial::peek()
+{
+    return rx_buffer.isEmpty() ? -1 : rx_buffer.peek();
+}
+
+int UsbSerial::read()
+{
+    uint8_t ch;
+    if (!rx_buffer.pop(ch))
+    {
+        return -1;
+    }
+
+    // accept the next packet once there is room for it
+    if (!rx_armed)
+    {
+        const uint32_t critical = core_critical_enter();
+        rx_arm();
+        core_critical_exit(critical);
+    }
+
+    return ch;
+}
+
+void UsbSerial::flush()
+{
+    while (configured && (!tx_buffer.isEmpty() || tx_busy))
+    {
+        yield();
+    }
+}
+
+size_t UsbSerial::write(uint8_t ch)
+{
+    return write(&ch, 1);
+}
+
+size_t UsbSerial::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size)
+    {
+        written += tx_buffer.push(buffer + written, size - written);
+
+        const uint32_t critical = core_critical_enter();
+        tx_kick();
+        core_critical_exit(critical);
+
+        // wait for room only while a host application reads the data
+        if (written < size)
+        {
+            if (!configured || (control_line_state & CDC_CONTROL_DTR) == 0)
+            {
+                break;
+            }
+
+            yield();
+        }
+    }
+
+    return written;
+}
+
+UsbSerial::operator bool()
+{
+    return configured && (control_line_state & CDC_CONTROL_DTR) != 0;
+}
+
+uint32_t UsbSerial::baud()
+{
+    return line_coding.dwDTERate;
+}
+
+uint8_t UsbSerial::stopbits()
+{
+    return line_coding.bCharFormat;
+}
+
+uint8_t UsbSerial::paritytype()
+{
+    return line_coding.bParityType;
+}
+
+uint8_t UsbSerial::numbits()
+{
+    return line_coding.bDataBits;
+}
+
+bool UsbSerial::dtr()
+{
+    return (control_line_state & CDC_CONTROL_DTR) != 0;
+}
+
+bool UsbSerial::rts()
+{
+    return (control_line_state & CDC_CONTROL_RTS) != 0;
+}
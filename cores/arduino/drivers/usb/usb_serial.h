@@ -0,0 +1,98 @@
+/**
+ * USB CDC-ACM (virtual serial port) device:
+ *
+ * with CORE_USB_CDC defined, the global SerialUSB can be used like the Usart serials. SerialUSB.begin() connects to
+ * the host, the baud rate is ignored. the driver of the host needs no configuration, and transfers run at the
+ * full-speed bulk rate, independent of the baud rate the host sets.
+ *
+ * writes block while the TX buffer is full and the host has the port open (DTR set). without a host application,
+ * data that does not fit the TX buffer is dropped, so printing never stalls on a unconnected port.
+ *
+ * see usb_device.h for the clock requirements.
+ */
+#pragma once
+#include "HardwareSerial.h"
+
+#ifndef USB_CDC_RX_BUFFER_SIZE
+/**
+ * @brief size of the receive buffer, in bytes. must be a power of two, and at least 64
+ */
+#define USB_CDC_RX_BUFFER_SIZE 512
+#endif
+
+#ifndef USB_CDC_TX_BUFFER_SIZE
+/**
+ * @brief size of the transmit buffer, in bytes. must be a power of two
+ */
+#define USB_CDC_TX_BUFFER_SIZE 1024
+#endif
+
+#ifndef USB_CDC_VID
+/**
+ * @brief USB vendor and product id
+ * @note the default is a pid.codes test id. set your own for distributed devices
+ */
+#define USB_CDC_VID 0x1209
+#define USB_CDC_PID 0x0001
+#endif
+
+#ifndef USB_CDC_MANUFACTURER
+#define USB_CDC_MANUFACTURER "HDSC"
+#endif
+
+#ifndef USB_CDC_PRODUCT
+#define USB_CDC_PRODUCT "HC32F460 Serial"
+#endif
+
+class UsbSerial : public HardwareSerial
+{
+public:
+    /**
+     * @brief start the USB device, and connect to the host
+     * @param baud ignored
+     */
+    void begin(uint32_t baud = 0);
+    void begin(uint32_t baud, uint16_t config);
+
+    /**
+     * @brief disconnect from the host
+     */
+    void end();
+
+    int available();
+    int availableForWrite();
+    int peek();
+    int read();
+
+    /**
+     * @brief wait until all data in the tx buffer was sent to the host
+     * @note returns immediately if the device is not configured by a host
+     */
+    void flush();
+    size_t write(uint8_t ch);
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write; // pull in write(str) from Print
+
+    /**
+     * @brief is a host application connected? (device configured and DTR set)
+     */
+    operator bool();
+
+    /**
+     * @brief line coding set by the host
+     */
+    uint32_t baud();
+    uint8_t stopbits();
+    uint8_t paritytype();
+    uint8_t numbits();
+
+    /**
+     * @brief control line state set by the host
+     */
+    bool dtr();
+    bool rts();
+};
+
+#ifdef CORE_USB_CDC
+extern UsbSerial SerialUSB;
+#endif
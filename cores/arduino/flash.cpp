@@ -1,5 +1,7 @@
 #include "flash.h"
+#include "drivers/sysclock/sysclock_util.h"
 #include <stdio.h>
+#include <string.h>
 
 namespace Intflash {
 
@@ -25,98 +27,424 @@ en_result_t FlashErasePage(uint32_t u32Addr)
         printf("Error, func: %s, line: %d.\n", __FUNCTION__, __LINE__);
     }
 
+    // drop stale cache lines of the erased sector
+    sysclock_flush_flash_cache();
     EFM_Lock();
 
     return res;
 }
 
-uint32_t Flash_Updata(uint32_t flashAddr, const void * dataBuf, uint16_t length)
+//
+// sequence programming
+//
+// in sequence program mode, the EFM programs a word as soon as it is written, without switching
+// modes and polling RDY in between like EFM_SingleProgram() does.
+// flash cannot be read while it is programmed, so the programming loop runs from SRAM with
+// interrupts disabled, and the data is copied to SRAM in chunks first.
+//
+#define FLASH_RAMFUNC                   __attribute__((section(".data.flash_ramfunc"), long_call, noinline))
+#define FLASH_SEQUENCE_CHUNK_WORDS      64
+#define FLASH_SEQUENCE_TIMEOUT          0x20000U
+#define FLASH_PEMOD_READONLY            0U
+#define FLASH_PEMOD_SEQUENCE_PROGRAM    3U
+
+// (no calls into flash allowed in here)
+static FLASH_RAMFUNC en_result_t flash_sequence_program_words(uint32_t addr, const uint32_t *words, const uint32_t count)
 {
-    en_result res = Error;
-    uint32_t addr = flashAddr;
-    uint32_t addr_end = flashAddr + length;
-    uint32_t offset = 0;
+    en_result_t res = Ok;
+
+    // cache must be off while programming
+    const uint32_t cache = M4_EFM->FRMC_f.CACHE;
+    M4_EFM->FRMC_f.CACHE = 0;
+
+    M4_EFM->FWMC_f.PEMOD = FLASH_PEMOD_SEQUENCE_PROGRAM;
+    for(uint32_t i = 0; i < count; i++) {
+        *((volatile uint32_t *)addr) = words[i];
+
+        uint32_t timeout = FLASH_SEQUENCE_TIMEOUT;
+        while(!M4_EFM->FSR_f.OPTEND && --timeout != 0);
+        M4_EFM->FSCLR_f.OPTENDCLR = 1;
+        if(timeout == 0) {
+            res = ErrorTimeout;
+            break;
+        }
+
+        addr += 4;
+    }
+
+    M4_EFM->FWMC_f.PEMOD = FLASH_PEMOD_READONLY;
+
+    uint32_t timeout = FLASH_SEQUENCE_TIMEOUT;
+    while(!M4_EFM->FSR_f.RDY && --timeout != 0);
+
+    M4_EFM->FRMC_f.CACHE = cache;
+    return res;
+}
+
+en_result_t Flash_Program(uint32_t flashAddr, const void * dataBuf, uint32_t length)
+{
+    if(flashAddr < FLASH_OUTAGE_DATA_ADDR || (flashAddr & 0x3) != 0) {
+        printf("can NOT program code area or unaligned address.\n");
+        return ErrorInvalidParameter;
+    }
+
+    en_result_t res = Ok;
+    const uint8_t *src = (const uint8_t *)dataBuf;
+    uint32_t words[FLASH_SEQUENCE_CHUNK_WORDS];
 
     EFM_Unlock();
     EFM_FlashCmd(Enable);
 
     while(Set != EFM_GetFlagStatus(EFM_FLAG_RDY));
 
-    res = EFM_SectorErase(flashAddr);
-    if(res != Ok) {
-        printf("Error, func: %s, line: %d.\n", __FUNCTION__, __LINE__);
-    }
+    while(length > 0) {
+        // copy chunk to SRAM, padding a partial last word with 0xFF (erased)
+        const uint32_t chunk = (length > sizeof(words)) ? sizeof(words) : length;
+        const uint32_t count = (chunk + 3) / 4;
+        words[count - 1] = 0xFFFFFFFFU;
+        memcpy(words, src, chunk);
+
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        res = flash_sequence_program_words(flashAddr, words, count);
+        __set_PRIMASK(primask);
 
-    while(addr < addr_end) {
-        res = EFM_SingleProgram(addr, *((uint32_t *)((uint8_t *)dataBuf + offset)));
         if(res != Ok) {
             printf("Error, func: %s, line: %d.\n", __FUNCTION__, __LINE__);
             break;
         }
-        addr += 4;
-        offset += 4;
+
+        flashAddr += count * 4;
+        src += chunk;
+        length -= chunk;
     }
 
+    // drop stale cache lines of the programmed range
+    sysclock_flush_flash_cache();
     EFM_Lock();
 
     return res;
 }
 
-void eeprom_buffer_fill()
+uint32_t Flash_Updata(uint32_t flashAddr, const void * dataBuf, uint16_t length)
+{
+    en_result res = FlashErasePage(flashAddr);
+    if(res != Ok) {
+        return res;
+    }
+
+    return Flash_Program(flashAddr, dataBuf, length);
+}
+
+//
+// log-structured eeprom emulation
+//
+// every sector of the log starts with a header, followed by a snapshot of the whole eeprom,
+// followed by records of single byte writes, each a 32-bit word. the sector with the highest
+// sequence number is the active one, and the current eeprom content is its snapshot with all
+// records replayed in order.
+// a byte write only programs one record. once the active sector is full, a new snapshot is
+// written into the next sector (compaction), so a sector is only erased every ~1800 byte writes.
+// the header is programmed last, so the previous sector stays valid until the new one is complete.
+//
+//   +----------------------------------------+ 0x0000
+//   | header: sequence, ~sequence, 0, magic  |
+//   +----------------------------------------+ 0x0010
+//   | snapshot (EEPROM_SIZE bytes)           |
+//   +----------------------------------------+ 0x0410
+//   | record: pos(16) | value(8) | check(8)  |
+//   | record ...                             |
+//   | erased (0xFFFFFFFF)                    |
+//   +----------------------------------------+ FLASH_SECTOR_SIZE
+//
+#define LOG_MAGIC               0x4C504545U // "EEPL"
+#define LOG_HEADER_SIZE         16
+#define LOG_SNAPSHOT_OFFSET     LOG_HEADER_SIZE
+#define LOG_RECORDS_OFFSET      (LOG_SNAPSHOT_OFFSET + EEPROM_SIZE)
+#define LOG_RECORD_SIZE         4
+#define LOG_ERASED_WORD         0xFFFFFFFFU
+
+static_assert(FLASH_EEPROM_LOG_BASE > FLASH_OUTAGE_DATA_ADDR, "EEPROM_LOG_SECTORS too large, log overlaps power outage data");
+static_assert((EEPROM_SIZE % 4) == 0, "EEPROM_SIZE must be a multiple of 4");
+static_assert(EEPROM_SIZE <= 0xFFFF, "EEPROM_SIZE must fit into a record");
+
+typedef struct log_header_t {
+    uint32_t sequence;
+    uint32_t sequence_inverted;
+    uint32_t reserved;
+    uint32_t magic;
+} log_header_t;
+
+// active log sector, or -1 if the log is not formatted yet
+static int8_t log_active_sector = -1;
+
+// sequence number of the active log sector
+static uint32_t log_sequence = 0;
+
+// address of the next free record in the active log sector
+static uint32_t log_next_record = 0;
+
+// has eeprom_buffer been loaded from the log?
+static bool log_loaded = false;
+
+// eeprom content as currently stored in flash.
+// a byte is dirty if it differs between eeprom_buffer and eeprom_persisted
+static uint8_t eeprom_persisted[EEPROM_SIZE] __attribute__((aligned(8))) = {0};
+
+// range of bytes that may be dirty, [dirty_start, dirty_end). empty if dirty_start >= dirty_end
+static uint32_t dirty_start = EEPROM_SIZE;
+static uint32_t dirty_end = 0;
+
+static inline uint32_t log_sector_address(const uint8_t sector)
 {
-    memcpy(eeprom_buffer, (uint8_t *)(FLASH_EEPROM_BASE), sizeof(eeprom_buffer));
+    return FLASH_EEPROM_LOG_BASE + (sector * FLASH_SECTOR_SIZE);
 }
 
-void eeprom_buffer_flush()
+static inline uint8_t log_record_check(const uint16_t pos, const uint8_t value)
 {
-    en_result res = Error;
-    uint32_t addr = FLASH_EEPROM_BASE;
-    uint32_t addr_end = FLASH_EEPROM_BASE + EEPROM_SIZE;
-    uint32_t offset = 0;
+    // erased (all 0xFF) and zeroed words both fail the check
+    return (uint8_t)~((pos & 0xFF) ^ (pos >> 8) ^ value);
+}
+
+static inline uint32_t log_record_encode(const uint16_t pos, const uint8_t value)
+{
+    return (uint32_t)pos | ((uint32_t)value << 16) | ((uint32_t)log_record_check(pos, value) << 24);
+}
+
+static inline bool log_header_valid(const uint8_t sector, uint32_t *sequence)
+{
+    const log_header_t *header = (const log_header_t *)log_sector_address(sector);
+    if(header->magic != LOG_MAGIC || header->sequence != ~header->sequence_inverted) {
+        return false;
+    }
+
+    *sequence = header->sequence;
+    return true;
+}
+
+static inline bool eeprom_is_dirty(const uint32_t pos)
+{
+    return eeprom_buffer[pos] != eeprom_persisted[pos];
+}
+
+static inline void eeprom_mark_clean()
+{
+    memcpy(eeprom_persisted, eeprom_buffer, sizeof(eeprom_persisted));
+    dirty_start = EEPROM_SIZE;
+    dirty_end = 0;
+}
+
+static en_result_t log_program_words(uint32_t addr, const uint32_t *words, const uint32_t count)
+{
+    en_result_t res = Ok;
 
     EFM_Unlock();
     EFM_FlashCmd(Enable);
 
     while(Set != EFM_GetFlagStatus(EFM_FLAG_RDY));
 
-    res = EFM_SectorErase(FLASH_EEPROM_BASE);
-    if(res != Ok) {
-        printf("Error, func: %s, line: %d.\n", __FUNCTION__, __LINE__);
-    }
-
-    while(addr < addr_end) {
-        res = EFM_SingleProgram(addr, *((uint32_t *)((uint8_t *)eeprom_buffer + offset)));
+    for(uint32_t i = 0; i < count; i++) {
+        res = EFM_SingleProgram(addr, words[i]);
         if(res != Ok) {
             printf("Error, func: %s, line: %d.\n", __FUNCTION__, __LINE__);
             break;
         }
         addr += 4;
-        offset += 4;
     }
 
+    // the records are read back right away, so drop stale lines from the flash cache
+    sysclock_flush_flash_cache();
     EFM_Lock();
+
+    return res;
+}
+
+// write eeprom_buffer as snapshot into the next log sector, and make it the active one
+static void log_compact()
+{
+    const uint8_t sector = (log_active_sector < 0) ? 0 : (uint8_t)((log_active_sector + 1) % EEPROM_LOG_SECTORS);
+    const uint32_t addr = log_sector_address(sector);
+
+    if(FlashErasePage(addr) != Ok) {
+        return;
+    }
+
+    // snapshot first, header last
+    if(Flash_Program(addr + LOG_SNAPSHOT_OFFSET, eeprom_buffer, EEPROM_SIZE) != Ok) {
+        return;
+    }
+
+    const uint32_t sequence = log_sequence + 1;
+    const log_header_t header = {
+        .sequence = sequence,
+        .sequence_inverted = ~sequence,
+        .reserved = 0,
+        .magic = LOG_MAGIC,
+    };
+    if(log_program_words(addr, (const uint32_t *)&header, LOG_HEADER_SIZE / 4) != Ok) {
+        return;
+    }
+
+    log_active_sector = (int8_t)sector;
+    log_sequence = sequence;
+    log_next_record = addr + LOG_RECORDS_OFFSET;
+
+    // buffered writes are part of the snapshot now
+    eeprom_mark_clean();
+}
+
+// append a record for the current value of a byte, compacting the log if it is full
+static void log_append(const uint32_t pos)
+{
+    if(log_active_sector < 0 || log_next_record >= (log_sector_address((uint8_t)log_active_sector) + FLASH_SECTOR_SIZE)) {
+        // the snapshot includes the new value
+        log_compact();
+        return;
+    }
+
+    const uint32_t record = log_record_encode((uint16_t)pos, eeprom_buffer[pos]);
+    const en_result_t res = log_program_words(log_next_record, &record, 1);
+    log_next_record += LOG_RECORD_SIZE;
+    if(res == Ok) {
+        eeprom_persisted[pos] = eeprom_buffer[pos];
+    }
+}
+
+static inline void eeprom_ensure_loaded()
+{
+    if(!log_loaded) {
+        eeprom_buffer_fill();
+    }
+}
+
+void eeprom_buffer_fill()
+{
+    // find the sector with the highest sequence number
+    log_active_sector = -1;
+    for(uint8_t sector = 0; sector < EEPROM_LOG_SECTORS; sector++) {
+        uint32_t sequence;
+        if(log_header_valid(sector, &sequence) && (log_active_sector < 0 || (int32_t)(sequence - log_sequence) > 0)) {
+            log_active_sector = (int8_t)sector;
+            log_sequence = sequence;
+        }
+    }
+
+    if(log_active_sector < 0) {
+        // not formatted yet, so FLASH_EEPROM_BASE holds a plain image (or is erased).
+        // the log is formatted on the first write
+        log_sequence = 0;
+        memcpy(eeprom_buffer, (uint8_t *)(FLASH_EEPROM_BASE), sizeof(eeprom_buffer));
+    } else {
+        // load snapshot and replay records
+        const uint32_t addr = log_sector_address((uint8_t)log_active_sector);
+        const uint32_t addr_end = addr + FLASH_SECTOR_SIZE;
+        memcpy(eeprom_buffer, (uint8_t *)(addr + LOG_SNAPSHOT_OFFSET), sizeof(eeprom_buffer));
+
+        log_next_record = addr + LOG_RECORDS_OFFSET;
+        for(; log_next_record < addr_end; log_next_record += LOG_RECORD_SIZE) {
+            const uint32_t record = *((const uint32_t *)log_next_record);
+            if(record == LOG_ERASED_WORD) {
+                break;
+            }
+
+            // a record interrupted by power loss fails the check and is skipped
+            const uint16_t pos = (uint16_t)(record & 0xFFFF);
+            const uint8_t value = (uint8_t)(record >> 16);
+            const uint8_t check = (uint8_t)(record >> 24);
+            if(pos < EEPROM_SIZE && check == log_record_check(pos, value)) {
+                eeprom_buffer[pos] = value;
+            }
+        }
+    }
+
+    eeprom_mark_clean();
+    log_loaded = true;
+}
+
+void eeprom_buffer_flush()
+{
+    // nothing written since the last flush
+    if(!log_loaded || dirty_start >= dirty_end) {
+        return;
+    }
+
+    // bytes written back to their stored value are not dirty
+    uint32_t dirty_count = 0;
+    for(uint32_t pos = dirty_start; pos < dirty_end; pos++) {
+        if(eeprom_is_dirty(pos)) {
+            dirty_count++;
+        }
+    }
+
+    if(dirty_count == 0) {
+        dirty_start = EEPROM_SIZE;
+        dirty_end = 0;
+        return;
+    }
+
+    // compact right away if the records would not fit, the snapshot includes all changes
+    const uint32_t records_left = (log_active_sector < 0) ? 0 :
+        (log_sector_address((uint8_t)log_active_sector) + FLASH_SECTOR_SIZE - log_next_record) / LOG_RECORD_SIZE;
+    if(dirty_count > records_left) {
+        log_compact();
+    } else {
+        for(uint32_t pos = dirty_start; pos < dirty_end; pos++) {
+            if(eeprom_is_dirty(pos)) {
+                log_append(pos);
+            }
+        }
+    }
+
+    dirty_start = EEPROM_SIZE;
+    dirty_end = 0;
 }
 
 uint8_t eeprom_read_byte(const uint32_t pos)
 {
-    eeprom_buffer_fill();
+    eeprom_ensure_loaded();
     return eeprom_buffered_read_byte(pos);
 }
 
 void eeprom_write_byte(uint32_t pos, uint8_t value)
 {
-    eeprom_buffered_write_byte(pos, value);
-    eeprom_buffer_flush();
+    eeprom_ensure_loaded();
+    if(pos >= EEPROM_SIZE) {
+        return;
+    }
+
+    // bytes that already hold the value in flash are not written at all
+    eeprom_buffer[pos] = value;
+    if(!eeprom_is_dirty(pos)) {
+        return;
+    }
+
+    log_append(pos);
 }
 
 uint8_t eeprom_buffered_read_byte(const uint32_t pos)
 {
+    eeprom_ensure_loaded();
+    if(pos >= EEPROM_SIZE) {
+        return 0xFF;
+    }
+
     return eeprom_buffer[pos];
 }
 
 void eeprom_buffered_write_byte(uint32_t pos, uint8_t value)
 {
+    eeprom_ensure_loaded();
+    if(pos >= EEPROM_SIZE || eeprom_buffer[pos] == value) {
+        return;
+    }
+
     eeprom_buffer[pos] = value;
+    if(pos < dirty_start) {
+        dirty_start = pos;
+    }
+    if(pos >= dirty_end) {
+        dirty_end = pos + 1;
+    }
 }
 
 
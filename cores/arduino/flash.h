@@ -28,6 +28,18 @@ extern "C" {
 // just use 1k bytes, not a full sector
 #define EEPROM_SIZE           1024
 
+// the eeprom is emulated as a log of byte writes across multiple sectors,
+// ending with the sector at FLASH_EEPROM_BASE. see flash.cpp
+#ifndef EEPROM_LOG_SECTORS
+#define EEPROM_LOG_SECTORS    2
+#endif
+
+#if EEPROM_LOG_SECTORS < 2
+#error "EEPROM_LOG_SECTORS must be at least 2"
+#endif
+
+#define FLASH_EEPROM_LOG_BASE (FLASH_EEPROM_BASE - ((EEPROM_LOG_SECTORS - 1) * FLASH_SECTOR_SIZE))
+
 
 // power outage
 #define FLASH_OUTAGE_DATA_ADDR  ((uint32_t)0x0003C000U)
@@ -35,13 +47,29 @@ extern "C" {
 
 
 namespace Intflash {
+    // (re-) load the RAM cache from flash. unflushed buffered writes are discarded
     void eeprom_buffer_fill();
+
+    // read and write the RAM cache. the cache is loaded on first use
     uint8_t eeprom_buffered_read_byte(const uint32_t pos);
     void eeprom_buffered_write_byte(uint32_t pos, uint8_t value);
+
+    // read from the RAM cache, and write through to flash.
+    // writing the value already stored in flash does nothing
     uint8_t eeprom_read_byte(const uint32_t pos);
     void eeprom_write_byte(uint32_t pos, uint8_t value);
+
+    // write the buffered writes to flash.
+    // only bytes that differ from flash are written, and nothing at all if none do
     void eeprom_buffer_flush();
+
+    // erase the sector at flashAddr, then program length bytes of dataBuf to it
      uint32_t Flash_Updata(uint32_t flashAddr, const void * dataBuf, uint16_t length);
+
+    // program length bytes of dataBuf to already erased flash, using sequence programming.
+    // flashAddr must be word aligned. a partial last word is padded with 0xFF.
+    // interrupts are disabled while each chunk of 256 bytes is programmed
+     en_result_t Flash_Program(uint32_t flashAddr, const void * dataBuf, uint32_t length);
      en_result_t FlashErasePage(uint32_t u32Addr);
 }
 
@@ -0,0 +1,167 @@
+#include "flash_async.h"
+#include "flash.h"
+#include "core_critical.h"
+#include "core_debug.h"
+
+static_assert((FLASH_ASYNC_CHUNK_SIZE % 4) == 0 && FLASH_ASYNC_CHUNK_SIZE > 0,
+              "FLASH_ASYNC_CHUNK_SIZE must be a multiple of 4");
+
+static flash_job_t *queue_head = nullptr;
+static flash_job_t *queue_tail = nullptr;
+
+// set while a step runs, so a yield() inside a callback does not recurse
+static bool polling = false;
+
+static bool submit(flash_job_t *job)
+{
+    const uint32_t critical = core_critical_enter();
+    if (job->queued)
+    {
+        core_critical_exit(critical);
+        return false;
+    }
+
+    job->next = nullptr;
+    job->queued = true;
+    if (queue_tail == nullptr)
+    {
+        queue_head = job;
+    }
+    else
+    {
+        queue_tail->next = job;
+    }
+    queue_tail = job;
+
+    core_critical_exit(critical);
+    return true;
+}
+
+bool flash_async_erase(flash_job_t *job,
+                       const uint32_t address,
+                       const flash_job_callback_t callback,
+                       void *param)
+{
+    CORE_ASSERT(job != nullptr, "flash_async_erase: job cannot be NULL", return false);
+    CORE_ASSERT(address >= FLASH_OUTAGE_DATA_ADDR, "flash_async_erase: cannot erase code area", return false);
+    if (job->queued)
+    {
+        return false;
+    }
+
+    job->type = FLASH_JOB_ERASE;
+    job->address = address;
+    job->data = nullptr;
+    job->length = 0;
+    job->progress = 0;
+    job->callback = callback;
+    job->param = param;
+    return submit(job);
+}
+
+bool flash_async_program(flash_job_t *job,
+                         const uint32_t address,
+                         const void *data,
+                         const uint32_t length,
+                         const flash_job_callback_t callback,
+                         void *param)
+{
+    CORE_ASSERT(job != nullptr, "flash_async_program: job cannot be NULL", return false);
+    CORE_ASSERT(data != nullptr || length == 0, "flash_async_program: data cannot be NULL", return false);
+    CORE_ASSERT(address >= FLASH_OUTAGE_DATA_ADDR && (address & 0x3) == 0,
+                "flash_async_program: cannot program code area or unaligned address", return false);
+    if (job->queued)
+    {
+        return false;
+    }
+
+    job->type = FLASH_JOB_PROGRAM;
+    job->address = address;
+    job->data = static_cast<const uint8_t *>(data);
+    job->length = length;
+    job->progress = 0;
+    job->callback = callback;
+    job->param = param;
+    return submit(job);
+}
+
+bool flash_async_is_busy(void)
+{
+    return queue_head != nullptr;
+}
+
+/**
+ * @brief run a single step of a job
+ * @param job the job
+ * @param done set to true if the job completed
+ * @return result of the step
+ */
+static en_result_t run_step(flash_job_t *job, bool &done)
+{
+    switch (job->type)
+    {
+    case FLASH_JOB_ERASE:
+        done = true;
+        return Intflash::FlashErasePage(job->address);
+    case FLASH_JOB_PROGRAM:
+    {
+        const uint32_t remaining = job->length - job->progress;
+        const uint32_t chunk = remaining > FLASH_ASYNC_CHUNK_SIZE ? FLASH_ASYNC_CHUNK_SIZE : remaining;
+        en_result_t res = Ok;
+        if (chunk > 0)
+        {
+            res = Intflash::Flash_Program(job->address + job->progress, job->data + job->progress, chunk);
+            job->progress += chunk;
+        }
+
+        done = res != Ok || job->progress >= job->length;
+        return res;
+    }
+    default:
+        done = true;
+        return ErrorInvalidParameter;
+    }
+}
+
+void flash_async_poll(void)
+{
+    if (polling || queue_head == nullptr)
+    {
+        return;
+    }
+
+    polling = true;
+    flash_job_t *job = queue_head;
+
+    bool done = false;
+    const en_result_t res = run_step(job, done);
+    if (done)
+    {
+        // dequeue before the callback, so it may submit the job again
+        const uint32_t critical = core_critical_enter();
+        queue_head = job->next;
+        if (queue_head == nullptr)
+        {
+            queue_tail = nullptr;
+        }
+        job->next = nullptr;
+        job->queued = false;
+        core_critical_exit(critical);
+
+        if (job->callback != nullptr)
+        {
+            job->callback(job, res, job->param);
+        }
+    }
+
+    polling = false;
+}
+
+void flash_async_flush(void)
+{
+    CORE_ASSERT(!polling, "flash_async_flush: cannot flush from a job callback", return);
+    while (flash_async_is_busy())
+    {
+        flash_async_poll();
+    }
+}
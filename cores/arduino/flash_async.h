@@ -0,0 +1,168 @@
+/**
+ * background flash erase / program service:
+ *
+ * erase and program requests are queued as jobs, and worked off in small steps from yield() and the main loop.
+ * each step either erases a single sector, or programs at most FLASH_ASYNC_CHUNK_SIZE bytes,
+ * so the caller is never blocked for longer than one step. once a job completed, its callback is called.
+ *
+ * the EFM blocks all flash reads (including code fetches) while it erases or programs,
+ * so a step cannot overlap with code running from flash. bounding the steps keeps the gaps short instead.
+ *
+ * jobs are allocated by the caller, so the service never allocates memory.
+ * if no job is ever submitted, the service is not linked at all.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <hc32_ddl.h>
+
+/**
+ * @brief maximum number of bytes programmed per step
+ * @note a multiple of 4. larger values finish jobs sooner, but block longer per step
+ */
+#ifndef FLASH_ASYNC_CHUNK_SIZE
+#define FLASH_ASYNC_CHUNK_SIZE 64
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    struct flash_job_t;
+
+    /**
+     * @brief flash job completion callback
+     * @param job the job that completed
+     * @param result result of the job. Ok on success
+     * @param param the param given when submitting the job
+     * @note called from yield() or the main loop. may submit new jobs
+     */
+    typedef void (*flash_job_callback_t)(struct flash_job_t *job, en_result_t result, void *param);
+
+    /**
+     * @brief type of a flash job
+     */
+    typedef enum flash_job_type_t
+    {
+        /**
+         * @brief erase the sector containing the address
+         */
+        FLASH_JOB_ERASE,
+
+        /**
+         * @brief program data to already erased flash
+         */
+        FLASH_JOB_PROGRAM,
+    } flash_job_type_t;
+
+    /**
+     * @brief flash job
+     * @note all fields are managed by the service. only zero-initialize before first use
+     */
+    typedef struct flash_job_t
+    {
+        /**
+         * @brief next job in the queue
+         */
+        struct flash_job_t *next;
+
+        /**
+         * @brief type of the job
+         */
+        flash_job_type_t type;
+
+        /**
+         * @brief flash address of the job
+         */
+        uint32_t address;
+
+        /**
+         * @brief data to program
+         * @note must stay valid until the job completed
+         */
+        const uint8_t *data;
+
+        /**
+         * @brief number of bytes to program
+         */
+        uint32_t length;
+
+        /**
+         * @brief number of bytes programmed so far
+         */
+        uint32_t progress;
+
+        /**
+         * @brief callback called when the job completed
+         */
+        flash_job_callback_t callback;
+
+        /**
+         * @brief param for the callback
+         */
+        void *param;
+
+        /**
+         * @brief is the job queued or running?
+         */
+        volatile bool queued;
+    } flash_job_t;
+
+    /**
+     * @brief queue a sector erase
+     * @param job the job. must not be queued already
+     * @param address address within the sector to erase
+     * @param callback called when the job completed. may be NULL
+     * @param param param for the callback
+     * @return true if the job was queued
+     */
+    bool flash_async_erase(flash_job_t *job,
+                           const uint32_t address,
+                           const flash_job_callback_t callback,
+                           void *param);
+
+    /**
+     * @brief queue programming data to already erased flash
+     * @param job the job. must not be queued already
+     * @param address word-aligned flash address to program
+     * @param data the data to program. must stay valid until the job completed
+     * @param length number of bytes to program. a partial last word is padded with 0xFF
+     * @param callback called when the job completed. may be NULL
+     * @param param param for the callback
+     * @return true if the job was queued
+     */
+    bool flash_async_program(flash_job_t *job,
+                             const uint32_t address,
+                             const void *data,
+                             const uint32_t length,
+                             const flash_job_callback_t callback,
+                             void *param);
+
+    /**
+     * @brief check if a job is queued or running
+     */
+    static inline bool flash_async_is_queued(const flash_job_t *job)
+    {
+        return job->queued;
+    }
+
+    /**
+     * @brief check if any job is queued or running
+     */
+    bool flash_async_is_busy(void);
+
+    /**
+     * @brief run a single step of the current job
+     * @note called from yield() and the main loop
+     */
+    void flash_async_poll(void);
+
+    /**
+     * @brief run all queued jobs to completion, blocking
+     */
+    void flash_async_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,110 @@
+#include "ftoa.h"
+#include <string.h>
+#include <math.h>
+
+// 10^n, for n = 0 .. FTOA_MAX_DIGITS
+static const uint32_t pow10_table[FTOA_MAX_DIGITS + 1] = {
+    1,
+    10,
+    100,
+    1000,
+    10000,
+    100000,
+    1000000,
+};
+
+/**
+ * @brief copy a string to out
+ * @return length of the string
+ */
+static size_t put_string(char *out, const char *str)
+{
+    const size_t len = strlen(str);
+    memcpy(out, str, len + 1);
+    return len;
+}
+
+/**
+ * @brief write the decimal digits of a value, right-aligned to end
+ * @param min_digits minimum number of digits, padded with leading zeros
+ * @return pointer to the first digit
+ */
+static char *put_digits(uint32_t value, uint8_t min_digits, char *end)
+{
+    uint8_t count = 0;
+    do
+    {
+        // division by a constant compiles to a multiply with its reciprocal
+        const uint32_t q = value / 10;
+        *--end = (char)('0' + (value - (q * 10)));
+        value = q;
+        count++;
+    } while (value != 0 || count < min_digits);
+    return end;
+}
+
+size_t ftoa_fixed(float value, uint8_t digits, char *out)
+{
+    if (isnan(value))
+    {
+        return put_string(out, "nan");
+    }
+
+    if (isinf(value))
+    {
+        return put_string(out, value < 0.0f ? "-inf" : "inf");
+    }
+
+    if (digits > FTOA_MAX_DIGITS)
+    {
+        digits = FTOA_MAX_DIGITS;
+    }
+
+    char *p = out;
+    if (value < 0.0f)
+    {
+        *p++ = '-';
+        value = -value;
+    }
+
+    // the integer part must fit 32 bits
+    if (value >= 4294967296.0f)
+    {
+        return put_string(out, "ovf");
+    }
+
+    // split into integer and fraction part. both steps are exact for any float
+    uint32_t int_part = (uint32_t)value;
+    const float fraction = value - (float)int_part;
+
+    // fraction as 0.32 fixed-point. scaling by a power of two is exact, and the
+    // result always fits, as fraction < 1 with at most 24 significant bits
+    const uint32_t fraction_fixed = (uint32_t)(fraction * 4294967296.0f);
+
+    // scale to the requested digits, and round to nearest on the exact binary value
+    const uint32_t scale = pow10_table[digits];
+    uint32_t fraction_digits = (uint32_t)((((uint64_t)fraction_fixed * scale) + 0x80000000ull) >> 32);
+    if (fraction_digits >= scale)
+    {
+        // rounding carried into the integer part, e.g. 1.999 -> 2.00
+        fraction_digits -= scale;
+        int_part++;
+    }
+
+    // format right-aligned into a local buffer, then move to the front
+    char buf[FTOA_BUFFER_SIZE];
+    char *const end = &buf[sizeof(buf) - 1];
+    *end = '\0';
+
+    char *start = end;
+    if (digits > 0)
+    {
+        start = put_digits(fraction_digits, digits, start);
+        *--start = '.';
+    }
+    start = put_digits(int_part, 1, start);
+
+    const size_t len = (size_t)(end - start);
+    memcpy(p, start, len + 1);
+    return (size_t)(p - out) + len;
+}
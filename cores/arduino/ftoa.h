@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief maximum number of fraction digits ftoa_fixed() computes. further digits are always '0'
+ * @note a float has about 7 significant digits, so more fraction digits would only show conversion noise
+ */
+#define FTOA_MAX_DIGITS 6
+
+/**
+ * @brief minimum size of the output buffer of ftoa_fixed(), for up to FTOA_MAX_DIGITS fraction digits
+ * @note sign, 10 integer digits, '.', fraction digits and '\0'
+ */
+#define FTOA_BUFFER_SIZE (1 + 10 + 1 + FTOA_MAX_DIGITS + 1)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief format a float with a fixed number of fraction digits, rounded to nearest
+     * @param value the value to format
+     * @param digits number of fraction digits. values above FTOA_MAX_DIGITS are clamped
+     * @param out output buffer, at least FTOA_BUFFER_SIZE bytes
+     * @return number of characters written, not including the '\0'
+     * @note uses only single-precision and 32/64-bit integer math, so it runs on the FPU instead of the
+     *       soft-double library. prints "nan", "inf", "-inf", and "ovf" for magnitudes of 2^32 and above
+     */
+    size_t ftoa_fixed(float value, uint8_t digits, char *out);
+
+#ifdef __cplusplus
+}
+#endif
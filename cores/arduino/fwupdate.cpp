@@ -0,0 +1,407 @@
+#include "fwupdate.h"
+#include "Stream.h"
+#include "delay.h"
+#include "yield.h"
+#include "core_debug.h"
+#include "main/init.h"
+#include "drivers/crc/crc.h"
+#include <string.h>
+
+static_assert((FWUPDATE_STAGING_ADDR % FLASH_SECTOR_SIZE) == 0, "FWUPDATE_STAGING_ADDR must be sector aligned");
+static_assert((FWUPDATE_STAGING_SIZE % FLASH_SECTOR_SIZE) == 0, "FWUPDATE_STAGING_SIZE must be a multiple of the sector size");
+static_assert((FWUPDATE_WRITE_BUFFER_SIZE % 4) == 0, "FWUPDATE_WRITE_BUFFER_SIZE must be a multiple of 4");
+static_assert(FWUPDATE_STAGING_ADDR >= FLASH_EEPROM_BASE + FLASH_SECTOR_SIZE ||
+                  (FWUPDATE_STAGING_ADDR >= FLASH_OUTAGE_DATA_ADDR + FLASH_SECTOR_SIZE &&
+                   FWUPDATE_STAGING_ADDR + FWUPDATE_STAGING_SIZE <= FLASH_EEPROM_LOG_BASE),
+              "staging region overlaps the power outage data or the EEPROM emulation");
+
+#define FWUPDATE_MAGIC 0x46575550u // "FWUP"
+#define FWUPDATE_IMAGE_ADDR (FWUPDATE_STAGING_ADDR + FWUPDATE_HEADER_SIZE)
+
+// SRAM range the initial stack pointer of an image must point into
+#define FWUPDATE_SRAM_START 0x1FFF8000u
+#define FWUPDATE_SRAM_END 0x20027FFFu
+
+//
+// copy routine
+//
+// runs from SRAM with interrupts disabled, and must not call into flash.
+// so it drives the EFM registers directly, and is always placed in SRAM (even with CORE_DISABLE_RAMFUNC)
+//
+#define FWUPDATE_RAMFUNC __attribute__((section(".data.fwupdate_ramfunc"), long_call, noinline))
+#define FWUPDATE_COPY_CHUNK_WORDS 64
+#define FWUPDATE_PEMOD_READONLY 0U
+#define FWUPDATE_PEMOD_SINGLE_PROGRAM 1U
+#define FWUPDATE_PEMOD_SEQUENCE_PROGRAM 3U
+#define FWUPDATE_PEMOD_SECTOR_ERASE 4U
+
+struct fwupdate_header_t
+{
+    uint32_t magic;
+    uint32_t size;
+    uint32_t crc32;
+
+    /**
+     * @brief ~(magic ^ size ^ crc32)
+     */
+    uint32_t check;
+};
+static_assert(sizeof(fwupdate_header_t) == FWUPDATE_HEADER_SIZE, "fwupdate_header_t size mismatch");
+
+static FWUPDATE_RAMFUNC void fwupdate_wait_operation(const bool refresh_wdt)
+{
+    while (!M4_EFM->FSR_f.OPTEND)
+    {
+        if (refresh_wdt)
+        {
+            M4_WDT->RR = 0x0123u;
+            M4_WDT->RR = 0x3210u;
+        }
+    }
+    M4_EFM->FSCLR_f.OPTENDCLR = 1;
+}
+
+static FWUPDATE_RAMFUNC void fwupdate_wait_ready()
+{
+    M4_EFM->FWMC_f.PEMOD = FWUPDATE_PEMOD_READONLY;
+    while (!M4_EFM->FSR_f.RDY)
+        ;
+}
+
+// (no calls into flash allowed in here)
+static FWUPDATE_RAMFUNC void fwupdate_copy_and_reset(const uint32_t destination,
+                                                     const uint32_t source,
+                                                     const uint32_t size,
+                                                     const bool refresh_wdt)
+{
+    uint32_t words[FWUPDATE_COPY_CHUNK_WORDS];
+    M4_EFM->FRMC_f.CACHE = 0;
+
+    // erase the application sectors the image covers
+    for (uint32_t addr = destination; addr < destination + size; addr += FLASH_SECTOR_SIZE)
+    {
+        M4_EFM->FWMC_f.PEMOD = FWUPDATE_PEMOD_SECTOR_ERASE;
+        *((volatile uint32_t *)addr) = 0x12345678u;
+        fwupdate_wait_operation(refresh_wdt);
+        fwupdate_wait_ready();
+    }
+
+    // copy in chunks: the staged image cannot be read while programming
+    const uint32_t total_words = (size + 3) / 4;
+    for (uint32_t done = 0; done < total_words;)
+    {
+        const uint32_t count = (total_words - done) > FWUPDATE_COPY_CHUNK_WORDS ? FWUPDATE_COPY_CHUNK_WORDS : (total_words - done);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            words[i] = ((const volatile uint32_t *)source)[done + i];
+        }
+
+        M4_EFM->FWMC_f.PEMOD = FWUPDATE_PEMOD_SEQUENCE_PROGRAM;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            ((volatile uint32_t *)destination)[done + i] = words[i];
+            fwupdate_wait_operation(refresh_wdt);
+        }
+        fwupdate_wait_ready();
+        done += count;
+    }
+
+    // invalidate the header, so the image is applied once. programming only clears bits, so no erase is needed
+    M4_EFM->FWMC_f.PEMOD = FWUPDATE_PEMOD_SINGLE_PROGRAM;
+    *((volatile uint32_t *)FWUPDATE_STAGING_ADDR) = 0u;
+    fwupdate_wait_operation(refresh_wdt);
+    fwupdate_wait_ready();
+
+    // reset, without NVIC_SystemReset() (which may not be inlined)
+    __DSB();
+    SCB->AIRCR = (0x5FAul << SCB_AIRCR_VECTKEY_Pos) | (SCB->AIRCR & SCB_AIRCR_PRIGROUP_Msk) | SCB_AIRCR_SYSRESETREQ_Msk;
+    __DSB();
+    while (true)
+        ;
+}
+
+//
+// update state
+//
+static struct
+{
+    bool active;
+    uint32_t size;
+    uint32_t written;
+
+    /**
+     * @brief bytes of the image already programmed
+     */
+    uint32_t programmed;
+
+    /**
+     * @brief CRC of the received data
+     */
+    crc_context_t crc;
+
+    uint8_t buffer[FWUPDATE_WRITE_BUFFER_SIZE] __attribute__((aligned(4)));
+    size_t buffered;
+} update;
+
+static inline bool is_blank(const uint32_t address, const uint32_t length)
+{
+    const volatile uint32_t *words = reinterpret_cast<const volatile uint32_t *>(address);
+    for (uint32_t i = 0; i < length / 4; i++)
+    {
+        if (words[i] != 0xFFFFFFFFu)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline uint32_t image_crc(const uint32_t size)
+{
+    return crc_calculate(CRC_ALGORITHM_CRC32, reinterpret_cast<const void *>(FWUPDATE_IMAGE_ADDR), size);
+}
+
+/**
+ * @brief does the staged image look like an application for LD_FLASH_START?
+ * @note checks the initial stack pointer and the reset handler of the vector table
+ */
+static bool image_plausible(const uint32_t size)
+{
+    const uint32_t *vectors = reinterpret_cast<const uint32_t *>(FWUPDATE_IMAGE_ADDR);
+    const uint32_t sp = vectors[0];
+    const uint32_t reset = vectors[1] & ~1ul;
+    return size >= 8 &&
+           sp >= FWUPDATE_SRAM_START && sp <= FWUPDATE_SRAM_END + 1 &&
+           reset >= uint32_t(LD_FLASH_START) && reset < uint32_t(LD_FLASH_START) + size;
+}
+
+static bool read_header(fwupdate_header_t &header)
+{
+    memcpy(&header, reinterpret_cast<const void *>(FWUPDATE_STAGING_ADDR), sizeof(header));
+    return header.magic == FWUPDATE_MAGIC &&
+           header.check == ~(header.magic ^ header.size ^ header.crc32) &&
+           header.size > 0 && header.size <= fwupdate_max_image_size();
+}
+
+/**
+ * @brief program the buffered data
+ */
+static en_result_t program_buffer()
+{
+    if (update.buffered == 0)
+    {
+        return Ok;
+    }
+
+    const en_result_t result = Intflash::Flash_Program(FWUPDATE_IMAGE_ADDR + update.programmed, update.buffer, update.buffered);
+    update.programmed += update.buffered;
+    update.buffered = 0;
+    return result;
+}
+
+//
+// public API
+//
+
+uint32_t fwupdate_max_image_size()
+{
+    const uint32_t staging = FWUPDATE_STAGING_SIZE - FWUPDATE_HEADER_SIZE;
+    const uint32_t application = FLASH_OUTAGE_DATA_ADDR - uint32_t(LD_FLASH_START);
+    return staging < application ? staging : application;
+}
+
+en_result_t fwupdate_begin(const uint32_t size)
+{
+    if (size == 0 || size > fwupdate_max_image_size())
+    {
+        CORE_DEBUG_PRINTF("fwupdate: image of %lu bytes does not fit (max %lu)\n", size, fwupdate_max_image_size());
+        return ErrorInvalidParameter;
+    }
+
+    update.active = false;
+
+    // erase all sectors the header and image need. sectors that are already blank are skipped
+    const uint32_t end = FWUPDATE_IMAGE_ADDR + size;
+    for (uint32_t addr = FWUPDATE_STAGING_ADDR; addr < end; addr += FLASH_SECTOR_SIZE)
+    {
+        if (!is_blank(addr, FLASH_SECTOR_SIZE) && Intflash::FlashErasePage(addr) != Ok)
+        {
+            CORE_DEBUG_PRINTF("fwupdate: erasing sector 0x%08lx failed\n", addr);
+            return Error;
+        }
+        yield();
+    }
+
+    update.size = size;
+    update.written = 0;
+    update.programmed = 0;
+    update.buffered = 0;
+    crc_begin(update.crc, CRC_ALGORITHM_CRC32);
+    update.active = true;
+    CORE_DEBUG_PRINTF("fwupdate: receiving %lu bytes\n", size);
+    return Ok;
+}
+
+en_result_t fwupdate_write(const void *data, const size_t length)
+{
+    if (!update.active)
+    {
+        return ErrorInvalidMode;
+    }
+    if (length > update.size - update.written)
+    {
+        fwupdate_abort();
+        return ErrorInvalidParameter;
+    }
+
+    crc_update(update.crc, data, length);
+    update.written += length;
+
+    const uint8_t *src = static_cast<const uint8_t *>(data);
+    size_t remaining = length;
+    while (remaining > 0)
+    {
+        const size_t space = sizeof(update.buffer) - update.buffered;
+        const size_t n = remaining < space ? remaining : space;
+        memcpy(&update.buffer[update.buffered], src, n);
+        update.buffered += n;
+        src += n;
+        remaining -= n;
+
+        if (update.buffered == sizeof(update.buffer) && program_buffer() != Ok)
+        {
+            CORE_DEBUG_PRINTF("fwupdate: programming failed at offset %lu\n", update.programmed);
+            fwupdate_abort();
+            return Error;
+        }
+    }
+
+    return Ok;
+}
+
+en_result_t fwupdate_write_from(Stream &source, const uint32_t length, const uint32_t timeout)
+{
+    uint8_t chunk[64];
+    uint32_t remaining = length;
+    uint32_t last_data = millis();
+    while (remaining > 0)
+    {
+        const int available = source.available();
+        if (available <= 0)
+        {
+            if (millis() - last_data > timeout)
+            {
+                CORE_DEBUG_PRINTF("fwupdate: stream timed out, %lu bytes missing\n", remaining);
+                fwupdate_abort();
+                return ErrorTimeout;
+            }
+
+            yield();
+            continue;
+        }
+
+        size_t n = size_t(available);
+        n = n < sizeof(chunk) ? n : sizeof(chunk);
+        n = n < remaining ? n : remaining;
+        n = source.readBytes(reinterpret_cast<char *>(chunk), n);
+
+        const en_result_t result = fwupdate_write(chunk, n);
+        if (result != Ok)
+        {
+            return result;
+        }
+
+        remaining -= n;
+        last_data = millis();
+    }
+
+    return Ok;
+}
+
+en_result_t fwupdate_finish(const uint32_t *expected_crc32)
+{
+    if (!update.active)
+    {
+        return ErrorInvalidMode;
+    }
+    if (update.written != update.size)
+    {
+        return ErrorNotReady;
+    }
+
+    if (program_buffer() != Ok)
+    {
+        fwupdate_abort();
+        return Error;
+    }
+
+    // the staged image must match what was received, and what the sender sent
+    const uint32_t received_crc = crc_final(update.crc);
+    const uint32_t staged_crc = image_crc(update.size);
+    if (staged_crc != received_crc || (expected_crc32 != NULL && *expected_crc32 != received_crc))
+    {
+        CORE_DEBUG_PRINTF("fwupdate: CRC mismatch (received=%08lx, staged=%08lx)\n", received_crc, staged_crc);
+        fwupdate_abort();
+        return Error;
+    }
+
+    if (!image_plausible(update.size))
+    {
+        CORE_DEBUG_PRINTF("fwupdate: image is not an application for 0x%08lx\n", uint32_t(LD_FLASH_START));
+        fwupdate_abort();
+        return Error;
+    }
+
+    // programming the header marks the image as ready
+    const fwupdate_header_t header = {
+        .magic = FWUPDATE_MAGIC,
+        .size = update.size,
+        .crc32 = staged_crc,
+        .check = ~(FWUPDATE_MAGIC ^ update.size ^ staged_crc),
+    };
+    update.active = false;
+    if (Intflash::Flash_Program(FWUPDATE_STAGING_ADDR, &header, sizeof(header)) != Ok)
+    {
+        return Error;
+    }
+
+    CORE_DEBUG_PRINTF("fwupdate: image of %lu bytes staged, crc=%08lx\n", update.size, staged_crc);
+    return Ok;
+}
+
+void fwupdate_abort()
+{
+    // the header is only programmed by fwupdate_finish(), so the partial image is never applied
+    update.active = false;
+    update.buffered = 0;
+}
+
+bool fwupdate_pending()
+{
+    fwupdate_header_t header;
+    return read_header(header) && image_crc(header.size) == header.crc32;
+}
+
+en_result_t fwupdate_apply()
+{
+    fwupdate_header_t header;
+    if (!read_header(header) || image_crc(header.size) != header.crc32)
+    {
+        return ErrorNotReady;
+    }
+
+    CORE_DEBUG_PRINTF("fwupdate: applying image of %lu bytes\n", header.size);
+    delay(10); // let the debug output drain
+
+    // a running watchdog has a non-zero counter. refreshing a stopped one would start it
+    const bool refresh_wdt = (M4_WDT->SR & 0xFFFFu) != 0;
+
+    EFM_Unlock();
+    EFM_FlashCmd(Enable);
+    while (Set != EFM_GetFlagStatus(EFM_FLAG_RDY))
+        ;
+
+    __disable_irq();
+    fwupdate_copy_and_reset(uint32_t(LD_FLASH_START), FWUPDATE_IMAGE_ADDR, header.size, refresh_wdt);
+    return Error; // never reached
+}
@@ -0,0 +1,129 @@
+/**
+ * in-application firmware update:
+ *
+ * a new firmware image is streamed (from SD, serial or USB) into a staging region of the internal flash, using
+ * sequence programming. the running firmware is not touched while the image is received, so a failed or aborted
+ * transfer leaves the board as it was.
+ *
+ *   +-------------------------------------------+ FWUPDATE_STAGING_ADDR
+ *   | header: magic | size | crc32 | check      |  (programmed last, once the image is verified)
+ *   +-------------------------------------------+ FWUPDATE_STAGING_ADDR + FWUPDATE_HEADER_SIZE
+ *   | image ...                                 |
+ *   +-------------------------------------------+
+ *
+ * once all data was written, fwupdate_finish() reads the staged image back and checks its CRC32 (calculated by the
+ * CRC unit) against the CRC of the received data, and optionally against a CRC given by the sender.
+ * only then the header is programmed, which marks the image as ready.
+ *
+ * fwupdate_apply() copies the staged image over the application at LD_FLASH_START and resets. the copy routine runs
+ * from SRAM with interrupts disabled, as the flash cannot be read while it is erased or programmed. afterwards, the
+ * header is invalidated, so the image is only applied once.
+ * the bootloader below LD_FLASH_START is never written. if power is lost while the image is copied (a few seconds),
+ * the staged image is still valid, and the bootloader's own update path can recover the board.
+ *
+ *   if (fwupdate_begin(size) == Ok &&
+ *       fwupdate_write_from(file, size, 1000) == Ok &&
+ *       fwupdate_finish() == Ok)
+ *   {
+ *       fwupdate_apply();
+ *   }
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <hc32_ddl.h>
+#include "flash.h"
+
+class Stream;
+
+#ifndef FWUPDATE_STAGING_ADDR
+/**
+ * @brief start of the staging region. must be sector aligned
+ * @note by default, the staging region follows the EEPROM emulation sector, and requires a 512 KB part
+ */
+#define FWUPDATE_STAGING_ADDR (FLASH_EEPROM_BASE + FLASH_SECTOR_SIZE)
+#endif
+
+#ifndef FWUPDATE_STAGING_SIZE
+/**
+ * @brief size of the staging region, in bytes. a multiple of the sector size
+ */
+#define FWUPDATE_STAGING_SIZE ((uint32_t)0x00080000U - FWUPDATE_STAGING_ADDR)
+#endif
+
+#ifndef FWUPDATE_WRITE_BUFFER_SIZE
+/**
+ * @brief size of the buffer collecting received data before it is programmed, in bytes
+ * @note a multiple of 4. larger buffers program in fewer, longer steps
+ */
+#define FWUPDATE_WRITE_BUFFER_SIZE 256
+#endif
+
+/**
+ * @brief size of the header at the start of the staging region
+ */
+#define FWUPDATE_HEADER_SIZE 16
+
+/**
+ * @brief maximum size of a firmware image
+ * @note limited by the staging region, and by the application region (LD_FLASH_START up to FLASH_OUTAGE_DATA_ADDR)
+ */
+uint32_t fwupdate_max_image_size();
+
+/**
+ * @brief start receiving a firmware image
+ * @param size size of the image, in bytes
+ * @return Ok on success,
+ *         ErrorInvalidParameter if the image does not fit,
+ *         Error if the staging region could not be erased
+ * @note erases the staging region (including a previously staged image). blocks for a few hundred milliseconds
+ */
+en_result_t fwupdate_begin(const uint32_t size);
+
+/**
+ * @brief write the next part of the image
+ * @param data the data
+ * @param length number of bytes. any length is allowed, data is programmed in FWUPDATE_WRITE_BUFFER_SIZE chunks
+ * @return Ok on success,
+ *         ErrorInvalidMode if no update was started,
+ *         ErrorInvalidParameter if more data than announced to fwupdate_begin() is written,
+ *         Error if programming failed. the update is aborted
+ */
+en_result_t fwupdate_write(const void *data, const size_t length);
+
+/**
+ * @brief write the next part of the image, read from a stream (e.g. a file on SD, Serial or a USB serial)
+ * @param source the stream to read from
+ * @param length number of bytes to read
+ * @param timeout maximum time (in milliseconds) to wait for the next data
+ * @return see fwupdate_write(), or ErrorTimeout if the stream ran dry. the update is aborted on timeout
+ */
+en_result_t fwupdate_write_from(Stream &source, const uint32_t length, const uint32_t timeout);
+
+/**
+ * @brief verify the received image, and mark it as ready to be applied
+ * @param expected_crc32 optional, CRC32 (as CRC_ALGORITHM_CRC32) of the image given by the sender
+ * @return Ok on success,
+ *         ErrorInvalidMode if no update was started,
+ *         ErrorNotReady if less data than announced was written,
+ *         Error if the staged image does not match the received data or the expected CRC. the update is aborted
+ */
+en_result_t fwupdate_finish(const uint32_t *expected_crc32 = NULL);
+
+/**
+ * @brief abort the update. a partially received image is never applied
+ */
+void fwupdate_abort();
+
+/**
+ * @brief is a verified image staged and ready to be applied?
+ * @note reads back the whole image to check its CRC
+ */
+bool fwupdate_pending();
+
+/**
+ * @brief copy the staged image over the application, and reset
+ * @return only returns (with ErrorNotReady) if no verified image is staged
+ * @note interrupts are disabled from here until the reset. a running watchdog is kept refreshed
+ */
+en_result_t fwupdate_apply();
@@ -0,0 +1,108 @@
+#include "boot_profile.h"
+
+#ifdef CORE_BOOT_PROFILING
+#include "../drivers/sysclock/sysclock.h"
+#include "../Print.h"
+#include <hc32_ddl.h>
+#include <stdio.h>
+
+/**
+ * @brief record of a boot phase end
+ */
+typedef struct boot_mark_t
+{
+    /**
+     * @brief DWT cycle count at the end of the phase
+     */
+    uint32_t cycles;
+
+    /**
+     * @brief HCLK at the end of the phase, in Hz
+     * @note 0 if the phase was not marked
+     */
+    uint32_t hclk;
+} boot_mark_t;
+
+static boot_mark_t marks[BOOT_PHASE_COUNT] = {};
+
+// HCLK before the first phase. the core always starts on the reset default clock
+static uint32_t start_hclk = 0;
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    "early init",
+    "default clocks",
+    "sysclock hook",
+    "systick",
+    "debug init",
+    "setup",
+};
+
+/**
+ * @brief read the current HCLK frequency
+ * @note SYSTEM_CLOCK_FREQUENCIES is only valid after the sysclock hook
+ */
+static uint32_t get_hclk()
+{
+    stc_clk_freq_t clkFreq;
+    CLK_GetClockFreq(&clkFreq);
+    return clkFreq.hclkFreq;
+}
+
+void boot_profile_start()
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    start_hclk = get_hclk();
+}
+
+void boot_profile_mark(const boot_phase_t phase)
+{
+    marks[phase].cycles = DWT->CYCCNT;
+    marks[phase].hclk = get_hclk();
+}
+
+uint32_t boot_profile_get(const boot_phase_t phase)
+{
+    if (marks[phase].hclk == 0)
+    {
+        return 0;
+    }
+
+    // phases start at the end of the previous phase, and run at its HCLK
+    uint32_t start_cycles = 0;
+    uint32_t hclk = start_hclk;
+    for (int32_t p = int32_t(phase) - 1; p >= 0; p--)
+    {
+        if (marks[p].hclk != 0)
+        {
+            start_cycles = marks[p].cycles;
+            hclk = marks[p].hclk;
+            break;
+        }
+    }
+
+    const uint64_t cycles = marks[phase].cycles - start_cycles;
+    return static_cast<uint32_t>((cycles * 1000000) / hclk);
+}
+
+void boot_profile_dump(Print &out)
+{
+    out.println("phase           us");
+    uint32_t total = 0;
+    for (uint32_t p = 0; p < BOOT_PHASE_COUNT; p++)
+    {
+        const uint32_t us = boot_profile_get(static_cast<boot_phase_t>(p));
+        total += us;
+
+        char line[48];
+        snprintf(line, sizeof(line), "%-14s  %lu", phase_names[p], us);
+        out.println(line);
+    }
+
+    char line[48];
+    snprintf(line, sizeof(line), "%-14s  %lu", "total", total);
+    out.println(line);
+}
+
+#endif // CORE_BOOT_PROFILING
@@ -0,0 +1,92 @@
+/**
+ * boot profiling:
+ *
+ * with CORE_BOOT_PROFILING defined, the DWT cycle counter is started at the beginning of core_init(), and its value
+ * is recorded at the end of every boot phase, together with the HCLK frequency at that point.
+ * after boot, boot_profile_dump() prints the duration of each phase.
+ *
+ * the clocks change during the sysclock_init hook, so its duration is converted using the HCLK at its start.
+ * thus, it is exact as long as the hook spends most of its time waiting for the oscillators (at the default clock).
+ *
+ * without CORE_BOOT_PROFILING, none of this is compiled.
+ */
+#pragma once
+#include <stdint.h>
+
+/**
+ * @brief boot phases, in order
+ * @note each phase is marked at its end
+ */
+typedef enum boot_phase_t
+{
+    /**
+     * @brief vector table, reset cause check and fault handlers
+     */
+    BOOT_PHASE_EARLY_INIT,
+
+    /**
+     * @brief restore of the default clocks
+     */
+    BOOT_PHASE_DEFAULT_CLOCKS,
+
+    /**
+     * @brief sysclock_init hook
+     */
+    BOOT_PHASE_SYSCLOCK_HOOK,
+
+    /**
+     * @brief SysTick initialization
+     */
+    BOOT_PHASE_SYSTICK,
+
+    /**
+     * @brief CORE_DEBUG initialization
+     */
+    BOOT_PHASE_DEBUG_INIT,
+
+    /**
+     * @brief setup() and its hooks
+     */
+    BOOT_PHASE_SETUP,
+
+    BOOT_PHASE_COUNT,
+} boot_phase_t;
+
+#ifdef CORE_BOOT_PROFILING
+
+/**
+ * @brief start boot profiling
+ * @note called at the beginning of core_init()
+ */
+void boot_profile_start();
+
+/**
+ * @brief record the end of a boot phase
+ * @param phase the phase that ended
+ */
+void boot_profile_mark(const boot_phase_t phase);
+
+/**
+ * @brief get the duration of a boot phase
+ * @param phase the phase
+ * @return duration in microseconds, or 0 if the phase was not marked
+ */
+uint32_t boot_profile_get(const boot_phase_t phase);
+
+class Print;
+
+/**
+ * @brief print the duration of all boot phases
+ * @param out where to print to, e.g. Serial
+ */
+void boot_profile_dump(Print &out);
+
+#define BOOT_PROFILE_START() boot_profile_start()
+#define BOOT_PROFILE_MARK(phase) boot_profile_mark(phase)
+
+#else
+
+#define BOOT_PROFILE_START()
+#define BOOT_PROFILE_MARK(phase)
+
+#endif // CORE_BOOT_PROFILING
@@ -1,22 +1,45 @@
 #include "init.h"
+#include "boot_profile.h"
+#include "warm_restart.h"
 #include "../drivers/sysclock/sysclock.h"
 #include "../drivers/sysclock/sysclock_util.h"
 #include "../drivers/sysclock/systick.h"
 #include "../drivers/panic/fault_handlers.h"
+#include "../drivers/irqn/irq_priority.h"
 #include "../core_debug.h"
 #include "../core_hooks.h"
+#include "../core_stack.h"
+#include "../core_trace.h"
 #include <hc32_ddl.h>
+#include <string.h>
+
+#ifdef CORE_SRAM_SECTIONS
+// SRAM placement sections, from tools/ld/sram_sections.ld
+extern "C" uint8_t __sramh_start__[];
+extern "C" uint8_t __sramh_end__[];
+extern "C" uint8_t __sram_dma_start__[];
+extern "C" uint8_t __sram_dma_end__[];
+
+/**
+ * @brief zero the SRAM placement sections
+ * @note the startup code only zeroes .bss, so this runs from .preinit_array, before any static constructor
+ */
+static void zero_sram_sections()
+{
+    memset(__sramh_start__, 0, __sramh_end__ - __sramh_start__);
+    memset(__sram_dma_start__, 0, __sram_dma_end__ - __sram_dma_start__);
+}
+
+__attribute__((section(".preinit_array"), used)) static void (*const zero_sram_sections_entry)() = zero_sram_sections;
+#endif
 
 /**
  * @brief check if the last reset was caused by a
  *        configuration fault (e.g. XTAL fault) that could be reoccuring
+ * @param cause the reset cause
  */
-inline void check_reoccuring_reset_fault()
+inline void check_reoccuring_reset_fault(const stc_rmu_rstcause_t &cause)
 {
-    // get reset cause
-    stc_rmu_rstcause_t cause;
-    RMU_GetResetCause(&cause);
-
     // check for possibly reoccuring faults:
 #define CHECK_RSTCAUSE(cause, msg) \
     if (cause == Set)              \
@@ -31,6 +54,13 @@ inline void check_reoccuring_reset_fault()
 
 void core_init()
 {
+    BOOT_PROFILE_START();
+
+#if defined(CORE_STACK_MONITOR) || defined(CORE_STACK_GUARD)
+    // paint the main stack and enable the stack guard
+    core_stack_init();
+#endif
+
 #if defined(__CC_ARM) && defined(__TARGET_FPU_VFP)
     SCB->CPACR |= 0x00F00000;
 #endif
@@ -38,22 +68,54 @@ void core_init()
     // setup vector table offset
     SCB->VTOR = (uint32_t(LD_FLASH_START) & SCB_VTOR_TBLOFF_Msk);
 
-    // check if last reset could be reoccuring
-    check_reoccuring_reset_fault();
+    // get reset cause
+    stc_rmu_rstcause_t cause;
+    RMU_GetResetCause(&cause);
+
+#ifdef CORE_WARM_RESTART
+    // a warm restart is only detected after a clean software or watchdog reset, so the reset fault check is redundant
+    if (!warm_restart_init(cause))
+#endif
+    {
+        // check if last reset could be reoccuring
+        check_reoccuring_reset_fault(cause);
+    }
 
     // setup fault handling
     fault_handlers_init();
 
+    // set the priority grouping before any interrupt is enabled
+    irq_priority_init();
+    BOOT_PROFILE_MARK(BOOT_PHASE_EARLY_INIT);
+
     // initialize system clock:
-    // - restore default clock settings
+    // - restore default clock settings, unless already at reset defaults (= not left configured by a bootloader)
 #ifndef CORE_DONT_RESTORE_DEFAULT_CLOCKS
-    sysclock_restore_default_clocks();
+    if (!sysclock_is_default_clocks())
+    {
+        sysclock_restore_default_clocks();
+    }
+    else
+    {
+        sysclock_configure_flash_cache();
+    }
 #endif
+    BOOT_PROFILE_MARK(BOOT_PHASE_DEFAULT_CLOCKS);
 
     // - call user setup hook
     core_hook_sysclock_init();
     update_system_clock_frequencies();
+#ifdef CORE_WARM_RESTART
+    warm_restart_check_clocks();
+#endif
+    BOOT_PROFILE_MARK(BOOT_PHASE_SYSCLOCK_HOOK);
 
     // initialize systick
     systick_init();
+    BOOT_PROFILE_MARK(BOOT_PHASE_SYSTICK);
+
+#ifdef CORE_TRACE
+    // start event tracing, now that HCLK is final
+    core_trace_init();
+#endif
 }
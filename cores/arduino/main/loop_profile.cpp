@@ -0,0 +1,164 @@
+#include "loop_profile.h"
+
+#ifdef CORE_LOOP_PROFILING
+#include "../drivers/sysclock/sysclock.h"
+#include "../drivers/sysclock/sysclock_switch.h"
+#include "../drivers/sysclock/systick.h"
+#include "../drivers/irqn/irq_profile.h"
+#include "../core_idle.h"
+#include "../core_critical.h"
+#include "../core_util.h"
+#include "../Print.h"
+#include <hc32_ddl.h>
+
+static loop_profile_stats_t stats = {};
+
+/**
+ * @brief cycle count the current iteration began at
+ */
+static uint32_t iteration_start = 0;
+
+/**
+ * @brief the deadline, in microseconds. 0 if disabled
+ */
+static uint32_t deadline_us = 0;
+
+/**
+ * @brief iterations longer than this many cycles are late. 0 if disabled
+ * @note derived from deadline_us and HCLK, and re-derived on clock changes
+ */
+static uint32_t deadline_cycles = 0;
+
+static sysclock_listener_t clock_listener = {};
+
+// counter values at the last reset
+static uint64_t reset_cycles = 0;
+static uint64_t reset_idle_cycles = 0;
+static uint64_t reset_isr_cycles = 0;
+
+/**
+ * @brief get the cycles spent in IRQ handlers, if known
+ */
+static inline uint64_t get_isr_cycles()
+{
+#ifdef CORE_IRQ_PROFILING
+    return irq_profile_get_total_cycles();
+#else
+    return 0;
+#endif
+}
+
+void loop_profile_start()
+{
+    core_cycle_counter_enable();
+    loop_profile_reset();
+}
+
+void loop_profile_begin()
+{
+    iteration_start = DWT->CYCCNT;
+}
+
+void loop_profile_end()
+{
+    const uint32_t cycles = DWT->CYCCNT - iteration_start;
+
+    stats.iterations++;
+    stats.total_cycles += cycles;
+    if (cycles < stats.min_cycles)
+    {
+        stats.min_cycles = cycles;
+    }
+    if (cycles > stats.max_cycles)
+    {
+        stats.max_cycles = cycles;
+    }
+    if (deadline_cycles != 0 && cycles > deadline_cycles)
+    {
+        stats.late_count++;
+    }
+}
+
+/**
+ * @brief convert the deadline to cycles of the current HCLK
+ */
+static void update_deadline_cycles()
+{
+    deadline_cycles = static_cast<uint32_t>((uint64_t(deadline_us) * SYSTEM_CLOCK_FREQUENCIES.hclk) / 1000000);
+}
+
+static void clock_changed(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)previous;
+    (void)param;
+    if (phase == SYSCLOCK_CHANGE_POST)
+    {
+        update_deadline_cycles();
+    }
+}
+
+void loop_profile_set_deadline(const uint32_t us)
+{
+    sysclock_listener_register(&clock_listener, clock_changed, nullptr);
+
+    const uint32_t critical = core_critical_enter();
+    deadline_us = us;
+    update_deadline_cycles();
+    core_critical_exit(critical);
+}
+
+void loop_profile_get(loop_profile_stats_t &out)
+{
+    const uint32_t critical = core_critical_enter();
+    out = stats;
+    out.elapsed_cycles = systick_cycles64() - reset_cycles;
+    out.idle_cycles = core_idle_get_cycles() - reset_idle_cycles;
+    out.isr_cycles = get_isr_cycles() - reset_isr_cycles;
+    core_critical_exit(critical);
+
+    const uint64_t busy = out.idle_cycles + out.isr_cycles;
+    out.thread_cycles = out.elapsed_cycles > busy ? out.elapsed_cycles - busy : 0;
+    if (out.iterations == 0)
+    {
+        out.min_cycles = 0;
+    }
+}
+
+void loop_profile_reset()
+{
+    const uint32_t critical = core_critical_enter();
+    stats = {};
+    stats.min_cycles = UINT32_MAX;
+    reset_cycles = systick_cycles64();
+    reset_idle_cycles = core_idle_get_cycles();
+    reset_isr_cycles = get_isr_cycles();
+    core_critical_exit(critical);
+}
+
+/**
+ * @brief get a part of the elapsed time, in 0.01 %
+ */
+static uint32_t share(const uint64_t cycles, const uint64_t elapsed)
+{
+    return elapsed == 0 ? 0 : static_cast<uint32_t>((cycles * 10000) / elapsed);
+}
+
+void loop_profile_dump(Print &out)
+{
+    loop_profile_stats_t s;
+    loop_profile_get(s);
+
+    const uint32_t avg = s.iterations == 0 ? 0 : static_cast<uint32_t>(s.total_cycles / s.iterations);
+    const uint32_t thread = share(s.thread_cycles, s.elapsed_cycles);
+    const uint32_t isr = share(s.isr_cycles, s.elapsed_cycles);
+    const uint32_t idle = share(s.idle_cycles, s.elapsed_cycles);
+
+    out.printf("loop iterations: %lu, late: %lu\n", s.iterations, s.late_count);
+    out.printf("loop cycles min/avg/max: %lu / %lu / %lu\n", s.min_cycles, avg, s.max_cycles);
+    out.printf("thread: %lu.%02lu%%, isr: %lu.%02lu%%, idle: %lu.%02lu%%\n",
+               thread / 100, thread % 100,
+               isr / 100, isr % 100,
+               idle / 100, idle % 100);
+}
+
+#endif // CORE_LOOP_PROFILING
@@ -0,0 +1,131 @@
+/**
+ * main loop profiling:
+ *
+ * with CORE_LOOP_PROFILING defined, every iteration of the main loop (core_hook_loop(), deferred services and
+ * loop()) is measured using the DWT cycle counter. the iteration count, and the minimum, average and maximum
+ * iteration duration are recorded. sleeping in core_idle_sleep() is not part of the iteration.
+ *
+ * in addition, the time since the last reset is split into
+ * - idle: sleeping in core_idle_sleep(), with CORE_ENABLE_IDLE_SLEEP
+ * - interrupts: running IRQ handlers, with CORE_IRQ_PROFILING. only IRQs registered using enIrqRegistration() are
+ *   counted, SysTick and the fault handlers are not
+ * - thread: everything else
+ * without CORE_IRQ_PROFILING, interrupt time is not known and counted as thread time.
+ *
+ * a deadline can be set, and iterations taking longer are counted. this shows when a configuration change
+ * pushes the main loop towards missed deadlines (e.g. a full planner buffer or serial overruns).
+ *
+ * without CORE_LOOP_PROFILING, none of this is compiled.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef CORE_LOOP_PROFILING
+
+/**
+ * @brief main loop profiling statistics
+ */
+typedef struct loop_profile_stats_t
+{
+    /**
+     * @brief number of main loop iterations
+     */
+    uint32_t iterations;
+
+    /**
+     * @brief shortest iteration, in cycles
+     */
+    uint32_t min_cycles;
+
+    /**
+     * @brief longest iteration, in cycles
+     */
+    uint32_t max_cycles;
+
+    /**
+     * @brief cumulative iteration cycles
+     */
+    uint64_t total_cycles;
+
+    /**
+     * @brief number of iterations longer than the deadline
+     */
+    uint32_t late_count;
+
+    /**
+     * @brief cycles since the last reset
+     */
+    uint64_t elapsed_cycles;
+
+    /**
+     * @brief cycles spent sleeping in core_idle_sleep()
+     */
+    uint64_t idle_cycles;
+
+    /**
+     * @brief cycles spent in IRQ handlers
+     * @note only known with CORE_IRQ_PROFILING, 0 otherwise
+     */
+    uint64_t isr_cycles;
+
+    /**
+     * @brief cycles spent in thread mode, not sleeping
+     */
+    uint64_t thread_cycles;
+} loop_profile_stats_t;
+
+/**
+ * @brief start main loop profiling
+ * @note called by main() before the first iteration of the main loop
+ */
+void loop_profile_start();
+
+/**
+ * @brief mark the begin of a main loop iteration
+ */
+void loop_profile_begin();
+
+/**
+ * @brief mark the end of a main loop iteration
+ */
+void loop_profile_end();
+
+/**
+ * @brief set the deadline of a main loop iteration
+ * @param us the deadline, in microseconds. 0 to disable
+ * @note the deadline is converted to cycles using the current HCLK, and again on every clock switch
+ */
+void loop_profile_set_deadline(const uint32_t us);
+
+/**
+ * @brief get the main loop profiling statistics
+ * @param stats the statistics since the last reset
+ */
+void loop_profile_get(loop_profile_stats_t &stats);
+
+/**
+ * @brief reset the main loop profiling statistics
+ * @note the deadline is kept
+ */
+void loop_profile_reset();
+
+class Print;
+
+/**
+ * @brief print the main loop profiling statistics
+ * @param out where to print to, e.g. Serial
+ */
+void loop_profile_dump(Print &out);
+
+#define LOOP_PROFILE_START() loop_profile_start()
+#define LOOP_PROFILE_BEGIN() loop_profile_begin()
+#define LOOP_PROFILE_END() loop_profile_end()
+
+#else
+
+#define LOOP_PROFILE_START()
+#define LOOP_PROFILE_BEGIN()
+#define LOOP_PROFILE_END()
+
+#endif // CORE_LOOP_PROFILING
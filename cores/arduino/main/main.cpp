@@ -1,26 +1,63 @@
 #include "../Arduino.h"
 #include "init.h"
+#include "boot_profile.h"
+#include "loop_profile.h"
 #include "../core_debug.h"
 #include "../core_hooks.h"
+#include "../core_idle.h"
+
+// soft-timer service, only linked if soft-timers are used
+__attribute__((weak)) void softtimer_run_deferred();
+
+// background flash service, only linked if flash jobs are used
+extern "C" __attribute__((weak)) void flash_async_poll(void);
+
+// deferred calls, only linked if calls are posted
+extern "C" __attribute__((weak)) size_t core_defer_run(void);
 
 int main(void)
 {
 	// initialize SoC, then CORE_DEBUG
 	core_init();
 	CORE_DEBUG_INIT();
+	BOOT_PROFILE_MARK(BOOT_PHASE_DEBUG_INIT);
 
 	// call setup()
 	core_hook_pre_setup();
 	CORE_DEBUG_PRINTF("core entering setup\n");
 	setup();
 	core_hook_post_setup();
+	BOOT_PROFILE_MARK(BOOT_PHASE_SETUP);
 	
 	// call loop() forever
 	CORE_DEBUG_PRINTF("core entering main loop\n");
+	LOOP_PROFILE_START();
 	while (1)
 	{
+		LOOP_PROFILE_BEGIN();
 		core_hook_loop();
+		if (softtimer_run_deferred != nullptr)
+		{
+			softtimer_run_deferred();
+		}
+
+		if (flash_async_poll != nullptr)
+		{
+			flash_async_poll();
+		}
+
+		if (core_defer_run != nullptr)
+		{
+			core_defer_run();
+		}
+
 		loop();
+		LOOP_PROFILE_END();
+
+#ifdef CORE_ENABLE_IDLE_SLEEP
+		// sleep until the next interrupt if nothing is pending
+		core_idle_sleep();
+#endif
 	}
 
 	CORE_ASSERT_FAIL("main loop exited");
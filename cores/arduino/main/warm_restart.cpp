@@ -0,0 +1,199 @@
+#include "warm_restart.h"
+
+#ifdef CORE_WARM_RESTART
+#ifndef CORE_SRAM_SECTIONS
+#error "CORE_WARM_RESTART requires the SRAM placement sections (board_build.sram_sections)"
+#endif
+
+#include "../core_util.h"
+#include "../drivers/sysclock/sysclock.h"
+#include <string.h>
+
+/**
+ * @brief warm restart record magic value, "WARM"
+ */
+#define WARM_RESTART_MAGIC 0x4D524157ul
+
+/**
+ * @brief version of the warm restart record layout
+ */
+#define WARM_RESTART_VERSION 1
+
+/**
+ * @brief the next software reset was requested by warm_restart_reset()
+ */
+#define WARM_RESTART_FLAG_REQUESTED (1u << 0)
+
+/**
+ * @brief state kept through a warm restart
+ */
+typedef struct warm_restart_record_t
+{
+    uint32_t magic;
+    uint16_t version;
+    uint8_t flags;    // WARM_RESTART_FLAG_*
+    uint8_t restarts; // warm restarts since the last commit
+
+    /**
+     * @brief clock frequencies at the time of the commit
+     */
+    system_clock_frequencies_t clocks;
+
+    /**
+     * @brief application data
+     */
+    uint32_t data[(WARM_RESTART_DATA_SIZE + 3) / 4];
+
+    /**
+     * @brief checksum over all previous words
+     */
+    uint32_t checksum;
+} warm_restart_record_t;
+
+// size of the record, without the checksum
+#define WARM_RESTART_CHECKSUM_WORDS ((sizeof(warm_restart_record_t) - sizeof(uint32_t)) / sizeof(uint32_t))
+
+/**
+ * @brief the warm restart record, kept through resets
+ */
+static warm_restart_record_t warm_restart_record CORE_RET_SRAM_NOINIT;
+
+/**
+ * @brief reset cause of this boot
+ */
+static stc_rmu_rstcause_t reset_cause;
+
+/**
+ * @brief is this boot a warm restart?
+ */
+static bool is_warm_restart = false;
+
+/**
+ * @brief calculate the checksum of the record
+ */
+static uint32_t warm_restart_checksum()
+{
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(&warm_restart_record);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < WARM_RESTART_CHECKSUM_WORDS; i++)
+    {
+        // rotate, so swapped words change the checksum
+        sum = ((sum << 5) | (sum >> 27)) ^ words[i];
+    }
+
+    return ~sum;
+}
+
+/**
+ * @brief is the record intact?
+ */
+static bool warm_restart_record_valid()
+{
+    return warm_restart_record.magic == WARM_RESTART_MAGIC &&
+           warm_restart_record.version == WARM_RESTART_VERSION &&
+           warm_restart_record.checksum == warm_restart_checksum();
+}
+
+/**
+ * @brief was the reset a clean software or watchdog reset?
+ * @param requested was the software reset requested by warm_restart_reset()?
+ */
+static bool is_clean_reset(const stc_rmu_rstcause_t &cause, const bool requested)
+{
+    // any of these means the retained state cannot be trusted, or the reset was not meant to be warm
+    if (cause.enPowerOn == Set || cause.enRstPin == Set || cause.enBrownOut == Set ||
+        cause.enPvd1 == Set || cause.enPvd2 == Set || cause.enPowerDown == Set ||
+        cause.enXtalErr == Set || cause.enClkFreqErr == Set ||
+        cause.enRamEcc == Set || cause.enRamParityErr == Set || cause.enMpuErr == Set)
+    {
+        return false;
+    }
+
+    // panics and faults reset using a software reset as well, so only requested ones count
+    if (cause.enSoftware == Set)
+    {
+        return requested;
+    }
+
+    return cause.enWdt == Set || cause.enSwdt == Set;
+}
+
+/**
+ * @brief start over with zeroed data, not yet committed
+ */
+static void warm_restart_cold_boot()
+{
+    is_warm_restart = false;
+    memset(&warm_restart_record, 0, sizeof(warm_restart_record));
+}
+
+bool warm_restart_init(const stc_rmu_rstcause_t &cause)
+{
+    reset_cause = cause;
+    RMU_ClrResetFlag();
+
+    if (!warm_restart_record_valid() ||
+        !is_clean_reset(cause, (warm_restart_record.flags & WARM_RESTART_FLAG_REQUESTED) != 0) ||
+        warm_restart_record.restarts >= WARM_RESTART_MAX_RESTARTS)
+    {
+        warm_restart_cold_boot();
+        return false;
+    }
+
+    // count the restart, so a state that keeps hanging the application is eventually dropped
+    warm_restart_record.flags &= ~WARM_RESTART_FLAG_REQUESTED;
+    warm_restart_record.restarts++;
+    warm_restart_record.checksum = warm_restart_checksum();
+
+    is_warm_restart = true;
+    return true;
+}
+
+void warm_restart_check_clocks()
+{
+    if (is_warm_restart && memcmp(&warm_restart_record.clocks, &SYSTEM_CLOCK_FREQUENCIES, sizeof(SYSTEM_CLOCK_FREQUENCIES)) != 0)
+    {
+        // the timing the application state depends on changed, e.g. with a new firmware
+        warm_restart_cold_boot();
+    }
+}
+
+bool warm_restart_detected()
+{
+    return is_warm_restart;
+}
+
+const stc_rmu_rstcause_t &warm_restart_get_reset_cause()
+{
+    return reset_cause;
+}
+
+void *warm_restart_data()
+{
+    return warm_restart_record.data;
+}
+
+void warm_restart_commit()
+{
+    warm_restart_record.magic = WARM_RESTART_MAGIC;
+    warm_restart_record.version = WARM_RESTART_VERSION;
+    warm_restart_record.flags = 0;
+    warm_restart_record.restarts = 0;
+    warm_restart_record.clocks = SYSTEM_CLOCK_FREQUENCIES;
+    warm_restart_record.checksum = warm_restart_checksum();
+}
+
+void warm_restart_invalidate()
+{
+    warm_restart_record.magic = 0;
+}
+
+void warm_restart_reset()
+{
+    warm_restart_commit();
+    warm_restart_record.flags = WARM_RESTART_FLAG_REQUESTED;
+    warm_restart_record.checksum = warm_restart_checksum();
+    NVIC_SystemReset();
+}
+
+#endif // CORE_WARM_RESTART
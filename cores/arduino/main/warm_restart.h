@@ -0,0 +1,105 @@
+/**
+ * warm restart:
+ *
+ * after a watchdog or software reset, the application would normally redo its whole initialization (homing,
+ * mounting the SD card, ...) before it can resume. with CORE_WARM_RESTART defined, it instead keeps the state
+ * it needs to resume in a block of Ret_SRAM (warm_restart_data()), and commits it whenever it is consistent
+ * (warm_restart_commit()).
+ *
+ * on the next boot, core_init() treats the reset as a warm restart if
+ * - it was a software reset requested with warm_restart_reset(), or a watchdog reset (WDT or SWDT).
+ *   any other reset cause (power-on, reset pin, brown-out, a panic or fault, ...) makes it a cold boot.
+ * - the retained block is intact (magic and checksum).
+ * - the clock frequencies set up by the sysclock_init hook match the ones at the time of the commit.
+ * - fewer than WARM_RESTART_MAX_RESTARTS warm restarts happened since the last commit, so a retained state
+ *   that makes the application hang does not cause an endless watchdog reset loop.
+ * if so, warm_restart_detected() returns true, and setup() can take its fast path using the retained data.
+ * the check for reoccuring reset faults is skipped, since the reset cause is already known to be clean.
+ *
+ * all clock and peripheral registers are reset by hardware, so the sysclock_init hook and the begin() calls of
+ * the drivers still run. what is kept is the state validated by the application, not register contents.
+ *
+ * enable with CORE_WARM_RESTART. requires the SRAM placement sections (board_build.sram_sections),
+ * since Ret_SRAM is only kept through a reset with its own no-init section.
+ *
+ *   void setup()
+ *   {
+ *       machine_state_t *state = static_cast<machine_state_t *>(warm_restart_data());
+ *       if (!warm_restart_detected())
+ *       {
+ *           home_all_axes(state);
+ *           warm_restart_commit();
+ *       }
+ *   }
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <hc32_ddl.h>
+
+#ifndef WARM_RESTART_DATA_SIZE
+/**
+ * @brief size of the application data kept through a warm restart, in bytes
+ * @note shares the 4K Ret_SRAM with the crash record
+ */
+#define WARM_RESTART_DATA_SIZE 256
+#endif
+
+#ifndef WARM_RESTART_MAX_RESTARTS
+/**
+ * @brief maximum number of warm restarts without a warm_restart_commit() in between
+ */
+#define WARM_RESTART_MAX_RESTARTS 3
+#endif
+
+#ifdef CORE_WARM_RESTART
+
+/**
+ * @brief check the reset cause and the retained state
+ * @param cause the reset cause. the reset flags are cleared afterwards, so the next boot sees only its own cause
+ * @return true if this boot is a warm restart (so far). the clocks are checked later by warm_restart_check_clocks()
+ * @note called by core_init(), before any other initialization
+ */
+bool warm_restart_init(const stc_rmu_rstcause_t &cause);
+
+/**
+ * @brief check that the clocks match the ones of the retained state
+ * @note called by core_init(), after the sysclock_init hook. falls back to a cold boot on a mismatch
+ */
+void warm_restart_check_clocks();
+
+/**
+ * @brief is this boot a warm restart, with the retained data valid?
+ */
+bool warm_restart_detected();
+
+/**
+ * @brief get the reset cause of this boot
+ * @note the reset flags are cleared by core_init(), so use this instead of RMU_GetResetCause()
+ */
+const stc_rmu_rstcause_t &warm_restart_get_reset_cause();
+
+/**
+ * @brief get the application data kept through a warm restart
+ * @return WARM_RESTART_DATA_SIZE bytes in Ret_SRAM, word-aligned. zeroed on a cold boot
+ * @note changes only take effect for the next warm restart once they are committed
+ */
+void *warm_restart_data();
+
+/**
+ * @brief mark the application data as consistent, so the next software or watchdog reset is a warm restart
+ * @note calculates the checksum over the data, so call it after a set of changes rather than after each of them
+ */
+void warm_restart_commit();
+
+/**
+ * @brief make the next reset a cold boot
+ */
+void warm_restart_invalidate();
+
+/**
+ * @brief commit the application data, and reset into a warm restart
+ */
+void warm_restart_reset() __attribute__((noreturn));
+
+#endif // CORE_WARM_RESTART
@@ -17,23 +17,269 @@
 */
 
 #include <stdlib.h>
+#include "core_alloc.h"
 
-void *operator new(size_t size)
+#ifndef CORE_POOL_ALLOCATOR
+
+static inline void *core_alloc(size_t size)
 {
     return malloc(size);
 }
 
+static inline void core_free(void *ptr)
+{
+    free(ptr);
+}
+
+#else
+#include <malloc.h>
+#include "core_critical.h"
+
+/**
+ * @brief a pool of fixed-size blocks
+ */
+typedef struct pool_t
+{
+    /**
+     * @brief size of each block
+     */
+    const size_t block_size;
+
+    /**
+     * @brief number of blocks
+     */
+    const size_t block_count;
+
+    /**
+     * @brief storage of the blocks
+     */
+    uint8_t *const storage;
+
+    /**
+     * @brief first free block. each free block holds the pointer to the next one
+     */
+    void *free_list;
+
+    /**
+     * @brief number of free blocks
+     */
+    size_t free_count;
+
+    /**
+     * @brief was the free list built?
+     */
+    bool initialized;
+} pool_t;
+
+#define POOL_STORAGE(size) \
+    static uint8_t pool_storage_##size[(CORE_POOL_COUNT_##size) * (size)] __attribute__((aligned(8)))
+
+#define POOL(size)                             \
+    {                                          \
+        .block_size = size,                    \
+        .block_count = CORE_POOL_COUNT_##size, \
+        .storage = pool_storage_##size,        \
+        .free_list = nullptr,                  \
+        .free_count = 0,                       \
+        .initialized = false,                  \
+    }
+
+POOL_STORAGE(16);
+POOL_STORAGE(32);
+POOL_STORAGE(64);
+POOL_STORAGE(128);
+
+// ordered by block size, smallest first
+static pool_t pools[] = {
+    POOL(16),
+    POOL(32),
+    POOL(64),
+    POOL(128),
+};
+
+static core_alloc_stats_t stats = {};
+
+/**
+ * @brief build the free list of a pool on first use
+ * @note in a critical section
+ */
+static void pool_init(pool_t &pool)
+{
+    pool.initialized = true;
+    pool.free_list = nullptr;
+    for (size_t i = pool.block_count; i > 0; i--)
+    {
+        void **block = reinterpret_cast<void **>(pool.storage + ((i - 1) * pool.block_size));
+        *block = pool.free_list;
+        pool.free_list = block;
+    }
+    pool.free_count = pool.block_count;
+}
+
+/**
+ * @brief get the pool a pointer belongs to
+ * @return the pool, or nullptr if the pointer is not in any pool
+ */
+static pool_t *pool_of(const void *ptr)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(ptr);
+    for (pool_t &pool : pools)
+    {
+        if (p >= pool.storage && p < pool.storage + (pool.block_count * pool.block_size))
+        {
+            return &pool;
+        }
+    }
+
+    return nullptr;
+}
+
+static inline void stats_add(const size_t bytes)
+{
+    stats.bytes_in_use += bytes;
+    if (stats.bytes_in_use > stats.peak_bytes_in_use)
+    {
+        stats.peak_bytes_in_use = stats.bytes_in_use;
+    }
+}
+
+static void *core_alloc(size_t size)
+{
+    const uint32_t critical = core_critical_enter();
+
+    // smallest pool that fits and has a free block
+    for (pool_t &pool : pools)
+    {
+        if (pool.block_size < size || pool.block_count == 0)
+        {
+            continue;
+        }
+
+        if (!pool.initialized)
+        {
+            pool_init(pool);
+        }
+
+        if (pool.free_list != nullptr)
+        {
+            void *block = pool.free_list;
+            pool.free_list = *static_cast<void **>(block);
+            pool.free_count--;
+            stats_add(pool.block_size);
+            core_critical_exit(critical);
+            return block;
+        }
+    }
+    core_critical_exit(critical);
+
+    // fall back to the heap
+    void *ptr = malloc(size);
+
+    const uint32_t critical_heap = core_critical_enter();
+    if (ptr == nullptr)
+    {
+        stats.failed_allocations++;
+    }
+    else
+    {
+        stats.heap_allocations++;
+        stats_add(malloc_usable_size(ptr));
+    }
+    core_critical_exit(critical_heap);
+    return ptr;
+}
+
+static void core_free(void *ptr)
+{
+    if (ptr == nullptr)
+    {
+        return;
+    }
+
+    pool_t *pool = pool_of(ptr);
+    if (pool == nullptr)
+    {
+        const size_t size = malloc_usable_size(ptr);
+        free(ptr);
+
+        const uint32_t critical = core_critical_enter();
+        stats.bytes_in_use -= size;
+        core_critical_exit(critical);
+        return;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    *static_cast<void **>(ptr) = pool->free_list;
+    pool->free_list = ptr;
+    pool->free_count++;
+    stats.bytes_in_use -= pool->block_size;
+    core_critical_exit(critical);
+}
+
+void core_alloc_get_stats(core_alloc_stats_t &out)
+{
+    // mallinfo() may take the malloc lock, so call it outside the critical section
+    const struct mallinfo info = mallinfo();
+
+    const uint32_t critical = core_critical_enter();
+    out = stats;
+    out.largest_free_block = 0;
+    for (const pool_t &pool : pools)
+    {
+        // uninitialized pools are fully free
+        if (pool.block_count > 0 && (!pool.initialized || pool.free_count > 0))
+        {
+            out.largest_free_block = pool.block_size;
+        }
+    }
+    core_critical_exit(critical);
+
+    out.heap_free_bytes = info.fordblks;
+}
+
+size_t core_alloc_get_free_blocks(const size_t block_size)
+{
+    for (const pool_t &pool : pools)
+    {
+        if (pool.block_size == block_size)
+        {
+            return pool.initialized ? pool.free_count : pool.block_count;
+        }
+    }
+
+    return 0;
+}
+
+#endif // CORE_POOL_ALLOCATOR
+
+void *operator new(size_t size)
+{
+    return core_alloc(size);
+}
+
 void *operator new[](size_t size)
 {
-    return malloc(size);
+    return core_alloc(size);
 }
 
 void operator delete(void *ptr)
 {
-    free(ptr);
+    core_free(ptr);
 }
 
 void operator delete[](void *ptr)
 {
-    free(ptr);
-}
\ No newline at end of file
+    core_free(ptr);
+}
+
+void operator delete(void *ptr, size_t size)
+{
+    (void)size;
+    core_free(ptr);
+}
+
+void operator delete[](void *ptr, size_t size)
+{
+    (void)size;
+    core_free(ptr);
+}
@@ -0,0 +1,159 @@
+#include "parse_number.h"
+
+// maximum number of significant digits kept in the mantissa. 10^9 < 2^32
+#define MAX_MANTISSA_DIGITS 9
+
+// 10^n as float, for n = 0 .. 10. all exactly representable
+static const float pow10_float[] = {
+    1e0f,
+    1e1f,
+    1e2f,
+    1e3f,
+    1e4f,
+    1e5f,
+    1e6f,
+    1e7f,
+    1e8f,
+    1e9f,
+    1e10f,
+};
+
+/**
+ * @brief parse an optional sign
+ * @return number of characters parsed
+ */
+static size_t parse_sign(const char *str, size_t length, bool *negative)
+{
+    *negative = false;
+    if (length > 0 && (str[0] == '-' || str[0] == '+'))
+    {
+        *negative = (str[0] == '-');
+        return 1;
+    }
+
+    return 0;
+}
+
+static inline bool is_digit(const char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+size_t parse_long(const char *str, size_t length, long *value)
+{
+    bool negative;
+    size_t i = parse_sign(str, length, &negative);
+
+    const size_t digits_start = i;
+    unsigned long v = 0;
+    while (i < length && is_digit(str[i]))
+    {
+        v = (v * 10) + (unsigned long)(str[i] - '0');
+        i++;
+    }
+
+    // a sign alone is not a number
+    if (i == digits_start)
+    {
+        return 0;
+    }
+
+    *value = negative ? (long)(0ul - v) : (long)v;
+    return i;
+}
+
+void parse_decimal_push(parse_decimal_t *decimal, uint8_t digit, bool fraction)
+{
+    // leading zeros do not count as significant digits
+    if (decimal->mantissa == 0 && digit == 0)
+    {
+        if (fraction)
+        {
+            decimal->exponent--;
+        }
+        return;
+    }
+
+    if (decimal->digits < MAX_MANTISSA_DIGITS)
+    {
+        decimal->mantissa = (decimal->mantissa * 10) + digit;
+        decimal->digits++;
+        if (fraction)
+        {
+            decimal->exponent--;
+        }
+    }
+    else if (!fraction)
+    {
+        // integer digits beyond the mantissa still scale the value
+        decimal->exponent++;
+    }
+}
+
+size_t parse_float(const char *str, size_t length, float *value)
+{
+    bool negative;
+    size_t i = parse_sign(str, length, &negative);
+
+    parse_decimal_t decimal = {0, 0, 0};
+    bool any_digits = false;
+    bool fraction = false;
+
+    for (; i < length; i++)
+    {
+        const char c = str[i];
+        if (c == '.' && !fraction)
+        {
+            fraction = true;
+            continue;
+        }
+
+        if (!is_digit(c))
+        {
+            break;
+        }
+
+        any_digits = true;
+        parse_decimal_push(&decimal, (uint8_t)(c - '0'), fraction);
+    }
+
+    if (!any_digits)
+    {
+        return 0;
+    }
+
+    const float v = parse_decimal_to_float(decimal.mantissa, decimal.exponent);
+    *value = negative ? -v : v;
+    return i;
+}
+
+float parse_decimal_to_float(uint32_t mantissa, int32_t exponent)
+{
+    if (mantissa == 0)
+    {
+        return 0.0f;
+    }
+
+    // fast path: mantissa and 10^|exponent| are exact in float, so one IEEE operation rounds correctly
+    if (mantissa < (1ul << 24) && exponent >= -10 && exponent <= 10)
+    {
+        return exponent < 0 ? (float)mantissa / pow10_float[-exponent]
+                            : (float)mantissa * pow10_float[exponent];
+    }
+
+    // slow path, through double
+    double v = (double)mantissa;
+    double scale = 1.0;
+    int32_t e = exponent < 0 ? -exponent : exponent;
+    if (e > 60)
+    {
+        // far outside of the float range
+        return exponent < 0 ? 0.0f : __builtin_inff();
+    }
+    while (e-- > 0)
+    {
+        scale *= 10.0;
+    }
+
+    return (float)(exponent < 0 ? v / scale : v * scale);
+}
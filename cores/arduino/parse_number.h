@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * number parsing from contiguous character spans, e.g. a line buffer or the USART ring buffer.
+ *
+ * numbers are an optional '-' or '+', followed by digits, with an optional '.' and fraction digits for floats.
+ * exponents are not parsed, so that e.g. "X1.5E2" in G-code stops at the 'E'.
+ * parsing stops at the first character that is not part of the number, or at the end of the span.
+ */
+
+/**
+ * @brief accumulator for the digits of a decimal number, for parsing one character at a time
+ * @note initialize to all zero. the value is mantissa * 10^exponent
+ */
+typedef struct parse_decimal_t
+{
+    uint32_t mantissa;
+    int32_t exponent;
+    uint8_t digits;
+} parse_decimal_t;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief add a digit to a decimal accumulator
+     * @param decimal the accumulator
+     * @param digit the digit value, 0 .. 9
+     * @param fraction is the digit after the decimal point?
+     * @note keeps up to 9 significant digits. further integer digits only scale the value, and further
+     *       fraction digits are dropped
+     */
+    void parse_decimal_push(parse_decimal_t *decimal, uint8_t digit, bool fraction);
+
+
+    /**
+     * @brief parse a decimal integer
+     * @param str start of the span
+     * @param length length of the span
+     * @param value receives the parsed value. overflows wrap around
+     * @return number of characters parsed, 0 if the span does not start with a number
+     * @note if the return value equals length, the number may continue after the span
+     */
+    size_t parse_long(const char *str, size_t length, long *value);
+
+    /**
+     * @brief parse a decimal number with optional fraction
+     * @param str start of the span
+     * @param length length of the span
+     * @param value receives the parsed value
+     * @return number of characters parsed, 0 if the span does not start with a number
+     * @note if the return value equals length, the number may continue after the span
+     * @note see parse_decimal_to_float() for the precision
+     */
+    size_t parse_float(const char *str, size_t length, float *value);
+
+    /**
+     * @brief convert a decimal mantissa and exponent to float, mantissa * 10^exponent
+     * @note correctly rounded if mantissa < 2^24 and -10 <= exponent <= 10, which covers all numbers with up to
+     *       7 significant digits. only a single float multiply or divide is needed then.
+     *       other values are converted through double, and are rounded twice.
+     */
+    float parse_decimal_to_float(uint32_t mantissa, int32_t exponent);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,307 @@
+#include "powerloss.h"
+#include "flash.h"
+#include "core_debug.h"
+#include "drivers/sysclock/softtimer.h"
+#include <string.h>
+
+#define POWERLOSS_BASE          FLASH_OUTAGE_DATA_ADDR
+#define POWERLOSS_SLOT_COUNT    (FLASH_SECTOR_SIZE / POWERLOSS_SLOT_SIZE)
+#define POWERLOSS_MAGIC         0x52534C50U // "PLSR"
+#define POWERLOSS_ERASED        0xFFFFFFFFU
+
+#define SLOT_ADDRESS(slot) (POWERLOSS_BASE + ((slot) * POWERLOSS_SLOT_SIZE))
+#define WORDS_FOR(size) (((size) + 3) / 4)
+
+/**
+ * @brief record header, followed by the data words and the magic word
+ */
+typedef struct powerloss_header_t
+{
+    uint32_t length;
+    uint32_t sequence;
+    uint32_t checksum;
+} powerloss_header_t;
+
+#define HEADER_WORDS (sizeof(powerloss_header_t) / 4)
+
+static_assert((POWERLOSS_SLOT_SIZE % 4) == 0 && (FLASH_SECTOR_SIZE % POWERLOSS_SLOT_SIZE) == 0,
+              "POWERLOSS_SLOT_SIZE must be a multiple of 4 and a divider of FLASH_SECTOR_SIZE");
+
+static_assert(POWERLOSS_MAX_DATA_SIZE == POWERLOSS_SLOT_SIZE - sizeof(powerloss_header_t) - 4,
+              "POWERLOSS_MAX_DATA_SIZE does not match the record layout");
+
+// record is assembled here before programming, so a save is a single sequence programming run
+static uint32_t record[POWERLOSS_SLOT_SIZE / 4];
+
+static bool initialized = false;
+static uint32_t next_slot = 0;
+static uint32_t next_sequence = 0;
+
+// slot of the latest valid record, or -1 if none
+static int32_t latest_slot = -1;
+
+static volatile bool erase_pending = false;
+static softtimer_t erase_timer = {};
+
+/**
+ * @brief checksum over the record header fields and data words
+ */
+static uint32_t record_checksum(const uint32_t length, const uint32_t sequence, const uint32_t *data)
+{
+    // FNV-1a over words
+    uint32_t hash = 0x811C9DC5U;
+    hash = (hash ^ length) * 0x01000193U;
+    hash = (hash ^ sequence) * 0x01000193U;
+    for (uint32_t i = 0; i < WORDS_FOR(length); i++)
+    {
+        hash = (hash ^ data[i]) * 0x01000193U;
+    }
+
+    // never match the erased state
+    return hash == POWERLOSS_ERASED ? 0 : hash;
+}
+
+/**
+ * @brief check if a slot holds a complete record
+ */
+static bool slot_is_valid(const uint32_t slot)
+{
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(SLOT_ADDRESS(slot));
+    const powerloss_header_t *header = reinterpret_cast<const powerloss_header_t *>(words);
+    if (header->length > POWERLOSS_MAX_DATA_SIZE)
+    {
+        return false;
+    }
+
+    // magic is programmed last, so a save interrupted by power loss never has it
+    const uint32_t *data = words + HEADER_WORDS;
+    return data[WORDS_FOR(header->length)] == POWERLOSS_MAGIC &&
+           header->checksum == record_checksum(header->length, header->sequence, data);
+}
+
+/**
+ * @brief check if a slot is fully erased
+ */
+static bool slot_is_erased(const uint32_t slot)
+{
+    const uint32_t *words = reinterpret_cast<const uint32_t *>(SLOT_ADDRESS(slot));
+    for (uint32_t i = 0; i < POWERLOSS_SLOT_SIZE / 4; i++)
+    {
+        if (words[i] != POWERLOSS_ERASED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void erase_timer_callback(softtimer_t *timer, void *param)
+{
+    (void)timer;
+    (void)param;
+    powerloss_service();
+}
+
+/**
+ * @brief should an erase of the sector be scheduled?
+ * @note the erase is started while one slot is still free, so a save during the erase delay still has a slot.
+ *       the erase rewrites the latest record to slot 0, so erasing with only slot 0 used would free nothing
+ */
+static bool erase_needed()
+{
+    return next_slot >= POWERLOSS_SLOT_COUNT || (next_slot > 1 && next_slot + 1 >= POWERLOSS_SLOT_COUNT);
+}
+
+/**
+ * @brief schedule an erase of the sector from the main loop
+ * @note may be called from interrupts
+ */
+static void schedule_erase()
+{
+    if (erase_pending)
+    {
+        return;
+    }
+
+    erase_pending = true;
+    softtimer_start(&erase_timer, POWERLOSS_ERASE_DELAY, 0, erase_timer_callback, nullptr, SOFTTIMER_CONTEXT_LOOP);
+}
+
+/**
+ * @brief program a record to the next free slot
+ */
+static en_result_t program_record(const void *data, const size_t size)
+{
+    const uint32_t sequence = next_sequence;
+    const uint32_t data_words = WORDS_FOR(size);
+
+    // pad with 0xFF, same as Flash_Program does
+    uint32_t *record_data = record + HEADER_WORDS;
+    record_data[data_words ? data_words - 1 : 0] = POWERLOSS_ERASED;
+    memcpy(record_data, data, size);
+
+    powerloss_header_t *header = reinterpret_cast<powerloss_header_t *>(record);
+    header->length = size;
+    header->sequence = sequence;
+    header->checksum = record_checksum(size, sequence, record_data);
+    record_data[data_words] = POWERLOSS_MAGIC;
+
+    // header, data and magic in one go, magic last
+    const uint32_t slot = next_slot;
+    const en_result_t res = Intflash::Flash_Program(SLOT_ADDRESS(slot), record, (HEADER_WORDS + data_words + 1) * 4);
+
+    // a failed save leaves a partial slot, which is skipped either way
+    next_slot++;
+    if (res == Ok)
+    {
+        latest_slot = static_cast<int32_t>(slot);
+        next_sequence++;
+    }
+
+    return res;
+}
+
+void powerloss_begin()
+{
+    latest_slot = -1;
+    next_slot = 0;
+    next_sequence = 0;
+
+    uint32_t latest_sequence = 0;
+    for (uint32_t slot = 0; slot < POWERLOSS_SLOT_COUNT; slot++)
+    {
+        if (slot_is_erased(slot))
+        {
+            continue;
+        }
+
+        // slots are used in order, so the slot after the last used one is free
+        next_slot = slot + 1;
+
+        if (slot_is_valid(slot))
+        {
+            const uint32_t sequence = reinterpret_cast<const powerloss_header_t *>(SLOT_ADDRESS(slot))->sequence;
+            if (latest_slot < 0 || static_cast<int32_t>(sequence - latest_sequence) > 0)
+            {
+                latest_slot = static_cast<int32_t>(slot);
+                latest_sequence = sequence;
+            }
+        }
+    }
+
+    if (latest_slot >= 0)
+    {
+        next_sequence = latest_sequence + 1;
+    }
+
+    initialized = true;
+
+    // keep at least one slot ready
+    if (erase_needed())
+    {
+        schedule_erase();
+    }
+}
+
+en_result_t powerloss_save(const void *data, const size_t size)
+{
+    CORE_ASSERT(initialized, "powerloss_begin() not called", return ErrorUninitialized);
+    CORE_ASSERT(data != nullptr || size == 0, "powerloss_save() data is NULL", return ErrorInvalidParameter);
+    if (size > POWERLOSS_MAX_DATA_SIZE)
+    {
+        return ErrorInvalidParameter;
+    }
+
+    // an erase in progress must not be raced with
+    if (next_slot >= POWERLOSS_SLOT_COUNT || (erase_pending && !softtimer_is_active(&erase_timer)))
+    {
+        return ErrorNotReady;
+    }
+
+    const en_result_t res = program_record(data, size);
+
+    if (erase_needed())
+    {
+        schedule_erase();
+    }
+
+    return res;
+}
+
+size_t powerloss_read(void *data, const size_t size)
+{
+    if (!initialized || latest_slot < 0)
+    {
+        return 0;
+    }
+
+    const uint32_t address = SLOT_ADDRESS(static_cast<uint32_t>(latest_slot));
+    const powerloss_header_t *header = reinterpret_cast<const powerloss_header_t *>(address);
+    if (data != nullptr)
+    {
+        memcpy(data, reinterpret_cast<const uint8_t *>(address + sizeof(powerloss_header_t)),
+               size < header->length ? size : header->length);
+    }
+
+    return header->length;
+}
+
+void powerloss_clear()
+{
+    if (!initialized)
+    {
+        return;
+    }
+
+    latest_slot = -1;
+    if (next_slot > 0)
+    {
+        schedule_erase();
+    }
+}
+
+uint32_t powerloss_free_slots()
+{
+    if (!initialized || next_slot >= POWERLOSS_SLOT_COUNT)
+    {
+        return 0;
+    }
+
+    return POWERLOSS_SLOT_COUNT - next_slot;
+}
+
+void powerloss_service()
+{
+    if (!initialized || !erase_pending)
+    {
+        return;
+    }
+
+    softtimer_stop(&erase_timer);
+
+    // keep the latest record in RAM while the sector is erased.
+    // saves are refused until the erase completed
+    static uint8_t keep_data[POWERLOSS_MAX_DATA_SIZE];
+    const bool keep = latest_slot >= 0;
+    const size_t keep_length = powerloss_read(keep_data, sizeof(keep_data));
+
+    if (Intflash::FlashErasePage(POWERLOSS_BASE) != Ok)
+    {
+        // the sector may be partially erased now, so no more saves until the retry succeeded
+        next_slot = POWERLOSS_SLOT_COUNT;
+        softtimer_start(&erase_timer, POWERLOSS_ERASE_DELAY, 0, erase_timer_callback, nullptr, SOFTTIMER_CONTEXT_LOOP);
+        return;
+    }
+
+    next_slot = 0;
+    latest_slot = -1;
+
+    // rewrite the latest record to the first slot, before saves are allowed again
+    if (keep)
+    {
+        program_record(keep_data, keep_length);
+    }
+
+    erase_pending = false;
+}
@@ -0,0 +1,90 @@
+/**
+ * power-loss resume save:
+ *
+ * on brown-out, there are only a few milliseconds of energy left. erasing a flash sector takes longer than that,
+ * so the sector at FLASH_OUTAGE_DATA_ADDR is kept erased ahead of time, and split into fixed-size slots.
+ * powerloss_save() only programs the next free slot using sequence programming, without ever erasing.
+ * the time it takes is bounded by the slot size: roughly one word program per 4 bytes of data.
+ *
+ *   +-------------------------------------------+
+ *   | slot 0: length | sequence | checksum      |
+ *   |         data ...                          |
+ *   |         magic (programmed last)           |
+ *   +-------------------------------------------+
+ *   | slot 1 ...                                |
+ *   +-------------------------------------------+
+ *   | erased slots, ready for the next save     |
+ *   +-------------------------------------------+
+ *
+ * after boot, powerloss_begin() finds the latest record. once only one free slot is left, or the record was discarded
+ * using powerloss_clear(), the sector is erased again from the main loop (via a soft-timer), keeping the latest record
+ * unless it was discarded. the last free slot stays available for a save until the erase starts.
+ */
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <hc32_ddl.h>
+
+/**
+ * @brief size of a save slot, in bytes
+ * @note a multiple of 4, and a divider of the 8 KB sector size. larger slots take longer to save
+ */
+#ifndef POWERLOSS_SLOT_SIZE
+#define POWERLOSS_SLOT_SIZE 512
+#endif
+
+/**
+ * @brief maximum size of the data of a record
+ */
+#define POWERLOSS_MAX_DATA_SIZE (POWERLOSS_SLOT_SIZE - 16)
+
+/**
+ * @brief delay after which a required erase is done from the main loop, in milliseconds
+ * @note gives the board time to settle after boot before the flash is blocked for the erase
+ */
+#ifndef POWERLOSS_ERASE_DELAY
+#define POWERLOSS_ERASE_DELAY 2000
+#endif
+
+/**
+ * @brief initialize the power-loss save service
+ * @note finds the latest record and the next free slot. if at most one slot is free, an erase is scheduled
+ */
+void powerloss_begin();
+
+/**
+ * @brief save a record to the next pre-erased slot
+ * @param data the data to save
+ * @param size size of the data. at most POWERLOSS_MAX_DATA_SIZE
+ * @return Ok on success,
+ *         ErrorInvalidParameter if the data is too large,
+ *         ErrorNotReady if no pre-erased slot is available,
+ *         ErrorUninitialized if powerloss_begin() was not called
+ * @note never erases flash. interrupts are disabled while the data is programmed.
+ *       safe to call from the brown-out interrupt
+ */
+en_result_t powerloss_save(const void *data, const size_t size);
+
+/**
+ * @brief read the latest record
+ * @param data buffer to read the data into
+ * @param size size of the buffer
+ * @return size of the record data, or 0 if there is no record. if the buffer is smaller, the data is truncated
+ */
+size_t powerloss_read(void *data, const size_t size);
+
+/**
+ * @brief discard the latest record, and schedule an erase to free all slots
+ */
+void powerloss_clear();
+
+/**
+ * @brief get the number of saves possible before an erase is needed
+ */
+uint32_t powerloss_free_slots();
+
+/**
+ * @brief do a pending erase right away
+ * @note blocks for the duration of the sector erase. normally called by the scheduled soft-timer
+ */
+void powerloss_service();
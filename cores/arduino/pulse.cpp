@@ -0,0 +1,44 @@
+#include "pulse.h"
+#include "delay.h"
+#include "yield.h"
+#include "wiring_constants.h"
+#include "drivers/gpio/gpio.h"
+#include "drivers/timera/timera_capture.h"
+#include "core_debug.h"
+
+// capture clock divider, for a resolution of about 1 us at PCLK1 = 50 MHz
+#define PULSEIN_CAPTURE_DIVIDER 32
+
+uint32_t pulseIn(gpio_pin_t pin, uint32_t state, uint32_t timeout)
+{
+    ASSERT_GPIO_PIN_VALID(pin, "pulseIn");
+    if (pin >= BOARD_NR_GPIO_PINS)
+    {
+        return 0;
+    }
+
+    // measure the pulse in hardware, so interrupts do not disturb the result
+    timera_config_t *unit;
+    en_timera_channel_t channel;
+    if (timera_capture_start_on_pin(pin, PULSEIN_CAPTURE_DIVIDER, unit, channel) != Ok)
+    {
+        CORE_ASSERT_FAIL("pulseIn: pin cannot be captured by TimerA");
+        return 0;
+    }
+
+    // wait until a complete pulse was captured, or the timeout expired
+    uint32_t ticks = 0;
+    bool captured = false;
+    const uint32_t start = micros();
+    while (!(captured = timera_capture_read_pulse(unit, channel, state == HIGH, ticks)) && (micros() - start) < timeout)
+    {
+        yield();
+    }
+
+    const uint32_t pulse_us = captured ? timera_capture_ticks_to_us(unit, ticks) : 0;
+    timera_capture_stop(unit, channel);
+
+    // return the pin to GPIO function
+    GPIO_SetFunc(pin, Func_Gpio);
+    return pulse_us;
+}
@@ -28,6 +28,9 @@ extern "C" {
  * or LOW, the type of pulse to measure.  Works on pulses from 2-3 microseconds
  * to 3 minutes in length, but must be called at least a few dozen microseconds
  * before the start of the pulse.
+ *
+ * \note the pulse is measured by TimerA input capture, so the pin must have a TimerA assignment.
+ *       the TimerA unit of the pin must not be in use by anything else.
  */
 uint32_t pulseIn(gpio_pin_t pin, uint32_t state, uint32_t timeout);
 
@@ -1,6 +1,7 @@
 #include "wiring_analog.h"
 #include "drivers/gpio/gpio.h" // includes drivers/adc/adc.h already
 #include "drivers/timera/timera_pwm.h"
+#include "drivers/softpwm/softpwm.h"
 #include "core_debug.h"
 
 //
@@ -31,30 +32,127 @@ uint32_t analogRead(gpio_pin_t ulPin)
         return 0;
     }
 
-    // read from adc channel synchronously
+    // read from adc channel synchronously, on whatever device it was enabled on
+    adc_lookup_channel(&adc_device, &adc_channel);
     return adc_read_sync(adc_device, adc_channel);
 }
 
+void analogReadMany(const gpio_pin_t *ulPins, uint16_t *ulValues, size_t count)
+{
+    CORE_ASSERT(ulPins != NULL && ulValues != NULL, "analogReadMany: invalid arguments", return);
+
+    // every scan converts all enabled channels of a ADC, so one conversion per ADC is enough
+    adc_device_t *devices[] = {&ADC1_device, &ADC2_device};
+    bool used[] = {false, false};
+    for (size_t i = 0; i < count; i++)
+    {
+        ASSERT_GPIO_PIN_VALID(ulPins[i], "analogReadMany");
+        if (ulPins[i] >= BOARD_NR_GPIO_PINS)
+        {
+            continue;
+        }
+
+        adc_device_t *adc_device = PIN_MAP[ulPins[i]].adc_info.device;
+        uint8_t adc_channel = PIN_MAP[ulPins[i]].adc_info.channel;
+        if (adc_device != NULL && adc_channel != ADC_PIN_INVALID)
+        {
+            adc_lookup_channel(&adc_device, &adc_channel);
+            used[0] |= adc_device == devices[0];
+            used[1] |= adc_device == devices[1];
+        }
+    }
+
+    // start all conversions first, so both ADCs convert in parallel
+    // (in continuous scan mode or with a hardware trigger, the results are always up to date)
+    for (size_t d = 0; d < 2; d++)
+    {
+        used[d] = used[d] && !adc_is_continuous(devices[d]) && !devices[d]->state.hardware_triggered;
+        if (used[d])
+        {
+            adc_start_conversion(devices[d]);
+        }
+    }
+
+    for (size_t d = 0; d < 2; d++)
+    {
+        if (used[d])
+        {
+            adc_await_conversion_completed(devices[d]);
+        }
+    }
+
+    // collect results
+    for (size_t i = 0; i < count; i++)
+    {
+        ulValues[i] = 0;
+        if (ulPins[i] >= BOARD_NR_GPIO_PINS)
+        {
+            continue;
+        }
+
+        adc_device_t *adc_device = PIN_MAP[ulPins[i]].adc_info.device;
+        uint8_t adc_channel = PIN_MAP[ulPins[i]].adc_info.channel;
+        if (adc_device == NULL || adc_channel == ADC_PIN_INVALID)
+        {
+            CORE_ASSERT_FAIL("analogReadMany: pin is not an ADC pin")
+            continue;
+        }
+
+        adc_lookup_channel(&adc_device, &adc_channel);
+        ulValues[i] = adc_conversion_read_result(adc_device, adc_channel);
+    }
+}
+
 void analogReadResolution(int res)
 {
+    en_adc_resolution_t resolution;
     switch (res)
     {
     case 8:
-        ADC1_device.init_params.resolution = AdcResolution_8Bit;
+        resolution = AdcResolution_8Bit;
         break;
     case 10:
-        ADC1_device.init_params.resolution = AdcResolution_10Bit;
+        resolution = AdcResolution_10Bit;
         break;
     case 12:
-        ADC1_device.init_params.resolution = AdcResolution_12Bit;
+        resolution = AdcResolution_12Bit;
         break;
     default:
         CORE_ASSERT_FAIL("analogReadResolution: resolution must be 8, 10 or 12")
 
         // fallback to 10 bit
-        ADC1_device.init_params.resolution = AdcResolution_10Bit;
+        resolution = AdcResolution_10Bit;
         break;
     }
+
+    // both ADCs use the same resolution, so balanced channels read the same
+    ADC1_device.init_params.resolution = resolution;
+    ADC2_device.init_params.resolution = resolution;
+}
+
+void analogReadSampleTime(gpio_pin_t ulPin, uint8_t cycles)
+{
+    ASSERT_GPIO_PIN_VALID(ulPin, "analogReadSampleTime");
+
+    if (ulPin >= BOARD_NR_GPIO_PINS)
+    {
+        return;
+    }
+
+    pin_adc_info_t adc_info = PIN_MAP[ulPin].adc_info;
+    if (adc_info.device == NULL || adc_info.channel == ADC_PIN_INVALID)
+    {
+        CORE_ASSERT_FAIL("analogReadSampleTime: pin is not an ADC pin")
+        return;
+    }
+
+    // set on the ADC1 channel of the pin map, which also covers ADC2 for shared channels
+    adc_set_sample_time(adc_info.device, adc_info.channel, cycles);
+}
+
+void analogReadSampleTimeNs(gpio_pin_t ulPin, uint32_t nanoseconds)
+{
+    analogReadSampleTime(ulPin, adc_sample_time_from_ns(nanoseconds));
 }
 
 //
@@ -83,7 +181,16 @@ void analogWriteScaled(gpio_pin_t ulPin, uint32_t ulValue, uint32_t ulScale)
     en_port_func_t port_function;
     if (!timera_get_assignment(ulPin, unit, channel, port_function))
     {
+#ifdef SOFTPWM_ANALOG_WRITE
+        // software PWM pin, attached by pinMode(OUTPUT_PWM)
+        CORE_ASSERT(softpwm_attached(ulPin), "analogWrite: pin is not configured as OUTPUT_PWM", return);
+        CORE_ASSERT(ulScale > 1, "analogWrite: invalid scale", return);
+        const uint32_t duty = ulValue >= ulScale - 1 ? SOFTPWM_ANALOG_WRITE_RESOLUTION
+                                                     : (ulValue * SOFTPWM_ANALOG_WRITE_RESOLUTION) / (ulScale - 1);
+        softpwm_write(ulPin, uint16_t(duty));
+#else
         CORE_ASSERT_FAIL("analogWrite: pin is not a PWM pin");
+#endif
         return;
     }
 
@@ -97,9 +204,14 @@ void analogWriteScaled(gpio_pin_t ulPin, uint32_t ulValue, uint32_t ulScale)
 
 bool isAnalogWritePin(gpio_pin_t ulPin)
 {
+#ifdef SOFTPWM_ANALOG_WRITE
+    // every pin can do software PWM
+    return true;
+#else
     // if the pin has a timerA assignment, it is a PWM pin
     timera_config_t *unit;
     en_timera_channel_t channel;
     en_port_func_t port_function;
     return timera_get_assignment(ulPin, unit, channel, port_function);
+#endif
 }
\ No newline at end of file
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include "core_types.h"
 
 #ifdef __cplusplus
@@ -73,6 +74,18 @@ extern "C"
    */
   extern uint32_t analogRead(gpio_pin_t ulPin);
 
+  /*
+   * \brief Reads the values of multiple analog pins, using one conversion per ADC.
+   *
+   * \param ulPins pins to read
+   * \param ulValues receives the read values, in the same order as ulPins
+   * \param count number of pins
+   *
+   * \note the pins must be configured as INPUT_ANALOG beforehand.
+   * \note values of pins that are not ADC pins are set to 0.
+   */
+  extern void analogReadMany(const gpio_pin_t *ulPins, uint16_t *ulValues, size_t count);
+
   /*
    * \brief Set the resolution of analogRead return values. Default is 10 bits (range from 0 to 1023).
    *
@@ -83,6 +96,27 @@ extern "C"
    */
   extern void analogReadResolution(int res);
 
+  /*
+   * \brief Set the sample time of an analog pin, in ADC clock (PCLK2) cycles.
+   *
+   * \param ulPin
+   * \param cycles sampling time. 0 to restore the default (50 cycles)
+   *
+   * \note high-impedance sources need longer sampling. shorter sampling reduces the time of a full scan.
+   * \note can be called before or after the pin is configured as INPUT_ANALOG.
+   */
+  extern void analogReadSampleTime(gpio_pin_t ulPin, uint8_t cycles);
+
+  /*
+   * \brief Set the sample time of an analog pin, in nanoseconds.
+   *
+   * \param ulPin
+   * \param nanoseconds minimum sampling time. rounded up to whole ADC clock cycles, and limited to 255 cycles
+   *
+   * \note see analogReadSampleTime()
+   */
+  extern void analogReadSampleTimeNs(gpio_pin_t ulPin, uint32_t nanoseconds);
+
   /*
    * \brief Set the resolution of analogWrite parameters. Default is 8 bits (range from 0 to 255).
    *
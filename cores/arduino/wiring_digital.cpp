@@ -2,6 +2,7 @@
 #include "drivers/gpio/gpio.h"
 #include "drivers/adc/adc.h"
 #include "drivers/timera/timera_pwm.h"
+#include "drivers/softpwm/softpwm.h"
 #include "wiring_constants.h"
 #include "core_debug.h"
 
@@ -22,19 +23,31 @@ void pinMode(gpio_pin_t dwPin, uint32_t dwMode)
         // is a valid ADC pin
         if (dwMode == INPUT_ANALOG)
         {
+            // shared channels may be moved to ADC2
+            adc_select_channel(&adc_device, &adc_channel);
+
             // initialize adc device (if already initialized, this will do nothing)
             adc_device_init(adc_device);
 
-            // enable ADC channel
-            adc_enable_channel(adc_device, adc_channel);
+            // enable ADC channel, with the sample time set by analogReadSampleTime()
+            adc_enable_channel(adc_device, adc_channel, adc_get_sample_time(adc_device, adc_channel));
         }
         else
         {
-            // disable ADC channel
+            // disable ADC channel, on whatever device it was enabled on
+            adc_lookup_channel(&adc_device, &adc_channel);
             adc_disable_channel(adc_device, adc_channel);
         }
     }
 
+#ifdef SOFTPWM_ANALOG_WRITE
+    // leaving software PWM
+    if (dwMode != OUTPUT_PWM)
+    {
+        softpwm_detach(dwPin);
+    }
+#endif
+
     // build pin configuration
     stc_port_init_t pinConf;
     MEM_ZERO_STRUCT(pinConf);
@@ -57,7 +70,16 @@ void pinMode(gpio_pin_t dwPin, uint32_t dwMode)
         en_port_func_t port_function;
         if (!timera_get_assignment(dwPin, unit, channel, port_function))
         {
+#ifdef SOFTPWM_ANALOG_WRITE
+            // no TimerA output, fall back to software PWM
+            GPIO_SetFunc(dwPin, Func_Gpio, Enable);
+            if (!softpwm_analog_write_begin() || !softpwm_write(dwPin, 0))
+            {
+                CORE_ASSERT_FAIL("pinMode: software PWM failed");
+            }
+#else
             CORE_ASSERT_FAIL("analogWrite: pin is not a PWM pin");
+#endif
             return;
         }
 
@@ -124,6 +146,12 @@ uint32_t getPinMode(gpio_pin_t dwPin)
         switch (pinConf.enPinMode)
         {
         case Pin_Mode_Out:
+#ifdef SOFTPWM_ANALOG_WRITE
+            if (softpwm_attached(dwPin))
+            {
+                return OUTPUT_PWM;
+            }
+#endif
             return OUTPUT;
         case Pin_Mode_In:
             return (pinConf.enPullUp == Enable) ? INPUT_PULLUP : INPUT;
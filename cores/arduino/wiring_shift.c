@@ -23,32 +23,110 @@
 #include "wiring_digital.h"
 #include "wiring_private.h"
 #include "core_debug.h"
+#include "WVariant.h"
+#include "drivers/gpio/fastio.h"
+#include "drivers/sysclock/sysclock.h"
+#include "core_util.h"
+
+#ifndef SHIFT_PHASE_DELAY_NS
+/**
+ * @brief minimum duration of each clock phase of shiftIn() and shiftOut(), in nanoseconds
+ * @note this is also the setup time of the data before the clock edge (shiftOut), and the time the data
+ *       is given to settle after the clock edge before it is sampled (shiftIn).
+ *       the default suits 74HC logic (e.g. 74HC595, 74HC165) at 3.3V with some margin. 0 to shift at full speed
+ */
+#define SHIFT_PHASE_DELAY_NS 100
+#endif
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
+/**
+ * @brief get the cycles of a clock phase, at the current HCLK
+ */
+static inline uint32_t shift_phase_cycles( void )
+{
+  core_cycle_counter_enable() ;
+  return (uint32_t)( ( (uint64_t)SYSTEM_CLOCK_FREQUENCIES.hclk * SHIFT_PHASE_DELAY_NS + 999999999u ) / 1000000000u ) ;
+}
+
+/**
+ * @brief wait for a clock phase, starting now
+ */
+static inline void shift_phase_wait( const uint32_t cycles )
+{
+#if SHIFT_PHASE_DELAY_NS > 0
+  const uint32_t start = DWT->CYCCNT ;
+  while ( ( DWT->CYCCNT - start ) < cycles )
+    ;
+#else
+  (void)cycles ;
+#endif
+}
+
+/*
+ * the port registers and masks of both pins are looked up once per call,
+ * and each bit is a single store (or load) to the port registers.
+ * this is the same as digitalWrite() / digitalRead(), but without the PIN_MAP lookup per bit.
+ * each clock phase lasts at least SHIFT_PHASE_DELAY_NS
+ */
+#define PIN_PORT_REG( reg, pin ) ( &FASTIO_PORT_REG( uint16_t, M4_PORT->reg, PIN_MAP[pin].port ) )
+
+// data is set up during the clock low phase, and latched on the rising edge
+#define SHIFT_OUT_BIT( mask ) \
+  *( ulVal & (mask) ? dataSet : dataReset ) = dataMask ; \
+  shift_phase_wait( phaseCycles ) ; \
+  *clockSet = clockMask ; \
+  shift_phase_wait( phaseCycles ) ; \
+  *clockReset = clockMask ;
+
+// data changes after the rising edge, and is sampled at the end of the clock high phase
+#define SHIFT_IN_BIT( mask ) \
+  *clockSet = clockMask ; \
+  shift_phase_wait( phaseCycles ) ; \
+  if ( *dataIn & dataMask ) { value |= (mask) ; } \
+  *clockReset = clockMask ; \
+  shift_phase_wait( phaseCycles ) ;
+
 uint32_t shiftIn( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder )
 {
   ASSERT_GPIO_PIN_VALID( ulDataPin, "shiftIn" ) ;
+  ASSERT_GPIO_PIN_VALID( ulClockPin, "shiftIn" ) ;
+  if ( !IS_GPIO_PIN( ulDataPin ) || !IS_GPIO_PIN( ulClockPin ) )
+  {
+    return 0 ;
+  }
 
-  uint8_t value = 0 ;
-  uint8_t i ;
+  volatile uint16_t * const dataIn = PIN_PORT_REG( PIDRA, ulDataPin ) ;
+  volatile uint16_t * const clockSet = PIN_PORT_REG( POSRA, ulClockPin ) ;
+  volatile uint16_t * const clockReset = PIN_PORT_REG( PORRA, ulClockPin ) ;
+  const uint16_t dataMask = PIN_MAP[ulDataPin].bit_mask ;
+  const uint16_t clockMask = PIN_MAP[ulClockPin].bit_mask ;
+  const uint32_t phaseCycles = shift_phase_cycles() ;
 
-  for ( i=0 ; i < 8 ; ++i )
+  uint8_t value = 0 ;
+  if ( ulBitOrder == LSBFIRST )
+  {
+    SHIFT_IN_BIT( 0x01 )
+    SHIFT_IN_BIT( 0x02 )
+    SHIFT_IN_BIT( 0x04 )
+    SHIFT_IN_BIT( 0x08 )
+    SHIFT_IN_BIT( 0x10 )
+    SHIFT_IN_BIT( 0x20 )
+    SHIFT_IN_BIT( 0x40 )
+    SHIFT_IN_BIT( 0x80 )
+  }
+  else
   {
-    digitalWrite( ulClockPin, HIGH ) ;
-
-    if ( ulBitOrder == LSBFIRST )
-    {
-      value |= digitalRead( ulDataPin ) << i ;
-    }
-    else
-    {
-      value |= digitalRead( ulDataPin ) << (7 - i) ;
-    }
-
-    digitalWrite( ulClockPin, LOW ) ;
+    SHIFT_IN_BIT( 0x80 )
+    SHIFT_IN_BIT( 0x40 )
+    SHIFT_IN_BIT( 0x20 )
+    SHIFT_IN_BIT( 0x10 )
+    SHIFT_IN_BIT( 0x08 )
+    SHIFT_IN_BIT( 0x04 )
+    SHIFT_IN_BIT( 0x02 )
+    SHIFT_IN_BIT( 0x01 )
   }
 
   return value ;
@@ -57,22 +135,49 @@ uint32_t shiftIn( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrd
 void shiftOut( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder, uint32_t ulVal )
 {
   ASSERT_GPIO_PIN_VALID( ulDataPin, "shiftOut" ) ;
+  ASSERT_GPIO_PIN_VALID( ulClockPin, "shiftOut" ) ;
+  if ( !IS_GPIO_PIN( ulDataPin ) || !IS_GPIO_PIN( ulClockPin ) )
+  {
+    return ;
+  }
+
+  volatile uint16_t * const dataSet = PIN_PORT_REG( POSRA, ulDataPin ) ;
+  volatile uint16_t * const dataReset = PIN_PORT_REG( PORRA, ulDataPin ) ;
+  volatile uint16_t * const clockSet = PIN_PORT_REG( POSRA, ulClockPin ) ;
+  volatile uint16_t * const clockReset = PIN_PORT_REG( PORRA, ulClockPin ) ;
+  const uint16_t dataMask = PIN_MAP[ulDataPin].bit_mask ;
+  const uint16_t clockMask = PIN_MAP[ulClockPin].bit_mask ;
+  const uint32_t phaseCycles = shift_phase_cycles() ;
 
-  uint8_t i ;
+  if ( ulBitOrder == LSBFIRST )
+  {
+    SHIFT_OUT_BIT( 0x01 )
+    SHIFT_OUT_BIT( 0x02 )
+    SHIFT_OUT_BIT( 0x04 )
+    SHIFT_OUT_BIT( 0x08 )
+    SHIFT_OUT_BIT( 0x10 )
+    SHIFT_OUT_BIT( 0x20 )
+    SHIFT_OUT_BIT( 0x40 )
+    SHIFT_OUT_BIT( 0x80 )
+  }
+  else
+  {
+    SHIFT_OUT_BIT( 0x80 )
+    SHIFT_OUT_BIT( 0x40 )
+    SHIFT_OUT_BIT( 0x20 )
+    SHIFT_OUT_BIT( 0x10 )
+    SHIFT_OUT_BIT( 0x08 )
+    SHIFT_OUT_BIT( 0x04 )
+    SHIFT_OUT_BIT( 0x02 )
+    SHIFT_OUT_BIT( 0x01 )
+  }
+}
 
-  for ( i=0 ; i < 8 ; i++ )
+void shiftOutBuffer( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder, const uint8_t *buffer, size_t length )
+{
+  for ( size_t i = 0 ; i < length ; i++ )
   {
-    if ( ulBitOrder == LSBFIRST )
-    {
-      digitalWrite( ulDataPin, !!(ulVal & (1 << i)) ) ;
-    }
-    else
-    {
-      digitalWrite( ulDataPin, !!(ulVal & (1 << (7 - i))) ) ;
-    }
-
-    digitalWrite( ulClockPin, HIGH ) ;
-    digitalWrite( ulClockPin, LOW ) ;
+    shiftOut( ulDataPin, ulClockPin, ulBitOrder, buffer[i] ) ;
   }
 }
 
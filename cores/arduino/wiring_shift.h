@@ -20,6 +20,7 @@
 #define _WIRING_SHIFT_
 
 #include <stdint.h>
+#include <stddef.h>
 #include "core_types.h"
 
 #ifdef __cplusplus
@@ -27,16 +28,28 @@
 #endif
 
 /*
- * \brief
+ * \brief Shifts in a byte of data one bit at a time, clocking the clock pin for each bit.
+ *
+ * \note the data is read at the end of the clock HIGH phase. both pins must be configured using pinMode()
+ * \note each clock phase lasts at least SHIFT_PHASE_DELAY_NS (default 100ns, for 74HC logic at 3.3V)
  */
 extern uint32_t shiftIn( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder ) ;
 
 
 /*
- * \brief
+ * \brief Shifts out a byte of data one bit at a time, clocking the clock pin for each bit.
+ *
+ * \note both pins must be configured as OUTPUT using pinMode()
+ * \note each clock phase lasts at least SHIFT_PHASE_DELAY_NS (default 100ns, for 74HC logic at 3.3V).
+ *       the data is set up for one phase before the rising clock edge
  */
 extern void shiftOut( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder, uint32_t ulVal ) ;
 
+/*
+ * \brief Shifts out multiple bytes of data, using shiftOut() for each byte.
+ */
+extern void shiftOutBuffer( gpio_pin_t ulDataPin, gpio_pin_t ulClockPin, uint32_t ulBitOrder, const uint8_t *buffer, size_t length ) ;
+
 
 #ifdef __cplusplus
 }
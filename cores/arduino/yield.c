@@ -17,6 +17,13 @@
 */
 
 #include "core_hooks.h"
+#include "core_scheduler.h"
+
+// background flash service, only linked if flash jobs are used
+extern void flash_async_poll(void) __attribute__((weak));
+
+// deferred calls, only linked if calls are posted
+extern size_t core_defer_run(void) __attribute__((weak));
 
 /**
  * Empty yield() hook.
@@ -29,9 +36,24 @@
  */
 static void __empty()
 {
-    // Empty
+    // run the calls deferred by interrupt handlers
+    if (core_defer_run != 0)
+    {
+        core_defer_run();
+    }
+
+    // run a step of the background flash service
+    if (flash_async_poll != 0)
+    {
+        flash_async_poll();
+    }
 
     // wdt reload
     core_hook_yield_wdt_reload();
+
+#ifdef CORE_SCHEDULER
+    // let the other tasks run
+    core_scheduler_yield();
+#endif
 }
 void yield(void) __attribute__((weak, alias("__empty")));
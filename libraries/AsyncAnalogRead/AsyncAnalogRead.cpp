@@ -1,7 +1,94 @@
 #include "AsyncAnalogRead.h"
 #include <drivers/adc/adc.h>
+#include "RingBuffer.h"
 #include "core_debug.h"
 
+// size of the result queue. must be a power of two
+#ifndef ASYNC_ANALOG_READ_QUEUE_SIZE
+#define ASYNC_ANALOG_READ_QUEUE_SIZE 16
+#endif
+
+/**
+ * @brief a completed asynchronous analog read
+ */
+struct analog_read_result_t
+{
+    gpio_pin_t pin;
+    uint16_t value;
+};
+
+/**
+ * @brief pending asynchronous analog reads of a adc device
+ */
+struct analog_read_pending_t
+{
+    adc_device_t *device;
+
+    /**
+     * @brief bit n == a read of channel n is pending
+     */
+    volatile uint32_t channels;
+
+    /**
+     * @brief pin that requested the read, per channel
+     */
+    gpio_pin_t pins[32];
+};
+
+static analog_read_pending_t pending[] = {
+    {.device = &ADC1_device},
+    {.device = &ADC2_device},
+};
+
+static RingBuffer<analog_read_result_t, ASYNC_ANALOG_READ_QUEUE_SIZE> results;
+static bool eventsEnabled = false;
+static analog_read_callback_t eventCallback = NULL;
+
+inline analog_read_pending_t *get_pending(const adc_device_t *adc_device)
+{
+    for (analog_read_pending_t &p : pending)
+    {
+        if (p.device == adc_device)
+        {
+            return &p;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief deliver all pending reads of a adc device
+ * @note called from the ADC DMA interrupt
+ */
+static void on_conversion_completed(adc_device_t *adc_device)
+{
+    analog_read_pending_t *p = get_pending(adc_device);
+    if (p == NULL)
+    {
+        return;
+    }
+
+    uint32_t channels = p->channels;
+    p->channels = 0;
+    while (channels != 0)
+    {
+        const uint8_t channel = __builtin_ctz(channels);
+        channels &= channels - 1;
+
+        const analog_read_result_t result = {
+            .pin = p->pins[channel],
+            .value = uint16_t(adc_conversion_read_sum(adc_device, channel) / adc_device->init_params.sample_count),
+        };
+        results.push(result);
+
+        if (eventCallback != NULL)
+        {
+            eventCallback(result.pin, result.value);
+        }
+    }
+}
+
 inline bool get_adc_info(gpio_pin_t pin, adc_device_t *&adc_device, uint8_t &adc_channel)
 {
     ASSERT_GPIO_PIN_VALID(pin, "get_adc_info");
@@ -18,6 +105,8 @@ inline bool get_adc_info(gpio_pin_t pin, adc_device_t *&adc_device, uint8_t &adc
         return false;
     }
 
+    // channel may be enabled on ADC2
+    adc_lookup_channel(&adc_device, &adc_channel);
     return true;
 }
 
@@ -34,6 +123,23 @@ void analogReadAsync(gpio_pin_t ulPin)
         return;
     }
 
+    // remember the request, so the result can be delivered as event
+    if (eventsEnabled)
+    {
+        analog_read_pending_t *p = get_pending(adc_device);
+        if (p != NULL)
+        {
+            // the interrupt clears the pending channels concurrently
+            const uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            p->pins[adc_channel] = ulPin;
+            p->channels |= 1 << adc_channel;
+            __set_PRIMASK(primask);
+        }
+
+        adc_set_conversion_completed_callback(adc_device, on_conversion_completed);
+    }
+
     // start conversion
     adc_start_conversion(adc_device);
 }
@@ -71,3 +177,40 @@ uint16_t getAnalogReadValue(gpio_pin_t ulPin)
     // read conversion result
     return adc_conversion_read_result(adc_device, adc_channel);
 }
+
+void enableAnalogReadEvents(analog_read_callback_t callback)
+{
+    eventCallback = callback;
+    eventsEnabled = true;
+}
+
+void disableAnalogReadEvents(void)
+{
+    eventsEnabled = false;
+    for (analog_read_pending_t &p : pending)
+    {
+        if (p.device->state.initialized)
+        {
+            adc_set_conversion_completed_callback(p.device, NULL);
+        }
+
+        p.channels = 0;
+    }
+
+    eventCallback = NULL;
+}
+
+bool getAnalogReadResult(gpio_pin_t *ulPin, uint16_t *value)
+{
+    CORE_ASSERT(ulPin != NULL && value != NULL, "getAnalogReadResult: invalid arguments", return false);
+
+    analog_read_result_t result;
+    if (!results.pop(result))
+    {
+        return false;
+    }
+
+    *ulPin = result.pin;
+    *value = result.value;
+    return true;
+}
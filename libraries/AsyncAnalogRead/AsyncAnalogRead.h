@@ -6,6 +6,14 @@ extern "C"
 {
 #endif
 
+    /**
+     * @brief callback for completed asynchronous analog reads
+     * @param ulPin the analog pin that was read
+     * @param value the read value
+     * @note called from the ADC DMA interrupt, so keep it short
+     */
+    typedef void (*analog_read_callback_t)(gpio_pin_t ulPin, uint16_t value);
+
     /**
      * @brief start asynchronous analog read from the specified analog pin.
      *
@@ -29,6 +37,28 @@ extern "C"
      */
     uint16_t getAnalogReadValue(gpio_pin_t ulPin);
 
+    /**
+     * @brief deliver asynchronous analog reads as events, instead of polling
+     * @param callback called for every completed read. may be NULL to only use the result queue
+     * @note once enabled, completed reads are also put into a queue, see getAnalogReadResult()
+     * @note getAnalogReadComplete() and getAnalogReadValue() keep working
+     */
+    void enableAnalogReadEvents(analog_read_callback_t callback);
+
+    /**
+     * @brief stop delivering asynchronous analog reads as events
+     */
+    void disableAnalogReadEvents(void);
+
+    /**
+     * @brief get the next completed asynchronous analog read from the result queue
+     * @param ulPin receives the analog pin that was read
+     * @param value receives the read value
+     * @return true if a result was available
+     * @note requires enableAnalogReadEvents(). if the queue is full, new results are dropped
+     */
+    bool getAnalogReadResult(gpio_pin_t *ulPin, uint16_t *value);
+
 #ifdef __cplusplus
 }
 #endif
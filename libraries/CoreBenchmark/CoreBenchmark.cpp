@@ -0,0 +1,380 @@
+#include "CoreBenchmark.h"
+#include "flash.h"
+#include <core_util.h>
+
+// runs of the slow benchmarks
+#define SLOW_ITERATIONS 4
+
+// strings appended per run of the String benchmark
+#define STRING_PARTS 8
+
+// bytes programmed per run of the flash benchmark
+#define FLASH_PROGRAM_BYTES 256
+
+// how long to wait for the interrupt of the latency benchmark, in cycles
+#define INTERRUPT_TIMEOUT_CYCLES 1000000
+
+/**
+ * @brief read the cycle counter
+ */
+static inline uint32_t cycles()
+{
+    return DWT->CYCCNT;
+}
+
+/**
+ * @brief a Print that discards what is printed
+ */
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) override
+    {
+        return 1;
+    }
+
+    size_t write(const uint8_t *, size_t size) override
+    {
+        return size;
+    }
+};
+
+static void reset_stats(core_benchmark_stats_t &stats)
+{
+    stats.iterations = 0;
+    stats.min_cycles = UINT32_MAX;
+    stats.max_cycles = 0;
+    stats.total_cycles = 0;
+}
+
+/**
+ * @brief cycle count the latency benchmark interrupt was entered at
+ */
+static volatile uint32_t interrupt_cycles = 0;
+static volatile bool interrupt_seen = false;
+
+static void latency_interrupt()
+{
+    interrupt_cycles = cycles();
+    interrupt_seen = true;
+}
+
+CoreBenchmark::CoreBenchmark(Print &report, const uint32_t iterations) : out(report), iterations(iterations), overhead(0)
+{
+}
+
+void CoreBenchmark::begin()
+{
+    core_cycle_counter_enable();
+
+    // cost of the measurement itself
+    overhead = UINT32_MAX;
+    for (int i = 0; i < 16; i++)
+    {
+        const uint32_t start = cycles();
+        const uint32_t end = cycles();
+        if ((end - start) < overhead)
+        {
+            overhead = end - start;
+        }
+    }
+
+    out.printf("{\"benchmark\":\"meta\",\"version\":%d,\"hclk\":%lu,\"pclk1\":%lu,\"overhead\":%lu}\n",
+               CORE_BENCHMARK_REPORT_VERSION,
+               SYSTEM_CLOCK_FREQUENCIES.hclk,
+               SYSTEM_CLOCK_FREQUENCIES.pclk1,
+               overhead);
+}
+
+void CoreBenchmark::record(core_benchmark_stats_t &stats, const uint32_t start, const uint32_t end)
+{
+    const uint32_t elapsed = end - start;
+    const uint32_t c = elapsed > overhead ? elapsed - overhead : 0;
+
+    stats.iterations++;
+    stats.total_cycles += c;
+    if (c < stats.min_cycles)
+    {
+        stats.min_cycles = c;
+    }
+    if (c > stats.max_cycles)
+    {
+        stats.max_cycles = c;
+    }
+}
+
+void CoreBenchmark::report(const char *name, const uint32_t param, const core_benchmark_stats_t &stats, const uint32_t bytes)
+{
+    if (stats.iterations == 0)
+    {
+        out.printf("{\"benchmark\":\"%s\",\"param\":%lu,\"iterations\":0}\n", name, param);
+        return;
+    }
+
+    const uint64_t avg = stats.total_cycles / stats.iterations;
+    out.printf("{\"benchmark\":\"%s\",\"param\":%lu,\"iterations\":%lu,\"min\":%lu,\"avg\":%llu,\"max\":%lu,\"total\":%llu",
+               name, param, stats.iterations, stats.min_cycles, avg, stats.max_cycles, stats.total_cycles);
+
+    // throughput, for benchmarks moving data
+    if (bytes > 0 && avg > 0)
+    {
+        const uint64_t bytes_per_second = (uint64_t(bytes) * SYSTEM_CLOCK_FREQUENCIES.hclk) / avg;
+        out.printf(",\"bytes_per_second\":%llu", bytes_per_second);
+    }
+
+    out.printf("}\n");
+}
+
+void CoreBenchmark::runAll(const core_benchmark_config_t &config)
+{
+    begin();
+
+    if (IS_GPIO_PIN(config.digital_pin))
+    {
+        digitalIo(config.digital_pin);
+    }
+
+    if (IS_GPIO_PIN(config.analog_pin))
+    {
+        analogIn(config.analog_pin);
+    }
+
+    if (IS_GPIO_PIN(config.pwm_pin))
+    {
+        analogOut(config.pwm_pin);
+    }
+
+    if (IS_GPIO_PIN(config.interrupt_pin))
+    {
+        interruptLatency(config.interrupt_pin);
+    }
+
+    printFloat();
+    stringConcat();
+
+    if (config.serial != NULL && config.baud_rates != NULL && config.baud_rate_count > 0)
+    {
+        usartThroughput(*config.serial, config.baud_rates, config.baud_rate_count);
+    }
+
+    if (config.flash_address != 0)
+    {
+        flashWrite(config.flash_address);
+    }
+}
+
+void CoreBenchmark::digitalIo(const gpio_pin_t pin)
+{
+    pinMode(pin, OUTPUT);
+
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t start = cycles();
+        digitalWrite(pin, (i & 1) ? HIGH : LOW);
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+    report("digitalWrite", 0, stats);
+
+    reset_stats(stats);
+    volatile uint32_t sink = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t start = cycles();
+        sink = digitalRead(pin);
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+    (void)sink;
+    report("digitalRead", 0, stats);
+
+    pinMode(pin, INPUT);
+}
+
+void CoreBenchmark::analogIn(const gpio_pin_t pin)
+{
+    pinMode(pin, INPUT_ANALOG);
+
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    volatile uint32_t sink = 0;
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t start = cycles();
+        sink = analogRead(pin);
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+    (void)sink;
+    report("analogRead", 0, stats);
+}
+
+void CoreBenchmark::analogOut(const gpio_pin_t pin)
+{
+    pinMode(pin, OUTPUT_PWM);
+
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t start = cycles();
+        analogWrite(pin, i & 0xFF);
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+    report("analogWrite", 0, stats);
+
+    analogWrite(pin, 0);
+    pinMode(pin, INPUT);
+}
+
+void CoreBenchmark::usartThroughput(Usart &serial, const uint32_t *baud_rates, const size_t count)
+{
+    static uint8_t data[CORE_BENCHMARK_USART_BYTES];
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = uint8_t('A' + (i % 26));
+    }
+
+    for (size_t b = 0; b < count; b++)
+    {
+        const uint32_t baud = baud_rates[b];
+        serial.begin(baud);
+
+        core_benchmark_stats_t write_stats, flush_stats;
+        reset_stats(write_stats);
+        reset_stats(flush_stats);
+        for (uint32_t i = 0; i < SLOW_ITERATIONS; i++)
+        {
+            serial.flush();
+
+            const uint32_t start = cycles();
+            serial.write(data, sizeof(data));
+            const uint32_t written = cycles();
+            serial.flush();
+            const uint32_t end = cycles();
+
+            record(write_stats, start, written);
+            record(flush_stats, start, end);
+        }
+
+        report("usartWrite", baud, write_stats);
+        report("usartFlush", baud, flush_stats, sizeof(data));
+    }
+
+    serial.end();
+}
+
+void CoreBenchmark::interruptLatency(const gpio_pin_t pin)
+{
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, LOW);
+    attachInterrupt(pin, latency_interrupt, RISING);
+
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        interrupt_seen = false;
+        const uint32_t start = cycles();
+        digitalWrite(pin, HIGH);
+        while (!interrupt_seen && (cycles() - start) < INTERRUPT_TIMEOUT_CYCLES)
+            ;
+
+        if (interrupt_seen)
+        {
+            record(stats, start, interrupt_cycles);
+        }
+
+        digitalWrite(pin, LOW);
+    }
+
+    detachInterrupt(pin);
+    pinMode(pin, INPUT);
+
+    // iterations below the configured count mean the pin does not trigger its own interrupt
+    report("attachInterruptLatency", 0, stats);
+}
+
+void CoreBenchmark::printFloat()
+{
+    NullPrint sink;
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const float value = (float(i) * 1.25f) - 500.0f;
+        const uint32_t start = cycles();
+        sink.print(value, 3);
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+    report("printFloat", 3, stats);
+}
+
+void CoreBenchmark::stringConcat()
+{
+    core_benchmark_stats_t stats;
+    reset_stats(stats);
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        const uint32_t start = cycles();
+        {
+            String s;
+            for (int p = 0; p < STRING_PARTS; p++)
+            {
+                s += "X:";
+                s += p;
+            }
+        }
+        const uint32_t end = cycles();
+        record(stats, start, end);
+    }
+
+    // includes the allocation and release of the String buffer
+    report("stringConcat", STRING_PARTS, stats);
+}
+
+void CoreBenchmark::flashWrite(const uint32_t address)
+{
+    if ((address % FLASH_SECTOR_SIZE) != 0)
+    {
+        out.printf("{\"benchmark\":\"flashErase\",\"error\":\"address not sector aligned\"}\n");
+        return;
+    }
+
+    static uint8_t data[FLASH_PROGRAM_BYTES];
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = uint8_t(i);
+    }
+
+    core_benchmark_stats_t erase_stats, program_stats;
+    reset_stats(erase_stats);
+    reset_stats(program_stats);
+    for (uint32_t i = 0; i < SLOW_ITERATIONS; i++)
+    {
+        const uint32_t start = cycles();
+        const en_result_t erased = Intflash::FlashErasePage(address);
+        const uint32_t programming = cycles();
+        const en_result_t programmed = Intflash::Flash_Program(address, data, sizeof(data));
+        const uint32_t end = cycles();
+
+        if (erased == Ok)
+        {
+            record(erase_stats, start, programming);
+        }
+        if (programmed == Ok)
+        {
+            record(program_stats, programming, end);
+        }
+    }
+
+    // leave the sector erased
+    Intflash::FlashErasePage(address);
+
+    report("flashErase", FLASH_SECTOR_SIZE, erase_stats);
+    report("flashProgram", FLASH_PROGRAM_BYTES, program_stats, FLASH_PROGRAM_BYTES);
+}
@@ -0,0 +1,171 @@
+/**
+ * on-target micro-benchmarks of core primitives:
+ *
+ * each benchmark runs a primitive a number of times, and measures every run with the DWT cycle counter.
+ * the overhead of reading the cycle counter is measured once and subtracted.
+ * interrupts stay enabled, so the maximum includes SysTick and other interrupts. the minimum is the best-case cost.
+ *
+ * results are printed as one JSON object per line, so reports of different core releases can be compared by tools:
+ *
+ *   {"benchmark":"meta","version":1,"hclk":200000000,"pclk1":100000000}
+ *   {"benchmark":"digitalWrite","param":0,"iterations":1000,"min":52,"avg":53,"max":310,"total":53120}
+ *
+ * all values are in HCLK cycles. param is the benchmark parameter, e.g. the baud rate of a usart benchmark.
+ * the usart benchmarks add the measured throughput as "bytes_per_second".
+ */
+#pragma once
+#include "Arduino.h"
+
+#ifndef CORE_BENCHMARK_USART_BYTES
+/**
+ * @brief number of bytes sent per run of the usart benchmarks
+ */
+#define CORE_BENCHMARK_USART_BYTES 256
+#endif
+
+/**
+ * @brief version of the report format
+ */
+#define CORE_BENCHMARK_REPORT_VERSION 1
+
+/**
+ * @brief statistics of a benchmark
+ */
+struct core_benchmark_stats_t
+{
+    uint32_t iterations;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+};
+
+/**
+ * @brief pins and peripherals used by CoreBenchmark::runAll()
+ * @note set unused pins to -1 (or any other invalid pin), and serial to NULL, to skip the benchmark
+ */
+struct core_benchmark_config_t
+{
+    /**
+     * @brief pin for digitalWrite() and digitalRead(). driven as output
+     */
+    gpio_pin_t digital_pin;
+
+    /**
+     * @brief analog input for analogRead()
+     */
+    gpio_pin_t analog_pin;
+
+    /**
+     * @brief PWM output for analogWrite()
+     */
+    gpio_pin_t pwm_pin;
+
+    /**
+     * @brief pin for the attachInterrupt() latency benchmark. driven as output, and triggers its own interrupt
+     */
+    gpio_pin_t interrupt_pin;
+
+    /**
+     * @brief serial port for the usart throughput benchmark. must not be the report output
+     */
+    Usart *serial;
+
+    /**
+     * @brief baud rates to run the usart benchmark at
+     */
+    const uint32_t *baud_rates;
+    size_t baud_rate_count;
+
+    /**
+     * @brief address of a unused flash sector for the Intflash benchmark. 0 to skip it
+     * @note the sector is erased and overwritten
+     */
+    uint32_t flash_address;
+};
+
+class CoreBenchmark
+{
+public:
+    /**
+     * @brief create a benchmark runner
+     * @param report where to print the report to, e.g. Serial
+     * @param iterations number of runs of the fast benchmarks. slow benchmarks (usart, flash) use fewer runs
+     */
+    CoreBenchmark(Print &report, const uint32_t iterations = 1000);
+
+    /**
+     * @brief print the report header, with the report version and clock frequencies
+     * @note called by runAll(). call it once before running single benchmarks
+     */
+    void begin();
+
+    /**
+     * @brief run all benchmarks enabled in the config
+     */
+    void runAll(const core_benchmark_config_t &config);
+
+    /**
+     * @brief benchmark digitalWrite() and digitalRead()
+     */
+    void digitalIo(const gpio_pin_t pin);
+
+    /**
+     * @brief benchmark analogRead()
+     */
+    void analogIn(const gpio_pin_t pin);
+
+    /**
+     * @brief benchmark analogWrite()
+     */
+    void analogOut(const gpio_pin_t pin);
+
+    /**
+     * @brief benchmark Usart::write() of CORE_BENCHMARK_USART_BYTES bytes
+     * @param serial the serial port. begin() is called with each baud rate, and end() at the end
+     * @param baud_rates baud rates to run at
+     * @param count number of baud rates
+     * @note reports the cycles spent in write() ("usartWrite") and until flush() returned ("usartFlush")
+     */
+    void usartThroughput(Usart &serial, const uint32_t *baud_rates, const size_t count);
+
+    /**
+     * @brief benchmark the latency from a pin edge to the attachInterrupt() callback
+     * @note measured from before digitalWrite() causing the edge, so the cost of digitalWrite() is included
+     */
+    void interruptLatency(const gpio_pin_t pin);
+
+    /**
+     * @brief benchmark Print::print(float), into a sink that discards the output
+     */
+    void printFloat();
+
+    /**
+     * @brief benchmark building a String by concatenation
+     */
+    void stringConcat();
+
+    /**
+     * @brief benchmark Intflash sector erase and programming
+     * @param address start of a unused flash sector. it is erased and overwritten
+     */
+    void flashWrite(const uint32_t address);
+
+    /**
+     * @brief print a result line of a custom benchmark
+     */
+    void report(const char *name, const uint32_t param, const core_benchmark_stats_t &stats, const uint32_t bytes = 0);
+
+private:
+    Print &out;
+    uint32_t iterations;
+
+    /**
+     * @brief cycles spent reading the cycle counter twice, subtracted from every measurement
+     */
+    uint32_t overhead;
+
+    /**
+     * @brief add a measurement to the statistics
+     */
+    void record(core_benchmark_stats_t &stats, const uint32_t start, const uint32_t end);
+};
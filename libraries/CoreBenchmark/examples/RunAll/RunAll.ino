@@ -0,0 +1,34 @@
+/*
+  CoreBenchmark RunAll
+
+  Runs all core benchmarks and prints the report to Serial, as one JSON object per line.
+  Save the output of two core releases and compare them using tools/benchmark/compare.py.
+
+  Adjust the pins to your board. Pins set to -1 skip their benchmark.
+  The interrupt pin is driven as output and must not be connected to anything.
+*/
+#include <CoreBenchmark.h>
+
+static const uint32_t baud_rates[] = {115200, 250000, 1000000};
+
+void setup()
+{
+  Serial.begin(115200);
+
+  core_benchmark_config_t config;
+  config.digital_pin = PA0;
+  config.analog_pin = PA1;
+  config.pwm_pin = -1;
+  config.interrupt_pin = PB0;
+  config.serial = NULL;
+  config.baud_rates = baud_rates;
+  config.baud_rate_count = sizeof(baud_rates) / sizeof(baud_rates[0]);
+  config.flash_address = 0; // e.g. the start of an unused sector
+
+  CoreBenchmark benchmark(Serial);
+  benchmark.runAll(config);
+}
+
+void loop()
+{
+}
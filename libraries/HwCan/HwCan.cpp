@@ -0,0 +1,128 @@
+#include "HwCan.h"
+
+bool HwCan::begin(const uint32_t bitrate, const gpio_pin_t tx_pin, const gpio_pin_t rx_pin, const can_mode_t mode)
+{
+    if (running)
+    {
+        end();
+    }
+
+    rx_queue.clear();
+    tx_queue.clear();
+    rx_dropped = 0;
+    filters_set = 0;
+
+    const can_config_t config = {
+        .tx = tx_pin,
+        .rx = rx_pin,
+        .bitrate = bitrate,
+        .mode = mode,
+        .receive = on_receive,
+        .transmit = on_transmit,
+        .param = this,
+    };
+    running = can_begin(&config);
+    return running;
+}
+
+void HwCan::end()
+{
+    if (running)
+    {
+        can_end();
+        running = false;
+    }
+
+    rx_queue.clear();
+    tx_queue.clear();
+}
+
+bool HwCan::setFilter(const uint8_t index, const uint32_t id, const uint32_t mask, const can_filter_type_t type)
+{
+    if (!running || index >= CAN_FILTER_COUNT)
+    {
+        return false;
+    }
+
+    // filter 0 accepts everything after begin(). the first filter set replaces it
+    if (filters_set == 0 && index != 0)
+    {
+        can_disable_filter(0);
+    }
+
+    filters_set |= uint8_t(1u << index);
+    return can_set_filter(index, id, mask, type);
+}
+
+void HwCan::clearFilter(const uint8_t index)
+{
+    if (!running || index >= CAN_FILTER_COUNT)
+    {
+        return;
+    }
+
+    filters_set &= uint8_t(~(1u << index));
+    can_disable_filter(index);
+}
+
+int HwCan::available()
+{
+    return int(rx_queue.count());
+}
+
+bool HwCan::read(can_frame_t &frame)
+{
+    return rx_queue.pop(frame);
+}
+
+bool HwCan::write(const can_frame_t &frame)
+{
+    if (!running || !tx_queue.push(frame))
+    {
+        return false;
+    }
+
+    can_transmit_kick();
+    return true;
+}
+
+bool HwCan::write(const uint32_t id, const void *data, const uint8_t length)
+{
+    can_frame_t frame = {};
+    frame.id = id;
+    frame.extended = id > CAN_STANDARD_ID_MASK;
+    frame.length = length > sizeof(frame.data) ? sizeof(frame.data) : length;
+    memcpy(frame.data, data, frame.length);
+    return write(frame);
+}
+
+int HwCan::availableForWrite()
+{
+    return int(tx_queue.capacity() - tx_queue.count());
+}
+
+uint32_t HwCan::droppedFrames()
+{
+    can_error_state_t state;
+    can_get_error_state(state);
+    return rx_dropped + state.overflows;
+}
+
+void HwCan::errorState(can_error_state_t &state)
+{
+    can_get_error_state(state);
+}
+
+void HwCan::on_receive(const can_frame_t &frame, void *param)
+{
+    HwCan *can = static_cast<HwCan *>(param);
+    if (!can->rx_queue.push(frame))
+    {
+        can->rx_dropped++;
+    }
+}
+
+bool HwCan::on_transmit(can_frame_t &frame, void *param)
+{
+    return static_cast<HwCan *>(param)->tx_queue.pop(frame);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "Arduino.h"
+#include "RingBuffer.h"
+#include "drivers/can/can.h"
+
+#ifndef CAN_RX_QUEUE_SIZE
+/**
+ * @brief number of received frames buffered until read(). must be a power of two
+ */
+#define CAN_RX_QUEUE_SIZE 32
+#endif
+
+#ifndef CAN_TX_QUEUE_SIZE
+/**
+ * @brief number of frames queued for sending. must be a power of two
+ */
+#define CAN_TX_QUEUE_SIZE 16
+#endif
+
+/**
+ * CAN bus using the CAN controller, see drivers/can/can.h.
+ *
+ * received frames accepted by the hardware filters are buffered by the interrupt, frames written are queued and
+ * sent in the background:
+ *
+ *   HwCan can;
+ *   can.begin(500000, PB6, PB7);
+ *   can.setFilter(0, 0x100, 0x700); // accept ids 0x100 - 0x1FF
+ *
+ *   can_frame_t frame;
+ *   while (can.read(frame)) { ... }
+ *
+ * only one instance can be started at a time.
+ */
+class HwCan
+{
+public:
+    /**
+     * @brief start the controller
+     * @param bitrate the bit rate, e.g. 500000
+     * @param tx_pin the CAN_TX pin
+     * @param rx_pin the CAN_RX pin
+     * @param mode operating mode, e.g. CAN_MODE_LOOPBACK_INTERNAL for tests without a bus
+     * @return false if the bit rate cannot be set, or another instance is started
+     * @note all frames are accepted until setFilter() is called
+     */
+    bool begin(const uint32_t bitrate, const gpio_pin_t tx_pin, const gpio_pin_t rx_pin, const can_mode_t mode = CAN_MODE_NORMAL);
+
+    /**
+     * @brief stop the controller, and discard all buffered frames
+     */
+    void end();
+
+    /**
+     * @brief accept only frames matching a filter
+     * @param index the filter, 0 - CAN_FILTER_COUNT - 1. filters that were not set are disabled
+     * @param id the id to accept
+     * @param mask id bits that must match
+     * @param type accepted id type
+     */
+    bool setFilter(const uint8_t index, const uint32_t id, const uint32_t mask, const can_filter_type_t type = CAN_FILTER_STANDARD);
+
+    /**
+     * @brief disable a filter set by setFilter()
+     */
+    void clearFilter(const uint8_t index);
+
+    /**
+     * @brief number of received frames buffered
+     */
+    int available();
+
+    /**
+     * @brief get the oldest received frame
+     * @return false if no frame was received
+     */
+    bool read(can_frame_t &frame);
+
+    /**
+     * @brief queue a frame for sending
+     * @return false if the queue is full
+     */
+    bool write(const can_frame_t &frame);
+
+    /**
+     * @brief queue a frame for sending
+     * @param id the id. ids above 0x7FF are sent as extended ids
+     * @param data the data, up to 8 bytes
+     * @param length number of data bytes
+     */
+    bool write(const uint32_t id, const void *data, const uint8_t length);
+
+    /**
+     * @brief number of frames that can be queued without write() failing
+     */
+    int availableForWrite();
+
+    /**
+     * @brief number of received frames dropped because the receive queue was full, plus the FIFO overflows of the controller
+     */
+    uint32_t droppedFrames();
+
+    /**
+     * @brief get the error state of the controller
+     */
+    void errorState(can_error_state_t &state);
+
+private:
+    static void on_receive(const can_frame_t &frame, void *param);
+    static bool on_transmit(can_frame_t &frame, void *param);
+
+    RingBuffer<can_frame_t, CAN_RX_QUEUE_SIZE> rx_queue;
+    RingBuffer<can_frame_t, CAN_TX_QUEUE_SIZE> tx_queue;
+    volatile uint32_t rx_dropped = 0;
+    uint8_t filters_set = 0;
+    bool running = false;
+};
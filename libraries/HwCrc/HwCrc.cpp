@@ -0,0 +1,43 @@
+#include "HwCrc.h"
+
+HwCrc::HwCrc(const crc_algorithm_t &algorithm)
+{
+    crc_begin(context, algorithm);
+}
+
+void HwCrc::reset()
+{
+    crc_begin(context, *context.algorithm);
+}
+
+void HwCrc::update(const void *data, const size_t length)
+{
+    crc_update(context, data, length);
+}
+
+void HwCrc::updateDma(const void *data, const size_t length)
+{
+    crc_update_dma(context, data, length);
+}
+
+uint32_t HwCrc::value() const
+{
+    return crc_final(context);
+}
+
+uint32_t HwCrc::calculate(const void *data, const size_t length, const crc_algorithm_t &algorithm)
+{
+    return crc_calculate(algorithm, data, length);
+}
+
+size_t HwCrc::write(uint8_t byte)
+{
+    crc_update(context, &byte, 1);
+    return 1;
+}
+
+size_t HwCrc::write(const uint8_t *buffer, size_t size)
+{
+    crc_update(context, buffer, size);
+    return size;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Arduino.h"
+#include "drivers/crc/crc.h"
+
+/**
+ * CRC16 / CRC32 calculation using the CRC unit, see drivers/crc/crc.h.
+ *
+ * data is added using update(), or by printing to it, e.g. to checksum a line of text:
+ *
+ *   HwCrc crc(CRC_ALGORITHM_CRC16_XMODEM);
+ *   crc.print("N10 G1 X10");
+ *   const uint32_t checksum = crc.value();
+ */
+class HwCrc : public Print
+{
+public:
+    /**
+     * @brief create a CRC calculation
+     * @param algorithm the algorithm, e.g. CRC_ALGORITHM_CRC32. must stay valid while the instance is used
+     */
+    HwCrc(const crc_algorithm_t &algorithm = CRC_ALGORITHM_CRC32);
+
+    /**
+     * @brief restart the calculation
+     */
+    void reset();
+
+    /**
+     * @brief add data to the calculation
+     */
+    void update(const void *data, const size_t length);
+
+    /**
+     * @brief add data to the calculation, fed to the CRC unit by DMA
+     * @note waits for the DMA to complete. see crc_update_dma()
+     */
+    void updateDma(const void *data, const size_t length);
+
+    /**
+     * @brief get the CRC of all data added since the last reset()
+     */
+    uint32_t value() const;
+
+    /**
+     * @brief calculate the CRC of a buffer
+     */
+    static uint32_t calculate(const void *data, const size_t length, const crc_algorithm_t &algorithm = CRC_ALGORITHM_CRC32);
+
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+
+private:
+    crc_context_t context;
+};
@@ -0,0 +1,292 @@
+#include "HwCrypto.h"
+#include "core_debug.h"
+#include "core_critical.h"
+
+// HASH registers, as offsets from the HASH register base
+#define HASH_CR_OFFSET 0x00ul
+#define HASH_HR_OFFSET 0x10ul // HR7 - HR0, digest word 0 first
+#define HASH_DR_OFFSET 0x40ul // DR15 - DR0, message word 0 first
+
+// HASH_CR bits
+#define HASH_CR_START (1ul << 0)
+#define HASH_CR_FST_GRP (1ul << 1)
+
+// AES registers, as offsets from the AES register base
+#define AES_CR_OFFSET 0x00ul
+#define AES_DR_OFFSET 0x10ul // DR0 - DR3
+#define AES_KR_OFFSET 0x20ul // KR0 - KR3
+
+// AES_CR bits
+#define AES_CR_START (1ul << 0)
+#define AES_CR_DECRYPT (1ul << 1)
+
+// the message length is appended to the last block, as 64-bit big-endian number of bits
+#define SHA256_LENGTH_SIZE 8
+
+/**
+ * @brief is the HASH unit claimed by a Sha256 instance?
+ */
+static bool hash_claimed = false;
+
+static inline volatile uint32_t *hash_register(const uint32_t offset)
+{
+    return reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_HASH) + offset);
+}
+
+static inline volatile uint32_t *aes_register(const uint32_t offset)
+{
+    return reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uint32_t>(M4_AES) + offset);
+}
+
+/**
+ * @brief read a word from a possibly unaligned buffer
+ */
+static inline uint32_t read_word(const uint8_t *data)
+{
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static inline void write_word(uint8_t *data, const uint32_t word)
+{
+    memcpy(data, &word, sizeof(word));
+}
+
+//
+// Sha256
+//
+
+bool Sha256::begin()
+{
+    const uint32_t critical = core_critical_enter();
+    const bool available = !hash_claimed || running;
+    hash_claimed = true;
+    core_critical_exit(critical);
+
+    if (!available)
+    {
+        return false;
+    }
+
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_HASH, Enable);
+    running = true;
+    first_block = true;
+    buffered = 0;
+    total_length = 0;
+    return true;
+}
+
+void Sha256::end()
+{
+    if (running)
+    {
+        running = false;
+        hash_claimed = false;
+    }
+}
+
+void Sha256::process_block(const uint8_t *block)
+{
+    // the HASH unit expects the message words big-endian
+    volatile uint32_t *dr = hash_register(HASH_DR_OFFSET);
+    for (size_t i = 0; i < BLOCK_SIZE / 4; i++)
+    {
+        dr[i] = __REV(read_word(block + (i * 4)));
+    }
+
+    // the first block starts from the initial hash value, the others continue from the previous result
+    volatile uint32_t *cr = hash_register(HASH_CR_OFFSET);
+    *cr = HASH_CR_START | (first_block ? HASH_CR_FST_GRP : 0ul);
+    first_block = false;
+
+    while ((*cr & HASH_CR_START) != 0)
+        ;
+}
+
+void Sha256::update(const void *data, size_t length)
+{
+    CORE_ASSERT(running, "Sha256::update: begin() not called", return);
+
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    total_length += length;
+
+    // complete the buffered block
+    if (buffered > 0)
+    {
+        const size_t fill = min(length, BLOCK_SIZE - buffered);
+        memcpy(buffer + buffered, bytes, fill);
+        buffered += fill;
+        bytes += fill;
+        length -= fill;
+
+        if (buffered < BLOCK_SIZE)
+        {
+            return;
+        }
+
+        process_block(buffer);
+        buffered = 0;
+    }
+
+    for (; length >= BLOCK_SIZE; length -= BLOCK_SIZE)
+    {
+        process_block(bytes);
+        bytes += BLOCK_SIZE;
+    }
+
+    memcpy(buffer, bytes, length);
+    buffered = length;
+}
+
+void Sha256::final(uint8_t *digest)
+{
+    CORE_ASSERT(running, "Sha256::final: begin() not called", return);
+
+    // padding: a 1 bit, zeros up to the length field, and the message length in bits.
+    // the HASH unit does not pad by itself
+    const uint64_t bit_length = total_length * 8;
+    buffer[buffered++] = 0x80;
+    if (buffered > BLOCK_SIZE - SHA256_LENGTH_SIZE)
+    {
+        memset(buffer + buffered, 0, BLOCK_SIZE - buffered);
+        process_block(buffer);
+        buffered = 0;
+    }
+
+    memset(buffer + buffered, 0, BLOCK_SIZE - SHA256_LENGTH_SIZE - buffered);
+    write_word(buffer + BLOCK_SIZE - 8, __REV(uint32_t(bit_length >> 32)));
+    write_word(buffer + BLOCK_SIZE - 4, __REV(uint32_t(bit_length)));
+    process_block(buffer);
+
+    volatile uint32_t *hr = hash_register(HASH_HR_OFFSET);
+    for (size_t i = 0; i < DIGEST_SIZE / 4; i++)
+    {
+        write_word(digest + (i * 4), __REV(hr[i]));
+    }
+
+    end();
+}
+
+bool Sha256::hash(const void *data, const size_t length, uint8_t *digest)
+{
+    Sha256 sha;
+    if (!sha.begin())
+    {
+        return false;
+    }
+
+    sha.update(data, length);
+    sha.final(digest);
+    return true;
+}
+
+//
+// Aes128
+//
+
+void Aes128::setKey(const uint8_t *key)
+{
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AES, Enable);
+    for (size_t i = 0; i < KEY_SIZE / 4; i++)
+    {
+        this->key[i] = read_word(key + (i * 4));
+    }
+}
+
+void Aes128::process_block(const bool decrypt, const uint8_t *in, uint8_t *out)
+{
+    volatile uint32_t *cr = aes_register(AES_CR_OFFSET);
+    volatile uint32_t *dr = aes_register(AES_DR_OFFSET);
+    volatile uint32_t *kr = aes_register(AES_KR_OFFSET);
+
+    // other instances may use the AES unit in between blocks, so it is loaded completely for every block
+    const uint32_t critical = core_critical_enter();
+    for (size_t i = 0; i < BLOCK_SIZE / 4; i++)
+    {
+        kr[i] = key[i];
+        dr[i] = read_word(in + (i * 4));
+    }
+
+    *cr = AES_CR_START | (decrypt ? AES_CR_DECRYPT : 0ul);
+    while ((*cr & AES_CR_START) != 0)
+        ;
+
+    for (size_t i = 0; i < BLOCK_SIZE / 4; i++)
+    {
+        write_word(out + (i * 4), dr[i]);
+    }
+    core_critical_exit(critical);
+}
+
+void Aes128::encryptEcb(const uint8_t *in, uint8_t *out, const size_t length)
+{
+    CORE_ASSERT((length % BLOCK_SIZE) == 0, "Aes128::encryptEcb: length must be a multiple of BLOCK_SIZE", return);
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        process_block(false, in + offset, out + offset);
+    }
+}
+
+void Aes128::decryptEcb(const uint8_t *in, uint8_t *out, const size_t length)
+{
+    CORE_ASSERT((length % BLOCK_SIZE) == 0, "Aes128::decryptEcb: length must be a multiple of BLOCK_SIZE", return);
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        process_block(true, in + offset, out + offset);
+    }
+}
+
+void Aes128::encryptCbc(uint8_t *iv, const uint8_t *in, uint8_t *out, const size_t length)
+{
+    CORE_ASSERT((length % BLOCK_SIZE) == 0, "Aes128::encryptCbc: length must be a multiple of BLOCK_SIZE", return);
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        uint8_t block[BLOCK_SIZE];
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            block[i] = in[offset + i] ^ iv[i];
+        }
+
+        process_block(false, block, out + offset);
+        memcpy(iv, out + offset, BLOCK_SIZE);
+    }
+}
+
+void Aes128::decryptCbc(uint8_t *iv, const uint8_t *in, uint8_t *out, const size_t length)
+{
+    CORE_ASSERT((length % BLOCK_SIZE) == 0, "Aes128::decryptCbc: length must be a multiple of BLOCK_SIZE", return);
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        // keep the ciphertext, out may overwrite it
+        uint8_t ciphertext[BLOCK_SIZE];
+        memcpy(ciphertext, in + offset, BLOCK_SIZE);
+
+        process_block(true, ciphertext, out + offset);
+        for (size_t i = 0; i < BLOCK_SIZE; i++)
+        {
+            out[offset + i] ^= iv[i];
+        }
+
+        memcpy(iv, ciphertext, BLOCK_SIZE);
+    }
+}
+
+void Aes128::cryptCtr(uint8_t *counter, const uint8_t *in, uint8_t *out, const size_t length)
+{
+    for (size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+    {
+        uint8_t stream[BLOCK_SIZE];
+        process_block(false, counter, stream);
+
+        const size_t count = min(length - offset, BLOCK_SIZE);
+        for (size_t i = 0; i < count; i++)
+        {
+            out[offset + i] = in[offset + i] ^ stream[i];
+        }
+
+        // increment the counter block, big-endian
+        for (int i = BLOCK_SIZE - 1; i >= 0 && ++counter[i] == 0; i--)
+            ;
+    }
+}
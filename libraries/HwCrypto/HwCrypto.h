@@ -0,0 +1,133 @@
+#pragma once
+
+// check ddl configuration
+#if (DDL_PWC_ENABLE != DDL_ON)
+#error "HwCrypto library requires PWC DDL to be enabled"
+#endif
+
+#include "Arduino.h"
+#include <hc32_ddl.h>
+
+/**
+ * SHA-256 using the HASH unit.
+ *
+ * the HASH unit holds the state of one calculation, so only one Sha256 instance can be used at a time.
+ * begin() claims the unit, and final() releases it.
+ *
+ *   Sha256 sha;
+ *   uint8_t digest[Sha256::DIGEST_SIZE];
+ *   if (sha.begin())
+ *   {
+ *       sha.update(image, image_size);
+ *       sha.final(digest);
+ *   }
+ */
+class Sha256
+{
+public:
+    static constexpr size_t DIGEST_SIZE = 32;
+    static constexpr size_t BLOCK_SIZE = 64;
+
+    /**
+     * @brief start a calculation, and claim the HASH unit
+     * @return false if the HASH unit is used by another calculation
+     */
+    bool begin();
+
+    /**
+     * @brief add data to the calculation
+     * @note full blocks are fed to the HASH unit directly from data, the rest is buffered
+     */
+    void update(const void *data, size_t length);
+
+    /**
+     * @brief finish the calculation, and release the HASH unit
+     * @param digest receives the DIGEST_SIZE bytes of the digest
+     */
+    void final(uint8_t *digest);
+
+    /**
+     * @brief abort the calculation, and release the HASH unit
+     */
+    void end();
+
+    /**
+     * @brief calculate the SHA-256 digest of a buffer
+     * @return false if the HASH unit is in use
+     */
+    static bool hash(const void *data, const size_t length, uint8_t *digest);
+
+private:
+    uint8_t buffer[BLOCK_SIZE];
+    uint8_t buffered = 0;
+    bool first_block = true;
+    bool running = false;
+    uint64_t total_length = 0;
+
+    void process_block(const uint8_t *block);
+};
+
+/**
+ * AES-128 using the AES unit.
+ *
+ * every block is processed with interrupts disabled, and the key is loaded for each block,
+ * so multiple Aes128 instances (and interrupts) may use the AES unit at the same time.
+ * the AES unit supports 128-bit keys only.
+ */
+class Aes128
+{
+public:
+    static constexpr size_t KEY_SIZE = 16;
+    static constexpr size_t BLOCK_SIZE = 16;
+
+    /**
+     * @brief set the key
+     * @param key KEY_SIZE bytes
+     * @note enables the AES peripheral clock
+     */
+    void setKey(const uint8_t *key);
+
+    /**
+     * @brief encrypt in ECB mode
+     * @param in the plaintext
+     * @param out receives the ciphertext. may be the same as in
+     * @param length number of bytes. must be a multiple of BLOCK_SIZE
+     */
+    void encryptEcb(const uint8_t *in, uint8_t *out, const size_t length);
+
+    /**
+     * @brief decrypt in ECB mode
+     * @note see encryptEcb()
+     */
+    void decryptEcb(const uint8_t *in, uint8_t *out, const size_t length);
+
+    /**
+     * @brief encrypt in CBC mode
+     * @param iv BLOCK_SIZE bytes initialization vector. updated to the last ciphertext block, so consecutive calls continue the chain
+     * @param in the plaintext
+     * @param out receives the ciphertext. may be the same as in
+     * @param length number of bytes. must be a multiple of BLOCK_SIZE
+     */
+    void encryptCbc(uint8_t *iv, const uint8_t *in, uint8_t *out, const size_t length);
+
+    /**
+     * @brief decrypt in CBC mode
+     * @note see encryptCbc()
+     */
+    void decryptCbc(uint8_t *iv, const uint8_t *in, uint8_t *out, const size_t length);
+
+    /**
+     * @brief encrypt or decrypt in CTR mode
+     * @param counter BLOCK_SIZE bytes counter block, incremented as a 128-bit big-endian number per block.
+     *                updated, so consecutive calls continue the key stream
+     * @param in the input
+     * @param out receives the output. may be the same as in
+     * @param length number of bytes. if not a multiple of BLOCK_SIZE, the rest of the last key stream block is discarded
+     */
+    void cryptCtr(uint8_t *counter, const uint8_t *in, uint8_t *out, const size_t length);
+
+private:
+    uint32_t key[KEY_SIZE / 4];
+
+    void process_block(const bool decrypt, const uint8_t *in, uint8_t *out);
+};
@@ -0,0 +1,80 @@
+#include "HwKeyscan.h"
+#include "core_critical.h"
+
+bool HwKeyscan::begin(const gpio_pin_t *rows, const uint8_t row_count, const gpio_pin_t *columns, const uint8_t column_count, const uint32_t row_time_us)
+{
+    if (running)
+    {
+        end();
+    }
+
+    CORE_ASSERT(row_count <= KEYSCAN_MAX_ROWS && column_count <= KEYSCAN_MAX_COLUMNS, "HwKeyscan::begin: matrix too large", return false);
+    queue.clear();
+    dropped = 0;
+
+    keyscan_config_t config = {};
+    memcpy(config.rows, rows, row_count * sizeof(gpio_pin_t));
+    memcpy(config.columns, columns, column_count * sizeof(gpio_pin_t));
+    config.row_count = row_count;
+    config.column_count = column_count;
+    config.row_time_us = row_time_us;
+    config.callback = on_event;
+    config.param = this;
+
+    running = keyscan_begin(&config);
+    return running;
+}
+
+void HwKeyscan::end()
+{
+    if (running)
+    {
+        keyscan_end();
+        running = false;
+    }
+
+    queue.clear();
+}
+
+int HwKeyscan::available()
+{
+    if (running)
+    {
+        keyscan_poll();
+    }
+
+    return int(queue.count());
+}
+
+bool HwKeyscan::read(keyscan_event_t &event)
+{
+    available();
+    return queue.pop(event);
+}
+
+bool HwKeyscan::isPressed(const uint8_t key)
+{
+    return running && keyscan_is_pressed(key);
+}
+
+uint32_t HwKeyscan::droppedEvents()
+{
+    return dropped;
+}
+
+void HwKeyscan::on_event(const uint8_t key, const bool pressed, void *param)
+{
+    HwKeyscan *self = static_cast<HwKeyscan *>(param);
+    const keyscan_event_t event = {
+        .key = key,
+        .pressed = pressed,
+    };
+
+    // presses are pushed by the interrupt, releases by keyscan_poll()
+    const uint32_t state = core_critical_enter();
+    if (!self->queue.push(event))
+    {
+        self->dropped++;
+    }
+    core_critical_exit(state);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "Arduino.h"
+#include "RingBuffer.h"
+#include "drivers/keyscan/keyscan.h"
+
+#ifndef KEYSCAN_QUEUE_SIZE
+/**
+ * @brief number of key events buffered until read(). must be a power of two
+ */
+#define KEYSCAN_QUEUE_SIZE 16
+#endif
+
+/**
+ * @brief a key press or release
+ */
+struct keyscan_event_t
+{
+    /**
+     * @brief the key number, row * column count + column
+     */
+    uint8_t key;
+    bool pressed;
+};
+
+/**
+ * button matrix scanned by the KEYSCAN peripheral, see drivers/keyscan/keyscan.h.
+ *
+ * key presses are reported by interrupt and buffered, so the matrix costs no CPU time until a key is pressed:
+ *
+ *   const gpio_pin_t rows[] = {PC0, PC1, PC2};
+ *   const gpio_pin_t columns[] = {PB0, PB1, PB2, PB3};
+ *
+ *   HwKeyscan keys;
+ *   keys.begin(rows, 3, columns, 4);
+ *
+ *   keyscan_event_t event;
+ *   while (keys.read(event)) { ... }
+ *
+ * only one instance can be started at a time.
+ */
+class HwKeyscan
+{
+public:
+    /**
+     * @brief start scanning the matrix
+     * @param rows the row pins. rows[n] must be the KEYOUTn pin
+     * @param row_count number of rows, 2 - 8
+     * @param columns the column pins, each on a different EXTI line
+     * @param column_count number of columns, 1 - 16
+     * @param row_time_us how long each row is scanned, in microseconds. 0 for the default
+     * @return false if the configuration is invalid
+     */
+    bool begin(const gpio_pin_t *rows, const uint8_t row_count, const gpio_pin_t *columns, const uint8_t column_count, const uint32_t row_time_us = 0);
+
+    /**
+     * @brief stop scanning, and discard all buffered events
+     */
+    void end();
+
+    /**
+     * @brief number of buffered key events
+     * @note also detects released keys
+     */
+    int available();
+
+    /**
+     * @brief get the oldest key event
+     * @return false if there is no event
+     */
+    bool read(keyscan_event_t &event);
+
+    /**
+     * @brief is a key pressed right now?
+     */
+    bool isPressed(const uint8_t key);
+
+    /**
+     * @brief number of key events dropped because the queue was full
+     */
+    uint32_t droppedEvents();
+
+private:
+    static void on_event(const uint8_t key, const bool pressed, void *param);
+
+    RingBuffer<keyscan_event_t, KEYSCAN_QUEUE_SIZE> queue;
+    volatile uint32_t dropped = 0;
+    bool running = false;
+};
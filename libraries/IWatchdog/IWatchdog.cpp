@@ -143,7 +143,7 @@ inline void register_wdt_callback(const voidFuncPtr callback)
     // register and enable IRQ
     enIrqRegistration(&irq_config);
     NVIC_ClearPendingIRQ(irqn);
-    NVIC_SetPriority(irqn, DDL_IRQ_PRIORITY_DEFAULT);
+    NVIC_SetPriority(irqn, IRQ_PRIORITY_LOW);
     NVIC_EnableIRQ(irqn);
 }
 
@@ -182,6 +182,10 @@ void IWatchdog::begin(const uint32_t divider, const uint32_t count_cycle, const
         register_wdt_callback(callback);
     }
 
+    // reload from yield() four times per timeout, so a late yield() still makes it in time
+    const uint32_t timeout_ms = uint32_t((uint64_t(count_cycle) * divider * 1000) / get_wdt_base_clock());
+    setReloadInterval(timeout_ms / 4);
+
     // call begin() with configuration
     begin(&config);
 
@@ -210,6 +214,46 @@ void IWatchdog::reload(void)
     }
 
     WDT_RefreshCounter();
+    this->last_reload_millis = millis();
+    this->checked_in = 0;
+}
+
+void IWatchdog::reloadIfDue(void)
+{
+    if (!this->initialized || (millis() - this->last_reload_millis) < this->reload_interval_ms)
+    {
+        return;
+    }
+
+    // every registered subsystem must have made progress since the last reload
+    const uint32_t required = this->required_check_ins;
+    if ((this->checked_in & required) != required)
+    {
+        return;
+    }
+
+    reload();
+}
+
+uint32_t IWatchdog::registerCheckIn(void)
+{
+    const uint32_t free = ~this->required_check_ins;
+    if (free == 0)
+    {
+        CORE_DEBUG_PRINTF("IWatchdog::registerCheckIn: all check-ins in use\n");
+        return 0;
+    }
+
+    // lowest free bit. counts as checked in, so registering does not delay the next reload
+    const uint32_t check_in = free & -free;
+    checkIn(check_in);
+    this->required_check_ins |= check_in;
+    return check_in;
+}
+
+void IWatchdog::unregisterCheckIn(const uint32_t check_in)
+{
+    this->required_check_ins &= ~check_in;
 }
 
 uint16_t IWatchdog::getCounter(void)
@@ -224,6 +268,6 @@ uint16_t IWatchdog::getCounter(void)
 
 void core_hook_yield_wdt_reload(void)
 {
-    // reload watchdog on yield() calls
-    WDT.reload();
+    // reload watchdog on yield() calls, rate-limited
+    WDT.reloadIfDue();
 }
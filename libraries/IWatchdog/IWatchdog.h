@@ -9,6 +9,24 @@
 #include "Arduino.h"
 #include <hc32_ddl.h>
 
+/**
+ * internal watchdog (WDT).
+ *
+ * once started, the watchdog is reloaded from yield(), at most every reload interval (a quarter of the timeout
+ * by default), so spin loops calling yield() cost no more than a compare per call.
+ *
+ * subsystems can register a check-in, e.g. the main loop and a communication task. yield() then only reloads the
+ * watchdog once every registered check-in was done since the last reload, so a stalled subsystem causes a timeout
+ * even though yield() is still called elsewhere:
+ *
+ *   const uint32_t loop_check_in = WDT.registerCheckIn();
+ *   ...
+ *   void loop()
+ *   {
+ *       WDT.checkIn(loop_check_in);
+ *       ...
+ *   }
+ */
 class IWatchdog
 {
 public:
@@ -45,9 +63,47 @@ public:
 
     /**
      * @brief refresh internal watchdog
+     * @note reloads unconditionally, ignoring the reload interval and check-ins
      */
     void reload(void);
 
+    /**
+     * @brief reload the watchdog if the reload interval elapsed and all registered check-ins were done
+     * @note called by yield()
+     */
+    void reloadIfDue(void);
+
+    /**
+     * @brief set the minimum time between reloads done by yield()
+     * @param interval_ms the interval, in milliseconds. 0 reloads on every yield()
+     * @note begin() sets it to a quarter of the timeout. begin(config) leaves it unchanged
+     */
+    void setReloadInterval(const uint32_t interval_ms)
+    {
+        this->reload_interval_ms = interval_ms;
+    }
+
+    /**
+     * @brief register a subsystem that must check in before every reload done by yield()
+     * @return the check-in bit of the subsystem, to pass to checkIn(). 0 if all 32 check-ins are in use
+     */
+    uint32_t registerCheckIn(void);
+
+    /**
+     * @brief unregister a subsystem registered with registerCheckIn()
+     */
+    void unregisterCheckIn(const uint32_t check_in);
+
+    /**
+     * @brief signal that a subsystem made progress
+     * @param check_in the check-in bit(s) returned by registerCheckIn()
+     * @note may be called from interrupts
+     */
+    void checkIn(const uint32_t check_in)
+    {
+        __atomic_fetch_or(&this->checked_in, check_in, __ATOMIC_RELAXED);
+    }
+
     /**
      * @brief get internal watchdog counter value
      */
@@ -55,6 +111,22 @@ public:
 
 private:
     bool initialized = false;
+
+    /**
+     * @brief minimum time between reloads done by yield(), in milliseconds
+     */
+    uint32_t reload_interval_ms = 0;
+
+    /**
+     * @brief value of millis() at the last reload
+     */
+    uint32_t last_reload_millis = 0;
+
+    /**
+     * @brief check-ins that must be done before a reload, and check-ins done since the last reload
+     */
+    uint32_t required_check_ins = 0;
+    volatile uint32_t checked_in = 0;
 };
 
 extern IWatchdog WDT;
@@ -1,6 +1,9 @@
 #include "OnChipTemperature.h"
 
 #include <core_debug.h>
+#include <core_critical.h>
+#include <drivers/irqn/irqn.h>
+#include <drivers/aos/aos.h>
 
 #define OTS_READ_TIMEOUT_MS 25 // 25 ms
 
@@ -12,6 +15,63 @@
 //
 OnChipTemperature ChipTemperature;
 
+//
+// background measurement state, shared with the OTS interrupt
+//
+static volatile bool reading = false;
+static volatile bool has_last_temperature = false;
+static volatile float last_temperature = 0.0f;
+static volatile uint32_t last_temperature_millis = 0;
+static volatile ots_read_callback_t read_callback = NULL;
+
+/**
+ * @brief IRQn of the measurement done interrupt
+ * @note only valid once irq_registered is set
+ */
+static IRQn_Type ots_irqn;
+static bool irq_registered = false;
+
+/**
+ * @brief OTS measurement done interrupt
+ */
+static void ots_irq_handler()
+{
+    const float temperature = OTS_CalculateTemp();
+    last_temperature = temperature;
+    last_temperature_millis = millis();
+    has_last_temperature = true;
+    reading = false;
+
+    const ots_read_callback_t callback = read_callback;
+    if (callback != NULL)
+    {
+        callback(temperature);
+    }
+}
+
+/**
+ * @brief register and enable the measurement done interrupt, if not already done
+ */
+static void enable_irq()
+{
+    if (!irq_registered)
+    {
+        irqn_aa_get(ots_irqn, "OTS");
+        stc_irq_regi_conf_t irq_config = {
+            .enIntSrc = INT_OTS_TRI,
+            .enIRQn = ots_irqn,
+            .pfnCallback = ots_irq_handler,
+        };
+        enIrqRegistration(&irq_config);
+        NVIC_ClearPendingIRQ(ots_irqn);
+        NVIC_SetPriority(ots_irqn, IRQ_PRIORITY_LOW);
+        NVIC_EnableIRQ(ots_irqn);
+        irq_registered = true;
+    }
+
+    OTS_IntCmd(Enable);
+}
+
 //
 // OnChipTemperature class implementation
 //
@@ -62,6 +122,12 @@ void OnChipTemperature::begin(const stc_ots_init_t *config)
 
 bool OnChipTemperature::read(float &temperature)
 {
+    // polling would race the background measurement
+    if (reading)
+    {
+        return false;
+    }
+
     // should we read?
     uint32_t now;
     if (!shouldRead(now))
@@ -81,6 +147,71 @@ bool OnChipTemperature::read(float &temperature)
     return true;
 }
 
+bool OnChipTemperature::startRead()
+{
+    const uint32_t critical = core_critical_enter();
+    const bool start = !reading;
+    reading = true;
+    core_critical_exit(critical);
+
+    if (!start)
+    {
+        return false;
+    }
+
+    enable_irq();
+    OTS_Start();
+    return true;
+}
+
+bool OnChipTemperature::isReading()
+{
+    return reading;
+}
+
+bool OnChipTemperature::readAsync(float &temperature)
+{
+    // start the next measurement once the last one is old enough
+    if (!reading && (!has_last_temperature || (millis() - last_temperature_millis) >= this->minimumReadDeltaMillis))
+    {
+        startRead();
+    }
+
+    return getLastTemperature(temperature);
+}
+
+bool OnChipTemperature::getLastTemperature(float &temperature, uint32_t *timestamp)
+{
+    // the interrupt may update the cache in between
+    const uint32_t critical = core_critical_enter();
+    const bool valid = has_last_temperature;
+    temperature = last_temperature;
+    if (timestamp != NULL)
+    {
+        *timestamp = last_temperature_millis;
+    }
+    core_critical_exit(critical);
+
+    return valid;
+}
+
+void OnChipTemperature::setReadCallback(ots_read_callback_t callback)
+{
+    read_callback = callback;
+}
+
+void OnChipTemperature::startTriggeredRead(const en_event_src_t source)
+{
+    aos_claim(AOS_TARGET_OTS, "OTS");
+    enable_irq();
+    aos_connect(AOS_TARGET_OTS, source);
+}
+
+void OnChipTemperature::stopTriggeredRead()
+{
+    aos_resign(AOS_TARGET_OTS, "OTS");
+}
+
 //
 // private:
 //
@@ -16,6 +16,13 @@
 #include "Arduino.h"
 #include <hc32_ddl.h>
 
+/**
+ * @brief measurement complete callback
+ * @param temperature the measured temperature
+ * @note called from the OTS interrupt
+ */
+typedef void (*ots_read_callback_t)(const float temperature);
+
 /**
  * @brief On-Chip Temperature Sensor (OTS) class
  */
@@ -63,6 +70,53 @@ public:
         return this->minimumReadDeltaMillis;
     }
 
+    /**
+     * @brief start a measurement in the background
+     * @return true if the measurement was started, false if one is already running
+     * @note the result is cached once the OTS interrupt signals completion, see getLastTemperature()
+     */
+    bool startRead();
+
+    /**
+     * @brief is a background measurement running?
+     */
+    bool isReading();
+
+    /**
+     * @brief read the temperature without blocking
+     * @param temperature the last measured temperature
+     * @return true if a measurement completed since begin()
+     * @note starts a new background measurement if the last one is older than the minimum read delta
+     */
+    bool readAsync(float &temperature);
+
+    /**
+     * @brief get the result of the last measurement
+     * @param temperature the last measured temperature
+     * @param timestamp if not NULL, receives the value of millis() the measurement completed at
+     * @return true if a measurement completed since begin()
+     */
+    bool getLastTemperature(float &temperature, uint32_t *timestamp = NULL);
+
+    /**
+     * @brief set a callback called when a background measurement completes
+     * @param callback the callback, or NULL to remove it
+     * @note the callback is called from the OTS interrupt
+     */
+    void setReadCallback(ots_read_callback_t callback);
+
+    /**
+     * @brief start a measurement on every occurrence of a hardware event, e.g. EVT_TMRA1_OVF
+     * @param source the event source, routed to the OTS by the AOS
+     * @note results are cached like with startRead(). the AOS target is claimed as "OTS"
+     */
+    void startTriggeredRead(const en_event_src_t source);
+
+    /**
+     * @brief stop measurements started by a hardware event
+     */
+    void stopTriggeredRead();
+
 private:
     /**
      * internal OTS read function, using OTS_Polling
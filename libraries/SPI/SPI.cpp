@@ -0,0 +1,670 @@
+#include "SPI.h"
+#include <drivers/gpio/gpio.h>
+#include <drivers/irqn/irqn.h>
+#include <drivers/dma/dma.h>
+#include <core_critical.h>
+
+// DMA transfer count register is 16 bits wide
+#define SPI_DMA_MAX_BLOCK_LENGTH 0xFFFF
+
+//
+// DMA helpers
+//
+
+/**
+ * @brief source of the tx DMA channel if there is no tx buffer
+ */
+static uint8_t spi_dma_dummy_tx = 0xFF;
+
+/**
+ * @brief destination of the rx DMA channel if there is no rx buffer
+ */
+static uint8_t spi_dma_dummy_rx;
+
+/**
+ * @brief initialize a DMA channel for a single block
+ */
+static void spi_dma_init_channel(spi_dma_config_t &dma,
+                                 const en_dma_channel_t channel,
+                                 const uint32_t src,
+                                 const en_dma_address_mode_t src_mode,
+                                 const uint32_t dst,
+                                 const en_dma_address_mode_t dst_mode,
+                                 const uint16_t length,
+                                 const en_functional_state_t interrupt)
+{
+    stc_dma_config_t dma_config = {
+        .u16BlockSize = 1,
+        .u16TransferCnt = length,
+        .u32SrcAddr = src,
+        .u32DesAddr = dst,
+        .u16SrcRptSize = 0,
+        .u16DesRptSize = 0,
+        .stcDmaChCfg = {
+            .enSrcInc = src_mode,
+            .enDesInc = dst_mode,
+            .enSrcRptEn = Disable,
+            .enDesRptEn = Disable,
+            .enSrcNseqEn = Disable,
+            .enDesNseqEn = Disable,
+            .enTrnWidth = Dma8Bit,
+            .enLlpEn = Disable,
+            .enIntEn = interrupt,
+        },
+    };
+
+    DMA_ClearIrqFlag(dma.register_base, channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(dma.register_base, channel, BlkTrnCpltIrq);
+    DMA_InitChannel(dma.register_base, channel, &dma_config);
+}
+
+/**
+ * @brief start the DMA transfer of the next block
+ * @note the peripheral is disabled and re-enabled to generate the first TX empty event
+ */
+static void spi_dma_start_block(spi_config_t *config)
+{
+    spi_dma_config_t &dma = config->dma;
+    spi_state_t &state = config->state;
+    M4_SPI_TypeDef *spi = config->peripheral.register_base;
+
+    const uint16_t length = state.remaining > SPI_DMA_MAX_BLOCK_LENGTH
+                                ? SPI_DMA_MAX_BLOCK_LENGTH
+                                : static_cast<uint16_t>(state.remaining);
+    state.block_length = length;
+
+    spi->CR1_f.SPE = 0;
+
+    // rx channel: SPIx->DR -> rx buffer, interrupt once the last byte was received
+    spi_dma_init_channel(dma, dma.rx_channel,
+                         uint32_t(&spi->DR), AddressFix,
+                         state.rx != NULL ? uint32_t(state.rx) : uint32_t(&spi_dma_dummy_rx),
+                         state.rx != NULL ? AddressIncrease : AddressFix,
+                         length, Enable);
+
+    // tx channel: tx buffer -> SPIx->DR
+    spi_dma_init_channel(dma, dma.tx_channel,
+                         state.tx != NULL ? uint32_t(state.tx) : uint32_t(&spi_dma_dummy_tx),
+                         state.tx != NULL ? AddressIncrease : AddressFix,
+                         uint32_t(&spi->DR), AddressFix,
+                         length, Disable);
+
+    // arm rx before tx, so no received byte is missed
+    DMA_ChannelCmd(dma.register_base, dma.rx_channel, Enable);
+    DMA_ChannelCmd(dma.register_base, dma.tx_channel, Enable);
+
+    spi->CR1_f.SPE = 1;
+}
+
+/**
+ * @brief handle the completion of a DMA block
+ * @note called from the rx channel transfer complete interrupt
+ */
+static void spi_dma_block_complete(spi_config_t *config)
+{
+    spi_dma_config_t &dma = config->dma;
+    spi_state_t &state = config->state;
+
+    DMA_ClearIrqFlag(dma.register_base, dma.rx_channel, TrnCpltIrq);
+    DMA_ClearIrqFlag(dma.register_base, dma.rx_channel, BlkTrnCpltIrq);
+    DMA_ChannelCmd(dma.register_base, dma.rx_channel, Disable);
+    DMA_ChannelCmd(dma.register_base, dma.tx_channel, Disable);
+
+    // advance to the next block
+    state.remaining -= state.block_length;
+    if (state.tx != NULL)
+    {
+        state.tx += state.block_length;
+    }
+
+    if (state.rx != NULL)
+    {
+        state.rx += state.block_length;
+    }
+
+    if (state.remaining > 0)
+    {
+        spi_dma_start_block(config);
+        return;
+    }
+
+    // transfer completed. the callback may start the next transfer
+    state.block_length = 0;
+    state.busy = false;
+    if (state.callback != NULL)
+    {
+        state.callback(state.callback_param);
+    }
+}
+
+//
+// DMA interrupt handlers
+//
+static spi_config_t *SPIx[3] = {
+    &SPI1_config,
+    &SPI2_config,
+    &SPI3_config,
+};
+
+template <uint8_t x>
+static void SPIx_dma_complete_irq(void)
+{
+    spi_dma_block_complete(SPIx[x - 1]);
+}
+
+static const func_ptr_t SPIx_dma_complete_irqs[3] = {
+    SPIx_dma_complete_irq<1>,
+    SPIx_dma_complete_irq<2>,
+    SPIx_dma_complete_irq<3>,
+};
+
+/**
+ * @brief SPI register to SPI number
+ */
+#define SPIx_REG_TO_X(reg) \
+    reg == M4_SPI1   ? 1   \
+    : reg == M4_SPI2 ? 2   \
+    : reg == M4_SPI3 ? 3   \
+    : reg == M4_SPI4 ? 4   \
+                     : 0
+
+/**
+ * @brief initialize the DMA of a SPI peripheral
+ * @return true if the DMA channels could be claimed
+ */
+static bool spi_dma_init(spi_config_t *config)
+{
+    spi_dma_config_t &dma = config->dma;
+    const uint8_t x = SPIx_REG_TO_X(config->peripheral.register_base);
+    CORE_ASSERT(x >= 1 && x <= 3, "spi_dma_init: SPI unit does not support DMA", return false);
+
+    // the channels are assigned at compile time, claim them to detect conflicts with other users
+    const dma_channel_t tx_channel = {dma.register_base, dma.tx_channel};
+    const dma_channel_t rx_channel = {dma.register_base, dma.rx_channel};
+    CORE_ASSERT(dma_claim(tx_channel, "spi tx dma") == Ok, "spi_dma_init: TX DMA channel is in use", return false);
+    if (dma_claim(rx_channel, "spi rx dma") != Ok)
+    {
+        dma_channel_t channel = tx_channel;
+        dma_resign(channel, "spi tx dma");
+        CORE_ASSERT_FAIL("spi_dma_init: RX DMA channel is in use");
+        return false;
+    }
+
+    // enable DMA peripheral clock
+    PWC_Fcg0PeriphClockCmd(dma.clock_id, Enable);
+    DMA_Cmd(dma.register_base, Enable);
+    DMA_ChannelCmd(dma.register_base, dma.tx_channel, Disable);
+    DMA_ChannelCmd(dma.register_base, dma.rx_channel, Disable);
+
+    // AOS is required to trigger DMA transfer, enable AOS peripheral clock
+    PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+
+    // move a byte every time the SPI TX buffer is empty or the RX buffer is full
+    DMA_SetTriggerSrc(dma.register_base, dma.tx_channel, dma.tx_event_source);
+    DMA_SetTriggerSrc(dma.register_base, dma.rx_channel, dma.rx_event_source);
+
+    // auto-assign IRQn
+    IRQn_Type irqn;
+    irqn_aa_get(irqn, "spi dma");
+    dma.interrupt_number = irqn;
+
+    // register and enable the rx channel transfer complete interrupt
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = dma.interrupt_source,
+        .enIRQn = dma.interrupt_number,
+        .pfnCallback = SPIx_dma_complete_irqs[x - 1],
+    };
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, dma.interrupt_priority);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+    return true;
+}
+
+/**
+ * @brief deinitialize the DMA of a SPI peripheral
+ */
+static void spi_dma_deinit(spi_config_t *config)
+{
+    spi_dma_config_t &dma = config->dma;
+
+    // disable interrupt and clear pending
+    NVIC_DisableIRQ(dma.interrupt_number);
+    NVIC_ClearPendingIRQ(dma.interrupt_number);
+    enIrqResign(dma.interrupt_number);
+
+    // resign auto-assigned irqn
+    irqn_aa_resign(dma.interrupt_number, "spi dma");
+
+    // stop and release the channels
+    dma_channel_t tx_channel = {dma.register_base, dma.tx_channel};
+    dma_channel_t rx_channel = {dma.register_base, dma.rx_channel};
+    dma_resign(tx_channel, "spi tx dma");
+    dma_resign(rx_channel, "spi rx dma");
+}
+
+//
+// SPIClass
+//
+
+SPIClass::SPIClass(spi_config_t *config, gpio_pin_t mosi_pin, gpio_pin_t miso_pin, gpio_pin_t sck_pin)
+{
+    CORE_ASSERT(config != NULL, "SPIClass: config is NULL");
+    this->config = config;
+    this->mosi_pin = mosi_pin;
+    this->miso_pin = miso_pin;
+    this->sck_pin = sck_pin;
+    this->cfg2 = 0;
+    this->clock = 0;
+    this->async_callback = NULL;
+    this->async_callback_param = NULL;
+    this->queue_active = NULL;
+    this->queue_head = NULL;
+    this->queue_tail = NULL;
+}
+
+void SPIClass::begin()
+{
+    M4_SPI_TypeDef *spi = this->config->peripheral.register_base;
+
+    // enable SPI peripheral clock
+    PWC_Fcg1PeriphClockCmd(this->config->peripheral.clock_id, Enable);
+
+    // initialize as master in 3-wire full duplex mode, with 8 bit frames.
+    // mode, bit order and clock divider are written as precomputed CFG2 bits below
+    stc_spi_init_t spi_config;
+    MEM_ZERO_STRUCT(spi_config);
+    spi_config.enClkDiv = SpiClkDiv2;
+    spi_config.enFrameNumber = SpiFrameNumber1;
+    spi_config.enDataLength = SpiDataLengthBit8;
+    spi_config.enFirstBitPosition = SpiFirstBitPositionMSB;
+    spi_config.enSckPolarity = SpiSckIdleLevelLow;
+    spi_config.enSckPhase = SpiSckOddSampleEvenChange;
+    spi_config.enReadBufferObject = SpiReadReceiverBuffer;
+    spi_config.enWorkMode = SpiWorkMode3Line;
+    spi_config.enTransMode = SpiTransFullDuplex;
+    spi_config.enMasterSlaveMode = SpiModeMaster;
+    spi_config.enCommAutoSuspendEn = Disable;
+    spi_config.enModeFaultErrorDetectEn = Disable;
+    spi_config.enParitySelfDetectEn = Disable;
+    spi_config.enParityEn = Disable;
+    SPI_Init(spi, &spi_config);
+
+    // default settings depend on PCLK1, so they are only computed once the clocks are set up
+    const SPISettings defaults;
+    this->cfg2 = defaults.cfg2;
+    this->clock = defaults.clock;
+    spi->CFG2 = (spi->CFG2 & ~SPI_CFG2_SETTINGS_MASK) | this->cfg2;
+
+    // set pin functions
+    GPIO_SetFunc(this->mosi_pin, this->config->peripheral.mosi_function);
+    GPIO_SetFunc(this->miso_pin, this->config->peripheral.miso_function);
+    GPIO_SetFunc(this->sck_pin, this->config->peripheral.sck_function);
+
+    this->config->state.busy = false;
+    if (SPI_DMA_ENABLED(this->config) && !spi_dma_init(this->config))
+    {
+        return;
+    }
+
+    SPI_Cmd(spi, Enable);
+    sysclock_listener_register(&this->clockListener, SPIClass::clockChanged, this);
+}
+
+void SPIClass::end()
+{
+    waitForTransfer();
+    sysclock_listener_unregister(&this->clockListener);
+    if (SPI_DMA_ENABLED(this->config))
+    {
+        spi_dma_deinit(this->config);
+    }
+
+    SPI_Cmd(this->config->peripheral.register_base, Disable);
+    SPI_DeInit(this->config->peripheral.register_base);
+
+    // return pins to GPIO function
+    GPIO_SetFunc(this->mosi_pin, Func_Gpio);
+    GPIO_SetFunc(this->miso_pin, Func_Gpio);
+    GPIO_SetFunc(this->sck_pin, Func_Gpio);
+
+    PWC_Fcg1PeriphClockCmd(this->config->peripheral.clock_id, Disable);
+}
+
+void SPIClass::apply_cfg2(const uint32_t cfg2)
+{
+    if (cfg2 == this->cfg2)
+    {
+        return;
+    }
+
+    // CFG2 may only be changed while the peripheral is disabled
+    M4_SPI_TypeDef *spi = this->config->peripheral.register_base;
+    spi->CR1_f.SPE = 0;
+    spi->CFG2 = (spi->CFG2 & ~SPI_CFG2_SETTINGS_MASK) | cfg2;
+    spi->CR1_f.SPE = 1;
+    this->cfg2 = cfg2;
+}
+
+void SPIClass::apply_settings(const SPISettings &settings)
+{
+    apply_cfg2(settings.get_cfg2());
+    this->clock = settings.clock;
+}
+
+void SPIClass::clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)previous;
+    SPIClass *spi = static_cast<SPIClass *>(param);
+    if (phase == SYSCLOCK_CHANGE_PRE)
+    {
+        // let the running transfer complete at the old clock
+        spi->waitForTransfer();
+        return;
+    }
+
+    // re-derive the divider from the new PCLK1. a divider set with setClockDivider() is kept
+    if (spi->clock != 0)
+    {
+        const uint32_t mbr = SPISettings::get_divider(SPI_BASE_FREQUENCY, spi->clock);
+        spi->apply_cfg2((spi->cfg2 & ~SPI_CFG2_MBR_MASK) | (mbr << SPI_CFG2_MBR_POS));
+    }
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+    waitForTransfer();
+    apply_settings(settings);
+}
+
+void SPIClass::endTransaction(void)
+{
+}
+
+void SPIClass::usingInterrupt(int interruptNumber)
+{
+    // transactions do not mask interrupts
+    (void)interruptNumber;
+}
+
+void SPIClass::notUsingInterrupt(int interruptNumber)
+{
+    (void)interruptNumber;
+}
+
+void SPIClass::attachInterrupt()
+{
+    // slave mode is not supported
+}
+
+void SPIClass::detachInterrupt()
+{
+}
+
+void SPIClass::setBitOrder(BitOrder order)
+{
+    apply_cfg2((this->cfg2 & ~SPI_CFG2_LSBF_MASK) | (uint32_t(order == LSBFIRST ? 1 : 0) << SPI_CFG2_LSBF_POS));
+}
+
+void SPIClass::setDataMode(uint8_t mode)
+{
+    apply_cfg2((this->cfg2 & ~SPI_CFG2_MODE_MASK) | (uint32_t(mode & 0x3) << SPI_CFG2_CPHA_POS));
+}
+
+void SPIClass::setClockDivider(uint8_t div)
+{
+    CORE_ASSERT(div <= SPI_CLOCK_DIV256, "SPIClass::setClockDivider: invalid divider", return);
+    apply_cfg2((this->cfg2 & ~SPI_CFG2_MBR_MASK) | (uint32_t(div) << SPI_CFG2_MBR_POS));
+    this->clock = 0;
+}
+
+byte SPIClass::transfer(uint8_t data)
+{
+    M4_SPI_TypeDef *spi = this->config->peripheral.register_base;
+    spi->DR = data;
+    while (!spi->SR_f.RDFF)
+        ;
+
+    return uint8_t(spi->DR);
+}
+
+uint16_t SPIClass::transfer16(uint16_t data)
+{
+    if (this->cfg2 & SPI_CFG2_LSBF_MASK)
+    {
+        const uint8_t lo = transfer(uint8_t(data));
+        const uint8_t hi = transfer(uint8_t(data >> 8));
+        return uint16_t(hi << 8) | lo;
+    }
+
+    const uint8_t hi = transfer(uint8_t(data >> 8));
+    const uint8_t lo = transfer(uint8_t(data));
+    return uint16_t(hi << 8) | lo;
+}
+
+void SPIClass::transfer_polled(const uint8_t *tx, uint8_t *rx, size_t count)
+{
+    M4_SPI_TypeDef *spi = this->config->peripheral.register_base;
+    while (count--)
+    {
+        spi->DR = tx != NULL ? *tx++ : 0xFF;
+        while (!spi->SR_f.RDFF)
+            ;
+
+        const uint8_t data = uint8_t(spi->DR);
+        if (rx != NULL)
+        {
+            *rx++ = data;
+        }
+    }
+}
+
+void SPIClass::transfer(const void *tx_buf, void *rx_buf, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (SPI_DMA_ENABLED(this->config) && count >= SPI_DMA_MIN_TRANSFER_LENGTH)
+    {
+        waitForTransfer();
+        transferAsync(tx_buf, rx_buf, count);
+        waitForTransfer();
+        return;
+    }
+
+    transfer_polled(static_cast<const uint8_t *>(tx_buf), static_cast<uint8_t *>(rx_buf), count);
+}
+
+bool SPIClass::transferAsync(const void *tx_buf, void *rx_buf, size_t count, spi_transfer_callback_t callback, void *callback_param)
+{
+    // without DMA, transfer right away
+    if (!SPI_DMA_ENABLED(this->config) || count == 0)
+    {
+        transfer_polled(static_cast<const uint8_t *>(tx_buf), static_cast<uint8_t *>(rx_buf), count);
+        if (callback != NULL)
+        {
+            callback(callback_param);
+        }
+
+        return true;
+    }
+
+    if (!claim())
+    {
+        return false;
+    }
+
+    this->async_callback = callback;
+    this->async_callback_param = callback_param;
+    start_dma(tx_buf, rx_buf, count);
+    return true;
+}
+
+bool SPIClass::claim()
+{
+    // the callback of the previous transfer may start a transfer from the DMA interrupt
+    const uint32_t critical = core_critical_enter();
+    if (this->config->state.busy)
+    {
+        core_critical_exit(critical);
+        return false;
+    }
+
+    this->config->state.busy = true;
+    core_critical_exit(critical);
+    return true;
+}
+
+void SPIClass::start_dma(const void *tx_buf, void *rx_buf, size_t count)
+{
+    spi_state_t &state = this->config->state;
+    state.tx = static_cast<const uint8_t *>(tx_buf);
+    state.rx = static_cast<uint8_t *>(rx_buf);
+    state.remaining = count;
+    state.callback = queue_transfer_complete;
+    state.callback_param = this;
+    spi_dma_start_block(this->config);
+}
+
+//
+// transaction queue
+//
+
+bool SPIClass::queue(SPITransaction *transaction)
+{
+    CORE_ASSERT(transaction != NULL, "SPIClass::queue: transaction is NULL", return false);
+    CORE_ASSERT(transaction->count > 0, "SPIClass::queue: transaction is empty", return false);
+
+    // without DMA, run the transaction right away
+    if (!SPI_DMA_ENABLED(this->config))
+    {
+        if (transaction->queued)
+        {
+            return false;
+        }
+
+        transaction->queued = true;
+        apply_settings(transaction->settings);
+        if (transaction->cs_pin != SPI_TRANSACTION_NO_CS)
+        {
+            GPIO_ResetBits(transaction->cs_pin);
+        }
+
+        transfer_polled(static_cast<const uint8_t *>(transaction->tx_buf), static_cast<uint8_t *>(transaction->rx_buf), transaction->count);
+        if (transaction->cs_pin != SPI_TRANSACTION_NO_CS)
+        {
+            GPIO_SetBits(transaction->cs_pin);
+        }
+
+        transaction->queued = false;
+        if (transaction->callback != NULL)
+        {
+            transaction->callback(transaction->callback_param);
+        }
+
+        return true;
+    }
+
+    const uint32_t critical = core_critical_enter();
+    if (transaction->queued)
+    {
+        core_critical_exit(critical);
+        return false;
+    }
+
+    // append to the queue
+    transaction->queued = true;
+    transaction->next = NULL;
+    if (this->queue_tail == NULL)
+    {
+        this->queue_head = transaction;
+    }
+    else
+    {
+        this->queue_tail->next = transaction;
+    }
+
+    this->queue_tail = transaction;
+
+    // kick off the queue if the bus is idle.
+    // otherwise, the completion of the running transfer starts it
+    if (this->queue_active == NULL)
+    {
+        queue_start_next();
+    }
+
+    core_critical_exit(critical);
+    return true;
+}
+
+void SPIClass::queue_start_next()
+{
+    SPITransaction *transaction = this->queue_head;
+    if (transaction == NULL || !claim())
+    {
+        return;
+    }
+
+    this->queue_head = transaction->next;
+    if (this->queue_head == NULL)
+    {
+        this->queue_tail = NULL;
+    }
+
+    this->queue_active = transaction;
+    apply_settings(transaction->settings);
+    if (transaction->cs_pin != SPI_TRANSACTION_NO_CS)
+    {
+        GPIO_ResetBits(transaction->cs_pin);
+    }
+
+    start_dma(transaction->tx_buf, transaction->rx_buf, transaction->count);
+}
+
+void SPIClass::queue_transfer_complete(void *param)
+{
+    SPIClass *spi = static_cast<SPIClass *>(param);
+
+    SPITransaction *transaction = spi->queue_active;
+    if (transaction != NULL)
+    {
+        // queued transaction completed, release chip select
+        spi->queue_active = NULL;
+        if (transaction->cs_pin != SPI_TRANSACTION_NO_CS)
+        {
+            GPIO_SetBits(transaction->cs_pin);
+        }
+
+        transaction->queued = false;
+        if (transaction->callback != NULL)
+        {
+            transaction->callback(transaction->callback_param);
+        }
+    }
+    else if (spi->async_callback != NULL)
+    {
+        // transferAsync() completed
+        spi->async_callback(spi->async_callback_param);
+    }
+
+    // the callback may have started a transfer itself, or queued one
+    if (spi->queue_active == NULL)
+    {
+        spi->queue_start_next();
+    }
+}
+
+void SPIClass::waitForTransfer()
+{
+    while (this->config->state.busy)
+        ;
+}
+
+//
+// default instance
+//
+#if defined(VARIANT_SPI1_MOSI_PIN) && defined(VARIANT_SPI1_MISO_PIN) && defined(VARIANT_SPI1_SCK_PIN)
+SPIClass SPI(&SPI1_config, VARIANT_SPI1_MOSI_PIN, VARIANT_SPI1_MISO_PIN, VARIANT_SPI1_SCK_PIN);
+#endif
@@ -19,9 +19,20 @@
 #ifndef SPI_H_
 #define SPI_H_
 
-#error "SPI library is not yet supported on the HC32F460"
+// check DDL configuration
+#if (DDL_SPI_ENABLE != DDL_ON)
+#error "SPI library requires SPI DDL to be enabled"
+#endif
+
+#if (DDL_PWC_ENABLE != DDL_ON)
+#error "SPI library requires PWC DDL to be enabled"
+#endif
 
 #include "Arduino.h"
+#include <core_debug.h>
+#include <hc32_ddl.h>
+#include <drivers/sysclock/sysclock_switch.h>
+#include "spi_config.h"
 
 // SPI_HAS_TRANSACTION means SPI has
 //   - beginTransaction()
@@ -30,10 +41,47 @@
 //   - SPISetting(clock, bitOrder, dataMode)
 #define SPI_HAS_TRANSACTION 1
 
-#define SPI_MODE0 0x02
-#define SPI_MODE1 0x00
-#define SPI_MODE2 0x03
-#define SPI_MODE3 0x01
+// data modes, bit 0 is CPHA and bit 1 is CPOL, matching their position in SPIx->CFG2
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+// clock dividers for setClockDivider(), as value of SPIx->CFG2.MBR
+#define SPI_CLOCK_DIV2 0x00
+#define SPI_CLOCK_DIV4 0x01
+#define SPI_CLOCK_DIV8 0x02
+#define SPI_CLOCK_DIV16 0x03
+#define SPI_CLOCK_DIV32 0x04
+#define SPI_CLOCK_DIV64 0x05
+#define SPI_CLOCK_DIV128 0x06
+#define SPI_CLOCK_DIV256 0x07
+
+/**
+ * @brief SPI base frequency
+ * @note SPI uses PCLK1 as base frequency
+ */
+#define SPI_BASE_FREQUENCY (SYSTEM_CLOCK_FREQUENCIES.pclk1)
+
+/**
+ * @brief minimum length of a transfer to use DMA for
+ * @note shorter transfers are polled, since setting up the DMA takes longer than sending a few bytes
+ */
+#ifndef SPI_DMA_MIN_TRANSFER_LENGTH
+#define SPI_DMA_MIN_TRANSFER_LENGTH 8
+#endif
+
+//
+// SPIx->CFG2 fields controlled by SPISettings
+//
+#define SPI_CFG2_CPHA_POS 0
+#define SPI_CFG2_CPOL_POS 1
+#define SPI_CFG2_MBR_POS 2
+#define SPI_CFG2_LSBF_POS 12
+#define SPI_CFG2_MODE_MASK (0x3ul << SPI_CFG2_CPHA_POS)
+#define SPI_CFG2_MBR_MASK (0x7ul << SPI_CFG2_MBR_POS)
+#define SPI_CFG2_LSBF_MASK (0x1ul << SPI_CFG2_LSBF_POS)
+#define SPI_CFG2_SETTINGS_MASK (SPI_CFG2_MODE_MASK | SPI_CFG2_MBR_MASK | SPI_CFG2_LSBF_MASK)
 
 class SPISettings
 {
@@ -50,32 +98,230 @@ public:
 	}
 
 private:
+	/**
+	 * @brief precompute the SPIx->CFG2 bits for the settings
+	 * @note the clock divider is the smallest one that does not exceed the requested clock.
+	 *       keep the settings object around to only do this once. if PCLK1 changes later, the divider is
+	 *       re-computed when the settings are applied
+	 */
 	void init_AlwaysInline(uint32_t clock, BitOrder bitOrder, uint8_t dataMode) __attribute__((__always_inline__))
 	{
-		this->clockFreq = clock;
-		this->bitOrder = bitOrder;
-		this->dataMode = dataMode;
+		this->clock = clock;
+		this->base = SPI_BASE_FREQUENCY;
+		this->cfg2 = (uint32_t(dataMode & 0x3) << SPI_CFG2_CPHA_POS) |
+					 (get_divider(this->base, clock) << SPI_CFG2_MBR_POS) |
+					 (uint32_t(bitOrder == LSBFIRST ? 1 : 0) << SPI_CFG2_LSBF_POS);
+	}
+
+	/**
+	 * @brief get the smallest clock divider (as SPIx->CFG2.MBR) that does not exceed the requested clock
+	 * @param base the SPI base frequency
+	 * @param clock the requested clock
+	 */
+	static uint32_t get_divider(const uint32_t base, const uint32_t clock) __attribute__((__always_inline__))
+	{
+		uint32_t mbr = 0;
+		while (mbr < SPI_CLOCK_DIV256 && (base >> (mbr + 1)) > clock)
+		{
+			mbr++;
+		}
+
+		return mbr;
+	}
+
+	/**
+	 * @brief get the SPIx->CFG2 bits of the settings for the current SPI base frequency
+	 * @note the divider is only re-computed if the base frequency changed since the settings were created
+	 */
+	uint32_t get_cfg2() const
+	{
+		const uint32_t current_base = SPI_BASE_FREQUENCY;
+		if (current_base == this->base)
+		{
+			return this->cfg2;
+		}
+
+		return (this->cfg2 & ~SPI_CFG2_MBR_MASK) | (get_divider(current_base, this->clock) << SPI_CFG2_MBR_POS);
 	}
 
-	uint32_t clockFreq;
-	uint8_t dataMode;
-	uint32_t bitOrder;
+	/**
+	 * @brief SPIx->CFG2 bits of the settings
+	 * @note only the bits in SPI_CFG2_SETTINGS_MASK are set
+	 */
+	uint32_t cfg2;
+
+	/**
+	 * @brief the requested clock, and the SPI base frequency cfg2 was computed for
+	 */
+	uint32_t clock;
+	uint32_t base;
 
 	friend class SPIClass;
 };
 
+/**
+ * @brief chip select pin value for transactions without chip select
+ */
+#define SPI_TRANSACTION_NO_CS BOARD_NR_GPIO_PINS
+
+/**
+ * @brief a transaction in the queue of a SPIClass
+ * @note allocated by the caller, and must stay valid until the transaction completed.
+ *       the fields may only be changed while the transaction is not queued
+ */
+struct SPITransaction
+{
+	/**
+	 * @brief chip select pin, driven LOW for the duration of the transaction
+	 * @note must be configured as OUTPUT by the caller. SPI_TRANSACTION_NO_CS if not used
+	 */
+	gpio_pin_t cs_pin;
+
+	/**
+	 * @brief bus settings of the transaction
+	 */
+	SPISettings settings;
+
+	/**
+	 * @brief the data to send. NULL to send 0xFF
+	 */
+	const void *tx_buf;
+
+	/**
+	 * @brief the buffer to receive into. NULL to discard the received data
+	 */
+	void *rx_buf;
+
+	/**
+	 * @brief number of bytes to transfer
+	 */
+	size_t count;
+
+	/**
+	 * @brief called after the transaction completed and chip select was released. may be NULL
+	 * @note called from the DMA interrupt. may queue the next transaction, including this one
+	 */
+	spi_transfer_callback_t callback;
+
+	/**
+	 * @brief param for the callback
+	 */
+	void *callback_param;
+
+	/**
+	 * @brief next transaction in the queue
+	 * @note managed by SPIClass
+	 */
+	SPITransaction *next;
+
+	/**
+	 * @brief is the transaction queued or running?
+	 * @note managed by SPIClass
+	 */
+	volatile bool queued;
+};
+
 class SPIClass
 {
 public:
-	// Parameters passed to the constructor are typically used for assigning the pins etc.
-	SPIClass();
+	/**
+	 * @brief Construct a new SPIClass object
+	 * @param config pointer to SPI peripheral configuration
+	 * @param mosi_pin pin to use for MOSI
+	 * @param miso_pin pin to use for MISO
+	 * @param sck_pin pin to use for SCK
+	 * @note the chip select pin is not managed by the SPI library, drive it with digitalWrite()
+	 */
+	SPIClass(spi_config_t *config, gpio_pin_t mosi_pin, gpio_pin_t miso_pin, gpio_pin_t sck_pin);
 
+	/**
+	 * @brief transfer a single byte
+	 * @param data the byte to send
+	 * @return the byte received
+	 * @note must not be called while an asynchronous transfer is running
+	 */
 	byte transfer(uint8_t data);
+
+	/**
+	 * @brief transfer 16 bits, in the currently set bit order
+	 * @param data the word to send
+	 * @return the word received
+	 */
 	uint16_t transfer16(uint16_t data);
-	inline void transfer(void *buf, size_t count);
+
+	/**
+	 * @brief transfer a buffer in-place
+	 * @param buf the data to send. overwritten with the data received
+	 * @param count number of bytes to transfer
+	 */
+	inline void transfer(void *buf, size_t count)
+	{
+		transfer(buf, buf, count);
+	}
+
+	/**
+	 * @brief transfer a buffer, blocking until done
+	 * @param tx_buf the data to send. NULL to send 0xFF
+	 * @param rx_buf the buffer to receive into. NULL to discard the received data. may be the same as tx_buf
+	 * @param count number of bytes to transfer
+	 * @note uses DMA if enabled for the peripheral and count >= SPI_DMA_MIN_TRANSFER_LENGTH
+	 */
+	void transfer(const void *tx_buf, void *rx_buf, size_t count);
+
+	/**
+	 * @brief start a buffer transfer in the background
+	 * @param tx_buf the data to send. NULL to send 0xFF. must stay valid until the transfer completed
+	 * @param rx_buf the buffer to receive into. NULL to discard the received data. must stay valid until the transfer completed
+	 * @param count number of bytes to transfer
+	 * @param callback called when the transfer completed. may be NULL
+	 * @param callback_param param for the callback
+	 * @return true if the transfer was started, false if a transfer is already running
+	 * @note the callback is called from the DMA interrupt, and may start the next transfer.
+	 *       without DMA, the transfer is done before this function returns, and the callback is called from here
+	 */
+	bool transferAsync(const void *tx_buf, void *rx_buf, size_t count, spi_transfer_callback_t callback = NULL, void *callback_param = NULL);
+
+	/**
+	 * @brief is an asynchronous transfer running?
+	 */
+	inline bool isBusy()
+	{
+		return this->config->state.busy;
+	}
+
+	/**
+	 * @brief wait until the running asynchronous transfer completed
+	 * @note also waits for all queued transactions
+	 */
+	void waitForTransfer();
+
+	/**
+	 * @brief queue a transaction to run in the background
+	 * @param transaction the transaction. must not be queued already
+	 * @return true if the transaction was queued, false if it is already queued
+	 * @note transactions run in queue order, each with its own settings and chip select.
+	 *       the next transaction is started from the DMA interrupt of the previous one, so the bus stays busy
+	 *       without involving the main loop. without DMA, the transactions run before this function returns
+	 * @note do not call the blocking transfer functions while transactions are queued, call waitForTransfer() first
+	 */
+	bool queue(SPITransaction *transaction);
+
+	/**
+	 * @brief check if a transaction is queued or running
+	 */
+	inline bool isQueued(const SPITransaction *transaction)
+	{
+		return transaction->queued;
+	}
 
 	// Transaction Functions
 	void usingInterrupt(int interruptNumber);
+	void notUsingInterrupt(int interruptNumber);
+
+	/**
+	 * @brief apply the settings for a transaction
+	 * @note if the settings changed since the last transaction, this is a write to SPIx->CFG2 while the peripheral is briefly disabled
+	 */
 	void beginTransaction(SPISettings settings);
 	void endTransaction(void);
 
@@ -87,20 +333,93 @@ public:
 	void end();
 
 	void setBitOrder(BitOrder order);
-	void setDataMode(unsigned char mode);
-	void setClockDivider(unsigned char div);
-};
+	void setDataMode(uint8_t mode);
+	void setClockDivider(uint8_t div);
 
-void SPIClass::transfer(void *buf, size_t count)
-{
-	uint8_t *buffer = reinterpret_cast<uint8_t *>(buf);
-	for (size_t i = 0; i < count; i++)
-	{
-		*buffer = transfer(*buffer);
-		buffer++;
-	}
-}
+private:
+	spi_config_t *config;
+	gpio_pin_t mosi_pin;
+	gpio_pin_t miso_pin;
+	gpio_pin_t sck_pin;
+
+	/**
+	 * @brief currently applied SPIx->CFG2 settings bits
+	 */
+	uint32_t cfg2;
+
+	/**
+	 * @brief requested clock of the applied settings, re-applied on clock changes
+	 * @note 0 if the divider was set directly with setClockDivider()
+	 */
+	uint32_t clock;
+
+	/**
+	 * @brief apply new SPIx->CFG2 settings bits
+	 */
+	void apply_cfg2(const uint32_t cfg2);
+
+	/**
+	 * @brief apply the settings of a transaction
+	 */
+	void apply_settings(const SPISettings &settings);
+
+	/**
+	 * @brief clock change listener, registered while begun
+	 */
+	sysclock_listener_t clockListener = {};
+
+	/**
+	 * @brief clock change listener callback, re-derives the clock divider from the new PCLK1
+	 * @param param the SPIClass
+	 */
+	static void clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param);
+
+	/**
+	 * @brief polled transfer of a buffer
+	 */
+	void transfer_polled(const uint8_t *tx, uint8_t *rx, size_t count);
+
+	/**
+	 * @brief completion callback of the running transferAsync()
+	 */
+	spi_transfer_callback_t async_callback;
+	void *async_callback_param;
+
+	/**
+	 * @brief claim the peripheral for a DMA transfer
+	 * @return false if a transfer is already running
+	 */
+	bool claim();
+
+	/**
+	 * @brief start a DMA transfer on the claimed peripheral
+	 */
+	void start_dma(const void *tx_buf, void *rx_buf, size_t count);
+
+	/**
+	 * @brief transaction queue
+	 * @note queue_active is the running transaction, queue_head the next one
+	 */
+	SPITransaction *queue_active;
+	SPITransaction *queue_head;
+	SPITransaction *queue_tail;
+
+	/**
+	 * @brief start the next queued transaction, if any
+	 * @note must be called with interrupts masked, or from the DMA interrupt
+	 */
+	void queue_start_next();
+
+	/**
+	 * @brief completion callback of all DMA transfers
+	 * @param param the SPIClass
+	 * @note completes the running transaction or transferAsync(), then starts the next queued transaction
+	 */
+	static void queue_transfer_complete(void *param);
+};
 
+#if defined(VARIANT_SPI1_MOSI_PIN) && defined(VARIANT_SPI1_MISO_PIN) && defined(VARIANT_SPI1_SCK_PIN)
 extern SPIClass SPI;
+#endif
 
 #endif /* SPI_H_ */
@@ -0,0 +1,101 @@
+#include "spi_config.h"
+#include <drivers/irqn/irq_priority.h>
+
+//
+// DMA channel assignment checks
+// (see usart_config.cpp and adc_config.cpp for the channels used by the core)
+//
+#ifdef SPI1_DMA
+#if defined(USART2_RX_DMA) || defined(USART3_RX_DMA)
+#error "SPI1_DMA uses DMA1 channel 2 and 3, and cannot be used with USART2_RX_DMA or USART3_RX_DMA"
+#endif
+#endif
+
+#ifdef SPI2_DMA
+#if defined(USART1_TX_DMA) || defined(USART2_TX_DMA)
+#error "SPI2_DMA uses DMA2 channel 0 and 1, and cannot be used with USART1_TX_DMA or USART2_TX_DMA"
+#endif
+#endif
+
+#ifdef SPI3_DMA
+#if defined(USART3_TX_DMA) || defined(USART4_TX_DMA) || defined(CORE_ADC_BALANCE_CHANNELS)
+#error "SPI3_DMA uses DMA2 channel 2 and 3, and cannot be used with USART3_TX_DMA, USART4_TX_DMA or CORE_ADC_BALANCE_CHANNELS"
+#endif
+#endif
+
+#ifdef SPI4_DMA
+#error "SPI4_DMA is not supported, all remaining DMA channels are in use"
+#endif
+
+//
+// SPI configuration helpers
+//
+#define SPI_PERIPHERAL_CONFIG(x)                  \
+    {                                             \
+        .register_base = M4_SPI##x,               \
+        .clock_id = PWC_FCG1_PERIPH_SPI##x,       \
+        .mosi_function = Func_Spi##x##_Mosi,      \
+        .miso_function = Func_Spi##x##_Miso,      \
+        .sck_function = Func_Spi##x##_Sck,        \
+    }
+
+#define SPI_DMA_CONFIG(x, dma, tx_ch, rx_ch)            \
+    {                                                   \
+        .register_base = M4_DMA##dma,                   \
+        .clock_id = PWC_FCG0_PERIPH_DMA##dma,           \
+        .tx_channel = DmaCh##tx_ch,                     \
+        .rx_channel = DmaCh##rx_ch,                     \
+        .tx_event_source = EVT_SPI##x##_SPTI,           \
+        .rx_event_source = EVT_SPI##x##_SPRI,           \
+        .interrupt_source = INT_DMA##dma##_TC##rx_ch,   \
+        .interrupt_priority = IRQ_PRIORITY_SPI,       \
+    }
+
+#define SPI_DMA_DISABLED      \
+    {                         \
+        .register_base = NULL \
+    }
+
+//
+// SPI1 config
+//
+spi_config_t SPI1_config = {
+    .peripheral = SPI_PERIPHERAL_CONFIG(1),
+#ifdef SPI1_DMA
+    .dma = SPI_DMA_CONFIG(1, 1, 2, 3),
+#else
+    .dma = SPI_DMA_DISABLED,
+#endif
+};
+
+//
+// SPI2 config
+//
+spi_config_t SPI2_config = {
+    .peripheral = SPI_PERIPHERAL_CONFIG(2),
+#ifdef SPI2_DMA
+    .dma = SPI_DMA_CONFIG(2, 2, 0, 1),
+#else
+    .dma = SPI_DMA_DISABLED,
+#endif
+};
+
+//
+// SPI3 config
+//
+spi_config_t SPI3_config = {
+    .peripheral = SPI_PERIPHERAL_CONFIG(3),
+#ifdef SPI3_DMA
+    .dma = SPI_DMA_CONFIG(3, 2, 2, 3),
+#else
+    .dma = SPI_DMA_DISABLED,
+#endif
+};
+
+//
+// SPI4 config
+//
+spi_config_t SPI4_config = {
+    .peripheral = SPI_PERIPHERAL_CONFIG(4),
+    .dma = SPI_DMA_DISABLED,
+};
@@ -0,0 +1,193 @@
+#pragma once
+#include <hc32_ddl.h>
+#include <stddef.h>
+
+/**
+ * @brief SPI peripheral config
+ */
+typedef struct spi_peripheral_config_t
+{
+    /**
+     * @brief The base address of the SPI peripheral.
+     */
+    M4_SPI_TypeDef *register_base;
+
+    /**
+     * @brief The clock id of the SPI peripheral.
+     * @note in FCG1
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief pin function for the MOSI pin
+     */
+    en_port_func_t mosi_function;
+
+    /**
+     * @brief pin function for the MISO pin
+     */
+    en_port_func_t miso_function;
+
+    /**
+     * @brief pin function for the SCK pin
+     */
+    en_port_func_t sck_function;
+} spi_peripheral_config_t;
+
+/**
+ * @brief SPI DMA config
+ * @note a transfer uses two channels of the same DMA unit, one for each direction
+ */
+typedef struct spi_dma_config_t
+{
+    /**
+     * @brief DMA peripheral register base address
+     * @note set to NULL to disable DMA
+     */
+    M4_DMA_TypeDef *register_base;
+
+    /**
+     * @brief DMA peripheral clock id
+     * @note in FCG0
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief DMA channel writing to SPIx->DR
+     */
+    en_dma_channel_t tx_channel;
+
+    /**
+     * @brief DMA channel reading from SPIx->DR
+     */
+    en_dma_channel_t rx_channel;
+
+    /**
+     * @brief DMA trigger event source for the tx channel
+     * @note EVT_SPIx_SPTI
+     */
+    en_event_src_t tx_event_source;
+
+    /**
+     * @brief DMA trigger event source for the rx channel
+     * @note EVT_SPIx_SPRI
+     */
+    en_event_src_t rx_event_source;
+
+    /**
+     * @brief IRQn assigned to the rx channel transfer complete interrupt
+     * @note auto-assigned in lib implementation
+     */
+    IRQn_Type interrupt_number;
+
+    /**
+     * @brief interrupt source of the rx channel transfer complete interrupt
+     * @note INT_DMAx_TCy
+     */
+    en_int_src_t interrupt_source;
+
+    /**
+     * @brief priority of the transfer complete interrupt
+     */
+    uint32_t interrupt_priority;
+} spi_dma_config_t;
+
+/**
+ * @brief SPI transfer completion callback
+ * @param param the param given to SPIClass::transferAsync()
+ */
+typedef void (*spi_transfer_callback_t)(void *param);
+
+/**
+ * @brief SPI runtime state
+ */
+typedef struct spi_state_t
+{
+    /**
+     * @brief is a DMA transfer running?
+     */
+    volatile bool busy;
+
+    /**
+     * @brief next byte to transmit
+     * @note NULL to transmit 0xFF
+     */
+    const uint8_t *tx;
+
+    /**
+     * @brief next byte to receive into
+     * @note NULL to discard received data
+     */
+    uint8_t *rx;
+
+    /**
+     * @brief number of bytes left to transfer, including the running DMA block
+     */
+    size_t remaining;
+
+    /**
+     * @brief number of bytes in the running DMA block
+     */
+    uint16_t block_length;
+
+    /**
+     * @brief callback called when the transfer completed
+     */
+    spi_transfer_callback_t callback;
+
+    /**
+     * @brief param for the callback
+     */
+    void *callback_param;
+} spi_state_t;
+
+/**
+ * @brief SPI device config
+ */
+typedef struct spi_config_t
+{
+    /**
+     * @brief The peripheral config of the SPI.
+     */
+    spi_peripheral_config_t peripheral;
+
+    /**
+     * @brief DMA config of the SPI.
+     * @note DMA is disabled if register_base is NULL
+     */
+    spi_dma_config_t dma;
+
+    /**
+     * @brief SPI runtime state
+     */
+    spi_state_t state;
+} spi_config_t;
+
+/**
+ * @brief is DMA enabled for a SPI config?
+ */
+#define SPI_DMA_ENABLED(config) ((config)->dma.register_base != NULL)
+
+/**
+ * @brief SPI1 configuration
+ * @note DMA with SPI1_DMA
+ */
+extern spi_config_t SPI1_config;
+
+/**
+ * @brief SPI2 configuration
+ * @note DMA with SPI2_DMA
+ */
+extern spi_config_t SPI2_config;
+
+/**
+ * @brief SPI3 configuration
+ * @note DMA with SPI3_DMA
+ */
+extern spi_config_t SPI3_config;
+
+/**
+ * @brief SPI4 configuration
+ * @note DMA is not supported, all remaining DMA channels are in use
+ */
+extern spi_config_t SPI4_config;
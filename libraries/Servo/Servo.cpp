@@ -1,5 +1,53 @@
 #include "Servo.h"
 #include "drivers/timera/timera_pwm.h"
+#include "core_critical.h"
+
+//
+// servo table
+//
+
+/**
+ * @brief all attached servos, by index
+ */
+static Servo *servos[SERVO_MAX_SERVOS] = {};
+
+/**
+ * @brief nesting depth of beginBatch()
+ */
+static uint8_t batch_depth = 0;
+
+/**
+ * @brief start the timer unit for servo output, or share it if it already runs at a usable frequency
+ */
+static bool servo_timer_start(timera_config_t *timera_unit)
+{
+    switch (timera_pwm_start(timera_unit, SERVO_PWM_FREQUENCY, SERVO_TIMER_DIVIDER, false))
+    {
+    case Ok:
+        return true;
+    case ErrorOperationInProgress:
+        // in use with another frequency, try to share it
+        break;
+    default:
+        return false;
+    }
+
+    if (timera_pwm_start(timera_unit, SERVO_PWM_FREQUENCY, SERVO_TIMER_DIVIDER, true) != Ok)
+    {
+        return false;
+    }
+
+    const uint32_t f_base = timera_get_base_clock() / timera_clk_div_to_n(timera_unit->state.base_init->enClkDiv);
+    const uint32_t period = timera_unit->state.pwm_period;
+    const uint32_t frequency = period > 0 ? f_base / period : 0;
+    if (frequency < SERVO_MIN_SHARED_FREQUENCY || frequency > SERVO_MAX_SHARED_FREQUENCY)
+    {
+        CORE_DEBUG_PRINTF("Servo: TimerA unit runs at %lu Hz, cannot share\n", frequency);
+        return false;
+    }
+
+    return true;
+}
 
 //
 // attach / detach
@@ -7,6 +55,11 @@
 
 Servo::Servo() {}
 
+Servo::~Servo()
+{
+    detach();
+}
+
 uint8_t Servo::attach(const gpio_pin_t gpio_pin, const int32_t min_angle, const int32_t max_angle)
 {
     ASSERT_GPIO_PIN_VALID(gpio_pin, "Servo::attach", return INVALID_SERVO);
@@ -47,10 +100,21 @@ uint8_t Servo::attach(timera_config_t *timera_unit,
         detach();
     }
 
-    // configure and start timer for PWM
-    // TODO: allow setting allow_use_incompatible_config here?
-    // -> servo should not care *too much* about frequency, as long as the period is correct
-    if (timera_pwm_start(timera_unit, SERVO_PWM_FREQUENCY, SERVO_TIMER_DIVIDER, false) != Ok)
+    // claim a slot in the servo table
+    uint8_t index = 0;
+    while (index < SERVO_MAX_SERVOS && servos[index] != nullptr)
+    {
+        index++;
+    }
+
+    if (index >= SERVO_MAX_SERVOS)
+    {
+        CORE_ASSERT_FAIL("Servo::attach: too many servos");
+        return INVALID_SERVO;
+    }
+
+    // configure and start timer for PWM, or share it with other servos
+    if (!servo_timer_start(timera_unit))
     {
         CORE_ASSERT_FAIL("Servo::attach: timera_pwm_start failed");
         return INVALID_SERVO;
@@ -64,12 +128,13 @@ uint8_t Servo::attach(timera_config_t *timera_unit,
     this->channel = timera_channel;
     this->min_angle = min_angle;
     this->max_angle = max_angle;
+    this->servo_index = index;
+    this->has_pending_compare = false;
+    servos[index] = this;
 
-    // set angle to 0° (this will start the output)
+    // set initial angle (this will start the output, or with the next commitBatch())
     write(SERVO_INITIAL_ANGLE);
-
-    // done, return (fake) channel number
-    return 1;
+    return index;
 }
 
 void Servo::detach()
@@ -93,6 +158,9 @@ void Servo::detach()
     }
 
     // set detached
+    servos[servo_index] = nullptr;
+    servo_index = INVALID_SERVO;
+    has_pending_compare = false;
     this->timer = nullptr;
     pin = INVALID_SERVO;
 }
@@ -113,8 +181,10 @@ void Servo::writeMicroseconds(servo_pulse_width_t pulse_width, bool force)
         pulse_width = constrain(pulse_width, SERVO_MIN_PULSE_WIDTH, SERVO_MAX_PULSE_WIDTH);
     }
 
-    // set pulse width
-    timera_pwm_set_period(timer, channel, pulse_width, TIMERA_PWM_UNIT_US);
+    // calculate compare value, constrained to the period
+    const uint64_t f_base = timera_get_base_clock() / timera_clk_div_to_n(timer->state.base_init->enClkDiv);
+    const uint64_t compare = TIMERA_PWM_CALC_CMP_FROM_PERIOD(f_base, uint64_t(pulse_width), uint64_t(TIMERA_PWM_UNIT_US));
+    setCompare(static_cast<uint16_t>(TIMERA_CONSTRAIN(compare, 0, uint64_t(timer->state.pwm_period))));
 }
 
 servo_pulse_width_t Servo::readMicroseconds()
@@ -124,6 +194,13 @@ servo_pulse_width_t Servo::readMicroseconds()
         return 0;
     }
 
+    // a value not yet committed is read back as written
+    if (has_pending_compare)
+    {
+        const uint64_t f_base = timera_get_base_clock() / timera_clk_div_to_n(timer->state.base_init->enClkDiv);
+        return TIMERA_PWM_CALC_PERIOD_FROM_CMP(f_base, uint64_t(pending_compare), uint64_t(TIMERA_PWM_UNIT_US));
+    }
+
     // get pulse width
     return timera_pwm_get_period(timer, channel, TIMERA_PWM_UNIT_US);
 }
@@ -138,7 +215,7 @@ void Servo::write(servo_angle_t angle)
 
     // convert to microseconds
     // SERVO_MIN_PULSE_WIDTH is 0°, SERVO_MAX_PULSE_WIDTH is 180°, everything in-between is linear
-    servo_pulse_width_t us = map(angle, 0, 180, SERVO_MIN_PULSE_WIDTH, SERVO_MAX_PULSE_WIDTH);
+    servo_pulse_width_t us = map<0, 180, SERVO_MIN_PULSE_WIDTH, SERVO_MAX_PULSE_WIDTH>(angle);
 
     // write microseconds
     writeMicroseconds(us);
@@ -151,5 +228,59 @@ servo_angle_t Servo::read()
 
     // convert to angle
     // SERVO_MIN_PULSE_WIDTH is 0°, SERVO_MAX_PULSE_WIDTH is 180°, everything in-between is linear
-    return map(us, SERVO_MIN_PULSE_WIDTH, SERVO_MAX_PULSE_WIDTH, 0, 180);
+    return map<SERVO_MIN_PULSE_WIDTH, SERVO_MAX_PULSE_WIDTH, 0, 180>(us);
+}
+
+//
+// batched updates
+//
+void Servo::setCompare(const uint16_t compare)
+{
+    if (batch_depth > 0)
+    {
+        pending_compare = compare;
+        has_pending_compare = true;
+        return;
+    }
+
+    has_pending_compare = false;
+    TIMERA_SetCompareValue(timer->peripheral.register_base, channel, compare);
+    timera_pwm_channel_output_enable(timer, channel);
+}
+
+void Servo::applyPendingCompare()
+{
+    if (!has_pending_compare)
+    {
+        return;
+    }
+
+    has_pending_compare = false;
+    TIMERA_SetCompareValue(timer->peripheral.register_base, channel, pending_compare);
+    timera_pwm_channel_output_enable(timer, channel);
+}
+
+void Servo::beginBatch()
+{
+    batch_depth++;
+}
+
+void Servo::commitBatch()
+{
+    CORE_ASSERT(batch_depth > 0, "Servo::commitBatch: no batch", return);
+    if (--batch_depth > 0)
+    {
+        return;
+    }
+
+    // all compare values are written back to back, so no period sees only some of them
+    const uint32_t state = core_critical_enter();
+    for (Servo *servo : servos)
+    {
+        if (servo != nullptr)
+        {
+            servo->applyPendingCompare();
+        }
+    }
+    core_critical_exit(state);
 }
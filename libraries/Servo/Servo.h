@@ -35,6 +35,22 @@
  */
 #define INVALID_SERVO 255
 
+#ifndef SERVO_MAX_SERVOS
+/**
+ * maximum number of servos attached at the same time
+ */
+#define SERVO_MAX_SERVOS 16
+#endif
+
+#ifndef SERVO_MIN_SHARED_FREQUENCY
+/**
+ * range of PWM frequencies a servo accepts, in Hz.
+ * a TimerA unit already started by another user at a frequency in this range is shared with it
+ */
+#define SERVO_MIN_SHARED_FREQUENCY 40
+#define SERVO_MAX_SHARED_FREQUENCY 400
+#endif
+
 typedef int32_t servo_angle_t;
 typedef uint32_t servo_pulse_width_t;
 
@@ -45,17 +61,20 @@ class Servo
 {
 public:
     Servo();
+    ~Servo();
 
     /**
      * @brief attach the given pin to the appropriate channel and set pin mode
      * @param gpio_pin gpio pin number
      * @param min_angle minimum angle in degrees
      * @param max_angle maximum angle in degrees
-     * @returns servo channel number or INVALID_SERVO if failure
+     * @returns servo index (0 - SERVO_MAX_SERVOS - 1) or INVALID_SERVO if failure
      *
      * @note this will disable the pin's GPIO function
      *
-     * @note ensure that the TimerA unit assigned to the pin is not already in use. if it is, this function will fail
+     * @note servos on pins of the same TimerA unit share the unit, each using one of its channels.
+     *       if the unit is already in use by something else, it is shared if it runs at a frequency between
+     *       SERVO_MIN_SHARED_FREQUENCY and SERVO_MAX_SHARED_FREQUENCY. otherwise, this function will fail
      *
      * @note if the pin is already attached to a servo, this function will detach the pin first
      */
@@ -117,7 +136,39 @@ public:
      */
     servo_angle_t read();
 
+    /**
+     * @brief get the index of the servo, as returned by attach()
+     * @returns servo index or INVALID_SERVO if not attached
+     */
+    inline uint8_t index()
+    {
+        return servo_index;
+    }
+
+    /**
+     * @brief hold back the output of write() and writeMicroseconds() of all servos, until commitBatch()
+     * @note calls may be nested. the outermost commitBatch() sets the outputs
+     */
+    static void beginBatch();
+
+    /**
+     * @brief set the outputs of all servos written since beginBatch(), at the same time
+     * @note the compare values of all servos are written in one critical section, so all servos change in the
+     *       same PWM period
+     */
+    static void commitBatch();
+
 private:
+    /**
+     * @brief set the compare value of the channel, or keep it for commitBatch()
+     */
+    void setCompare(const uint16_t compare);
+
+    /**
+     * @brief write the compare value kept for commitBatch(), if any
+     */
+    void applyPendingCompare();
+
     /**
      * @brief TimerA unit config reference
      * @note this is nullprt if the servo is not attached
@@ -144,6 +195,21 @@ private:
      * @note if equal to INVALID_SERVO, the servo is not attached or the pin is not known
      */
     gpio_pin_t pin = INVALID_SERVO;
+
+    /**
+     * @brief index of the servo in the servo table
+     */
+    uint8_t servo_index = INVALID_SERVO;
+
+    /**
+     * @brief compare value written by the next commitBatch()
+     */
+    uint16_t pending_compare;
+
+    /**
+     * @brief is pending_compare set?
+     */
+    bool has_pending_compare = false;
 };
 
 #endif // __SERVO_H__
@@ -82,7 +82,7 @@ inline void timer0_irq_register(timer0_interrupt_config_t &irq, voidFuncPtr call
 
     // register and enable irq with default priority
     enIrqRegistration(&irqConf);
-    NVIC_SetPriority(irqConf.enIRQn, DDL_IRQ_PRIORITY_DEFAULT);
+    NVIC_SetPriority(irqConf.enIRQn, IRQ_PRIORITY_TIMER0);
     NVIC_ClearPendingIRQ(irqConf.enIRQn);
     NVIC_EnableIRQ(irqConf.enIRQn);
 }
@@ -101,16 +101,73 @@ inline void timer0_irq_resign(timer0_interrupt_config_t &irq, const char *name)
     irqn_aa_resign(irq.interrupt_number, name);
 }
 
+//
+// context-carrying callbacks
+//
+
+/**
+ * @brief callback with context pointer, per timer0 channel
+ */
+typedef struct timer0_param_handler_t
+{
+    voidFuncPtrParam callback;
+    void *param;
+} timer0_param_handler_t;
+
+static timer0_param_handler_t timer0_param_handlers[4];
+
+/**
+ * @brief trampoline for callbacks with context pointer
+ * @note the channel index is a template parameter, so the slot address is constant
+ */
+template <uint8_t i>
+static void timer0_param_irq(void)
+{
+    timer0_param_handlers[i].callback(timer0_param_handlers[i].param);
+}
+
+static const voidFuncPtr timer0_param_irqs[4] = {
+    timer0_param_irq<0>,
+    timer0_param_irq<1>,
+    timer0_param_irq<2>,
+    timer0_param_irq<3>,
+};
+
+/**
+ * @brief get the index of a timer0 channel, 0 == Timer01A, 3 == Timer02B
+ */
+inline uint8_t timer0_channel_index(const timer0_channel_config_t *config)
+{
+    const uint8_t unit = config->peripheral.register_base == M4_TMR01 ? 0 : 1;
+    const uint8_t channel = config->peripheral.channel == Tim0_ChannelA ? 0 : 1;
+    return (unit * 2) + channel;
+}
+
 //
 // Timer0 class implementation
 //
 Timer0::Timer0(timer0_channel_config_t *config, voidFuncPtr callback)
 {
-    CORE_ASSERT(config != nullptr, "Timer0 config must not be null")
-    CORE_ASSERT(callback != nullptr, "Timer0 callback must not be null")
+    CORE_ASSERT(config != nullptr, "Timer0 config must not be null");
+    CORE_ASSERT(callback != nullptr, "Timer0 callback must not be null");
 
     this->config = config;
     this->callback = callback;
+
+    // cache the channel's registers for the inlined compare and count functions
+    M4_TMR0_TypeDef *timer = config->peripheral.register_base;
+    const bool is_channel_a = config->peripheral.channel == Tim0_ChannelA;
+    this->countRegister = is_channel_a ? &timer->CNTAR : &timer->CNTBR;
+    this->compareRegister = is_channel_a ? &timer->CMPAR : &timer->CMPBR;
+}
+
+Timer0::Timer0(timer0_channel_config_t *config, const voidFuncPtrParam callback, void *callback_param)
+    : Timer0(config, config != nullptr ? timer0_param_irqs[timer0_channel_index(config)] : nullptr)
+{
+    CORE_ASSERT(callback != nullptr, "Timer0 callback must not be null");
+
+    this->callbackWithParam = callback;
+    this->callbackParam = callback_param;
 }
 
 void Timer0::start(const uint32_t frequency, const uint16_t prescaler)
@@ -188,11 +245,25 @@ void Timer0::start(const stc_tim0_base_init_t *channel_config)
 
     // register interrupt
     CORE_ASSERT(this->callback != nullptr, "Timer0::start(): callback not set");
+    if (this->callbackWithParam != nullptr)
+    {
+        // callback is dispatched by the trampoline of the channel
+        timer0_param_handler_t &handler = timer0_param_handlers[timer0_channel_index(this->config)];
+        handler.callback = this->callbackWithParam;
+        handler.param = this->callbackParam;
+    }
+
     timer0_irq_register(this->config->interrupt, this->callback, "Timer0");
 
     // enable timer interrupt
     TIMER0_IntCmd(this->config->peripheral.register_base, this->config->peripheral.channel, Enable);
 
+    // keep the count rate when PCLK1 changes
+    if (channel_config->Tim0_CounterMode == Tim0_Sync)
+    {
+        sysclock_listener_register(&this->clockListener, Timer0::clockChanged, this);
+    }
+
     // set channel initialized flag
     this->isStarted = true;
 
@@ -218,9 +289,84 @@ void Timer0::stop()
 
     // resign interrupt
     timer0_irq_resign(this->config->interrupt, "Timer0");
+    sysclock_listener_unregister(&this->clockListener);
 
     // de-init timer channel
     TIMER0_DeInit(this->config->peripheral.register_base, this->config->peripheral.channel);
 
     TIMER0_DEBUG_PRINTF("stopped channel\n");
 }
+
+void Timer0::clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    Timer0 *timer = static_cast<Timer0 *>(param);
+    int8_t shift;
+    if (phase != SYSCLOCK_CHANGE_POST ||
+        !sysclock_get_shift(previous->pclk1, SYSTEM_CLOCK_FREQUENCIES.pclk1, shift) ||
+        shift == 0)
+    {
+        return;
+    }
+
+    // the clock divider is log2 of the division factor, so shifting it by the
+    // same amount as PCLK1 keeps the count rate, and the compare value stays valid
+    M4_TMR0_TypeDef *reg = timer->config->peripheral.register_base;
+    const bool is_channel_a = timer->config->peripheral.channel == Tim0_ChannelA;
+    int32_t div = int32_t(is_channel_a ? reg->BCONR_f.CKDIVA : reg->BCONR_f.CKDIVB) + shift;
+
+    // if the divider runs out of range, scale the compare value by the rest
+    int32_t rest = 0;
+    if (div < Tim0_ClkDiv0)
+    {
+        rest = div - Tim0_ClkDiv0;
+        div = Tim0_ClkDiv0;
+    }
+    else if (div > Tim0_ClkDiv1024)
+    {
+        rest = div - Tim0_ClkDiv1024;
+        div = Tim0_ClkDiv1024;
+    }
+
+    if (is_channel_a)
+    {
+        reg->BCONR_f.CKDIVA = uint32_t(div);
+    }
+    else
+    {
+        reg->BCONR_f.CKDIVB = uint32_t(div);
+    }
+
+    if (rest != 0)
+    {
+        uint32_t compare = *timer->compareRegister;
+        compare = rest > 0 ? (compare << rest) : (compare >> -rest);
+        *timer->compareRegister = compare > 0xFFFF ? 0xFFFF : (compare == 0 ? 1 : compare);
+    }
+}
+
+void Timer0::setOneShot(const bool enable)
+{
+    if (!this->isStarted)
+    {
+        CORE_ASSERT_FAIL("Timer0::setOneShot(): channel not initialized");
+        return;
+    }
+
+    // the compare match event of the channel stops the channel, via AOS
+    if (enable)
+    {
+        PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_AOS, Enable);
+    }
+
+    stc_tim0_trigger_init_t trigger_config = {
+        .Tim0_OCMode = Tim0_OC_Mode,
+        .Tim0_SelTrigSrc = this->config->peripheral.compare_event,
+        .Tim0_InTrigEnable = enable,
+        .Tim0_InTrigClear = false,
+        .Tim0_InTrigStart = false,
+        .Tim0_InTrigStop = enable,
+    };
+    TIMER0_HardTriggerInit(this->config->peripheral.register_base, this->config->peripheral.channel, &trigger_config);
+
+    TIMER0_DEBUG_PRINTF("one-shot mode %s\n", enable ? "enabled" : "disabled");
+}
@@ -12,6 +12,7 @@
 #include "Arduino.h"
 #include <core_debug.h>
 #include <hc32_ddl.h>
+#include <drivers/sysclock/sysclock_switch.h>
 #include "timer0_config.h"
 
 /**
@@ -35,6 +36,16 @@ public:
      */
     Timer0(timer0_channel_config_t *config, const voidFuncPtr callback);
 
+    /**
+     * @brief Construct a new Timer0 object, with a callback that receives a context pointer
+     * @param config pointer to timer0 peripheral configuration
+     * @param callback pointer to callback function for timer interrupt
+     * @param callback_param pointer passed to the callback, eg. the object handling the interrupt
+     * @note the callback is dispatched from a static slot per channel, so no memory is allocated.
+     *       only one Timer0 object per channel may be start()-ed at a time
+     */
+    Timer0(timer0_channel_config_t *config, const voidFuncPtrParam callback, void *callback_param);
+
     /**
      * @brief start timer0 channel with frequency and prescaler
      * @param frequency the frequency to set the timer to
@@ -132,8 +143,40 @@ public:
      */
     TIMER0_INLINE_ATTR void setCompareValue(const uint16_t compare)
     {
-        //CORE_ASSERT(this->isStarted, "Timer0::setCompare(): channel not initialized");
-        TIMER0_WriteCmpReg(this->config->peripheral.register_base, this->config->peripheral.channel, compare);
+        setCompare(compare);
+    }
+
+    /**
+     * @brief set timer0 channel compare value, writing the CMPAR / CMPBR register directly
+     * @param compare compare value to set. the interrupt fires when the counter reaches this value
+     * @note the counter restarts at 0 on every compare match. so, when called from the interrupt handler,
+     *       this sets the time until the next interrupt, in counts of the channel clock
+     * @note the channel must be start()-ed before calling this function
+     */
+    TIMER0_INLINE_ATTR void setCompare(const uint16_t compare)
+    {
+        *this->compareRegister = compare;
+    }
+
+    /**
+     * @brief move the current compare value (deadline) ahead
+     * @param ticks counts to add to the compare value. the result saturates at 0xFFFF
+     * @note to be used before the compare match happened, eg. to postpone the next interrupt
+     * @note the channel must be start()-ed before calling this function
+     */
+    TIMER0_INLINE_ATTR void advanceCompare(const uint16_t ticks)
+    {
+        const uint32_t compare = (*this->compareRegister & 0xFFFF) + ticks;
+        *this->compareRegister = compare > 0xFFFF ? 0xFFFF : compare;
+    }
+
+    /**
+     * @brief get timer0 channel compare value
+     * @return current compare value
+     */
+    TIMER0_INLINE_ATTR uint16_t getCompare()
+    {
+        return static_cast<uint16_t>(*this->compareRegister);
     }
 
     /**
@@ -144,10 +187,29 @@ public:
      */
     TIMER0_INLINE_ATTR uint16_t getCount()
     {
-        //CORE_ASSERT(this->isStarted, "Timer0::getCount(): channel not initialized");
-        return TIMER0_GetCntReg(this->config->peripheral.register_base, this->config->peripheral.channel);
+        return static_cast<uint16_t>(*this->countRegister);
     }
 
+    /**
+     * @brief set timer0 channel counter value
+     * @param count counter value to set
+     * @note the channel should be paused while setting the counter
+     */
+    TIMER0_INLINE_ATTR void setCount(const uint16_t count)
+    {
+        *this->countRegister = count;
+    }
+
+    /**
+     * @brief enable or disable one-shot mode
+     * @param enable if true, the channel stops (pauses) in hardware on compare match.
+     *               the interrupt fires once, and the channel has to be resume()-ed to fire again
+     * @note one-shot mode uses the Timer0 hardware trigger, whose event source is shared by all Timer0 channels.
+     *       thus, only one channel can be in one-shot mode at a time, and not together with USART[n]_RX_DMA
+     * @note the channel must be start()-ed before calling this function
+     */
+    void setOneShot(const bool enable);
+
     /**
      * @brief set timer0 channel callback priority
      * @param channel timer0 channel to set callback priority for
@@ -177,5 +239,28 @@ public:
 private:
     timer0_channel_config_t *config;
     voidFuncPtr callback;
+    voidFuncPtrParam callbackWithParam = nullptr;
+    void *callbackParam = nullptr;
     bool isStarted = false;
+
+    /**
+     * @brief counter register of the channel (CNTAR or CNTBR)
+     */
+    volatile uint32_t *countRegister;
+
+    /**
+     * @brief compare register of the channel (CMPAR or CMPBR)
+     */
+    volatile uint32_t *compareRegister;
+
+    /**
+     * @brief clock change listener, registered while started with PCLK1 as clock source
+     */
+    sysclock_listener_t clockListener = {};
+
+    /**
+     * @brief clock change listener callback, keeps the count rate constant
+     * @param param the Timer0
+     */
+    static void clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param);
 };
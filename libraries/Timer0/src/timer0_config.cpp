@@ -5,6 +5,7 @@ timer0_channel_config_t TIMER01A_config = {
         .register_base = M4_TMR01,
         .channel = Tim0_ChannelA,
         .clock_id = PWC_FCG2_PERIPH_TIM01,
+        .compare_event = EVT_TMR01_GCMA,
     },
     .interrupt = {
         .interrupt_source = INT_TMR01_GCMA,
@@ -16,6 +17,7 @@ timer0_channel_config_t TIMER01B_config = {
         .register_base = M4_TMR01,
         .channel = Tim0_ChannelB,
         .clock_id = PWC_FCG2_PERIPH_TIM01,
+        .compare_event = EVT_TMR01_GCMB,
     },
     .interrupt = {
         .interrupt_source = INT_TMR01_GCMB,
@@ -27,6 +29,7 @@ timer0_channel_config_t TIMER02A_config = {
         .register_base = M4_TMR02,
         .channel = Tim0_ChannelA,
         .clock_id = PWC_FCG2_PERIPH_TIM02,
+        .compare_event = EVT_TMR02_GCMA,
     },
     .interrupt = {
         .interrupt_source = INT_TMR02_GCMA,
@@ -38,6 +41,7 @@ timer0_channel_config_t TIMER02B_config = {
         .register_base = M4_TMR02,
         .channel = Tim0_ChannelB,
         .clock_id = PWC_FCG2_PERIPH_TIM02,
+        .compare_event = EVT_TMR02_GCMB,
     },
     .interrupt = {
         .interrupt_source = INT_TMR02_GCMB,
@@ -21,6 +21,12 @@ typedef struct timer0_peripheral_config_t
      * @note in FCG2
      */
     uint32_t clock_id;
+
+    /**
+     * @brief compare match event of the channel, for triggering peripherals via AOS
+     * @note eg. EVT_TMR01_GCMA
+     */
+    en_event_src_t compare_event;
 } timer0_peripheral_config_t;
 
 /**
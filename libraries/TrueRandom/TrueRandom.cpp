@@ -1,16 +1,109 @@
 #include "TrueRandom.h"
+#include "RingBuffer.h"
 #include "core_debug.h"
+#include "core_critical.h"
+#include "drivers/irqn/irqn.h"
+
+#if (TRUE_RANDOM_POOL_SIZE < 2) || ((TRUE_RANDOM_POOL_SIZE & (TRUE_RANDOM_POOL_SIZE - 1)) != 0)
+#error "TRUE_RANDOM_POOL_SIZE must be a power of two, and at least 2"
+#endif
+
+// each conversion produces 2 32-bit random numbers
+#define TRNG_WORDS_PER_CONVERSION 2
 
 //
 // TrueRandom global instance
 //
 TrueRandom RNG;
 
+//
+// entropy pool
+//
+static RingBuffer<uint32_t, TRUE_RANDOM_POOL_SIZE> pool;
+
+/**
+ * @brief is a conversion running, that will push to the pool once done?
+ */
+static volatile bool refill_running = false;
+
+/**
+ * @brief IRQn of the conversion done interrupt
+ * @note only valid while initialized
+ */
+static IRQn_Type trng_irqn;
+
+static bool initialized = false;
+
+/**
+ * @brief start a conversion, if the pool has room for its result
+ * @note must be called with the TRNG interrupt disabled, or from within it
+ */
+static void start_refill()
+{
+    if (pool.capacity() - pool.count() < TRNG_WORDS_PER_CONVERSION)
+    {
+        refill_running = false;
+        return;
+    }
+
+    refill_running = true;
+    TRNG_StartIT();
+}
+
+/**
+ * @brief TRNG conversion done interrupt
+ */
+static void trng_irq_handler()
+{
+    uint32_t randoms[TRNG_WORDS_PER_CONVERSION];
+    TRNG_GetRandomNum(randoms, TRNG_WORDS_PER_CONVERSION);
+    pool.push(randoms, TRNG_WORDS_PER_CONVERSION);
+
+    start_refill();
+}
+
+/**
+ * @brief can the caller wait for the conversion done interrupt?
+ * @note not in an interrupt handler, and not with interrupts disabled or masked by a critical section
+ */
+static inline bool can_wait_for_refill()
+{
+    return __get_IPSR() == 0 && __get_PRIMASK() == 0 && __get_BASEPRI() == 0;
+}
+
+/**
+ * @brief get a random number by polling a conversion, for when the pool is empty and the interrupt cannot run
+ * @note the second number of the conversion goes to the pool. the interrupt of the conversion is dropped,
+ *       so it does not push the same numbers again
+ */
+static uint32_t read_blocking()
+{
+    uint32_t randoms[TRNG_WORDS_PER_CONVERSION];
+
+    const uint32_t critical = core_critical_enter();
+    const en_result_t res = TRNG_Generate(randoms, TRNG_WORDS_PER_CONVERSION, TRNG_TIMEOUT);
+    NVIC_ClearPendingIRQ(trng_irqn);
+    refill_running = false;
+    if (res == Ok)
+    {
+        pool.push(randoms + 1, TRNG_WORDS_PER_CONVERSION - 1);
+    }
+    core_critical_exit(critical);
+
+    CORE_ASSERT(res == Ok, "TrueRandom: TRNG conversion timed out", return 0);
+    return randoms[0];
+}
+
 //
 // TrueRandom implementation
 //
 void TrueRandom::begin()
 {
+    if (initialized)
+    {
+        return;
+    }
+
     // enable TRNG clock
     PWC_Fcg0PeriphClockCmd(PWC_FCG0_PERIPH_TRNG, Enable);
 
@@ -20,26 +113,82 @@ void TrueRandom::begin()
         .enShiftCount = TrngShiftCount_64,
     };
     TRNG_Init(&config);
+
+    // register the conversion done interrupt
+    irqn_aa_get(trng_irqn, "TRNG");
+    stc_irq_regi_conf_t irq_config = {
+        .enIntSrc = INT_TRNG_END,
+        .enIRQn = trng_irqn,
+        .pfnCallback = trng_irq_handler,
+    };
+    enIrqRegistration(&irq_config);
+    NVIC_ClearPendingIRQ(trng_irqn);
+    NVIC_SetPriority(trng_irqn, IRQ_PRIORITY_LOW);
+    NVIC_EnableIRQ(trng_irqn);
+    initialized = true;
+
+    // fill the pool in the background
+    pool.clear();
+    const uint32_t critical = core_critical_enter();
+    start_refill();
+    core_critical_exit(critical);
 }
 
 void TrueRandom::end()
 {
+    if (!initialized)
+    {
+        return;
+    }
+
+    NVIC_DisableIRQ(trng_irqn);
+    NVIC_ClearPendingIRQ(trng_irqn);
+    enIrqResign(trng_irqn);
+    irqn_aa_resign(trng_irqn, "TRNG");
+    initialized = false;
+    refill_running = false;
+
     TRNG_DeInit();
 }
 
-uint64_t TrueRandom::get()
+uint32_t TrueRandom::next()
 {
-    // TRNG generates 2 32-bit random numbers at a time
-    uint32_t randoms[2];
+    CORE_ASSERT(initialized, "TrueRandom::next: not initialized", return 0);
 
-    // get both random numbers
-    TRNG_Generate(randoms, 2, TRNG_TIMEOUT);
+    uint32_t random;
+    while (!pool.pop(random))
+    {
+        // the refill interrupt cannot run here, so waiting for it would never end
+        if (!can_wait_for_refill())
+        {
+            random = read_blocking();
+            break;
+        }
+
+        yield();
+    }
+
+    // restart the refill if it stopped on a full pool
+    if (!refill_running)
+    {
+        const uint32_t critical = core_critical_enter();
+        if (!refill_running)
+        {
+            start_refill();
+        }
+        core_critical_exit(critical);
+    }
 
-    // build 64-bit random number
-    uint64_t random = ((uint64_t)randoms[0] << 32) | randoms[1];
     return random;
 }
 
+uint64_t TrueRandom::get()
+{
+    // build 64-bit random number
+    const uint64_t high = next();
+    return (high << 32) | next();
+}
+
 void TrueRandom::fill(uint8_t *buffer, size_t size)
 {
     CORE_ASSERT(buffer != NULL, "TrueRandom::fill: buffer is NULL")
@@ -48,7 +197,7 @@ void TrueRandom::fill(uint8_t *buffer, size_t size)
     while (size > 0)
     {
         // get random number
-        uint64_t random = get();
+        const uint32_t random = next();
 
         // copy random number to buffer
         size_t count = min(size, sizeof(random));
@@ -57,3 +206,20 @@ void TrueRandom::fill(uint8_t *buffer, size_t size)
         size -= count;
     }
 }
+
+size_t TrueRandom::available()
+{
+    return pool.count() * sizeof(uint32_t);
+}
+
+void TrueRandom::seedRandom()
+{
+    // randomSeed() ignores 0
+    uint32_t seed;
+    do
+    {
+        seed = next();
+    } while (seed == 0);
+
+    randomSeed(seed);
+}
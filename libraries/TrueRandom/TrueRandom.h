@@ -17,11 +17,26 @@
 #define TRNG_TIMEOUT 10
 #endif
 
+#ifndef TRUE_RANDOM_POOL_SIZE
+/**
+ * @brief number of 32-bit random numbers kept in the entropy pool
+ * @note must be a power of two, and at least 2
+ */
+#define TRUE_RANDOM_POOL_SIZE 16
+#endif
+
+/**
+ * true random number generator, using the TRNG peripheral.
+ *
+ * random numbers are kept in a pool, which the TRNG conversion done interrupt refills in the background.
+ * get() and fill() are served from the pool, and only wait (calling yield()) when it runs empty.
+ * in an interrupt handler or with interrupts masked, an empty pool is instead refilled by polling a conversion.
+ */
 class TrueRandom
 {
 public:
     /**
-     * @brief initialize true random number generator
+     * @brief initialize true random number generator, and start filling the pool
      */
     void begin();
 
@@ -41,6 +56,24 @@ public:
      * @param size size of buffer
      */
     void fill(uint8_t *buffer, size_t size);
+
+    /**
+     * @brief get the number of random bytes available without waiting
+     */
+    size_t available();
+
+    /**
+     * @brief seed random() of the core with a true random number
+     * @note with CORE_FAST_RANDOM, random() then uses a fast PRNG. not suitable for cryptography
+     */
+    void seedRandom();
+
+private:
+    /**
+     * @brief get a 32-bit random number from the pool, waiting until one is available
+     * @note if the refill interrupt cannot run, does a blocking conversion instead of waiting
+     */
+    uint32_t next();
 };
 
 /**
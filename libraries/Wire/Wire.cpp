@@ -0,0 +1,626 @@
+#include "Wire.h"
+#include <drivers/gpio/gpio.h>
+#include <drivers/irqn/irqn.h>
+#include <drivers/sysclock/sysclock.h>
+#include <core_debug.h>
+
+/**
+ * @brief all interrupts used by a transfer
+ */
+#define WIRE_TRANSFER_INTERRUPTS (I2C_CR2_STARTIE | I2C_CR2_STOPIE | I2C_CR2_TENDIE | I2C_CR2_RFULLIE | I2C_CR2_ARLOIE | I2C_CR2_NACKIE)
+
+//
+// transfer state machine
+// (runs in the I2C interrupts)
+//
+
+/**
+ * @brief complete the running transfer
+ */
+static void wire_complete(wire_config_t *config, const uint8_t result)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    I2C_IntCmd(i2c, WIRE_TRANSFER_INTERRUPTS, Disable);
+    I2C_NackConfig(i2c, Disable);
+
+    state.result = result;
+    state.phase = WIRE_PHASE_IDLE;
+    if (state.callback != NULL)
+    {
+        state.callback(result, state.callback_param);
+    }
+}
+
+/**
+ * @brief end the running transfer, with a stop condition if requested
+ */
+static void wire_stop(wire_config_t *config, const uint8_t result, const bool force_stop)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    if (!state.send_stop && !force_stop)
+    {
+        // keep the bus, the next transfer starts with a repeated start
+        state.bus_held = true;
+        wire_complete(config, result);
+        return;
+    }
+
+    // complete once the stop condition was sent
+    state.result = result;
+    state.phase = WIRE_PHASE_STOP;
+    state.bus_held = false;
+    I2C_IntCmd(i2c, I2C_CR2_TENDIE | I2C_CR2_RFULLIE | I2C_CR2_NACKIE, Disable);
+    I2C_ClearStatus(i2c, I2C_CLR_STOPFCLR);
+    I2C_IntCmd(i2c, I2C_CR2_STOPIE, Enable);
+    I2C_GenerateStop(i2c, Enable);
+}
+
+/**
+ * @brief handle the event and error interrupt
+ */
+static void wire_event_irq(wire_config_t *config)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    // arbitration lost, the bus is no longer ours
+    if (I2C_GetStatus(i2c, I2C_SR_ARLOF) == Set)
+    {
+        I2C_ClearStatus(i2c, I2C_CLR_ARLOFCLR);
+        state.bus_held = false;
+        wire_complete(config, WIRE_RESULT_OTHER_ERROR);
+        return;
+    }
+
+    // slave did not acknowledge
+    if (I2C_GetStatus(i2c, I2C_SR_NACKF) == Set)
+    {
+        I2C_ClearStatus(i2c, I2C_CLR_NACKFCLR);
+
+        // while receiving, only the address is acknowledged by the slave
+        if (state.phase == WIRE_PHASE_WRITE || (state.phase == WIRE_PHASE_READ && state.index == 0))
+        {
+            wire_stop(config, state.index == 0 ? WIRE_RESULT_ADDRESS_NACK : WIRE_RESULT_DATA_NACK, true);
+            return;
+        }
+    }
+
+    // (repeated) start condition sent, send address
+    if (I2C_GetStatus(i2c, I2C_SR_STARTF) == Set)
+    {
+        I2C_ClearStatus(i2c, I2C_CLR_STARTFCLR);
+        if (state.phase == WIRE_PHASE_START)
+        {
+            I2C_IntCmd(i2c, I2C_CR2_STARTIE, Disable);
+            if (state.address & 0x1)
+            {
+                // receive: NACK the last byte, which is the first one if only one byte is read
+                state.phase = WIRE_PHASE_READ;
+                I2C_NackConfig(i2c, state.length == 1 ? Enable : Disable);
+                I2C_IntCmd(i2c, I2C_CR2_RFULLIE | I2C_CR2_NACKIE, Enable);
+            }
+            else
+            {
+                // transmit: the transfer end interrupt sends the data
+                state.phase = WIRE_PHASE_WRITE;
+                I2C_ClearStatus(i2c, I2C_CLR_TENDFCLR);
+                I2C_IntCmd(i2c, I2C_CR2_TENDIE | I2C_CR2_NACKIE, Enable);
+            }
+
+            I2C_WriteData(i2c, state.address);
+        }
+    }
+
+    // stop condition sent, transfer complete
+    if (I2C_GetStatus(i2c, I2C_SR_STOPF) == Set)
+    {
+        I2C_ClearStatus(i2c, I2C_CLR_STOPFCLR);
+        if (state.phase == WIRE_PHASE_STOP)
+        {
+            wire_complete(config, state.result);
+        }
+    }
+}
+
+/**
+ * @brief handle the transfer end interrupt
+ * @note fires after the address and each data byte were acknowledged
+ */
+static void wire_tx_end_irq(wire_config_t *config)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    I2C_ClearStatus(i2c, I2C_CLR_TENDFCLR);
+    if (state.phase != WIRE_PHASE_WRITE || I2C_GetStatus(i2c, I2C_SR_ACKRF) == Set)
+    {
+        // NACK is handled by the event interrupt
+        return;
+    }
+
+    if (state.index < state.length)
+    {
+        I2C_WriteData(i2c, state.buffer[state.index++]);
+        return;
+    }
+
+    wire_stop(config, WIRE_RESULT_SUCCESS, false);
+}
+
+/**
+ * @brief handle the receive buffer full interrupt
+ */
+static void wire_rx_full_irq(wire_config_t *config)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    if (state.phase != WIRE_PHASE_READ)
+    {
+        (void)I2C_ReadData(i2c);
+        return;
+    }
+
+    // NACK the last byte, so the slave releases the bus
+    if (state.index + 2 == state.length)
+    {
+        I2C_NackConfig(i2c, Enable);
+    }
+
+    state.buffer[state.index++] = I2C_ReadData(i2c);
+    if (state.index >= state.length)
+    {
+        wire_stop(config, WIRE_RESULT_SUCCESS, false);
+    }
+}
+
+/**
+ * @brief start a transfer
+ * @return false if a transfer is already running
+ */
+static bool wire_start(wire_config_t *config, const uint8_t address, uint8_t *buffer, const size_t length, const bool send_stop, const wire_callback_t callback, void *callback_param)
+{
+    M4_I2C_TypeDef *i2c = config->peripheral.register_base;
+    wire_state_t &state = config->state;
+
+    if (state.phase != WIRE_PHASE_IDLE)
+    {
+        return false;
+    }
+
+    // another master is using the bus
+    if (!state.bus_held && I2C_GetStatus(i2c, I2C_SR_BUSY) == Set)
+    {
+        state.result = WIRE_RESULT_OTHER_ERROR;
+        if (callback != NULL)
+        {
+            callback(WIRE_RESULT_OTHER_ERROR, callback_param);
+        }
+
+        return true;
+    }
+
+    state.address = address;
+    state.buffer = buffer;
+    state.length = length;
+    state.index = 0;
+    state.send_stop = send_stop;
+    state.callback = callback;
+    state.callback_param = callback_param;
+    state.phase = WIRE_PHASE_START;
+
+    // the rest of the transfer runs in the interrupts
+    I2C_ClearStatus(i2c, I2C_CLR_STARTFCLR | I2C_CLR_STOPFCLR | I2C_CLR_NACKFCLR | I2C_CLR_ARLOFCLR);
+    I2C_IntCmd(i2c, I2C_CR2_STARTIE | I2C_CR2_ARLOIE, Enable);
+    if (state.bus_held)
+    {
+        I2C_GenerateReStart(i2c, Enable);
+    }
+    else
+    {
+        I2C_GenerateStart(i2c, Enable);
+    }
+
+    return true;
+}
+
+//
+// interrupt handlers
+//
+static wire_config_t *I2Cx[3] = {
+    &I2C1_config,
+    &I2C2_config,
+    &I2C3_config,
+};
+
+template <uint8_t x>
+static void I2Cx_rx_full_irq(void)
+{
+    wire_rx_full_irq(I2Cx[x - 1]);
+}
+
+template <uint8_t x>
+static void I2Cx_tx_end_irq(void)
+{
+    wire_tx_end_irq(I2Cx[x - 1]);
+}
+
+template <uint8_t x>
+static void I2Cx_event_irq(void)
+{
+    wire_event_irq(I2Cx[x - 1]);
+}
+
+static const func_ptr_t I2Cx_rx_full_irqs[3] = {
+    I2Cx_rx_full_irq<1>,
+    I2Cx_rx_full_irq<2>,
+    I2Cx_rx_full_irq<3>,
+};
+
+static const func_ptr_t I2Cx_tx_end_irqs[3] = {
+    I2Cx_tx_end_irq<1>,
+    I2Cx_tx_end_irq<2>,
+    I2Cx_tx_end_irq<3>,
+};
+
+static const func_ptr_t I2Cx_event_irqs[3] = {
+    I2Cx_event_irq<1>,
+    I2Cx_event_irq<2>,
+    I2Cx_event_irq<3>,
+};
+
+/**
+ * @brief I2C register to I2C number
+ */
+#define I2Cx_REG_TO_X(reg) \
+    reg == M4_I2C1   ? 1   \
+    : reg == M4_I2C2 ? 2   \
+    : reg == M4_I2C3 ? 3   \
+                     : 0
+
+/**
+ * @brief register and enable an I2C interrupt
+ */
+static void wire_irq_register(wire_interrupt_config_t &irq, const uint32_t priority, const func_ptr_t callback)
+{
+    // auto-assign IRQn
+    IRQn_Type irqn;
+    irqn_aa_get(irqn, "wire");
+    irq.interrupt_number = irqn;
+
+    stc_irq_regi_conf_t irqConf = {
+        .enIntSrc = irq.interrupt_source,
+        .enIRQn = irq.interrupt_number,
+        .pfnCallback = callback,
+    };
+    enIrqRegistration(&irqConf);
+    NVIC_SetPriority(irqConf.enIRQn, priority);
+    NVIC_ClearPendingIRQ(irqConf.enIRQn);
+    NVIC_EnableIRQ(irqConf.enIRQn);
+}
+
+/**
+ * @brief disable and resign an I2C interrupt
+ */
+static void wire_irq_resign(wire_interrupt_config_t &irq)
+{
+    NVIC_DisableIRQ(irq.interrupt_number);
+    NVIC_ClearPendingIRQ(irq.interrupt_number);
+    enIrqResign(irq.interrupt_number);
+    irqn_aa_resign(irq.interrupt_number, "wire");
+}
+
+//
+// TwoWire
+//
+
+TwoWire::TwoWire(wire_config_t *config, gpio_pin_t scl_pin, gpio_pin_t sda_pin)
+{
+    CORE_ASSERT(config != NULL, "TwoWire: config is NULL");
+    this->config = config;
+    this->scl_pin = scl_pin;
+    this->sda_pin = sda_pin;
+    this->clock_frequency = 100000;
+    this->timeout = WIRE_DEFAULT_TIMEOUT;
+    this->initialized = false;
+    this->tx_address = 0;
+    this->tx_length = 0;
+    this->tx_overflow = false;
+    this->rx_length = 0;
+    this->rx_index = 0;
+    this->request_callback = NULL;
+    this->request_callback_param = NULL;
+}
+
+void TwoWire::init_peripheral()
+{
+    M4_I2C_TypeDef *i2c = this->config->peripheral.register_base;
+
+    // the SCL timing is derived from PCLK3.
+    // use the smallest clock divider the timing can be generated with
+    stc_i2c_init_t i2c_config;
+    MEM_ZERO_STRUCT(i2c_config);
+    i2c_config.u32Baudrate = this->clock_frequency;
+    i2c_config.u32SclTime = 0;
+
+    en_result_t result = Error;
+    float32_t error;
+    for (uint32_t div = I2C_CLK_DIV1; div <= I2C_CLK_DIV128 && result != Ok; div++)
+    {
+        I2C_DeInit(i2c);
+        i2c_config.u32ClockDiv = div;
+        result = I2C_Init(i2c, &i2c_config, &error);
+    }
+
+    CORE_ASSERT(result == Ok, "TwoWire: clock frequency cannot be generated from PCLK3");
+    I2C_BusWaitCmd(i2c, Enable);
+    I2C_Cmd(i2c, Enable);
+
+    this->config->state.phase = WIRE_PHASE_IDLE;
+    this->config->state.bus_held = false;
+}
+
+void TwoWire::begin()
+{
+    const uint8_t x = I2Cx_REG_TO_X(this->config->peripheral.register_base);
+    CORE_ASSERT(x >= 1 && x <= 3, "TwoWire::begin: invalid I2C unit", return);
+
+    if (this->initialized)
+    {
+        end();
+    }
+
+    // enable I2C peripheral clock
+    PWC_Fcg1PeriphClockCmd(this->config->peripheral.clock_id, Enable);
+    init_peripheral();
+
+    // set pin functions
+    GPIO_SetFunc(this->scl_pin, this->config->peripheral.scl_function);
+    GPIO_SetFunc(this->sda_pin, this->config->peripheral.sda_function);
+
+    // register interrupts
+    wire_interrupts_config_t &irqs = this->config->interrupts;
+    wire_irq_register(irqs.rx_full, irqs.interrupt_priority, I2Cx_rx_full_irqs[x - 1]);
+    wire_irq_register(irqs.tx_end, irqs.interrupt_priority, I2Cx_tx_end_irqs[x - 1]);
+    wire_irq_register(irqs.event, irqs.interrupt_priority, I2Cx_event_irqs[x - 1]);
+
+    sysclock_listener_register(&this->clockListener, TwoWire::clockChanged, this);
+    this->initialized = true;
+}
+
+void TwoWire::begin(uint8_t address)
+{
+    (void)address;
+    CORE_ASSERT_FAIL("TwoWire::begin: slave mode is not supported");
+    begin();
+}
+
+void TwoWire::end()
+{
+    if (!this->initialized)
+    {
+        return;
+    }
+
+    wait_for_completion();
+    sysclock_listener_unregister(&this->clockListener);
+
+    M4_I2C_TypeDef *i2c = this->config->peripheral.register_base;
+    I2C_IntCmd(i2c, WIRE_TRANSFER_INTERRUPTS, Disable);
+    wire_interrupts_config_t &irqs = this->config->interrupts;
+    wire_irq_resign(irqs.rx_full);
+    wire_irq_resign(irqs.tx_end);
+    wire_irq_resign(irqs.event);
+
+    I2C_Cmd(i2c, Disable);
+    I2C_DeInit(i2c);
+
+    // return pins to GPIO function
+    GPIO_SetFunc(this->scl_pin, Func_Gpio);
+    GPIO_SetFunc(this->sda_pin, Func_Gpio);
+
+    PWC_Fcg1PeriphClockCmd(this->config->peripheral.clock_id, Disable);
+    this->initialized = false;
+}
+
+void TwoWire::setClock(uint32_t clockFreq)
+{
+    this->clock_frequency = clockFreq;
+    if (this->initialized)
+    {
+        wait_for_completion();
+        init_peripheral();
+    }
+}
+
+void TwoWire::clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param)
+{
+    (void)previous;
+    TwoWire *wire = static_cast<TwoWire *>(param);
+    if (phase == SYSCLOCK_CHANGE_PRE)
+    {
+        // let the running transfer complete at the old timing
+        wire->wait_for_completion();
+        return;
+    }
+
+    // re-derive the SCL timing from the new PCLK3
+    wire->init_peripheral();
+}
+
+void TwoWire::setWireTimeout(uint32_t timeout)
+{
+    this->timeout = timeout;
+}
+
+uint8_t TwoWire::wait_for_completion()
+{
+    wire_state_t &state = this->config->state;
+    const uint32_t start = millis();
+    while (state.phase != WIRE_PHASE_IDLE)
+    {
+        if (this->timeout != 0 && (millis() - start) > this->timeout)
+        {
+            // bus is stuck, reset the I2C unit
+            I2C_IntCmd(this->config->peripheral.register_base, WIRE_TRANSFER_INTERRUPTS, Disable);
+            init_peripheral();
+            state.result = WIRE_RESULT_TIMEOUT;
+            break;
+        }
+
+        yield();
+    }
+
+    return state.result;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    // the transmit buffer may still be in use by a background transfer
+    wait_for_completion();
+
+    this->tx_address = address;
+    this->tx_length = 0;
+    this->tx_overflow = false;
+}
+
+uint8_t TwoWire::endTransmission(bool stopBit)
+{
+    if (!endTransmissionAsync(stopBit))
+    {
+        return this->tx_overflow ? WIRE_RESULT_DATA_TOO_LONG : WIRE_RESULT_OTHER_ERROR;
+    }
+
+    return wait_for_completion();
+}
+
+bool TwoWire::endTransmissionAsync(bool stopBit, wire_callback_t callback, void *callback_param)
+{
+    CORE_ASSERT(this->initialized, "TwoWire::endTransmission: not initialized", return false);
+    if (this->tx_overflow)
+    {
+        return false;
+    }
+
+    return wire_start(this->config, uint8_t(this->tx_address << 1), this->tx_buffer, this->tx_length, stopBit, callback, callback_param);
+}
+
+void TwoWire::request_complete(uint8_t result, void *param)
+{
+    TwoWire *wire = static_cast<TwoWire *>(param);
+    wire->rx_length = result == WIRE_RESULT_SUCCESS ? wire->config->state.index : 0;
+    wire->rx_index = 0;
+    if (wire->request_callback != NULL)
+    {
+        wire->request_callback(result, wire->request_callback_param);
+    }
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t quantity, bool stopBit)
+{
+    wait_for_completion();
+    if (!requestFromAsync(address, quantity, stopBit))
+    {
+        return 0;
+    }
+
+    if (wait_for_completion() == WIRE_RESULT_TIMEOUT)
+    {
+        this->rx_length = 0;
+        this->rx_index = 0;
+    }
+
+    return uint8_t(this->rx_length);
+}
+
+bool TwoWire::requestFromAsync(uint8_t address, size_t quantity, bool stopBit, wire_callback_t callback, void *callback_param)
+{
+    CORE_ASSERT(this->initialized, "TwoWire::requestFrom: not initialized", return false);
+    if (isBusy())
+    {
+        return false;
+    }
+
+    if (quantity > WIRE_BUFFER_SIZE)
+    {
+        quantity = WIRE_BUFFER_SIZE;
+    }
+
+    this->rx_length = 0;
+    this->rx_index = 0;
+    if (quantity == 0)
+    {
+        return false;
+    }
+
+    this->request_callback = callback;
+    this->request_callback_param = callback_param;
+    return wire_start(this->config, uint8_t((address << 1) | 0x1), this->rx_buffer, quantity, stopBit, request_complete, this);
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (this->tx_length >= WIRE_BUFFER_SIZE)
+    {
+        this->tx_overflow = true;
+        setWriteError();
+        return 0;
+    }
+
+    this->tx_buffer[this->tx_length++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t quantity)
+{
+    for (size_t i = 0; i < quantity; i++)
+    {
+        if (!write(data[i]))
+        {
+            return i;
+        }
+    }
+
+    return quantity;
+}
+
+int TwoWire::available(void)
+{
+    return int(this->rx_length - this->rx_index);
+}
+
+int TwoWire::read(void)
+{
+    if (this->rx_index >= this->rx_length)
+    {
+        return -1;
+    }
+
+    return this->rx_buffer[this->rx_index++];
+}
+
+int TwoWire::peek(void)
+{
+    if (this->rx_index >= this->rx_length)
+    {
+        return -1;
+    }
+
+    return this->rx_buffer[this->rx_index];
+}
+
+void TwoWire::flush(void)
+{
+    wait_for_completion();
+}
+
+//
+// default instance
+//
+#if defined(VARIANT_I2C1_SCL_PIN) && defined(VARIANT_I2C1_SDA_PIN)
+TwoWire Wire(&I2C1_config, VARIANT_I2C1_SCL_PIN, VARIANT_I2C1_SDA_PIN);
+#endif
@@ -19,32 +19,144 @@
 #ifndef TWO_WIRE_H_
 #define TWO_WIRE_H_
 
-#error "Wire library is not yet supported on the HC32F460"
+// check DDL configuration
+#if (DDL_I2C_ENABLE != DDL_ON)
+#error "Wire library requires I2C DDL to be enabled"
+#endif
 
+#if (DDL_PWC_ENABLE != DDL_ON)
+#error "Wire library requires PWC DDL to be enabled"
+#endif
+
+#include "Arduino.h"
 #include "Stream.h"
-#include "variant.h"
-#include "RingBuffer.h"
+#include <hc32_ddl.h>
+#include <drivers/sysclock/sysclock_switch.h>
+#include "wire_config.h"
 
 // WIRE_HAS_END means Wire has end()
 #define WIRE_HAS_END 1
 
-class TwoWire: public Stream {
-public:
-	TwoWire();
+/**
+ * @brief size of the transmit and receive buffers
+ */
+#ifndef WIRE_BUFFER_SIZE
+#define WIRE_BUFFER_SIZE 32
+#endif
 
+// Arduino compatibility
+#define BUFFER_LENGTH WIRE_BUFFER_SIZE
+
+/**
+ * @brief default timeout of the blocking transfer functions, in milliseconds
+ */
+#ifndef WIRE_DEFAULT_TIMEOUT
+#define WIRE_DEFAULT_TIMEOUT 25
+#endif
+
+//
+// transfer results, as returned by endTransmission()
+//
+#define WIRE_RESULT_SUCCESS 0
+#define WIRE_RESULT_DATA_TOO_LONG 1
+#define WIRE_RESULT_ADDRESS_NACK 2
+#define WIRE_RESULT_DATA_NACK 3
+#define WIRE_RESULT_OTHER_ERROR 4
+#define WIRE_RESULT_TIMEOUT 5
+
+class TwoWire : public Stream
+{
+public:
+	/**
+	 * @brief Construct a new TwoWire object
+	 * @param config pointer to I2C peripheral configuration
+	 * @param scl_pin pin to use for SCL
+	 * @param sda_pin pin to use for SDA
+	 */
+	TwoWire(wire_config_t *config, gpio_pin_t scl_pin, gpio_pin_t sda_pin);
+
+	/**
+	 * @brief initialize the I2C unit as master
+	 */
 	void begin();
+
+	/**
+	 * @brief initialize the I2C unit as slave
+	 * @note slave mode is not supported. initializes as master
+	 */
 	void begin(uint8_t address);
 
 	void end();
+
+	/**
+	 * @brief set the SCL clock frequency
+	 * @param clockFreq frequency in Hz. default is 100000
+	 */
 	void setClock(uint32_t clockFreq);
 
+	/**
+	 * @brief set the timeout of the blocking transfer functions
+	 * @param timeout timeout in milliseconds. 0 to wait forever
+	 * @note on timeout, the I2C unit is reset
+	 */
+	void setWireTimeout(uint32_t timeout = WIRE_DEFAULT_TIMEOUT);
+
 	void beginTransmission(uint8_t address);
+
+	/**
+	 * @brief send the data written since beginTransmission(), blocking until done
+	 * @param stopBit send a stop condition at the end? if not, the next transfer starts with a repeated start
+	 * @return 0 on success,
+	 *         1 if the data was too long to fit in the transmit buffer,
+	 *         2 if the address was not acknowledged,
+	 *         3 if the data was not acknowledged,
+	 *         4 on other errors (eg. arbitration lost),
+	 *         5 on timeout
+	 * @note the transfer runs in the I2C interrupts. this only waits for its completion
+	 */
 	uint8_t endTransmission(bool stopBit = true);
 
+	/**
+	 * @brief send the data written since beginTransmission() in the background
+	 * @param stopBit send a stop condition at the end?
+	 * @param callback called from the I2C interrupt when the transfer completed, with the result of endTransmission(). may be NULL
+	 * @param callback_param param for the callback
+	 * @return true if the transfer was started, false if a transfer is already running or the data was too long
+	 * @note the transmit buffer must not be written until the transfer completed
+	 */
+	bool endTransmissionAsync(bool stopBit = true, wire_callback_t callback = NULL, void *callback_param = NULL);
+
+	/**
+	 * @brief read bytes from a slave, blocking until done
+	 * @param address 7-bit slave address
+	 * @param quantity number of bytes to read. at most WIRE_BUFFER_SIZE
+	 * @param stopBit send a stop condition at the end?
+	 * @return the number of bytes read, available with read()
+	 */
 	uint8_t requestFrom(uint8_t address, size_t quantity, bool stopBit = true);
 
+	/**
+	 * @brief read bytes from a slave in the background
+	 * @param address 7-bit slave address
+	 * @param quantity number of bytes to read. at most WIRE_BUFFER_SIZE
+	 * @param stopBit send a stop condition at the end?
+	 * @param callback called from the I2C interrupt when the transfer completed. may be NULL
+	 * @param callback_param param for the callback
+	 * @return true if the transfer was started, false if a transfer is already running
+	 * @note the received bytes are available with read() once the transfer completed
+	 */
+	bool requestFromAsync(uint8_t address, size_t quantity, bool stopBit = true, wire_callback_t callback = NULL, void *callback_param = NULL);
+
+	/**
+	 * @brief is a transfer running?
+	 */
+	inline bool isBusy()
+	{
+		return this->config->state.phase != WIRE_PHASE_IDLE;
+	}
+
 	size_t write(uint8_t data);
-	size_t write(const uint8_t * data, size_t quantity);
+	size_t write(const uint8_t *data, size_t quantity);
 
 	virtual int available(void);
 	virtual int read(void);
@@ -54,10 +166,56 @@ public:
 	using Print::write;
 
 private:
-    RingBuffer rxBuffer;
-    RingBuffer txBuffer;
+	wire_config_t *config;
+	gpio_pin_t scl_pin;
+	gpio_pin_t sda_pin;
+	uint32_t clock_frequency;
+	uint32_t timeout;
+	bool initialized;
+
+	uint8_t tx_address;
+	uint8_t tx_buffer[WIRE_BUFFER_SIZE];
+	size_t tx_length;
+	bool tx_overflow;
+
+	uint8_t rx_buffer[WIRE_BUFFER_SIZE];
+	size_t rx_length;
+	size_t rx_index;
+
+	/**
+	 * @brief initialize the I2C unit for the current clock frequency
+	 */
+	void init_peripheral();
+
+	/**
+	 * @brief wait for the running transfer to complete
+	 * @return result of the transfer
+	 */
+	uint8_t wait_for_completion();
+
+	/**
+	 * @brief completion callback of requestFrom transfers
+	 * @param param the TwoWire
+	 */
+	static void request_complete(uint8_t result, void *param);
+
+	wire_callback_t request_callback;
+	void *request_callback_param;
+
+	/**
+	 * @brief clock change listener, registered while initialized
+	 */
+	sysclock_listener_t clockListener = {};
+
+	/**
+	 * @brief clock change listener callback, re-derives the SCL timing from the new PCLK3
+	 * @param param the TwoWire
+	 */
+	static void clockChanged(const sysclock_change_phase_t phase, const system_clock_frequencies_t *previous, void *param);
 };
 
+#if defined(VARIANT_I2C1_SCL_PIN) && defined(VARIANT_I2C1_SDA_PIN)
 extern TwoWire Wire;
+#endif
 
 #endif /* TWO_WIRE_H_ */
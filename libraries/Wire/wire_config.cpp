@@ -0,0 +1,31 @@
+#include "wire_config.h"
+#include <drivers/irqn/irq_priority.h>
+
+//
+// I2C configuration helpers
+//
+#define WIRE_CONFIG(x)                                       \
+    {                                                        \
+        .peripheral = {                                      \
+            .register_base = M4_I2C##x,                      \
+            .clock_id = PWC_FCG1_PERIPH_I2C##x,              \
+            .scl_function = Func_I2c##x##_Scl,               \
+            .sda_function = Func_I2c##x##_Sda,               \
+        },                                                   \
+        .interrupts = {                                      \
+            .rx_full = {                                     \
+                .interrupt_source = INT_I2C##x##_RXI,        \
+            },                                               \
+            .tx_end = {                                      \
+                .interrupt_source = INT_I2C##x##_TEI,        \
+            },                                               \
+            .event = {                                       \
+                .interrupt_source = INT_I2C##x##_EEI,        \
+            },                                               \
+            .interrupt_priority = IRQ_PRIORITY_WIRE,       \
+        },                                                   \
+    }
+
+wire_config_t I2C1_config = WIRE_CONFIG(1);
+wire_config_t I2C2_config = WIRE_CONFIG(2);
+wire_config_t I2C3_config = WIRE_CONFIG(3);
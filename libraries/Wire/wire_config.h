@@ -0,0 +1,207 @@
+#pragma once
+#include <hc32_ddl.h>
+#include <stddef.h>
+
+/**
+ * @brief I2C peripheral config
+ */
+typedef struct wire_peripheral_config_t
+{
+    /**
+     * @brief The base address of the I2C peripheral.
+     */
+    M4_I2C_TypeDef *register_base;
+
+    /**
+     * @brief The clock id of the I2C peripheral.
+     * @note in FCG1
+     */
+    uint32_t clock_id;
+
+    /**
+     * @brief pin function for the SCL pin
+     */
+    en_port_func_t scl_function;
+
+    /**
+     * @brief pin function for the SDA pin
+     */
+    en_port_func_t sda_function;
+} wire_peripheral_config_t;
+
+/**
+ * @brief I2C interrupt config
+ */
+typedef struct wire_interrupt_config_t
+{
+    /**
+     * @brief IRQn assigned to this interrupt handler
+     * @note auto-assigned in lib implementation
+     */
+    IRQn_Type interrupt_number;
+
+    /**
+     * @brief interrupt source
+     */
+    en_int_src_t interrupt_source;
+} wire_interrupt_config_t;
+
+/**
+ * @brief I2C interrupts config
+ */
+typedef struct wire_interrupts_config_t
+{
+    /**
+     * @brief receive buffer full interrupt
+     * @note INT_I2Cx_RXI
+     */
+    wire_interrupt_config_t rx_full;
+
+    /**
+     * @brief transfer end interrupt
+     * @note INT_I2Cx_TEI
+     */
+    wire_interrupt_config_t tx_end;
+
+    /**
+     * @brief event and error interrupt (start, stop, nack, arbitration lost)
+     * @note INT_I2Cx_EEI
+     */
+    wire_interrupt_config_t event;
+
+    /**
+     * @brief priority of all interrupts
+     */
+    uint32_t interrupt_priority;
+} wire_interrupts_config_t;
+
+/**
+ * @brief I2C transfer completion callback
+ * @param result result of the transfer, see TwoWire::endTransmission()
+ * @param param the param given when starting the transfer
+ */
+typedef void (*wire_callback_t)(uint8_t result, void *param);
+
+/**
+ * @brief phase of a I2C transfer
+ */
+typedef enum wire_phase_t
+{
+    /**
+     * @brief no transfer running
+     */
+    WIRE_PHASE_IDLE,
+
+    /**
+     * @brief waiting for the (repeated) start condition
+     */
+    WIRE_PHASE_START,
+
+    /**
+     * @brief address sent, transmitting data
+     */
+    WIRE_PHASE_WRITE,
+
+    /**
+     * @brief address sent, receiving data
+     */
+    WIRE_PHASE_READ,
+
+    /**
+     * @brief waiting for the stop condition
+     */
+    WIRE_PHASE_STOP,
+} wire_phase_t;
+
+/**
+ * @brief I2C runtime state
+ */
+typedef struct wire_state_t
+{
+    /**
+     * @brief phase of the running transfer
+     */
+    volatile wire_phase_t phase;
+
+    /**
+     * @brief address byte of the running transfer, including the R/W bit
+     */
+    uint8_t address;
+
+    /**
+     * @brief data of the running transfer
+     */
+    uint8_t *buffer;
+
+    /**
+     * @brief number of bytes to transfer
+     */
+    size_t length;
+
+    /**
+     * @brief number of bytes transferred so far
+     */
+    volatile size_t index;
+
+    /**
+     * @brief end the transfer with a stop condition?
+     * @note if not, the next transfer starts with a repeated start
+     */
+    bool send_stop;
+
+    /**
+     * @brief is the bus held after a transfer without stop condition?
+     */
+    bool bus_held;
+
+    /**
+     * @brief result of the transfer, once phase is WIRE_PHASE_IDLE
+     */
+    volatile uint8_t result;
+
+    /**
+     * @brief callback called when the transfer completed
+     */
+    wire_callback_t callback;
+
+    /**
+     * @brief param for the callback
+     */
+    void *callback_param;
+} wire_state_t;
+
+/**
+ * @brief I2C device config
+ */
+typedef struct wire_config_t
+{
+    /**
+     * @brief The peripheral config of the I2C unit.
+     */
+    wire_peripheral_config_t peripheral;
+
+    /**
+     * @brief I2C interrupts config
+     */
+    wire_interrupts_config_t interrupts;
+
+    /**
+     * @brief I2C runtime state
+     */
+    wire_state_t state;
+} wire_config_t;
+
+/**
+ * @brief I2C1 configuration
+ */
+extern wire_config_t I2C1_config;
+
+/**
+ * @brief I2C2 configuration
+ */
+extern wire_config_t I2C2_config;
+
+/**
+ * @brief I2C3 configuration
+ */
+extern wire_config_t I2C3_config;
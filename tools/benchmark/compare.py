@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+compare two CoreBenchmark reports, e.g. of two core releases
+
+each report is a serial capture of CoreBenchmark output. lines that are not JSON objects are ignored.
+benchmarks whose cycle count changed by more than the threshold are marked, and the exit code is 1 if any got slower.
+
+e.g.:
+  compare.py baseline.log current.log --metric min --threshold 5
+"""
+import argparse
+import json
+import sys
+
+
+def load_report(path):
+    """
+    read a report. returns (meta, dict of (benchmark, param) -> result)
+    """
+    meta = {}
+    results = {}
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith("{"):
+                continue
+            try:
+                entry = json.loads(line)
+            except json.JSONDecodeError:
+                continue
+
+            if entry.get("benchmark") == "meta":
+                meta = entry
+            elif "benchmark" in entry:
+                results[(entry["benchmark"], entry.get("param", 0))] = entry
+
+    return meta, results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compare two CoreBenchmark reports")
+    parser.add_argument("baseline", help="report of the baseline")
+    parser.add_argument("current", help="report to compare against the baseline")
+    parser.add_argument("--metric", choices=["min", "avg", "max"], default="min", help="value to compare (default min)")
+    parser.add_argument("--threshold", type=float, default=5.0, help="change in percent that is reported (default 5)")
+    args = parser.parse_args()
+
+    base_meta, base = load_report(args.baseline)
+    cur_meta, cur = load_report(args.current)
+
+    if base_meta.get("hclk") != cur_meta.get("hclk"):
+        print(f"warning: HCLK differs ({base_meta.get('hclk')} vs {cur_meta.get('hclk')}), cycle counts are not comparable")
+
+    regressed = False
+    print(f"{'benchmark':<28}{'param':>10}{'baseline':>12}{'current':>12}{'change':>10}")
+    for key in sorted(set(base) | set(cur), key=lambda k: (k[0], k[1])):
+        name, param = key
+        b = base.get(key, {}).get(args.metric)
+        c = cur.get(key, {}).get(args.metric)
+        if b is None or c is None:
+            print(f"{name:<28}{param:>10}{str(b or '-'):>12}{str(c or '-'):>12}{'':>10}")
+            continue
+
+        change = ((c - b) * 100.0 / b) if b > 0 else 0.0
+        mark = ""
+        if change > args.threshold:
+            mark = "  slower"
+            regressed = True
+        elif change < -args.threshold:
+            mark = "  faster"
+        print(f"{name:<28}{param:>10}{b:>12}{c:>12}{change:>9.1f}%{mark}")
+
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,52 @@
+#include "benchmark.h"
+#include "itoa.h"
+#include "avr/dtostrf.h"
+#include "WMath.h"
+
+BENCHMARK(itoa_decimal)
+{
+    char buffer[16];
+    for (size_t i = 0; i < iterations; i++)
+    {
+        benchmark_keep(itoa(int(i * 7919), buffer, 10));
+    }
+}
+
+BENCHMARK(ultoa_hex)
+{
+    char buffer[16];
+    for (size_t i = 0; i < iterations; i++)
+    {
+        benchmark_keep(ultoa((unsigned long)(i * 2654435761u), buffer, 16));
+    }
+}
+
+BENCHMARK(dtostrf_3)
+{
+    char buffer[24];
+    for (size_t i = 0; i < iterations; i++)
+    {
+        benchmark_keep(dtostrf((double(i & 0xFFFF) * 0.125) - 1000.0, 8, 3, buffer));
+    }
+}
+
+BENCHMARK(wmath_map)
+{
+    long value = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        value = map(long(i & 0xFFF), 0, 4095, -100, 100);
+        benchmark_keep(value);
+    }
+}
+
+BENCHMARK(wmath_random_range)
+{
+    randomSeed(1);
+    long value = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        value = random(10, 1000);
+        benchmark_keep(value);
+    }
+}
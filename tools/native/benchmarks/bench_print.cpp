@@ -0,0 +1,55 @@
+#include "benchmark.h"
+#include "Print.h"
+
+/**
+ * @brief a Print that discards what is printed
+ */
+class NullPrint : public Print
+{
+public:
+    size_t write(uint8_t) override
+    {
+        return 1;
+    }
+
+    size_t write(const uint8_t *, size_t size) override
+    {
+        return size;
+    }
+};
+
+BENCHMARK(print_int)
+{
+    NullPrint out;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        out.print(long(i) * 7919 - 1000000);
+    }
+}
+
+BENCHMARK(print_hex)
+{
+    NullPrint out;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        out.print(uint32_t(i * 2654435761u), HEX);
+    }
+}
+
+BENCHMARK(print_float)
+{
+    NullPrint out;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        out.print((float(i & 0xFFFF) * 1.25f) - 500.0f, 3);
+    }
+}
+
+BENCHMARK(printf_mixed)
+{
+    NullPrint out;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        out.printf("X:%d Y:%ld E:%s\n", int(i & 0xFFF), long(i), "ok");
+    }
+}
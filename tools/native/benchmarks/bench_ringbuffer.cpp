@@ -0,0 +1,38 @@
+#include "benchmark.h"
+#include "RingBuffer.h"
+
+BENCHMARK(ringbuffer_push_pop)
+{
+    static RingBuffer<uint8_t, 64> buffer;
+    uint8_t value = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        buffer.push(uint8_t(i));
+        buffer.pop(value);
+    }
+    benchmark_keep(value);
+}
+
+BENCHMARK(ringbuffer_push_pop_runtime_capacity)
+{
+    static RingBuffer<uint8_t> buffer(64);
+    uint8_t value = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        buffer.push(uint8_t(i));
+        buffer.pop(value);
+    }
+    benchmark_keep(value);
+}
+
+BENCHMARK(ringbuffer_bulk_32)
+{
+    static RingBuffer<uint8_t, 64> buffer;
+    uint8_t data[32] = {0};
+    for (size_t i = 0; i < iterations; i++)
+    {
+        buffer.push(data, sizeof(data));
+        buffer.pop(data, sizeof(data));
+    }
+    benchmark_keep(data);
+}
@@ -0,0 +1,111 @@
+#include "benchmark.h"
+#include "Stream.h"
+
+/**
+ * @brief a Stream reading from a constant string, rewound after each run
+ */
+class StringStream : public Stream
+{
+public:
+    StringStream(const char *text) : text(text), length(strlen(text)), position(0)
+    {
+    }
+
+    void rewind()
+    {
+        position = 0;
+    }
+
+    int available() override
+    {
+        return int(length - position);
+    }
+
+    int read() override
+    {
+        return position < length ? text[position++] : -1;
+    }
+
+    int peek() override
+    {
+        return position < length ? text[position] : -1;
+    }
+
+    void flush() override
+    {
+    }
+
+    size_t write(uint8_t) override
+    {
+        return 1;
+    }
+
+    size_t peekSpan(const char *&span) override
+    {
+        span = text + position;
+        return length - position;
+    }
+
+    void skipSpan(size_t count) override
+    {
+        position += count;
+    }
+
+private:
+    const char *text;
+    size_t length;
+    size_t position;
+};
+
+BENCHMARK(stream_parse_int)
+{
+    StringStream in("G1 X12345 Y-678 Z9\n");
+    long sum = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        in.rewind();
+        sum += in.parseInt();
+        sum += in.parseInt();
+        sum += in.parseInt();
+    }
+    benchmark_keep(sum);
+}
+
+BENCHMARK(stream_parse_float)
+{
+    StringStream in("X12.345 Y-67.8 E0.0125\n");
+    float sum = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        in.rewind();
+        sum += in.parseFloat();
+        sum += in.parseFloat();
+        sum += in.parseFloat();
+    }
+    benchmark_keep(sum);
+}
+
+BENCHMARK(stream_find)
+{
+    StringStream in("echo:busy: processing\nok T:210.0 /210.0 B:60.0 /60.0\n");
+    bool found = false;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        in.rewind();
+        found = in.find((char *)"B:");
+    }
+    benchmark_keep(found);
+}
+
+BENCHMARK(stream_read_bytes_until)
+{
+    StringStream in("N123 G1 X10 Y20 F3000*57\n");
+    char line[64];
+    size_t length = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        in.rewind();
+        length = in.readBytesUntil('\n', line, sizeof(line));
+    }
+    benchmark_keep(length);
+}
@@ -0,0 +1,47 @@
+#include "benchmark.h"
+#include "WString.h"
+
+BENCHMARK(string_concat)
+{
+    for (size_t i = 0; i < iterations; i++)
+    {
+        String s;
+        for (int p = 0; p < 8; p++)
+        {
+            s += "X:";
+            s += p;
+        }
+        benchmark_keep(s);
+    }
+}
+
+BENCHMARK(string_from_float)
+{
+    for (size_t i = 0; i < iterations; i++)
+    {
+        String s(float(i & 0xFFFF) * 0.01f, 2);
+        benchmark_keep(s);
+    }
+}
+
+BENCHMARK(string_index_of)
+{
+    const String s("ok T:210.0 /210.0 B:60.0 /60.0 @:127 B@:0");
+    int index = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        index = s.indexOf("B@:");
+        benchmark_keep(index);
+    }
+}
+
+BENCHMARK(string_to_float)
+{
+    const String s("-123.4567");
+    float value = 0;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        value = s.toFloat();
+        benchmark_keep(value);
+    }
+}
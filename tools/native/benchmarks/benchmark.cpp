@@ -0,0 +1,127 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// largest iteration count of a single run
+#define MAX_ITERATIONS (1ul << 30)
+
+static benchmark_t *benchmarks = NULL;
+
+bool benchmark_register(benchmark_t *benchmark)
+{
+    benchmark->next = benchmarks;
+    benchmarks = benchmark;
+    return true;
+}
+
+/**
+ * @brief run a benchmark once
+ * @return the duration of the run, in nanoseconds
+ */
+static double run_once(const benchmark_t *benchmark, const size_t iterations)
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    benchmark->function(iterations);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static void run(const benchmark_t *benchmark, const double min_time_ns, const int repeat)
+{
+    // find the iteration count that takes at least the minimum time
+    size_t iterations = 1;
+    double elapsed = run_once(benchmark, iterations);
+    while (elapsed < min_time_ns && iterations < MAX_ITERATIONS)
+    {
+        const double scale = elapsed > 0 ? (min_time_ns * 1.2) / elapsed : 10.0;
+        iterations = size_t(double(iterations) * std::min(std::max(scale, 2.0), 100.0));
+        iterations = std::min(iterations, size_t(MAX_ITERATIONS));
+        elapsed = run_once(benchmark, iterations);
+    }
+
+    std::vector<double> per_iteration;
+    for (int r = 0; r < repeat; r++)
+    {
+        per_iteration.push_back(run_once(benchmark, iterations) / double(iterations));
+    }
+    std::sort(per_iteration.begin(), per_iteration.end());
+
+    printf("{\"benchmark\":\"%s\",\"param\":0,\"iterations\":%zu,\"repeat\":%d,\"min\":%.3f,\"avg\":%.3f,\"max\":%.3f,\"unit\":\"ns\"}\n",
+           benchmark->name,
+           iterations,
+           repeat,
+           per_iteration.front(),
+           per_iteration[per_iteration.size() / 2],
+           per_iteration.back());
+    fflush(stdout);
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--list] [--filter <substring>] [--min-time <ms>] [--repeat <n>]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    double min_time_ms = 50;
+    int repeat = 5;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--list") == 0)
+        {
+            list = true;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            min_time_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            repeat = std::max(1, atoi(argv[++i]));
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // registration order is reversed, sort by name for stable reports
+    std::vector<const benchmark_t *> selected;
+    for (const benchmark_t *b = benchmarks; b != NULL; b = b->next)
+    {
+        if (filter == NULL || strstr(b->name, filter) != NULL)
+        {
+            selected.push_back(b);
+        }
+    }
+    std::sort(selected.begin(), selected.end(), [](const benchmark_t *a, const benchmark_t *b)
+              { return strcmp(a->name, b->name) < 0; });
+
+    if (list)
+    {
+        for (const benchmark_t *b : selected)
+        {
+            printf("%s\n", b->name);
+        }
+        return 0;
+    }
+
+    printf("{\"benchmark\":\"meta\",\"version\":1,\"target\":\"native\",\"unit\":\"ns\"}\n");
+    for (const benchmark_t *b : selected)
+    {
+        run(b, min_time_ms * 1e6, repeat);
+    }
+    return 0;
+}
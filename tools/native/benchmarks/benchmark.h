@@ -0,0 +1,58 @@
+/**
+ * minimal benchmark runner for the native build.
+ *
+ * a benchmark is a function that runs the measured code a given number of times:
+ *
+ *   BENCHMARK(itoa_decimal)
+ *   {
+ *       char buffer[16];
+ *       for (size_t i = 0; i < iterations; i++)
+ *       {
+ *           benchmark_keep(itoa(int(i), buffer, 10));
+ *       }
+ *   }
+ *
+ * the runner scales the iteration count until a run takes at least the minimum time, then repeats the run
+ * and reports the fastest and the median time per iteration.
+ * results are printed as one JSON object per line, in the same layout as the CoreBenchmark library.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*benchmark_function_t)(size_t iterations);
+
+/**
+ * @brief a registered benchmark
+ */
+struct benchmark_t
+{
+    const char *name;
+    benchmark_function_t function;
+    benchmark_t *next;
+};
+
+/**
+ * @brief add a benchmark to the list run by the runner
+ * @note called by the BENCHMARK() macro during static initialization
+ */
+bool benchmark_register(benchmark_t *benchmark);
+
+/**
+ * @brief keep the compiler from optimizing away a value
+ */
+template <typename T>
+inline void benchmark_keep(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * @brief define and register a benchmark
+ * @note the body has access to the number of iterations as 'iterations'
+ */
+#define BENCHMARK(name)                                                          \
+    static void benchmark_##name(size_t iterations);                             \
+    static benchmark_t benchmark_entry_##name = {#name, benchmark_##name, NULL}; \
+    static const bool benchmark_registered_##name = benchmark_register(&benchmark_entry_##name); \
+    static void benchmark_##name(size_t iterations)
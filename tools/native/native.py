@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+build and run the portable core sources natively on the host
+
+the core sources listed in CORE_SOURCES do not depend on the MCU. they are compiled with the host compiler,
+with native_arduino.h replacing Arduino.h, and linked with the benchmarks in benchmarks/, or with --tests,
+the tests in tests/.
+
+e.g. run all benchmarks, and save the report:
+  tools/native/native.py > before.log
+  tools/native/native.py --filter print_ > after.log
+  tools/benchmark/compare.py before.log after.log --metric avg
+
+e.g. run all tests:
+  tools/native/native.py --tests
+"""
+import argparse
+import os
+import shlex
+import subprocess
+import sys
+import tempfile
+from concurrent.futures import ThreadPoolExecutor
+from os.path import abspath, dirname, join
+
+NATIVE_DIR = dirname(abspath(__file__))
+CORE_DIR = join(NATIVE_DIR, "..", "..", "cores", "arduino")
+BENCHMARK_DIR = join(NATIVE_DIR, "benchmarks")
+TEST_DIR = join(NATIVE_DIR, "tests")
+
+# core sources that build without the DDL
+CORE_SOURCES = [
+    "Print.cpp",
+    "Stream.cpp",
+    "TokenMatcher.cpp",
+    "WString.cpp",
+    "WMath.cpp",
+    "itoa.c",
+    "ftoa.c",
+    "parse_number.c",
+    "avr/dtostrf.c",
+    "core_dsp.cpp",
+]
+
+NATIVE_SOURCES = [
+    join(NATIVE_DIR, "native_arduino.cpp"),
+]
+
+
+def compile_source(source, build_dir, program_dir, args):
+    """
+    compile a source file. returns the object file path
+    """
+    is_c = source.endswith(".c")
+    compiler = args.cc if is_c else args.cxx
+    std = "-std=gnu11" if is_c else "-std=gnu++17"
+    obj = join(build_dir, os.path.relpath(abspath(source), abspath(join(NATIVE_DIR, "..", ".."))).replace(os.sep, "_") + ".o")
+
+    command = [compiler, std, "-c", source, "-o", obj,
+               "-include", join(NATIVE_DIR, "native_arduino.h"),
+               "-I", NATIVE_DIR, "-I", CORE_DIR, "-I", program_dir,
+               "-Wall"] + shlex.split(args.flags)
+    if args.verbose:
+        print(" ".join(command), file=sys.stderr)
+    subprocess.run(command, check=True)
+    return obj
+
+
+def main():
+    parser = argparse.ArgumentParser(description="build and run the native core benchmarks or tests")
+    parser.add_argument("--cc", default=os.environ.get("CC", "cc"), help="host C compiler (default $CC or cc)")
+    parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="host C++ compiler (default $CXX or c++)")
+    parser.add_argument("--flags", default="-O2 -g", help="compiler flags, e.g. '-O2 -DPRINT_FLOAT_NO_DTOSTRF' (default '-O2 -g')")
+    parser.add_argument("--build-dir", default=join(tempfile.gettempdir(), "hc32-native"), help="where to place the build output")
+    parser.add_argument("--tests", action="store_true", help="build and run the tests instead of the benchmarks")
+    parser.add_argument("--build-only", action="store_true", help="build, but do not run the benchmarks or tests")
+    parser.add_argument("--verbose", action="store_true", help="print the compiler commands")
+    args, benchmark_args = parser.parse_known_args()
+
+    os.makedirs(args.build_dir, exist_ok=True)
+    program_dir = TEST_DIR if args.tests else BENCHMARK_DIR
+    sources = [join(CORE_DIR, s) for s in CORE_SOURCES] + NATIVE_SOURCES + \
+        sorted(join(program_dir, s) for s in os.listdir(program_dir) if s.endswith(".cpp"))
+
+    try:
+        with ThreadPoolExecutor(max_workers=os.cpu_count()) as pool:
+            objects = list(pool.map(lambda s: compile_source(s, args.build_dir, program_dir, args), sources))
+
+        executable = join(args.build_dir, "tests" if args.tests else "benchmarks")
+        subprocess.run([args.cxx] + shlex.split(args.flags) + objects + ["-o", executable, "-lm"], check=True)
+    except subprocess.CalledProcessError as e:
+        print(f"build failed: {e}", file=sys.stderr)
+        return 1
+
+    if args.build_only:
+        print(executable)
+        return 0
+
+    return subprocess.run([executable] + benchmark_args).returncode
+
+
+if __name__ == "__main__":
+    sys.exit(main())
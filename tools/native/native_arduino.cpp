@@ -0,0 +1,22 @@
+#include "native_arduino.h"
+#include <chrono>
+
+static std::chrono::steady_clock::time_point start_time()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+uint32_t millis(void)
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time()).count());
+}
+
+uint32_t micros(void)
+{
+    return uint32_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time()).count());
+}
+
+void yield(void)
+{
+}
@@ -0,0 +1,64 @@
+/**
+ * host-side replacement of Arduino.h, for building the portable core sources natively.
+ *
+ * force-included (-include) into every source of the native build. it defines the include guard of Arduino.h,
+ * so the MCU headers (DDL, drivers, variant) are never pulled in, and provides the few functions the portable
+ * sources use from them instead.
+ */
+#pragma once
+#define Arduino_h
+#define CORE_NATIVE 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+
+// core_debug.h pulls in the panic driver. replace its macros with host equivalents
+#define _CORE_DEBUG_H
+#define CORE_DEBUG_INIT()
+#define CORE_DEBUG_PRINTF(fmt, ...) fprintf(stderr, fmt, ##__VA_ARGS__)
+#define CORE_ASSERT(expression, message, ...)                                    \
+    do                                                                           \
+    {                                                                            \
+        if (!(expression))                                                       \
+        {                                                                        \
+            fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, message); \
+            abort();                                                             \
+        }                                                                        \
+    } while (0)
+#define CORE_ASSERT_FAIL(message) CORE_ASSERT(false, message)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief milliseconds since the first call, from the host monotonic clock
+     */
+    uint32_t millis(void);
+
+    /**
+     * @brief microseconds since the first call, from the host monotonic clock
+     */
+    uint32_t micros(void);
+
+    /**
+     * @brief no-op, there is nothing to yield to on the host
+     */
+    void yield(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+#include "WString.h"
+#include "WMath.h"
+#endif
+#include "itoa.h"
+#include "avr/dtostrf.h"
@@ -0,0 +1,86 @@
+#include "test.h"
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static test_t *tests = NULL;
+
+// failures of the running test, and of all tests
+static int test_failures = 0;
+static int total_failures = 0;
+
+bool test_register(test_t *test)
+{
+    test->next = tests;
+    tests = test;
+    return true;
+}
+
+void test_fail(const char *file, const int line, const char *expression)
+{
+    fprintf(stderr, "%s:%d: expectation failed: %s\n", file, line, expression);
+    test_failures++;
+}
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--list] [--filter <substring>]\n", program);
+}
+
+int main(int argc, char **argv)
+{
+    const char *filter = NULL;
+    bool list = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--list") == 0)
+        {
+            list = true;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // registration order is reversed, sort by name for stable reports
+    std::vector<const test_t *> selected;
+    for (const test_t *t = tests; t != NULL; t = t->next)
+    {
+        if (filter == NULL || strstr(t->name, filter) != NULL)
+        {
+            selected.push_back(t);
+        }
+    }
+    std::sort(selected.begin(), selected.end(), [](const test_t *a, const test_t *b)
+              { return strcmp(a->name, b->name) < 0; });
+
+    if (list)
+    {
+        for (const test_t *t : selected)
+        {
+            printf("%s\n", t->name);
+        }
+        return 0;
+    }
+
+    int failed = 0;
+    for (const test_t *t : selected)
+    {
+        test_failures = 0;
+        t->function();
+        printf("%s %s\n", test_failures == 0 ? "PASS" : "FAIL", t->name);
+        failed += test_failures != 0 ? 1 : 0;
+        total_failures += test_failures;
+    }
+
+    printf("%zu tests, %d failed\n", selected.size(), failed);
+    return total_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+/**
+ * minimal test runner for the native build.
+ *
+ * a test is a function that checks the results of the code under test:
+ *
+ *   TEST(itoa_negative)
+ *   {
+ *       char buffer[16];
+ *       TEST_EXPECT(strcmp(itoa(-42, buffer, 10), "-42") == 0);
+ *   }
+ *
+ * the runner runs all tests, and prints every failed expectation.
+ * the exit code is non-zero if any expectation failed.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*test_function_t)();
+
+/**
+ * @brief a registered test
+ */
+struct test_t
+{
+    const char *name;
+    test_function_t function;
+    test_t *next;
+};
+
+/**
+ * @brief add a test to the list run by the runner
+ * @note called by the TEST() macro during static initialization
+ */
+bool test_register(test_t *test);
+
+/**
+ * @brief record a failed expectation of the running test
+ */
+void test_fail(const char *file, const int line, const char *expression);
+
+/**
+ * @brief define and register a test
+ */
+#define TEST(name)                                                              \
+    static void test_##name();                                                  \
+    static test_t test_entry_##name = {#name, test_##name, NULL};               \
+    static const bool test_registered_##name = test_register(&test_entry_##name); \
+    static void test_##name()
+
+/**
+ * @brief check an expression, and record a failure if it is false
+ * @note the test continues after a failure
+ */
+#define TEST_EXPECT(expression)                         \
+    do                                                  \
+    {                                                   \
+        if (!(expression))                              \
+        {                                               \
+            test_fail(__FILE__, __LINE__, #expression); \
+        }                                               \
+    } while (0)
@@ -0,0 +1,31 @@
+#include "test.h"
+#include "core_dsp.h"
+
+TEST(dsp_sum_u16_small)
+{
+    const uint16_t samples[5] = {1, 2, 3, 4, 5};
+    TEST_EXPECT(dsp_sum_u16(samples, 5) == 15);
+    TEST_EXPECT(dsp_sum_u16(samples, 0) == 0);
+}
+
+TEST(dsp_sum_u16_full_range)
+{
+    // samples >= 0x8000 must not be sign-extended
+    uint16_t samples[8];
+    for (size_t i = 0; i < 8; i++)
+    {
+        samples[i] = 40000;
+    }
+    TEST_EXPECT(dsp_sum_u16(samples, 8) == 320000);
+
+    // odd count, so the tail loop sees a large sample too
+    const uint16_t mixed[7] = {0xFFFF, 0x8000, 0x7FFF, 0, 0xFFFF, 1, 0x8001};
+    TEST_EXPECT(dsp_sum_u16(mixed, 7) == 0xFFFFu + 0x8000u + 0x7FFFu + 0xFFFFu + 1u + 0x8001u);
+}
+
+TEST(dsp_mean_u16_full_range)
+{
+    const uint16_t samples[4] = {40000, 40000, 50000, 50000};
+    TEST_EXPECT(dsp_mean_u16(samples, 4) == 45000);
+    TEST_EXPECT(dsp_mean_u16(samples, 0) == 0);
+}
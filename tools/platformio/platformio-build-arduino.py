@@ -5,8 +5,10 @@ control devices attached to a wide range of Arduino boards to create all
 kinds of creative coding, interactive objects, spaces or physical experiences.
 http://arduino.cc/en/Reference/HomePage
 """
+import os
+import re
 import sys
-from os.path import isfile, isdir, join
+from os.path import basename, isfile, isdir, join
 from SCons.Script import DefaultEnvironment, SConscript
 
 
@@ -53,6 +55,20 @@ env.Append(
     ]
 )
 
+# place SRAM sections (SRAMH, DMA buffers, Ret_SRAM), see core_util.h
+if board.get("build.sram_sections", "false") == "true":
+    env.Append(
+        CPPDEFINES=["CORE_SRAM_SECTIONS"],
+        LINKFLAGS=["-Wl,-T," + join(FRAMEWORK_DIR, "tools", "ld", "sram_sections.ld")],
+    )
+
+# tokenized debug output, format strings are kept out of flash. see core_debug_tokens.h
+if board.get("build.debug_tokens", "false") == "true":
+    env.Append(
+        CPPDEFINES=["CORE_DEBUG_TOKENIZED"],
+        LINKFLAGS=["-Wl,-T," + join(FRAMEWORK_DIR, "tools", "ld", "debug_tokens.ld")],
+    )
+
 # enable all drivers required by the core
 core_requirements = [
     "adc",
@@ -66,11 +82,73 @@ core_requirements = [
     "rmu",
     "sram",
     "usart",
-    "timera"
+    "timera",
+    "timer0",
 ]
+
+# drivers only used by the bundled libraries: (headers using the driver, built without pruning)
+library_requirements = {
+    "spi": (["SPI.h"], True),
+    "i2c": (["Wire.h"], True),
+    "wdt": (["IWatchdog.h"], False),
+    "ots": (["OnChipTemperature.h"], False),
+    "trng": (["TrueRandom.h"], False),
+}
+
+# headers included and serial ports referenced by the project, for pruning
+INCLUDE_PATTERN = re.compile(r"^\s*#\s*include\s*[<\"]([^>\"]+)[>\"]", re.MULTILINE)
+SERIAL_PATTERN = re.compile(r"\bSerial([1-4]?)\b")
+SOURCE_SUFFIXES = (".c", ".cpp", ".cc", ".h", ".hpp", ".ino")
+
+
+def scan_project():
+    """
+    scan the project sources and installed libraries. returns (set of included header names, set of serial port numbers)
+    """
+    includes = set()
+    serials = set()
+    dirs = [env.subst(d) for d in ["$PROJECT_SRC_DIR", "$PROJECT_INCLUDE_DIR", "$PROJECT_LIB_DIR", join("$PROJECT_LIBDEPS_DIR", "$PIOENV")]]
+    for d in dirs:
+        if not isdir(d):
+            continue
+        for root, _, files in os.walk(d):
+            for name in files:
+                if not name.endswith(SOURCE_SUFFIXES):
+                    continue
+                with open(join(root, name), "r", errors="replace") as f:
+                    source = f.read()
+                includes.update(basename(i) for i in INCLUDE_PATTERN.findall(source))
+                serials.update(int(n or "1") for n in SERIAL_PATTERN.findall(source))
+
+    # e.g. -D CORE_DEBUG_PRINT_TARGET=Serial2
+    flags = str(env.get("CPPDEFINES", [])) + str(env.get("BUILD_FLAGS", []))
+    serials.update(int(n or "1") for n in SERIAL_PATTERN.findall(flags))
+    return includes, serials
+
+
+prune_drivers = board.get("build.prune_drivers", "false") == "true"
+serial_globals = board.get("build.serial_globals", "all").strip().lower()
+project_includes, project_serials = scan_project() if prune_drivers or serial_globals == "auto" else (set(), set())
+
+# with build.prune_drivers, library drivers are only built when the project includes the library.
+# drivers enabled explicitly using board_build.ddl.<driver> = true are always built
+for req, (headers, default) in library_requirements.items():
+    if any(h in project_includes for h in headers) if prune_drivers else default:
+        core_requirements.append(req)
+
 for req in core_requirements:
     board.update(f"build.ddl.{req}", "true")
 
+# global SerialN instances to construct: 'all' (default), 'none', 'auto' (referenced by the project), or a list, e.g. '1, 3'
+if serial_globals == "none":
+    env.Append(CPPDEFINES=["DISABLE_SERIAL_GLOBALS"])
+elif serial_globals != "all":
+    if serial_globals == "auto":
+        keep = project_serials
+    else:
+        keep = {int(n) for n in re.split(r"[\s,]+", serial_globals) if n}
+    env.Append(CPPDEFINES=[f"DISABLE_SERIAL{n}_GLOBAL" for n in range(1, 5) if n not in keep])
+
 # build the ddl core
 ddl_build_script = join(env.PioPlatform().get_package_dir("framework-hc32f46x-ddl"), "tools", "platformio", "platformio-build-ddl.py")
 if not isfile(ddl_build_script):
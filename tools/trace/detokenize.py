@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""
+decode tokenized debug output, see core_debug_tokens.h
+
+reads the format strings from the .core_debug_tokens section of the firmware ELF file, and formats the frames
+of a serial capture with them. everything that is not a frame (e.g. panic messages) is passed through unchanged.
+
+e.g. decode a live serial port:
+  stty -F /dev/ttyUSB0 115200 raw && detokenize.py .pio/build/env/firmware.elf /dev/ttyUSB0
+"""
+import argparse
+import re
+import struct
+import sys
+
+SECTION_NAME = ".core_debug_tokens"
+SYNC = 0xC5
+HEADER_SIZE = 6
+TRUNCATED = 0x80
+
+# printf conversion specification
+CONVERSION = re.compile(r"%([-+ #0]*)(\d+|\*)?(?:\.(\d+|\*))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcsp%])")
+
+
+def load_tokens(elf_path):
+    """
+    read the format strings from the ELF file. returns a dict of token -> format string
+    """
+    with open(elf_path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[5] != 1:
+        raise ValueError(f"{elf_path} is not a little-endian ELF file")
+
+    is_64 = elf[4] == 2
+    if is_64:
+        shoff, = struct.unpack_from("<Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x3A)
+        section = struct.Struct("<IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from("<I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from("<HHH", elf, 0x2E)
+        section = struct.Struct("<IIIIIIIIII")
+
+    # name, type, flags, addr, offset, size, link, info, addralign, entsize
+    sections = [section.unpack_from(elf, shoff + (i * shentsize)) for i in range(shnum)]
+    strtab_offset = sections[shstrndx][4]
+
+    def section_name(s):
+        start = strtab_offset + s[0]
+        return elf[start:elf.index(b"\0", start)].decode("ascii")
+
+    tokens = {}
+    for s in sections:
+        if section_name(s) != SECTION_NAME:
+            continue
+
+        address, offset, size = s[3], s[4], s[5]
+        data = elf[offset:offset + size]
+        start = 0
+        while start < len(data):
+            end = data.find(b"\0", start)
+            if end < 0:
+                end = len(data)
+            tokens[address + start] = data[start:end].decode("utf-8", errors="replace")
+            start = end + 1
+
+    if not tokens:
+        raise ValueError(f"{elf_path} has no {SECTION_NAME} section. was it built with board_build.debug_tokens = true?")
+    return tokens
+
+
+class ArgumentReader:
+    def __init__(self, payload):
+        self.payload = payload
+        self.position = 0
+
+    def unpack(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.position + size > len(self.payload):
+            raise IndexError()
+        value, = struct.unpack_from(fmt, self.payload, self.position)
+        self.position += size
+        return value
+
+    def string(self):
+        end = self.payload.find(b"\0", self.position)
+        if end < 0:
+            raise IndexError()
+        value = self.payload[self.position:end].decode("utf-8", errors="replace")
+        self.position = end + 1
+        return value
+
+
+def format_message(fmt, payload, truncated):
+    """
+    format a message like printf(), taking the arguments from the frame payload
+    """
+    args = ArgumentReader(payload)
+    out = []
+    last = 0
+    for match in CONVERSION.finditer(fmt):
+        out.append(fmt[last:match.start()])
+        last = match.end()
+
+        flags, width, precision, length, conversion = match.groups()
+        if conversion == "%":
+            out.append("%")
+            continue
+
+        try:
+            # '*' width and precision are passed as int arguments
+            if width == "*":
+                width = str(args.unpack("<i"))
+            if precision == "*":
+                precision = str(args.unpack("<i"))
+
+            wide = length in ("ll", "j")
+            if conversion in "di":
+                value = args.unpack("<q" if wide else "<i")
+                if length in ("h", "hh"):
+                    bits = 8 if length == "hh" else 16
+                    value = ((value + (1 << (bits - 1))) & ((1 << bits) - 1)) - (1 << (bits - 1))
+            elif conversion in "ouxXc":
+                value = args.unpack("<Q" if wide else "<I")
+                if length in ("h", "hh"):
+                    value &= 0xFF if length == "hh" else 0xFFFF
+            elif conversion == "p":
+                value = args.unpack("<I")
+            elif conversion == "s":
+                value = args.string()
+            else:
+                value = args.unpack("<d")
+        except IndexError:
+            # keep the line structure of the output
+            out.append("<truncated>" if truncated else "<missing>")
+            out.append("\n" if fmt.endswith("\n") else "")
+            last = len(fmt)
+            break
+
+        spec = "%" + flags + (width or "") + (("." + precision) if precision is not None else "")
+        if conversion == "p":
+            out.append((spec + "s") % f"0x{value:x}")
+        elif conversion == "c":
+            out.append((spec + "c") % chr(value & 0xFF))
+        elif conversion == "u":
+            out.append((spec + "d") % value)
+        elif conversion in "aA":
+            out.append(float(value).hex())
+        else:
+            out.append((spec + conversion) % value)
+
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode(stream, tokens, output):
+    """
+    decode frames from a byte stream, passing everything else through
+    """
+    buffer = b""
+    while True:
+        chunk = stream.read(1) if stream.isatty() else stream.read(4096)
+        if not chunk:
+            break
+        buffer += chunk
+
+        while buffer:
+            sync = buffer.find(bytes([SYNC]))
+            if sync < 0:
+                output.write(buffer.decode("utf-8", errors="replace"))
+                buffer = b""
+                break
+            if sync > 0:
+                output.write(buffer[:sync].decode("utf-8", errors="replace"))
+                buffer = buffer[sync:]
+
+            if len(buffer) < HEADER_SIZE:
+                break
+
+            token, = struct.unpack_from("<I", buffer, 1)
+            length = buffer[5] & ~TRUNCATED
+            if token not in tokens:
+                # not a frame, pass the byte through
+                output.write(buffer[:1].decode("latin-1"))
+                buffer = buffer[1:]
+                continue
+
+            if len(buffer) < HEADER_SIZE + length:
+                break
+
+            payload = buffer[HEADER_SIZE:HEADER_SIZE + length]
+            output.write(format_message(tokens[token], payload, (buffer[5] & TRUNCATED) != 0))
+            buffer = buffer[HEADER_SIZE + length:]
+
+        output.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode tokenized CORE_DEBUG_PRINTF output")
+    parser.add_argument("elf", help="firmware ELF file, built with board_build.debug_tokens = true")
+    parser.add_argument("input", help="serial capture or serial port. '-' for stdin")
+    args = parser.parse_args()
+
+    tokens = load_tokens(args.elf)
+    stream = sys.stdin.buffer if args.input == "-" else open(args.input, "rb", buffering=0)
+    decode(stream, tokens, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
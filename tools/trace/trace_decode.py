@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""
+decode binary trace records written by core_trace.h
+
+input is either
+- a capture of the serial output of core_trace_drain() (default), or
+- a raw memory dump of core_trace_buffer, taken with a debug probe (--raw). e.g. in gdb:
+  dump binary memory trace.bin &core_trace_buffer ((char*)&core_trace_buffer + sizeof(core_trace_buffer))
+
+event names are read from the core_trace_event_t enum in core_trace.h. user events can be named by passing
+additional headers with --events, using the same "NAME = value," format.
+"""
+import argparse
+import re
+import struct
+import sys
+from os.path import abspath, dirname, join
+
+RECORD = struct.Struct("<IHHII")
+SYNC = 0xA5
+SEQUENCE_VALID = 0x8000
+EVENT_LOST = 0x0000
+EVENT_START = 0x0001
+
+DEFAULT_HEADER = join(dirname(abspath(__file__)), "..", "..", "cores", "arduino", "core_trace.h")
+EVENT_PATTERN = re.compile(r"^\s*(\w+)\s*=\s*(0x[0-9a-fA-F]+|\d+)\s*,", re.MULTILINE)
+
+
+def load_event_names(headers):
+    names = {}
+    for header in headers:
+        with open(header, "r") as f:
+            for name, value in EVENT_PATTERN.findall(f.read()):
+                names[int(value, 0)] = name.replace("CORE_TRACE_EVENT_", "")
+    return names
+
+
+def parse_stream(data):
+    """
+    parse the output of core_trace_drain(). bytes between records (e.g. text output on the same port) are skipped
+    """
+    records = []
+    i = 0
+    while i + 1 + RECORD.size <= len(data):
+        if data[i] != SYNC:
+            i += 1
+            continue
+
+        record = RECORD.unpack_from(data, i + 1)
+        if (record[2] & SEQUENCE_VALID) == 0:
+            i += 1
+            continue
+
+        records.append(record)
+        i += 1 + RECORD.size
+    return records
+
+
+def parse_raw(data):
+    """
+    parse a memory dump of core_trace_buffer, and bring the records into ring order
+    """
+    records = []
+    for i in range(len(data) // RECORD.size):
+        record = RECORD.unpack_from(data, i * RECORD.size)
+        if (record[2] & SEQUENCE_VALID) != 0:
+            records.append(record)
+
+    if len(records) < 2:
+        return records
+
+    # the record numbers are consecutive, modulo 2^15. the oldest record follows the largest gap
+    records.sort(key=lambda r: r[2] & 0x7FFF)
+    gaps = [((records[(i + 1) % len(records)][2] - records[i][2]) & 0x7FFF, i) for i in range(len(records))]
+    _, last = max(gaps)
+    return records[last + 1:] + records[:last + 1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode core_trace records")
+    parser.add_argument("input", help="serial capture, or memory dump with --raw. '-' for stdin")
+    parser.add_argument("--raw", action="store_true", help="input is a memory dump of core_trace_buffer")
+    parser.add_argument("--hclk", type=float, default=None, help="HCLK frequency in Hz, if the trace has no START record")
+    parser.add_argument("--events", action="append", default=[], help="additional header defining event names")
+    args = parser.parse_args()
+
+    names = load_event_names([DEFAULT_HEADER] + args.events)
+
+    data = sys.stdin.buffer.read() if args.input == "-" else open(args.input, "rb").read()
+    records = parse_raw(data) if args.raw else parse_stream(data)
+
+    hclk = args.hclk
+    start = None
+    previous = None
+    for timestamp, event, sequence, arg0, arg1 in records:
+        if event == EVENT_START and args.hclk is None:
+            hclk = float(arg0)
+
+        if event == EVENT_LOST:
+            print(f"{'':>14} {'':>12}  *** {arg0} records lost ***")
+            continue
+
+        if start is None:
+            start = timestamp
+            previous = timestamp
+
+        # the cycle counter wraps every 2^32 cycles, so times are only exact for gaps below that
+        elapsed = (timestamp - start) & 0xFFFFFFFF
+        delta = (timestamp - previous) & 0xFFFFFFFF
+        previous = timestamp
+
+        name = names.get(event, f"EVENT_0x{event:04x}")
+        if hclk:
+            when = f"{elapsed * 1e6 / hclk:12.3f}us {delta * 1e6 / hclk:+10.3f}us"
+        else:
+            when = f"{elapsed:12d}cy {delta:+10d}cy"
+        print(f"{when}  {name:<28} 0x{arg0:08x} 0x{arg1:08x}")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
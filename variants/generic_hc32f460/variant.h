@@ -123,6 +123,103 @@
 #define PH1 81
 #define PH2 82
 
+//
+// GPIO pin map
+// PINMAP_ENTRY(bit_pos, port, bit_mask, adc, timera) for every pin, in pin number order.
+// expanded into PIN_MAP (variant.cpp) and PIN_MAP_CONSTEXPR (WVariant.h).
+// see WVariant.h for PINMAP_ADC() and PINMAP_TIMA()
+//
+#define VARIANT_PIN_MAP(PINMAP_ENTRY) \
+	/* ---  PAx  --- */ \
+	PINMAP_ENTRY(0, PortA, Pin00, PINMAP_ADC(ADC1_IN0), PINMAP_TIMA(2, 1, 4)) /* PA0 */ \
+	PINMAP_ENTRY(1, PortA, Pin01, PINMAP_ADC(ADC1_IN1), PINMAP_TIMA(2, 2, 4)) /* PA1 */ \
+	PINMAP_ENTRY(2, PortA, Pin02, PINMAP_ADC(ADC1_IN2), PINMAP_TIMA(5, 1, 5)) /* PA2 */ \
+	PINMAP_ENTRY(3, PortA, Pin03, PINMAP_ADC(ADC1_IN3), PINMAP_TIMA(5, 2, 5)) /* PA3 */ \
+	PINMAP_ENTRY(4, PortA, Pin04, PINMAP_ADC(ADC12_IN4), PINMAP_TIMA(3, 5, 5)) /* PA4 */ \
+	PINMAP_ENTRY(5, PortA, Pin05, PINMAP_ADC(ADC12_IN5), PINMAP_TIMA(3, 6, 5)) /* PA5 */ \
+	PINMAP_ENTRY(6, PortA, Pin06, PINMAP_ADC(ADC12_IN6), PINMAP_TIMA(3, 1, 5)) /* PA6 */ \
+	PINMAP_ENTRY(7, PortA, Pin07, PINMAP_ADC(ADC12_IN7), PINMAP_TIMA(3, 2, 5)) /* PA7 */ \
+	PINMAP_ENTRY(8, PortA, Pin08, PINMAP_ADC_NONE, PINMAP_TIMA(1, 1, 4)) /* PA8 */ \
+	PINMAP_ENTRY(9, PortA, Pin09, PINMAP_ADC_NONE, PINMAP_TIMA(1, 2, 4)) /* PA9 */ \
+	PINMAP_ENTRY(10, PortA, Pin10, PINMAP_ADC_NONE, PINMAP_TIMA(1, 3, 4)) /* PA10 */ \
+	PINMAP_ENTRY(11, PortA, Pin11, PINMAP_ADC_NONE, PINMAP_TIMA(1, 4, 4)) /* PA11 */ \
+	PINMAP_ENTRY(12, PortA, Pin12, PINMAP_ADC_NONE, PINMAP_TIMA(6, 1, 5)) /* PA12 */ \
+	PINMAP_ENTRY(13, PortA, Pin13, PINMAP_ADC_NONE, PINMAP_TIMA(6, 2, 5)) /* PA13 */ \
+	PINMAP_ENTRY(14, PortA, Pin14, PINMAP_ADC_NONE, PINMAP_TIMA(6, 3, 5)) /* PA14 */ \
+	PINMAP_ENTRY(15, PortA, Pin15, PINMAP_ADC_NONE, PINMAP_TIMA(6, 4, 5)) /* PA15 */ \
+	/* ---  PBx  --- */ \
+	PINMAP_ENTRY(0, PortB, Pin00, PINMAP_ADC(ADC12_IN8), PINMAP_TIMA(3, 3, 5)) /* PB0 */ \
+	PINMAP_ENTRY(1, PortB, Pin01, PINMAP_ADC(ADC12_IN9), PINMAP_TIMA(3, 4, 5)) /* PB1 */ \
+	PINMAP_ENTRY(2, PortB, Pin02, PINMAP_ADC_NONE, PINMAP_TIMA(1, 8, 4)) /* PB2 */ \
+	PINMAP_ENTRY(3, PortB, Pin03, PINMAP_ADC_NONE, PINMAP_TIMA(6, 5, 5)) /* PB3 */ \
+	PINMAP_ENTRY(4, PortB, Pin04, PINMAP_ADC_NONE, PINMAP_TIMA(6, 6, 5)) /* PB4 */ \
+	PINMAP_ENTRY(5, PortB, Pin05, PINMAP_ADC_NONE, PINMAP_TIMA(6, 7, 5)) /* PB5 */ \
+	PINMAP_ENTRY(6, PortB, Pin06, PINMAP_ADC_NONE, PINMAP_TIMA(6, 8, 5)) /* PB6 */ \
+	PINMAP_ENTRY(7, PortB, Pin07, PINMAP_ADC_NONE, PINMAP_TIMA(4, 2, 4)) /* PB7 */ \
+	PINMAP_ENTRY(8, PortB, Pin08, PINMAP_ADC_NONE, PINMAP_TIMA(4, 3, 4)) /* PB8 */ \
+	PINMAP_ENTRY(9, PortB, Pin09, PINMAP_ADC_NONE, PINMAP_TIMA(4, 4, 4)) /* PB9 */ \
+	PINMAP_ENTRY(10, PortB, Pin10, PINMAP_ADC_NONE, PINMAP_TIMA(5, 8, 5)) /* PB10 */ \
+	PINMAP_ENTRY(11, PortB, Pin11, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PB11 */ \
+	PINMAP_ENTRY(12, PortB, Pin12, PINMAP_ADC_NONE, PINMAP_TIMA(1, 8, 4)) /* PB12 */ \
+	PINMAP_ENTRY(13, PortB, Pin13, PINMAP_ADC_NONE, PINMAP_TIMA(1, 5, 4)) /* PB13 */ \
+	PINMAP_ENTRY(14, PortB, Pin14, PINMAP_ADC_NONE, PINMAP_TIMA(1, 6, 4)) /* PB14 */ \
+	PINMAP_ENTRY(15, PortB, Pin15, PINMAP_ADC_NONE, PINMAP_TIMA(1, 7, 4)) /* PB15 */ \
+	/* ---  PCx  --- */ \
+	PINMAP_ENTRY(0, PortC, Pin00, PINMAP_ADC(ADC12_IN10), PINMAP_TIMA(2, 5, 4)) /* PC0 */ \
+	PINMAP_ENTRY(1, PortC, Pin01, PINMAP_ADC(ADC12_IN11), PINMAP_TIMA(2, 6, 4)) /* PC1 */ \
+	PINMAP_ENTRY(2, PortC, Pin02, PINMAP_ADC(ADC1_IN12), PINMAP_TIMA(2, 7, 4)) /* PC2 */ \
+	PINMAP_ENTRY(3, PortC, Pin03, PINMAP_ADC(ADC1_IN13), PINMAP_TIMA(2, 8, 4)) /* PC3 */ \
+	PINMAP_ENTRY(4, PortC, Pin04, PINMAP_ADC(ADC1_IN14), PINMAP_TIMA(3, 7, 5)) /* PC4 */ \
+	PINMAP_ENTRY(5, PortC, Pin05, PINMAP_ADC(ADC1_IN15), PINMAP_TIMA(3, 8, 5)) /* PC5 */ \
+	PINMAP_ENTRY(6, PortC, Pin06, PINMAP_ADC_NONE, PINMAP_TIMA(5, 8, 5)) /* PC6 */ \
+	PINMAP_ENTRY(7, PortC, Pin07, PINMAP_ADC_NONE, PINMAP_TIMA(5, 7, 5)) /* PC7 */ \
+	PINMAP_ENTRY(8, PortC, Pin08, PINMAP_ADC_NONE, PINMAP_TIMA(5, 6, 5)) /* PC8 */ \
+	PINMAP_ENTRY(9, PortC, Pin09, PINMAP_ADC_NONE, PINMAP_TIMA(5, 5, 5)) /* PC9 */ \
+	PINMAP_ENTRY(10, PortC, Pin10, PINMAP_ADC_NONE, PINMAP_TIMA(5, 1, 5)) /* PC10 */ \
+	PINMAP_ENTRY(11, PortC, Pin11, PINMAP_ADC_NONE, PINMAP_TIMA(5, 2, 5)) /* PC11 */ \
+	PINMAP_ENTRY(12, PortC, Pin12, PINMAP_ADC_NONE, PINMAP_TIMA(5, 3, 5)) /* PC12 */ \
+	PINMAP_ENTRY(13, PortC, Pin13, PINMAP_ADC_NONE, PINMAP_TIMA(4, 8, 4)) /* PC13 */ \
+	PINMAP_ENTRY(14, PortC, Pin14, PINMAP_ADC_NONE, PINMAP_TIMA(4, 5, 4)) /* PC14 XTAL32_OUT */ \
+	PINMAP_ENTRY(15, PortC, Pin15, PINMAP_ADC_NONE, PINMAP_TIMA(4, 6, 4)) /* PC15 XTAL32_IN */ \
+	/* ---  PDx  --- */ \
+	PINMAP_ENTRY(0, PortD, Pin00, PINMAP_ADC_NONE, PINMAP_TIMA(5, 4, 5)) /* PD0 */ \
+	PINMAP_ENTRY(1, PortD, Pin01, PINMAP_ADC_NONE, PINMAP_TIMA(6, 5, 5)) /* PD1 */ \
+	PINMAP_ENTRY(2, PortD, Pin02, PINMAP_ADC_NONE, PINMAP_TIMA(6, 6, 5)) /* PD2 */ \
+	PINMAP_ENTRY(3, PortD, Pin03, PINMAP_ADC_NONE, PINMAP_TIMA(6, 7, 5)) /* PD3 */ \
+	PINMAP_ENTRY(4, PortD, Pin04, PINMAP_ADC_NONE, PINMAP_TIMA(6, 8, 5)) /* PD4 */ \
+	PINMAP_ENTRY(5, PortD, Pin05, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PD5 */ \
+	PINMAP_ENTRY(6, PortD, Pin06, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PD6 */ \
+	PINMAP_ENTRY(7, PortD, Pin07, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PD7 */ \
+	PINMAP_ENTRY(8, PortD, Pin08, PINMAP_ADC_NONE, PINMAP_TIMA(6, 1, 5)) /* PD8 */ \
+	PINMAP_ENTRY(9, PortD, Pin09, PINMAP_ADC_NONE, PINMAP_TIMA(6, 2, 5)) /* PD9 */ \
+	PINMAP_ENTRY(10, PortD, Pin10, PINMAP_ADC_NONE, PINMAP_TIMA(6, 3, 5)) /* PD10 */ \
+	PINMAP_ENTRY(11, PortD, Pin11, PINMAP_ADC_NONE, PINMAP_TIMA(6, 4, 5)) /* PD11 */ \
+	PINMAP_ENTRY(12, PortD, Pin12, PINMAP_ADC_NONE, PINMAP_TIMA(5, 5, 5)) /* PD12 */ \
+	PINMAP_ENTRY(13, PortD, Pin13, PINMAP_ADC_NONE, PINMAP_TIMA(5, 6, 5)) /* PD13 */ \
+	PINMAP_ENTRY(14, PortD, Pin14, PINMAP_ADC_NONE, PINMAP_TIMA(5, 7, 5)) /* PD14 */ \
+	PINMAP_ENTRY(15, PortD, Pin15, PINMAP_ADC_NONE, PINMAP_TIMA(5, 8, 5)) /* PD15 */ \
+	/* ---  PEx  --- */ \
+	PINMAP_ENTRY(0, PortE, Pin00, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PE0 */ \
+	PINMAP_ENTRY(1, PortE, Pin01, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PE1 */ \
+	PINMAP_ENTRY(2, PortE, Pin02, PINMAP_ADC_NONE, PINMAP_TIMA(3, 5, 4)) /* PE2 */ \
+	PINMAP_ENTRY(3, PortE, Pin03, PINMAP_ADC_NONE, PINMAP_TIMA(3, 6, 4)) /* PE3 */ \
+	PINMAP_ENTRY(4, PortE, Pin04, PINMAP_ADC_NONE, PINMAP_TIMA(3, 7, 4)) /* PE4 */ \
+	PINMAP_ENTRY(5, PortE, Pin05, PINMAP_ADC_NONE, PINMAP_TIMA(3, 8, 4)) /* PE5 */ \
+	PINMAP_ENTRY(6, PortE, Pin06, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PE6 */ \
+	PINMAP_ENTRY(7, PortE, Pin07, PINMAP_ADC_NONE, PINMAP_TIMA_NONE) /* PE7 */ \
+	PINMAP_ENTRY(8, PortE, Pin08, PINMAP_ADC_NONE, PINMAP_TIMA(1, 5, 4)) /* PE8 */ \
+	PINMAP_ENTRY(9, PortE, Pin09, PINMAP_ADC_NONE, PINMAP_TIMA(1, 1, 4)) /* PE9 */ \
+	PINMAP_ENTRY(10, PortE, Pin10, PINMAP_ADC_NONE, PINMAP_TIMA(1, 6, 4)) /* PE10 */ \
+	PINMAP_ENTRY(11, PortE, Pin11, PINMAP_ADC_NONE, PINMAP_TIMA(1, 2, 4)) /* PE11 */ \
+	PINMAP_ENTRY(12, PortE, Pin12, PINMAP_ADC_NONE, PINMAP_TIMA(1, 7, 4)) /* PE12 */ \
+	PINMAP_ENTRY(13, PortE, Pin13, PINMAP_ADC_NONE, PINMAP_TIMA(1, 3, 4)) /* PE13 */ \
+	PINMAP_ENTRY(14, PortE, Pin14, PINMAP_ADC_NONE, PINMAP_TIMA(1, 4, 4)) /* PE14 */ \
+	PINMAP_ENTRY(15, PortE, Pin15, PINMAP_ADC_NONE, PINMAP_TIMA(1, 8, 4)) /* PE15 */ \
+	/* ---  PHx  --- */ \
+	PINMAP_ENTRY(0, PortH, Pin00, PINMAP_ADC_NONE, PINMAP_TIMA(5, 3, 5)) /* PH0   XTAL_IN */ \
+	PINMAP_ENTRY(1, PortH, Pin01, PINMAP_ADC_NONE, PINMAP_TIMA(5, 4, 5)) /* PH1   XTAL_OUT */ \
+	PINMAP_ENTRY(2, PortH, Pin02, PINMAP_ADC_NONE, PINMAP_TIMA(4, 7, 4)) /* PH2 */
+
 //
 // USART gpio pins
 //
@@ -135,4 +232,22 @@
 #define VARIANT_USART3_TX_PIN PE5
 #define VARIANT_USART3_RX_PIN PE4
 
+#define VARIANT_USART4_TX_PIN PB10
+#define VARIANT_USART4_RX_PIN PB11
+
+//
+// SPI gpio pins
+// (for the default SPI instance, which uses SPI1)
+//
+#define VARIANT_SPI1_MOSI_PIN PA7
+#define VARIANT_SPI1_MISO_PIN PA6
+#define VARIANT_SPI1_SCK_PIN PA5
+
+//
+// I2C gpio pins
+// (for the default Wire instance, which uses I2C1)
+//
+#define VARIANT_I2C1_SCL_PIN PB6
+#define VARIANT_I2C1_SDA_PIN PB7
+
 #endif /* BOARD_VARIANT_H_ */